@@ -26,6 +26,7 @@
 #if defined(USE_Z_STD)
 
 #include <stdint.h>
+#include <pthread.h>
 #include <zstd.h>      // presumes zstd library is installed
 
 
@@ -34,21 +35,73 @@
 //so allocate 1700 bytes as the max input size we expect in a single shot
 #define COMPRESSION_BUFFER_IN_MAX_SIZE 1700
 
+//Blocks are written as independent zstd frames of up to this size (before compression), so they can be
+//compressed and decompressed in parallel. A file of several frames is still a regular zstd stream
+#define COMPRESSION_FRAME_SIZE (1024 * 1024)
+//Number of threads compressing or decompressing the frames of a file
+#define COMPRESSION_NUM_OF_WORKERS 4
+//Number of frames in flight: being filled, compressed or waiting to be written (or read ahead when decompressing)
+#define COMPRESSION_NUM_OF_FRAMES (2 * COMPRESSION_NUM_OF_WORKERS)
+//Frames that declare a larger decompressed size (or no size at all, like frames written by a streaming compressor)
+//are decompressed as a stream on the reading thread
+#define DECOMPRESSION_MAX_FRAME_SIZE (64 * 1024 * 1024)
+
+//A frame handed from the file thread to the workers and back. buffer_in holds the data the worker reads
+//and buffer_out the data it produces
+struct zstd_frame_t
+{
+	uint8_t* buffer_in;
+	size_t in_size;
+	size_t in_capacity;
+	uint8_t* buffer_out;
+	size_t out_size;
+	size_t out_capacity;
+	int is_done;
+	int is_error;
+};
+
+//State shared between the thread reading or writing the file and the worker threads. Frames are handed to the
+//workers in sequence numbers, the frame of sequence number n is frames[n % COMPRESSION_NUM_OF_FRAMES]
+struct zstd_worker_pool_t
+{
+	struct zstd_frame_t frames[COMPRESSION_NUM_OF_FRAMES];
+	//the next frame to be taken by a worker and the number of frames handed to the workers
+	uint64_t next_frame_to_process;
+	uint64_t num_of_frames_submitted;
+	pthread_t workers[COMPRESSION_NUM_OF_WORKERS];
+	int num_of_workers;
+	int stopping;
+	pthread_mutex_t mutex;
+	pthread_cond_t frame_submitted;
+	pthread_cond_t frame_done;
+	int compression_level;
+	int is_compression;
+};
+
 //This is the z-std compression type I would call it z-std type and realias 
 //2x but complier won't let me do that across bounds it seems
 //So I gave it a generic "light" name....
 struct zstd_compression_t
 {
-	uint32_t* buffer_in;
-	uint32_t* buffer_out;
-	size_t buffer_in_max_size;
-	size_t buffer_out_max_size;
-	int compression_level;
-	ZSTD_CCtx* cctx;
+	struct zstd_worker_pool_t pool;
+	//the next frame to write to the file, all frames before the one being filled were submitted
+	uint64_t next_frame_to_write;
+	int is_error;
 };
 
 struct zstd_decompression_t
 {
+	struct zstd_worker_pool_t pool;
+	//the next frame whose output is consumed and the position in its output
+	uint64_t next_frame_to_read;
+	size_t read_pos;
+	//compressed bytes read from the file that aren't submitted yet
+	uint8_t* pending;
+	size_t pending_size;
+	size_t pending_capacity;
+	int is_file_eof;
+	//once a frame can't be decompressed in parallel the rest of the file is decompressed as a stream
+	int is_streaming;
 	uint32_t* buffer_in;
 	uint32_t* buffer_out;
 	size_t buffer_in_max_size;
@@ -46,18 +46,165 @@ int(*close_compressed)(struct light_file_t *) = &close_zstd_compresssed;
 		_a > _b ? _a : _b; })
 #endif // !defined(_MSC_VER) || !defined(max)
 
+//Enough bytes to hold the header of any zstd frame, which has the frame content size
+#define ZSTD_FRAME_HEADER_MAX_SIZE 18
+
+static size_t zstd_process_frame(struct zstd_worker_pool_t* pool, struct zstd_frame_t* frame, ZSTD_CCtx* cctx, ZSTD_DCtx* dctx)
+{
+	if (pool->is_compression)
+		return ZSTD_compressCCtx(cctx, frame->buffer_out, frame->out_capacity, frame->buffer_in, frame->in_size, pool->compression_level);
+	else
+		return ZSTD_decompressDCtx(dctx, frame->buffer_out, frame->out_capacity, frame->buffer_in, frame->in_size);
+}
+
+static void* zstd_worker_main(void* arg)
+{
+	struct zstd_worker_pool_t* pool = (struct zstd_worker_pool_t*)arg;
+	//Every worker has its own context, they are expensive to create so they are kept for the whole file
+	ZSTD_CCtx* cctx = pool->is_compression ? ZSTD_createCCtx() : NULL;
+	ZSTD_DCtx* dctx = pool->is_compression ? NULL : ZSTD_createDCtx();
+
+	pthread_mutex_lock(&pool->mutex);
+	while (1)
+	{
+		while (pool->next_frame_to_process == pool->num_of_frames_submitted && !pool->stopping)
+			pthread_cond_wait(&pool->frame_submitted, &pool->mutex);
+
+		if (pool->next_frame_to_process == pool->num_of_frames_submitted)
+			break;
+
+		//The frame isn't touched by the file thread until it's done, so it's processed without holding the lock
+		struct zstd_frame_t* frame = &pool->frames[pool->next_frame_to_process % COMPRESSION_NUM_OF_FRAMES];
+		pool->next_frame_to_process++;
+		pthread_mutex_unlock(&pool->mutex);
+
+		size_t result = zstd_process_frame(pool, frame, cctx, dctx);
+
+		pthread_mutex_lock(&pool->mutex);
+		frame->is_error = ZSTD_isError(result) ? 1 : 0;
+		frame->out_size = frame->is_error ? 0 : result;
+		frame->is_done = 1;
+		pthread_cond_broadcast(&pool->frame_done);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	if (cctx)
+		ZSTD_freeCCtx(cctx);
+	if (dctx)
+		ZSTD_freeDCtx(dctx);
+	return NULL;
+}
+
+static void zstd_pool_init(struct zstd_worker_pool_t* pool, int is_compression, int compression_level)
+{
+	int i;
+
+	pool->is_compression = is_compression;
+	pool->compression_level = compression_level;
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->frame_submitted, NULL);
+	pthread_cond_init(&pool->frame_done, NULL);
+
+	//If no worker could be started frames are processed on the file thread when they're submitted
+	for (i = 0; i < COMPRESSION_NUM_OF_WORKERS; i++)
+	{
+		if (pthread_create(&pool->workers[pool->num_of_workers], NULL, zstd_worker_main, pool) != 0)
+			break;
+		pool->num_of_workers++;
+	}
+}
+
+static void zstd_pool_destroy(struct zstd_worker_pool_t* pool)
+{
+	int i;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->stopping = 1;
+	pthread_cond_broadcast(&pool->frame_submitted);
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (i = 0; i < pool->num_of_workers; i++)
+		pthread_join(pool->workers[i], NULL);
+	pool->num_of_workers = 0;
+
+	for (i = 0; i < COMPRESSION_NUM_OF_FRAMES; i++)
+	{
+		free(pool->frames[i].buffer_in);
+		free(pool->frames[i].buffer_out);
+	}
+
+	pthread_mutex_destroy(&pool->mutex);
+	pthread_cond_destroy(&pool->frame_submitted);
+	pthread_cond_destroy(&pool->frame_done);
+}
+
+//Hand the frame of the next sequence number, already filled by the file thread, to the workers
+static void zstd_pool_submit(struct zstd_worker_pool_t* pool)
+{
+	struct zstd_frame_t* frame = &pool->frames[pool->num_of_frames_submitted % COMPRESSION_NUM_OF_FRAMES];
+
+	if (pool->num_of_workers == 0)
+	{
+		ZSTD_CCtx* cctx = pool->is_compression ? ZSTD_createCCtx() : NULL;
+		ZSTD_DCtx* dctx = pool->is_compression ? NULL : ZSTD_createDCtx();
+		size_t result = zstd_process_frame(pool, frame, cctx, dctx);
+		if (cctx)
+			ZSTD_freeCCtx(cctx);
+		if (dctx)
+			ZSTD_freeDCtx(dctx);
+		frame->is_error = ZSTD_isError(result) ? 1 : 0;
+		frame->out_size = frame->is_error ? 0 : result;
+		frame->is_done = 1;
+		pool->next_frame_to_process++;
+		pool->num_of_frames_submitted++;
+		return;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	frame->is_done = 0;
+	frame->is_error = 0;
+	pool->num_of_frames_submitted++;
+	pthread_cond_signal(&pool->frame_submitted);
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+//Check if the frame of a submitted sequence number is done, optionally waiting for it
+static struct zstd_frame_t* zstd_pool_get_done_frame(struct zstd_worker_pool_t* pool, uint64_t frame_num, int wait)
+{
+	struct zstd_frame_t* frame = &pool->frames[frame_num % COMPRESSION_NUM_OF_FRAMES];
+	int is_done;
+
+	pthread_mutex_lock(&pool->mutex);
+	while (wait && !frame->is_done)
+		pthread_cond_wait(&pool->frame_done, &pool->mutex);
+	is_done = frame->is_done;
+	pthread_mutex_unlock(&pool->mutex);
+
+	return is_done ? frame : NULL;
+}
+
+static int zstd_reserve(uint8_t** buffer, size_t* capacity, size_t size)
+{
+	uint8_t* new_buffer;
+
+	if (*buffer != NULL && *capacity >= size)
+		return 1;
+
+	new_buffer = realloc(*buffer, size);
+	if (new_buffer == NULL)
+		return 0;
+
+	*buffer = new_buffer;
+	*capacity = size;
+	return 1;
+}
+
 _compression_t * get_zstd_compression_context(int compression_level)
 {
 	struct zstd_compression_t *context = calloc(1, sizeof(struct zstd_compression_t));
-	context->cctx = ZSTD_createCCtx();
-	//Enough to handle a whole packet
-	context->buffer_in_max_size = COMPRESSION_BUFFER_IN_MAX_SIZE;
-	//If we don't compress to a smaller or equal size then we are we compressing at all!
-	context->buffer_out_max_size = max(ZSTD_CStreamOutSize(), COMPRESSION_BUFFER_IN_MAX_SIZE);
-	context->buffer_in = malloc(context->buffer_in_max_size);
-	context->buffer_out = malloc(context->buffer_out_max_size);
-	context->compression_level = compression_level * 2; //Input is scale 0-10 but zstd goes 0 - 20!
-	assert(!ZSTD_isError(ZSTD_CCtx_setParameter(context->cctx, ZSTD_c_compressionLevel, compression_level)));
+	//Input is scale 0-10 but zstd goes 0 - 20!
+	//The streaming compressor was always given the unscaled level, which is kept so files are compressed the same
+	zstd_pool_init(&context->pool, 1, compression_level);
 
 	return context;
 }
@@ -67,29 +214,13 @@ void free_zstd_compression_context(_compression_t* context)
 	if (!context)
 		return;
 
-	if (context->cctx)
-		ZSTD_freeCCtx(context->cctx);
-	if (context->buffer_out)
-		free(context->buffer_out);
-	if (context->buffer_in)
-		free(context->buffer_in);
+	zstd_pool_destroy(&context->pool);
 }
 
 _decompression_t * get_zstd_decompression_context()
 {
 	struct zstd_decompression_t *context = calloc(1, sizeof(struct zstd_decompression_t));
-	context->dctx = ZSTD_createDCtx();
-	//Enough to handle a whole packet
-	context->buffer_in_max_size = ZSTD_DStreamInSize();;
-	//ZSTD_DStreamOutSize() is big enough to hold atleast 1 full frame, but we can go bigger
-	context->buffer_out_max_size = max(ZSTD_DStreamOutSize(), COMPRESSION_BUFFER_IN_MAX_SIZE);
-	context->buffer_in = malloc(context->buffer_in_max_size);
-	context->buffer_out = malloc(context->buffer_out_max_size);
-
-	context->output.dst = context->buffer_out;
-	context->output.size = context->buffer_out_max_size;
-	context->output.pos = 0;
-	context->outputReady = 0;
+	zstd_pool_init(&context->pool, 0, 0);
 
 	return context;
 }
@@ -99,12 +230,16 @@ void free_zstd_decompression_context(_decompression_t* context)
 	if (!context)
 		return;
 
+	zstd_pool_destroy(&context->pool);
+
 	if (context->dctx)
 		ZSTD_freeDCtx(context->dctx);
 	if (context->buffer_out)
 		free(context->buffer_out);
 	if (context->buffer_in)
 		free(context->buffer_in);
+	if (context->pending)
+		free(context->pending);
 }
 
 
@@ -118,99 +253,247 @@ int is_zstd_compressed_file(const char* file_path)
 		return 0; 
 }
 
-size_t read_zstd_compressed(light_file fd, void *buf, size_t count)
+//Switch to decompressing the rest of the file as a stream, starting with the bytes already read from the file
+static void zstd_start_streaming(struct zstd_decompression_t* context)
 {
-	//Decompression is a little more complex
-	//Need to manage reading bytes from orignal file
-	//Decompressing those into a buffer
-	//Then reading the selected number of bytes from the buffer
-	//Once whole buffer is consumed we need to read and decompress next chunk from file
+	context->is_streaming = 1;
+	context->dctx = ZSTD_createDCtx();
+	context->buffer_in_max_size = ZSTD_DStreamInSize();
+	//ZSTD_DStreamOutSize() is big enough to hold atleast 1 full frame, but we can go bigger
+	context->buffer_out_max_size = max(ZSTD_DStreamOutSize(), COMPRESSION_BUFFER_IN_MAX_SIZE);
+	context->buffer_in = malloc(context->buffer_in_max_size);
+	context->buffer_out = malloc(context->buffer_out_max_size);
 
-	size_t bytes_read = 0;
+	context->input.src = context->pending;
+	context->input.size = context->pending_size;
+	context->input.pos = 0;
+	context->pending_size = 0;
+	context->outputReady = 0;
+}
 
-	while (bytes_read < count)
+//Decompress the next chunk of the stream into the output buffer, returns 0 at the end of the file
+static int zstd_decompress_stream_chunk(light_file fd)
+{
+	struct zstd_decompression_t* context = fd->decompression_context;
+
+	do
 	{
-		if (fd->decompression_context->outputReady == 0)
+		//Check if we need to grab a new chunk from the actual file
+		//If we read all the input then yes, we need to do that
+		if (context->input.pos >= context->input.size)
 		{
-			//Check if we need to grab a new chunk from the actual file
-			//If we read all the input then yes, we need to do that
-			if (fd->decompression_context->input.pos >= fd->decompression_context->input.size)
+			size_t bytes_read_file = fread(context->buffer_in, 1, context->buffer_in_max_size, fd->file);
+			if (bytes_read_file == 0)
+				return 0;
+			context->input.src = context->buffer_in;
+			context->input.size = bytes_read_file;
+			context->input.pos = 0;
+		}
+
+		//Decompress into the output buffer and use this buffer to actually get our results
+		context->output.dst = context->buffer_out;
+		context->output.size = context->buffer_out_max_size;
+		context->output.pos = 0;
+
+		size_t const remaining = ZSTD_decompressStream(context->dctx, &context->output, &context->input);
+		if (ZSTD_isError(remaining))
+			return 0;
+	} while (context->output.pos == 0);
+
+	//Re-use the output class to track our own consumption
+	context->output.size = context->output.pos;
+	context->output.pos = 0;
+	context->outputReady = 1;
+	return 1;
+}
+
+//Split the next whole frames out of the compressed bytes read from the file and hand them to the workers,
+//until enough frames are read ahead
+static void zstd_read_ahead(light_file fd)
+{
+	struct zstd_decompression_t* context = fd->decompression_context;
+	struct zstd_worker_pool_t* pool = &context->pool;
+
+	while (!context->is_streaming && pool->num_of_frames_submitted - context->next_frame_to_read < COMPRESSION_NUM_OF_FRAMES)
+	{
+		unsigned long long content_size = 0;
+		size_t frame_size = 0;
+
+		while (1)
+		{
+			if (context->pending_size >= ZSTD_FRAME_HEADER_MAX_SIZE || context->is_file_eof)
 			{
-				//Read a decompress a chunk
-				size_t bytes_read_file = fread(fd->decompression_context->buffer_in, 1, fd->decompression_context->buffer_in_max_size, fd->file);
-				if (bytes_read_file < fd->decompression_context->buffer_in_max_size && bytes_read_file == 0 && feof(fd->file))
-					return EOF;
-				fd->decompression_context->input.src = fd->decompression_context->buffer_in;
-				fd->decompression_context->input.size = bytes_read_file;
-				fd->decompression_context->input.pos = 0;
+				if (context->pending_size == 0)
+					return;
+
+				content_size = ZSTD_getFrameContentSize(context->pending, context->pending_size);
+				if (content_size == ZSTD_CONTENTSIZE_UNKNOWN || content_size == ZSTD_CONTENTSIZE_ERROR || content_size > DECOMPRESSION_MAX_FRAME_SIZE)
+				{
+					zstd_start_streaming(context);
+					return;
+				}
+
+				frame_size = ZSTD_findFrameCompressedSize(context->pending, context->pending_size);
+				if (!ZSTD_isError(frame_size))
+					break;
+
+				//A truncated frame at the end of the file, decompress as much of it as possible
+				if (context->is_file_eof)
+				{
+					zstd_start_streaming(context);
+					return;
+				}
 			}
-			//Decompress into the output buffer and use this buffer to actually get our results
-			fd->decompression_context->output.dst = fd->decompression_context->buffer_out;
-			fd->decompression_context->output.size = fd->decompression_context->buffer_out_max_size;
-			fd->decompression_context->output.pos = 0;
-
-			size_t const remaining = ZSTD_decompressStream(fd->decompression_context->dctx, &fd->decompression_context->output, &fd->decompression_context->input);
-			assert(!ZSTD_isError(remaining));
-
-			//Re-use the output class to track our own consumption
-			fd->decompression_context->output.size = fd->decompression_context->output.pos;
-			fd->decompression_context->output.pos = 0;
-			fd->decompression_context->outputReady = 1;
-		}
 
-		//Now get bytes from our output buffer
+			if (context->pending_size == context->pending_capacity &&
+				!zstd_reserve(&context->pending, &context->pending_capacity, max(2 * context->pending_capacity, (size_t)2 * COMPRESSION_FRAME_SIZE)))
+			{
+				context->is_file_eof = 1;
+				continue;
+			}
 
-		//Case we need everything or less than that which was decoded
-		int needToRead = count - bytes_read;
-		int remaining = (fd->decompression_context->output.size - fd->decompression_context->output.pos);
-		if (needToRead <= remaining)
+			size_t bytes_read_file = fread(context->pending + context->pending_size, 1, context->pending_capacity - context->pending_size, fd->file);
+			if (bytes_read_file == 0)
+				context->is_file_eof = 1;
+			context->pending_size += bytes_read_file;
+		}
+
+		struct zstd_frame_t* frame = &pool->frames[pool->num_of_frames_submitted % COMPRESSION_NUM_OF_FRAMES];
+		if (!zstd_reserve(&frame->buffer_in, &frame->in_capacity, frame_size) ||
+			!zstd_reserve(&frame->buffer_out, &frame->out_capacity, max((size_t)content_size, (size_t)1)))
 		{
-			memcpy((uint8_t*)buf + bytes_read, (uint8_t*)fd->decompression_context->output.dst + fd->decompression_context->output.pos, needToRead);
-			fd->decompression_context->output.pos += needToRead;
-			bytes_read += needToRead;
+			zstd_start_streaming(context);
+			return;
 		}
 
-		//Case we need more than that which was decoded
-		if (needToRead > remaining)
+		memcpy(frame->buffer_in, context->pending, frame_size);
+		frame->in_size = frame_size;
+		context->pending_size -= frame_size;
+		memmove(context->pending, context->pending + frame_size, context->pending_size);
+		zstd_pool_submit(pool);
+	}
+}
+
+size_t read_zstd_compressed(light_file fd, void *buf, size_t count)
+{
+	//Decompression is a little more complex
+	//Frames are read from the file and decompressed by the workers ahead of time
+	//Then the selected number of bytes are read from the decompressed frames in order
+	//Files with frames that can't be decompressed separately are decompressed as a stream on this thread
+
+	struct zstd_decompression_t* context = fd->decompression_context;
+	size_t bytes_read = 0;
+
+	while (bytes_read < count)
+	{
+		size_t remaining;
+		const uint8_t* output;
+
+		zstd_read_ahead(fd);
+
+		if (context->next_frame_to_read < context->pool.num_of_frames_submitted)
 		{
-			memcpy((uint8_t*)buf + bytes_read, (uint8_t*)fd->decompression_context->output.dst + fd->decompression_context->output.pos, remaining);
+			struct zstd_frame_t* frame = zstd_pool_get_done_frame(&context->pool, context->next_frame_to_read, 1);
+			if (frame->is_error)
+				return EOF;
+
+			output = frame->buffer_out + context->read_pos;
+			remaining = frame->out_size - context->read_pos;
+			if (remaining > count - bytes_read)
+				remaining = count - bytes_read;
+			memcpy((uint8_t*)buf + bytes_read, output, remaining);
 			bytes_read += remaining;
-			fd->decompression_context->output.pos += remaining;
+			context->read_pos += remaining;
+
+			//We have consumed everything - the frame can be reused for reading ahead
+			if (context->read_pos == frame->out_size)
+			{
+				context->next_frame_to_read++;
+				context->read_pos = 0;
+			}
+			continue;
 		}
 
+		if (!context->is_streaming)
+			return EOF;
+
+		if (context->outputReady == 0 && !zstd_decompress_stream_chunk(fd))
+			return EOF;
+
+		remaining = context->output.size - context->output.pos;
+		if (remaining > count - bytes_read)
+			remaining = count - bytes_read;
+		memcpy((uint8_t*)buf + bytes_read, (uint8_t*)context->output.dst + context->output.pos, remaining);
+		context->output.pos += remaining;
+		bytes_read += remaining;
+
 		//We have consumed everything - set next call to decompress a new chunk
-		if (fd->decompression_context->output.pos == fd->decompression_context->output.size)
-			fd->decompression_context->outputReady = 0;
+		if (context->output.pos == context->output.size)
+			context->outputReady = 0;
+	}
+
+	return bytes_read;
+}
+
+//Write the frames that are done in order, waiting for the oldest one if there's no free frame to fill
+static int zstd_write_frames(light_file fd, int write_all)
+{
+	struct zstd_compression_t* context = fd->compression_context;
+	struct zstd_worker_pool_t* pool = &context->pool;
 
+	while (context->next_frame_to_write < pool->num_of_frames_submitted)
+	{
+		int must_wait = write_all || pool->num_of_frames_submitted - context->next_frame_to_write >= COMPRESSION_NUM_OF_FRAMES;
+		struct zstd_frame_t* frame = zstd_pool_get_done_frame(pool, context->next_frame_to_write, must_wait);
+		if (frame == NULL)
+			break;
+
+		if (frame->is_error || fwrite(frame->buffer_out, 1, frame->out_size, fd->file) != frame->out_size)
+			context->is_error = 1;
+
+		frame->in_size = 0;
+		context->next_frame_to_write++;
 	}
 
+	return context->is_error ? 0 : 1;
+}
 
-	return bytes_read;
+static int zstd_submit_compression_frame(light_file fd)
+{
+	zstd_pool_submit(&fd->compression_context->pool);
+	return zstd_write_frames(fd, 0);
 }
 
 size_t write_zstd_compressed(light_file fd, const void *buf, size_t count)
 {
 	//Do compression here!
-	/* Set the input buffer to what we just read.
-	* We compress until the input buffer is empty, each time flushing the
-	* output.
-	*/
-	ZSTD_inBuffer input = { buf, count, 0 };
-	int finished;
-	do
+	//The data is collected into frames, each full frame is compressed by a worker as an independent
+	//zstd frame and written to the file in order once it's compressed
+	struct zstd_compression_t* context = fd->compression_context;
+	const uint8_t* data = (const uint8_t*)buf;
+	size_t remaining = count;
+
+	while (remaining > 0)
 	{
-		/* Compress into the output buffer and write all of the output to
-		* the file so we can reuse the buffer next iteration.
-		*/
-		ZSTD_outBuffer output = { fd->compression_context->buffer_out, fd->compression_context->buffer_out_max_size, 0 };
-		size_t const remaining = ZSTD_compressStream2(fd->compression_context->cctx, &output, &input, ZSTD_e_continue);
-		assert(!ZSTD_isError(remaining));
-		fwrite(output.dst, 1, output.pos, fd->file);
-		/* If we're on the last chunk we're finished when zstd returns 0,
-			* We're finished when we've consumed all the input.
-			*/
-		finished = (input.pos == input.size);
-	} while (!finished);
+		struct zstd_frame_t* frame = &context->pool.frames[context->pool.num_of_frames_submitted % COMPRESSION_NUM_OF_FRAMES];
+		if (frame->buffer_in == NULL)
+		{
+			if (!zstd_reserve(&frame->buffer_in, &frame->in_capacity, COMPRESSION_FRAME_SIZE) ||
+				!zstd_reserve(&frame->buffer_out, &frame->out_capacity, ZSTD_compressBound(COMPRESSION_FRAME_SIZE)))
+				return -1;
+		}
+
+		size_t length = frame->in_capacity - frame->in_size;
+		if (length > remaining)
+			length = remaining;
+		memcpy(frame->buffer_in + frame->in_size, data, length);
+		frame->in_size += length;
+		data += length;
+		remaining -= length;
+
+		if (frame->in_size == frame->in_capacity && !zstd_submit_compression_frame(fd))
+			return -1;
+	}
 
 	return count;
 }
@@ -220,18 +503,13 @@ int close_zstd_compresssed(light_file fd)
 	//Wrap up the compression here
 	if (fd->compression_context)
 	{
-		ZSTD_inBuffer input = { 0,0,0 };
+		struct zstd_compression_t* context = fd->compression_context;
+		struct zstd_frame_t* frame = &context->pool.frames[context->pool.num_of_frames_submitted % COMPRESSION_NUM_OF_FRAMES];
 
-		int remaining = 1;
+		if (frame->in_size > 0)
+			zstd_pool_submit(&context->pool);
 
-		while (remaining != 0)
-		{
-			ZSTD_outBuffer output = { fd->compression_context->buffer_out, fd->compression_context->buffer_out_max_size, 0 };
-			remaining = ZSTD_compressStream2(fd->compression_context->cctx, &output, &input, ZSTD_e_end);
-			fwrite(output.dst, 1, output.pos, fd->file);
-		}
-
-		return 0;
+		return zstd_write_frames(fd, 1) ? 0 : -1;
 	}
 
 	return -1;
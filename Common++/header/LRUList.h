@@ -1,8 +1,14 @@
 #ifndef PCAPPP_LRU_LIST
 #define PCAPPP_LRU_LIST
 
-#include <map>
+#include <vector>
 #include <list>
+#include <map>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+#include "IpAddress.h"
+#include "MacAddress.h"
 
 #if __cplusplus > 199711L || _MSC_VER >= 1800
 #include <utility>
@@ -17,35 +23,178 @@
 namespace pcpp
 {
 
+	/**
+	 * @struct LRUListOrderedIndex
+	 * The base of hash functors of element types that have no hash. LRUList finds elements whose Hash functor derives from this struct
+	 * through a std::map ordered by operator< instead of its hash table, so put() and eraseElement() are O(log(getSize())) for them
+	 */
+	struct LRUListOrderedIndex {};
+
+	/**
+	 * @struct LRUListHash
+	 * The default hash function used by LRUList. It's specialized for integer types, pointers, std::string, IPv4Address, IPv6Address,
+	 * IPAddress and MacAddress. Elements of other types (including enums) have no hash and are kept in an ordered index, which requires
+	 * operator<. A hash functor of their own can be given as the second template parameter of LRUList to make them O(1)
+	 */
+	template<typename T>
+	struct LRUListHash : public LRUListOrderedIndex
+	{
+		/**
+		 * @return 0, elements of this type are found through the ordered index
+		 */
+		uint32_t operator()(const T& /* value */) const { return 0; }
+	};
+
+	namespace internal
+	{
+		// the finalizer of MurmurHash3, it spreads sequential values (such as IDs or ports) over the whole range
+		inline uint32_t lruListHashInteger(uint64_t value)
+		{
+			value ^= value >> 33;
+			value *= 0xff51afd7ed558ccdULL;
+			value ^= value >> 33;
+			value *= 0xc4ceb9fe1a85ec53ULL;
+			value ^= value >> 33;
+			return (uint32_t)value;
+		}
+
+		// FNV-1a
+		inline uint32_t lruListHashBytes(const uint8_t* data, size_t dataLen)
+		{
+			uint32_t hash = 2166136261U;
+			for (size_t i = 0; i < dataLen; i++)
+			{
+				hash ^= data[i];
+				hash *= 16777619U;
+			}
+			return hash;
+		}
+
+		template<typename T>
+		struct LRUListIntegerHash
+		{
+			uint32_t operator()(const T& value) const { return lruListHashInteger((uint64_t)value); }
+		};
+
+		// tells whether elements hashed by Hash are kept in the ordered index
+		template<typename Hash>
+		struct LRUListUsesOrderedIndex
+		{
+			static char test(const LRUListOrderedIndex*);
+			static long test(...);
+			enum { value = (sizeof(test((const Hash*)NULL)) == sizeof(char)) };
+		};
+
+		template<bool Ordered>
+		struct LRUListIndexTag {};
+	} // namespace internal
+
+	template<> struct LRUListHash<bool> : public internal::LRUListIntegerHash<bool> {};
+	template<> struct LRUListHash<char> : public internal::LRUListIntegerHash<char> {};
+	template<> struct LRUListHash<signed char> : public internal::LRUListIntegerHash<signed char> {};
+	template<> struct LRUListHash<unsigned char> : public internal::LRUListIntegerHash<unsigned char> {};
+	template<> struct LRUListHash<wchar_t> : public internal::LRUListIntegerHash<wchar_t> {};
+	template<> struct LRUListHash<short> : public internal::LRUListIntegerHash<short> {};
+	template<> struct LRUListHash<unsigned short> : public internal::LRUListIntegerHash<unsigned short> {};
+	template<> struct LRUListHash<int> : public internal::LRUListIntegerHash<int> {};
+	template<> struct LRUListHash<unsigned int> : public internal::LRUListIntegerHash<unsigned int> {};
+	template<> struct LRUListHash<long> : public internal::LRUListIntegerHash<long> {};
+	template<> struct LRUListHash<unsigned long> : public internal::LRUListIntegerHash<unsigned long> {};
+	template<> struct LRUListHash<long long> : public internal::LRUListIntegerHash<long long> {};
+	template<> struct LRUListHash<unsigned long long> : public internal::LRUListIntegerHash<unsigned long long> {};
+
+	template<typename T>
+	struct LRUListHash<T*>
+	{
+		uint32_t operator()(T* value) const { return internal::lruListHashInteger((uint64_t)(size_t)value); }
+	};
+
+	template<>
+	struct LRUListHash<std::string>
+	{
+		uint32_t operator()(const std::string& value) const { return internal::lruListHashBytes((const uint8_t*)value.data(), value.size()); }
+	};
+
+	template<>
+	struct LRUListHash<IPv4Address>
+	{
+		uint32_t operator()(const IPv4Address& value) const { return internal::lruListHashInteger(value.toInt()); }
+	};
+
+	template<>
+	struct LRUListHash<IPv6Address>
+	{
+		uint32_t operator()(const IPv6Address& value) const { return internal::lruListHashBytes(value.toBytes(), 16); }
+	};
+
+	template<>
+	struct LRUListHash<IPAddress>
+	{
+		uint32_t operator()(const IPAddress& value) const
+		{
+			if (value.isIPv4())
+				return internal::lruListHashInteger(value.getIPv4().toInt());
+			return internal::lruListHashBytes(value.getIPv6().toBytes(), 16);
+		}
+	};
+
+	template<>
+	struct LRUListHash<MacAddress>
+	{
+		uint32_t operator()(const MacAddress& value) const { return internal::lruListHashBytes(value.getRawData(), 6); }
+	};
+
+
 	/**
 	 * @class LRUList
 	 * A template class that implements a LRU cache with limited size. Each time the user puts an element it goes to head of the
 	 * list as the most recently used element (if the element was already in the list it advances to the head of the list).
 	 * The last element in the list is the one least recently used and will be pulled out of the list if it reaches its max size
-	 * and a new element comes in. All actions on this LRU list are O(1)
+	 * and a new element comes in. All actions on this LRU list are O(1).<BR>
+	 * Elements are kept in an array of nodes that are linked to each other by their indices (an intrusive doubly-linked list) and are
+	 * found through an open-addressing hash table of node indices. Nodes of erased and evicted elements are reused, so once the node
+	 * array has grown to its max size put() and eraseElement() never allocate memory. The array grows on demand by default; use the
+	 * LRUList(size_t, size_t) c'tor to allocate it up-front.<BR>
+	 * Elements are compared with operator== and hashed with the Hash functor (see LRUListHash for the types it supports by default).
+	 * Elements whose Hash derives from LRUListOrderedIndex are compared with operator< and found through a std::map instead.
+	 * T must be default constructible
 	 */
-	template<typename T>
+	template<typename T, typename Hash = LRUListHash<T> >
 	class LRUList
 	{
 	public:
 
+		/**
+		 * Kept for compatibility with older versions, in which the list was a std::list indexed by a std::map. They're not used by the
+		 * list anymore
+		 */
 		typedef typename std::list<T>::iterator ListIterator;
 		typedef typename std::map<T, ListIterator>::iterator MapIterator;
 
 		/**
-		 * A c'tor for this class
+		 * A c'tor for this class. Memory for the elements is allocated as the list grows
 		 * @param[in] maxSize The max size this list can go
 		 */
 		LRUList(size_t maxSize)
 		{
-			m_MaxSize = maxSize;
+			init(maxSize, DefaultInitialCapacity);
+		}
+
+		/**
+		 * A c'tor for this class that allocates memory for a given number of elements up-front
+		 * @param[in] maxSize The max size this list can go
+		 * @param[in] initialCapacity The number of elements to allocate memory for. If it's equal to or larger than maxSize put() and
+		 * eraseElement() never allocate memory
+		 */
+		LRUList(size_t maxSize, size_t initialCapacity)
+		{
+			init(maxSize, initialCapacity);
 		}
 
 		/**
 		 * Puts an element in the list. This element will be inserted (or advanced if it already exists) to the head of the
 		 * list as the most recently used element. If the list already reached its max size and the element is new this method
-		 * will remove the least recently used element and return a value in deletedValue. Method complexity is O(log(getSize())).
-		 * This is a optimized version of the method T* put(const T&).
+		 * will remove the least recently used element and return a value in deletedValue. Method complexity is O(1).
 		 * @param[in] element The element to insert or to advance to the head of the list (if already exists)
 		 * @param[out] deletedValue The value of deleted element if a pointer is not NULL. This parameter is optional.
 		 * @return 0 if the list didn't reach its max size, 1 otherwise. In case the list already reached its max size
@@ -53,32 +202,56 @@ namespace pcpp
 		 */
 		int put(const T& element, T* deletedValue = NULL)
 		{
-			m_CacheItemsList.push_front(element);
-
-			// Inserting a new element. If an element with an equivalent key already exists the method returns an iterator to the element that prevented the insertion
-			std::pair<MapIterator, bool> pair = m_CacheItemsMap.insert(std::make_pair(element, m_CacheItemsList.begin()));
-			if (pair.second == false) // already exists
+			uint32_t hash = m_Hash(element);
+			uint32_t nodeIndex = findNode(element, hash);
+			if (nodeIndex != InvalidIndex) // already exists
 			{
-				m_CacheItemsList.erase(pair.first->second);
-				pair.first->second = m_CacheItemsList.begin();
+				if (nodeIndex != m_Head)
+				{
+					unlink(nodeIndex);
+					linkAsHead(nodeIndex);
+				}
+				return 0;
 			}
 
-			if (m_CacheItemsMap.size() > m_MaxSize)
+			if (m_Size >= m_MaxSize)
 			{
-				ListIterator lruIter = m_CacheItemsList.end();
-				lruIter--;
+				if (m_MaxSize == 0)
+				{
+					// the new element is the least recently used one
+					if (deletedValue != NULL)
+						*deletedValue = element;
+					return 1;
+				}
+
+				// reuse the node of the least recently used element for the new element
+				nodeIndex = m_Tail;
+				removeFromIndex(nodeIndex);
+				unlink(nodeIndex);
 
 				if (deletedValue != NULL)
 #if __cplusplus > 199711L || _MSC_VER >= 1800
-					*deletedValue = std::move(*lruIter);
+					*deletedValue = std::move(m_Nodes[nodeIndex].value);
 #else
-					*deletedValue = *lruIter;
+					*deletedValue = m_Nodes[nodeIndex].value;
 #endif
-				m_CacheItemsMap.erase(*lruIter);
-				m_CacheItemsList.erase(lruIter);
+				m_Nodes[nodeIndex].value = element;
+				m_Nodes[nodeIndex].hash = hash;
+				linkAsHead(nodeIndex);
+				addToIndex(nodeIndex);
 				return 1;
 			}
 
+			if (m_FreeHead == InvalidIndex)
+				grow();
+
+			nodeIndex = m_FreeHead;
+			m_FreeHead = m_Nodes[nodeIndex].next;
+			m_Nodes[nodeIndex].value = element;
+			m_Nodes[nodeIndex].hash = hash;
+			linkAsHead(nodeIndex);
+			addToIndex(nodeIndex);
+			m_Size++;
 			return 0;
 		}
 
@@ -88,7 +261,7 @@ namespace pcpp
 		 */
 		const T& getMRUElement() const
 		{
-			return m_CacheItemsList.front();
+			return m_Nodes[m_Head].value;
 		}
 
 		/**
@@ -97,7 +270,7 @@ namespace pcpp
 		 */
 		const T& getLRUElement() const
 		{
-			return m_CacheItemsList.back();
+			return m_Nodes[m_Tail].value;
 		}
 
 		/**
@@ -106,12 +279,16 @@ namespace pcpp
 		 */
 		void eraseElement(const T& element)
 		{
-			MapIterator iter = m_CacheItemsMap.find(element);
-			if (iter == m_CacheItemsMap.end())
+			uint32_t nodeIndex = findNode(element, m_Hash(element));
+			if (nodeIndex == InvalidIndex)
 				return;
 
-			m_CacheItemsList.erase(iter->second);
-			m_CacheItemsMap.erase(iter);
+			removeFromIndex(nodeIndex);
+			unlink(nodeIndex);
+			m_Nodes[nodeIndex].value = T();
+			m_Nodes[nodeIndex].next = m_FreeHead;
+			m_FreeHead = nodeIndex;
+			m_Size--;
 		}
 
 		/**
@@ -122,12 +299,202 @@ namespace pcpp
 		/**
 		 * @return The number of elements currently in this list
 		 */
-		size_t getSize() const { return m_CacheItemsMap.size(); }
+		size_t getSize() const { return m_Size; }
 
 	private:
-		std::list<T> m_CacheItemsList;
-		std::map<T, ListIterator> m_CacheItemsMap;
+
+		enum
+		{
+			InvalidIndex = 0xffffffff,
+			DefaultInitialCapacity = 16
+		};
+
+		struct Node
+		{
+			T value;
+			uint32_t hash;
+			uint32_t prev;
+			uint32_t next;
+		};
+
+		// the elements' nodes. Nodes that aren't in use are linked to each other through 'next' starting at m_FreeHead
+		std::vector<Node> m_Nodes;
+		// open-addressing hash table (linear probing) of node indices, its size is a power of 2 at least twice the number of nodes
+		std::vector<uint32_t> m_Index;
+		uint32_t m_IndexMask;
+		uint32_t m_Head;
+		uint32_t m_Tail;
+		uint32_t m_FreeHead;
+		size_t m_Size;
 		size_t m_MaxSize;
+		Hash m_Hash;
+		// the index of elements whose type has no hash, m_Index isn't used for them
+		std::map<T, uint32_t> m_OrderedIndex;
+
+		typedef internal::LRUListIndexTag<internal::LRUListUsesOrderedIndex<Hash>::value != 0> IndexTag;
+
+		void init(size_t maxSize, size_t initialCapacity)
+		{
+			// node indices are 32-bit and one value is reserved
+			if (maxSize >= (size_t)InvalidIndex)
+				maxSize = (size_t)InvalidIndex - 1;
+			m_MaxSize = maxSize;
+			m_Head = m_Tail = m_FreeHead = InvalidIndex;
+			m_Size = 0;
+			m_IndexMask = 0;
+			resize(initialCapacity < maxSize ? initialCapacity : maxSize);
+		}
+
+		uint32_t findNode(const T& element, uint32_t hash) const
+		{
+			return findNode(element, hash, IndexTag());
+		}
+
+		void addToIndex(uint32_t nodeIndex)
+		{
+			addToIndex(nodeIndex, IndexTag());
+		}
+
+		void removeFromIndex(uint32_t nodeIndex)
+		{
+			removeFromIndex(nodeIndex, IndexTag());
+		}
+
+		uint32_t findNode(const T& element, uint32_t /* hash */, internal::LRUListIndexTag<true>) const
+		{
+			typename std::map<T, uint32_t>::const_iterator iter = m_OrderedIndex.find(element);
+			return (iter != m_OrderedIndex.end() ? iter->second : (uint32_t)InvalidIndex);
+		}
+
+		void addToIndex(uint32_t nodeIndex, internal::LRUListIndexTag<true>)
+		{
+			m_OrderedIndex.insert(std::make_pair(m_Nodes[nodeIndex].value, nodeIndex));
+		}
+
+		void removeFromIndex(uint32_t nodeIndex, internal::LRUListIndexTag<true>)
+		{
+			m_OrderedIndex.erase(m_Nodes[nodeIndex].value);
+		}
+
+		void resizeIndex(size_t /* capacity */, internal::LRUListIndexTag<true>)
+		{
+		}
+
+		uint32_t findNode(const T& element, uint32_t hash, internal::LRUListIndexTag<false>) const
+		{
+			if (m_Index.empty())
+				return InvalidIndex;
+
+			for (uint32_t slot = hash & m_IndexMask; m_Index[slot] != InvalidIndex; slot = (slot + 1) & m_IndexMask)
+			{
+				const Node& node = m_Nodes[m_Index[slot]];
+				if (node.hash == hash && node.value == element)
+					return m_Index[slot];
+			}
+
+			return InvalidIndex;
+		}
+
+		void addToIndex(uint32_t nodeIndex, internal::LRUListIndexTag<false>)
+		{
+			uint32_t slot = m_Nodes[nodeIndex].hash & m_IndexMask;
+			while (m_Index[slot] != InvalidIndex)
+				slot = (slot + 1) & m_IndexMask;
+			m_Index[slot] = nodeIndex;
+		}
+
+		void removeFromIndex(uint32_t nodeIndex, internal::LRUListIndexTag<false>)
+		{
+			uint32_t slot = m_Nodes[nodeIndex].hash & m_IndexMask;
+			while (m_Index[slot] != nodeIndex)
+				slot = (slot + 1) & m_IndexMask;
+
+			// backward shift deletion: move back the following entries of the cluster that can't be found anymore once this slot is
+			// empty, so no tombstones are needed
+			uint32_t next = slot;
+			while (true)
+			{
+				next = (next + 1) & m_IndexMask;
+				if (m_Index[next] == InvalidIndex)
+					break;
+
+				uint32_t home = m_Nodes[m_Index[next]].hash & m_IndexMask;
+				bool homeBetween = (slot <= next) ? (slot < home && home <= next) : (slot < home || home <= next);
+				if (homeBetween)
+					continue;
+
+				m_Index[slot] = m_Index[next];
+				slot = next;
+			}
+
+			m_Index[slot] = InvalidIndex;
+		}
+
+		void linkAsHead(uint32_t nodeIndex)
+		{
+			Node& node = m_Nodes[nodeIndex];
+			node.prev = InvalidIndex;
+			node.next = m_Head;
+			if (m_Head != InvalidIndex)
+				m_Nodes[m_Head].prev = nodeIndex;
+			else
+				m_Tail = nodeIndex;
+			m_Head = nodeIndex;
+		}
+
+		void unlink(uint32_t nodeIndex)
+		{
+			Node& node = m_Nodes[nodeIndex];
+			if (node.prev != InvalidIndex)
+				m_Nodes[node.prev].next = node.next;
+			else
+				m_Head = node.next;
+
+			if (node.next != InvalidIndex)
+				m_Nodes[node.next].prev = node.prev;
+			else
+				m_Tail = node.prev;
+		}
+
+		void grow()
+		{
+			size_t capacity = m_Nodes.size() * 2;
+			if (capacity < (size_t)DefaultInitialCapacity)
+				capacity = DefaultInitialCapacity;
+			if (capacity > m_MaxSize)
+				capacity = m_MaxSize;
+			resize(capacity);
+		}
+
+		void resize(size_t capacity)
+		{
+			size_t oldCapacity = m_Nodes.size();
+			if (capacity <= oldCapacity)
+				return;
+
+			m_Nodes.resize(capacity);
+			for (size_t i = capacity; i > oldCapacity; i--)
+			{
+				m_Nodes[i - 1].next = m_FreeHead;
+				m_FreeHead = (uint32_t)(i - 1);
+			}
+
+			resizeIndex(capacity, IndexTag());
+		}
+
+		void resizeIndex(size_t capacity, internal::LRUListIndexTag<false>)
+		{
+			size_t indexSize = 1;
+			while (indexSize < capacity * 2)
+				indexSize <<= 1;
+			if (indexSize <= m_Index.size())
+				return;
+
+			m_Index.assign(indexSize, (uint32_t)InvalidIndex);
+			m_IndexMask = (uint32_t)(indexSize - 1);
+			for (uint32_t nodeIndex = m_Head; nodeIndex != InvalidIndex; nodeIndex = m_Nodes[nodeIndex].next)
+				addToIndex(nodeIndex, internal::LRUListIndexTag<false>());
+		}
 	};
 
 } // namespace pcpp
@@ -0,0 +1,497 @@
+#ifndef PCAPPP_LOCK_FREE_RING
+#define PCAPPP_LOCK_FREE_RING
+
+#include <stddef.h>
+#include <stdint.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/// @file
+
+/**
+ * The size of a cache line. Indices written by different threads are kept this number of bytes apart so they don't share a cache line
+ */
+#define PCPP_RING_CACHE_LINE_SIZE 64
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	namespace internal
+	{
+		// atomic access to the ring indices. On MSVC volatile accesses have acquire/release semantics, so a compiler barrier is enough
+
+		inline uint32_t ringLoadAcquire(const volatile uint32_t* ptr)
+		{
+#if defined(_MSC_VER)
+			uint32_t value = *ptr;
+			_ReadWriteBarrier();
+			return value;
+#else
+			return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+		}
+
+		inline void ringStoreRelease(volatile uint32_t* ptr, uint32_t value)
+		{
+#if defined(_MSC_VER)
+			_ReadWriteBarrier();
+			*ptr = value;
+#else
+			__atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+		}
+
+		inline bool ringCompareAndSwap(volatile uint32_t* ptr, uint32_t expected, uint32_t desired)
+		{
+#if defined(_MSC_VER)
+			return (uint32_t)_InterlockedCompareExchange((volatile long*)ptr, (long)desired, (long)expected) == expected;
+#else
+			return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+#endif
+		}
+
+		// round a ring capacity up to a power of 2 (at least 2), so positions can be masked into slot indices
+		inline uint32_t ringRoundUpCapacity(uint32_t capacity)
+		{
+			uint32_t result = 2;
+			while (result < capacity && result < 0x80000000)
+				result <<= 1;
+			return result;
+		}
+
+	} // namespace internal
+
+
+	/**
+	 * @class SPSCRing
+	 * A bounded lock-free ring (queue) for exactly one producer thread and one consumer thread, for example for handing packets from a
+	 * capture thread to a worker thread without locking and without the capture thread ever blocking on the worker.
+	 * The producer and consumer indices are kept on different cache lines, and each side keeps a cached copy of the other side's index
+	 * so it reads the other side's cache line only when the ring looks full (or empty), which keeps cache line transfers between the
+	 * cores to a minimum. Items can be moved one by one or in bulk, and for items that are expensive to copy (such as structs with
+	 * buffers) reserveEnqueue() and peekDequeue() give direct access to the slots.<BR>
+	 * A ring of pointers, such as SPSCRing<RawPacket*> or SPSCRing<MBufRawPacket*>, transfers ownership of the pointed objects: once an
+	 * object was enqueued the producer must not touch it, and the consumer that dequeued it is responsible for freeing it (or handing it
+	 * on). Objects left in the ring when it's destroyed aren't freed, use deleteAll() for that.<BR>
+	 * T must be default constructible and assignable. The capacity is rounded up to a power of 2
+	 */
+	template<typename T>
+	class SPSCRing
+	{
+	private:
+		T* m_Slots;
+		uint32_t m_Capacity;
+		uint32_t m_Mask;
+		char m_Padding1[PCPP_RING_CACHE_LINE_SIZE];
+		// the next position the consumer reads, written by the consumer only
+		volatile uint32_t m_Head;
+		// the consumer's last known value of m_Tail
+		uint32_t m_CachedTail;
+		char m_Padding2[PCPP_RING_CACHE_LINE_SIZE];
+		// the next position the producer writes, written by the producer only
+		volatile uint32_t m_Tail;
+		// the producer's last known value of m_Head
+		uint32_t m_CachedHead;
+		char m_Padding3[PCPP_RING_CACHE_LINE_SIZE];
+
+		// private copy c'tor
+		SPSCRing(const SPSCRing& other);
+		SPSCRing& operator=(const SPSCRing& other);
+
+		// the number of free slots, reading the consumer's index only if there are less than needed
+		uint32_t freeSlots(uint32_t tail, uint32_t needed)
+		{
+			uint32_t result = m_Capacity - (tail - m_CachedHead);
+			if (result < needed)
+			{
+				m_CachedHead = internal::ringLoadAcquire(&m_Head);
+				result = m_Capacity - (tail - m_CachedHead);
+			}
+			return result;
+		}
+
+		// the number of used slots, reading the producer's index only if there are less than needed
+		uint32_t usedSlots(uint32_t head, uint32_t needed)
+		{
+			uint32_t result = m_CachedTail - head;
+			if (result < needed)
+			{
+				m_CachedTail = internal::ringLoadAcquire(&m_Tail);
+				result = m_CachedTail - head;
+			}
+			return result;
+		}
+
+	public:
+		/**
+		 * A c'tor for this class
+		 * @param[in] capacity The number of items the ring can hold. It's rounded up to a power of 2
+		 */
+		SPSCRing(uint32_t capacity)
+		{
+			m_Capacity = internal::ringRoundUpCapacity(capacity);
+			m_Mask = m_Capacity - 1;
+			m_Slots = new T[m_Capacity]();
+			m_Head = 0;
+			m_CachedTail = 0;
+			m_Tail = 0;
+			m_CachedHead = 0;
+		}
+
+		/**
+		 * A d'tor for this class. Items left in the ring are destroyed with the ring's slots, pointed objects aren't freed (see deleteAll())
+		 */
+		~SPSCRing() { delete [] m_Slots; }
+
+		/**
+		 * Add an item to the ring. May be called by the producer thread only
+		 * @param[in] item The item to add
+		 * @return True if the item was added, false if the ring is full (ownership of a pointed object stays with the caller)
+		 */
+		bool enqueue(const T& item)
+		{
+			uint32_t tail = m_Tail;
+			if (freeSlots(tail, 1) == 0)
+				return false;
+
+			m_Slots[tail & m_Mask] = item;
+			internal::ringStoreRelease(&m_Tail, tail + 1);
+			return true;
+		}
+
+		/**
+		 * Add as many items as there is room for from an array, with a single update of the shared index. May be called by the producer
+		 * thread only
+		 * @param[in] items The items to add
+		 * @param[in] count The number of items in the array
+		 * @return The number of items added, which are the first items of the array. Ownership of the objects pointed by the rest of the
+		 * items stays with the caller
+		 */
+		uint32_t enqueueBulk(const T* items, uint32_t count)
+		{
+			uint32_t tail = m_Tail;
+			uint32_t numOfFree = freeSlots(tail, count);
+			if (count > numOfFree)
+				count = numOfFree;
+
+			for (uint32_t i = 0; i < count; i++)
+				m_Slots[(tail + i) & m_Mask] = items[i];
+
+			if (count > 0)
+				internal::ringStoreRelease(&m_Tail, tail + count);
+			return count;
+		}
+
+		/**
+		 * Remove the oldest item from the ring. May be called by the consumer thread only
+		 * @param[out] item The removed item
+		 * @return True if an item was removed, false if the ring is empty
+		 */
+		bool dequeue(T& item)
+		{
+			uint32_t head = m_Head;
+			if (usedSlots(head, 1) == 0)
+				return false;
+
+			item = m_Slots[head & m_Mask];
+			internal::ringStoreRelease(&m_Head, head + 1);
+			return true;
+		}
+
+		/**
+		 * Remove up to a given number of the oldest items from the ring, with a single update of the shared index. May be called by the
+		 * consumer thread only
+		 * @param[out] items An array for the removed items
+		 * @param[in] count The max number of items to remove, which is the size of the array
+		 * @return The number of items removed
+		 */
+		uint32_t dequeueBulk(T* items, uint32_t count)
+		{
+			uint32_t head = m_Head;
+			uint32_t numOfUsed = usedSlots(head, count);
+			if (count > numOfUsed)
+				count = numOfUsed;
+
+			for (uint32_t i = 0; i < count; i++)
+				items[i] = m_Slots[(head + i) & m_Mask];
+
+			if (count > 0)
+				internal::ringStoreRelease(&m_Head, head + count);
+			return count;
+		}
+
+		/**
+		 * Get the slot of the next item to add, so the item can be built in place instead of being copied into the ring. The item is added
+		 * only when commitEnqueue() is called. May be called by the producer thread only
+		 * @return A pointer to the slot, or NULL if the ring is full. The slot holds whatever item was last stored in it, so buffers owned by
+		 * items can be reused
+		 */
+		T* reserveEnqueue()
+		{
+			uint32_t tail = m_Tail;
+			if (freeSlots(tail, 1) == 0)
+				return NULL;
+			return &m_Slots[tail & m_Mask];
+		}
+
+		/**
+		 * Add the item built in the slot returned by reserveEnqueue() to the ring. May be called by the producer thread only
+		 */
+		void commitEnqueue() { internal::ringStoreRelease(&m_Tail, m_Tail + 1); }
+
+		/**
+		 * Get the slot of the oldest item without removing it, so it can be processed in place instead of being copied out of the ring.
+		 * The item is removed only when commitDequeue() is called. May be called by the consumer thread only
+		 * @return A pointer to the slot, or NULL if the ring is empty
+		 */
+		T* peekDequeue()
+		{
+			uint32_t head = m_Head;
+			if (usedSlots(head, 1) == 0)
+				return NULL;
+			return &m_Slots[head & m_Mask];
+		}
+
+		/**
+		 * Remove the item returned by peekDequeue() from the ring, which lets the producer reuse its slot. May be called by the consumer
+		 * thread only
+		 */
+		void commitDequeue() { internal::ringStoreRelease(&m_Head, m_Head + 1); }
+
+		/**
+		 * Dequeue all items and delete the objects they point to. Relevant only for rings of pointers. May be called by the consumer thread
+		 * only
+		 * @return The number of objects deleted
+		 */
+		uint32_t deleteAll()
+		{
+			uint32_t count = 0;
+			T item;
+			while (dequeue(item))
+			{
+				delete item;
+				count++;
+			}
+			return count;
+		}
+
+		/**
+		 * @return The number of items the ring can hold
+		 */
+		uint32_t getCapacity() const { return m_Capacity; }
+
+		/**
+		 * @return The number of items in the ring. When called while the other thread is active the result may be already outdated
+		 */
+		uint32_t getSize() const { return internal::ringLoadAcquire(&m_Tail) - internal::ringLoadAcquire(&m_Head); }
+
+		/**
+		 * @return True if the ring is empty. When called while the other thread is active the result may be already outdated
+		 */
+		bool isEmpty() const { return getSize() == 0; }
+	};
+
+
+	/**
+	 * @class MPMCRing
+	 * A bounded lock-free ring (queue) for any number of producer threads and any number of consumer threads, for example for
+	 * distributing packets from several capture threads to a pool of worker threads.
+	 * Each slot has a sequence number that tells whether it's ready to be written or read in the current lap of the ring, so producers and
+	 * consumers only compete on claiming positions (with a compare-and-swap of the shared index) and never wait for each other while
+	 * copying items. The producer and consumer indices are kept on different cache lines. Bulk operations claim a run of consecutive
+	 * positions with a single compare-and-swap.<BR>
+	 * Like SPSCRing, a ring of pointers transfers ownership of the pointed objects from the producer to the consumer that dequeued them.
+	 * Please notice a producer (or consumer) that is preempted after claiming a position delays the consumers (or producers) of that
+	 * position until it resumes, as in every bounded ring of this kind.<BR>
+	 * T must be default constructible and assignable. The capacity is rounded up to a power of 2. If there is only one producer and one
+	 * consumer SPSCRing is faster
+	 */
+	template<typename T>
+	class MPMCRing
+	{
+	private:
+		struct Cell
+		{
+			volatile uint32_t sequence;
+			T item;
+		};
+
+		Cell* m_Cells;
+		uint32_t m_Capacity;
+		uint32_t m_Mask;
+		char m_Padding1[PCPP_RING_CACHE_LINE_SIZE];
+		// the next position to write, claimed by producers
+		volatile uint32_t m_EnqueuePos;
+		char m_Padding2[PCPP_RING_CACHE_LINE_SIZE];
+		// the next position to read, claimed by consumers
+		volatile uint32_t m_DequeuePos;
+		char m_Padding3[PCPP_RING_CACHE_LINE_SIZE];
+
+		// private copy c'tor
+		MPMCRing(const MPMCRing& other);
+		MPMCRing& operator=(const MPMCRing& other);
+
+		// claim up to count consecutive positions whose cells have the expected sequence (position + offset). Returns the number of
+		// positions claimed, which is 0 if the first cell isn't ready (the ring is full or empty)
+		uint32_t claim(volatile uint32_t* posPtr, uint32_t offset, uint32_t count, uint32_t& pos)
+		{
+			pos = internal::ringLoadAcquire(posPtr);
+			while (true)
+			{
+				uint32_t ready = 0;
+				while (ready < count)
+				{
+					uint32_t sequence = internal::ringLoadAcquire(&m_Cells[(pos + ready) & m_Mask].sequence);
+					if (sequence != pos + ready + offset)
+						break;
+					ready++;
+				}
+
+				if (ready == 0)
+				{
+					// the cell isn't ready for this lap: either the ring is full (or empty), or another thread already claimed the
+					// position and the index moved on
+					uint32_t sequence = internal::ringLoadAcquire(&m_Cells[pos & m_Mask].sequence);
+					if ((int32_t)(sequence - (pos + offset)) < 0)
+						return 0;
+
+					pos = internal::ringLoadAcquire(posPtr);
+					continue;
+				}
+
+				if (internal::ringCompareAndSwap(posPtr, pos, pos + ready))
+					return ready;
+
+				pos = internal::ringLoadAcquire(posPtr);
+			}
+		}
+
+	public:
+		/**
+		 * A c'tor for this class
+		 * @param[in] capacity The number of items the ring can hold. It's rounded up to a power of 2
+		 */
+		MPMCRing(uint32_t capacity)
+		{
+			m_Capacity = internal::ringRoundUpCapacity(capacity);
+			m_Mask = m_Capacity - 1;
+			m_Cells = new Cell[m_Capacity]();
+			for (uint32_t i = 0; i < m_Capacity; i++)
+				m_Cells[i].sequence = i;
+			m_EnqueuePos = 0;
+			m_DequeuePos = 0;
+		}
+
+		/**
+		 * A d'tor for this class. Items left in the ring are destroyed with the ring's cells, pointed objects aren't freed (see deleteAll())
+		 */
+		~MPMCRing() { delete [] m_Cells; }
+
+		/**
+		 * Add an item to the ring. May be called by any thread
+		 * @param[in] item The item to add
+		 * @return True if the item was added, false if the ring is full (ownership of a pointed object stays with the caller)
+		 */
+		bool enqueue(const T& item) { return enqueueBulk(&item, 1) == 1; }
+
+		/**
+		 * Add as many items as there is room for from an array. The items are added to consecutive positions, so they are dequeued in order
+		 * (but possibly by different consumers). May be called by any thread
+		 * @param[in] items The items to add
+		 * @param[in] count The number of items in the array
+		 * @return The number of items added, which are the first items of the array. Ownership of the objects pointed by the rest of the
+		 * items stays with the caller
+		 */
+		uint32_t enqueueBulk(const T* items, uint32_t count)
+		{
+			if (count == 0)
+				return 0;
+
+			uint32_t pos;
+			count = claim(&m_EnqueuePos, 0, count, pos);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				Cell& cell = m_Cells[(pos + i) & m_Mask];
+				cell.item = items[i];
+				// the cell is ready to be read in this lap
+				internal::ringStoreRelease(&cell.sequence, pos + i + 1);
+			}
+			return count;
+		}
+
+		/**
+		 * Remove the oldest item from the ring. May be called by any thread
+		 * @param[out] item The removed item
+		 * @return True if an item was removed, false if the ring is empty
+		 */
+		bool dequeue(T& item) { return dequeueBulk(&item, 1) == 1; }
+
+		/**
+		 * Remove up to a given number of the oldest items from the ring. May be called by any thread
+		 * @param[out] items An array for the removed items
+		 * @param[in] count The max number of items to remove, which is the size of the array
+		 * @return The number of items removed
+		 */
+		uint32_t dequeueBulk(T* items, uint32_t count)
+		{
+			if (count == 0)
+				return 0;
+
+			uint32_t pos;
+			count = claim(&m_DequeuePos, 1, count, pos);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				Cell& cell = m_Cells[(pos + i) & m_Mask];
+				items[i] = cell.item;
+				// the cell is ready to be written in the next lap
+				internal::ringStoreRelease(&cell.sequence, pos + i + m_Capacity);
+			}
+			return count;
+		}
+
+		/**
+		 * Dequeue all items and delete the objects they point to. Relevant only for rings of pointers
+		 * @return The number of objects deleted
+		 */
+		uint32_t deleteAll()
+		{
+			uint32_t count = 0;
+			T item;
+			while (dequeue(item))
+			{
+				delete item;
+				count++;
+			}
+			return count;
+		}
+
+		/**
+		 * @return The number of items the ring can hold
+		 */
+		uint32_t getCapacity() const { return m_Capacity; }
+
+		/**
+		 * @return The number of items in the ring, including items that are being added or removed. When called while other threads are
+		 * active the result may be already outdated
+		 */
+		uint32_t getSize() const
+		{
+			uint32_t size = internal::ringLoadAcquire(&m_EnqueuePos) - internal::ringLoadAcquire(&m_DequeuePos);
+			// the positions are read one after the other, so the difference may be momentarily out of range
+			return ((int32_t)size < 0 ? 0 : (size > m_Capacity ? m_Capacity : size));
+		}
+
+		/**
+		 * @return True if the ring is empty. When called while other threads are active the result may be already outdated
+		 */
+		bool isEmpty() const { return getSize() == 0; }
+	};
+
+} // namespace pcpp
+
+#endif // PCAPPP_LOCK_FREE_RING
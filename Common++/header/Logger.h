@@ -55,6 +55,8 @@ namespace pcpp
 		PacketLogModuleSSHLayer, ///< SSHLayer module (Packet++)
 		PacketLogModuleTcpReassembly, ///< TcpReassembly module (Packet++)
 		PacketLogModuleIPReassembly, ///< IPReassembly module (Packet++)
+		PacketLogModulePacketClassifier, ///< PacketClassifier module (Packet++)
+		PacketLogModulePatternMatcher, ///< PatternMatcher module (Packet++)
 		PcapLogModuleWinPcapLiveDevice, ///< WinPcapLiveDevice module (Pcap++)
 		PcapLogModuleRemoteDevice, ///< WinPcapRemoteDevice module (Pcap++)
 		PcapLogModuleLiveDevice, ///< PcapLiveDevice module (Pcap++)
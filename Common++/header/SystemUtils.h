@@ -9,6 +9,32 @@
 
 #define MAX_NUM_OF_CORES 32
 
+/**
+ * Declares a variable of which each thread has its own copy
+ */
+#if defined(_MSC_VER)
+#define PCPP_THREAD_LOCAL __declspec(thread)
+#else
+#define PCPP_THREAD_LOCAL __thread
+#endif
+
+/**
+ * Compiles a function for an instruction set (such as "avx2") that the rest of the code isn't compiled for, so it can be chosen at
+ * runtime according to cpuSupports(). MSVC doesn't need it since it accepts intrinsics of any instruction set
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define PCPP_TARGET(arch) __attribute__((target(arch)))
+#else
+#define PCPP_TARGET(arch)
+#endif
+
+/**
+ * Defined when compiling for x86 or x86-64, where the x86 intrinsics headers can be included
+ */
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PCPP_X86
+#endif
+
 #ifdef _MSC_VER
 int gettimeofday(struct timeval * tp, struct timezone * tzp);
 #endif
@@ -224,6 +250,26 @@ namespace pcpp
 	 */
 	void createCoreVectorFromCoreMask(CoreMask coreMask, std::vector<SystemCore>& resultVec);
 
+	/**
+	 * x86 instruction set extensions whose support can be checked with cpuSupports()
+	 */
+	enum CpuFeature
+	{
+		/** SSE2 */
+		CpuSse2,
+		/** SSSE3 */
+		CpuSsse3,
+		/** AVX2 (including OS support for saving the YMM registers) */
+		CpuAvx2
+	};
+
+	/**
+	 * Check if the CPU the application runs on supports an instruction set extension. The CPU is queried once and the result is cached
+	 * @param[in] feature The extension to check
+	 * @return True if the extension is supported, false otherwise. Always false on non-x86 CPUs
+	 */
+	bool cpuSupports(CpuFeature feature);
+
 	/**
 	 * Execute a shell command and return its output
 	 * @param[in] command The command to run
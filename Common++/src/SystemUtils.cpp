@@ -11,6 +11,9 @@
 #include <signal.h>
 #include <string.h>
 #include <sys/stat.h>
+#if defined(PCPP_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
 #ifdef MAC_OS_X
 #include <mach/clock.h>
 #include <mach/mach.h>
@@ -182,6 +185,54 @@ void createCoreVectorFromCoreMask(CoreMask coreMask, std::vector<SystemCore>& re
 	}
 }
 
+#ifdef PCPP_X86
+static bool detectCpuFeature(CpuFeature feature)
+{
+#if defined(_MSC_VER)
+	int cpuInfo[4];
+	__cpuid(cpuInfo, 0);
+	int maxLeaf = cpuInfo[0];
+	__cpuid(cpuInfo, 1);
+	switch (feature)
+	{
+	case CpuSse2:
+		return (cpuInfo[3] & (1 << 26)) != 0;
+	case CpuSsse3:
+		return (cpuInfo[2] & (1 << 9)) != 0;
+	case CpuAvx2:
+		// the OS must save the YMM registers (OSXSAVE + XCR0 bits 1 and 2)
+		if (maxLeaf < 7 || (cpuInfo[2] & (1 << 27)) == 0 || (_xgetbv(0) & 0x6) != 0x6)
+			return false;
+		__cpuidex(cpuInfo, 7, 0);
+		return (cpuInfo[1] & (1 << 5)) != 0;
+	}
+	return false;
+#else
+	__builtin_cpu_init();
+	switch (feature)
+	{
+	case CpuSse2:
+		return __builtin_cpu_supports("sse2");
+	case CpuSsse3:
+		return __builtin_cpu_supports("ssse3");
+	case CpuAvx2:
+		return __builtin_cpu_supports("avx2");
+	}
+	return false;
+#endif
+}
+#endif
+
+bool cpuSupports(CpuFeature feature)
+{
+#ifdef PCPP_X86
+	static const bool supported[] = { detectCpuFeature(CpuSse2), detectCpuFeature(CpuSsse3), detectCpuFeature(CpuAvx2) };
+	return supported[feature];
+#else
+	return false;
+#endif
+}
+
 std::string executeShellCommand(const std::string command)
 {
 	FILE* pipe = POPEN(command.c_str(), "r");
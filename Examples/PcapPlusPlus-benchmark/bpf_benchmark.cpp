@@ -0,0 +1,142 @@
+/**
+ * PcapPlusPlus BPF filter micro-benchmark
+ * =======================================
+ * This application compiles BPF filters with libpcap and measures the matching throughput of libpcap's interpreter
+ * (pcap_offline_filter()) and of pcpp::ThreadedBpfProgram on the packets of a pcap file. It also verifies both return
+ * the same value for every packet.
+ * Usage: bpf_benchmark pcap_file [repetitions] [filter]
+ */
+
+#include <PcapFileDevice.h>
+#include <ThreadedBpfProgram.h>
+#include <pcap.h>
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+
+using namespace pcpp;
+
+template<typename MatchFunc>
+double measure(MatchFunc func, const RawPacketVector& packets, size_t repetitions, uint64_t& result)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    uint64_t acc = 0;
+    for (size_t rep = 0; rep < repetitions; rep++)
+    {
+        for (RawPacketVector::ConstVectorIterator iter = packets.begin(); iter != packets.end(); iter++)
+            acc += func((*iter)->getRawData(), (uint32_t)(*iter)->getRawDataLen());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    result = acc;
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double> >(end - start).count();
+    return (double)repetitions * packets.size() / seconds / 1000000.0;
+}
+
+bool runFilter(const std::string& filter, int linkType, const RawPacketVector& packets, size_t repetitions)
+{
+    bpf_program program;
+    if (pcap_compile_nopcap(65535, linkType, &program, filter.c_str(), 1, 0) < 0)
+    {
+        std::cout << "Cannot compile filter '" << filter << "'\n";
+        return false;
+    }
+
+    ThreadedBpfProgram threaded;
+    if (!threaded.compile(&program))
+    {
+        std::cout << "Filter '" << filter << "' can't be translated to threaded code\n";
+        pcap_freecode(&program);
+        return false;
+    }
+
+    // verify both give the same result for every packet
+    for (RawPacketVector::ConstVectorIterator iter = packets.begin(); iter != packets.end(); iter++)
+    {
+        pcap_pkthdr hdr;
+        hdr.caplen = hdr.len = (*iter)->getRawDataLen();
+        hdr.ts.tv_sec = hdr.ts.tv_usec = 0;
+        if ((uint32_t)pcap_offline_filter(&program, &hdr, (*iter)->getRawData()) != threaded.run((*iter)->getRawData(), hdr.len, hdr.caplen))
+        {
+            std::cout << "Result mismatch for filter '" << filter << "'\n";
+            pcap_freecode(&program);
+            return false;
+        }
+    }
+
+    uint64_t interpreterResult, threadedResult;
+    double interpreter = measure([&program](const uint8_t* data, uint32_t len) {
+        pcap_pkthdr hdr;
+        hdr.caplen = hdr.len = len;
+        hdr.ts.tv_sec = hdr.ts.tv_usec = 0;
+        return (uint32_t)pcap_offline_filter(&program, &hdr, data);
+    }, packets, repetitions, interpreterResult);
+    double fast = measure([&threaded](const uint8_t* data, uint32_t len) {
+        return threaded.run(data, len, len);
+    }, packets, repetitions, threadedResult);
+
+    u_int numOfInstructions = program.bf_len;
+    pcap_freecode(&program);
+
+    if (interpreterResult != threadedResult)
+    {
+        std::cout << "Result mismatch for filter '" << filter << "'\n";
+        return false;
+    }
+
+    std::cout << filter << " | " << numOfInstructions << " | " << interpreter << " | " << fast << " | " << fast / interpreter << "x\n";
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2)
+    {
+        std::cout << "Usage: bpf_benchmark pcap_file [repetitions] [filter]\n";
+        return 1;
+    }
+
+    size_t repetitions = (argc > 2 ? (size_t)atoi(argv[2]) : 20);
+    if (repetitions == 0)
+        repetitions = 1;
+
+    IFileReaderDevice* reader = IFileReaderDevice::getReader(argv[1]);
+    if (reader == NULL || !reader->open())
+    {
+        std::cout << "Cannot open file '" << argv[1] << "'\n";
+        delete reader;
+        return 1;
+    }
+
+    RawPacketVector packets;
+    reader->getNextPackets(packets);
+    reader->close();
+    delete reader;
+    if (packets.size() == 0)
+    {
+        std::cout << "File '" << argv[1] << "' contains no packets\n";
+        return 1;
+    }
+
+    int linkType = packets.front()->getLinkLayerType();
+
+    const char* defaultFilters[] = {
+        "tcp",
+        "tcp port 80",
+        "udp and (port 53 or port 67)",
+        "host 10.0.0.1 or net 192.168.0.0/16",
+        "vlan and tcp[tcpflags] & tcp-syn != 0",
+        "ip6 and tcp dst port 443",
+        "len > 100 and ip[8] < 64"
+    };
+
+    std::cout << "filter | instructions | pcap_offline_filter (Mpps) | ThreadedBpfProgram (Mpps) | speedup\n";
+    if (argc > 3)
+        return runFilter(argv[3], linkType, packets, repetitions) ? 0 : 1;
+
+    bool success = true;
+    for (size_t i = 0; i < sizeof(defaultFilters) / sizeof(defaultFilters[0]); i++)
+        success &= runFilter(defaultFilters[i], linkType, packets, repetitions);
+
+    return success ? 0 : 1;
+}
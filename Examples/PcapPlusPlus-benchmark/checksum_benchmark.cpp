@@ -0,0 +1,97 @@
+/**
+ * PcapPlusPlus checksum micro-benchmark
+ * =====================================
+ * This application measures the throughput of pcpp::computeChecksum() for different buffer sizes and compares it to the
+ * straightforward word-by-word implementation PcapPlusPlus used before computeChecksum() was vectorized.
+ * Usage: checksum_benchmark [repetitions]
+ */
+
+#include <PacketUtils.h>
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cstdlib>
+
+using namespace pcpp;
+
+// the original scalar implementation, kept here as a baseline
+uint16_t scalarChecksum(ScalarBuffer<uint16_t> vec[], size_t vecSize)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i < vecSize; i++)
+    {
+        uint32_t localSum = 0;
+        size_t buffSize = vec[i].len;
+        const uint16_t* buffer = vec[i].buffer;
+        while (buffSize > 1) {
+            localSum += *buffer++;
+            buffSize -= 2;
+        }
+
+        if (buffSize == 1)
+        {
+            uint8_t lastByte = *(uint8_t*)buffer;
+            localSum += lastByte;
+        }
+
+        while (localSum >> 16)
+            localSum = (localSum & 0xffff) + (localSum >> 16);
+        sum += be16toh((uint16_t)localSum);
+    }
+
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+
+    return (uint16_t)~sum;
+}
+
+template<typename ChecksumFunc>
+double measure(ChecksumFunc func, std::vector<uint8_t>& data, size_t bufferSize, size_t repetitions, uint16_t& result)
+{
+    ScalarBuffer<uint16_t> buffer = { (uint16_t*)&data[0], bufferSize };
+    size_t iterations = repetitions * (64 * 1024 * 1024 / bufferSize);
+
+    data[0] = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    uint16_t acc = 0;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        acc ^= func(&buffer, 1);
+        // touch the data so the compiler can't hoist the call out of the loop
+        data[0] = (uint8_t)i;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    result = acc;
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double> >(end - start).count();
+    return (double)iterations * bufferSize / seconds / (1024.0 * 1024.0 * 1024.0);
+}
+
+int main(int argc, char *argv[]) {
+    size_t repetitions = (argc > 1 ? (size_t)atoi(argv[1]) : 4);
+    if (repetitions == 0)
+        repetitions = 1;
+
+    std::vector<uint8_t> data(64 * 1024);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (uint8_t)rand();
+
+    const size_t sizes[] = { 20, 40, 64, 576, 1500, 9000, 65535 };
+
+    std::cout << "buffer size | scalar (GB/s) | computeChecksum (GB/s) | speedup\n";
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        uint16_t scalarResult, result;
+        double scalar = measure(scalarChecksum, data, sizes[i], repetitions, scalarResult);
+        double fast = measure(computeChecksum, data, sizes[i], repetitions, result);
+        if (scalarResult != result)
+        {
+            std::cout << "Checksum mismatch for buffer size " << sizes[i] << "\n";
+            return 1;
+        }
+
+        std::cout << sizes[i] << " | " << scalar << " | " << fast << " | " << fast / scalar << "x\n";
+    }
+
+    return 0;
+}
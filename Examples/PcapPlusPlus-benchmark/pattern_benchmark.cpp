@@ -0,0 +1,209 @@
+/**
+ * PcapPlusPlus multi-pattern search micro-benchmark
+ * =================================================
+ * This application measures the throughput of pcpp::PatternMatcher on the TCP and UDP payloads of a pcap file for pattern sets of
+ * growing size, and compares it to searching the patterns one by one with cross_platform_memmem(). The patterns are substrings of the
+ * payloads themselves (so they are actually found) mixed with random byte strings. It also measures streaming search of the payloads
+ * reassembled by TcpReassembly.
+ * Usage: pattern_benchmark pcap_file [repetitions]
+ */
+
+#include <PcapFileDevice.h>
+#include <PatternMatcher.h>
+#include <TcpReassembly.h>
+#include <GeneralUtils.h>
+#include <TcpLayer.h>
+#include <UdpLayer.h>
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+using namespace pcpp;
+
+struct Payload
+{
+    const uint8_t* data;
+    size_t len;
+};
+
+static void countMatch(const PatternMatch& /* match */, void* userCookie)
+{
+    (*(uint64_t*)userCookie)++;
+}
+
+static void countFlowMatch(uint32_t /* flowKey */, int8_t /* side */, const PatternMatch& /* match */, void* userCookie)
+{
+    (*(uint64_t*)userCookie)++;
+}
+
+static void onMessageReady(int8_t side, const TcpStreamData& tcpData, void* userCookie)
+{
+    ((PatternFlowMatcher*)userCookie)->scan(side, tcpData);
+}
+
+static void onConnectionEnd(const ConnectionData& connectionData, TcpReassembly::ConnectionEndReason /* reason */, void* userCookie)
+{
+    ((PatternFlowMatcher*)userCookie)->closeFlow(connectionData.flowKey);
+}
+
+static double elapsedSeconds(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::duration<double> >(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static std::vector<std::string> generatePatterns(const std::vector<Payload>& payloads, size_t numOfPatterns)
+{
+    std::vector<std::string> patterns;
+    while (patterns.size() < numOfPatterns)
+    {
+        size_t len = 4 + rand() % 13;
+        const Payload& payload = payloads[rand() % payloads.size()];
+        if (rand() % 2 == 0 && payload.len >= len)
+        {
+            patterns.push_back(std::string((const char*)payload.data + rand() % (payload.len - len + 1), len));
+            continue;
+        }
+
+        std::string pattern;
+        for (size_t i = 0; i < len; i++)
+            pattern += (char)rand();
+        patterns.push_back(pattern);
+    }
+
+    return patterns;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2)
+    {
+        std::cout << "Usage: pattern_benchmark pcap_file [repetitions]\n";
+        return 1;
+    }
+
+    size_t repetitions = (argc > 2 ? (size_t)atoi(argv[2]) : 10);
+    if (repetitions == 0)
+        repetitions = 1;
+
+    IFileReaderDevice* reader = IFileReaderDevice::getReader(argv[1]);
+    if (reader == NULL || !reader->open())
+    {
+        std::cout << "Cannot open file '" << argv[1] << "'\n";
+        delete reader;
+        return 1;
+    }
+
+    RawPacketVector rawPackets;
+    reader->getNextPackets(rawPackets);
+    reader->close();
+    delete reader;
+
+    std::vector<Packet*> packets;
+    std::vector<Payload> payloads;
+    size_t totalBytes = 0;
+    for (RawPacketVector::ConstVectorIterator iter = rawPackets.begin(); iter != rawPackets.end(); iter++)
+    {
+        Packet* packet = new Packet(*iter);
+        packets.push_back(packet);
+        Layer* transportLayer = packet->getLayerOfType<TcpLayer>();
+        if (transportLayer == NULL)
+            transportLayer = packet->getLayerOfType<UdpLayer>();
+        if (transportLayer == NULL || transportLayer->getLayerPayloadSize() == 0)
+            continue;
+
+        Payload payload = { transportLayer->getLayerPayload(), transportLayer->getLayerPayloadSize() };
+        payloads.push_back(payload);
+        totalBytes += payload.len;
+    }
+
+    if (payloads.empty())
+    {
+        std::cout << "File '" << argv[1] << "' contains no TCP or UDP payloads\n";
+        return 1;
+    }
+
+    std::cout << payloads.size() << " payloads, " << totalBytes << " bytes\n";
+    std::cout << "patterns | states | memory (KB) | PatternMatcher (MB/s) | memmem per pattern (MB/s) | TcpReassembly + PatternFlowMatcher (MB/s) | matches\n";
+
+    srand(1);
+    const size_t patternSetSizes[] = { 10, 100, 1000, 10000 };
+    for (size_t setIndex = 0; setIndex < sizeof(patternSetSizes) / sizeof(patternSetSizes[0]); setIndex++)
+    {
+        std::vector<std::string> patterns = generatePatterns(payloads, patternSetSizes[setIndex]);
+        PatternMatcher matcher;
+        for (size_t i = 0; i < patterns.size(); i++)
+            matcher.addPattern(patterns[i], (uint32_t)i);
+        if (!matcher.compile())
+        {
+            std::cout << "Cannot compile " << patterns.size() << " patterns\n";
+            return 1;
+        }
+
+        uint64_t numOfMatches = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t rep = 0; rep < repetitions; rep++)
+        {
+            for (size_t i = 0; i < payloads.size(); i++)
+                matcher.search(payloads[i].data, payloads[i].len, countMatch, &numOfMatches);
+        }
+        double matcherThroughput = (double)totalBytes * repetitions / elapsedSeconds(start) / 1000000.0;
+        numOfMatches /= repetitions;
+
+        // searching thousands of patterns one by one takes too long, so memmem is only measured for the small sets
+        std::string memmemThroughput = "-";
+        if (patterns.size() <= 100)
+        {
+            uint64_t memmemMatches = 0;
+            start = std::chrono::high_resolution_clock::now();
+            for (size_t rep = 0; rep < repetitions; rep++)
+            {
+                for (size_t i = 0; i < payloads.size(); i++)
+                {
+                    for (size_t j = 0; j < patterns.size(); j++)
+                    {
+                        const char* data = (const char*)payloads[i].data;
+                        size_t len = payloads[i].len;
+                        const char* found;
+                        while ((found = cross_platform_memmem(data, len, patterns[j].data(), patterns[j].length())) != NULL)
+                        {
+                            memmemMatches++;
+                            len -= (found - data) + 1;
+                            data = found + 1;
+                        }
+                    }
+                }
+            }
+            std::ostringstream stream;
+            stream << (double)totalBytes * repetitions / elapsedSeconds(start) / 1000000.0;
+            memmemThroughput = stream.str();
+
+            if (memmemMatches / repetitions != numOfMatches)
+            {
+                std::cout << "Match count mismatch for " << patterns.size() << " patterns\n";
+                return 1;
+            }
+        }
+
+        uint64_t streamMatches = 0;
+        start = std::chrono::high_resolution_clock::now();
+        for (size_t rep = 0; rep < repetitions; rep++)
+        {
+            PatternFlowMatcher flowMatcher(matcher, countFlowMatch, &streamMatches);
+            TcpReassembly reassembly(onMessageReady, &flowMatcher, NULL, onConnectionEnd);
+            for (size_t i = 0; i < packets.size(); i++)
+                reassembly.reassemblePacket(*packets[i]);
+            reassembly.closeAllConnections();
+        }
+        double streamThroughput = (double)totalBytes * repetitions / elapsedSeconds(start) / 1000000.0;
+
+        std::cout << patterns.size() << " | " << matcher.getNumOfStates() << " | " << matcher.getMemoryUsage() / 1024 << " | "
+            << matcherThroughput << " | " << memmemThroughput << " | " << streamThroughput << " | " << numOfMatches << "\n";
+    }
+
+    for (size_t i = 0; i < packets.size(); i++)
+        delete packets[i];
+
+    return 0;
+}
@@ -0,0 +1,241 @@
+/**
+ * PcapPlusPlus lock-free ring micro-benchmark
+ * ===========================================
+ * This application measures how many packets per second can be handed from a producer thread (such as a capture thread) to a consumer
+ * thread (such as a worker thread) through pcpp::SPSCRing and pcpp::MPMCRing, compared to a queue protected by a mutex.
+ * Packets are RawPacket pointers taken from a pool: the producer moves them to the consumer through the measured ring and the consumer
+ * returns them to the producer through a second ring of the same kind, so ownership of every packet travels the way it would in an
+ * application. Each measurement runs with the producer and the consumer pinned to a pair of cores.
+ * Usage: ring_benchmark [millions_of_packets] [producer_core:consumer_core ...]
+ */
+
+#include <LockFreeRing.h>
+#include <RawPacket.h>
+#include <SystemUtils.h>
+#include <pthread.h>
+#include <sched.h>
+#include <iostream>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+
+using namespace pcpp;
+
+static const uint32_t RingSize = 1024;
+static const uint32_t PoolSize = 1024;
+static const uint32_t MaxBurst = 32;
+
+// the baseline: a queue protected by a mutex, with the same interface as the rings
+template<typename T>
+class LockedQueue
+{
+public:
+    LockedQueue(uint32_t capacity) : m_Capacity(capacity) { pthread_mutex_init(&m_Mutex, NULL); }
+    ~LockedQueue() { pthread_mutex_destroy(&m_Mutex); }
+
+    uint32_t enqueueBulk(const T* items, uint32_t count)
+    {
+        pthread_mutex_lock(&m_Mutex);
+        uint32_t i = 0;
+        for (; i < count && m_Queue.size() < m_Capacity; i++)
+            m_Queue.push_back(items[i]);
+        pthread_mutex_unlock(&m_Mutex);
+        return i;
+    }
+
+    uint32_t dequeueBulk(T* items, uint32_t count)
+    {
+        pthread_mutex_lock(&m_Mutex);
+        uint32_t i = 0;
+        for (; i < count && !m_Queue.empty(); i++)
+        {
+            items[i] = m_Queue.front();
+            m_Queue.pop_front();
+        }
+        pthread_mutex_unlock(&m_Mutex);
+        return i;
+    }
+
+private:
+    pthread_mutex_t m_Mutex;
+    std::deque<T> m_Queue;
+    uint32_t m_Capacity;
+};
+
+template<typename Ring>
+struct BenchmarkContext
+{
+    Ring* workRing;
+    Ring* freeRing;
+    uint64_t numOfPackets;
+    uint32_t burstSize;
+    int producerCore;
+    int consumerCore;
+    uint64_t bytesSeen;
+};
+
+static void pinToCore(int coreId)
+{
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(coreId, &cpuset);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) != 0)
+        std::cerr << "Cannot pin thread to core " << coreId << "\n";
+}
+
+// moves a burst of packets to the ring, waiting while the ring is full
+template<typename Ring>
+static void enqueueAll(Ring* ring, RawPacket** packets, uint32_t count)
+{
+    uint32_t sent = 0;
+    while (sent < count)
+    {
+        uint32_t result = ring->enqueueBulk(packets + sent, count - sent);
+        if (result == 0)
+            sched_yield();
+        sent += result;
+    }
+}
+
+template<typename Ring>
+static void* producerMain(void* ptr)
+{
+    BenchmarkContext<Ring>* context = (BenchmarkContext<Ring>*)ptr;
+    pinToCore(context->producerCore);
+
+    RawPacket* burst[MaxBurst];
+    uint64_t sent = 0;
+    while (sent < context->numOfPackets)
+    {
+        uint32_t count = context->burstSize;
+        if (context->numOfPackets - sent < count)
+            count = (uint32_t)(context->numOfPackets - sent);
+
+        // take packets the consumer is done with, a capture thread would fill them here
+        count = context->freeRing->dequeueBulk(burst, count);
+        if (count == 0)
+        {
+            sched_yield();
+            continue;
+        }
+
+        enqueueAll(context->workRing, burst, count);
+        sent += count;
+    }
+
+    return NULL;
+}
+
+template<typename Ring>
+static void* consumerMain(void* ptr)
+{
+    BenchmarkContext<Ring>* context = (BenchmarkContext<Ring>*)ptr;
+    pinToCore(context->consumerCore);
+
+    RawPacket* burst[MaxBurst];
+    uint64_t received = 0;
+    while (received < context->numOfPackets)
+    {
+        uint32_t count = context->workRing->dequeueBulk(burst, context->burstSize);
+        if (count == 0)
+        {
+            sched_yield();
+            continue;
+        }
+
+        // the consumer owns the packets now, a worker would analyze them here
+        for (uint32_t i = 0; i < count; i++)
+            context->bytesSeen += burst[i]->getRawDataLen();
+
+        enqueueAll(context->freeRing, burst, count);
+        received += count;
+    }
+
+    return NULL;
+}
+
+// returns the throughput in millions of packets per second
+template<typename Ring>
+static double measure(std::vector<RawPacket*>& pool, uint64_t numOfPackets, uint32_t burstSize, int producerCore, int consumerCore)
+{
+    Ring workRing(RingSize);
+    Ring freeRing(RingSize);
+    enqueueAll(&freeRing, &pool[0], (uint32_t)pool.size());
+
+    BenchmarkContext<Ring> context = { &workRing, &freeRing, numOfPackets, burstSize, producerCore, consumerCore, 0 };
+
+    auto start = std::chrono::high_resolution_clock::now();
+    pthread_t producer, consumer;
+    pthread_create(&consumer, NULL, consumerMain<Ring>, &context);
+    pthread_create(&producer, NULL, producerMain<Ring>, &context);
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    // all packets must be back in the pool
+    RawPacket* packet;
+    uint32_t returned = 0;
+    while (freeRing.dequeueBulk(&packet, 1) == 1)
+        returned++;
+    if (returned != pool.size() || context.bytesSeen != numOfPackets * 64)
+        std::cerr << "Packets were lost or corrupted\n";
+
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double> >(end - start).count();
+    return (double)numOfPackets / seconds / 1000000.0;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t numOfPackets = (argc > 1 ? (uint64_t)atoi(argv[1]) : 10) * 1000000;
+    if (numOfPackets == 0)
+        numOfPackets = 1000000;
+
+    std::vector<std::pair<int, int> > corePairs;
+    for (int i = 2; i < argc; i++)
+    {
+        int producerCore, consumerCore;
+        if (sscanf(argv[i], "%d:%d", &producerCore, &consumerCore) != 2)
+        {
+            std::cerr << "Core pairs should be given as producer_core:consumer_core\n";
+            return 1;
+        }
+        corePairs.push_back(std::make_pair(producerCore, consumerCore));
+    }
+
+    // by default measure two neighbor cores and two cores that are far apart (different physical cores or sockets on most machines)
+    int numOfCores = getNumOfCores();
+    if (corePairs.empty())
+    {
+        corePairs.push_back(std::make_pair(0, numOfCores > 1 ? 1 : 0));
+        if (numOfCores > 3)
+            corePairs.push_back(std::make_pair(0, numOfCores / 2));
+    }
+
+    uint8_t packetData[64] = { 0 };
+    timeval ts = { 0, 0 };
+    std::vector<RawPacket*> pool;
+    for (uint32_t i = 0; i < PoolSize; i++)
+        pool.push_back(new RawPacket(packetData, sizeof(packetData), ts, false));
+
+    const uint32_t burstSizes[] = { 1, MaxBurst };
+
+    std::cout << "cores | burst | mutex queue (Mpps) | SPSCRing (Mpps) | MPMCRing (Mpps)\n";
+    for (size_t i = 0; i < corePairs.size(); i++)
+    {
+        for (size_t j = 0; j < sizeof(burstSizes) / sizeof(burstSizes[0]); j++)
+        {
+            int producerCore = corePairs[i].first, consumerCore = corePairs[i].second;
+            double locked = measure<LockedQueue<RawPacket*> >(pool, numOfPackets, burstSizes[j], producerCore, consumerCore);
+            double spsc = measure<SPSCRing<RawPacket*> >(pool, numOfPackets, burstSizes[j], producerCore, consumerCore);
+            double mpmc = measure<MPMCRing<RawPacket*> >(pool, numOfPackets, burstSizes[j], producerCore, consumerCore);
+            std::cout << producerCore << ":" << consumerCore << " | " << burstSizes[j] << " | " << locked << " | " << spsc << " | " << mpmc << "\n";
+        }
+    }
+
+    for (uint32_t i = 0; i < PoolSize; i++)
+        delete pool[i];
+
+    return 0;
+}
@@ -0,0 +1,327 @@
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <Packet.h>
+#include <EthLayer.h>
+#include <VlanLayer.h>
+#include <IPv4Layer.h>
+#include <IPv6Layer.h>
+#include <ArpLayer.h>
+#include <TcpLayer.h>
+#include <UdpLayer.h>
+
+/**
+ * The protocols counted in a chunk summary. They are the protocols the search criteria analyzer (see SearchCriteriaAnalyzer.h) knows
+ * BPF keywords for
+ */
+enum SummaryProtocol
+{
+	SummaryIPv4,
+	SummaryIPv6,
+	SummaryArp,
+	SummaryTcp,
+	SummaryUdp,
+	SummarySctp,
+	SummaryIcmp,
+	SummaryIcmpV6,
+	SummaryIgmp,
+	SummaryVlan,
+	SummaryMpls,
+	NumOfSummaryProtocols
+};
+
+
+/**
+ * A summary of a range of packet records in a file: its time range, how many packets of each protocol it contains, a Bloom filter of the IP
+ * addresses and a bitmap of the TCP/UDP/SCTP ports it contains. The summary holds a superset of what a BPF filter can see in the packets
+ * (for example it also contains addresses of tunneled packets), so if the summary says a chunk can't contain a value it really doesn't.
+ * Packets the summary can't classify are counted in numOfUnclassifiedPackets and a chunk that contains any of them is never skipped
+ */
+struct ChunkSummary
+{
+	static const size_t IpBloomFilterBits = 32768;
+	static const size_t IpBloomFilterHashes = 3;
+	static const size_t PortBitmapBits = 65536;
+
+	uint64_t startOffset;
+	uint64_t endOffset;
+	uint64_t numOfPackets;
+	uint64_t numOfUnclassifiedPackets;
+	// nanoseconds since epoch
+	uint64_t minTimestamp;
+	uint64_t maxTimestamp;
+	uint64_t protocolCount[NumOfSummaryProtocols];
+	uint8_t ipBloomFilter[IpBloomFilterBits / 8];
+	uint8_t portBitmap[PortBitmapBits / 8];
+
+	ChunkSummary() { clear(); }
+
+	void clear()
+	{
+		memset(this, 0, sizeof(ChunkSummary));
+		minTimestamp = (uint64_t)-1;
+	}
+
+	void addPacket(pcpp::Packet& packet)
+	{
+		const pcpp::RawPacket* rawPacket = packet.getRawPacketReadOnly();
+		timespec timestamp = rawPacket->getPacketTimeStamp();
+		uint64_t packetTime = (uint64_t)timestamp.tv_sec * 1000000000ULL + (uint64_t)timestamp.tv_nsec;
+		if (packetTime < minTimestamp)
+			minTimestamp = packetTime;
+		if (packetTime > maxTimestamp)
+			maxTimestamp = packetTime;
+		numOfPackets++;
+
+		pcpp::Layer* firstLayer = packet.getFirstLayer();
+		bool classified = (firstLayer != NULL && firstLayer->getProtocol() != pcpp::GenericPayload && firstLayer->getProtocol() != pcpp::UnknownProtocol);
+
+		for (pcpp::Layer* layer = firstLayer; layer != NULL; layer = layer->getNextLayer())
+		{
+			switch (layer->getProtocol())
+			{
+			case pcpp::Ethernet:
+				classified = classified && isNextLayerParsed(readBigEndian16((uint8_t*)&((pcpp::EthLayer*)layer)->getEthHeader()->etherType), layer->getNextLayer());
+				break;
+			case pcpp::VLAN:
+				protocolCount[SummaryVlan]++;
+				classified = classified && isNextLayerParsed(readBigEndian16((uint8_t*)&((pcpp::VlanLayer*)layer)->getVlanHeader()->etherType), layer->getNextLayer());
+				break;
+			case pcpp::MPLS:
+				protocolCount[SummaryMpls]++;
+				break;
+			case pcpp::ARP:
+			{
+				protocolCount[SummaryArp]++;
+				pcpp::ArpLayer* arpLayer = (pcpp::ArpLayer*)layer;
+				addIpAddress(arpLayer->getSenderIpAddr().toBytes(), 4);
+				addIpAddress(arpLayer->getTargetIpAddr().toBytes(), 4);
+				break;
+			}
+			case pcpp::IPv4:
+			{
+				protocolCount[SummaryIPv4]++;
+				pcpp::IPv4Layer* ipLayer = (pcpp::IPv4Layer*)layer;
+				addIpAddress(ipLayer->getSrcIpAddress().toBytes(), 4);
+				addIpAddress(ipLayer->getDstIpAddress().toBytes(), 4);
+				// BPF looks at the protocol field and the bytes that follow the header, not at what PcapPlusPlus managed to parse
+				addIpProtocol(ipLayer->getIPv4Header()->protocol, ipLayer->getFragmentOffset() == 0 ? layer : NULL);
+				break;
+			}
+			case pcpp::IPv6:
+			{
+				protocolCount[SummaryIPv6]++;
+				pcpp::IPv6Layer* ipLayer = (pcpp::IPv6Layer*)layer;
+				addIpAddress(ipLayer->getSrcIpAddress().toBytes(), 16);
+				addIpAddress(ipLayer->getDstIpAddress().toBytes(), 16);
+				// like BPF's protocol primitives, look through a fragment header that follows the fixed header. BPF doesn't look for ports
+				// after it
+				uint8_t nextHeader = ipLayer->getIPv6Header()->nextHeader;
+				if (nextHeader == pcpp::PACKETPP_IPPROTO_FRAGMENT && layer->getDataLen() >= sizeof(pcpp::ip6_hdr) + 8)
+					addIpProtocol(layer->getData()[sizeof(pcpp::ip6_hdr)], NULL);
+				else
+					addIpProtocol(nextHeader, layer);
+				break;
+			}
+			case pcpp::TCP:
+			case pcpp::UDP:
+				// both headers start with the source and destination ports
+				addPort(readBigEndian16(layer->getData()));
+				addPort(readBigEndian16(layer->getData() + 2));
+				break;
+			default:
+				break;
+			}
+		}
+
+		if (!classified)
+			numOfUnclassifiedPackets++;
+	}
+
+	bool mayContainIpAddress(const uint8_t* address, size_t len) const
+	{
+		uint64_t hash = hashIpAddress(address, len);
+		for (size_t i = 0; i < IpBloomFilterHashes; i++)
+		{
+			size_t bit = (size_t)((hash + i * (hash >> 32 | 1)) % IpBloomFilterBits);
+			if ((ipBloomFilter[bit / 8] & (1 << (bit % 8))) == 0)
+				return false;
+		}
+
+		return true;
+	}
+
+	bool mayContainPort(uint16_t port) const { return (portBitmap[port / 8] & (1 << (port % 8))) != 0; }
+
+private:
+	static uint16_t readBigEndian16(const uint8_t* data) { return (uint16_t)(data[0] << 8 | data[1]); }
+
+	static bool isNextLayerParsed(uint16_t etherType, pcpp::Layer* nextLayer)
+	{
+		pcpp::ProtocolType expected;
+		switch (etherType)
+		{
+		case PCPP_ETHERTYPE_IP: expected = pcpp::IPv4; break;
+		case PCPP_ETHERTYPE_IPV6: expected = pcpp::IPv6; break;
+		case PCPP_ETHERTYPE_ARP: expected = pcpp::ARP; break;
+		case PCPP_ETHERTYPE_VLAN: expected = pcpp::VLAN; break;
+		case PCPP_ETHERTYPE_MPLS: expected = pcpp::MPLS; break;
+		// PcapPlusPlus doesn't parse RARP but BPF 'host' matches its addresses
+		case PCPP_ETHERTYPE_REVARP: return false;
+		default:
+			return true;
+		}
+
+		// a truncated or malformed header BPF may still match on
+		return nextLayer != NULL && nextLayer->getProtocol() == expected;
+	}
+
+	static uint64_t hashIpAddress(const uint8_t* address, size_t len)
+	{
+		// FNV-1a followed by the murmur3 finalizer, the first only is weak on addresses that differ in their last byte
+		uint64_t hash = 0xcbf29ce484222325ULL;
+		for (size_t i = 0; i < len; i++)
+			hash = (hash ^ address[i]) * 0x100000001b3ULL;
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdULL;
+		hash ^= hash >> 33;
+		hash *= 0xc4ceb9fe1a85ec53ULL;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+	void addIpAddress(const uint8_t* address, size_t len)
+	{
+		uint64_t hash = hashIpAddress(address, len);
+		for (size_t i = 0; i < IpBloomFilterHashes; i++)
+		{
+			size_t bit = (size_t)((hash + i * (hash >> 32 | 1)) % IpBloomFilterBits);
+			ipBloomFilter[bit / 8] |= (1 << (bit % 8));
+		}
+	}
+
+	void addPort(uint16_t port) { portBitmap[port / 8] |= (1 << (port % 8)); }
+
+	void addIpProtocol(uint8_t protocol, pcpp::Layer* ipLayer)
+	{
+		switch (protocol)
+		{
+		case pcpp::PACKETPP_IPPROTO_TCP: protocolCount[SummaryTcp]++; break;
+		case pcpp::PACKETPP_IPPROTO_UDP: protocolCount[SummaryUdp]++; break;
+		case 132: protocolCount[SummarySctp]++; break;
+		case pcpp::PACKETPP_IPPROTO_ICMP: protocolCount[SummaryIcmp]++; return;
+		case pcpp::PACKETPP_IPPROTO_ICMPV6: protocolCount[SummaryIcmpV6]++; return;
+		case pcpp::PACKETPP_IPPROTO_IGMP: protocolCount[SummaryIgmp]++; return;
+		default:
+			return;
+		}
+
+		// the ports of TCP, UDP and SCTP are the first 4 bytes after the IP header
+		if (ipLayer != NULL && ipLayer->getLayerPayloadSize() >= 4)
+		{
+			addPort(readBigEndian16(ipLayer->getLayerPayload()));
+			addPort(readBigEndian16(ipLayer->getLayerPayload() + 2));
+		}
+	}
+};
+
+
+/**
+ * The summary of a whole file: a list of chunk summaries. It is stored in a sidecar file next to the file it summarizes (see
+ * getSummaryFileName()) and is valid as long as that file's size and modification time don't change.
+ * The sidecar is a plain dump of the structures in host byte order. A sidecar written on a machine of a different byte order or by a
+ * different version is treated as missing and rebuilt
+ */
+class FileSummary
+{
+public:
+	// true if the chunks can be read separately with PcapChunkReader. Otherwise there is a single chunk and the file is read whole
+	bool isChunked;
+	std::vector<ChunkSummary> chunks;
+
+	FileSummary() : isChunked(false) {}
+
+	static std::string getSummaryFileName(const std::string& fileName) { return fileName + ".pcpp-summary"; }
+
+	bool read(const std::string& fileName, uint64_t fileSize, int64_t modificationTime)
+	{
+		chunks.clear();
+		FILE* file = fopen(getSummaryFileName(fileName).c_str(), "rb");
+		if (file == NULL)
+			return false;
+
+		SidecarHeader header;
+		bool result = (fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, getSidecarMagic(), sizeof(header.magic)) == 0 &&
+				header.byteOrderMark == ByteOrderMark && header.fileSize == fileSize && header.modificationTime == modificationTime &&
+				header.numOfChunks > 0);
+
+		if (result)
+		{
+			isChunked = (header.isChunked != 0);
+			chunks.resize((size_t)header.numOfChunks);
+			result = (fread(&chunks[0], sizeof(ChunkSummary), chunks.size(), file) == chunks.size());
+		}
+
+		fclose(file);
+		if (!result)
+			chunks.clear();
+		return result;
+	}
+
+	bool write(const std::string& fileName, uint64_t fileSize, int64_t modificationTime) const
+	{
+		if (chunks.empty())
+			return false;
+
+		// write to a temporary file and rename it so a concurrent search never sees a partially written sidecar
+		std::string summaryFileName = getSummaryFileName(fileName);
+		std::string tempFileName = summaryFileName + ".tmp";
+		FILE* file = fopen(tempFileName.c_str(), "wb");
+		if (file == NULL)
+			return false;
+
+		SidecarHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, getSidecarMagic(), sizeof(header.magic));
+		header.byteOrderMark = ByteOrderMark;
+		header.isChunked = (isChunked ? 1 : 0);
+		header.fileSize = fileSize;
+		header.modificationTime = modificationTime;
+		header.numOfChunks = chunks.size();
+
+		bool result = (fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(&chunks[0], sizeof(ChunkSummary), chunks.size(), file) == chunks.size());
+		result = (fclose(file) == 0) && result;
+
+#if defined(WIN32) || defined(WINx64)
+		// rename() doesn't replace an existing file on Windows
+		if (result)
+			remove(summaryFileName.c_str());
+#endif
+		if (!result || rename(tempFileName.c_str(), summaryFileName.c_str()) != 0)
+		{
+			remove(tempFileName.c_str());
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+	struct SidecarHeader
+	{
+		char magic[8];
+		uint32_t byteOrderMark;
+		uint32_t isChunked;
+		uint64_t fileSize;
+		int64_t modificationTime;
+		uint64_t numOfChunks;
+	};
+
+	static const uint32_t ByteOrderMark = 0x01020304;
+
+	// the last character is the format version. Version 2 counts the protocol after an IPv6 fragment header, older sidecars are rebuilt
+	static const char* getSidecarMagic() { return "PCPPSUM2"; }
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <RawPacket.h>
+
+#if defined(WIN32) || defined(WINx64)
+#define PCAP_SEARCH_FSEEK _fseeki64
+#define PCAP_SEARCH_FTELL _ftelli64
+#else
+#define PCAP_SEARCH_FSEEK fseeko
+#define PCAP_SEARCH_FTELL ftello
+#endif
+
+/**
+ * A minimal reader of pcap (not pcap-ng) files that can start reading at any packet record given its byte offset in the file, so several
+ * threads can read different chunks of the same file. Record offsets are known from the file summary (see FileSummary.h) which is
+ * built while the file is read sequentially with this reader. Files in formats this reader doesn't support are read with
+ * pcpp::IFileReaderDevice instead
+ */
+class PcapChunkReader
+{
+public:
+	static const uint64_t FileHeaderSize = 24;
+
+	PcapChunkReader() : m_File(NULL), m_Swapped(false), m_NanoSecPrecision(false), m_LinkType(pcpp::LINKTYPE_ETHERNET), m_Offset(0), m_EndOffset(0) {}
+
+	~PcapChunkReader() { close(); }
+
+	/**
+	 * Open a file and read its header
+	 * @return False if the file can't be opened or isn't a pcap file this reader supports
+	 */
+	bool open(const std::string& fileName)
+	{
+		close();
+		m_File = fopen(fileName.c_str(), "rb");
+		if (m_File == NULL)
+			return false;
+
+		uint8_t header[FileHeaderSize];
+		if (fread(header, 1, sizeof(header), m_File) != sizeof(header))
+		{
+			close();
+			return false;
+		}
+
+		uint32_t magic;
+		memcpy(&magic, header, sizeof(magic));
+		switch (magic)
+		{
+		case 0xa1b2c3d4: m_Swapped = false; m_NanoSecPrecision = false; break;
+		case 0xd4c3b2a1: m_Swapped = true; m_NanoSecPrecision = false; break;
+		case 0xa1b23c4d: m_Swapped = false; m_NanoSecPrecision = true; break;
+		case 0x4d3cb2a1: m_Swapped = true; m_NanoSecPrecision = true; break;
+		default:
+			close();
+			return false;
+		}
+
+		m_LinkType = linkTypeToDlt(toHost(readUint32(header + 20)) & 0x0fffffff);
+		m_Offset = FileHeaderSize;
+		m_EndOffset = (uint64_t)-1;
+		return true;
+	}
+
+	void close()
+	{
+		if (m_File != NULL)
+			fclose(m_File);
+		m_File = NULL;
+	}
+
+	/**
+	 * Set the range of bytes to read packet records from. startOffset must be the offset of a packet record
+	 */
+	bool setRange(uint64_t startOffset, uint64_t endOffset)
+	{
+		if (m_File == NULL || PCAP_SEARCH_FSEEK(m_File, startOffset, SEEK_SET) != 0)
+			return false;
+
+		m_Offset = startOffset;
+		m_EndOffset = endOffset;
+		return true;
+	}
+
+	/**
+	 * Read the next packet record in the range. Like pcpp::IFileReaderDevice, the packet data is allocated for the raw packet which
+	 * frees it. recordOffset is set to the offset of the record in the file
+	 * @return False at the end of the range, the end of the file or if the file is truncated
+	 */
+	bool getNextPacket(pcpp::RawPacket& rawPacket, uint64_t& recordOffset)
+	{
+		if (m_File == NULL || m_Offset >= m_EndOffset)
+			return false;
+
+		uint8_t recordHeader[16];
+		if (fread(recordHeader, 1, sizeof(recordHeader), m_File) != sizeof(recordHeader))
+			return false;
+
+		uint32_t capturedLength = toHost(readUint32(recordHeader + 8));
+		// a corrupted length, don't allocate gigabytes for it
+		if (capturedLength > 0x4000000)
+			return false;
+
+		uint8_t* packetData = new uint8_t[capturedLength > 0 ? capturedLength : 1];
+		if (fread(packetData, 1, capturedLength, m_File) != capturedLength)
+		{
+			delete[] packetData;
+			return false;
+		}
+
+		timespec timestamp;
+		timestamp.tv_sec = toHost(readUint32(recordHeader));
+		timestamp.tv_nsec = toHost(readUint32(recordHeader + 4)) * (m_NanoSecPrecision ? 1 : 1000);
+
+		recordOffset = m_Offset;
+		m_Offset += sizeof(recordHeader) + capturedLength;
+		rawPacket.setRawData(packetData, (int)capturedLength, timestamp, m_LinkType, (int)toHost(readUint32(recordHeader + 12)));
+		return true;
+	}
+
+	pcpp::LinkLayerType getLinkType() const { return m_LinkType; }
+
+	/**
+	 * @return The offset of the next packet record
+	 */
+	uint64_t getOffset() const { return m_Offset; }
+
+private:
+	FILE* m_File;
+	bool m_Swapped;
+	bool m_NanoSecPrecision;
+	pcpp::LinkLayerType m_LinkType;
+	uint64_t m_Offset;
+	uint64_t m_EndOffset;
+
+	static uint32_t readUint32(const uint8_t* data)
+	{
+		uint32_t result;
+		memcpy(&result, data, sizeof(result));
+		return result;
+	}
+
+	/**
+	 * Translate the LINKTYPE_ value of a pcap file header to this platform's DLT_ value like libpcap's pcap_datalink() does, so packets
+	 * and filters get the same link type as when the file is read with pcpp::PcapFileReaderDevice. Filters are compiled for DLT_ values
+	 * and libpcap rejects the LINKTYPE_ values below, which differ from the DLT_ values platforms assigned before LINKTYPE_ values existed
+	 */
+	static pcpp::LinkLayerType linkTypeToDlt(uint32_t linkType)
+	{
+		switch (linkType)
+		{
+		// LINKTYPE_ATM_RFC1483 -> DLT_ATM_RFC1483
+		case pcpp::LINKTYPE_ATM_RFC1483:
+			return (pcpp::LinkLayerType)11;
+		// LINKTYPE_RAW -> DLT_RAW
+		case pcpp::LINKTYPE_RAW:
+#if defined(__OpenBSD__)
+			return pcpp::LINKTYPE_DLT_RAW2;
+#else
+			return pcpp::LINKTYPE_DLT_RAW1;
+#endif
+		// LINKTYPE_SLIP_BSDOS -> DLT_SLIP_BSDOS and LINKTYPE_PPP_BSDOS -> DLT_PPP_BSDOS
+		case 102:
+#if defined(__NetBSD__) || defined(__FreeBSD__)
+			return (pcpp::LinkLayerType)13;
+#else
+			return (pcpp::LinkLayerType)15;
+#endif
+		case 103:
+#if defined(__NetBSD__) || defined(__FreeBSD__)
+			return (pcpp::LinkLayerType)14;
+#else
+			return (pcpp::LinkLayerType)16;
+#endif
+		// LINKTYPE_ATM_CLIP -> DLT_ATM_CLIP
+		case 106:
+			return (pcpp::LinkLayerType)19;
+#if defined(__OpenBSD__)
+		// LINKTYPE_LOOP -> DLT_LOOP, LINKTYPE_ENC -> DLT_ENC and LINKTYPE_PFSYNC -> DLT_PFSYNC
+		case pcpp::LINKTYPE_LOOP:
+			return (pcpp::LinkLayerType)12;
+		case 109:
+			return (pcpp::LinkLayerType)13;
+		case 246:
+			return (pcpp::LinkLayerType)18;
+#endif
+#if defined(__APPLE__)
+		// LINKTYPE_PKTAP -> DLT_PKTAP
+		case 258:
+			return pcpp::LINKTYPE_USER2;
+#endif
+		default:
+			return (pcpp::LinkLayerType)linkType;
+		}
+	}
+
+	uint32_t toHost(uint32_t value) const
+	{
+		if (!m_Swapped)
+			return value;
+		return ((value & 0xff) << 24) | ((value & 0xff00) << 8) | ((value >> 8) & 0xff00) | (value >> 24);
+	}
+
+	// disable copy
+	PcapChunkReader(const PcapChunkReader&);
+	PcapChunkReader& operator=(const PcapChunkReader&);
+};
@@ -0,0 +1,327 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <IpAddress.h>
+#include "FileSummary.h"
+
+/**
+ * Decides from a chunk summary (see FileSummary.h) whether any packet in the chunk may match a BPF search criteria, so chunks and files
+ * that can't match are skipped without being read.
+ * The analyzer understands a small part of the BPF syntax: 'and', 'or', 'not' (and '&&', '||', '!'), parentheses, and the primitives
+ * '[ip|ip6|arp|rarp] [src|dst] host ADDR', '[ip|ip6] [src|dst] net ADDR' without a mask, '[tcp|udp|sctp] [src|dst] port NUM' and the
+ * protocol names ip, ip6, arp, tcp, udp, sctp, icmp, icmp6, igmp, vlan, mpls. Anything else it doesn't understand is treated as "may match",
+ * so the analysis is always conservative: it never skips a chunk that contains a matching packet
+ */
+class SearchCriteriaAnalyzer
+{
+public:
+	SearchCriteriaAnalyzer() : m_Root(-1) {}
+
+	/**
+	 * Analyze a search criteria. The criteria is assumed to be a valid BPF filter (it's verified before), if the analyzer can't parse it
+	 * every chunk may match
+	 */
+	void analyze(const std::string& searchCriteria)
+	{
+		m_Nodes.clear();
+		m_Tokens.clear();
+		m_Root = -1;
+		tokenize(searchCriteria);
+		m_CurToken = 0;
+		m_LastPrimitive = -1;
+
+		int root = parseExpression();
+		if (root >= 0 && m_CurToken == m_Tokens.size())
+			m_Root = root;
+		else
+			m_Nodes.clear();
+	}
+
+	/**
+	 * @return False only if no packet in the chunk can match the search criteria
+	 */
+	bool mayMatch(const ChunkSummary& chunk) const
+	{
+		if (m_Root < 0 || chunk.numOfUnclassifiedPackets > 0)
+			return true;
+		if (chunk.numOfPackets == 0)
+			return false;
+
+		return evaluate(m_Root, chunk);
+	}
+
+private:
+	enum NodeType
+	{
+		AndNode,
+		OrNode,
+		// the summary can't tell if all packets contain something, so 'not' always may match
+		NotNode,
+		HostNode,
+		PortNode,
+		ProtocolNode,
+		UnknownNode
+	};
+
+	struct Node
+	{
+		NodeType type;
+		int left;
+		int right;
+		// the protocol of a protocol node, or the protocol a port must be of (NumOfSummaryProtocols for any)
+		SummaryProtocol protocol;
+		uint16_t port;
+		uint8_t address[16];
+		size_t addressLen;
+	};
+
+	std::vector<Node> m_Nodes;
+	int m_Root;
+	std::vector<std::string> m_Tokens;
+	size_t m_CurToken;
+	int m_LastPrimitive;
+
+	void tokenize(const std::string& str)
+	{
+		std::string token;
+		for (size_t i = 0; i <= str.length(); i++)
+		{
+			char c = (i < str.length() ? str[i] : ' ');
+			if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '(' || c == ')' || c == '!')
+			{
+				if (!token.empty())
+					m_Tokens.push_back(token);
+				token.clear();
+				// '!=' is a comparison, not a negation
+				if (c == '!' && i + 1 < str.length() && str[i + 1] == '=')
+				{
+					m_Tokens.push_back("!=");
+					i++;
+				}
+				else if (c == '(' || c == ')' || c == '!')
+					m_Tokens.push_back(std::string(1, c));
+				continue;
+			}
+
+			token += c;
+		}
+	}
+
+	bool isToken(const char* str) const { return m_CurToken < m_Tokens.size() && m_Tokens[m_CurToken] == str; }
+
+	bool isAnd() const { return isToken("and") || isToken("&&"); }
+
+	bool isOr() const { return isToken("or") || isToken("||"); }
+
+	int addNode(NodeType type, int left = -1, int right = -1)
+	{
+		Node node;
+		memset(&node, 0, sizeof(node));
+		node.type = type;
+		node.left = left;
+		node.right = right;
+		node.protocol = NumOfSummaryProtocols;
+		m_Nodes.push_back(node);
+		return (int)m_Nodes.size() - 1;
+	}
+
+	// 'and' and 'or' have the same precedence in BPF and associate left to right
+	int parseExpression()
+	{
+		int left = parseFactor();
+		while (left >= 0 && (isAnd() || isOr()))
+		{
+			NodeType type = (isAnd() ? AndNode : OrNode);
+			m_CurToken++;
+			int right = parseFactor();
+			if (right < 0)
+				return -1;
+			left = addNode(type, left, right);
+		}
+
+		return left;
+	}
+
+	int parseFactor()
+	{
+		if (m_CurToken >= m_Tokens.size())
+			return -1;
+
+		if (isToken("not") || isToken("!"))
+		{
+			m_CurToken++;
+			int operand = parseFactor();
+			return (operand < 0 ? -1 : addNode(NotNode, operand));
+		}
+
+		if (isToken("("))
+		{
+			m_CurToken++;
+			int expression = parseExpression();
+			if (expression < 0 || !isToken(")"))
+				return -1;
+			m_CurToken++;
+			return expression;
+		}
+
+		return parsePrimitive();
+	}
+
+	int parsePrimitive()
+	{
+		std::vector<std::string> words;
+		while (m_CurToken < m_Tokens.size() && !isToken("(") && !isToken(")"))
+		{
+			if (isAnd() || isOr())
+			{
+				// 'src or dst' and 'src and dst' are directions, not operators
+				if (words.empty() || !isDirection(words.back()) || m_CurToken + 1 >= m_Tokens.size() || !isDirection(m_Tokens[m_CurToken + 1]))
+					break;
+				m_CurToken += 2;
+				continue;
+			}
+
+			words.push_back(m_Tokens[m_CurToken++]);
+		}
+
+		// the and/or/not operators are handled above, a parenthesis here is part of an arithmetic expression
+		if (words.empty())
+			return -1;
+
+		return interpretPrimitive(words);
+	}
+
+	static bool isDirection(const std::string& word) { return word == "src" || word == "dst"; }
+
+	static bool parseAddress(const std::string& word, Node& node)
+	{
+		pcpp::IPv4Address ipv4(word);
+		if (word.find(':') == std::string::npos && ipv4.isValid())
+		{
+			memcpy(node.address, ipv4.toBytes(), 4);
+			node.addressLen = 4;
+			return true;
+		}
+
+		pcpp::IPv6Address ipv6(word);
+		if (word.find(':') != std::string::npos && ipv6.isValid())
+		{
+			memcpy(node.address, ipv6.toBytes(), 16);
+			node.addressLen = 16;
+			return true;
+		}
+
+		return false;
+	}
+
+	static bool parsePort(const std::string& word, uint16_t& port)
+	{
+		char* end = NULL;
+		long value = strtol(word.c_str(), &end, 10);
+		if (word.empty() || *end != '\0' || value < 0 || value > 65535)
+			return false;
+		port = (uint16_t)value;
+		return true;
+	}
+
+	static bool getProtocolByName(const std::string& word, SummaryProtocol& protocol)
+	{
+		static const char* names[NumOfSummaryProtocols] = { "ip", "ip6", "arp", "tcp", "udp", "sctp", "icmp", "icmp6", "igmp", "vlan", "mpls" };
+		for (int i = 0; i < NumOfSummaryProtocols; i++)
+		{
+			if (word == names[i])
+			{
+				protocol = (SummaryProtocol)i;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	int interpretPrimitive(const std::vector<std::string>& words)
+	{
+		int node = addNode(UnknownNode);
+		Node& primitive = m_Nodes[node];
+
+		size_t i = 0;
+		SummaryProtocol qualifier = NumOfSummaryProtocols;
+		bool hasQualifier = getProtocolByName(words[0], qualifier) || words[0] == "rarp";
+		if (hasQualifier)
+			i++;
+
+		// 'vlan [id]' and 'mpls [label]' require the protocol regardless of the id
+		if (hasQualifier && (qualifier == SummaryVlan || qualifier == SummaryMpls) && words.size() <= 2)
+		{
+			primitive.type = ProtocolNode;
+			primitive.protocol = qualifier;
+		}
+		else if (hasQualifier && words.size() == 1)
+		{
+			primitive.type = (words[0] == "rarp" ? UnknownNode : ProtocolNode);
+			primitive.protocol = qualifier;
+		}
+		else
+		{
+			if (i < words.size() && isDirection(words[i]))
+				i++;
+
+			bool isAddressQualifier = (!hasQualifier || qualifier == SummaryIPv4 || qualifier == SummaryIPv6 || qualifier == SummaryArp || words[0] == "rarp");
+			bool isPortQualifier = (!hasQualifier || qualifier == SummaryTcp || qualifier == SummaryUdp || qualifier == SummarySctp ||
+					qualifier == SummaryIPv4 || qualifier == SummaryIPv6);
+
+			if (i + 2 == words.size() && words[i] == "host" && isAddressQualifier && parseAddress(words[i + 1], primitive))
+				primitive.type = HostNode;
+			// a net without a mask is a host match
+			else if (i + 2 == words.size() && words[i] == "net" && isAddressQualifier && words[0] != "arp" && words[0] != "rarp" && parseAddress(words[i + 1], primitive))
+				primitive.type = HostNode;
+			else if (i + 1 == words.size() && isAddressQualifier && parseAddress(words[i], primitive))
+				primitive.type = HostNode;
+			else if (i + 2 == words.size() && words[i] == "port" && isPortQualifier && parsePort(words[i + 1], primitive.port))
+			{
+				primitive.type = PortNode;
+				if (qualifier == SummaryTcp || qualifier == SummaryUdp || qualifier == SummarySctp)
+					primitive.protocol = qualifier;
+			}
+			// 'host 1.1.1.1 or 2.2.2.2' and 'port 80 or 443' repeat the previous primitive's qualifiers
+			else if (i == 0 && words.size() == 1 && m_LastPrimitive >= 0)
+			{
+				Node previous = m_Nodes[m_LastPrimitive];
+				if (previous.type == HostNode && parseAddress(words[0], primitive))
+					primitive.type = HostNode;
+				else if (previous.type == PortNode && parsePort(words[0], primitive.port))
+				{
+					primitive.type = PortNode;
+					primitive.protocol = previous.protocol;
+				}
+			}
+		}
+
+		m_LastPrimitive = node;
+		return node;
+	}
+
+	bool evaluate(int nodeIndex, const ChunkSummary& chunk) const
+	{
+		const Node& node = m_Nodes[nodeIndex];
+		switch (node.type)
+		{
+		case AndNode:
+			return evaluate(node.left, chunk) && evaluate(node.right, chunk);
+		case OrNode:
+			return evaluate(node.left, chunk) || evaluate(node.right, chunk);
+		case HostNode:
+			return chunk.mayContainIpAddress(node.address, node.addressLen);
+		case PortNode:
+			if (node.protocol != NumOfSummaryProtocols && chunk.protocolCount[node.protocol] == 0)
+				return false;
+			return chunk.mayContainPort(node.port);
+		case ProtocolNode:
+			return chunk.protocolCount[node.protocol] > 0;
+		default:
+			return true;
+		}
+	}
+};
@@ -19,6 +19,14 @@
  * There are switches that allows the user to search only in the provided folder (without sub-directories), search user-defined file extensions (sometimes
  * pcap files have an extension which is not '.pcap'), and output or not output the detailed report
  *
+ * Files are searched by a pool of worker threads while the directories are still being walked. The number of files waiting to be searched is
+ * bounded so memory doesn't grow with the size of the directory tree.
+ * When the user asks to use file summaries (-i), a summary of each file is kept in a sidecar file next to it (see FileSummary.h). The summary
+ * is built the first time the file is searched and holds, for each chunk of the file, its time range, per-protocol packet counts, a Bloom filter
+ * of its IP addresses and a bitmap of its ports. In later searches chunks and files that can't match the search criteria (see
+ * SearchCriteriaAnalyzer.h) or the time range are skipped without being read, and the chunks of a pcap file that may match are searched in
+ * parallel by several workers.
+ *
  * For more details about modes of operation and parameters please run PcapSearch -h
  */
 
@@ -29,14 +37,20 @@
 #include <sys/stat.h>
 #include <dirent.h>
 #include <vector>
+#include <deque>
 #include <map>
+#include <pthread.h>
 #include <Logger.h>
 #include <PcapPlusPlusVersion.h>
 #include <SystemUtils.h>
 #include <RawPacket.h>
 #include <Packet.h>
 #include <PcapFileDevice.h>
+#include <PcapFilter.h>
 #include <getopt.h>
+#include "FileSummary.h"
+#include "SearchCriteriaAnalyzer.h"
+#include "PcapChunkReader.h"
 
 
 using namespace pcpp;
@@ -48,6 +62,11 @@ static struct option PcapSearchOptions[] =
 	{"search", required_argument, 0, 's'},
 	{"detailed-report", required_argument, 0, 'r'},
 	{"set-extensions", required_argument, 0, 'e'},
+	{"threads", required_argument, 0, 't'},
+	{"use-summaries", no_argument, 0, 'i'},
+	{"chunk-size", required_argument, 0, 'c'},
+	{"start-time", required_argument, 0, 'S'},
+	{"end-time", required_argument, 0, 'E'},
 	{"version", no_argument, 0, 'v'},
 	{"help", no_argument, 0, 'h'},
     {0, 0, 0, 0}
@@ -70,8 +89,103 @@ static struct option PcapSearchOptions[] =
 
 #define ERROR_STRING_LEN 500
 
+// above this size a worker stops buffering its part of the detailed report and writes it directly to the report file
+#define MAX_REPORT_BUFFER_SIZE (4 * 1024 * 1024)
+
+#define DEFAULT_CHUNK_SIZE_MB 64
+
 char errorString[ERROR_STRING_LEN];
 
+
+/**
+ * The parameters of a search, shared by all workers
+ */
+struct SearchParams
+{
+	std::string searchCriteria;
+	std::ofstream* detailedReportFile;
+	bool useSummaries;
+	uint64_t chunkSize;
+	// nanoseconds since epoch
+	uint64_t startTime;
+	uint64_t endTime;
+	SearchCriteriaAnalyzer analyzer;
+};
+
+
+/**
+ * A file being searched. It may be searched by several tasks (one per chunk), the last task to finish prints the result
+ */
+struct FileSearchState
+{
+	std::string path;
+	int numOfPendingTasks;
+	int packetsFound;
+};
+
+
+/**
+ * A task for a worker: either a whole file, or a chunk of a pcap file whose summary already exists
+ */
+struct SearchTask
+{
+	FileSearchState* file;
+	bool isChunk;
+	uint64_t startOffset;
+	uint64_t endOffset;
+};
+
+
+/**
+ * The state shared between the directory walker and the workers
+ */
+struct SearchContext
+{
+	const SearchParams* params;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t taskAvailable;
+	pthread_cond_t queueNotFull;
+	// files found by the directory walker. This queue is bounded by maxQueuedFiles
+	std::deque<SearchTask> fileTasks;
+	// chunks of files being searched. Workers take them before new files so files are completed as early as possible
+	std::deque<SearchTask> chunkTasks;
+	size_t maxQueuedFiles;
+	bool noMoreFiles;
+	int numOfBusyWorkers;
+
+	// libpcap's filter compiler isn't thread-safe in old versions
+	pthread_mutex_t filterCompileMutex;
+	pthread_mutex_t reportMutex;
+
+	int totalFilesSearched;
+	int totalFilesSkipped;
+	int totalChunksSkipped;
+	int totalPacketsFound;
+};
+
+
+/**
+ * A worker thread and the state it keeps between tasks
+ */
+struct SearchWorker
+{
+	SearchContext* context;
+	pthread_t thread;
+	BpfFilterWrapper filter;
+	// whether the search criteria was compiled for filterLinkType and whether it succeeded. A failure is kept so it isn't retried for
+	// every packet
+	bool isFilterCompiled;
+	bool isFilterSet;
+	LinkLayerType filterLinkType;
+	// the detailed report of the current task. When it grows too big the worker holds reportMutex and writes directly to the report file
+	std::ostringstream report;
+	bool isReportLocked;
+
+	SearchWorker() : context(NULL), isFilterCompiled(false), isFilterSet(false), filterLinkType(LINKTYPE_ETHERNET), isReportLocked(false) {}
+};
+
+
 /**
  * Print application usage
  */
@@ -79,7 +193,7 @@ void printUsage()
 {
 	printf("\nUsage:\n"
 			"-------\n"
-			"%s [-h] [-v] [-n] [-r file_name] [-e extension_list] -d directory -s search_criteria\n"
+			"%s [-h] [-v] [-n] [-i] [-r file_name] [-e extension_list] [-t num_of_threads] [-c chunk_size] [-S start_time] [-E end_time] -d directory -s search_criteria\n"
 			"\nOptions:\n\n"
 			"    -d directory        : Input directory\n"
 			"    -n                  : Don't include sub-directories (default is include them)\n"
@@ -88,8 +202,15 @@ void printUsage()
 			"    -r file_name        : Write a detailed search report to a file\n"
 			"    -e extension_list   : Set file extensions to search. The default is searching '.pcap' and '.pcapng' files.\n"
 			"                          extension_list should be a comma-separated list of extensions, for example: pcap,net,dmp\n"
+			"    -t num_of_threads   : Number of worker threads searching files. The default is the number of cores\n"
+			"    -i                  : Use file summaries to skip files and chunks that can't match the search criteria. A summary is\n"
+			"                          built the first time a file is searched and kept in a '.pcpp-summary' file next to it\n"
+			"    -c chunk_size       : The size in MB of the chunks pcap files are summarized and searched in parallel in when -i is\n"
+			"                          used. The default is %d. It applies to summaries built by this search\n"
+			"    -S start_time       : Match only packets captured at or after this time (seconds since epoch)\n"
+			"    -E end_time         : Match only packets captured at or before this time (seconds since epoch)\n"
 			"    -v                  : Displays the current version and exists\n"
-			"    -h                  : Displays this help message and exits\n", AppName::get().c_str());
+			"    -h                  : Displays this help message and exits\n", AppName::get().c_str(), DEFAULT_CHUNK_SIZE_MB);
 }
 
 
@@ -115,83 +236,312 @@ std::string getExtension(std::string fileName)
 
 
 /**
- * Searches all packet in a given pcap file for a certain search criteria. Returns how many packets matched the seatch criteria
+ * Parse a time given in seconds since epoch (may be fractional) to nanoseconds since epoch
  */
-int searchPcap(std::string pcapFilePath, std::string searchCriteria, std::ofstream* detailedReportFile)
+bool parseTime(const char* str, uint64_t& result)
 {
-	// create the pcap/pcap-ng reader
-	IFileReaderDevice* reader = IFileReaderDevice::getReader(pcapFilePath.c_str());
+	char* end = NULL;
+	double seconds = strtod(str, &end);
+	if (end == str || *end != '\0' || seconds < 0)
+		return false;
+
+	result = (uint64_t)(seconds * 1000000000.0);
+	return true;
+}
+
 
-	// if the reader fails to open
-	if (!reader->open())
+/**
+ * Flush the worker's buffered part of the detailed report. If the report is too big to keep buffering, lock the report file for the
+ * rest of the task so the task's section isn't interleaved with other tasks' sections
+ */
+void flushReport(SearchWorker& worker, bool endOfTask)
+{
+	if (worker.context->params->detailedReportFile == NULL)
+		return;
+
+	if (!endOfTask && !worker.isReportLocked && (size_t)worker.report.tellp() < MAX_REPORT_BUFFER_SIZE)
+		return;
+
+	if (!worker.isReportLocked)
 	{
-		if (detailedReportFile != NULL)
+		pthread_mutex_lock(&worker.context->reportMutex);
+		worker.isReportLocked = true;
+	}
+
+	(*worker.context->params->detailedReportFile) << worker.report.str();
+	worker.report.str("");
+
+	if (endOfTask)
+	{
+		worker.isReportLocked = false;
+		pthread_mutex_unlock(&worker.context->reportMutex);
+	}
+}
+
+
+/**
+ * Compile the search criteria for a link type unless the worker's filter was already compiled for it
+ * @return True if the worker's filter can match packets of this link type. Packets of a link type the search criteria can't be compiled
+ * for never match
+ */
+bool setWorkerFilter(SearchWorker& worker, LinkLayerType linkType)
+{
+	if (worker.isFilterCompiled && worker.filterLinkType == linkType)
+		return worker.isFilterSet;
+
+	pthread_mutex_lock(&worker.context->filterCompileMutex);
+	worker.isFilterSet = worker.filter.setFilter(worker.context->params->searchCriteria, linkType);
+	pthread_mutex_unlock(&worker.context->filterCompileMutex);
+	worker.isFilterCompiled = true;
+	worker.filterLinkType = linkType;
+	return worker.isFilterSet;
+}
+
+
+/**
+ * Write to the detailed report that a file isn't searched because the search criteria can't be compiled for its link type
+ */
+void reportFilterError(SearchWorker& worker, const std::string& filePath, LinkLayerType linkType)
+{
+	if (worker.context->params->detailedReportFile != NULL)
+	{
+		worker.report << "File '" << filePath << "':" << std::endl;
+		worker.report << "    Search criteria can't be compiled for link type " << (int)linkType << std::endl << std::endl;
+	}
+	flushReport(worker, true);
+}
+
+
+/**
+ * Match a packet with the search criteria and the time range, and write it to the detailed report if it matches. If a summary chunk is
+ * given the packet is added to it
+ */
+bool searchPacket(SearchWorker& worker, RawPacket& rawPacket, ChunkSummary* summaryChunk)
+{
+	const SearchParams* params = worker.context->params;
+
+	// the filter is compiled for the link type of the file, which is usually the same for all packets
+	bool isFilterSet = setWorkerFilter(worker, rawPacket.getLinkLayerType());
+
+	Packet* parsedPacket = NULL;
+	if (summaryChunk != NULL)
+	{
+		parsedPacket = new Packet(&rawPacket);
+		summaryChunk->addPacket(*parsedPacket);
+	}
+
+	timespec timestamp = rawPacket.getPacketTimeStamp();
+	uint64_t packetTime = (uint64_t)timestamp.tv_sec * 1000000000ULL + (uint64_t)timestamp.tv_nsec;
+	bool isMatch = (isFilterSet && packetTime >= params->startTime && packetTime <= params->endTime && worker.filter.matchPacketWithFilter(&rawPacket));
+
+	// if a detailed report is required, parse the packet and print it to the report
+	if (isMatch && params->detailedReportFile != NULL)
+	{
+		if (parsedPacket == NULL)
+			parsedPacket = new Packet(&rawPacket);
+
+		// print layer by layer by layer as we want to add a few spaces before each layer
+		std::vector<std::string> packetLayers;
+		parsedPacket->toStringList(packetLayers);
+		for (std::vector<std::string>::iterator iter = packetLayers.begin(); iter != packetLayers.end(); iter++)
+			worker.report << "\n    " << (*iter);
+		worker.report << std::endl;
+		flushReport(worker, false);
+	}
+
+	delete parsedPacket;
+	return isMatch;
+}
+
+
+/**
+ * Count the packets a task found in a file. The last task of the file prints how many packets were found in it
+ */
+void finishTask(SearchContext* context, FileSearchState* file, int packetsFound)
+{
+	pthread_mutex_lock(&context->mutex);
+
+	file->packetsFound += packetsFound;
+	file->numOfPendingTasks--;
+	if (file->numOfPendingTasks == 0)
+	{
+		context->totalFilesSearched++;
+		if (file->packetsFound > 0)
 		{
-			// PcapPlusPlus writes the error to the error string variable we set it to write to
-			// write this error to the report file
-			(*detailedReportFile) << "File '" << pcapFilePath << "':" << std::endl;
-			(*detailedReportFile) << "    ";
-			std::string errorStr = errorString;
-			(*detailedReportFile) << errorStr << std::endl;
+			printf("%d packets found in '%s'\n", file->packetsFound, file->path.c_str());
+			context->totalPacketsFound += file->packetsFound;
 		}
+		delete file;
+	}
 
-		// free the reader memory and return
-		delete reader;
+	pthread_mutex_unlock(&context->mutex);
+}
+
+
+/**
+ * Search a chunk of a pcap file. Returns how many packets matched the search criteria
+ */
+int searchChunk(SearchWorker& worker, const SearchTask& task)
+{
+	const SearchParams* params = worker.context->params;
+	if (params->detailedReportFile != NULL)
+		worker.report << "File '" << task.file->path << "', bytes " << task.startOffset << "-" << task.endOffset << ":" << std::endl;
+
+	int packetCount = 0;
+	PcapChunkReader reader;
+	if (!reader.open(task.file->path) || !reader.setRange(task.startOffset, task.endOffset))
+	{
+		if (params->detailedReportFile != NULL)
+			worker.report << "    Cannot read file" << std::endl << std::endl;
+		flushReport(worker, true);
 		return 0;
 	}
 
-	// set the filter for the file so only packets that match the search criteria will be read
-	if (!reader->setFilter(searchCriteria))
+	if (!setWorkerFilter(worker, reader.getLinkType()))
 	{
-		// free the reader memory and return
-		delete reader;
+		if (params->detailedReportFile != NULL)
+			worker.report << "    Search criteria can't be compiled for link type " << (int)reader.getLinkType() << std::endl << std::endl;
+		flushReport(worker, true);
 		return 0;
 	}
 
-	if (detailedReportFile != NULL)
+	RawPacket rawPacket;
+	uint64_t recordOffset;
+	while (reader.getNextPacket(rawPacket, recordOffset))
 	{
-		(*detailedReportFile) << "File '" << pcapFilePath << "':" << std::endl;
+		if (searchPacket(worker, rawPacket, NULL))
+			packetCount++;
+	}
+
+	if (params->detailedReportFile != NULL)
+	{
+		if (packetCount > 0)
+			worker.report << "\n";
+		worker.report << "    ----> Found " << packetCount << " packets" << std::endl << std::endl;
 	}
+	flushReport(worker, true);
 
+	return packetCount;
+}
+
+
+/**
+ * Searches all packet in a given pcap file for a certain search criteria. Returns how many packets matched the seatch criteria.
+ * If a summary is given it's filled with the file's summary
+ */
+int searchPcap(SearchWorker& worker, const std::string& pcapFilePath, FileSummary* summary)
+{
+	const SearchParams* params = worker.context->params;
 	int packetCount = 0;
 	RawPacket rawPacket;
 
-	// read packets from the file. Since we already set the filter, only packets that matches the filter will be read
-	while (reader->getNextPacket(rawPacket))
+	// pcap files are read with PcapChunkReader so their summary can record where each chunk starts
+	PcapChunkReader chunkReader;
+	if (chunkReader.open(pcapFilePath))
 	{
-		// if a detailed report is required, parse the packet and print it to the report file
-		if (detailedReportFile != NULL)
+		// a file the search criteria can't be compiled for isn't searched (and isn't summarized)
+		if (!setWorkerFilter(worker, chunkReader.getLinkType()))
 		{
-			// parse the packet
-			Packet parsedPacket(&rawPacket);
-
-			// print layer by layer by layer as we want to add a few spaces before each layer
-			std::vector<std::string> packetLayers;
-			parsedPacket.toStringList(packetLayers);
-			for (std::vector<std::string>::iterator iter = packetLayers.begin(); iter != packetLayers.end(); iter++)
-				(*detailedReportFile) << "\n    " << (*iter);
-			(*detailedReportFile) << std::endl;
+			reportFilterError(worker, pcapFilePath, chunkReader.getLinkType());
+			return 0;
+		}
+
+		if (params->detailedReportFile != NULL)
+			worker.report << "File '" << pcapFilePath << "':" << std::endl;
+
+		ChunkSummary* summaryChunk = NULL;
+		uint64_t recordOffset;
+		while (chunkReader.getNextPacket(rawPacket, recordOffset))
+		{
+			if (summary != NULL && (summaryChunk == NULL || recordOffset - summaryChunk->startOffset >= params->chunkSize))
+			{
+				if (summaryChunk != NULL)
+					summaryChunk->endOffset = recordOffset;
+				summary->chunks.push_back(ChunkSummary());
+				summaryChunk = &summary->chunks.back();
+				summaryChunk->startOffset = recordOffset;
+			}
+
+			if (searchPacket(worker, rawPacket, summaryChunk))
+				packetCount++;
 		}
 
-		// count the packet read
-		packetCount++;
+		if (summaryChunk != NULL)
+			summaryChunk->endOffset = chunkReader.getOffset();
+		if (summary != NULL)
+			summary->isChunked = true;
 	}
+	else
+	{
+		// create the pcap/pcap-ng reader
+		IFileReaderDevice* reader = IFileReaderDevice::getReader(pcapFilePath.c_str());
+
+		// if the reader fails to open
+		if (!reader->open())
+		{
+			if (params->detailedReportFile != NULL)
+			{
+				// PcapPlusPlus writes the error to the error string variable we set it to write to
+				// write this error to the report file
+				worker.report << "File '" << pcapFilePath << "':" << std::endl;
+				worker.report << "    ";
+				std::string errorStr = errorString;
+				worker.report << errorStr << std::endl;
+			}
+			flushReport(worker, true);
 
-	// close the reader file
-	reader->close();
+			// free the reader memory and return
+			delete reader;
+			if (summary != NULL)
+				summary->chunks.clear();
+			return 0;
+		}
+
+		// a pcap file has a single link type, a file the search criteria can't be compiled for isn't searched. The packets of pcap-ng
+		// interfaces the search criteria can't be compiled for don't match
+		PcapFileReaderDevice* pcapReader = dynamic_cast<PcapFileReaderDevice*>(reader);
+		if (pcapReader != NULL && !setWorkerFilter(worker, pcapReader->getLinkLayerType()))
+		{
+			reportFilterError(worker, pcapFilePath, pcapReader->getLinkLayerType());
+			reader->close();
+			delete reader;
+			return 0;
+		}
+
+		if (params->detailedReportFile != NULL)
+			worker.report << "File '" << pcapFilePath << "':" << std::endl;
+
+		// pcap-ng files can't be read from the middle, their summary has a single chunk
+		ChunkSummary* summaryChunk = NULL;
+		if (summary != NULL)
+		{
+			summary->isChunked = false;
+			summary->chunks.push_back(ChunkSummary());
+			summaryChunk = &summary->chunks.back();
+		}
+
+		while (reader->getNextPacket(rawPacket))
+		{
+			if (searchPacket(worker, rawPacket, summaryChunk))
+				packetCount++;
+		}
+
+		// close the reader file
+		reader->close();
+
+		// free the reader memory
+		delete reader;
+	}
 
 	// finalize the report
-	if (detailedReportFile != NULL)
+	if (params->detailedReportFile != NULL)
 	{
 		if (packetCount > 0)
-			(*detailedReportFile) << "\n";
-
-		(*detailedReportFile) << "    ----> Found " << packetCount << " packets" << std::endl << std::endl;
+			worker.report << "\n";
 
+		worker.report << "    ----> Found " << packetCount << " packets" << std::endl << std::endl;
 	}
-
-	// free the reader memory
-	delete reader;
+	flushReport(worker, true);
 
 	// return how many packets matched the search criteria
 	return packetCount;
@@ -199,17 +549,160 @@ int searchPcap(std::string pcapFilePath, std::string searchCriteria, std::ofstre
 
 
 /**
- * Searches all pcap files in given directory (and sub-directories if directed by the user) and output how many packets in each file matches a given
- * search criteria. This method outputs how many directories were searched, how many files were searched and how many packets were matched
+ * Search a file, using its summary if the user asked for it. If the summary exists, chunks that may match are searched by other
+ * workers too; otherwise the file is searched whole and its summary is built while searching
+ */
+void searchFile(SearchWorker& worker, FileSearchState* file)
+{
+	SearchContext* context = worker.context;
+	const SearchParams* params = context->params;
+
+	struct stat info;
+	bool useSummary = (params->useSummaries && stat(file->path.c_str(), &info) == 0);
+	FileSummary summary;
+	if (!useSummary || !summary.read(file->path, (uint64_t)info.st_size, (int64_t)info.st_mtime))
+	{
+		int packetsFound = searchPcap(worker, file->path, useSummary ? &summary : NULL);
+		if (useSummary && !summary.chunks.empty() && !summary.write(file->path, (uint64_t)info.st_size, (int64_t)info.st_mtime))
+			printf("Cannot write summary of '%s'\n", file->path.c_str());
+		finishTask(context, file, packetsFound);
+		return;
+	}
+
+	std::vector<SearchTask> tasks;
+	for (std::vector<ChunkSummary>::iterator iter = summary.chunks.begin(); iter != summary.chunks.end(); iter++)
+	{
+		if (iter->maxTimestamp < params->startTime || iter->minTimestamp > params->endTime || !params->analyzer.mayMatch(*iter))
+			continue;
+
+		SearchTask task = { file, true, iter->startOffset, iter->endOffset };
+		tasks.push_back(task);
+	}
+
+	pthread_mutex_lock(&context->mutex);
+	context->totalChunksSkipped += (int)(summary.chunks.size() - tasks.size());
+	if (tasks.empty())
+		context->totalFilesSkipped++;
+	pthread_mutex_unlock(&context->mutex);
+
+	if (tasks.empty())
+	{
+		finishTask(context, file, 0);
+		return;
+	}
+
+	if (!summary.isChunked)
+	{
+		finishTask(context, file, searchPcap(worker, file->path, NULL));
+		return;
+	}
+
+	// the search criteria is compiled for the file's link type before any chunk is handed to other workers, the file isn't searched if
+	// it can't be compiled
+	PcapChunkReader reader;
+	if (reader.open(file->path) && !setWorkerFilter(worker, reader.getLinkType()))
+	{
+		reportFilterError(worker, file->path, reader.getLinkType());
+		finishTask(context, file, 0);
+		return;
+	}
+	reader.close();
+
+	// let other workers search the rest of the chunks while this one searches the first
+	if (tasks.size() > 1)
+	{
+		pthread_mutex_lock(&context->mutex);
+		file->numOfPendingTasks += (int)tasks.size() - 1;
+		context->chunkTasks.insert(context->chunkTasks.end(), tasks.begin() + 1, tasks.end());
+		pthread_cond_broadcast(&context->taskAvailable);
+		pthread_mutex_unlock(&context->mutex);
+	}
+
+	finishTask(context, file, searchChunk(worker, tasks[0]));
+}
+
+
+/**
+ * The main loop of a worker thread: take chunks and files from the queues until the directory walk is over and all tasks are done
+ */
+void* searchWorkerThread(void* arg)
+{
+	SearchWorker& worker = *(SearchWorker*)arg;
+	SearchContext* context = worker.context;
+
+	pthread_mutex_lock(&context->mutex);
+	while (true)
+	{
+		// a busy worker may still add chunk tasks, so wait for it even if the directory walk is over
+		while (context->chunkTasks.empty() && context->fileTasks.empty() && !(context->noMoreFiles && context->numOfBusyWorkers == 0))
+			pthread_cond_wait(&context->taskAvailable, &context->mutex);
+
+		if (context->chunkTasks.empty() && context->fileTasks.empty())
+			break;
+
+		SearchTask task;
+		if (!context->chunkTasks.empty())
+		{
+			task = context->chunkTasks.front();
+			context->chunkTasks.pop_front();
+		}
+		else
+		{
+			task = context->fileTasks.front();
+			context->fileTasks.pop_front();
+			pthread_cond_signal(&context->queueNotFull);
+		}
+
+		context->numOfBusyWorkers++;
+		pthread_mutex_unlock(&context->mutex);
+
+		if (task.isChunk)
+			finishTask(context, task.file, searchChunk(worker, task));
+		else
+			searchFile(worker, task.file);
+
+		pthread_mutex_lock(&context->mutex);
+		context->numOfBusyWorkers--;
+	}
+
+	// wake up the other workers so they see there's nothing left to do
+	pthread_cond_broadcast(&context->taskAvailable);
+	pthread_mutex_unlock(&context->mutex);
+	return NULL;
+}
+
+
+/**
+ * Add a file to the queue of files to search. Blocks while the queue is full
  */
-void searchtDirectories(std::string directory, bool includeSubDirectories, std::string searchCriteria, std::ofstream* detailedReportFile,
-		std::map<std::string, bool> extensionsToSearch,
-		int& totalDirSearched, int& totalFilesSearched, int& totalPacketsFound)
+void addFileTask(SearchContext* context, const std::string& filePath)
+{
+	FileSearchState* file = new FileSearchState();
+	file->path = filePath;
+	file->numOfPendingTasks = 1;
+	file->packetsFound = 0;
+	SearchTask task = { file, false, 0, 0 };
+
+	pthread_mutex_lock(&context->mutex);
+	while (context->fileTasks.size() >= context->maxQueuedFiles)
+		pthread_cond_wait(&context->queueNotFull, &context->mutex);
+	context->fileTasks.push_back(task);
+	pthread_cond_signal(&context->taskAvailable);
+	pthread_mutex_unlock(&context->mutex);
+}
+
+
+/**
+ * Walks a given directory (and sub-directories if directed by the user) and adds all pcap files in it to the queue of files to search.
+ * This method counts how many directories were searched
+ */
+void searchtDirectories(std::string directory, bool includeSubDirectories, SearchContext* context,
+		std::map<std::string, bool> extensionsToSearch, int& totalDirSearched)
 {
     // open the directory
     DIR *dir = opendir(directory.c_str());
 
-    // dir is null usually when user has no access permissions 
+    // dir is null usually when user has no access permissions
     if (dir == NULL)
         return;
 
@@ -228,7 +721,7 @@ void searchtDirectories(std::string directory, bool includeSubDirectories, std::
     	if (0 != directory.compare(directory.length() - dirSep.length(), dirSep.length(), dirSep)) // directory doesn't contain separator in the end
     	    dirPath += DIR_SEPARATOR;
     	dirPath += name;
-    	
+
 	struct stat info;
 
     	// get file attributes
@@ -259,7 +752,7 @@ void searchtDirectories(std::string directory, bool includeSubDirectories, std::
     	// if we got to here it means the file is actually a directory. If required to search sub-directories, call this method recursively to search
     	// inside this sub-directory
         if (includeSubDirectories)
-        	searchtDirectories(dirPath, true, searchCriteria, detailedReportFile, extensionsToSearch, totalDirSearched, totalFilesSearched, totalPacketsFound);
+        	searchtDirectories(dirPath, true, context, extensionsToSearch, totalDirSearched);
 
         // move to the next file
         entry = readdir(dir);
@@ -271,21 +764,9 @@ void searchtDirectories(std::string directory, bool includeSubDirectories, std::
     totalDirSearched++;
 
     // when we get to here we already covered all sub-directories and collected all the files in this directory that are required for search
-    // go over each such file and search its packets to find the search criteria
+    // hand each such file to the workers
     for (std::vector<std::string>::iterator iter = pcapList.begin(); iter != pcapList.end(); iter++)
-    {
-    	// do the actual search
-    	int packetsFound = searchPcap(*iter, searchCriteria, detailedReportFile);
-
-    	// add to total matched packets
-    	totalFilesSearched++;
-    	if (packetsFound > 0)
-    	{
-    		printf("%d packets found in '%s'\n", packetsFound, iter->c_str());
-    		totalPacketsFound += packetsFound;
-    	}
-    }
-
+    	addFileTask(context, *iter);
 }
 
 
@@ -299,12 +780,19 @@ int main(int argc, char* argv[])
 
 	std::string inputDirectory = "";
 
-	std::string searchCriteria = "";
+	SearchParams params;
+	params.detailedReportFile = NULL;
+	params.useSummaries = false;
+	params.chunkSize = DEFAULT_CHUNK_SIZE_MB * 1024 * 1024;
+	params.startTime = 0;
+	params.endTime = (uint64_t)-1;
 
 	bool includeSubDirectories = true;
 
 	std::string detailedReportFileName = "";
 
+	int numOfThreads = getNumOfCores();
+
 	std::map<std::string, bool> extensionsToSearch;
 
 	// the default (unless set otherwise) is to search in '.pcap' and '.pcapng' extensions
@@ -314,7 +802,7 @@ int main(int argc, char* argv[])
 	int optionIndex = 0;
 	char opt = 0;
 
-	while((opt = getopt_long (argc, argv, "d:s:r:e:hvn", PcapSearchOptions, &optionIndex)) != -1)
+	while((opt = getopt_long (argc, argv, "d:s:r:e:t:ic:S:E:hvn", PcapSearchOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -327,7 +815,7 @@ int main(int argc, char* argv[])
 				includeSubDirectories = false;
 				break;
 			case 's':
-				searchCriteria = optarg;
+				params.searchCriteria = optarg;
 				break;
 			case 'r':
 				detailedReportFileName = optarg;
@@ -354,6 +842,35 @@ int main(int argc, char* argv[])
 				}
 				break;
 			}
+			case 't':
+				numOfThreads = atoi(optarg);
+				if (numOfThreads <= 0)
+				{
+					EXIT_WITH_ERROR("Number of threads must be a positive number");
+				}
+				break;
+			case 'i':
+				params.useSummaries = true;
+				break;
+			case 'c':
+				if (atoi(optarg) <= 0)
+				{
+					EXIT_WITH_ERROR("Chunk size must be a positive number");
+				}
+				params.chunkSize = (uint64_t)atoi(optarg) * 1024 * 1024;
+				break;
+			case 'S':
+				if (!parseTime(optarg, params.startTime))
+				{
+					EXIT_WITH_ERROR("Couldn't parse start time");
+				}
+				break;
+			case 'E':
+				if (!parseTime(optarg, params.endTime))
+				{
+					EXIT_WITH_ERROR("Couldn't parse end time");
+				}
+				break;
 			case 'h':
 				printUsage();
 				exit(0);
@@ -371,31 +888,38 @@ int main(int argc, char* argv[])
 		EXIT_WITH_ERROR("Input directory was not given");
 	}
 
-	if (searchCriteria == "")
+	if (params.searchCriteria == "")
 	{
 		EXIT_WITH_ERROR("Search criteria was not given");
 	}
 
+	if (params.startTime > params.endTime)
+	{
+		EXIT_WITH_ERROR("Start time is after end time");
+	}
+
 	DIR *dir = opendir(inputDirectory.c_str());
 	if (dir == NULL)
 	{
 		EXIT_WITH_ERROR("Cannot find or open input directory");
 	}
+	closedir(dir);
 
 	// verify the search criteria is a valid BPF filter
-	BPFStringFilter filter(searchCriteria);
+	BPFStringFilter filter(params.searchCriteria);
 	if(!filter.verifyFilter())
 	{
 		EXIT_WITH_ERROR("Search criteria isn't valid");
 	}
 
+	params.analyzer.analyze(params.searchCriteria);
+
 	// open the detailed report file if requested by the user
-	std::ofstream* detailedReportFile = NULL;
 	if (detailedReportFileName != "")
 	{
-		detailedReportFile = new std::ofstream();
-		detailedReportFile->open(detailedReportFileName.c_str());
-		if (detailedReportFile->fail())
+		params.detailedReportFile = new std::ofstream();
+		params.detailedReportFile->open(detailedReportFileName.c_str());
+		if (params.detailedReportFile->fail())
 		{
 			EXIT_WITH_ERROR("Couldn't open detailed report file '%s' for writing", detailedReportFileName.c_str());
 		}
@@ -405,23 +929,71 @@ int main(int argc, char* argv[])
 		pcpp::LoggerPP::getInstance().setErrorString(errorString, ERROR_STRING_LEN);
 	}
 
+	SearchContext context;
+	context.params = &params;
+	pthread_mutex_init(&context.mutex, NULL);
+	pthread_cond_init(&context.taskAvailable, NULL);
+	pthread_cond_init(&context.queueNotFull, NULL);
+	pthread_mutex_init(&context.filterCompileMutex, NULL);
+	pthread_mutex_init(&context.reportMutex, NULL);
+	context.maxQueuedFiles = (size_t)numOfThreads * 2;
+	context.noMoreFiles = false;
+	context.numOfBusyWorkers = 0;
+	context.totalFilesSearched = 0;
+	context.totalFilesSkipped = 0;
+	context.totalChunksSkipped = 0;
+	context.totalPacketsFound = 0;
 
 	printf("Searching...\n");
-	int totalDirSearched = 0;
-	int totalFilesSearched = 0;
-	int totalPacketsFound = 0;
+
+	std::vector<SearchWorker*> workers;
+	for (int i = 0; i < numOfThreads; i++)
+	{
+		SearchWorker* worker = new SearchWorker();
+		worker->context = &context;
+		if (pthread_create(&worker->thread, NULL, searchWorkerThread, worker) != 0)
+		{
+			delete worker;
+			if (workers.empty())
+			{
+				EXIT_WITH_ERROR("Couldn't create worker threads");
+			}
+			break;
+		}
+		workers.push_back(worker);
+	}
 
 	// the main call - start searching!
-	searchtDirectories(inputDirectory, includeSubDirectories, searchCriteria, detailedReportFile, extensionsToSearch, totalDirSearched, totalFilesSearched, totalPacketsFound);
+	int totalDirSearched = 0;
+	searchtDirectories(inputDirectory, includeSubDirectories, &context, extensionsToSearch, totalDirSearched);
+
+	pthread_mutex_lock(&context.mutex);
+	context.noMoreFiles = true;
+	pthread_cond_broadcast(&context.taskAvailable);
+	pthread_mutex_unlock(&context.mutex);
+
+	for (std::vector<SearchWorker*>::iterator iter = workers.begin(); iter != workers.end(); iter++)
+	{
+		pthread_join((*iter)->thread, NULL);
+		delete (*iter);
+	}
+
+	pthread_mutex_destroy(&context.mutex);
+	pthread_cond_destroy(&context.taskAvailable);
+	pthread_cond_destroy(&context.queueNotFull);
+	pthread_mutex_destroy(&context.filterCompileMutex);
+	pthread_mutex_destroy(&context.reportMutex);
 
 	// after search is done, close the report file and delete its instance
-	printf("\n\nDone! Searched %d files in %d directories, %d packets were matched to search criteria\n", totalFilesSearched, totalDirSearched, totalPacketsFound);
-	if (detailedReportFile != NULL)
+	printf("\n\nDone! Searched %d files in %d directories, %d packets were matched to search criteria\n", context.totalFilesSearched, totalDirSearched, context.totalPacketsFound);
+	if (params.useSummaries)
+		printf("File summaries ruled out %d files and %d chunks\n", context.totalFilesSkipped, context.totalChunksSkipped);
+	if (params.detailedReportFile != NULL)
 	{
-		if (detailedReportFile->is_open())
-			detailedReportFile->close();
+		if (params.detailedReportFile->is_open())
+			params.detailedReportFile->close();
 
-		delete detailedReportFile;
+		delete params.detailedReportFile;
 		printf("Detailed report written to '%s'\n", detailedReportFileName.c_str());
 	}
 
@@ -27,20 +27,15 @@ public:
 		// hash the 2-tuple and look for it in the flow table
 		uint32_t hash = pcpp::hash2Tuple(&packet);
 
-		// if flow isn't found in the flow table
-		if (m_FlowTable.find(hash) == m_FlowTable.end())
-		{
-			// create a new entry and get a new file number for it
-			m_FlowTable[hash] = getNextFileNumber(filesToClose);
-		}
-		else // flow is found in the 2-tuple flow table
-		{
-			// indicate file is being written because this file may not be in the LRU list (and hence closed),
-			// so we need to put it there, open it, and maybe close another file
-			writingToFile(m_FlowTable[hash], filesToClose);
-		}
-
-		return m_FlowTable[hash];
+		// if flow is found in the 2-tuple flow table, follow its file number
+		int* fileNum = m_FlowTable.find(hash);
+		if (fileNum != NULL)
+			return *fileNum;
+
+		// create a new entry and get a new file number for it
+		int nextFile = getNextFileNumber();
+		m_FlowTable.insert(hash) = nextFile;
+		return nextFile;
 	}
 };
 
@@ -58,7 +53,7 @@ private:
 
 	// a flow table for saving TCP state per flow. Currently the only data that is saved is whether
 	// the last packet seen on the flow was a TCP SYN packet
-	std::map<uint32_t, bool> m_TcpFlowTable;
+	SplitterHashTable<bool> m_TcpFlowTable;
 
 	/**
 	 * A utility method that takes a packet and returns true if it's a TCP SYN packet
@@ -96,53 +91,52 @@ public:
 	{
 		// hash the 5-tuple and look for it in the flow table
 		uint32_t hash = pcpp::hash5Tuple(&packet);
+		bool isTcp = packet.isPacketOfType(pcpp::TCP);
+
+		int* fileNum = m_FlowTable.find(hash);
 
 		// if flow isn't found in the flow table
-		if (m_FlowTable.find(hash) == m_FlowTable.end())
+		if (fileNum == NULL)
 		{
 			// create a new entry and get a new file number for it
-			m_FlowTable[hash] = getNextFileNumber(filesToClose);
+			int nextFile = getNextFileNumber();
+			m_FlowTable.insert(hash) = nextFile;
 
 			// if this is s a TCP packet check whether it's a SYN packet
 			// and save this data in the TCP flow table
-			if (packet.isPacketOfType(pcpp::TCP))
+			if (isTcp)
 			{
-				m_TcpFlowTable[hash] = isTcpSyn(packet);
+				bool* lastWasSyn = m_TcpFlowTable.find(hash);
+				if (lastWasSyn == NULL)
+					lastWasSyn = &m_TcpFlowTable.insert(hash);
+				*lastWasSyn = isTcpSyn(packet);
 			}
+
+			return nextFile;
 		}
-		else // flow is found in the flow table
+
+		// flow is found in the flow table
+		if (isTcp)
 		{
-			if (packet.isPacketOfType(pcpp::TCP))
+			// if this is a TCP flow, check if this is a SYN packet
+			bool isSyn = isTcpSyn(packet);
+			bool* lastWasSyn = m_TcpFlowTable.find(hash);
+
+			// if this is a SYN packet it means this is a beginning of a new flow
+			//(with the same 5-tuple as the previous one), so assign a new file number to it.
+			// unless the last packet was also SYN, which is an indication of SYN retransmission.
+			// In this case don't assign a new file number
+			if (isSyn && lastWasSyn != NULL && *lastWasSyn == false)
 			{
-				// if this is a TCP flow, check if this is a SYN packet
-				bool isSyn = isTcpSyn(packet);
-
-				// if this is a SYN packet it means this is a beginning of a new flow
-				//(with the same 5-tuple as the previous one), so assign a new file number to it.
-				// unless the last packet was also SYN, which is an indication of SYN retransmission.
-				// In this case don't assign a new file number
-				if (isSyn && m_TcpFlowTable.find(hash) != m_TcpFlowTable.end() && m_TcpFlowTable[hash] == false)
-				{
-					m_FlowTable[hash] = getNextFileNumber(filesToClose);
-				}
-				else
-				{
-					// indicate file is being written because this file may not be in the LRU list (and hence closed),
-					// so we need to put it there, open it, and maybe close another file
-					writingToFile(m_FlowTable[hash], filesToClose);
-				}
-
-				// update the TCP flow table
-				m_TcpFlowTable[hash] = isSyn;
-			}
-			else
-			{
-				// indicate file is being written because this file may not be in the LRU list (and hence closed),
-				// so we need to put it there, open it, and maybe close another file
-				writingToFile(m_FlowTable[hash], filesToClose);
+				*fileNum = getNextFileNumber();
 			}
+
+			// update the TCP flow table
+			if (lastWasSyn == NULL)
+				lastWasSyn = &m_TcpFlowTable.insert(hash);
+			*lastWasSyn = isSyn;
 		}
 
-		return m_FlowTable[hash];
+		return *fileNum;
 	}
 };
@@ -36,13 +36,10 @@ public:
 		// hash the 5-tuple and look for it in the flow table
 		uint32_t hash = pcpp::hash5Tuple(&packet);
 
-		if (m_FlowTable.find(hash) != m_FlowTable.end())
-		{
-			writingToFile(m_FlowTable[hash], filesToClose);
-
-			// if found it, follow the file number written in the hash record
-			return m_FlowTable[hash];
-		}
+		// if found it, follow the file number written in the hash record
+		int* fileNum = m_FlowTable.find(hash);
+		if (fileNum != NULL)
+			return *fileNum;
 
 		// if it's the first packet seen on this flow, try to guess the server port
 
@@ -60,21 +57,18 @@ public:
 					// SYN packet
 					if (!tcpLayer->getTcpHeader()->ackFlag)
 					{
-						m_FlowTable[hash] = getFileNumberForValue(getValue(packet, SYN, srcPort, dstPort), filesToClose);
-						return m_FlowTable[hash];
+						return addFlow(hash, getValue(packet, SYN, srcPort, dstPort));
 					}
 					// SYN/ACK packet
 					else
 					{
-						m_FlowTable[hash] = getFileNumberForValue(getValue(packet, SYN_ACK, srcPort, dstPort), filesToClose);
-						return m_FlowTable[hash];
+						return addFlow(hash, getValue(packet, SYN_ACK, srcPort, dstPort));
 					}
 				}
 				// Other TCP packet
 				else
 				{
-					m_FlowTable[hash] = getFileNumberForValue(getValue(packet, TCP_OTHER, srcPort, dstPort), filesToClose);
-					return m_FlowTable[hash];
+					return addFlow(hash, getValue(packet, TCP_OTHER, srcPort, dstPort));
 				}
 			}
 		}
@@ -87,13 +81,11 @@ public:
 			{
 				uint16_t srcPort = pcpp::netToHost16(udpLayer->getUdpHeader()->portSrc);
 				uint16_t dstPort = pcpp::netToHost16(udpLayer->getUdpHeader()->portDst);
-				m_FlowTable[hash] = getFileNumberForValue(getValue(packet, UDP, srcPort, dstPort), filesToClose);
-				return m_FlowTable[hash];
+				return addFlow(hash, getValue(packet, UDP, srcPort, dstPort));
 			}
 		}
 
 		// if reached here, return 0
-		writingToFile(0, filesToClose);
 		return 0;
 	}
 
@@ -160,6 +152,16 @@ public:
 
 protected:
 
+	/**
+	 * Put a new flow in the flow table with the file number of the flow's value and return this file number
+	 */
+	int addFlow(uint32_t flowHash, uint32_t value)
+	{
+		int fileNum = getFileNumberForValue(value);
+		m_FlowTable.insert(flowHash) = fileNum;
+		return fileNum;
+	}
+
 	/**
 	 * An enum for TCP/UDP packet type: can be either TCP-SYN, TCP-SYN/ACK, Other TCP packet of UDP packet
 	 */
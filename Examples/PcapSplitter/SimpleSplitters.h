@@ -191,7 +191,7 @@ public:
 	 */
 	int getFileNumber(pcpp::Packet& packet, std::vector<int>& filesToClose)
 	{
-		return getNextFileNumber(filesToClose);
+		return getNextFileNumber();
 	}
 
 	/**
@@ -0,0 +1,443 @@
+#pragma once
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <pthread.h>
+#include "LRUList.h"
+#include "RawPacket.h"
+#include "PcapFileDevice.h"
+
+/**
+ * Writes the output files of the split in the background. The classifying thread appends packets to a write buffer per output
+ * file, and full buffers are handed to a pool of writer threads. A file's buffers are written in the order they were handed
+ * over and by one thread at a time, while different files are written in parallel.
+ * Since any OS has a limit on concurrently open files, the pool keeps a LRU list of the open output files. When the list is
+ * full the least recently written file is closed after its pending buffers are written, and re-opened in append mode the
+ * next time a buffer is written to it.
+ * All methods except the c'tor and d'tor must be called from the classifying thread only
+ */
+class SplitWriterPool
+{
+public:
+
+	/**
+	 * A c'tor for this class
+	 * @param[in] isPcapng Whether to write pcap-ng or pcap files
+	 * @param[in] numOfThreads Number of writer threads
+	 * @param[in] maxOpenFiles Maximum number of output files open concurrently (a few more may be open while closing)
+	 * @param[in] maxBufferedBytes Maximum number of bytes of packets waiting to be written. When this limit is reached the
+	 * classifying thread waits for the writers
+	 */
+	SplitWriterPool(bool isPcapng, int numOfThreads, size_t maxOpenFiles, size_t maxBufferedBytes) :
+		m_IsPcapng(isPcapng), m_NumOfThreads(numOfThreads), m_OpenFiles(maxOpenFiles), m_MaxBufferedBytes(maxBufferedBytes),
+		m_BufferedBytes(0), m_InFlightBytes(0), m_Stopping(false), m_NumOfBusyThreads(0), m_HasError(false)
+	{
+		pthread_mutex_init(&m_Mutex, NULL);
+		pthread_cond_init(&m_FileReady, NULL);
+		pthread_cond_init(&m_SpaceAvailable, NULL);
+	}
+
+	~SplitWriterPool()
+	{
+		finish();
+
+		for (std::vector<OutputFile*>::iterator iter = m_Files.begin(); iter != m_Files.end(); iter++)
+			delete (*iter);
+		for (std::vector<std::vector<uint8_t>*>::iterator iter = m_FreeBuffers.begin(); iter != m_FreeBuffers.end(); iter++)
+			delete (*iter);
+
+		pthread_mutex_destroy(&m_Mutex);
+		pthread_cond_destroy(&m_FileReady);
+		pthread_cond_destroy(&m_SpaceAvailable);
+	}
+
+	/**
+	 * Start the writer threads
+	 * @return False if no thread could be started
+	 */
+	bool start()
+	{
+		for (int i = 0; i < m_NumOfThreads; i++)
+		{
+			pthread_t thread;
+			if (pthread_create(&thread, NULL, writerThreadMain, this) != 0)
+				break;
+			m_Threads.push_back(thread);
+		}
+
+		return !m_Threads.empty();
+	}
+
+	/**
+	 * @return True if a packet was already written to this output file
+	 */
+	bool hasFile(int fileNum) const { return fileNum >= 0 && (size_t)fileNum < m_Files.size() && m_Files[fileNum] != NULL; }
+
+	/**
+	 * Add an output file. It's created when the first buffer is written to it
+	 */
+	void addFile(int fileNum, const std::string& fileName, pcpp::LinkLayerType linkType)
+	{
+		// the writers look up files by number when closing the least recently used one
+		pthread_mutex_lock(&m_Mutex);
+		if ((size_t)fileNum >= m_Files.size())
+			m_Files.resize(fileNum + 1, NULL);
+
+		m_Files[fileNum] = new OutputFile(fileName, linkType);
+		pthread_mutex_unlock(&m_Mutex);
+	}
+
+	/**
+	 * Copy a packet to the write buffer of an output file that was added with addFile()
+	 */
+	void writePacket(int fileNum, const pcpp::RawPacket& rawPacket)
+	{
+		OutputFile* file = m_Files[fileNum];
+		if (file->buffer == NULL)
+		{
+			file->buffer = getFreeBuffer();
+			m_FilesWithData.push_back(fileNum);
+		}
+
+		RecordHeader header;
+		header.timestamp = rawPacket.getPacketTimeStamp();
+		header.capturedLength = (uint32_t)rawPacket.getRawDataLen();
+		header.frameLength = (uint32_t)rawPacket.getFrameLength();
+		header.linkType = (uint32_t)rawPacket.getLinkLayerType();
+
+		std::vector<uint8_t>& buffer = *file->buffer;
+		size_t offset = buffer.size();
+		buffer.resize(offset + sizeof(header) + header.capturedLength);
+		memcpy(&buffer[offset], &header, sizeof(header));
+		if (header.capturedLength > 0)
+			memcpy(&buffer[offset + sizeof(header)], rawPacket.getRawData(), header.capturedLength);
+		m_BufferedBytes += sizeof(header) + header.capturedLength;
+
+		if (buffer.size() >= FlushThreshold)
+			flushFile(fileNum, false);
+
+		// too many small buffers of idle files are waiting, hand them all over
+		if (m_BufferedBytes > m_MaxBufferedBytes / 2)
+			flushAll();
+	}
+
+	/**
+	 * Hand over the write buffer of a file and close the file after it's written
+	 */
+	void closeFile(int fileNum)
+	{
+		if (hasFile(fileNum))
+			flushFile(fileNum, true);
+	}
+
+	/**
+	 * Write all buffers, wait for the writers to finish and close all files. Can be called more than once
+	 * @return False if an error occurred while opening or writing one of the files
+	 */
+	bool finish()
+	{
+		if (!m_Threads.empty())
+		{
+			flushAll();
+
+			pthread_mutex_lock(&m_Mutex);
+			m_Stopping = true;
+			pthread_cond_broadcast(&m_FileReady);
+			pthread_mutex_unlock(&m_Mutex);
+
+			for (std::vector<pthread_t>::iterator iter = m_Threads.begin(); iter != m_Threads.end(); iter++)
+				pthread_join(*iter, NULL);
+			m_Threads.clear();
+		}
+
+		for (std::vector<OutputFile*>::iterator iter = m_Files.begin(); iter != m_Files.end(); iter++)
+		{
+			if ((*iter) != NULL && (*iter)->writer != NULL)
+			{
+				(*iter)->writer->close();
+				delete (*iter)->writer;
+				(*iter)->writer = NULL;
+			}
+		}
+
+		return !hasError();
+	}
+
+	/**
+	 * @return True if an error occurred while opening or writing one of the files. The error itself is printed by PcapPlusPlus
+	 */
+	bool hasError()
+	{
+		pthread_mutex_lock(&m_Mutex);
+		bool result = m_HasError;
+		pthread_mutex_unlock(&m_Mutex);
+		return result;
+	}
+
+private:
+	// a buffer is handed over to the writers when it reaches this size
+	static const size_t FlushThreshold = 256 * 1024;
+
+	struct RecordHeader
+	{
+		timespec timestamp;
+		uint32_t capturedLength;
+		uint32_t frameLength;
+		uint32_t linkType;
+	};
+
+	/**
+	 * A buffer to write or a request to close the file (or both)
+	 */
+	struct WriteJob
+	{
+		std::vector<uint8_t>* buffer;
+		bool closeAfter;
+	};
+
+	struct OutputFile
+	{
+		std::string fileName;
+		pcpp::LinkLayerType linkType;
+		// the buffer being filled by the classifying thread
+		std::vector<uint8_t>* buffer;
+		// the fields below are protected by m_Mutex, except the writer which is used only by the thread the file is scheduled on
+		std::deque<WriteJob> pendingJobs;
+		bool isScheduled;
+		bool wasCreated;
+		pcpp::IFileWriterDevice* writer;
+
+		OutputFile(const std::string& name, pcpp::LinkLayerType type) :
+			fileName(name), linkType(type), buffer(NULL), isScheduled(false), wasCreated(false), writer(NULL) {}
+
+		~OutputFile() { delete buffer; }
+	};
+
+	bool m_IsPcapng;
+	int m_NumOfThreads;
+	std::vector<pthread_t> m_Threads;
+	// indexed by file number. Resized by the classifying thread under m_Mutex, writers access it under m_Mutex only
+	std::vector<OutputFile*> m_Files;
+	// files whose buffer isn't empty, owned by the classifying thread
+	std::vector<int> m_FilesWithData;
+
+	pthread_mutex_t m_Mutex;
+	pthread_cond_t m_FileReady;
+	pthread_cond_t m_SpaceAvailable;
+	// files with pending jobs that no thread is writing
+	std::deque<int> m_ReadyFiles;
+	pcpp::LRUList<int> m_OpenFiles;
+	std::vector<std::vector<uint8_t>*> m_FreeBuffers;
+	size_t m_MaxBufferedBytes;
+	// bytes in buffers being filled (classifying thread only)
+	size_t m_BufferedBytes;
+	// bytes in buffers handed over to the writers
+	size_t m_InFlightBytes;
+	bool m_Stopping;
+	int m_NumOfBusyThreads;
+	bool m_HasError;
+
+	std::vector<uint8_t>* getFreeBuffer()
+	{
+		pthread_mutex_lock(&m_Mutex);
+		std::vector<uint8_t>* buffer = NULL;
+		if (!m_FreeBuffers.empty())
+		{
+			buffer = m_FreeBuffers.back();
+			m_FreeBuffers.pop_back();
+		}
+		pthread_mutex_unlock(&m_Mutex);
+
+		if (buffer == NULL)
+		{
+			buffer = new std::vector<uint8_t>();
+			buffer->reserve(FlushThreshold + 2048);
+		}
+
+		return buffer;
+	}
+
+	// must be called with m_Mutex held
+	void addJob(int fileNum, const WriteJob& job)
+	{
+		OutputFile* file = m_Files[fileNum];
+		file->pendingJobs.push_back(job);
+		if (!file->isScheduled)
+		{
+			file->isScheduled = true;
+			m_ReadyFiles.push_back(fileNum);
+			pthread_cond_signal(&m_FileReady);
+		}
+	}
+
+	void flushFile(int fileNum, bool closeAfter)
+	{
+		OutputFile* file = m_Files[fileNum];
+		WriteJob job;
+		job.buffer = file->buffer;
+		job.closeAfter = closeAfter;
+		file->buffer = NULL;
+
+		size_t size = (job.buffer != NULL ? job.buffer->size() : 0);
+		m_BufferedBytes -= size;
+
+		pthread_mutex_lock(&m_Mutex);
+		// wait for the writers to catch up before handing over more data
+		while (m_InFlightBytes > 0 && m_InFlightBytes + size > m_MaxBufferedBytes / 2 && !m_Threads.empty())
+			pthread_cond_wait(&m_SpaceAvailable, &m_Mutex);
+		m_InFlightBytes += size;
+		addJob(fileNum, job);
+		pthread_mutex_unlock(&m_Mutex);
+	}
+
+	void flushAll()
+	{
+		for (std::vector<int>::iterator iter = m_FilesWithData.begin(); iter != m_FilesWithData.end(); iter++)
+		{
+			if (m_Files[*iter]->buffer != NULL)
+				flushFile(*iter, false);
+		}
+
+		m_FilesWithData.clear();
+	}
+
+	bool openWriter(OutputFile* file)
+	{
+		if (m_IsPcapng)
+			file->writer = new pcpp::PcapNgFileWriterDevice(file->fileName.c_str());
+		else
+			file->writer = new pcpp::PcapFileWriterDevice(file->fileName.c_str(), file->linkType);
+
+		// a file that was closed to make room for other files is re-opened in append mode
+		if (!file->writer->open(file->wasCreated))
+		{
+			delete file->writer;
+			file->writer = NULL;
+			return false;
+		}
+
+		file->wasCreated = true;
+		return true;
+	}
+
+	void writeBuffer(OutputFile* file, const std::vector<uint8_t>& buffer)
+	{
+		// the raw packet points into the buffer and doesn't own the data
+		timespec zeroTime = { 0, 0 };
+		pcpp::RawPacket rawPacket(NULL, 0, zeroTime, false);
+
+		size_t offset = 0;
+		while (offset + sizeof(RecordHeader) <= buffer.size())
+		{
+			RecordHeader header;
+			memcpy(&header, &buffer[offset], sizeof(header));
+			offset += sizeof(header);
+
+			rawPacket.setRawData(header.capturedLength > 0 ? &buffer[offset] : NULL, (int)header.capturedLength, header.timestamp,
+					(pcpp::LinkLayerType)header.linkType, (int)header.frameLength);
+			file->writer->writePacket(rawPacket);
+			offset += header.capturedLength;
+		}
+	}
+
+	/**
+	 * Run a job of a file that is scheduled on the calling thread. Called without m_Mutex held
+	 */
+	void runJob(int fileNum, OutputFile* file, const WriteJob& job)
+	{
+		bool hasData = (job.buffer != NULL && !job.buffer->empty());
+
+		if (hasData)
+		{
+			int fileToClose = -1;
+			bool isOpen = (file->writer != NULL);
+			if (!isOpen && !openWriter(file))
+			{
+				pthread_mutex_lock(&m_Mutex);
+				m_HasError = true;
+				pthread_mutex_unlock(&m_Mutex);
+				return;
+			}
+
+			pthread_mutex_lock(&m_Mutex);
+			// the least recently written file is closed after the jobs it already has
+			if (m_OpenFiles.put(fileNum, &fileToClose) == 1 && fileToClose != fileNum)
+			{
+				WriteJob closeJob;
+				closeJob.buffer = NULL;
+				closeJob.closeAfter = true;
+				addJob(fileToClose, closeJob);
+			}
+			pthread_mutex_unlock(&m_Mutex);
+
+			writeBuffer(file, *job.buffer);
+		}
+
+		if (job.closeAfter && file->writer != NULL)
+		{
+			file->writer->close();
+			delete file->writer;
+			file->writer = NULL;
+
+			pthread_mutex_lock(&m_Mutex);
+			m_OpenFiles.eraseElement(fileNum);
+			pthread_mutex_unlock(&m_Mutex);
+		}
+	}
+
+	void writerLoop()
+	{
+		pthread_mutex_lock(&m_Mutex);
+		while (true)
+		{
+			// a busy thread may still schedule a file (to close it), so wait for it even when stopping
+			while (m_ReadyFiles.empty() && !(m_Stopping && m_NumOfBusyThreads == 0))
+				pthread_cond_wait(&m_FileReady, &m_Mutex);
+
+			if (m_ReadyFiles.empty())
+				break;
+
+			int fileNum = m_ReadyFiles.front();
+			m_ReadyFiles.pop_front();
+			OutputFile* file = m_Files[fileNum];
+			WriteJob job = file->pendingJobs.front();
+			m_NumOfBusyThreads++;
+			pthread_mutex_unlock(&m_Mutex);
+
+			runJob(fileNum, file, job);
+
+			pthread_mutex_lock(&m_Mutex);
+			m_NumOfBusyThreads--;
+			file->pendingJobs.pop_front();
+			if (job.buffer != NULL)
+			{
+				m_InFlightBytes -= job.buffer->size();
+				job.buffer->clear();
+				m_FreeBuffers.push_back(job.buffer);
+				pthread_cond_signal(&m_SpaceAvailable);
+			}
+
+			// the file stays scheduled while it has jobs, it goes to the back of the line so other files get their turn
+			if (file->pendingJobs.empty())
+				file->isScheduled = false;
+			else
+				m_ReadyFiles.push_back(fileNum);
+		}
+
+		// wake up the other threads so they see there's nothing left to do
+		pthread_cond_broadcast(&m_FileReady);
+		pthread_mutex_unlock(&m_Mutex);
+	}
+
+	static void* writerThreadMain(void* pool)
+	{
+		((SplitWriterPool*)pool)->writerLoop();
+		return NULL;
+	}
+
+	// disable copy
+	SplitWriterPool(const SplitWriterPool&);
+	SplitWriterPool& operator=(const SplitWriterPool&);
+};
@@ -1,6 +1,5 @@
 #pragma once
 
-#include "LRUList.h"
 #include "RawPacket.h"
 #include "Packet.h"
 #include "IPv4Layer.h"
@@ -9,11 +8,99 @@
 #include "UdpLayer.h"
 #include "DnsLayer.h"
 #include "PacketUtils.h"
-#include <map>
+#include <vector>
 #include <algorithm>
 #include <iomanip>
 #include <sstream>
 
+/**
+ * An open-addressing hash table (linear probing) that maps a 32-bit key - a flow hash or a packet value such as an IP
+ * address - to a value. The splitters look up every packet in their tables, and this table does it with one probe sequence
+ * in a flat array instead of the several tree walks std::map needs. Entries are never removed
+ */
+template<typename V>
+class SplitterHashTable
+{
+public:
+	SplitterHashTable() : m_Size(0) { m_Slots.resize(InitialCapacity); }
+
+	/**
+	 * Return a pointer to the value of a key or NULL if the key isn't in the table. The pointer is valid until the next insert
+	 */
+	V* find(uint32_t key)
+	{
+		for (size_t slot = mix(key) & (m_Slots.size() - 1); m_Slots[slot].used; slot = (slot + 1) & (m_Slots.size() - 1))
+		{
+			if (m_Slots[slot].key == key)
+				return &m_Slots[slot].value;
+		}
+
+		return NULL;
+	}
+
+	/**
+	 * Insert a key that isn't in the table and return a reference to its value, which is valid until the next insert
+	 */
+	V& insert(uint32_t key)
+	{
+		// keep the load factor under 1/2 so probe sequences stay short
+		if ((m_Size + 1) * 2 > m_Slots.size())
+			grow();
+
+		m_Size++;
+		return insertSlot(key).value;
+	}
+
+private:
+	static const size_t InitialCapacity = 1024;
+
+	struct Slot
+	{
+		uint32_t key;
+		bool used;
+		V value;
+
+		Slot() : key(0), used(false), value() {}
+	};
+
+	std::vector<Slot> m_Slots;
+	size_t m_Size;
+
+	// the murmur3 finalizer, values such as ports and IPv4 addresses are far from uniformly distributed
+	static uint32_t mix(uint32_t key)
+	{
+		key ^= key >> 16;
+		key *= 0x85ebca6b;
+		key ^= key >> 13;
+		key *= 0xc2b2ae35;
+		key ^= key >> 16;
+		return key;
+	}
+
+	Slot& insertSlot(uint32_t key)
+	{
+		size_t slot = mix(key) & (m_Slots.size() - 1);
+		while (m_Slots[slot].used)
+			slot = (slot + 1) & (m_Slots.size() - 1);
+
+		m_Slots[slot].used = true;
+		m_Slots[slot].key = key;
+		return m_Slots[slot];
+	}
+
+	void grow()
+	{
+		std::vector<Slot> oldSlots(m_Slots.size() * 2);
+		oldSlots.swap(m_Slots);
+		for (typename std::vector<Slot>::iterator iter = oldSlots.begin(); iter != oldSlots.end(); iter++)
+		{
+			if (iter->used)
+				insertSlot(iter->key).value = iter->value;
+		}
+	}
+};
+
+
 /**
  * The base splitter class. All type of splitters inherit from it. It's a virtual abstract class that doesn't
  * implement any logic
@@ -25,7 +112,7 @@ public:
 	/**
 	 * A method that gets a packet and returns:
 	 * - The file number to write the packet to
-	 * - A vector of file numbers to close (may be empty)
+	 * - A vector of file numbers the splitter won't write to anymore, so they can be closed (may be empty)
 	 */
 	virtual int getFileNumber(pcpp::Packet& packet, std::vector<int>& filesToClose) = 0;
 
@@ -58,45 +145,23 @@ public:
 
 /**
  * A virtual abstract splitter which represent splitters that may or may not have a limit on the number of
- * output files after the split
- * Since any OS has a limit on concurrently open files, this class implements a mechanism that makes sure no more than a
- * certain number of files are opened concurrently without limiting the number of output files desired by the user.
- * The idea is to use a LRU list that holds the number of currently open files. Each time a packet is written to a
- * certain file, the file number is advance to the head of the LRU list (or added if it's not there),
- * and if the list is full then the least recently used file is leaving it and gets closed. The next time a packet will
- * be written to a file that left the LRU list, this file will be put back in the LRU list, re-opened and packet will
- * be appended to that file
+ * output files after the split.
+ * The number of output files isn't limited by the number of files the OS lets the application open concurrently: the
+ * writers (see SplitWriterPool.h) keep a LRU list of open files and close the least recently used one when needed. When
+ * a packet is written to a file that was closed, the file is re-opened and the packet is appended to it
  */
 class SplitterWithMaxFiles : public Splitter
 {
-	// in order to support all OS's, the maximum number of concurrent open file is set to 250
-	static const int MAX_NUMBER_OF_CONCURRENT_OPEN_FILES = 250;
-
 protected:
 	int m_MaxFiles;
 	int m_NextFile;
-	pcpp::LRUList<int> m_LRUFileList;
-
-	/**
-	 * A helper method that needs to be called by child classes each time a packet is written to a certain file.
-	 * This method puts the file in the LRU list, and if the list is full it pulls out the least recently used file
-	 * and returns it in filesToClose vector. The application will take care of closing that file
-	 */
-	void writingToFile(int fileNum, std::vector<int>& filesToClose)
-	{
-		int fileToClose;
-		if (m_LRUFileList.put(fileNum, &fileToClose) == 1)
-			filesToClose.push_back(fileToClose);
-	}
 
 	/**
 	 * A helper method that is called by child classes and returns the next file number. If there's no output file limit
 	 * it just return prev_file_number+1. But if there is a file limit it return file number in cyclic manner, meaning if
-	 * reached the max file number, the next file number will be 0.
-	 * In addition the method puts the next file in the LRU list and if the list is full it pulls out the least recently
-	 * used file and returns it in filesToClose vector. The application will take care of closing that file
+	 * reached the max file number, the next file number will be 0
 	 */
-	int getNextFileNumber(std::vector<int>& filesToClose)
+	int getNextFileNumber()
 	{
 		int nextFile = 0;
 
@@ -109,14 +174,6 @@ protected:
 			m_NextFile++;
 		}
 
-
-		// put the next file in the LRU list
-		int fileToClose;
-		if (m_LRUFileList.put(nextFile, &fileToClose) == 1)
-		{
-			// if a file is pulled out of the LRU list - return it
-			filesToClose.push_back(fileToClose);
-		}
 		return nextFile;
 	}
 
@@ -124,7 +181,7 @@ protected:
 	 * A protected c'tor for this class which gets the output file limit size. If maxFile is UNLIMITED_FILES_MAGIC_NUMBER,
 	 * it's considered there's no output files limit
 	 */
-	SplitterWithMaxFiles(int maxFiles, int firstFileNumber = 0) : m_LRUFileList(MAX_NUMBER_OF_CONCURRENT_OPEN_FILES)
+	SplitterWithMaxFiles(int maxFiles, int firstFileNumber = 0)
 	{
 		m_MaxFiles = maxFiles;
 		m_NextFile = firstFileNumber;
@@ -166,9 +223,9 @@ class ValueBasedSplitter : public SplitterWithMaxFiles
 {
 protected:
 	// A flow table that keeps track of all flows (a flow is usually identified by 5-tuple)
-	std::map<uint32_t, int> m_FlowTable;
+	SplitterHashTable<int> m_FlowTable;
 	// a map between the relevant packet value (e.g client-ip) and the file to write the packet to
-	std::map<uint32_t, int> m_ValueToFileTable;
+	SplitterHashTable<int> m_ValueToFileTable;
 
 	/**
 	 * A protected c'tor for this class that only propagate the maxFiles to its ancestor
@@ -176,22 +233,20 @@ protected:
 	ValueBasedSplitter(int maxFiles) : SplitterWithMaxFiles(maxFiles, 1) {}
 
 	/**
-	 * A helper method that gets the packet value and returns the file to write it to, and also a file to close if the
-	 * LRU list is full
+	 * A helper method that gets the packet value and returns the file to write it to
 	 */
-	int getFileNumberForValue(uint32_t value, std::vector<int>& filesToClose)
+	int getFileNumberForValue(uint32_t value)
 	{
-		// search the value in the value-to-file map. If it's there, return the file number
-		if (m_ValueToFileTable.find(value) != m_ValueToFileTable.end())
-		{
-			// if value was already seen, follow the same file number
-			return m_ValueToFileTable[value];
-		}
+		// search the value in the value-to-file map. If it's there, follow the same file number
+		int* fileNum = m_ValueToFileTable.find(value);
+		if (fileNum != NULL)
+			return *fileNum;
 
 		// if it's not there, use SplitterWithMaxFiles's helper method to get a new file number, put it in the map
 		// and return this file number
-		m_ValueToFileTable[value] = getNextFileNumber(filesToClose);
-		return m_ValueToFileTable[value];
+		int nextFile = getNextFileNumber();
+		m_ValueToFileTable.insert(value) = nextFile;
+		return nextFile;
 	}
 };
 
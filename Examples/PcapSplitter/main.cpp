@@ -39,6 +39,9 @@
  * - In options 3-5 & 7 all packets which aren't UDP or TCP (hence don't belong to any connection) will be written to
  *   one output file, separate from the other output files (usually file#0)
  * - Works only on files of the pcap (TCPDUMP) format
+ * - The input file is read and parsed by one thread while the main thread decides on the output file of each packet.
+ *   Packets are copied to a write buffer per output file and the buffers are written by a pool of writer threads (see
+ *   SplitWriterPool.h), which also limits the number of files open concurrently
  *
  */
 
@@ -49,13 +52,15 @@
 #include <sstream>
 #include <string>
 #include <iomanip>
-#include <map>
+#include <deque>
+#include <pthread.h>
 #include <RawPacket.h>
 #include <Packet.h>
 #include <PcapFileDevice.h>
 #include "SimpleSplitters.h"
 #include "IPPortSplitters.h"
 #include "ConnectionSplitters.h"
+#include "SplitWriterPool.h"
 #include <getopt.h>
 #include <SystemUtils.h>
 #include <PcapPlusPlusVersion.h>
@@ -70,6 +75,7 @@ static struct option PcapSplitterOptions[] =
 	{"method", required_argument, 0, 'm'},
 	{"param", required_argument, 0, 'p'},
 	{"filter", required_argument, 0, 'i'},
+	{"thread-count", required_argument, 0, 't'},
 	{"help", no_argument, 0, 'h'},
 	{"version", no_argument, 0, 'v'},
 	{0, 0, 0, 0}
@@ -93,6 +99,13 @@ static struct option PcapSplitterOptions[] =
 #define SPLIT_BY_BPF_FILTER    "bpf-filter"
 #define SPLIT_BY_ROUND_ROBIN   "round-robin"
 
+// max number of output files open concurrently, files beyond that are closed and re-opened in append mode when needed
+#define MAX_OPEN_FILES 250
+// max number of bytes of packets copied to write buffers and not written yet
+#define MAX_BUFFERED_BYTES (64 * 1024 * 1024)
+#define PACKETS_IN_BATCH 256
+#define NUM_OF_BATCHES 8
+
 #if defined(WIN32) || defined(WINx64)
 #define SEPARATOR '\\'
 #else
@@ -106,7 +119,7 @@ void printUsage()
 {
 	printf("\nUsage:\n"
 			"-------\n"
-			"%s [-h] [-v] [-i filter] -f pcap_file -o output_dir -m split_method [-p split_param]\n"
+			"%s [-h] [-v] [-i filter] [-t thread_count] -f pcap_file -o output_dir -m split_method [-p split_param]\n"
 			"\nOptions:\n\n"
 			"    -f pcap_file    : Input pcap file name\n"
 			"    -o output_dir   : The directory where the output files shall be written\n"
@@ -146,6 +159,7 @@ void printUsage()
 			"                      'method = bpf-filter'   => split-param is the BPF filter to match upon\n"
 			"                      'method = round-robin'  => split-param is number of files to round-robin packets between\n"
 			"    -i filter       : Apply a BPF filter, meaning only filtered packets will be counted in the split\n"
+			"    -t thread_count : Number of threads writing the output files. The default is the number of cores\n"
 			"    -v              : Displays the current version and exists\n"
 			"    -h              : Displays this help message and exits\n", AppName::get().c_str());
 }
@@ -202,6 +216,82 @@ std::string getFileNameWithoutExtension(const std::string& path)
 	return("");
 }
 
+/**
+ * A batch of packets read and parsed by the reader thread. The Packet objects are reused for the next batch so
+ * parsing doesn't allocate memory
+ */
+struct PacketBatch
+{
+	RawPacket rawPackets[PACKETS_IN_BATCH];
+	Packet packets[PACKETS_IN_BATCH];
+	int count;
+};
+
+
+/**
+ * The queues of batches between the reader thread and the main thread. The number of batches is fixed so the reader
+ * can't get too far ahead of the writers
+ */
+struct PacketBatchQueue
+{
+	IFileReaderDevice* reader;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	std::vector<PacketBatch*> freeBatches;
+	std::deque<PacketBatch*> fullBatches;
+	bool readerDone;
+	bool stopReading;
+};
+
+
+/**
+ * The reader thread: read packets from the input file and parse them in batches until the file ends or the main
+ * thread asks to stop
+ */
+void* readerThreadMain(void* queuePtr)
+{
+	PacketBatchQueue* queue = (PacketBatchQueue*)queuePtr;
+
+	while (true)
+	{
+		pthread_mutex_lock(&queue->mutex);
+		while (queue->freeBatches.empty() && !queue->stopReading)
+			pthread_cond_wait(&queue->cond, &queue->mutex);
+		if (queue->stopReading)
+		{
+			pthread_mutex_unlock(&queue->mutex);
+			break;
+		}
+		PacketBatch* batch = queue->freeBatches.back();
+		queue->freeBatches.pop_back();
+		pthread_mutex_unlock(&queue->mutex);
+
+		batch->count = 0;
+		while (batch->count < PACKETS_IN_BATCH && queue->reader->getNextPacket(batch->rawPackets[batch->count]))
+		{
+			batch->packets[batch->count].setRawPacket(&batch->rawPackets[batch->count], false);
+			batch->count++;
+		}
+
+		bool isLastBatch = (batch->count < PACKETS_IN_BATCH);
+
+		pthread_mutex_lock(&queue->mutex);
+		if (batch->count > 0)
+			queue->fullBatches.push_back(batch);
+		else
+			queue->freeBatches.push_back(batch);
+		queue->readerDone = isLastBatch;
+		pthread_cond_broadcast(&queue->cond);
+		pthread_mutex_unlock(&queue->mutex);
+
+		if (isLastBatch)
+			break;
+	}
+
+	return NULL;
+}
+
+
 /**
  * main method of this utility
  */
@@ -221,10 +311,12 @@ int main(int argc, char* argv[])
 
 	bool paramWasSet = false;
 
+	int numOfWriterThreads = getNumOfCores();
+
 	int optionIndex = 0;
 	char opt = 0;
 
-	while((opt = getopt_long (argc, argv, "f:o:m:p:i:vh", PcapSplitterOptions, &optionIndex)) != -1)
+	while((opt = getopt_long (argc, argv, "f:o:m:p:i:t:vh", PcapSplitterOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -246,6 +338,9 @@ int main(int argc, char* argv[])
 			case 'i':
 				filter = optarg;
 				break;
+			case 't':
+				numOfWriterThreads = atoi(optarg);
+				break;
 			case 'h':
 				printUsage();
 				exit(0);
@@ -278,6 +373,11 @@ int main(int argc, char* argv[])
 		EXIT_WITH_ERROR("Split method was not given");
 	}
 
+	if (numOfWriterThreads <= 0)
+	{
+		EXIT_WITH_ERROR("Number of writer threads must be a positive number");
+	}
+
 	Splitter* splitter = NULL;
 
 	// decide of the splitter to use, according to the user's choice
@@ -363,92 +463,96 @@ int main(int argc, char* argv[])
 
 	int packetCountSoFar = 0;
 	int numOfFiles = 0;
-	RawPacket rawPacket;
-
-	// prepare a map of file number to IFileWriterDevice
-	std::map<int, IFileWriterDevice*> outputFiles;
+	bool writeFailed = false;
 
-	// read all packets from input file, for each packet do:
-	while (reader->getNextPacket(rawPacket))
+	// the writer pool holds the write buffer, writer and state of each output file
+	SplitWriterPool writerPool(isReaderPcapng, numOfWriterThreads, MAX_OPEN_FILES, MAX_BUFFERED_BYTES);
+	if (!writerPool.start())
 	{
-		// parse the raw packet into a parsed packet
-		Packet parsedPacket(&rawPacket);
+		EXIT_WITH_ERROR("Couldn't start the writer threads");
+	}
 
-		std::vector<int> filesToClose;
+	// start the reader thread
+	PacketBatchQueue queue;
+	queue.reader = reader;
+	pthread_mutex_init(&queue.mutex, NULL);
+	pthread_cond_init(&queue.cond, NULL);
+	queue.readerDone = false;
+	queue.stopReading = false;
+	for (int i = 0; i < NUM_OF_BATCHES; i++)
+		queue.freeBatches.push_back(new PacketBatch());
+
+	pthread_t readerThread;
+	if (pthread_create(&readerThread, NULL, readerThreadMain, &queue) != 0)
+	{
+		EXIT_WITH_ERROR("Couldn't start the reader thread");
+	}
 
-		// call the splitter to get the file number to write the current packet to
-		int fileNum = splitter->getFileNumber(parsedPacket, filesToClose);
+	std::vector<int> filesToClose;
 
-		// if file number is seen for the first time (meaning it's the first packet written to it)
-		if (outputFiles.find(fileNum) == outputFiles.end())
+	// go over the batches of packets the reader thread parsed, for each packet do:
+	while (!writeFailed)
+	{
+		pthread_mutex_lock(&queue.mutex);
+		while (queue.fullBatches.empty() && !queue.readerDone)
+			pthread_cond_wait(&queue.cond, &queue.mutex);
+		if (queue.fullBatches.empty())
 		{
-			// get file name from the splitter and add the .pcap extension
-			std::string fileName = splitter->getFileName(parsedPacket, outputPcapFileName, fileNum) + outputFileExtenison;
-
-			// create a new IFileWriterDevice for this file
-			if (isReaderPcapng)
-			{
-				// if reader is pcapng, create a pcapng writer
-				outputFiles[fileNum] = new PcapNgFileWriterDevice(fileName.c_str());
-			}
-			else
-			{
-				// if reader is pcap, create a pcap writer
-				outputFiles[fileNum] = new PcapFileWriterDevice(fileName.c_str(), rawPacket.getLinkLayerType());
-			}
-
-			// open the writer
-			if (!outputFiles[fileNum]->open())
-				break;
-
-			numOfFiles++;
+			pthread_mutex_unlock(&queue.mutex);
+			break;
 		}
+		PacketBatch* batch = queue.fullBatches.front();
+		queue.fullBatches.pop_front();
+		pthread_mutex_unlock(&queue.mutex);
 
-		// if file number exists in the map but PcapFileWriterDevice is null it means this file was open once and
-		// then closed. In this case we need to re-open the PcapFileWriterDevice in append mode
-		else if (outputFiles[fileNum] == NULL)
+		for (int i = 0; i < batch->count; i++)
 		{
-			// get file name from the splitter and add the .pcap extension
-			std::string fileName = splitter->getFileName(parsedPacket, outputPcapFileName, fileNum) + outputFileExtenison;
+			Packet& parsedPacket = batch->packets[i];
 
-			// re-create the IFileWriterDevice object
-			if (isReaderPcapng)
-			{
-				// if reader is pcapng, create a pcapng writer
-				outputFiles[fileNum] = new PcapNgFileWriterDevice(fileName.c_str());
-			}
-			else
+			filesToClose.clear();
+
+			// call the splitter to get the file number to write the current packet to
+			int fileNum = splitter->getFileNumber(parsedPacket, filesToClose);
+
+			// if file number is seen for the first time (meaning it's the first packet written to it)
+			if (!writerPool.hasFile(fileNum))
 			{
-				// if reader is pcap, create a pcap writer
-				outputFiles[fileNum] = new PcapFileWriterDevice(fileName.c_str(), rawPacket.getLinkLayerType());
+				// get file name from the splitter and add the .pcap extension
+				std::string fileName = splitter->getFileName(parsedPacket, outputPcapFileName, fileNum) + outputFileExtenison;
+				writerPool.addFile(fileNum, fileName, parsedPacket.getRawPacket()->getLinkLayerType());
+				numOfFiles++;
 			}
 
-			// open the writer in __append__ mode
-			if (!outputFiles[fileNum]->open(true))
-				break;
-		}
+			// copy the packet to the file's write buffer. If the file was closed before, it's re-opened in append mode
+			writerPool.writePacket(fileNum, *parsedPacket.getRawPacket());
 
-		// write the packet to the writer
-		outputFiles[fileNum]->writePacket(*parsedPacket.getRawPacket());
-
-		// if splitter wants us to close files - go over the file numbers and close them
-		for (std::vector<int>::iterator it = filesToClose.begin(); it != filesToClose.end(); it++)
-		{
-			// check if that file number is in the map
-			if (outputFiles.find(*it) != outputFiles.end())
-			{
-				// close the writer
-				outputFiles[*it]->close();
+			// if splitter wants us to close files - they're closed after their buffered packets are written
+			for (std::vector<int>::iterator it = filesToClose.begin(); it != filesToClose.end(); it++)
+				writerPool.closeFile(*it);
 
-				// free the writer memory and put null in the map record
-				delete outputFiles[*it];
-				outputFiles[*it] = NULL;
-			}
+			packetCountSoFar++;
 		}
 
-		packetCountSoFar++;
+		pthread_mutex_lock(&queue.mutex);
+		queue.freeBatches.push_back(batch);
+		pthread_cond_broadcast(&queue.cond);
+		pthread_mutex_unlock(&queue.mutex);
+
+		// stop on the first file that couldn't be opened or written, like writing inline did
+		writeFailed = writerPool.hasError();
 	}
 
+	// stop the reader thread in case the split stopped before the end of the file
+	pthread_mutex_lock(&queue.mutex);
+	queue.stopReading = true;
+	pthread_cond_broadcast(&queue.cond);
+	pthread_mutex_unlock(&queue.mutex);
+	pthread_join(readerThread, NULL);
+
+	// write the remaining buffers and close all output files
+	if (!writerPool.finish())
+		writeFailed = true;
+
 	std::cout << "Finished. Read and written " << packetCountSoFar << " packets to " << numOfFiles << " files" << std::endl;
 
 	// close the reader file
@@ -458,14 +562,17 @@ int main(int argc, char* argv[])
 	delete reader;
 	delete splitter;
 
-	// close the writer files which are still open
-	for(std::map<int, IFileWriterDevice*>::iterator it = outputFiles.begin(); it != outputFiles.end(); ++it)
+	for (std::vector<PacketBatch*>::iterator it = queue.freeBatches.begin(); it != queue.freeBatches.end(); ++it)
+		delete (*it);
+	for (std::deque<PacketBatch*>::iterator it = queue.fullBatches.begin(); it != queue.fullBatches.end(); ++it)
+		delete (*it);
+	pthread_mutex_destroy(&queue.mutex);
+	pthread_cond_destroy(&queue.cond);
+
+	if (writeFailed)
 	{
-		if (it->second != NULL)
-		{
-			it->second->close();
-			delete it->second;
-		}
+		printf("Error: couldn't write some of the output files\n");
+		return 1;
 	}
 
 	return 0;
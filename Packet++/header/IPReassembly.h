@@ -2,10 +2,10 @@
 #define PACKETPP_IP_REASSEMBLY
 
 #include "Packet.h"
-#include "LRUList.h"
 #include "IpAddress.h"
 #include "PointerVector.h"
-#include <map>
+#include <vector>
+#include <time.h>
 
 /**
  * @file
@@ -17,15 +17,17 @@
  * reassembly and returns a fully reassembled packet when done.<BR>
  *
  * The logic works as follows:
- * - There is an internal map that stores the reassembly data for each packet. The key to this map, meaning the way to uniquely associate a
+ * - There is an internal hash table that stores the reassembly data for each packet. The key to this table, meaning the way to uniquely associate a
  *   fragment to a (reassembled) packet is the triplet of source IP, destination IP and IP ID (for IPv4) or Fragment ID (for IPv6)
- * - When the first fragment arrives a new record is created in the map and the fragment data is copied
- * - With each fragment arriving the fragment data is copied right after the previous fragment and the reassembled packet is gradually being built
+ * - When the first fragment arrives a new record is created in the table and the fragment data is copied
+ * - With each fragment arriving the fragment data is copied right after the previous fragment and the reassembled packet is gradually being built.
+ *   Once the last fragment was seen the total length of the packet is known, and the buffer of the reassembled packet is allocated at its
+ *   final size so no more copies are needed
  * - When the last fragment arrives the packet is fully reassembled and returned to the user. Since all fragment data is copied, the packet pointer
  *   returned to the user has to be freed by the user when done using it
  * - The logic supports out-of-order fragments, meaning that a fragment which arrives out-of-order, its data will be copied to a list of out-of-order
- *   fragments where it waits for its turn. This list is observed each time a new fragment arrives to see if the next fragment(s) wait(s) in this
- *   list
+ *   fragments (sorted by offset) where it waits for its turn. This list is observed each time a new fragment arrives to see if the next fragment(s)
+ *   wait(s) in this list. The data of out-of-order fragments is kept in fixed-size blocks taken from a slab which is reused between packets
  * - If a non-IP packet arrives it's returned as is to the user
  * - If a non-fragment packet arrives it's returned as is to the user
  *
@@ -34,7 +36,14 @@
  * c'tor). Once capacity (the number of concurrent reassembled packets) exceeds this number, the packet that was least recently used will be
  * dropped from the map along with all the data that was reassembled so far. This means that if the next fragment from this packet suddenly
  * appears it will be treated as a new reassembled packet (which will create another record in the map). The user can be notified when
- * reassembled packets are removed from the map by registering to the pcpp#IPReassembly#OnFragmentsClean callback in pcpp#IPReassembly c'tor
+ * reassembled packets are removed from the map by registering to the pcpp#IPReassembly#OnFragmentsClean callback in pcpp#IPReassembly c'tor.<BR>
+ * Two more limits can be set in the c'tor, both are disabled by default:
+ * - A cap on the number of bytes buffered for all packets together (reassembled data and out-of-order fragments). When a fragment would exceed
+ *   it the least recently used packets are dropped until there's enough room. A packet that doesn't fit even on its own is dropped as well
+ * - A timeout. Packets that didn't get a new fragment for longer than the timeout are dropped. Time is taken from the timestamps of the
+ *   processed fragments, so it works the same way for live traffic and for pcap files
+ *
+ * The OnFragmentsClean callback is fired for packets dropped due to each of these limits
  */
 
 /**
@@ -289,7 +298,8 @@ namespace pcpp
 		 * @typedef OnFragmentsClean
 		 * The IP reassembly mechanism has a certain capacity of concurrent packets it can handle. This capacity is determined in its c'tor
 		 * (default value is #PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE). When traffic volume exceeds this capacity the mechanism starts
-		 * dropping packets in a LRU manner (least recently used are dropped first). Whenever a packet is dropped this callback is fired
+		 * dropping packets in a LRU manner (least recently used are dropped first). Packets are also dropped when the buffered bytes cap is
+		 * reached or when they time out (if these limits are set in the c'tor). Whenever a packet is dropped this callback is fired
 		 * @param[in] key A pointer to the identifier of the packet that is being dropped
 		 * @param[in] userCookie A pointer to the cookie provided by the user in IPReassemby c'tor (or NULL if no cookie provided)
 		 */
@@ -323,9 +333,13 @@ namespace pcpp
 		 * @param[in] callbackUserCookie A pointer to an object provided by the user. This pointer will be returned when invoking the
 		 * onFragmentsCleanCallback. This parameter is optional, default cookie is NULL
 		 * @param[in] maxPacketsToStore Set the capacity limit of the IP reassembly mechanism. Default capacity is #PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE
+		 * @param[in] maxBufferedBytes Set a cap on the number of bytes buffered for all packets together. This parameter is optional, default
+		 * value is 0 which means the number of bytes isn't limited
+		 * @param[in] timeout Drop packets that didn't get a new fragment for this number of seconds, according to the fragments' timestamps.
+		 * This parameter is optional, default value is 0 which means packets never time out
 		 */
-		IPReassembly(OnFragmentsClean onFragmentsCleanCallback = NULL, void *callbackUserCookie = NULL, size_t maxPacketsToStore = PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE)
-			: m_PacketLRU(maxPacketsToStore), m_OnFragmentsCleanCallback(onFragmentsCleanCallback), m_CallbackUserCookie(callbackUserCookie) {}
+		IPReassembly(OnFragmentsClean onFragmentsCleanCallback = NULL, void *callbackUserCookie = NULL, size_t maxPacketsToStore = PCPP_IP_REASSEMBLY_DEFAULT_MAX_PACKETS_TO_STORE,
+			uint64_t maxBufferedBytes = 0, uint32_t timeout = 0);
 
 		/**
 		 * A d'tor for this class
@@ -412,44 +426,115 @@ namespace pcpp
 		/**
 		 * Get the maximum capacity as determined in the c'tor
 		 */
-		size_t getMaxCapacity() const { return m_PacketLRU.getMaxSize(); }
+		size_t getMaxCapacity() const { return m_MaxPacketsToStore; }
 
 		/**
 		 * Get the current number of packets being processed
 		 */
-		size_t getCurrentCapacity() const { return m_FragmentMap.size(); }
+		size_t getCurrentCapacity() const { return m_NumOfPackets; }
+
+		/**
+		 * @return The number of bytes currently buffered for all packets together: the buffers of the reassembled packets and the slab blocks
+		 * holding out-of-order fragments
+		 */
+		uint64_t getBufferedBytes() const { return m_BufferedBytes; }
 
 	private:
 
+		// the identifying triplet of a packet. IPv4 addresses take the first 4 bytes of the address arrays and the rest is zeroed
+		struct PacketKeyData
+		{
+			uint8_t srcIP[16];
+			uint8_t dstIP[16];
+			uint32_t fragmentID;
+			ProtocolType protocol;
+
+			bool operator==(const PacketKeyData& other) const;
+		};
+
+		// out-of-order fragment data is stored in a chain of fixed-size blocks taken from the slab
+		static const size_t SlabBlockDataSize = 2040;
+
+		struct SlabBlock
+		{
+			SlabBlock* next;
+			uint8_t data[SlabBlockDataSize];
+		};
+
 		struct IPFragment
 		{
-			uint16_t fragmentOffset;
+			uint32_t fragmentOffset;
+			uint32_t fragmentDataLen;
 			bool lastFragment;
-			uint8_t* fragmentData;
-			size_t fragmentDataLen;
-			IPFragment() { fragmentOffset = 0; lastFragment = false; fragmentData = NULL; fragmentDataLen = 0; }
-			~IPFragment() { delete [] fragmentData; }
+			SlabBlock* firstBlock;
+			// the next fragment of the packet (ordered by offset) or the next free fragment
+			uint32_t next;
 		};
 
 		struct IPFragmentData
 		{
-			uint16_t currentOffset;
-			RawPacket* data;
-			bool deleteData;
-			uint32_t fragmentID;
-			PacketKey* packetKey;
-			PointerVector<IPFragment> outOfOrderFragments;
-			IPFragmentData(PacketKey* pktKey, uint32_t fragId) { currentOffset = 0; data = NULL; deleteData = true; fragmentID = fragId; packetKey = pktKey; }
-			~IPFragmentData() { delete packetKey; if (deleteData && data != NULL) { delete data; } }
+			PacketKeyData key;
+			uint32_t hash;
+			uint32_t currentOffset;
+			// the total IP payload length of the packet, known once the last fragment arrives (0 until then)
+			uint32_t totalLength;
+			// the reassembled packet: the first fragment (including all layers below IP) followed by the in-order data. NULL until the
+			// first fragment arrives
+			uint8_t* data;
+			size_t dataLen;
+			size_t dataCapacity;
+			timespec timestamp;
+			LinkLayerType linkType;
+			// the first out-of-order fragment (the one with the lowest offset)
+			uint32_t outOfOrderFragments;
+			time_t lastSeen;
+			// links in the LRU list (most recently used first), 'next' also links free entries
+			uint32_t lruPrev;
+			uint32_t lruNext;
 		};
 
-		LRUList<uint32_t> m_PacketLRU;
-		std::map<uint32_t, IPFragmentData*> m_FragmentMap;
+		static const uint32_t InvalidIndex = 0xffffffff;
+		static const size_t MinPacketsCapacity = 64;
+		static const size_t SlabBlocksPerChunk = 64;
+
 		OnFragmentsClean m_OnFragmentsCleanCallback;
 		void* m_CallbackUserCookie;
-
-		void addNewFragment(uint32_t hash, IPFragmentData* fragData);
-		bool matchOutOfOrderFragments(IPFragmentData* fragData);
+		size_t m_MaxPacketsToStore;
+		uint64_t m_MaxBufferedBytes;
+		uint64_t m_BufferedBytes;
+		uint32_t m_Timeout;
+		// packet entries, their open-addressing (linear probing) hash table of entry indices and the LRU list
+		std::vector<IPFragmentData> m_Packets;
+		std::vector<uint32_t> m_PacketTable;
+		size_t m_NumOfPackets;
+		uint32_t m_FreePackets;
+		uint32_t m_LRUHead;
+		uint32_t m_LRUTail;
+		std::vector<IPFragment> m_Fragments;
+		uint32_t m_FreeFragments;
+		std::vector<SlabBlock*> m_SlabChunks;
+		SlabBlock* m_FreeSlabBlocks;
+
+		// private copy c'tor and assignment operator
+		IPReassembly(const IPReassembly& other);
+		IPReassembly& operator=(const IPReassembly& other);
+
+		static bool getPacketKeyData(const PacketKey& key, PacketKeyData& keyData);
+		static size_t getRequiredCapacity(const IPFragmentData& fragData, size_t appendLen);
+		uint32_t findPacket(const PacketKeyData& key, uint32_t hash) const;
+		uint32_t createPacket(const PacketKeyData& key, uint32_t hash);
+		void removePacketEntry(uint32_t packetIndex, bool fireCallback);
+		void linkAsMostRecent(uint32_t packetIndex);
+		void unlinkFromLRU(uint32_t packetIndex);
+		void removeFromTable(uint32_t packetIndex);
+		void growPacketTable();
+		void dropExpiredPackets(time_t now);
+		bool makeRoom(size_t bytes, uint32_t packetIndex);
+		bool reserveData(uint32_t packetIndex, size_t capacity);
+		bool storeOutOfOrderFragment(uint32_t packetIndex, uint32_t offset, const uint8_t* data, size_t dataLen, bool lastFragment);
+		SlabBlock* allocateSlabBlock();
+		void releaseFragment(uint32_t fragmentIndex);
+		bool matchOutOfOrderFragments(uint32_t packetIndex, bool& gotLastFragment);
 	};
 
 } // namespace pcpp
@@ -76,9 +76,24 @@ namespace pcpp
 		virtual ~Layer();
 
 		/**
-		 * @return A pointer to the next layer in the protocol stack or NULL if the layer is the last one
+		 * Layers are allocated from the LayerArena set as current on the calling thread (which is the case while a packet is being
+		 * parsed), or on the heap if there is no such arena or if the arena is full
+		 * @param[in] size The size of the layer object in bytes
+		 * @return A pointer to the allocated memory
 		 */
-		Layer* getNextLayer() const { return m_NextLayer; }
+		static void* operator new(size_t size);
+
+		/**
+		 * Frees the memory of a layer allocated by operator new(), either by returning it to its arena or to the heap
+		 * @param[in] ptr A pointer to the layer memory
+		 */
+		static void operator delete(void* ptr);
+
+		/**
+		 * @return A pointer to the next layer in the protocol stack or NULL if the layer is the last one. If the layer belongs to a packet
+		 * parsed lazily (see ::LazyParsing) and the next layer wasn't parsed yet, it's parsed now
+		 */
+		Layer* getNextLayer() const { return m_IsNextLayerPending ? parsePendingNextLayer() : m_NextLayer; }
 
 		/**
 		 * @return A pointer to the previous layer in the protocol stack or NULL if the layer is the first one
@@ -167,13 +182,15 @@ namespace pcpp
 		Layer* m_NextLayer;
 		Layer* m_PrevLayer;
 		bool m_IsAllocatedInPacket;
+		// set on the last parsed layer of a lazily parsed packet until the layer after it is parsed
+		bool m_IsNextLayerPending;
 
-		Layer() : m_Data(NULL), m_DataLen(0), m_Packet(NULL), m_Protocol(UnknownProtocol), m_NextLayer(NULL), m_PrevLayer(NULL), m_IsAllocatedInPacket(false) { }
+		Layer() : m_Data(NULL), m_DataLen(0), m_Packet(NULL), m_Protocol(UnknownProtocol), m_NextLayer(NULL), m_PrevLayer(NULL), m_IsAllocatedInPacket(false), m_IsNextLayerPending(false) { }
 
 		Layer(uint8_t* data, size_t dataLen, Layer* prevLayer, Packet* packet) :
 			m_Data(data), m_DataLen(dataLen),
 			m_Packet(packet), m_Protocol(UnknownProtocol),
-			m_NextLayer(NULL), m_PrevLayer(prevLayer), m_IsAllocatedInPacket(false) {}
+			m_NextLayer(NULL), m_PrevLayer(prevLayer), m_IsAllocatedInPacket(false), m_IsNextLayerPending(false) {}
 
 		// Copy c'tor
 		Layer(const Layer& other);
@@ -184,6 +201,9 @@ namespace pcpp
 
 		virtual bool extendLayer(int offsetInLayer, size_t numOfBytesToExtend);
 		virtual bool shortenLayer(int offsetInLayer, size_t numOfBytesToShorten);
+
+	private:
+		Layer* parsePendingNextLayer() const;
 	};
 
 } // namespace pcpp
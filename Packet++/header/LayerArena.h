@@ -0,0 +1,150 @@
+#ifndef PACKETPP_LAYER_ARENA
+#define PACKETPP_LAYER_ARENA
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @class LayerArena
+	 * A memory arena that layers created while parsing a packet are placed in. Each Packet owns one arena and reuses it every time the
+	 * packet is re-parsed (for example by Packet#setRawPacket()), so parsing packets into the same Packet object doesn't allocate any heap
+	 * memory for layers. The arena is a simple bump allocator: memory of a destroyed layer is reclaimed only when the arena is reset, which
+	 * is possible once no layer allocated from it is alive.
+	 * Layers that outlive their packet (for example layers detached by Packet#detachLayer()) keep the arena alive, it's freed when the last
+	 * of them is deleted. Allocations that don't fit in the arena fall back to the heap, and the next arena created by the packet is
+	 * big enough to contain them.
+	 * Layers pick their arena through Layer#operator new(), which uses the arena set as the current arena of the calling thread by
+	 * LayerArenaScope. This class is used internally by Packet and Layer and usually shouldn't be used directly.
+	 * Thread safety: allocate(), reset() and release() must be called only by the thread that uses the owning packet. deallocate() may be
+	 * called from any thread, so a detached layer can be handed to and deleted by another thread (for example a worker that received it
+	 * through a queue) while the packet keeps parsing on its own thread: the arena counts its live blocks atomically, it isn't reset while
+	 * such a layer is alive and it's freed by whichever thread drops the last reference to it
+	 */
+	class LayerArena
+	{
+	public:
+		/**
+		 * The capacity in bytes of the first arena a packet creates
+		 */
+		static const size_t DefaultCapacity = 1024;
+
+		/**
+		 * The maximum capacity in bytes of an arena. Packets whose layers need more memory than this use the heap for the rest of them
+		 */
+		static const size_t MaxCapacity = 64 * 1024;
+
+		/**
+		 * Create a new arena
+		 * @param[in] capacity The arena capacity in bytes. It's rounded up to the arena alignment and capped at MaxCapacity
+		 * @return A pointer to the new arena
+		 */
+		static LayerArena* create(size_t capacity = DefaultCapacity);
+
+		/**
+		 * Allocate a block from the arena
+		 * @param[in] size The block size in bytes
+		 * @return A pointer to the block or NULL if there is not enough space left in the arena
+		 */
+		void* allocate(size_t size);
+
+		/**
+		 * Notify the arena that a block allocated from it was released. If the arena was already released by its owner and this was
+		 * the last live block, the arena is freed. This method may be called from any thread
+		 */
+		void deallocate();
+
+		/**
+		 * Make all arena memory available again
+		 * @return True if the arena was reset. False if there are live blocks allocated from it or if allocations didn't fit in the
+		 * arena since the last reset, in which case the owner should release this arena and create a new one with getRecommendedCapacity()
+		 */
+		bool reset();
+
+		/**
+		 * Called by the owner of the arena when it no longer uses it. The arena is freed immediately if there are no live blocks allocated
+		 * from it, otherwise it's freed when the last of them is deallocated
+		 */
+		void release();
+
+		/**
+		 * @return The capacity needed to contain all allocations since the last reset, including those that didn't fit in the arena
+		 */
+		size_t getRecommendedCapacity() const;
+
+		/**
+		 * @return The arena capacity in bytes
+		 */
+		size_t getCapacity() const { return m_Capacity; }
+
+		/**
+		 * @return The number of blocks allocated from the arena that weren't deallocated yet. Valid only before the arena is released
+		 */
+		size_t getNumOfLiveBlocks() const;
+
+		/**
+		 * @return The arena set as the current arena of the calling thread or NULL if there is none
+		 */
+		static LayerArena* getCurrent();
+
+		/**
+		 * Set the current arena of the calling thread
+		 * @param[in] arena The arena to set, or NULL to allocate layers on the heap
+		 */
+		static void setCurrent(LayerArena* arena);
+
+	private:
+		uint8_t* m_Buffer;
+		size_t m_Capacity;
+		size_t m_Used;
+		size_t m_Requested;
+		// one reference held by the owner until release() plus one per live block, changed atomically
+		volatile long m_NumOfReferences;
+
+		LayerArena(uint8_t* buffer, size_t capacity);
+
+		// private copy c'tor
+		LayerArena(const LayerArena& other);
+		LayerArena& operator=(const LayerArena& other);
+
+		void destroy();
+	};
+
+
+	/**
+	 * @class LayerArenaScope
+	 * Sets the current arena of the calling thread for the lifetime of the object and restores the previous one when it's destroyed
+	 */
+	class LayerArenaScope
+	{
+	private:
+		LayerArena* m_PrevArena;
+
+		// private copy c'tor
+		LayerArenaScope(const LayerArenaScope& other);
+		LayerArenaScope& operator=(const LayerArenaScope& other);
+
+	public:
+		/**
+		 * A constructor for this class
+		 * @param[in] arena The arena layers created on this thread will be allocated from
+		 */
+		explicit LayerArenaScope(LayerArena* arena) : m_PrevArena(LayerArena::getCurrent()) { LayerArena::setCurrent(arena); }
+
+		/**
+		 * A destructor for this class, restores the previous arena
+		 */
+		~LayerArenaScope() { LayerArena::setCurrent(m_PrevArena); }
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_LAYER_ARENA */
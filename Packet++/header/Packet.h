@@ -14,6 +14,22 @@
 namespace pcpp
 {
 
+	class LayerArena;
+
+	/**
+	 * An enum representing the ways a Packet can parse the layers of a raw packet
+	 */
+	enum PacketParsingMode
+	{
+		/** All layers are parsed when the raw packet is set */
+		EagerParsing,
+		/** Only the first layer is parsed when the raw packet is set. The following layers are parsed one at a time, only when they're
+		 * needed: Layer#getNextLayer(), Packet#getLayerOfType() and Packet#isPacketOfType() parse only as far as they have to,
+		 * Packet#getLastLayer() and methods that modify the packet parse the rest of it. The result of parsing the whole packet
+		 * is the same as in ::EagerParsing */
+		LazyParsing
+	};
+
 	/**
 	 * @class Packet
 	 * This class represents a parsed packet. It contains the raw data (RawPacket instance), and a linked list of layers, each layer is a parsed
@@ -21,7 +37,9 @@ namespace pcpp
 	 * Ethernet protocol as PcapPlusPlus supports only Ethernet packets), the next layer will be L2.5 or L3 (e.g VLAN, IPv4, IPv6, etc.), and so on.
 	 * etc.), etc. The last layer in the linked list will be the highest in the packet.
 	 * For example: for a standard HTTP request packet the layer will look like this: EthLayer -> IPv4Layer -> TcpLayer -> HttpRequestLayer <BR>
-	 * Packet instance isn't read only. The user can add or remove layers, update current layer, etc.
+	 * Packet instance isn't read only. The user can add or remove layers, update current layer, etc.<BR>
+	 * Layers created while parsing are allocated from a memory arena owned by the packet (see LayerArena). The arena is reused when the
+	 * packet is re-parsed, so reusing a Packet object via setRawPacket() doesn't allocate heap memory for layers
 	 */
 	class Packet
 	{
@@ -33,6 +51,7 @@ namespace pcpp
 		uint64_t m_ProtocolTypes;
 		size_t m_MaxPacketLen;
 		bool m_FreeRawPacket;
+		LayerArena* m_LayerArena;
 
 	public:
 
@@ -81,19 +100,29 @@ namespace pcpp
 		 */
 		Packet(RawPacket* rawPacket, OsiModelLayer parseUntilLayer);
 
+		/**
+		 * A constructor for creating a packet out of already allocated RawPacket that lets the user choose when the packet layers are
+		 * parsed. Lazy parsing is useful when most packets are examined only up to a certain layer (for example filtered by their
+		 * IP addresses), since layers that are never reached aren't created at all
+		 * @param[in] rawPacket A pointer to the raw packet
+		 * @param[in] parsingMode Parse all layers now (::EagerParsing) or only when they're needed (::LazyParsing)
+		 * @param[in] freeRawPacket Optional parameter. A flag indicating if the destructor should also call the raw packet destructor or not. Default value is false
+		 */
+		Packet(RawPacket* rawPacket, PacketParsingMode parsingMode, bool freeRawPacket = false);
+
 		/**
 		 * A destructor for this class. Frees all layers allocated by this instance (Notice: it doesn't free layers that weren't allocated by this
 		 * class, for example layers that were added by addLayer() or insertLayer() ). In addition it frees the raw packet if it was allocated by
 		 * this instance (meaning if it was allocated by this instance constructor)
 		 */
-		virtual ~Packet() { destructPacketData(); }
+		virtual ~Packet();
 
 		/**
 		 * A copy constructor for this class. This copy constructor copies all the raw data and re-create all layers. So when the original Packet
 		 * is being freed, no data will be lost in the copied instance
 		 * @param[in] other The instance to copy from
 		 */
-		Packet(const Packet& other) { copyDataFrom(other); }
+		Packet(const Packet& other) : m_LayerArena(NULL) { copyDataFrom(other); }
 
 		/**
 		 * Assignment operator overloading. It first frees all layers allocated by this instance (Notice: it doesn't free layers that weren't allocated by this
@@ -121,6 +150,14 @@ namespace pcpp
 		 */
 		void setRawPacket(RawPacket* rawPacket, bool freeRawPacket, ProtocolType parseUntil = UnknownProtocol, OsiModelLayer parseUntilLayer = OsiModelLayerUnknown);
 
+		/**
+		 * Set a RawPacket and re-construct the packet layers, either all of them now or each of them when it's needed
+		 * @param[in] rawPacket Raw packet to set
+		 * @param[in] freeRawPacket A flag indicating if the destructor should also call the raw packet destructor or not
+		 * @param[in] parsingMode Parse all layers now (::EagerParsing) or only when they're needed (::LazyParsing)
+		 */
+		void setRawPacket(RawPacket* rawPacket, bool freeRawPacket, PacketParsingMode parsingMode);
+
 		/**
 		 * Get a pointer to the Packet's RawPacket in a read-only manner
 		 * @return A pointer to the Packet's RawPacket
@@ -134,10 +171,10 @@ namespace pcpp
 		Layer* getFirstLayer() const { return m_FirstLayer; }
 
 		/**
-		 * Get a pointer to the last (highest) layer in the packet
+		 * Get a pointer to the last (highest) layer in the packet. In a lazily parsed packet this parses all remaining layers
 		 * @return A pointer to the last (highest) layer in the packet
 		 */
-		Layer* getLastLayer() const { return m_LastLayer; }
+		Layer* getLastLayer() const { if (isParsingPending()) parseAllLayers(); return m_LastLayer; }
 
 		/**
 		 * Add a new layer as the last layer in the packet. This method gets a pointer to the new layer as a parameter
@@ -148,7 +185,7 @@ namespace pcpp
 		 * @return True if everything went well or false otherwise (an appropriate error log message will be printed in
 		 * such cases)
 		 */
-		bool addLayer(Layer* newLayer, bool ownInPacket = false) { return insertLayer(m_LastLayer, newLayer, ownInPacket); }
+		bool addLayer(Layer* newLayer, bool ownInPacket = false) { return insertLayer(getLastLayer(), newLayer, ownInPacket); }
 
 		/**
 		 * Insert a new layer after an existing layer in the packet. This method gets a pointer to the new layer as a
@@ -274,11 +311,11 @@ namespace pcpp
 		TLayer* getPrevLayerOfType(Layer* startLayer) const;
 
 		/**
-		 * Check whether the packet contains a certain protocol
+		 * Check whether the packet contains a certain protocol. In a lazily parsed packet layers are parsed until the protocol is found
 		 * @param[in] protocolType The protocol type to search
 		 * @return True if the packet contains the protocol, false otherwise
 		 */
-		bool isPacketOfType(ProtocolType protocolType) const { return m_ProtocolTypes & protocolType; }
+		bool isPacketOfType(ProtocolType protocolType) const { return (m_ProtocolTypes & protocolType) != 0 || (isParsingPending() && parseUntilProtocol(protocolType)); }
 
 		/**
 		 * Each layer can have fields that can be calculate automatically from other fields using Layer#computeCalculateFields(). This method forces all layers to calculate these
@@ -316,6 +353,15 @@ namespace pcpp
 		std::string printPacketInfo(bool timeAsLocalTime) const;
 
 		Layer* createFirstLayer(LinkLayerType linkType);
+
+		void createPacketTrailerLayer();
+
+		LayerArena* prepareLayerArena();
+
+		bool isParsingPending() const { return m_LastLayer != NULL && m_LastLayer->m_IsNextLayerPending; }
+		Layer* parseNextPendingLayer();
+		void parseAllLayers() const;
+		bool parseUntilProtocol(ProtocolType protocolType) const;
 	}; // class Packet
 
 
@@ -0,0 +1,215 @@
+#ifndef PACKETPP_PACKET_CLASSIFIER
+#define PACKETPP_PACKET_CLASSIFIER
+
+#include "Packet.h"
+#include "IpAddress.h"
+#include <vector>
+#include <map>
+
+/**
+ * @file
+ * This file includes an implementation of a multi-rule packet classifier that matches packets against large sets (tens of thousands) of
+ * 5-tuple rules, such as firewall ACLs. Each rule may specify a source and destination IPv4 or IPv6 network (address and prefix length),
+ * source and destination port ranges and an IP protocol. Any of them can be left as a wildcard.<BR>
+ * Rules are matched by their order: the first rule added has the highest priority. pcpp#PacketClassifier#classify() returns the ID of the
+ * first rule that matches a packet and pcpp#PacketClassifier#classifyAll() returns the IDs of all matching rules.<BR>
+ *
+ * The implementation uses tuple space search:
+ * - Rules are grouped by their "shape" (a tuple), i.e the IP version, the prefix lengths of both networks, whether the protocol is a wildcard
+ *   and whether each port is a wildcard, a single port or a range
+ * - Each tuple keeps a hash table of the rules' masked 5-tuples, so matching a packet against a tuple is a single hash lookup no matter
+ *   how many rules it contains. Single ports are part of the hashed key. Port ranges aren't (splitting them into port prefixes would
+ *   multiply the number of tuples), instead they're checked on the few rules that share the same hashed key
+ * - Tuples are ordered by the highest priority rule they contain, so searching for the first matching rule stops as soon as the remaining
+ *   tuples can't contain a better rule
+ *
+ * Real rule sets usually have a few dozen tuples at most, so classifying a packet costs a few dozen hash lookups no matter how many rules
+ * there are. Only IPv4 and IPv6 packets are classified; other packets never match any rule. Packets that don't have TCP or UDP ports
+ * (for example ICMP packets or non-first IP fragments) never match rules that specify ports
+ */
+
+/**
+ * @namespace pcpp
+ * @brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct PacketClassifierRule
+	 * A 5-tuple rule to be added to a PacketClassifier. A default-constructed rule matches every IPv4 and IPv6 packet; each field that's
+	 * set narrows it down
+	 */
+	struct PacketClassifierRule
+	{
+		/** A value that means any IP protocol */
+		static const int AnyProtocol = -1;
+
+		/** The ID returned when a packet matches this rule. IDs don't have to be unique, but PacketClassifier::NoMatch can't be used */
+		uint32_t ruleId;
+		/** The source network address. Only the first srcIpPrefixLength bits are compared */
+		IPAddress srcIp;
+		/** The prefix length of the source network. 0 (the default) means any source IP */
+		uint8_t srcIpPrefixLength;
+		/** The destination network address. Only the first dstIpPrefixLength bits are compared */
+		IPAddress dstIp;
+		/** The prefix length of the destination network. 0 (the default) means any destination IP */
+		uint8_t dstIpPrefixLength;
+		/** The first source port of the range (inclusive). The default range is 0-65535 which means any source port */
+		uint16_t srcPortFrom;
+		/** The last source port of the range (inclusive) */
+		uint16_t srcPortTo;
+		/** The first destination port of the range (inclusive). The default range is 0-65535 which means any destination port */
+		uint16_t dstPortFrom;
+		/** The last destination port of the range (inclusive) */
+		uint16_t dstPortTo;
+		/** The IP protocol number, for example ::PACKETPP_IPPROTO_TCP. The default is AnyProtocol */
+		int protocol;
+
+		/**
+		 * A c'tor for this struct which creates a rule that matches any IP packet
+		 * @param[in] id The rule ID
+		 */
+		PacketClassifierRule(uint32_t id = 0) :
+			ruleId(id), srcIpPrefixLength(0), dstIpPrefixLength(0),
+			srcPortFrom(0), srcPortTo(0xffff), dstPortFrom(0), dstPortTo(0xffff), protocol(AnyProtocol) {}
+	};
+
+
+	/**
+	 * @class PacketClassifier
+	 * A classifier for large sets of 5-tuple rules. Please refer to the documentation at the top of PacketClassifier.h to understand how it
+	 * works. Rules are added with addRule() and packets are classified with classify(), classifyAll() or classifyBurst(). The classify
+	 * methods don't change the object, so once all rules are added the same classifier can be used by several threads concurrently
+	 */
+	class PacketClassifier
+	{
+	public:
+		/**
+		 * The value returned by classify() when no rule matches the packet
+		 */
+		static const uint32_t NoMatch = 0xffffffff;
+
+		/**
+		 * A c'tor for this class which creates an empty classifier
+		 */
+		PacketClassifier();
+
+		/**
+		 * Add a rule. Rules added earlier have higher priority
+		 * @param[in] rule The rule to add
+		 * @return True if the rule was added, false if it's invalid (an error will be printed to log): prefix length is too long, the source
+		 * and destination networks are of different IP versions, a port range is reversed, the protocol is out of range or the rule ID is
+		 * PacketClassifier::NoMatch
+		 */
+		bool addRule(const PacketClassifierRule& rule);
+
+		/**
+		 * Remove all rules
+		 */
+		void clear();
+
+		/**
+		 * @return The number of rules added
+		 */
+		size_t getNumOfRules() const { return m_RuleIds.size(); }
+
+		/**
+		 * @return The number of distinct rule shapes (tuples). Classifying a packet takes up to one hash lookup per tuple
+		 */
+		size_t getNumOfTuples() const { return m_Tuples.size(); }
+
+		/**
+		 * Find the first (highest priority) rule that matches a packet
+		 * @param[in] packet The packet to classify. It must be parsed at least up to the transport layer
+		 * @return The ID of the first matching rule or PacketClassifier::NoMatch if no rule matches
+		 */
+		uint32_t classify(Packet& packet) const;
+
+		/**
+		 * Find the first (highest priority) rule that matches a raw packet. The packet is parsed up to the transport layer
+		 * @param[in] rawPacket The raw packet to classify
+		 * @return The ID of the first matching rule or PacketClassifier::NoMatch if no rule matches
+		 */
+		uint32_t classify(RawPacket* rawPacket) const;
+
+		/**
+		 * Find all rules that match a packet
+		 * @param[in] packet The packet to classify. It must be parsed at least up to the transport layer
+		 * @param[out] ruleIds The IDs of all matching rules ordered by their priority. The vector is cleared first
+		 * @return True if at least one rule matches, false otherwise
+		 */
+		bool classifyAll(Packet& packet, std::vector<uint32_t>& ruleIds) const;
+
+		/**
+		 * Find the first matching rule of each packet in a burst. Packets are matched together against each tuple, which uses the cache
+		 * better than classifying them one by one
+		 * @param[in] rawPackets An array of pointers to the raw packets to classify
+		 * @param[in] numOfPackets The number of packets in the array
+		 * @param[out] ruleIds An array of at least numOfPackets elements that will contain the ID of the first matching rule of each packet,
+		 * or PacketClassifier::NoMatch
+		 */
+		void classifyBurst(RawPacket* const* rawPackets, size_t numOfPackets, uint32_t* ruleIds) const;
+
+		/**
+		 * Same as classifyBurst(RawPacket* const*, size_t, uint32_t*), but for a contiguous array of raw packets such as the ones filled by
+		 * RawSocketDevice#receivePacketBurst()
+		 * @param[in] rawPackets An array of raw packets to classify
+		 * @param[in] numOfPackets The number of packets in the array
+		 * @param[out] ruleIds An array of at least numOfPackets elements that will contain the ID of the first matching rule of each packet,
+		 * or PacketClassifier::NoMatch
+		 */
+		void classifyBurst(RawPacket* rawPackets, size_t numOfPackets, uint32_t* ruleIds) const;
+
+	private:
+		// src IP (4 words), dst IP (4 words), ports, protocol/IP version/has ports
+		static const int KeyWords = 10;
+
+		struct Key
+		{
+			uint32_t words[KeyWords];
+		};
+
+		struct Entry
+		{
+			Key key;
+			// the first and last node of the entry's rule chain in m_Chain, the first one has the highest priority
+			uint32_t head;
+			uint32_t tail;
+		};
+
+		struct ChainNode
+		{
+			uint32_t ruleIndex;
+			uint32_t next;
+			uint16_t srcPortFrom;
+			uint16_t srcPortTo;
+			uint16_t dstPortFrom;
+			uint16_t dstPortTo;
+		};
+
+		struct Tuple
+		{
+			Key mask;
+			// the index of the highest priority rule in this tuple
+			uint32_t minRuleIndex;
+			std::vector<Entry> table;
+			uint32_t numOfEntries;
+		};
+
+		std::vector<uint32_t> m_RuleIds;
+		std::vector<Tuple> m_Tuples;
+		std::vector<ChainNode> m_Chain;
+		std::map<uint32_t, size_t> m_TupleBySignature;
+
+		static bool extractKey(Packet& packet, Key& key);
+		static const Entry* lookup(const Tuple& tuple, const Key& key);
+		void insert(Tuple& tuple, const Key& key, const ChainNode& node);
+		const ChainNode* findFirstMatchingNode(const Entry* entry, const Key& key) const;
+		uint32_t classifyKey(const Key& key) const;
+		void classifyKeys(const Key* keys, const bool* isValid, size_t numOfKeys, uint32_t* ruleIds) const;
+	};
+
+} // namespace pcpp
+
+#endif // PACKETPP_PACKET_CLASSIFIER
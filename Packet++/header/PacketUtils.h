@@ -29,13 +29,47 @@ namespace pcpp
 	};
 
 	/**
-	 * Computes the checksum for a vector of buffers
+	 * Computes the Internet checksum (RFC 1071) for a vector of buffers. The buffers are summed with SSE2 or AVX2 instructions when the
+	 * CPU supports them (detected at runtime), otherwise with a portable scalar implementation
 	 * @param[in] vec The vector of buffers
 	 * @param[in] vecSize Number of ScalarBuffers in vector
 	 * @return The checksum result
 	 */
 	uint16_t computeChecksum(ScalarBuffer<uint16_t> vec[], size_t vecSize);
 
+	/**
+	 * Updates an Internet checksum after a 16-bit word covered by it was changed, without going over the rest of the data (RFC 1624).
+	 * Useful for rewriting a single field, for example decrementing the IPv4 TTL. The checksum and the values must all be in the same
+	 * byte order, for example all of them as they're stored in the packet
+	 * @param[in] checksum The current checksum
+	 * @param[in] oldValue The old value of the word
+	 * @param[in] newValue The new value of the word
+	 * @return The updated checksum
+	 */
+	uint16_t updateChecksum16(uint16_t checksum, uint16_t oldValue, uint16_t newValue);
+
+	/**
+	 * Updates an Internet checksum after a 32-bit field aligned to a 16-bit word boundary was changed (RFC 1624). Useful for rewriting
+	 * an IPv4 address, for example in NAT. The checksum and the values must all be in the same byte order, for example all of them as
+	 * they're stored in the packet
+	 * @param[in] checksum The current checksum
+	 * @param[in] oldValue The old value of the field
+	 * @param[in] newValue The new value of the field
+	 * @return The updated checksum
+	 */
+	uint16_t updateChecksum32(uint16_t checksum, uint32_t oldValue, uint32_t newValue);
+
+	/**
+	 * Updates an Internet checksum after a range of bytes covered by it was changed (RFC 1624), for example an IPv6 address. The range
+	 * must start at an even offset of the checksummed data and the checksum must be in the byte order it's stored in the packet
+	 * @param[in] checksum The current checksum
+	 * @param[in] oldData The old content of the range
+	 * @param[in] newData The new content of the range
+	 * @param[in] dataLen The length of the range in bytes
+	 * @return The updated checksum
+	 */
+	uint16_t updateChecksum(uint16_t checksum, const uint8_t* oldData, const uint8_t* newData, size_t dataLen);
+
 	/**
 	 * Computes Fowler-Noll-Vo (FNV-1) 32bit hash function on an array of byte buffers. The hash is calculated on each
 	 * byte in each byte buffer, as if all byte buffers were one long byte buffer
@@ -0,0 +1,356 @@
+#ifndef PACKETPP_PATTERN_MATCHER
+#define PACKETPP_PATTERN_MATCHER
+
+#include "Packet.h"
+#include "TcpReassembly.h"
+#include <vector>
+#include <string>
+#include <map>
+
+/**
+ * @file
+ * This file includes an implementation of a multi-pattern payload search engine that finds all occurrences of a large set (thousands) of
+ * byte signatures in packet payloads or in TCP streams, in a single pass over the data.<BR>
+ * Patterns are added to a pcpp#PatternMatcher and compiled into an Aho-Corasick automaton which is stored as a deterministic state
+ * machine: each state has a transition for every input byte, so scanning costs one table lookup per byte no matter how many patterns
+ * there are. Some details about the implementation:
+ * - Bytes that don't appear in any pattern share a single byte class, so a state's row in the transition table is usually much
+ *   smaller than 256 entries. The table takes (number of states) * (number of byte classes) * 4 bytes, the number of states is at most
+ *   the total length of the patterns
+ * - Case-insensitive patterns are compiled into a second automaton whose byte classes fold upper and lower case ASCII letters. When
+ *   both kinds of patterns exist both automata are advanced on each byte
+ * - States are numbered so that all states that end a pattern come last, hence detecting a match costs a single comparison per byte
+ * - When the automaton is in its initial state and the patterns start with a small set of bytes, bytes that can't start a pattern are
+ *   skipped 16 at a time with SSSE3 (on x86 CPUs that support it) instead of going through the automaton one by one
+ *
+ * The automaton state can be carried between buffers (see pcpp#PatternMatchStream), so matches that span several TCP segments or
+ * TcpReassembly message chunks are found. pcpp#PatternFlowMatcher keeps such a state per flow and direction.<BR>
+ * Once compiled, the search methods don't change the matcher, so the same matcher can be used by several threads concurrently (each
+ * with streams of its own)
+ */
+
+/**
+ * @namespace pcpp
+ * @brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	/**
+	 * @struct PatternMatch
+	 * A single occurrence of a pattern found by PatternMatcher
+	 */
+	struct PatternMatch
+	{
+		/** The ID given to the pattern in PatternMatcher#addPattern() */
+		uint32_t patternId;
+		/** The offset of the first byte of the occurrence. In stream searches the offset is relative to the beginning of the stream and may
+		 * point to data of a previous buffer */
+		uint64_t startOffset;
+		/** The offset of the byte following the last byte of the occurrence */
+		uint64_t endOffset;
+	};
+
+
+	/**
+	 * @class PatternMatchStream
+	 * The state of a stream searched by PatternMatcher#searchStream(): the automaton state at the end of the data searched so far and the
+	 * number of bytes searched. A stream may only be used with the matcher that searched it first, and should be reset if the matcher is
+	 * compiled again
+	 */
+	class PatternMatchStream
+	{
+		friend class PatternMatcher;
+	public:
+		/**
+		 * A c'tor for this class which creates the state of a new stream
+		 */
+		PatternMatchStream() { reset(); }
+
+		/**
+		 * Reset the stream so the next searched buffer is treated as the beginning of a new stream
+		 */
+		void reset() { m_CaseSensitiveState = 0; m_CaseInsensitiveState = 0; m_Offset = 0; }
+
+		/**
+		 * Skip bytes of the stream that weren't (and won't be) searched, for example data lost in capture. A pattern isn't matched across
+		 * the skipped bytes and the offsets of the following matches take them into account
+		 * @param[in] numOfBytes The number of bytes to skip
+		 */
+		void skip(uint64_t numOfBytes) { m_CaseSensitiveState = 0; m_CaseInsensitiveState = 0; m_Offset += numOfBytes; }
+
+		/**
+		 * @return The number of bytes searched or skipped in this stream so far
+		 */
+		uint64_t getOffset() const { return m_Offset; }
+
+	private:
+		uint32_t m_CaseSensitiveState;
+		uint32_t m_CaseInsensitiveState;
+		uint64_t m_Offset;
+	};
+
+
+	/**
+	 * @typedef OnPatternMatch
+	 * A callback invoked by PatternMatcher for every occurrence of a pattern, in the order the occurrences end in the data
+	 * @param[in] match The pattern occurrence
+	 * @param[in] userCookie A pointer to the cookie provided by the user in the search method
+	 */
+	typedef void (*OnPatternMatch)(const PatternMatch& match, void* userCookie);
+
+
+	/**
+	 * @class PatternMatcher
+	 * A multi-pattern search engine. Please refer to the documentation at the top of PatternMatcher.h to understand how it works.
+	 * Patterns are added with addPattern() and compiled with compile(), then any number of buffers, packets or streams can be searched.
+	 * Searching a matcher that wasn't compiled finds nothing
+	 */
+	class PatternMatcher
+	{
+	public:
+		/**
+		 * A c'tor for this class which creates a matcher with no patterns
+		 */
+		PatternMatcher();
+
+		/**
+		 * Add a pattern. The pattern is searched for only after compile() is called
+		 * @param[in] pattern A pointer to the pattern bytes. Patterns are binary and may contain any byte value
+		 * @param[in] patternLen The pattern length
+		 * @param[in] patternId The ID reported when the pattern is found. IDs don't have to be unique
+		 * @param[in] caseInsensitive If true, ASCII letters in the pattern match both upper and lower case letters in the data
+		 * @return True if the pattern was added or false if it's empty (an error will be printed to log)
+		 */
+		bool addPattern(const uint8_t* pattern, size_t patternLen, uint32_t patternId, bool caseInsensitive = false);
+
+		/**
+		 * Add a pattern given as a string. The pattern is searched for only after compile() is called
+		 * @param[in] pattern The pattern
+		 * @param[in] patternId The ID reported when the pattern is found. IDs don't have to be unique
+		 * @param[in] caseInsensitive If true, ASCII letters in the pattern match both upper and lower case letters in the data
+		 * @return True if the pattern was added or false if it's empty (an error will be printed to log)
+		 */
+		bool addPattern(const std::string& pattern, uint32_t patternId, bool caseInsensitive = false);
+
+		/**
+		 * Compile all added patterns into the automaton that is used by the search methods. Patterns added later are searched for only
+		 * after compile() is called again
+		 * @return True if compilation succeeded or false if the automaton is too large (an error will be printed to log)
+		 */
+		bool compile();
+
+		/**
+		 * Remove all patterns
+		 */
+		void clear();
+
+		/**
+		 * @return The number of patterns added
+		 */
+		size_t getNumOfPatterns() const { return m_Patterns.size(); }
+
+		/**
+		 * @return True if all added patterns are compiled, false otherwise
+		 */
+		bool isCompiled() const { return m_IsCompiled; }
+
+		/**
+		 * @return The number of states of the compiled automata
+		 */
+		size_t getNumOfStates() const;
+
+		/**
+		 * @return The memory the compiled automata take in bytes
+		 */
+		size_t getMemoryUsage() const;
+
+		/**
+		 * Find all pattern occurrences in a buffer
+		 * @param[in] data The buffer to search
+		 * @param[in] dataLen The buffer length
+		 * @param[in] onMatch A callback invoked for every occurrence, its offsets are relative to the beginning of the buffer
+		 * @param[in] userCookie A pointer to an object provided by the user that will be passed to the callback
+		 * @return The number of occurrences found
+		 */
+		size_t search(const uint8_t* data, size_t dataLen, OnPatternMatch onMatch, void* userCookie = NULL) const;
+
+		/**
+		 * Find all pattern occurrences in a buffer
+		 * @param[in] data The buffer to search
+		 * @param[in] dataLen The buffer length
+		 * @param[out] matches The occurrences found, in the order they end in the buffer. Occurrences are appended to the vector
+		 * @return The number of occurrences found
+		 */
+		size_t search(const uint8_t* data, size_t dataLen, std::vector<PatternMatch>& matches) const;
+
+		/**
+		 * Find all pattern occurrences in the TCP or UDP payload of a packet
+		 * @param[in] packet The packet to search. It must be parsed at least up to the transport layer
+		 * @param[in] onMatch A callback invoked for every occurrence, its offsets are relative to the beginning of the payload
+		 * @param[in] userCookie A pointer to an object provided by the user that will be passed to the callback
+		 * @return The number of occurrences found. Packets without a TCP or UDP layer aren't searched and 0 is returned
+		 */
+		size_t search(Packet& packet, OnPatternMatch onMatch, void* userCookie = NULL) const;
+
+		/**
+		 * Check whether any pattern occurs in a buffer. Searching stops at the first occurrence
+		 * @param[in] data The buffer to search
+		 * @param[in] dataLen The buffer length
+		 * @return True if at least one pattern occurs in the buffer
+		 */
+		bool containsAny(const uint8_t* data, size_t dataLen) const;
+
+		/**
+		 * Find all pattern occurrences in the next buffer of a stream, including occurrences that begin in previous buffers of the stream
+		 * @param[in] stream The stream state. It's updated so the next buffer of the stream can be searched
+		 * @param[in] data The buffer to search
+		 * @param[in] dataLen The buffer length
+		 * @param[in] onMatch A callback invoked for every occurrence, its offsets are relative to the beginning of the stream
+		 * @param[in] userCookie A pointer to an object provided by the user that will be passed to the callback
+		 * @return The number of occurrences found in this buffer
+		 */
+		size_t searchStream(PatternMatchStream& stream, const uint8_t* data, size_t dataLen, OnPatternMatch onMatch, void* userCookie = NULL) const;
+
+	private:
+		struct Pattern
+		{
+			std::string bytes;
+			uint32_t id;
+			bool caseInsensitive;
+		};
+
+		// a deterministic Aho-Corasick automaton. States are kept premultiplied by numOfClasses, i.e as the offset of their row in the
+		// transition table, and the initial state is 0
+		struct Automaton
+		{
+			std::vector<uint32_t> transitions;
+			uint16_t byteClass[256];
+			uint32_t numOfClasses;
+			uint32_t numOfStates;
+			// the (premultiplied) first state that ends a pattern, all following states end a pattern as well
+			uint32_t firstMatchState;
+			// the patterns ended by match state i are matchPatterns[matchListStart[i]] .. matchPatterns[matchListStart[i + 1] - 1]
+			std::vector<uint32_t> matchListStart;
+			std::vector<uint32_t> matchPatterns;
+		};
+
+		typedef size_t (*FindStartByteFunc)(const uint8_t* data, size_t dataLen, const uint8_t* lowMask, const uint8_t* highMask, const bool* isStartByte);
+
+		std::vector<Pattern> m_Patterns;
+		Automaton m_CaseSensitive;
+		Automaton m_CaseInsensitive;
+		bool m_IsCompiled;
+		bool m_HasCaseSensitive;
+		bool m_HasCaseInsensitive;
+		// skipping of bytes that don't start any pattern
+		bool m_SkipEnabled;
+		bool m_IsStartByte[256];
+		uint8_t m_StartByteLowMask[16];
+		uint8_t m_StartByteHighMask[16];
+		FindStartByteFunc m_FindStartByte;
+
+		static void resetAutomaton(Automaton& automaton);
+		bool buildAutomaton(Automaton& automaton, bool caseInsensitive);
+		void buildStartByteSkipping();
+
+		template<bool UseCaseSensitive, bool UseCaseInsensitive>
+		size_t scan(PatternMatchStream& stream, const uint8_t* data, size_t dataLen, OnPatternMatch onMatch, void* userCookie, bool stopAtFirstMatch) const;
+		size_t dispatchScan(PatternMatchStream& stream, const uint8_t* data, size_t dataLen, OnPatternMatch onMatch, void* userCookie, bool stopAtFirstMatch) const;
+		size_t reportMatches(const Automaton& automaton, uint32_t state, uint64_t endOffset, OnPatternMatch onMatch, void* userCookie) const;
+	};
+
+
+	/**
+	 * @typedef OnFlowPatternMatch
+	 * A callback invoked by PatternFlowMatcher for every occurrence of a pattern in a flow
+	 * @param[in] flowKey The key of the flow the pattern was found in
+	 * @param[in] side The side (direction) of the flow the pattern was found in
+	 * @param[in] match The pattern occurrence. Its offsets are relative to the beginning of this side of the flow
+	 * @param[in] userCookie A pointer to the cookie provided by the user in the PatternFlowMatcher c'tor
+	 */
+	typedef void (*OnFlowPatternMatch)(uint32_t flowKey, int8_t side, const PatternMatch& match, void* userCookie);
+
+
+	/**
+	 * @class PatternFlowMatcher
+	 * Searches the data of many flows with a PatternMatcher, keeping a stream state for each side of each flow so occurrences that span
+	 * several packets or TcpReassembly message chunks are found. It's meant to be called from TcpReassembly's OnTcpMessageReady callback
+	 * (see scan(int8_t, const TcpStreamData&)) but any data with a flow key can be scanned. The flow state should be removed with
+	 * closeFlow() when a flow ends
+	 */
+	class PatternFlowMatcher
+	{
+	public:
+		/**
+		 * A c'tor for this class
+		 * @param[in] matcher The compiled matcher to search flows with. It must outlive this object
+		 * @param[in] onMatch A callback invoked for every occurrence
+		 * @param[in] userCookie A pointer to an object provided by the user that will be passed to the callback
+		 */
+		PatternFlowMatcher(const PatternMatcher& matcher, OnFlowPatternMatch onMatch, void* userCookie = NULL);
+
+		/**
+		 * Search the next data of a flow side
+		 * @param[in] flowKey The flow key, for example ConnectionData#flowKey
+		 * @param[in] side The flow side, 0 or 1
+		 * @param[in] data The data to search
+		 * @param[in] dataLen The data length
+		 * @return The number of occurrences found in this data
+		 */
+		size_t scan(uint32_t flowKey, int8_t side, const uint8_t* data, size_t dataLen);
+
+		/**
+		 * Search a message chunk reported by TcpReassembly. If bytes are missing before the chunk the stream continues after them, so no
+		 * occurrence spans the missing bytes
+		 * @param[in] side The side as reported by TcpReassembly
+		 * @param[in] tcpData The message chunk
+		 * @return The number of occurrences found in this chunk
+		 */
+		size_t scan(int8_t side, const TcpStreamData& tcpData);
+
+		/**
+		 * Remove the state of a flow. If the flow key is seen again it starts as a new flow
+		 * @param[in] flowKey The flow key
+		 */
+		void closeFlow(uint32_t flowKey);
+
+		/**
+		 * Remove the state of all flows
+		 */
+		void clear();
+
+		/**
+		 * @return The number of flows with a state
+		 */
+		size_t getNumOfFlows() const { return m_Flows.size(); }
+
+	private:
+		struct FlowState
+		{
+			PatternMatchStream sides[2];
+		};
+
+		struct MatchContext
+		{
+			PatternFlowMatcher* flowMatcher;
+			uint32_t flowKey;
+			int8_t side;
+		};
+
+		const PatternMatcher& m_Matcher;
+		OnFlowPatternMatch m_OnMatch;
+		void* m_UserCookie;
+		std::map<uint32_t, FlowState> m_Flows;
+
+		PatternMatchStream* getStream(uint32_t flowKey, int8_t side);
+		static void onStreamMatch(const PatternMatch& match, void* userCookie);
+
+		// disable copy
+		PatternFlowMatcher(const PatternFlowMatcher& other);
+		PatternFlowMatcher& operator=(const PatternFlowMatcher& other);
+	};
+
+} // namespace pcpp
+
+#endif // PACKETPP_PATTERN_MATCHER
@@ -311,8 +311,8 @@ namespace pcpp
 
 		/**
 		 * Assignment operator overload for this class. When using this operator on an already initialized RawPacket instance,
-		 * the original raw data is freed first. Then the other instance is copied to this instance, the same way the copy constructor works
-		 * @todo free raw data only if deleteRawDataAtDestructor was set to 'true'
+		 * the original raw data is freed first (only if deleteRawDataAtDestructor was set to 'true'). Then the other instance is copied to
+		 * this instance, the same way the copy constructor works
 		 * @param[in] other The instance to copy from
 		 */
 		RawPacket& operator=(const RawPacket& other);
@@ -405,13 +405,26 @@ namespace pcpp
 		bool isPacketSet() const { return m_RawPacketSet; }
 
 		/**
-		 * Clears all members of this instance, meaning setting raw data to NULL, raw data length to 0, etc. Currently raw data is always freed,
-		 * even if deleteRawDataAtDestructor was set to 'false'
-		 * @todo deleteRawDataAtDestructor was set to 'true', don't free the raw data
+		 * Clears all members of this instance, meaning setting raw data to NULL, raw data length to 0, etc. Raw data is freed only if
+		 * deleteRawDataAtDestructor was set to 'true', so raw data lent by someone else (for example: a capture engine or a zero-copy file reader)
+		 * is left untouched
 		 * @todo set timestamp to a default value as well
 		 */
 		virtual void clear();
 
+		/**
+		 * Set whether the raw data should be freed when the instance is freed, cleared or when new raw data is set. Please notice this method
+		 * doesn't free or copy the current raw data, so it's usually called on an empty instance (for example: right after clear())
+		 * @param[in] deleteRawDataAtDestructor If set to 'true' the instance owns the raw data and is responsible for freeing it. If set to 'false'
+		 * the raw data is owned by someone else and this instance only points to it
+		 */
+		void setDeleteRawDataAtDestructor(bool deleteRawDataAtDestructor) { m_DeleteRawDataAtDestructor = deleteRawDataAtDestructor; }
+
+		/**
+		 * @return True if this instance owns the raw data and frees it when the instance is freed or cleared, false otherwise
+		 */
+		bool isDeleteRawDataAtDestructor() const { return m_DeleteRawDataAtDestructor; }
+
 		/**
 		 * Append data to the end of current data. This method works without allocating more memory, it just uses memcpy() to copy dataToAppend at
 		 * the end of the current data. This means that the method assumes this memory was already allocated by the user. If it isn't the case then
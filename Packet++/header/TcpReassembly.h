@@ -3,9 +3,9 @@
 
 #include "Packet.h"
 #include "IpAddress.h"
-#include "PointerVector.h"
 #include <map>
-#include <list>
+#include <vector>
+#include <deque>
 #include <time.h>
 
 
@@ -62,6 +62,19 @@
  * - pcpp#TcpReassemblyConfiguration#closedConnectionDelay - the value of delay expressed in seconds. The minimum value is 1
  * - pcpp#TcpReassemblyConfiguration#maxNumToClean - to avoid performance overhead when the cleanup is being performed, this parameter is used. It defines the maximum number of items to be removed per one call of pcpp#TcpReassembly#purgeClosedConnections
  * - pcpp#TcpReassemblyConfiguration#maxOutOfOrderFragments - the maximum number of unmatched fragments to keep per flow before missed fragments are considered lost. A value of 0 means unlimited
+ * - pcpp#TcpReassemblyConfiguration#maxNumOfConnections - the capacity of the connection table. A value of 0 means the table grows as needed
+ * - pcpp#TcpReassemblyConfiguration#maxMemoryUsage - a cap on the memory used for connection state and out-of-order data. A value of 0 means unlimited
+ * - pcpp#TcpReassemblyConfiguration#maxOutOfOrderBytesPerConnection - the maximum number of out-of-order bytes to keep per connection before missed data is considered lost. A value of 0 means unlimited
+ * - pcpp#TcpReassemblyConfiguration#maxOutOfOrderBytes - the maximum number of out-of-order bytes to keep for all connections together. A value of 0 means unlimited
+ *
+ * __Bounded memory:__
+ * Connections are kept in an open-addressing hash table indexed by their flow key, and closed connections are scheduled for cleanup on a timer wheel
+ * with one-second slots. If pcpp#TcpReassemblyConfiguration#maxNumOfConnections or pcpp#TcpReassemblyConfiguration#maxMemoryUsage is set and a new
+ * connection or new out-of-order data would exceed it, the connections that were idle the longest are evicted: open connections are closed (with a
+ * reason of pcpp#TcpReassembly#TcpReassemblyConnectionEvicted) and removed from memory right away together with their connection information.
+ * Out-of-order data is kept sorted by sequence in buffers taken from a pool of size classes, so filling a gap doesn't require scanning or
+ * reallocating. If pcpp#TcpReassemblyConfiguration#maxOutOfOrderBytes is exceeded, the out-of-order data of the connections that were idle the
+ * longest is considered lost (and sent to the user with a missing data indication) until the total is within the limit again.
  *
  */
 
@@ -197,15 +210,42 @@ struct TcpReassemblyConfiguration
 	 */
 	uint32_t maxOutOfOrderFragments;
 
+	/** The capacity of the connection table. If the value is not 0 the table is allocated once for this number of connections, and when a new
+	 * connection arrives while the table is full the connection that was idle the longest is evicted. If the value is 0 the table grows as needed
+	 */
+	uint32_t maxNumOfConnections;
+
+	/** An approximate cap (in bytes) on the memory TcpReassembly uses for connection state and buffered out-of-order data. When it's exceeded the
+	 * connections that were idle the longest are evicted. If the value is 0 memory usage isn't limited
+	 */
+	uint64_t maxMemoryUsage;
+
+	/** The maximum number of out-of-order bytes to store per connection (both sides together) before packets are assumed permanently missed.
+	 * If the value is 0 the number of bytes isn't limited
+	 */
+	uint32_t maxOutOfOrderBytesPerConnection;
+
+	/** The maximum number of out-of-order bytes to store for all connections together. When it's exceeded the out-of-order data of the connections
+	 * that were idle the longest is considered permanently missed. If the value is 0 the number of bytes isn't limited
+	 */
+	uint64_t maxOutOfOrderBytes;
+
 	/**
 	 * A c'tor for this struct
 	 * @param[in] removeConnInfo The flag indicating whether to remove the connection data after a connection is closed. The default is true
 	 * @param[in] closedConnectionDelay How long the closed connections will not be cleaned up. The value is expressed in seconds. If it's set to 0 the default value will be used. The default is 5.
 	 * @param[in] maxNumToClean The maximum number of items to be cleaned up per one call of purgeClosedConnections. If it's set to 0 the default value will be used. The default is 30.
 	 * @param[in] maxOutOfOrderFragments The maximum number of unmatched fragments to keep per flow before missed fragments are considered lost. The default is unlimited.
+	 * @param[in] maxNumOfConnections The capacity of the connection table. The default is 0 which means the table grows as needed
+	 * @param[in] maxMemoryUsage An approximate cap (in bytes) on the memory used for connection state and out-of-order data. The default is unlimited.
+	 * @param[in] maxOutOfOrderBytesPerConnection The maximum number of out-of-order bytes to store per connection. The default is unlimited.
+	 * @param[in] maxOutOfOrderBytes The maximum number of out-of-order bytes to store for all connections together. The default is unlimited.
 	 */
-	TcpReassemblyConfiguration(bool removeConnInfo = true, uint32_t closedConnectionDelay = 5, uint32_t maxNumToClean = 30, uint32_t maxOutOfOrderFragments = 0) :
-		removeConnInfo(removeConnInfo), closedConnectionDelay(closedConnectionDelay), maxNumToClean(maxNumToClean), maxOutOfOrderFragments(maxOutOfOrderFragments)
+	TcpReassemblyConfiguration(bool removeConnInfo = true, uint32_t closedConnectionDelay = 5, uint32_t maxNumToClean = 30, uint32_t maxOutOfOrderFragments = 0,
+		uint32_t maxNumOfConnections = 0, uint64_t maxMemoryUsage = 0, uint32_t maxOutOfOrderBytesPerConnection = 0, uint64_t maxOutOfOrderBytes = 0) :
+		removeConnInfo(removeConnInfo), closedConnectionDelay(closedConnectionDelay), maxNumToClean(maxNumToClean), maxOutOfOrderFragments(maxOutOfOrderFragments),
+		maxNumOfConnections(maxNumOfConnections), maxMemoryUsage(maxMemoryUsage), maxOutOfOrderBytesPerConnection(maxOutOfOrderBytesPerConnection),
+		maxOutOfOrderBytes(maxOutOfOrderBytes)
 	{
 	}
 };
@@ -227,7 +267,9 @@ public:
 		/** Connection ended because of FIN or RST packet */
 		TcpReassemblyConnectionClosedByFIN_RST,
 		/** Connection ended manually by the user */
-		TcpReassemblyConnectionClosedManually
+		TcpReassemblyConnectionClosedManually,
+		/** Connection was evicted because the connection table or the memory cap was full */
+		TcpReassemblyConnectionEvicted
 	};
 
 	/**
@@ -318,7 +360,7 @@ public:
 	 * @typedef OnTcpConnectionEnd
 	 * A callback invoked when a TCP connection is terminated, either by a FIN or RST packet or manually by the user
 	 * @param[in] connectionData Connection information
-	 * @param[in] reason The reason for connection termination: FIN/RST packet or manually by the user
+	 * @param[in] reason The reason for connection termination: FIN/RST packet, manually by the user or evicted because of the connection table or memory limits
 	 * @param[in] userCookie A pointer to the cookie provided by the user in TcpReassembly c'tor (or NULL if no cookie provided)
 	 */
 	typedef void (*OnTcpConnectionEnd)(const ConnectionData& connectionData, ConnectionEndReason reason, void* userCookie);
@@ -333,6 +375,11 @@ public:
 	 */
 	TcpReassembly(OnTcpMessageReady onMessageReadyCallback, void* userCookie = NULL, OnTcpConnectionStart onConnectionStartCallback = NULL, OnTcpConnectionEnd onConnectionEndCallback = NULL, const TcpReassemblyConfiguration &config = TcpReassemblyConfiguration());
 
+	/**
+	 * A d'tor for this class. Frees all connection data (without invoking any callback)
+	 */
+	~TcpReassembly();
+
 	/**
 	 * The most important method of this class which gets a packet from the user and processes it. If this packet opens a new connection, ends a connection or contains new data on an
 	 * existing connection, the relevant callback will be called (TcpReassembly#OnTcpMessageReady, TcpReassembly#OnTcpConnectionStart, TcpReassembly#OnTcpConnectionEnd)
@@ -382,23 +429,42 @@ public:
 	 */
 	uint32_t purgeClosedConnections(uint32_t maxNumToClean = 0);
 
+	/**
+	 * @return The number of connections currently managed by this TcpReassembly instance (both open and closed connections which weren't cleaned up yet)
+	 */
+	size_t getNumOfConnections() const { return m_NumOfConnections; }
+
+	/**
+	 * @return The approximate number of bytes currently used for connection state and buffered out-of-order data. This is the value
+	 * compared against TcpReassemblyConfiguration#maxMemoryUsage
+	 */
+	uint64_t getMemoryUsage() const { return m_MemoryUsage; }
+
+	/**
+	 * @return The number of out-of-order bytes currently stored for all connections. This is the value compared against
+	 * TcpReassemblyConfiguration#maxOutOfOrderBytes
+	 */
+	uint64_t getOutOfOrderBytes() const { return m_OutOfOrderBytes; }
+
 private:
+	// the fragment header and its data are a single allocation, the data follows the header
 	struct TcpFragment
 	{
 		uint32_t sequence;
 		size_t dataLength;
+		size_t capacity;
 		uint8_t* data;
-
-		TcpFragment() : sequence(0), dataLength(0), data(NULL) {}
-		~TcpFragment() { delete [] data; }
 	};
 
+	// sorted by sequence, so the fragments that can fill the current gap are always at the front
+	typedef std::deque<TcpFragment*> TcpFragmentList;
+
 	struct TcpOneSideData
 	{
 		IPAddress srcIP;
 		uint16_t srcPort;
 		uint32_t sequence;
-		PointerVector<TcpFragment> tcpFragmentList;
+		TcpFragmentList tcpFragmentList;
 		bool gotFinOrRst;
 
 		TcpOneSideData() : srcPort(0), sequence(0), gotFinOrRst(false) {}
@@ -411,33 +477,105 @@ private:
 		int8_t prevSide;
 		TcpOneSideData twoSides[2];
 		ConnectionData connData;
+		// the number of out-of-order bytes stored for both sides
+		size_t outOfOrderBytes;
+		// links in the idle list (least recently seen first)
+		uint32_t idlePrev;
+		uint32_t idleNext;
+		// links in the cleanup timer wheel slot, and the time the connection is due to be cleaned up (0 if it isn't scheduled)
+		uint32_t cleanupPrev;
+		uint32_t cleanupNext;
+		time_t cleanupTime;
+
+		TcpReassemblyData() { clear(); }
+
+		void clear();
+	};
 
-		TcpReassemblyData() : closed(false), numOfSides(0), prevSide(-1) {}
+	struct ConnectionTableSlot
+	{
+		uint32_t flowKey;
+		uint32_t connIndex;
 	};
-	
-	typedef std::map<uint32_t, TcpReassemblyData> ConnectionList;
-	typedef std::map<time_t, std::list<uint32_t> > CleanupList;
+
+	static const uint32_t InvalidConnIndex = 0xffffffff;
+	static const uint32_t ConnectionBlockSize = 256;
+	// free fragments are pooled by size class: class i holds fragments with a capacity of (MinFragmentCapacity << i) bytes
+	static const size_t MinFragmentCapacity = 128;
+	static const int NumOfFragmentSizeClasses = 10;
 
 	OnTcpMessageReady m_OnMessageReadyCallback;
 	OnTcpConnectionStart m_OnConnStart;
 	OnTcpConnectionEnd m_OnConnEnd;
 	void* m_UserCookie;
-	ConnectionList m_ConnectionList;
+	// connection data is allocated in fixed-size blocks so pointers to it stay valid while the table grows
+	std::vector<TcpReassemblyData*> m_ConnectionBlocks;
+	std::vector<uint32_t> m_FreeConnections;
+	// open-addressing (linear probing) table from flow key to connection index
+	std::vector<ConnectionTableSlot> m_ConnectionTable;
+	size_t m_NumOfConnections;
+	uint32_t m_IdleListHead;
+	uint32_t m_IdleListTail;
 	ConnectionInfoList m_ConnectionInfo;
-	CleanupList m_CleanupList;
+	std::vector<uint32_t> m_CleanupWheel;
+	time_t m_CleanupWheelTime;
 	bool m_RemoveConnInfo;
 	uint32_t m_ClosedConnectionDelay;
 	uint32_t m_MaxNumToClean;
 	size_t m_MaxOutOfOrderFragments;
+	size_t m_MaxNumOfConnections;
+	uint64_t m_MaxMemoryUsage;
+	uint64_t m_MemoryUsage;
+	size_t m_MaxOutOfOrderBytesPerConnection;
+	uint64_t m_MaxOutOfOrderBytes;
+	uint64_t m_OutOfOrderBytes;
+	std::vector<TcpFragment*> m_FragmentPool[NumOfFragmentSizeClasses];
+	size_t m_FragmentPoolBytes;
 	time_t m_PurgeTimepoint;
 
+	// private copy c'tor and assignment operator
+	TcpReassembly(const TcpReassembly& other);
+	TcpReassembly& operator=(const TcpReassembly& other);
+
 	void checkOutOfOrderFragments(TcpReassemblyData* tcpReassemblyData, int8_t sideIndex, bool cleanWholeFragList);
 
 	void handleFinOrRst(TcpReassemblyData* tcpReassemblyData, int8_t sideIndex, uint32_t flowKey);
 
 	void closeConnectionInternal(uint32_t flowKey, ConnectionEndReason reason);
 
-	void insertIntoCleanupList(uint32_t flowKey);
+	void insertIntoCleanupList(uint32_t connIndex);
+
+	void removeFromCleanupList(uint32_t connIndex);
+
+	TcpReassemblyData* getConnection(uint32_t connIndex) const { return &m_ConnectionBlocks[connIndex / ConnectionBlockSize][connIndex % ConnectionBlockSize]; }
+
+	size_t getTableSlot(uint32_t flowKey) const { return (flowKey ^ (flowKey >> 16)) & (m_ConnectionTable.size() - 1); }
+
+	uint32_t findConnection(uint32_t flowKey) const;
+
+	uint32_t createConnection(uint32_t flowKey);
+
+	void removeConnection(uint32_t connIndex);
+
+	void growConnectionTable();
+
+	void touchConnection(uint32_t connIndex);
+
+	void unlinkFromIdleList(uint32_t connIndex);
+
+	bool evictIdleConnection(uint32_t connIndexToKeep);
+
+	TcpFragment* allocateFragment(size_t dataLength);
+
+	void releaseFragment(TcpFragment* fragment);
+
+	void addFragment(TcpReassemblyData* tcpReassemblyData, int8_t sideIndex, uint32_t sequence, const uint8_t* data, size_t dataLength);
+
+	void removeFirstFragment(TcpReassemblyData* tcpReassemblyData, int8_t sideIndex);
+
+	bool isOutOfOrderDataWithinLimits(const TcpReassemblyData* tcpReassemblyData, int8_t sideIndex) const;
+
+	void releaseOutOfOrderData(uint32_t connIndexToReleaseLast);
 };
 
 }
@@ -1,7 +1,7 @@
 #ifndef PACKETPP_TEXT_BASED_PROTOCOL_LAYER
 #define PACKETPP_TEXT_BASED_PROTOCOL_LAYER
 
-#include <map>
+#include <string>
 #include "Layer.h"
 
 /// @file
@@ -86,6 +86,7 @@ private:
 	HeaderField *getNextField() const;
 	void initNewField(std::string name, std::string value);
 	void attachToTextBasedProtocolMessage(TextBasedProtocolMessage* message, int fieldOffsetInMessage);
+	bool isNameEqual(const char* name, size_t nameLen, int knownNameId) const;
 
 	uint8_t* m_NewFieldData;
 	TextBasedProtocolMessage* m_TextBasedProtocolMessage;
@@ -98,6 +99,10 @@ private:
 	bool m_IsEndOfHeaderField;
 	char m_NameValueSeperator;
 	bool m_SpacesAllowedBetweenNameAndValue;
+	// the ID of a well-known field name (such as "Host" or "Call-ID") or -1 for other names
+	int m_KnownNameId;
+	// the order in which the field was added to the message. Fields with the same name are indexed in this order
+	uint32_t m_InsertionOrder;
 };
 
 
@@ -233,7 +238,7 @@ public:
 
 protected:
 	TextBasedProtocolMessage(uint8_t* data, size_t dataLen, Layer* prevLayer, Packet* packet);
-	TextBasedProtocolMessage() : m_FieldList(NULL), m_LastField(NULL), m_FieldsOffset(0) {}
+	TextBasedProtocolMessage() : m_FieldList(NULL), m_LastField(NULL), m_FieldsOffset(0), m_InlineFieldsInUse(0), m_NextInsertionOrder(0) {}
 
 	// copy c'tor
 	TextBasedProtocolMessage(const TextBasedProtocolMessage& other);
@@ -251,7 +256,22 @@ protected:
 	HeaderField* m_FieldList;
 	HeaderField* m_LastField;
 	int m_FieldsOffset;
-	std::multimap<std::string, HeaderField*> m_FieldNameToFieldMap;
+
+private:
+	// the first fields of a message are constructed in storage inside the message object, so parsing a typical message doesn't allocate
+	static const int NumOfInlineFields = 16;
+
+	union
+	{
+		uint8_t m_InlineFieldStorage[NumOfInlineFields * sizeof(HeaderField)];
+		void* m_InlineFieldAlignment;
+		uint64_t m_InlineFieldAlignment64;
+	};
+	uint32_t m_InlineFieldsInUse;
+	uint32_t m_NextInsertionOrder;
+
+	void* allocateFieldStorage();
+	void freeField(HeaderField* field);
 };
 
 
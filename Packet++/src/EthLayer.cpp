@@ -76,10 +76,10 @@ void EthLayer::parseNextLayer()
 
 void EthLayer::computeCalculateFields()
 {
-	if (m_NextLayer == NULL)
+	if (getNextLayer() == NULL)
 		return;
 
-	switch (m_NextLayer->getProtocol())
+	switch (getNextLayer()->getProtocol())
 	{
 	case IPv4:
 		getEthHeader()->etherType = htobe16(PCPP_ETHERTYPE_IP);
@@ -97,9 +97,9 @@ uint8_t* GreLayer::getFieldValue(GreField field, bool returnOffsetEvenIfFieldMis
 void GreLayer::computeCalculateFieldsInner()
 {
 	gre_basic_header* header = (gre_basic_header*)m_Data;
-	if (m_NextLayer != NULL)
+	if (getNextLayer() != NULL)
 	{
-		switch (m_NextLayer->getProtocol())
+		switch (getNextLayer()->getProtocol())
 		{
 		case IPv4:
 			header->protocol = htobe16(PCPP_ETHERTYPE_IP);
@@ -595,9 +595,9 @@ void PPP_PPTPLayer::parseNextLayer()
 void PPP_PPTPLayer::computeCalculateFields()
 {
 	ppp_pptp_header* header = getPPP_PPTPHeader();
-	if (m_NextLayer != NULL)
+	if (getNextLayer() != NULL)
 	{
-		switch (m_NextLayer->getProtocol())
+		switch (getNextLayer()->getProtocol())
 		{
 		case IPv4:
 			header->protocol = htobe16(PCPP_PPP_IP);
@@ -53,7 +53,7 @@ public:
 	virtual uint16_t getFragmentOffset() = 0;
 	virtual uint32_t getFragmentId() = 0;
 	virtual uint32_t hashPacket() = 0;
-	virtual IPReassembly::PacketKey* createPacketKey() = 0;
+	virtual void copyAddresses(uint8_t* srcIP, uint8_t* dstIP) = 0;
 
 	virtual uint8_t* getIPLayerPayload() = 0;
 	virtual size_t getIPLayerPayloadSize() = 0;
@@ -114,9 +114,10 @@ public:
 		return pcpp::fnvHash(vec, 3);
 	}
 
-	IPReassembly::PacketKey* createPacketKey()
+	void copyAddresses(uint8_t* srcIP, uint8_t* dstIP)
 	{
-		return new IPReassembly::IPv4PacketKey(be16toh(m_IPLayer->getIPv4Header()->ipId), m_IPLayer->getSrcIpAddress(), m_IPLayer->getDstIpAddress());
+		memcpy(srcIP, &m_IPLayer->getIPv4Header()->ipSrc, 4);
+		memcpy(dstIP, &m_IPLayer->getIPv4Header()->ipDst, 4);
 	}
 
 	uint8_t* getIPLayerPayload()
@@ -200,9 +201,10 @@ public:
 		return pcpp::fnvHash(vec, 3);
 	}
 
-	IPReassembly::PacketKey* createPacketKey()
+	void copyAddresses(uint8_t* srcIP, uint8_t* dstIP)
 	{
-		return new IPReassembly::IPv6PacketKey(be32toh(m_FragHeader->getFragHeader()->id), m_IPLayer->getSrcIpAddress(), m_IPLayer->getDstIpAddress());
+		memcpy(srcIP, m_IPLayer->getIPv6Header()->ipSrc, 16);
+		memcpy(dstIP, m_IPLayer->getIPv6Header()->ipDst, 16);
 	}
 
 	uint8_t* getIPLayerPayload()
@@ -262,14 +264,38 @@ uint32_t IPReassembly::IPv6PacketKey::getHashValue() const
 
 
 
+static inline size_t getTableSlot(uint32_t hash, size_t tableSize)
+{
+	return (hash ^ (hash >> 16)) & (tableSize - 1);
+}
+
+
+bool IPReassembly::PacketKeyData::operator==(const PacketKeyData& other) const
+{
+	return fragmentID == other.fragmentID && protocol == other.protocol &&
+			memcmp(srcIP, other.srcIP, sizeof(srcIP)) == 0 && memcmp(dstIP, other.dstIP, sizeof(dstIP)) == 0;
+}
+
+IPReassembly::IPReassembly(OnFragmentsClean onFragmentsCleanCallback, void *callbackUserCookie, size_t maxPacketsToStore, uint64_t maxBufferedBytes, uint32_t timeout)
+	: m_OnFragmentsCleanCallback(onFragmentsCleanCallback), m_CallbackUserCookie(callbackUserCookie), m_MaxPacketsToStore(maxPacketsToStore),
+	  m_MaxBufferedBytes(maxBufferedBytes), m_BufferedBytes(0), m_Timeout(timeout), m_NumOfPackets(0), m_FreePackets(InvalidIndex),
+	  m_LRUHead(InvalidIndex), m_LRUTail(InvalidIndex), m_FreeFragments(InvalidIndex), m_FreeSlabBlocks(NULL)
+{
+	// packet entries are referred to by 32-bit indices
+	if (m_MaxPacketsToStore == 0)
+		m_MaxPacketsToStore = 1;
+	else if (m_MaxPacketsToStore >= (size_t)InvalidIndex)
+		m_MaxPacketsToStore = (size_t)InvalidIndex - 1;
+}
+
 IPReassembly::~IPReassembly()
 {
-	// empty the map - go over all keys, delete all IPFragmentData objects and remove them from the map
-	while (!m_FragmentMap.empty())
-	{
-		delete m_FragmentMap.begin()->second;
-		m_FragmentMap.erase(m_FragmentMap.begin());
-	}
+	// free entries have no data so it's safe to go over all of them
+	for (std::vector<IPFragmentData>::iterator iter = m_Packets.begin(); iter != m_Packets.end(); ++iter)
+		delete [] iter->data;
+
+	for (std::vector<SlabBlock*>::iterator iter = m_SlabChunks.begin(); iter != m_SlabChunks.end(); ++iter)
+		delete [] *iter;
 }
 
 Packet* IPReassembly::processPacket(Packet* fragment, ReassemblyStatus& status, ProtocolType parseUntil, OsiModelLayer parseUntilLayer)
@@ -284,17 +310,21 @@ Packet* IPReassembly::processPacket(Packet* fragment, ReassemblyStatus& status,
 		return fragment;
 	}
 
-	// get IPv4 layer
-	//IPv4Layer* ipLayer = fragment->getLayerOfType<IPv4Layer>();
-
 	// create fragment wrapper
 	IPv4FragmentWrapper ipv4Wrapper(fragment);
 	IPv6FragmentWrapper ipv6Wrapper(fragment);
 	IPFragmentWrapper* fragWrapper = NULL;
+	ProtocolType protocol = UnknownProtocol;
 	if (fragment->isPacketOfType(IPv4))
+	{
 		fragWrapper = &ipv4Wrapper;
+		protocol = IPv4;
+	}
 	else // fragment->isPacketOfType(IPv6)
+	{
 		fragWrapper = &ipv6Wrapper;
+		protocol = IPv6;
+	}
 
 	// packet is not a fragment
 	if (!(fragWrapper->isFragment()))
@@ -307,47 +337,72 @@ Packet* IPReassembly::processPacket(Packet* fragment, ReassemblyStatus& status,
 	// create a hash from source IP, destination IP and IP/fragment ID
 	uint32_t hash = fragWrapper->hashPacket();
 
-	IPFragmentData* fragData = NULL;
+	PacketKeyData key;
+	memset(&key, 0, sizeof(key));
+	key.protocol = protocol;
+	key.fragmentID = fragWrapper->getFragmentId();
+	fragWrapper->copyAddresses(key.srcIP, key.dstIP);
 
-	// check whether this packet already exists in the map
-	std::map<uint32_t, IPFragmentData*>::iterator iter = m_FragmentMap.find(hash);
+	RawPacket* rawFragment = fragment->getRawPacket();
+	time_t now = rawFragment->getPacketTimeStamp().tv_sec;
+	if (m_Timeout > 0)
+		dropExpiredPackets(now);
+
+	// check whether this packet already exists in the table
+	uint32_t packetIndex = findPacket(key, hash);
 
 	// this is the first fragment seen for this packet
-	if (iter == m_FragmentMap.end())
+	if (packetIndex == InvalidIndex)
 	{
-		LOG_DEBUG("Got new packet with FragID=0x%X, allocating place in map", fragWrapper->getFragmentId());
-
-		// create the IPFragmentData object
-		fragData = new IPFragmentData(fragWrapper->createPacketKey(), fragWrapper->getFragmentId());
-
-		// add the new fragment to the map
-		addNewFragment(hash, fragData);
+		LOG_DEBUG("Got new packet with FragID=0x%X, allocating place in table", fragWrapper->getFragmentId());
+		packetIndex = createPacket(key, hash);
 	}
-	else // packet was seen before
+	else // packet was seen before, mark it as used
 	{
-		// get the IPFragmentData object
-		fragData = iter->second;
-
-		// mark this packet as used
-		m_PacketLRU.put(hash, NULL);
+		unlinkFromLRU(packetIndex);
+		linkAsMostRecent(packetIndex);
 	}
 
+	IPFragmentData* fragData = &m_Packets[packetIndex];
+	fragData->lastSeen = now;
+
 	bool gotLastFragment = false;
+	size_t payloadSize = fragWrapper->getIPLayerPayloadSize();
 
 	// if current fragment is the first fragment of this packet
 	if (fragWrapper->isFirstFragment())
 	{
 		if (fragData->data == NULL) // first fragment
 		{
-			LOG_DEBUG("[FragID=0x%X] Got first fragment, allocating RawPacket", fragWrapper->getFragmentId());
-
-			// create the reassembled packet and copy the fragment data to it
-			fragData->data = new RawPacket(*(fragment->getRawPacket()));
-			fragData->currentOffset = fragWrapper->getIPLayerPayloadSize();
+			LOG_DEBUG("[FragID=0x%X] Got first fragment, copying its data", fragWrapper->getFragmentId());
 			status = FIRST_FRAGMENT;
 
+			// if the last fragment already arrived the buffer can be allocated at its final size
+			size_t rawDataLen = (size_t)rawFragment->getRawDataLen();
+			size_t capacity = rawDataLen;
+			if (fragData->totalLength > payloadSize)
+				capacity += fragData->totalLength - payloadSize;
+
+			if (!reserveData(packetIndex, capacity))
+			{
+				LOG_DEBUG("[FragID=0x%X] Not enough room to buffer the fragment, dropping the packet", fragWrapper->getFragmentId());
+				removePacketEntry(packetIndex, true);
+				return NULL;
+			}
+
+			// copy the fragment data to the reassembled packet
+			memcpy(fragData->data, rawFragment->getRawData(), rawDataLen);
+			fragData->dataLen = rawDataLen;
+			fragData->currentOffset = payloadSize;
+			fragData->timestamp = rawFragment->getPacketTimeStamp();
+			fragData->linkType = rawFragment->getLinkLayerType();
+
 			// check if the next fragments already arrived out-of-order and waiting in the out-of-order list
-			gotLastFragment = matchOutOfOrderFragments(fragData);
+			if (!matchOutOfOrderFragments(packetIndex, gotLastFragment))
+			{
+				removePacketEntry(packetIndex, true);
+				return NULL;
+			}
 		}
 		else // duplicated first fragment
 		{
@@ -376,39 +431,55 @@ Packet* IPReassembly::processPacket(Packet* fragment, ReassemblyStatus& status,
 
 			LOG_DEBUG("[FragID=0x%X] Found next matching fragment with offset %d, adding fragment data to reassembled packet", fragWrapper->getFragmentId(), (int)fragOffset);
 
-			size_t payloadSize = fragWrapper->getIPLayerPayloadSize();
-			// copy fragment data to reassembled packet
-			fragData->data->reallocateData(fragData->data->getRawDataLen() + payloadSize);
-			fragData->data->appendData(fragWrapper->getIPLayerPayload(), payloadSize);
+			if (fragWrapper->isLastFragment())
+				fragData->totalLength = fragOffset + payloadSize;
+
+			if (!reserveData(packetIndex, getRequiredCapacity(*fragData, payloadSize)))
+			{
+				LOG_DEBUG("[FragID=0x%X] Not enough room to buffer the fragment, dropping the packet", fragWrapper->getFragmentId());
+				status = FRAGMENT;
+				removePacketEntry(packetIndex, true);
+				return NULL;
+			}
 
-			// update expected offset
+			// copy fragment data to reassembled packet and update expected offset
+			memcpy(fragData->data + fragData->dataLen, fragWrapper->getIPLayerPayload(), payloadSize);
+			fragData->dataLen += payloadSize;
 			fragData->currentOffset += payloadSize;
 
 			// if this is the last fragment - mark it
 			if (fragWrapper->isLastFragment())
 				gotLastFragment = true;
-			else
-				// if not the last fragment - check if the next fragments are waiting in the out-of-order list
-				gotLastFragment = matchOutOfOrderFragments(fragData);
+			// if not the last fragment - check if the next fragments are waiting in the out-of-order list
+			else if (!matchOutOfOrderFragments(packetIndex, gotLastFragment))
+			{
+				status = FRAGMENT;
+				removePacketEntry(packetIndex, true);
+				return NULL;
+			}
 		}
 		// if current fragment offset is larger than expected - this means this fragment is out-of-order
 		else if (fragOffset > fragData->currentOffset)
 		{
 			LOG_DEBUG("[FragID=0x%X] Got out-of-ordered fragment with offset %d (expected: %d). Adding it to out-of-order list", fragWrapper->getFragmentId(), (int)fragOffset, (int)fragData->currentOffset);
+			status = OUT_OF_ORDER_FRAGMENT;
 
-			// create a new IPFragment and copy the fragment data and params to it
-			size_t payloadSize = fragWrapper->getIPLayerPayloadSize();
-			IPFragment* newFrag = new IPFragment();
-			newFrag->fragmentOffset = fragWrapper->getFragmentOffset();
-			newFrag->fragmentData = new uint8_t[payloadSize];
-			newFrag->fragmentDataLen = payloadSize;
-			memcpy(newFrag->fragmentData, fragWrapper->getIPLayerPayload(), newFrag->fragmentDataLen);
-			newFrag->lastFragment = fragWrapper->isLastFragment();
+			bool stored = storeOutOfOrderFragment(packetIndex, fragOffset, fragWrapper->getIPLayerPayload(), payloadSize, fragWrapper->isLastFragment());
 
-			// store the IPFragment in the out-of-order fragment list
-			fragData->outOfOrderFragments.pushBack(newFrag);
+			// now that the total length is known the reassembled packet can get its final size
+			if (stored && fragWrapper->isLastFragment())
+			{
+				fragData->totalLength = fragOffset + payloadSize;
+				if (fragData->data != NULL)
+					stored = reserveData(packetIndex, getRequiredCapacity(*fragData, 0));
+			}
+
+			if (!stored)
+			{
+				LOG_DEBUG("[FragID=0x%X] Not enough room to buffer the fragment, dropping the packet", fragWrapper->getFragmentId());
+				removePacketEntry(packetIndex, true);
+			}
 
-			status = OUT_OF_ORDER_FRAGMENT;
 			return NULL;
 		}
 		else
@@ -422,28 +493,38 @@ Packet* IPReassembly::processPacket(Packet* fragment, ReassemblyStatus& status,
 	if (gotLastFragment)
 	{
 		LOG_DEBUG("[FragID=0x%X] Reassembly process completed, allocating a packet and returning it", fragWrapper->getFragmentId());
-		fragData->deleteData = false;
+
+		// hand the reassembled data over to a RawPacket and remove the packet from the table
+		RawPacket* reassembledRawPacket = new RawPacket(fragData->data, (int)fragData->dataLen, fragData->timestamp, true, fragData->linkType);
+		uint32_t reassembledLength = fragData->currentOffset;
+		m_BufferedBytes -= fragData->dataCapacity;
+		fragData->data = NULL;
+		fragData->dataLen = 0;
+		fragData->dataCapacity = 0;
+
+		LOG_DEBUG("[FragID=0x%X] Deleting fragment data from table", fragWrapper->getFragmentId());
+		removePacketEntry(packetIndex, false);
 
 		// fix IP length field
-		if (fragData->packetKey->getProtocolType() == IPv4)
+		if (protocol == IPv4)
 		{
-			Packet tempPacket(fragData->data, IPv4);
+			Packet tempPacket(reassembledRawPacket, IPv4);
 			IPv4Layer* ipLayer = tempPacket.getLayerOfType<IPv4Layer>();
 			iphdr* iphdr = ipLayer->getIPv4Header();
-			iphdr->totalLength = htobe16(fragData->currentOffset + ipLayer->getHeaderLen());
+			iphdr->totalLength = htobe16(reassembledLength + ipLayer->getHeaderLen());
 			iphdr->fragmentOffset = 0;
 		}
 		else
 		{
-			Packet tempPacket(fragData->data, IPv6);
+			Packet tempPacket(reassembledRawPacket, IPv6);
 			IPv6Layer* ipLayer = tempPacket.getLayerOfType<IPv6Layer>();
-			tempPacket.getLayerOfType<IPv6Layer>()->getIPv6Header()->payloadLength = fragData->currentOffset + ipLayer->getHeaderLen();
+			tempPacket.getLayerOfType<IPv6Layer>()->getIPv6Header()->payloadLength = reassembledLength + ipLayer->getHeaderLen();
 		}
 
 		// create a new Packet object with the reassembled data as its RawPacket
-		Packet* reassembledPacket = new Packet(fragData->data, true, parseUntil, parseUntilLayer);
+		Packet* reassembledPacket = new Packet(reassembledRawPacket, true, parseUntil, parseUntilLayer);
 
-		if (fragData->packetKey->getProtocolType() == IPv4)
+		if (protocol == IPv4)
 		{
 			// re-calculate all IPv4 fields
 			reassembledPacket->getLayerOfType<IPv4Layer>()->computeCalculateFields();
@@ -458,12 +539,6 @@ Packet* IPReassembly::processPacket(Packet* fragment, ReassemblyStatus& status,
 			ipLayer->computeCalculateFields();
 		}
 
-		LOG_DEBUG("[FragID=0x%X] Deleting fragment data from map", fragWrapper->getFragmentId());
-
-		// delete the IPFragmentData object and remove it from the map
-		delete fragData;
-		m_FragmentMap.erase(iter);
-		m_PacketLRU.eraseElement(hash);
 		status = REASSEMBLED;
 		return reassembledPacket;
 	}
@@ -487,56 +562,55 @@ Packet* IPReassembly::processPacket(RawPacket* fragment, ReassemblyStatus& statu
 
 Packet* IPReassembly::getCurrentPacket(const PacketKey& key)
 {
-	// create a hash out of the packet key
-	uint32_t hash = key.getHashValue();
+	PacketKeyData keyData;
+	if (!getPacketKeyData(key, keyData))
+		return NULL;
 
-	// look for this hash value in the map
-	std::map<uint32_t, IPFragmentData*>::iterator iter = m_FragmentMap.find(hash);
+	// look for this packet in the table
+	uint32_t packetIndex = findPacket(keyData, key.getHashValue());
 
-	// hash was found
-	if (iter != m_FragmentMap.end())
+	// packet was found and some data already exists
+	if (packetIndex != InvalidIndex && m_Packets[packetIndex].data != NULL)
 	{
-		IPFragmentData* fragData = iter->second;
+		const IPFragmentData& fragData = m_Packets[packetIndex];
 
-		// some data already exists
-		if (fragData != NULL && fragData->data != NULL)
-		{
-			// create a copy of the RawPacket object
-			RawPacket* partialRawPacket = new RawPacket(*(fragData->data));
-
-			// fix IP length field
-			if (fragData->packetKey->getProtocolType() == IPv4)
-			{
-				Packet tempPacket(partialRawPacket, IPv4);
-				IPv4Layer* ipLayer = tempPacket.getLayerOfType<IPv4Layer>();
-				ipLayer->getIPv4Header()->totalLength = htobe16(fragData->currentOffset + ipLayer->getHeaderLen());
-			}
-			else
-			{
-				Packet tempPacket(partialRawPacket, IPv6);
-				IPv6Layer* ipLayer = tempPacket.getLayerOfType<IPv6Layer>();
-				tempPacket.getLayerOfType<IPv6Layer>()->getIPv6Header()->payloadLength = fragData->currentOffset + + ipLayer->getHeaderLen();
-			}
+		// create a copy of the reassembled data
+		uint8_t* partialData = new uint8_t[fragData.dataLen];
+		memcpy(partialData, fragData.data, fragData.dataLen);
+		RawPacket* partialRawPacket = new RawPacket(partialData, (int)fragData.dataLen, fragData.timestamp, true, fragData.linkType);
 
-			// create a packet object wrapping the RawPacket we've just created
-			Packet* partialDataPacket = new Packet(partialRawPacket, true);
+		// fix IP length field
+		if (fragData.key.protocol == IPv4)
+		{
+			Packet tempPacket(partialRawPacket, IPv4);
+			IPv4Layer* ipLayer = tempPacket.getLayerOfType<IPv4Layer>();
+			ipLayer->getIPv4Header()->totalLength = htobe16(fragData.currentOffset + ipLayer->getHeaderLen());
+		}
+		else
+		{
+			Packet tempPacket(partialRawPacket, IPv6);
+			IPv6Layer* ipLayer = tempPacket.getLayerOfType<IPv6Layer>();
+			tempPacket.getLayerOfType<IPv6Layer>()->getIPv6Header()->payloadLength = fragData.currentOffset + + ipLayer->getHeaderLen();
+		}
 
-			// prepare the packet and return it
-			if (key.getProtocolType() == IPv4)
-			{
-				IPv4Layer* ipLayer = partialDataPacket->getLayerOfType<IPv4Layer>();
-				ipLayer->getIPv4Header()->fragmentOffset = 0;
-				ipLayer->computeCalculateFields();
-			}
-			else // key.getProtocolType() == IPv6
-			{
-				IPv6Layer* ipLayer = partialDataPacket->getLayerOfType<IPv6Layer>();
-				ipLayer->removeAllExtensions();
-				ipLayer->computeCalculateFields();
-			}
+		// create a packet object wrapping the RawPacket we've just created
+		Packet* partialDataPacket = new Packet(partialRawPacket, true);
 
-			return partialDataPacket;
+		// prepare the packet and return it
+		if (key.getProtocolType() == IPv4)
+		{
+			IPv4Layer* ipLayer = partialDataPacket->getLayerOfType<IPv4Layer>();
+			ipLayer->getIPv4Header()->fragmentOffset = 0;
+			ipLayer->computeCalculateFields();
 		}
+		else // key.getProtocolType() == IPv6
+		{
+			IPv6Layer* ipLayer = partialDataPacket->getLayerOfType<IPv6Layer>();
+			ipLayer->removeAllExtensions();
+			ipLayer->computeCalculateFields();
+		}
+
+		return partialDataPacket;
 	}
 
 	return NULL;
@@ -544,110 +618,441 @@ Packet* IPReassembly::getCurrentPacket(const PacketKey& key)
 
 void IPReassembly::removePacket(const PacketKey& key)
 {
-	// create a hash out of the packet key
-	uint32_t hash = key.getHashValue();
+	PacketKeyData keyData;
+	if (!getPacketKeyData(key, keyData))
+		return;
+
+	// look for this packet in the table and free all data saved for it
+	uint32_t packetIndex = findPacket(keyData, key.getHashValue());
+	if (packetIndex != InvalidIndex)
+		removePacketEntry(packetIndex, false);
+}
+
+bool IPReassembly::getPacketKeyData(const PacketKey& key, PacketKeyData& keyData)
+{
+	memset(&keyData, 0, sizeof(keyData));
+	keyData.protocol = key.getProtocolType();
+
+	const IPv4PacketKey* ipv4Key = dynamic_cast<const IPv4PacketKey*>(&key);
+	if (ipv4Key != NULL)
+	{
+		uint32_t srcIP = ipv4Key->getSrcIP().toInt();
+		uint32_t dstIP = ipv4Key->getDstIP().toInt();
+		memcpy(keyData.srcIP, &srcIP, 4);
+		memcpy(keyData.dstIP, &dstIP, 4);
+		keyData.fragmentID = ipv4Key->getIpID();
+		return true;
+	}
+
+	const IPv6PacketKey* ipv6Key = dynamic_cast<const IPv6PacketKey*>(&key);
+	if (ipv6Key != NULL)
+	{
+		ipv6Key->getSrcIP().copyTo(keyData.srcIP);
+		ipv6Key->getDstIP().copyTo(keyData.dstIP);
+		keyData.fragmentID = ipv6Key->getFragmentID();
+		return true;
+	}
+
+	LOG_ERROR("Unknown packet key type");
+	return false;
+}
+
+size_t IPReassembly::getRequiredCapacity(const IPFragmentData& fragData, size_t appendLen)
+{
+	size_t capacity = fragData.dataLen + appendLen;
+
+	// once the total length is known allocate the final size right away, otherwise grow exponentially
+	if (fragData.totalLength > fragData.currentOffset)
+	{
+		size_t finalCapacity = fragData.dataLen + (fragData.totalLength - fragData.currentOffset);
+		if (finalCapacity > capacity)
+			capacity = finalCapacity;
+	}
+	else if (capacity > fragData.dataCapacity && fragData.dataCapacity * 2 > capacity)
+		capacity = fragData.dataCapacity * 2;
+
+	return capacity;
+}
+
+uint32_t IPReassembly::findPacket(const PacketKeyData& key, uint32_t hash) const
+{
+	if (m_PacketTable.empty())
+		return InvalidIndex;
+
+	for (size_t slot = getTableSlot(hash, m_PacketTable.size()); m_PacketTable[slot] != InvalidIndex; slot = (slot + 1) & (m_PacketTable.size() - 1))
+	{
+		const IPFragmentData& fragData = m_Packets[m_PacketTable[slot]];
+		if (fragData.hash == hash && fragData.key == key)
+			return m_PacketTable[slot];
+	}
+
+	return InvalidIndex;
+}
+
+uint32_t IPReassembly::createPacket(const PacketKeyData& key, uint32_t hash)
+{
+	// the table is full, remove the least recently used packet
+	if (m_NumOfPackets >= m_MaxPacketsToStore)
+	{
+		LOG_DEBUG("Reached maximum packet capacity, removing data for FragID=0x%X", m_Packets[m_LRUTail].key.fragmentID);
+		removePacketEntry(m_LRUTail, true);
+	}
+
+	if (m_FreePackets == InvalidIndex)
+		growPacketTable();
+
+	uint32_t packetIndex = m_FreePackets;
+	IPFragmentData& fragData = m_Packets[packetIndex];
+	m_FreePackets = fragData.lruNext;
+
+	fragData.key = key;
+	fragData.hash = hash;
+	fragData.currentOffset = 0;
+	fragData.totalLength = 0;
+	fragData.data = NULL;
+	fragData.dataLen = 0;
+	fragData.dataCapacity = 0;
+	fragData.timestamp.tv_sec = 0;
+	fragData.timestamp.tv_nsec = 0;
+	fragData.linkType = LINKTYPE_ETHERNET;
+	fragData.outOfOrderFragments = InvalidIndex;
+	fragData.lastSeen = 0;
+
+	size_t slot = getTableSlot(hash, m_PacketTable.size());
+	while (m_PacketTable[slot] != InvalidIndex)
+		slot = (slot + 1) & (m_PacketTable.size() - 1);
+	m_PacketTable[slot] = packetIndex;
+
+	linkAsMostRecent(packetIndex);
+	m_NumOfPackets++;
+	return packetIndex;
+}
+
+void IPReassembly::removePacketEntry(uint32_t packetIndex, bool fireCallback)
+{
+	IPFragmentData& fragData = m_Packets[packetIndex];
+
+	removeFromTable(packetIndex);
+	unlinkFromLRU(packetIndex);
+
+	while (fragData.outOfOrderFragments != InvalidIndex)
+	{
+		uint32_t fragmentIndex = fragData.outOfOrderFragments;
+		fragData.outOfOrderFragments = m_Fragments[fragmentIndex].next;
+		releaseFragment(fragmentIndex);
+	}
+
+	delete [] fragData.data;
+	m_BufferedBytes -= fragData.dataCapacity;
+	fragData.data = NULL;
+	fragData.dataLen = 0;
+	fragData.dataCapacity = 0;
+
+	fragData.lruNext = m_FreePackets;
+	m_FreePackets = packetIndex;
+	m_NumOfPackets--;
+
+	// fire callback if not null. The key is built on the stack as the entry can't be reused before the callback returns
+	if (fireCallback && m_OnFragmentsCleanCallback != NULL)
+	{
+		if (fragData.key.protocol == IPv4)
+		{
+			IPv4PacketKey key((uint16_t)fragData.key.fragmentID, IPv4Address(fragData.key.srcIP), IPv4Address(fragData.key.dstIP));
+			m_OnFragmentsCleanCallback(&key, m_CallbackUserCookie);
+		}
+		else
+		{
+			IPv6PacketKey key(fragData.key.fragmentID, IPv6Address(fragData.key.srcIP), IPv6Address(fragData.key.dstIP));
+			m_OnFragmentsCleanCallback(&key, m_CallbackUserCookie);
+		}
+	}
+}
+
+void IPReassembly::linkAsMostRecent(uint32_t packetIndex)
+{
+	IPFragmentData& fragData = m_Packets[packetIndex];
+	fragData.lruPrev = InvalidIndex;
+	fragData.lruNext = m_LRUHead;
+	if (m_LRUHead != InvalidIndex)
+		m_Packets[m_LRUHead].lruPrev = packetIndex;
+	else
+		m_LRUTail = packetIndex;
+	m_LRUHead = packetIndex;
+}
 
-	// look for this hash value in the map
-	std::map<uint32_t, IPFragmentData*>::iterator iter = m_FragmentMap.find(hash);
+void IPReassembly::unlinkFromLRU(uint32_t packetIndex)
+{
+	IPFragmentData& fragData = m_Packets[packetIndex];
+	if (fragData.lruPrev != InvalidIndex)
+		m_Packets[fragData.lruPrev].lruNext = fragData.lruNext;
+	else
+		m_LRUHead = fragData.lruNext;
+
+	if (fragData.lruNext != InvalidIndex)
+		m_Packets[fragData.lruNext].lruPrev = fragData.lruPrev;
+	else
+		m_LRUTail = fragData.lruPrev;
+}
 
-	// hash was found
-	if (iter != m_FragmentMap.end())
+void IPReassembly::removeFromTable(uint32_t packetIndex)
+{
+	size_t mask = m_PacketTable.size() - 1;
+	size_t slot = getTableSlot(m_Packets[packetIndex].hash, m_PacketTable.size());
+	while (m_PacketTable[slot] != packetIndex)
+		slot = (slot + 1) & mask;
+
+	// backward shift deletion: move back the following entries of the cluster that can't be found once this slot is empty
+	size_t next = slot;
+	while (true)
 	{
-		// free all data saved in the map
-		delete iter->second;
-		m_FragmentMap.erase(iter);
+		next = (next + 1) & mask;
+		if (m_PacketTable[next] == InvalidIndex)
+			break;
 
-		// remove from LRU list
-		m_PacketLRU.eraseElement(hash);
+		size_t home = getTableSlot(m_Packets[m_PacketTable[next]].hash, m_PacketTable.size());
+		bool homeBetween = (slot <= next) ? (slot < home && home <= next) : (slot < home || home <= next);
+		if (homeBetween)
+			continue;
+
+		m_PacketTable[slot] = m_PacketTable[next];
+		slot = next;
 	}
+
+	m_PacketTable[slot] = InvalidIndex;
 }
 
-void IPReassembly::addNewFragment(uint32_t hash, IPFragmentData* fragData)
+void IPReassembly::growPacketTable()
 {
-	// put the new frag in the LRU list
-	uint32_t packetRemoved;
+	size_t oldCapacity = m_Packets.size();
+	size_t newCapacity = (oldCapacity == 0 ? (size_t)MinPacketsCapacity : oldCapacity * 2);
+	if (newCapacity > m_MaxPacketsToStore)
+		newCapacity = m_MaxPacketsToStore;
 
-	if (m_PacketLRU.put(hash, &packetRemoved) == 1) // this means LRU list was full and the least recently used item was removed
+	m_Packets.resize(newCapacity);
+	for (size_t i = newCapacity; i > oldCapacity; i--)
 	{
-		// remove this item from the fragment map
-		std::map<uint32_t, IPFragmentData*>::iterator iter = m_FragmentMap.find(packetRemoved);
-		IPFragmentData* dataRemoved = iter->second;
+		m_Packets[i - 1].data = NULL;
+		m_Packets[i - 1].dataCapacity = 0;
+		m_Packets[i - 1].lruNext = m_FreePackets;
+		m_FreePackets = (uint32_t)(i - 1);
+	}
 
-		PacketKey* key = NULL;
-		if (m_OnFragmentsCleanCallback != NULL)
-			key = dataRemoved->packetKey->clone();
+	// keep the load factor of the hash table at 0.5 at most
+	size_t tableSize = 1;
+	while (tableSize < newCapacity * 2)
+		tableSize <<= 1;
+	if (tableSize <= m_PacketTable.size())
+		return;
+
+	m_PacketTable.assign(tableSize, (uint32_t)InvalidIndex);
+	for (uint32_t packetIndex = m_LRUHead; packetIndex != InvalidIndex; packetIndex = m_Packets[packetIndex].lruNext)
+	{
+		size_t slot = getTableSlot(m_Packets[packetIndex].hash, tableSize);
+		while (m_PacketTable[slot] != InvalidIndex)
+			slot = (slot + 1) & (tableSize - 1);
+		m_PacketTable[slot] = packetIndex;
+	}
+}
 
-		LOG_DEBUG("Reached maximum packet capacity, removing data for FragID=0x%X", dataRemoved->fragmentID);
-		delete dataRemoved;
-		m_FragmentMap.erase(iter);
+void IPReassembly::dropExpiredPackets(time_t now)
+{
+	// the least recently used packets are the ones that didn't get a fragment for the longest time
+	while (m_LRUTail != InvalidIndex && now - m_Packets[m_LRUTail].lastSeen > (time_t)m_Timeout)
+	{
+		LOG_DEBUG("Packet with FragID=0x%X timed out, removing its data", m_Packets[m_LRUTail].key.fragmentID);
+		removePacketEntry(m_LRUTail, true);
+	}
+}
 
-		// fire callback if not null
-		if (m_OnFragmentsCleanCallback != NULL)
+bool IPReassembly::makeRoom(size_t bytes, uint32_t packetIndex)
+{
+	if (m_MaxBufferedBytes == 0)
+		return true;
+
+	// remove the least recently used packets (other than the one that needs the room) until there's enough room
+	while (m_BufferedBytes + bytes > m_MaxBufferedBytes)
+	{
+		uint32_t packetToRemove = m_LRUTail;
+		if (packetToRemove == packetIndex)
+			packetToRemove = m_Packets[packetToRemove].lruPrev;
+		if (packetToRemove == InvalidIndex)
+			return false;
+
+		LOG_DEBUG("Reached maximum buffered bytes, removing data for FragID=0x%X", m_Packets[packetToRemove].key.fragmentID);
+		removePacketEntry(packetToRemove, true);
+	}
+
+	return true;
+}
+
+bool IPReassembly::reserveData(uint32_t packetIndex, size_t capacity)
+{
+	IPFragmentData& fragData = m_Packets[packetIndex];
+	if (capacity <= fragData.dataCapacity)
+		return true;
+
+	if (!makeRoom(capacity - fragData.dataCapacity, packetIndex))
+		return false;
+
+	uint8_t* newData = new uint8_t[capacity];
+	if (fragData.dataLen > 0)
+		memcpy(newData, fragData.data, fragData.dataLen);
+	delete [] fragData.data;
+
+	m_BufferedBytes += capacity - fragData.dataCapacity;
+	fragData.data = newData;
+	fragData.dataCapacity = capacity;
+	return true;
+}
+
+bool IPReassembly::storeOutOfOrderFragment(uint32_t packetIndex, uint32_t offset, const uint8_t* data, size_t dataLen, bool lastFragment)
+{
+	size_t numOfBlocks = (dataLen + SlabBlockDataSize - 1) / SlabBlockDataSize;
+	if (!makeRoom(numOfBlocks * sizeof(SlabBlock), packetIndex))
+		return false;
+
+	uint32_t fragmentIndex = m_FreeFragments;
+	if (fragmentIndex == InvalidIndex)
+	{
+		fragmentIndex = (uint32_t)m_Fragments.size();
+		m_Fragments.push_back(IPFragment());
+	}
+	else
+		m_FreeFragments = m_Fragments[fragmentIndex].next;
+
+	// copy the data to a chain of slab blocks
+	SlabBlock* firstBlock = NULL;
+	SlabBlock** nextBlockLink = &firstBlock;
+	for (size_t copied = 0; copied < dataLen; )
+	{
+		SlabBlock* block = allocateSlabBlock();
+		size_t blockLen = dataLen - copied;
+		if (blockLen > SlabBlockDataSize)
+			blockLen = SlabBlockDataSize;
+		memcpy(block->data, data + copied, blockLen);
+		copied += blockLen;
+
+		block->next = NULL;
+		*nextBlockLink = block;
+		nextBlockLink = &block->next;
+	}
+
+	m_BufferedBytes += numOfBlocks * sizeof(SlabBlock);
+
+	IPFragment& fragment = m_Fragments[fragmentIndex];
+	fragment.fragmentOffset = offset;
+	fragment.fragmentDataLen = (uint32_t)dataLen;
+	fragment.lastFragment = lastFragment;
+	fragment.firstBlock = firstBlock;
+
+	// keep the out-of-order list sorted by offset. Fragments with the same offset stay in the order they arrived
+	uint32_t* link = &m_Packets[packetIndex].outOfOrderFragments;
+	while (*link != InvalidIndex && m_Fragments[*link].fragmentOffset <= offset)
+		link = &m_Fragments[*link].next;
+	fragment.next = *link;
+	*link = fragmentIndex;
+
+	return true;
+}
+
+IPReassembly::SlabBlock* IPReassembly::allocateSlabBlock()
+{
+	if (m_FreeSlabBlocks == NULL)
+	{
+		SlabBlock* chunk = new SlabBlock[SlabBlocksPerChunk];
+		m_SlabChunks.push_back(chunk);
+		for (size_t i = 0; i < SlabBlocksPerChunk; i++)
 		{
-			m_OnFragmentsCleanCallback(key, m_CallbackUserCookie);
-			delete key;
+			chunk[i].next = m_FreeSlabBlocks;
+			m_FreeSlabBlocks = &chunk[i];
 		}
 	}
 
-	// add the new fragment to the map
-	std::pair<uint32_t, IPFragmentData*> pair(hash, fragData);
-	m_FragmentMap.insert(pair);
+	SlabBlock* block = m_FreeSlabBlocks;
+	m_FreeSlabBlocks = block->next;
+	return block;
+}
+
+void IPReassembly::releaseFragment(uint32_t fragmentIndex)
+{
+	IPFragment& fragment = m_Fragments[fragmentIndex];
+
+	SlabBlock* block = fragment.firstBlock;
+	while (block != NULL)
+	{
+		SlabBlock* next = block->next;
+		block->next = m_FreeSlabBlocks;
+		m_FreeSlabBlocks = block;
+		m_BufferedBytes -= sizeof(SlabBlock);
+		block = next;
+	}
+
+	fragment.firstBlock = NULL;
+	fragment.next = m_FreeFragments;
+	m_FreeFragments = fragmentIndex;
 }
 
-bool IPReassembly::matchOutOfOrderFragments(IPFragmentData* fragData)
+bool IPReassembly::matchOutOfOrderFragments(uint32_t packetIndex, bool& gotLastFragment)
 {
-	LOG_DEBUG("[FragID=0x%X] Searching out-of-order fragment list for the next fragment", fragData->fragmentID);
+	IPFragmentData& fragData = m_Packets[packetIndex];
+	gotLastFragment = false;
 
-	// a flag indicating whether the last fragment of the packet was found
-	bool foundLastSgement = false;
+	LOG_DEBUG("[FragID=0x%X] Searching out-of-order fragment list for the next fragment", fragData.key.fragmentID);
 
-	// run until the last fragment was found or until we finished going over the out-of-order list and didn't find any matching fragment
-	while (!foundLastSgement)
+	// the list is sorted by offset so the next fragment can only be at its head
+	while (fragData.outOfOrderFragments != InvalidIndex)
 	{
-		bool foundOutOfOrderFrag = false;
+		uint32_t fragmentIndex = fragData.outOfOrderFragments;
+		IPFragment& fragment = m_Fragments[fragmentIndex];
 
-		int index = 0;
+		if (fragment.fragmentOffset > fragData.currentOffset)
+		{
+			// need to wait for the missing fragment in next incoming packets
+			LOG_DEBUG("[FragID=0x%X] Didn't find the next fragment in out-of-order list", fragData.key.fragmentID);
+			return true;
+		}
 
-		// go over all fragment in the out-of-order list
-		while (index < (int)fragData->outOfOrderFragments.size())
+		// fragments whose offset was already passed (duplicates or overlaps) can never match, release them
+		if (fragment.fragmentOffset < fragData.currentOffset)
 		{
-			// get the current fragment from the out-of-order list
-			IPFragment* frag = fragData->outOfOrderFragments.at(index);
+			fragData.outOfOrderFragments = fragment.next;
+			releaseFragment(fragmentIndex);
+			continue;
+		}
 
-			// this fragment is exactly the one we're looking for
-			if (fragData->currentOffset == frag->fragmentOffset)
-			{
-				// add it to the reassembled packet
-				LOG_DEBUG("[FragID=0x%X] Found the next matching fragment in out-of-order list with offset %d, adding its data to reassembled packet", fragData->fragmentID, (int)frag->fragmentOffset);
-				fragData->data->reallocateData(fragData->data->getRawDataLen() + frag->fragmentDataLen);
-				fragData->data->appendData(frag->fragmentData, frag->fragmentDataLen);
-				fragData->currentOffset += frag->fragmentDataLen;
-				if (frag->lastFragment) // if this is the last fragment of the packet
-				{
-					LOG_DEBUG("[FragID=0x%X] Found last fragment inside out-of-order list", fragData->fragmentID);
-					foundLastSgement = true;
-				}
-
-				// remove this fragment from the out-of-order list
-				fragData->outOfOrderFragments.erase(fragData->outOfOrderFragments.begin() + index);
-
-				// mark that we found at least one matching fragment in the out-of-order list
-				foundOutOfOrderFrag = true;
-			}
-			else
-				index++;
+		// this fragment is exactly the one we're looking for, add it to the reassembled packet
+		LOG_DEBUG("[FragID=0x%X] Found the next matching fragment in out-of-order list with offset %d, adding its data to reassembled packet", fragData.key.fragmentID, (int)fragment.fragmentOffset);
+		if (!reserveData(packetIndex, getRequiredCapacity(fragData, fragment.fragmentDataLen)))
+		{
+			LOG_DEBUG("[FragID=0x%X] Not enough room to buffer the fragment, dropping the packet", fragData.key.fragmentID);
+			return false;
 		}
 
-		// during the search we did on the out-of-order list we didn't find any matching fragment
-		if (!foundOutOfOrderFrag)
+		size_t remaining = fragment.fragmentDataLen;
+		for (SlabBlock* block = fragment.firstBlock; block != NULL; block = block->next)
 		{
-			// break the loop - need to wait for the missing fragment in next incoming packets
-			LOG_DEBUG("[FragID=0x%X] Didn't find the next fragment in out-of-order list", fragData->fragmentID);
-			break;
+			size_t blockLen = (remaining > SlabBlockDataSize ? (size_t)SlabBlockDataSize : remaining);
+			memcpy(fragData.data + fragData.dataLen, block->data, blockLen);
+			fragData.dataLen += blockLen;
+			remaining -= blockLen;
+		}
+		fragData.currentOffset += fragment.fragmentDataLen;
+
+		// remove this fragment from the out-of-order list
+		bool lastFragment = fragment.lastFragment;
+		fragData.outOfOrderFragments = fragment.next;
+		releaseFragment(fragmentIndex);
+
+		if (lastFragment) // if this is the last fragment of the packet
+		{
+			LOG_DEBUG("[FragID=0x%X] Found last fragment inside out-of-order list", fragData.key.fragmentID);
+			gotLastFragment = true;
+			return true;
 		}
 	}
 
-	return foundLastSgement;
+	LOG_DEBUG("[FragID=0x%X] Didn't find the next fragment in out-of-order list", fragData.key.fragmentID);
+	return true;
 }
 
 }
@@ -321,9 +321,9 @@ void IPv4Layer::computeCalculateFields()
 	ipHdr->totalLength = htobe16(m_DataLen);
 	ipHdr->headerChecksum = 0;
 
-	if (m_NextLayer != NULL)
+	if (getNextLayer() != NULL)
 	{
-		switch (m_NextLayer->getProtocol())
+		switch (getNextLayer()->getProtocol())
 		{
 		case TCP:
 			ipHdr->protocol = PACKETPP_IPPROTO_TCP;
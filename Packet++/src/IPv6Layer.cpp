@@ -259,10 +259,10 @@ void IPv6Layer::computeCalculateFields()
 	ipHdr->payloadLength = htobe16(m_DataLen - sizeof(ip6_hdr));
 	ipHdr->ipVersion = (6 & 0x0f);
 
-	if (m_NextLayer != NULL)
+	if (getNextLayer() != NULL)
 	{
 		uint8_t nextHeader = 0;
-		switch (m_NextLayer->getProtocol())
+		switch (getNextLayer()->getProtocol())
 		{
 		case TCP:
 			nextHeader = PACKETPP_IPPROTO_TCP;
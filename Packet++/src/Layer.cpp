@@ -2,19 +2,55 @@
 
 #include "Layer.h"
 #include <string.h>
+#include <new>
 #include "Logger.h"
 #include "Packet.h"
+#include "LayerArena.h"
+
+// every layer is preceded by a header holding the arena it was allocated from, or NULL if it was allocated on the heap.
+// The header size keeps the layer aligned the same way the heap and the arena do
+#define LAYER_ALLOCATION_HEADER_SIZE 16
 
 namespace pcpp
 {
 
+void* Layer::operator new(size_t size)
+{
+	LayerArena* arena = LayerArena::getCurrent();
+	uint8_t* block = NULL;
+	if (arena != NULL)
+		block = (uint8_t*)arena->allocate(size + LAYER_ALLOCATION_HEADER_SIZE);
+
+	if (block == NULL)
+	{
+		block = (uint8_t*)::operator new(size + LAYER_ALLOCATION_HEADER_SIZE);
+		arena = NULL;
+	}
+
+	*(LayerArena**)block = arena;
+	return block + LAYER_ALLOCATION_HEADER_SIZE;
+}
+
+void Layer::operator delete(void* ptr)
+{
+	if (ptr == NULL)
+		return;
+
+	uint8_t* block = (uint8_t*)ptr - LAYER_ALLOCATION_HEADER_SIZE;
+	LayerArena* arena = *(LayerArena**)block;
+	if (arena != NULL)
+		arena->deallocate();
+	else
+		::operator delete(block);
+}
+
 Layer::~Layer()
 {
 	if (!isAllocatedToPacket())
 		delete [] m_Data;
 }
 
-Layer::Layer(const Layer& other) : m_Packet(NULL), m_Protocol(other.m_Protocol), m_NextLayer(NULL), m_PrevLayer(NULL), m_IsAllocatedInPacket(false)
+Layer::Layer(const Layer& other) : m_Packet(NULL), m_Protocol(other.m_Protocol), m_NextLayer(NULL), m_PrevLayer(NULL), m_IsAllocatedInPacket(false), m_IsNextLayerPending(false)
 {
 	m_DataLen = other.getHeaderLen();
 	m_Data = new uint8_t[other.m_DataLen];
@@ -36,11 +72,17 @@ Layer& Layer::operator=(const Layer& other)
 	m_PrevLayer = NULL;
 	m_Data = new uint8_t[other.m_DataLen];
 	m_IsAllocatedInPacket = false;
+	m_IsNextLayerPending = false;
 	memcpy(m_Data, other.m_Data, other.m_DataLen);
 
 	return *this;
 }
 
+Layer* Layer::parsePendingNextLayer() const
+{
+	return m_Packet->parseNextPendingLayer();
+}
+
 void Layer::copyData(uint8_t* toArr) const
 {
 	memcpy(toArr, m_Data, m_DataLen);
@@ -0,0 +1,115 @@
+#include "LayerArena.h"
+#include "SystemUtils.h"
+#include <new>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// all blocks are aligned to this value, which is enough for any layer member
+#define LAYER_ARENA_ALIGNMENT 16
+#define LAYER_ARENA_ALIGN(size) (((size) + LAYER_ARENA_ALIGNMENT - 1) & ~((size_t)LAYER_ARENA_ALIGNMENT - 1))
+
+namespace pcpp
+{
+
+// the reference count is changed by the thread of the owning packet and by any thread that deletes a detached layer
+static inline long arenaAddReferences(volatile long* references, long delta)
+{
+#if defined(_MSC_VER)
+	return _InterlockedExchangeAdd(references, delta) + delta;
+#else
+	return __atomic_add_fetch(references, delta, __ATOMIC_ACQ_REL);
+#endif
+}
+
+static inline long arenaLoadReferences(volatile long* references)
+{
+#if defined(_MSC_VER)
+	return _InterlockedOr(references, 0);
+#else
+	return __atomic_load_n(references, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static PCPP_THREAD_LOCAL LayerArena* currentLayerArena = NULL;
+
+LayerArena::LayerArena(uint8_t* buffer, size_t capacity) :
+	m_Buffer(buffer), m_Capacity(capacity), m_Used(0), m_Requested(0), m_NumOfReferences(1)
+{
+}
+
+LayerArena* LayerArena::create(size_t capacity)
+{
+	if (capacity > MaxCapacity)
+		capacity = MaxCapacity;
+	capacity = LAYER_ARENA_ALIGN(capacity);
+
+	// the arena object and its buffer are allocated together
+	size_t headerSize = LAYER_ARENA_ALIGN(sizeof(LayerArena));
+	uint8_t* memory = new uint8_t[headerSize + capacity];
+	return new(memory) LayerArena(memory + headerSize, capacity);
+}
+
+void LayerArena::destroy()
+{
+	this->~LayerArena();
+	delete [] (uint8_t*)this;
+}
+
+void* LayerArena::allocate(size_t size)
+{
+	size = LAYER_ARENA_ALIGN(size);
+	m_Requested += size;
+	if (m_Used + size > m_Capacity)
+		return NULL;
+
+	void* block = m_Buffer + m_Used;
+	m_Used += size;
+	arenaAddReferences(&m_NumOfReferences, 1);
+	return block;
+}
+
+void LayerArena::deallocate()
+{
+	if (arenaAddReferences(&m_NumOfReferences, -1) == 0)
+		destroy();
+}
+
+bool LayerArena::reset()
+{
+	// the owner holds the only reference, so no block is alive and none can be allocated while resetting
+	if (arenaLoadReferences(&m_NumOfReferences) != 1 || m_Requested > m_Capacity)
+		return false;
+
+	m_Used = 0;
+	m_Requested = 0;
+	return true;
+}
+
+void LayerArena::release()
+{
+	if (arenaAddReferences(&m_NumOfReferences, -1) == 0)
+		destroy();
+}
+
+size_t LayerArena::getNumOfLiveBlocks() const
+{
+	return (size_t)(arenaLoadReferences(const_cast<volatile long*>(&m_NumOfReferences)) - 1);
+}
+
+size_t LayerArena::getRecommendedCapacity() const
+{
+	return (m_Requested > m_Capacity ? m_Requested : m_Capacity);
+}
+
+LayerArena* LayerArena::getCurrent()
+{
+	return currentLayerArena;
+}
+
+void LayerArena::setCurrent(LayerArena* arena)
+{
+	currentLayerArena = arena;
+}
+
+} // namespace pcpp
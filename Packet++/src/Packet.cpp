@@ -9,6 +9,7 @@
 #include "IPv6Layer.h"
 #include "PayloadLayer.h"
 #include "PacketTrailerLayer.h"
+#include "LayerArena.h"
 #include "Logger.h"
 #include "EndianPortable.h"
 #include <string.h>
@@ -29,7 +30,8 @@ Packet::Packet(size_t maxPacketLen) :
 	m_LastLayer(NULL),
 	m_ProtocolTypes(UnknownProtocol),
 	m_MaxPacketLen(maxPacketLen),
-	m_FreeRawPacket(true)
+	m_FreeRawPacket(true),
+	m_LayerArena(NULL)
 {
 	timeval time;
 	gettimeofday(&time, NULL);
@@ -53,6 +55,7 @@ void Packet::setRawPacket(RawPacket* rawPacket, bool freeRawPacket, ProtocolType
 
 	LinkLayerType linkType = m_RawPacket->getLinkLayerType();
 
+	LayerArenaScope arenaScope(prepareLayerArena());
 	m_FirstLayer = createFirstLayer(linkType);
 
 	m_LastLayer = m_FirstLayer;
@@ -81,24 +84,100 @@ void Packet::setRawPacket(RawPacket* rawPacket, bool freeRawPacket, ProtocolType
 	}
 
 	if (m_LastLayer != NULL && parseUntil == UnknownProtocol && parseUntilLayer == OsiModelLayerUnknown)
+		createPacketTrailerLayer();
+}
+
+void Packet::setRawPacket(RawPacket* rawPacket, bool freeRawPacket, PacketParsingMode parsingMode)
+{
+	if (parsingMode == EagerParsing)
 	{
-		// find if there is data left in the raw packet that doesn't belong to any layer. In that case it's probably a packet trailer.
-		// create a PacketTrailerLayer layer and add it at the end of the packet
-		int trailerLen = (int)((m_RawPacket->getRawData() + m_RawPacket->getRawDataLen()) - (m_LastLayer->getData() + m_LastLayer->getDataLen()));
-		if (trailerLen > 0)
-		{
-			PacketTrailerLayer* trailerLayer = new PacketTrailerLayer(
-					(uint8_t*)(m_LastLayer->getData() + m_LastLayer->getDataLen()),
-					trailerLen,
-					m_LastLayer,
-					this);
-
-			trailerLayer->m_IsAllocatedInPacket = true;
-			m_LastLayer->setNextLayer(trailerLayer);
-			m_LastLayer = trailerLayer;
-			m_ProtocolTypes |= trailerLayer->getProtocol();
-		}
+		setRawPacket(rawPacket, freeRawPacket);
+		return;
+	}
+
+	destructPacketData();
+
+	m_FirstLayer = NULL;
+	m_LastLayer = NULL;
+	m_ProtocolTypes = UnknownProtocol;
+	m_FreeRawPacket = freeRawPacket;
+	m_RawPacket = rawPacket;
+	if (m_RawPacket == NULL)
+		return;
+
+	m_MaxPacketLen = m_RawPacket->getRawDataLen();
+
+	// only the first layer is created now, every other layer is created by parseNextPendingLayer() when it's first needed
+	LayerArenaScope arenaScope(prepareLayerArena());
+	m_FirstLayer = createFirstLayer(m_RawPacket->getLinkLayerType());
+	m_LastLayer = m_FirstLayer;
+	if (m_FirstLayer != NULL)
+	{
+		m_FirstLayer->m_IsAllocatedInPacket = true;
+		m_FirstLayer->m_IsNextLayerPending = true;
+		m_ProtocolTypes = m_FirstLayer->getProtocol();
+	}
+}
+
+void Packet::createPacketTrailerLayer()
+{
+	// find if there is data left in the raw packet that doesn't belong to any layer. In that case it's probably a packet trailer.
+	// create a PacketTrailerLayer layer and add it at the end of the packet
+	int trailerLen = (int)((m_RawPacket->getRawData() + m_RawPacket->getRawDataLen()) - (m_LastLayer->getData() + m_LastLayer->getDataLen()));
+	if (trailerLen > 0)
+	{
+		PacketTrailerLayer* trailerLayer = new PacketTrailerLayer(
+				(uint8_t*)(m_LastLayer->getData() + m_LastLayer->getDataLen()),
+				trailerLen,
+				m_LastLayer,
+				this);
+
+		trailerLayer->m_IsAllocatedInPacket = true;
+		m_LastLayer->setNextLayer(trailerLayer);
+		m_LastLayer = trailerLayer;
+		m_ProtocolTypes |= trailerLayer->getProtocol();
+	}
+}
+
+Layer* Packet::parseNextPendingLayer()
+{
+	Layer* curLayer = m_LastLayer;
+	curLayer->m_IsNextLayerPending = false;
+
+	LayerArenaScope arenaScope(m_LayerArena);
+	curLayer->parseNextLayer();
+
+	Layer* nextLayer = curLayer->m_NextLayer;
+	if (nextLayer == NULL)
+	{
+		// the whole packet is parsed, add a packet trailer the same way eager parsing does
+		createPacketTrailerLayer();
+		return curLayer->m_NextLayer;
 	}
+
+	nextLayer->m_IsAllocatedInPacket = true;
+	nextLayer->m_IsNextLayerPending = true;
+	m_ProtocolTypes |= nextLayer->getProtocol();
+	m_LastLayer = nextLayer;
+	return nextLayer;
+}
+
+void Packet::parseAllLayers() const
+{
+	while (isParsingPending())
+		const_cast<Packet*>(this)->parseNextPendingLayer();
+}
+
+bool Packet::parseUntilProtocol(ProtocolType protocolType) const
+{
+	while (isParsingPending())
+	{
+		const_cast<Packet*>(this)->parseNextPendingLayer();
+		if ((m_ProtocolTypes & protocolType) != 0)
+			return true;
+	}
+
+	return false;
 }
 
 Packet::Packet(RawPacket* rawPacket, bool freeRawPacket, ProtocolType parseUntil, OsiModelLayer parseUntilLayer)
@@ -106,6 +185,7 @@ Packet::Packet(RawPacket* rawPacket, bool freeRawPacket, ProtocolType parseUntil
 	m_FreeRawPacket = false;
 	m_RawPacket = NULL;
 	m_FirstLayer = NULL;
+	m_LayerArena = NULL;
 	setRawPacket(rawPacket, freeRawPacket, parseUntil, parseUntilLayer);
 }
 
@@ -114,6 +194,7 @@ Packet::Packet(RawPacket* rawPacket, ProtocolType parseUntil)
 	m_FreeRawPacket = false;
 	m_RawPacket = NULL;
 	m_FirstLayer = NULL;
+	m_LayerArena = NULL;
 	setRawPacket(rawPacket, false, parseUntil, OsiModelLayerUnknown);
 }
 
@@ -122,15 +203,52 @@ Packet::Packet(RawPacket* rawPacket, OsiModelLayer parseUntilLayer)
 	m_FreeRawPacket = false;
 	m_RawPacket = NULL;
 	m_FirstLayer = NULL;
+	m_LayerArena = NULL;
 	setRawPacket(rawPacket, false, UnknownProtocol, parseUntilLayer);
 }
 
+Packet::Packet(RawPacket* rawPacket, PacketParsingMode parsingMode, bool freeRawPacket)
+{
+	m_FreeRawPacket = false;
+	m_RawPacket = NULL;
+	m_FirstLayer = NULL;
+	m_LayerArena = NULL;
+	setRawPacket(rawPacket, freeRawPacket, parsingMode);
+}
+
+Packet::~Packet()
+{
+	destructPacketData();
+
+	if (m_LayerArena != NULL)
+		m_LayerArena->release();
+}
+
+LayerArena* Packet::prepareLayerArena()
+{
+	if (m_LayerArena != NULL && !m_LayerArena->reset())
+	{
+		// layers detached from this packet still use the arena, or it was too small for the previous packet. Leave the old arena
+		// to the layers still using it (it'll be freed with the last of them) and start a new one
+		size_t capacity = m_LayerArena->getRecommendedCapacity();
+		m_LayerArena->release();
+		m_LayerArena = LayerArena::create(capacity);
+	}
+	else if (m_LayerArena == NULL)
+	{
+		m_LayerArena = LayerArena::create();
+	}
+
+	return m_LayerArena;
+}
+
 void Packet::destructPacketData()
 {
 	Layer* curLayer = m_FirstLayer;
 	while (curLayer != NULL)
 	{
-		Layer* nextLayer = curLayer->getNextLayer();
+		// layers that weren't parsed yet shouldn't be parsed just to be deleted
+		Layer* nextLayer = curLayer->m_NextLayer;
 		if (curLayer->m_IsAllocatedInPacket)
 			delete curLayer;
 		curLayer = nextLayer;
@@ -153,10 +271,12 @@ Packet& Packet::operator=(const Packet& other)
 
 void Packet::copyDataFrom(const Packet& other)
 {
+	other.parseAllLayers();
 	m_RawPacket = new RawPacket(*(other.m_RawPacket));
 	m_FreeRawPacket = true;
 	m_MaxPacketLen = other.m_MaxPacketLen;
 	m_ProtocolTypes = other.m_ProtocolTypes;
+	LayerArenaScope arenaScope(prepareLayerArena());
 	m_FirstLayer = createFirstLayer(m_RawPacket->getLinkLayerType());
 	m_LastLayer = m_FirstLayer;
 	Layer* curLayer = m_FirstLayer;
@@ -199,6 +319,8 @@ void Packet::reallocateRawData(size_t newSize)
 
 bool Packet::insertLayer(Layer* prevLayer, Layer* newLayer, bool ownInPacket)
 {
+	parseAllLayers();
+
 	if (newLayer == NULL)
 	{
 		LOG_ERROR("Layer to add is NULL");
@@ -375,6 +497,8 @@ Layer* Packet::detachLayer(ProtocolType layerType, int index)
 
 bool Packet::removeLayer(Layer* layer, bool tryToDelete)
 {
+	parseAllLayers();
+
 	if (layer == NULL)
 	{
 		LOG_ERROR("Layer is NULL");
@@ -512,6 +636,8 @@ Layer* Packet::getLayerOfType(ProtocolType layerType, int index) const
 
 bool Packet::extendLayer(Layer* layer, int offsetInLayer, size_t numOfBytesToExtend)
 {
+	parseAllLayers();
+
 	if (layer == NULL)
 	{
 		LOG_ERROR("Layer is NULL");
@@ -572,6 +698,8 @@ bool Packet::extendLayer(Layer* layer, int offsetInLayer, size_t numOfBytesToExt
 
 bool Packet::shortenLayer(Layer* layer, int offsetInLayer, size_t numOfBytesToShorten)
 {
+	parseAllLayers();
+
 	if (layer == NULL)
 	{
 		LOG_ERROR("Layer is NULL");
@@ -625,7 +753,7 @@ void Packet::computeCalculateFields()
 {
 	// calculated fields should be calculated from top layer to bottom layer
 
-	Layer* curLayer = m_LastLayer;
+	Layer* curLayer = getLastLayer();
 	while (curLayer != NULL)
 	{
 		curLayer->computeCalculateFields();
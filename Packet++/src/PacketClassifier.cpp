@@ -0,0 +1,492 @@
+#define LOG_MODULE PacketLogModulePacketClassifier
+
+#include "PacketClassifier.h"
+#include "IPv4Layer.h"
+#include "IPv6Layer.h"
+#include "TcpLayer.h"
+#include "UdpLayer.h"
+#include "Logger.h"
+#include "EndianPortable.h"
+#include <string.h>
+#include <algorithm>
+
+namespace pcpp
+{
+
+#define INVALID_INDEX 0xffffffff
+
+// the number of packets classifyBurst() extracts and matches together
+#define CLASSIFIER_BURST_CHUNK 32
+
+// the layout of the last key word
+#define KEY_PROTOCOL_MASK 0x000000ff
+#define KEY_IP_VERSION_MASK 0x0000ff00
+#define KEY_HAS_PORTS_MASK 0x00010000
+#define KEY_IPV4 0x00000400
+#define KEY_IPV6 0x00000600
+
+static inline uint32_t prefixMask(int prefixLength)
+{
+	if (prefixLength <= 0)
+		return 0;
+	return (uint32_t)(0xffffffffULL << (32 - prefixLength));
+}
+
+// convert an IP address to host-order words (IPv4 addresses use only the first one)
+static void addressToWords(const IPAddress& addr, uint32_t* words)
+{
+	if (addr.isIPv4())
+	{
+		words[0] = be32toh(addr.getIPv4().toInt());
+		words[1] = words[2] = words[3] = 0;
+	}
+	else
+	{
+		uint32_t netOrder[4];
+		memcpy(netOrder, addr.getIPv6().toBytes(), sizeof(netOrder));
+		for (int i = 0; i < 4; i++)
+			words[i] = be32toh(netOrder[i]);
+	}
+}
+
+static void addressMask(int prefixLength, uint32_t* mask)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		int bitsInWord = std::max(0, std::min(32, prefixLength - 32 * i));
+		mask[i] = prefixMask(bitsInWord);
+	}
+}
+
+// murmur3-style hash of the key words
+static inline uint32_t hashKeyWords(const uint32_t* words, int numOfWords)
+{
+	uint32_t hash = 0x9747b28c;
+	for (int i = 0; i < numOfWords; i++)
+	{
+		uint32_t k = words[i] * 0xcc9e2d51;
+		k = (k << 15) | (k >> 17);
+		hash ^= k * 0x1b873593;
+		hash = ((hash << 13) | (hash >> 19)) * 5 + 0xe6546b64;
+	}
+
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+PacketClassifier::PacketClassifier()
+{
+}
+
+void PacketClassifier::clear()
+{
+	m_RuleIds.clear();
+	m_Tuples.clear();
+	m_Chain.clear();
+	m_TupleBySignature.clear();
+}
+
+bool PacketClassifier::addRule(const PacketClassifierRule& rule)
+{
+	if (rule.ruleId == NoMatch)
+	{
+		LOG_ERROR("Rule ID 0x%X is reserved", (uint32_t)NoMatch);
+		return false;
+	}
+
+	int srcMaxPrefix = (rule.srcIp.isIPv4() ? 32 : 128);
+	int dstMaxPrefix = (rule.dstIp.isIPv4() ? 32 : 128);
+	if (rule.srcIpPrefixLength > srcMaxPrefix || rule.dstIpPrefixLength > dstMaxPrefix)
+	{
+		LOG_ERROR("Rule #%u: prefix length is too long", rule.ruleId);
+		return false;
+	}
+
+	if (rule.srcIpPrefixLength > 0 && rule.dstIpPrefixLength > 0 && rule.srcIp.getType() != rule.dstIp.getType())
+	{
+		LOG_ERROR("Rule #%u: source and destination networks are of different IP versions", rule.ruleId);
+		return false;
+	}
+
+	if (rule.srcPortFrom > rule.srcPortTo || rule.dstPortFrom > rule.dstPortTo)
+	{
+		LOG_ERROR("Rule #%u: port range is reversed", rule.ruleId);
+		return false;
+	}
+
+	if (rule.protocol != PacketClassifierRule::AnyProtocol && (rule.protocol < 0 || rule.protocol > 255))
+	{
+		LOG_ERROR("Rule #%u: protocol %d is out of range", rule.ruleId, rule.protocol);
+		return false;
+	}
+
+	// the IP version is part of the rule only if at least one network isn't a wildcard
+	uint32_t ipVersion = 0;
+	if (rule.srcIpPrefixLength > 0)
+		ipVersion = (rule.srcIp.isIPv4() ? KEY_IPV4 : KEY_IPV6);
+	else if (rule.dstIpPrefixLength > 0)
+		ipVersion = (rule.dstIp.isIPv4() ? KEY_IPV4 : KEY_IPV6);
+
+	// IPv4 addresses use only the first word of each address, so the same key layout serves both IP versions
+	Key baseKey, baseMask;
+	memset(&baseKey, 0, sizeof(baseKey));
+	memset(&baseMask, 0, sizeof(baseMask));
+	if (rule.srcIpPrefixLength > 0)
+	{
+		addressToWords(rule.srcIp, baseKey.words);
+		addressMask(rule.srcIpPrefixLength, baseMask.words);
+	}
+	if (rule.dstIpPrefixLength > 0)
+	{
+		addressToWords(rule.dstIp, baseKey.words + 4);
+		addressMask(rule.dstIpPrefixLength, baseMask.words + 4);
+	}
+	for (int i = 0; i < 8; i++)
+		baseKey.words[i] &= baseMask.words[i];
+
+	baseMask.words[9] = (ipVersion != 0 ? KEY_IP_VERSION_MASK : 0);
+	baseKey.words[9] = ipVersion;
+	if (rule.protocol != PacketClassifierRule::AnyProtocol)
+	{
+		baseMask.words[9] |= KEY_PROTOCOL_MASK;
+		baseKey.words[9] |= (uint32_t)rule.protocol;
+	}
+
+	// single ports are part of the key, ranges are checked on the rule's chain node
+	bool anySrcPort = (rule.srcPortFrom == 0 && rule.srcPortTo == 0xffff);
+	bool anyDstPort = (rule.dstPortFrom == 0 && rule.dstPortTo == 0xffff);
+	int srcPortKind = (anySrcPort ? 0 : (rule.srcPortFrom == rule.srcPortTo ? 1 : 2));
+	int dstPortKind = (anyDstPort ? 0 : (rule.dstPortFrom == rule.dstPortTo ? 1 : 2));
+	if (srcPortKind == 1)
+	{
+		baseMask.words[8] |= 0xffff0000;
+		baseKey.words[8] |= ((uint32_t)rule.srcPortFrom << 16);
+	}
+	if (dstPortKind == 1)
+	{
+		baseMask.words[8] |= 0x0000ffff;
+		baseKey.words[8] |= rule.dstPortFrom;
+	}
+	if (!anySrcPort || !anyDstPort)
+	{
+		baseMask.words[9] |= KEY_HAS_PORTS_MASK;
+		baseKey.words[9] |= KEY_HAS_PORTS_MASK;
+	}
+
+	// the signature identifies the tuple: IP version, network prefix lengths, protocol wildcard and port kinds
+	uint32_t signature = (ipVersion >> 8) | ((uint32_t)rule.srcIpPrefixLength << 4) | ((uint32_t)rule.dstIpPrefixLength << 12) |
+			((uint32_t)srcPortKind << 20) | ((uint32_t)dstPortKind << 22) |
+			(rule.protocol != PacketClassifierRule::AnyProtocol ? 0x1000000 : 0);
+
+	uint32_t ruleIndex = (uint32_t)m_RuleIds.size();
+	m_RuleIds.push_back(rule.ruleId);
+
+	std::map<uint32_t, size_t>::iterator iter = m_TupleBySignature.find(signature);
+	size_t tupleIndex;
+	if (iter == m_TupleBySignature.end())
+	{
+		// rules are added by priority order, so appending a new tuple keeps the tuples ordered by minRuleIndex
+		tupleIndex = m_Tuples.size();
+		m_Tuples.push_back(Tuple());
+		Tuple& tuple = m_Tuples.back();
+		tuple.mask = baseMask;
+		tuple.minRuleIndex = ruleIndex;
+		tuple.numOfEntries = 0;
+		m_TupleBySignature[signature] = tupleIndex;
+	}
+	else
+		tupleIndex = iter->second;
+
+	ChainNode node;
+	node.ruleIndex = ruleIndex;
+	node.next = INVALID_INDEX;
+	node.srcPortFrom = rule.srcPortFrom;
+	node.srcPortTo = rule.srcPortTo;
+	node.dstPortFrom = rule.dstPortFrom;
+	node.dstPortTo = rule.dstPortTo;
+	insert(m_Tuples[tupleIndex], baseKey, node);
+
+	LOG_DEBUG("Added rule #%u, %d tuples", rule.ruleId, (int)m_Tuples.size());
+	return true;
+}
+
+void PacketClassifier::insert(Tuple& tuple, const Key& key, const ChainNode& node)
+{
+	// keep the load factor at 50% at most
+	if ((tuple.numOfEntries + 1) * 2 > tuple.table.size())
+	{
+		std::vector<Entry> oldTable;
+		oldTable.swap(tuple.table);
+		Entry emptyEntry;
+		memset(&emptyEntry, 0, sizeof(emptyEntry));
+		emptyEntry.head = emptyEntry.tail = INVALID_INDEX;
+		tuple.table.assign(oldTable.empty() ? 16 : oldTable.size() * 2, emptyEntry);
+
+		uint32_t tableMask = (uint32_t)tuple.table.size() - 1;
+		for (size_t i = 0; i < oldTable.size(); i++)
+		{
+			if (oldTable[i].head == INVALID_INDEX)
+				continue;
+
+			uint32_t slot = hashKeyWords(oldTable[i].key.words, KeyWords) & tableMask;
+			while (tuple.table[slot].head != INVALID_INDEX)
+				slot = (slot + 1) & tableMask;
+			tuple.table[slot] = oldTable[i];
+		}
+	}
+
+	uint32_t nodeIndex = (uint32_t)m_Chain.size();
+	m_Chain.push_back(node);
+
+	uint32_t tableMask = (uint32_t)tuple.table.size() - 1;
+	uint32_t slot = hashKeyWords(key.words, KeyWords) & tableMask;
+	while (tuple.table[slot].head != INVALID_INDEX)
+	{
+		Entry& entry = tuple.table[slot];
+		if (memcmp(entry.key.words, key.words, sizeof(key.words)) == 0)
+		{
+			// a lower priority rule with the same masked key goes to the end of the chain
+			m_Chain[entry.tail].next = nodeIndex;
+			entry.tail = nodeIndex;
+			return;
+		}
+
+		slot = (slot + 1) & tableMask;
+	}
+
+	Entry& entry = tuple.table[slot];
+	entry.key = key;
+	entry.head = entry.tail = nodeIndex;
+	tuple.numOfEntries++;
+}
+
+const PacketClassifier::Entry* PacketClassifier::lookup(const Tuple& tuple, const Key& key)
+{
+	Key maskedKey;
+	for (int i = 0; i < KeyWords; i++)
+		maskedKey.words[i] = key.words[i] & tuple.mask.words[i];
+
+	uint32_t tableMask = (uint32_t)tuple.table.size() - 1;
+	uint32_t slot = hashKeyWords(maskedKey.words, KeyWords) & tableMask;
+	while (true)
+	{
+		const Entry& entry = tuple.table[slot];
+		if (entry.head == INVALID_INDEX)
+			return NULL;
+
+		if (memcmp(entry.key.words, maskedKey.words, sizeof(maskedKey.words)) == 0)
+			return &entry;
+
+		slot = (slot + 1) & tableMask;
+	}
+}
+
+bool PacketClassifier::extractKey(Packet& packet, Key& key)
+{
+	memset(&key, 0, sizeof(key));
+
+	// classify by the outermost IP layer
+	Layer* ipLayer = packet.getFirstLayer();
+	while (ipLayer != NULL && ipLayer->getProtocol() != IPv4 && ipLayer->getProtocol() != IPv6)
+		ipLayer = ipLayer->getNextLayer();
+
+	if (ipLayer == NULL)
+		return false;
+
+	uint32_t protocol;
+	if (ipLayer->getProtocol() == IPv4)
+	{
+		iphdr* ipHdr = static_cast<IPv4Layer*>(ipLayer)->getIPv4Header();
+		key.words[0] = be32toh(ipHdr->ipSrc);
+		key.words[4] = be32toh(ipHdr->ipDst);
+		protocol = ipHdr->protocol;
+		key.words[9] = KEY_IPV4;
+	}
+	else
+	{
+		ip6_hdr* ipHdr = static_cast<IPv6Layer*>(ipLayer)->getIPv6Header();
+		uint32_t netOrder[8];
+		memcpy(netOrder, ipHdr->ipSrc, 16);
+		memcpy(netOrder + 4, ipHdr->ipDst, 16);
+		for (int i = 0; i < 8; i++)
+			key.words[i] = be32toh(netOrder[i]);
+		protocol = ipHdr->nextHeader;
+		key.words[9] = KEY_IPV6;
+	}
+
+	Layer* transportLayer = ipLayer->getNextLayer();
+	if (transportLayer != NULL && transportLayer->getProtocol() == TCP)
+	{
+		tcphdr* tcpHdr = static_cast<TcpLayer*>(transportLayer)->getTcpHeader();
+		key.words[8] = ((uint32_t)be16toh(tcpHdr->portSrc) << 16) | be16toh(tcpHdr->portDst);
+		protocol = PACKETPP_IPPROTO_TCP;
+		key.words[9] |= KEY_HAS_PORTS_MASK;
+	}
+	else if (transportLayer != NULL && transportLayer->getProtocol() == UDP)
+	{
+		udphdr* udpHdr = static_cast<UdpLayer*>(transportLayer)->getUdpHeader();
+		key.words[8] = ((uint32_t)be16toh(udpHdr->portSrc) << 16) | be16toh(udpHdr->portDst);
+		protocol = PACKETPP_IPPROTO_UDP;
+		key.words[9] |= KEY_HAS_PORTS_MASK;
+	}
+
+	key.words[9] |= (protocol & KEY_PROTOCOL_MASK);
+	return true;
+}
+
+static inline bool portsInRange(uint32_t srcPort, uint32_t dstPort, uint16_t srcPortFrom, uint16_t srcPortTo, uint16_t dstPortFrom, uint16_t dstPortTo)
+{
+	return srcPort >= srcPortFrom && srcPort <= srcPortTo && dstPort >= dstPortFrom && dstPort <= dstPortTo;
+}
+
+const PacketClassifier::ChainNode* PacketClassifier::findFirstMatchingNode(const Entry* entry, const Key& key) const
+{
+	uint32_t srcPort = key.words[8] >> 16;
+	uint32_t dstPort = key.words[8] & 0xffff;
+	for (uint32_t nodeIndex = entry->head; nodeIndex != INVALID_INDEX; nodeIndex = m_Chain[nodeIndex].next)
+	{
+		const ChainNode& node = m_Chain[nodeIndex];
+		if (portsInRange(srcPort, dstPort, node.srcPortFrom, node.srcPortTo, node.dstPortFrom, node.dstPortTo))
+			return &node;
+	}
+
+	return NULL;
+}
+
+uint32_t PacketClassifier::classifyKey(const Key& key) const
+{
+	uint32_t bestRuleIndex = INVALID_INDEX;
+	for (std::vector<Tuple>::const_iterator iter = m_Tuples.begin(); iter != m_Tuples.end(); iter++)
+	{
+		// tuples are ordered by their highest priority rule, so none of the remaining tuples can contain a better rule
+		if (iter->minRuleIndex >= bestRuleIndex)
+			break;
+
+		const Entry* entry = lookup(*iter, key);
+		if (entry == NULL)
+			continue;
+
+		const ChainNode* node = findFirstMatchingNode(entry, key);
+		if (node != NULL && node->ruleIndex < bestRuleIndex)
+			bestRuleIndex = node->ruleIndex;
+	}
+
+	return (bestRuleIndex == INVALID_INDEX ? (uint32_t)NoMatch : m_RuleIds[bestRuleIndex]);
+}
+
+uint32_t PacketClassifier::classify(Packet& packet) const
+{
+	Key key;
+	if (!extractKey(packet, key))
+		return NoMatch;
+
+	return classifyKey(key);
+}
+
+uint32_t PacketClassifier::classify(RawPacket* rawPacket) const
+{
+	Packet packet(rawPacket, false, UnknownProtocol, OsiModelTransportLayer);
+	return classify(packet);
+}
+
+bool PacketClassifier::classifyAll(Packet& packet, std::vector<uint32_t>& ruleIds) const
+{
+	ruleIds.clear();
+
+	Key key;
+	if (!extractKey(packet, key))
+		return false;
+
+	uint32_t srcPort = key.words[8] >> 16;
+	uint32_t dstPort = key.words[8] & 0xffff;
+	std::vector<uint32_t> ruleIndices;
+	for (std::vector<Tuple>::const_iterator iter = m_Tuples.begin(); iter != m_Tuples.end(); iter++)
+	{
+		const Entry* entry = lookup(*iter, key);
+		if (entry == NULL)
+			continue;
+
+		for (uint32_t nodeIndex = entry->head; nodeIndex != INVALID_INDEX; nodeIndex = m_Chain[nodeIndex].next)
+		{
+			const ChainNode& node = m_Chain[nodeIndex];
+			if (portsInRange(srcPort, dstPort, node.srcPortFrom, node.srcPortTo, node.dstPortFrom, node.dstPortTo))
+				ruleIndices.push_back(node.ruleIndex);
+		}
+	}
+
+	std::sort(ruleIndices.begin(), ruleIndices.end());
+	ruleIds.reserve(ruleIndices.size());
+	for (std::vector<uint32_t>::const_iterator iter = ruleIndices.begin(); iter != ruleIndices.end(); iter++)
+		ruleIds.push_back(m_RuleIds[*iter]);
+
+	return !ruleIds.empty();
+}
+
+void PacketClassifier::classifyKeys(const Key* keys, const bool* isValid, size_t numOfKeys, uint32_t* ruleIds) const
+{
+	uint32_t bestRuleIndex[CLASSIFIER_BURST_CHUNK];
+	for (size_t i = 0; i < numOfKeys; i++)
+		bestRuleIndex[i] = INVALID_INDEX;
+
+	// match all packets against one tuple before moving to the next one, so each tuple's table is brought to the cache once per burst
+	for (std::vector<Tuple>::const_iterator iter = m_Tuples.begin(); iter != m_Tuples.end(); iter++)
+	{
+		bool anyPending = false;
+		for (size_t i = 0; i < numOfKeys; i++)
+		{
+			if (!isValid[i] || iter->minRuleIndex >= bestRuleIndex[i])
+				continue;
+
+			anyPending = true;
+			const Entry* entry = lookup(*iter, keys[i]);
+			if (entry == NULL)
+				continue;
+
+			const ChainNode* node = findFirstMatchingNode(entry, keys[i]);
+			if (node != NULL && node->ruleIndex < bestRuleIndex[i])
+				bestRuleIndex[i] = node->ruleIndex;
+		}
+
+		if (!anyPending)
+			break;
+	}
+
+	for (size_t i = 0; i < numOfKeys; i++)
+		ruleIds[i] = (bestRuleIndex[i] == INVALID_INDEX ? (uint32_t)NoMatch : m_RuleIds[bestRuleIndex[i]]);
+}
+
+void PacketClassifier::classifyBurst(RawPacket* const* rawPackets, size_t numOfPackets, uint32_t* ruleIds) const
+{
+	Key keys[CLASSIFIER_BURST_CHUNK];
+	bool isValid[CLASSIFIER_BURST_CHUNK];
+	for (size_t start = 0; start < numOfPackets; start += CLASSIFIER_BURST_CHUNK)
+	{
+		size_t count = std::min((size_t)CLASSIFIER_BURST_CHUNK, numOfPackets - start);
+		for (size_t i = 0; i < count; i++)
+		{
+			Packet packet(rawPackets[start + i], false, UnknownProtocol, OsiModelTransportLayer);
+			isValid[i] = extractKey(packet, keys[i]);
+		}
+
+		classifyKeys(keys, isValid, count, ruleIds + start);
+	}
+}
+
+void PacketClassifier::classifyBurst(RawPacket* rawPackets, size_t numOfPackets, uint32_t* ruleIds) const
+{
+	RawPacket* packetPtrs[CLASSIFIER_BURST_CHUNK];
+	for (size_t start = 0; start < numOfPackets; start += CLASSIFIER_BURST_CHUNK)
+	{
+		size_t count = std::min((size_t)CLASSIFIER_BURST_CHUNK, numOfPackets - start);
+		for (size_t i = 0; i < count; i++)
+			packetPtrs[i] = &rawPackets[start + i];
+
+		classifyBurst(packetPtrs, count, ruleIds + start);
+	}
+}
+
+} // namespace pcpp
@@ -7,52 +7,185 @@
 #include "IcmpLayer.h"
 #include "Logger.h"
 #include "EndianPortable.h"
+#include "SystemUtils.h"
+
+#ifdef PCPP_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
 
 namespace pcpp
 {
 
-uint16_t computeChecksum(ScalarBuffer<uint16_t> vec[], size_t vecSize)
+// All the functions below sum a buffer as a sequence of 16-bit words in host byte order (an odd last byte is padded with a zero byte)
+// and return the sum without folding it. Summing 32-bit words is equivalent since 2^16 = 1 (mod 2^16 - 1)
+
+typedef uint64_t (*ChecksumSumFunc)(const uint8_t* data, size_t dataLen);
+
+static uint64_t checksumSumScalar(const uint8_t* data, size_t dataLen)
 {
-	uint32_t sum = 0;
-	for (size_t i = 0; i<vecSize; i++)
+	uint64_t sum = 0;
+
+	while (dataLen >= 4)
 	{
-		uint32_t local_sum = 0;
-		size_t buff_len = vec[i].len;
-		while (buff_len > 1) {
-			LOG_DEBUG("Value to add = 0x%4X", *(vec[i].buffer));
-			local_sum += *(vec[i].buffer);
-			++(vec[i].buffer);
-			buff_len -= 2;
-		}
-		LOG_DEBUG("Local sum = %d, 0x%4X", local_sum, local_sum);
+		uint32_t word;
+		memcpy(&word, data, sizeof(word));
+		sum += word;
+		data += 4;
+		dataLen -= 4;
+	}
+
+	if (dataLen >= 2)
+	{
+		uint16_t word;
+		memcpy(&word, data, sizeof(word));
+		sum += word;
+		data += 2;
+		dataLen -= 2;
+	}
+
+	if (dataLen == 1)
+	{
+		uint8_t lastWord[2] = { *data, 0 };
+		uint16_t word;
+		memcpy(&word, lastWord, sizeof(word));
+		sum += word;
+	}
 
-		if (buff_len == 1)
+	return sum;
+}
+
+// buffers shorter than this are always summed by checksumSumScalar()
+#define CHECKSUM_SIMD_MIN_LENGTH 64
+
+#ifdef PCPP_X86
+
+// every 32-bit lane grows by at most 2 * 0xFFFF per iteration, so the lanes are flushed before they can overflow
+#define CHECKSUM_SIMD_MAX_ITERATIONS 16384
+
+PCPP_TARGET("sse2")
+static uint64_t checksumSumSse2(const uint8_t* data, size_t dataLen)
+{
+	uint64_t sum = 0;
+	const __m128i zero = _mm_setzero_si128();
+
+	while (dataLen >= 16)
+	{
+		__m128i acc = _mm_setzero_si128();
+		size_t iterations = 0;
+		while (dataLen >= 16 && iterations < CHECKSUM_SIMD_MAX_ITERATIONS)
 		{
-			uint8_t lastByte = *(vec[i].buffer);
-			LOG_DEBUG("1 byte left, adding value: 0x%4X", lastByte);
-			local_sum += lastByte;
-			LOG_DEBUG("Local sum = %d, 0x%4X", local_sum, local_sum);
+			__m128i words = _mm_loadu_si128((const __m128i*)data);
+			acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(words, zero));
+			acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(words, zero));
+			data += 16;
+			dataLen -= 16;
+			iterations++;
 		}
 
-		while (local_sum>>16) {
-			local_sum = (local_sum & 0xffff) + (local_sum >> 16);
+		uint32_t lanes[4];
+		_mm_storeu_si128((__m128i*)lanes, acc);
+		sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	}
+
+	return sum + checksumSumScalar(data, dataLen);
+}
+
+PCPP_TARGET("avx2")
+static uint64_t checksumSumAvx2(const uint8_t* data, size_t dataLen)
+{
+	uint64_t sum = 0;
+	const __m256i zero = _mm256_setzero_si256();
+
+	while (dataLen >= 32)
+	{
+		__m256i acc = _mm256_setzero_si256();
+		size_t iterations = 0;
+		while (dataLen >= 32 && iterations < CHECKSUM_SIMD_MAX_ITERATIONS)
+		{
+			__m256i words = _mm256_loadu_si256((const __m256i*)data);
+			acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(words, zero));
+			acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(words, zero));
+			data += 32;
+			dataLen -= 32;
+			iterations++;
 		}
-		local_sum = be16toh(local_sum);
-		LOG_DEBUG("Local sum = %d, 0x%4X", local_sum, local_sum);
-		sum += local_sum;
+
+		uint32_t lanes[8];
+		_mm256_storeu_si256((__m256i*)lanes, acc);
+		for (int i = 0; i < 8; i++)
+			sum += lanes[i];
 	}
 
-	while (sum>>16) {
+	return sum + checksumSumScalar(data, dataLen);
+}
+
+#endif // PCPP_X86
+
+static ChecksumSumFunc selectChecksumSumFunc()
+{
+#ifdef PCPP_X86
+	if (cpuSupports(CpuAvx2))
+		return checksumSumAvx2;
+	if (cpuSupports(CpuSse2))
+		return checksumSumSse2;
+#endif
+	return checksumSumScalar;
+}
+
+static uint16_t foldChecksumSum(uint64_t sum)
+{
+	while (sum >> 16)
 		sum = (sum & 0xffff) + (sum >> 16);
+
+	return (uint16_t)sum;
+}
+
+uint16_t computeChecksum(ScalarBuffer<uint16_t> vec[], size_t vecSize)
+{
+	static const ChecksumSumFunc checksumSum = selectChecksumSumFunc();
+
+	uint64_t sum = 0;
+	for (size_t i = 0; i < vecSize; i++)
+	{
+		// short buffers (such as IP headers) are faster to sum without the vector setup
+		uint64_t bufferSum = (vec[i].len < CHECKSUM_SIMD_MIN_LENGTH ?
+				checksumSumScalar((const uint8_t*)vec[i].buffer, vec[i].len) :
+				checksumSum((const uint8_t*)vec[i].buffer, vec[i].len));
+		// each buffer is summed in host byte order, so it's converted before it's added to buffers that may start at an odd offset
+		uint16_t localSum = foldChecksumSum(bufferSum);
+		sum += be16toh(localSum);
 	}
 
-	LOG_DEBUG("Sum before invert = %d, 0x%4X", sum, sum);
+	uint16_t result = ~foldChecksumSum(sum);
 
-	sum = ~sum;
+	LOG_DEBUG("Calculated checksum = %d, 0x%4X", result, result);
 
-	LOG_DEBUG("Calculated checksum = %d, 0x%4X", sum, sum);
+	return result;
+}
 
-	return ((uint16_t) sum);
+uint16_t updateChecksum16(uint16_t checksum, uint16_t oldValue, uint16_t newValue)
+{
+	// RFC 1624, eqn. 3: HC' = ~(~HC + ~m + m')
+	uint32_t sum = (uint16_t)~checksum + (uint32_t)(uint16_t)~oldValue + newValue;
+	return ~foldChecksumSum(sum);
+}
+
+uint16_t updateChecksum32(uint16_t checksum, uint32_t oldValue, uint32_t newValue)
+{
+	uint32_t sum = (uint16_t)~checksum
+			+ (uint32_t)(uint16_t)~(oldValue >> 16) + (uint32_t)(uint16_t)~(oldValue & 0xffff)
+			+ (newValue >> 16) + (newValue & 0xffff);
+	return ~foldChecksumSum(sum);
+}
+
+uint16_t updateChecksum(uint16_t checksum, const uint8_t* oldData, const uint8_t* newData, size_t dataLen)
+{
+	// the one's complement of the sum of the old words equals the sum of their one's complements
+	uint64_t sum = (uint16_t)~checksum
+			+ (uint64_t)(uint16_t)~foldChecksumSum(checksumSumScalar(oldData, dataLen))
+			+ foldChecksumSum(checksumSumScalar(newData, dataLen));
+	return ~foldChecksumSum(sum);
 }
 
 static const uint32_t FNV_PRIME = 16777619u;
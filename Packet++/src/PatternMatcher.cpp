@@ -0,0 +1,563 @@
+#define LOG_MODULE PacketLogModulePatternMatcher
+
+#include "PatternMatcher.h"
+#include "TcpLayer.h"
+#include "UdpLayer.h"
+#include "Logger.h"
+#include "SystemUtils.h"
+#include <string.h>
+
+#ifdef PCPP_X86
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace pcpp
+{
+
+// the transition table is addressed with 32-bit premultiplied states
+#define PATTERN_MATCHER_MAX_TABLE_SIZE 0xfffffff0ULL
+
+// bytes are skipped at the initial state only if the patterns start with at most this many distinct bytes, otherwise most bytes
+// start a pattern anyway and checking them before going through the automaton only adds work
+#define PATTERN_MATCHER_MAX_START_BYTES 64
+
+// the automaton of an empty pattern set, searching it never finds anything
+#define PATTERN_MATCHER_NO_MATCH_STATE 0xffffffff
+
+static inline uint8_t foldCase(uint8_t byte)
+{
+	if (byte >= 'A' && byte <= 'Z')
+		return byte + ('a' - 'A');
+	return byte;
+}
+
+// returns the index of the first byte of data that starts a pattern, or dataLen if there is none
+static size_t findStartByteScalar(const uint8_t* data, size_t dataLen, const uint8_t* /* lowMask */, const uint8_t* /* highMask */, const bool* isStartByte)
+{
+	size_t i = 0;
+	while (i < dataLen && !isStartByte[data[i]])
+		i++;
+	return i;
+}
+
+#ifdef PCPP_X86
+
+static inline int countTrailingZeros(uint32_t mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (int)index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+// Checks 16 bytes at a time for membership in the set of start bytes. The set is kept as two 16-byte masks indexed by the low nibble
+// of a byte: bit h of lowMask[l] is set if byte (h << 4 | l) is in the set for h < 8, and bit (h - 8) of highMask[l] for h >= 8.
+// PSHUFB looks up both masks by the low nibbles (it returns 0 for lanes whose index has the top bit set, which selects the right mask)
+// and a third lookup turns the high nibbles into the bit to test
+PCPP_TARGET("ssse3")
+static size_t findStartByteSsse3(const uint8_t* data, size_t dataLen, const uint8_t* lowMask, const uint8_t* highMask, const bool* isStartByte)
+{
+	const __m128i lowMaskVec = _mm_loadu_si128((const __m128i*)lowMask);
+	const __m128i highMaskVec = _mm_loadu_si128((const __m128i*)highMask);
+	const __m128i highNibbleBits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+	const __m128i nibbleMask = _mm_set1_epi8(0x0f);
+	const __m128i topBit = _mm_set1_epi8(-128);
+	const __m128i zero = _mm_setzero_si128();
+
+	size_t i = 0;
+	for (; i + 16 <= dataLen; i += 16)
+	{
+		__m128i bytes = _mm_loadu_si128((const __m128i*)(data + i));
+		__m128i lowNibbleMatch = _mm_or_si128(_mm_shuffle_epi8(lowMaskVec, bytes), _mm_shuffle_epi8(highMaskVec, _mm_xor_si128(bytes, topBit)));
+		__m128i highNibble = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibbleMask);
+		__m128i inSet = _mm_and_si128(lowNibbleMatch, _mm_shuffle_epi8(highNibbleBits, highNibble));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(inSet, zero)) ^ 0xffff;
+		if (mask != 0)
+			return i + countTrailingZeros(mask);
+	}
+
+	return i + findStartByteScalar(data + i, dataLen - i, lowMask, highMask, isStartByte);
+}
+
+#endif // PCPP_X86
+
+
+PatternMatcher::PatternMatcher()
+{
+	m_IsCompiled = false;
+	clear();
+}
+
+bool PatternMatcher::addPattern(const uint8_t* pattern, size_t patternLen, uint32_t patternId, bool caseInsensitive)
+{
+	if (pattern == NULL || patternLen == 0)
+	{
+		LOG_ERROR("Pattern #%u is empty", patternId);
+		return false;
+	}
+
+	Pattern newPattern;
+	newPattern.bytes.assign((const char*)pattern, patternLen);
+	newPattern.id = patternId;
+	newPattern.caseInsensitive = caseInsensitive;
+	m_Patterns.push_back(newPattern);
+	m_IsCompiled = false;
+	return true;
+}
+
+bool PatternMatcher::addPattern(const std::string& pattern, uint32_t patternId, bool caseInsensitive)
+{
+	return addPattern((const uint8_t*)pattern.data(), pattern.length(), patternId, caseInsensitive);
+}
+
+void PatternMatcher::clear()
+{
+	m_Patterns.clear();
+	resetAutomaton(m_CaseSensitive);
+	resetAutomaton(m_CaseInsensitive);
+	m_IsCompiled = false;
+	m_HasCaseSensitive = false;
+	m_HasCaseInsensitive = false;
+	m_SkipEnabled = false;
+	memset(m_IsStartByte, 0, sizeof(m_IsStartByte));
+	memset(m_StartByteLowMask, 0, sizeof(m_StartByteLowMask));
+	memset(m_StartByteHighMask, 0, sizeof(m_StartByteHighMask));
+	m_FindStartByte = findStartByteScalar;
+}
+
+void PatternMatcher::resetAutomaton(Automaton& automaton)
+{
+	// a single state that goes back to itself on every byte and never matches
+	automaton.transitions.assign(1, 0);
+	memset(automaton.byteClass, 0, sizeof(automaton.byteClass));
+	automaton.numOfClasses = 1;
+	automaton.numOfStates = 1;
+	automaton.firstMatchState = PATTERN_MATCHER_NO_MATCH_STATE;
+	automaton.matchListStart.clear();
+	automaton.matchPatterns.clear();
+}
+
+bool PatternMatcher::compile()
+{
+	resetAutomaton(m_CaseSensitive);
+	resetAutomaton(m_CaseInsensitive);
+	m_HasCaseSensitive = false;
+	m_HasCaseInsensitive = false;
+	m_IsCompiled = false;
+
+	for (std::vector<Pattern>::const_iterator iter = m_Patterns.begin(); iter != m_Patterns.end(); ++iter)
+	{
+		if (iter->caseInsensitive)
+			m_HasCaseInsensitive = true;
+		else
+			m_HasCaseSensitive = true;
+	}
+
+	if ((m_HasCaseSensitive && !buildAutomaton(m_CaseSensitive, false)) || (m_HasCaseInsensitive && !buildAutomaton(m_CaseInsensitive, true)))
+	{
+		resetAutomaton(m_CaseSensitive);
+		resetAutomaton(m_CaseInsensitive);
+		m_HasCaseSensitive = false;
+		m_HasCaseInsensitive = false;
+		buildStartByteSkipping();
+		return false;
+	}
+
+	buildStartByteSkipping();
+	m_IsCompiled = true;
+	return true;
+}
+
+bool PatternMatcher::buildAutomaton(Automaton& automaton, bool caseInsensitive)
+{
+	// assign a class to each byte value that appears in the patterns, all other bytes share class 0
+	uint16_t classOfValue[256];
+	memset(classOfValue, 0, sizeof(classOfValue));
+	uint32_t numOfClasses = 1;
+	for (std::vector<Pattern>::const_iterator iter = m_Patterns.begin(); iter != m_Patterns.end(); ++iter)
+	{
+		if (iter->caseInsensitive != caseInsensitive)
+			continue;
+
+		for (size_t i = 0; i < iter->bytes.length(); i++)
+		{
+			uint8_t value = (uint8_t)iter->bytes[i];
+			if (caseInsensitive)
+				value = foldCase(value);
+			if (classOfValue[value] == 0)
+				classOfValue[value] = (uint16_t)numOfClasses++;
+		}
+	}
+
+	for (int value = 0; value < 256; value++)
+		automaton.byteClass[value] = classOfValue[caseInsensitive ? foldCase((uint8_t)value) : value];
+	automaton.numOfClasses = numOfClasses;
+
+	// build the trie. Transitions are kept as plain state numbers until the end, 0 means there's no child yet (the initial state is
+	// never a child)
+	std::vector<uint32_t> delta(numOfClasses, 0);
+	std::vector<std::vector<uint32_t> > outputs(1);
+	uint32_t numOfStates = 1;
+	for (size_t patternIndex = 0; patternIndex < m_Patterns.size(); patternIndex++)
+	{
+		const Pattern& pattern = m_Patterns[patternIndex];
+		if (pattern.caseInsensitive != caseInsensitive)
+			continue;
+
+		uint32_t state = 0;
+		for (size_t i = 0; i < pattern.bytes.length(); i++)
+		{
+			uint32_t byteClass = automaton.byteClass[(uint8_t)pattern.bytes[i]];
+			if (delta[state * numOfClasses + byteClass] == 0)
+			{
+				if ((uint64_t)(numOfStates + 1) * numOfClasses > PATTERN_MATCHER_MAX_TABLE_SIZE)
+				{
+					LOG_ERROR("Cannot compile patterns: the automaton is too large");
+					return false;
+				}
+
+				delta[state * numOfClasses + byteClass] = numOfStates++;
+				delta.resize((size_t)numOfStates * numOfClasses, 0);
+				outputs.push_back(std::vector<uint32_t>());
+			}
+
+			state = delta[state * numOfClasses + byteClass];
+		}
+
+		outputs[state].push_back((uint32_t)patternIndex);
+	}
+
+	// Turn the trie into a DFA in breadth-first order. When a state is dequeued its row still holds only its trie children: each child
+	// gets its failure state (the state of the longest proper suffix that is in the trie) and all missing transitions are copied from
+	// the failure state's row, which is already complete since the failure state is shallower
+	std::vector<uint32_t> failure(numOfStates, 0);
+	std::vector<uint32_t> queue;
+	queue.reserve(numOfStates);
+	for (uint32_t byteClass = 0; byteClass < numOfClasses; byteClass++)
+	{
+		if (delta[byteClass] != 0)
+			queue.push_back(delta[byteClass]);
+	}
+
+	for (size_t head = 0; head < queue.size(); head++)
+	{
+		uint32_t state = queue[head];
+		uint32_t* row = &delta[(size_t)state * numOfClasses];
+		const uint32_t* failureRow = &delta[(size_t)failure[state] * numOfClasses];
+		for (uint32_t byteClass = 0; byteClass < numOfClasses; byteClass++)
+		{
+			uint32_t child = row[byteClass];
+			if (child == 0)
+			{
+				row[byteClass] = failureRow[byteClass];
+				continue;
+			}
+
+			failure[child] = failureRow[byteClass];
+			// the patterns that end at the failure state end at the child as well
+			const std::vector<uint32_t>& failureOutputs = outputs[failure[child]];
+			outputs[child].insert(outputs[child].end(), failureOutputs.begin(), failureOutputs.end());
+			queue.push_back(child);
+		}
+	}
+
+	// renumber the states so the ones that end a pattern come last, the initial state stays 0
+	std::vector<uint32_t> newNumber(numOfStates);
+	uint32_t nextNumber = 0;
+	for (uint32_t state = 0; state < numOfStates; state++)
+	{
+		if (outputs[state].empty())
+			newNumber[state] = nextNumber++;
+	}
+
+	uint32_t firstMatchState = nextNumber;
+	std::vector<uint32_t> matchStateOf(numOfStates - firstMatchState);
+	for (uint32_t state = 0; state < numOfStates; state++)
+	{
+		if (!outputs[state].empty())
+		{
+			matchStateOf[nextNumber - firstMatchState] = state;
+			newNumber[state] = nextNumber++;
+		}
+	}
+
+	automaton.transitions.resize((size_t)numOfStates * numOfClasses);
+	for (uint32_t state = 0; state < numOfStates; state++)
+	{
+		const uint32_t* oldRow = &delta[(size_t)state * numOfClasses];
+		uint32_t* newRow = &automaton.transitions[(size_t)newNumber[state] * numOfClasses];
+		for (uint32_t byteClass = 0; byteClass < numOfClasses; byteClass++)
+			newRow[byteClass] = newNumber[oldRow[byteClass]] * numOfClasses;
+	}
+
+	automaton.numOfStates = numOfStates;
+	automaton.firstMatchState = firstMatchState * numOfClasses;
+	automaton.matchListStart.resize(matchStateOf.size() + 1);
+	automaton.matchPatterns.clear();
+	for (size_t i = 0; i < matchStateOf.size(); i++)
+	{
+		automaton.matchListStart[i] = (uint32_t)automaton.matchPatterns.size();
+		const std::vector<uint32_t>& stateOutputs = outputs[matchStateOf[i]];
+		automaton.matchPatterns.insert(automaton.matchPatterns.end(), stateOutputs.begin(), stateOutputs.end());
+	}
+	automaton.matchListStart[matchStateOf.size()] = (uint32_t)automaton.matchPatterns.size();
+
+	return true;
+}
+
+void PatternMatcher::buildStartByteSkipping()
+{
+	// a byte starts a pattern if it moves an automaton out of its initial state
+	int numOfStartBytes = 0;
+	memset(m_StartByteLowMask, 0, sizeof(m_StartByteLowMask));
+	memset(m_StartByteHighMask, 0, sizeof(m_StartByteHighMask));
+	for (int value = 0; value < 256; value++)
+	{
+		m_IsStartByte[value] =
+				(m_HasCaseSensitive && m_CaseSensitive.transitions[m_CaseSensitive.byteClass[value]] != 0) ||
+				(m_HasCaseInsensitive && m_CaseInsensitive.transitions[m_CaseInsensitive.byteClass[value]] != 0);
+
+		if (!m_IsStartByte[value])
+			continue;
+
+		numOfStartBytes++;
+		int highNibble = value >> 4;
+		if (highNibble < 8)
+			m_StartByteLowMask[value & 0x0f] |= (uint8_t)(1 << highNibble);
+		else
+			m_StartByteHighMask[value & 0x0f] |= (uint8_t)(1 << (highNibble - 8));
+	}
+
+	m_SkipEnabled = (numOfStartBytes > 0 && numOfStartBytes <= PATTERN_MATCHER_MAX_START_BYTES);
+
+	m_FindStartByte = findStartByteScalar;
+#ifdef PCPP_X86
+	if (cpuSupports(CpuSsse3))
+		m_FindStartByte = findStartByteSsse3;
+#endif
+}
+
+size_t PatternMatcher::getNumOfStates() const
+{
+	size_t result = 0;
+	if (m_HasCaseSensitive)
+		result += m_CaseSensitive.numOfStates;
+	if (m_HasCaseInsensitive)
+		result += m_CaseInsensitive.numOfStates;
+	return result;
+}
+
+size_t PatternMatcher::getMemoryUsage() const
+{
+	const Automaton* automata[] = { &m_CaseSensitive, &m_CaseInsensitive };
+	size_t result = 0;
+	for (int i = 0; i < 2; i++)
+	{
+		result += automata[i]->transitions.size() * sizeof(uint32_t) + automata[i]->matchListStart.size() * sizeof(uint32_t) +
+				automata[i]->matchPatterns.size() * sizeof(uint32_t);
+	}
+
+	return result;
+}
+
+size_t PatternMatcher::reportMatches(const Automaton& automaton, uint32_t state, uint64_t endOffset, OnPatternMatch onMatch, void* userCookie) const
+{
+	uint32_t matchState = (state - automaton.firstMatchState) / automaton.numOfClasses;
+	uint32_t first = automaton.matchListStart[matchState];
+	uint32_t last = automaton.matchListStart[matchState + 1];
+	if (onMatch == NULL)
+		return last - first;
+
+	for (uint32_t i = first; i < last; i++)
+	{
+		const Pattern& pattern = m_Patterns[automaton.matchPatterns[i]];
+		PatternMatch match;
+		match.patternId = pattern.id;
+		match.endOffset = endOffset;
+		match.startOffset = endOffset - pattern.bytes.length();
+		onMatch(match, userCookie);
+	}
+
+	return last - first;
+}
+
+template<bool UseCaseSensitive, bool UseCaseInsensitive>
+size_t PatternMatcher::scan(PatternMatchStream& stream, const uint8_t* data, size_t dataLen, OnPatternMatch onMatch, void* userCookie, bool stopAtFirstMatch) const
+{
+	const uint32_t* sensitiveTransitions = &m_CaseSensitive.transitions[0];
+	const uint16_t* sensitiveClass = m_CaseSensitive.byteClass;
+	const uint32_t sensitiveFirstMatch = m_CaseSensitive.firstMatchState;
+	const uint32_t* insensitiveTransitions = &m_CaseInsensitive.transitions[0];
+	const uint16_t* insensitiveClass = m_CaseInsensitive.byteClass;
+	const uint32_t insensitiveFirstMatch = m_CaseInsensitive.firstMatchState;
+
+	uint32_t sensitiveState = stream.m_CaseSensitiveState;
+	uint32_t insensitiveState = stream.m_CaseInsensitiveState;
+	size_t numOfMatches = 0;
+	size_t i = 0;
+
+	while (i < dataLen)
+	{
+		if (m_SkipEnabled && (!UseCaseSensitive || sensitiveState == 0) && (!UseCaseInsensitive || insensitiveState == 0) && !m_IsStartByte[data[i]])
+		{
+			i += m_FindStartByte(data + i, dataLen - i, m_StartByteLowMask, m_StartByteHighMask, m_IsStartByte);
+			if (i >= dataLen)
+				break;
+		}
+
+		uint8_t value = data[i++];
+		if (UseCaseSensitive)
+			sensitiveState = sensitiveTransitions[sensitiveState + sensitiveClass[value]];
+		if (UseCaseInsensitive)
+			insensitiveState = insensitiveTransitions[insensitiveState + insensitiveClass[value]];
+
+		if ((UseCaseSensitive && sensitiveState >= sensitiveFirstMatch) || (UseCaseInsensitive && insensitiveState >= insensitiveFirstMatch))
+		{
+			uint64_t endOffset = stream.m_Offset + i;
+			if (UseCaseSensitive && sensitiveState >= sensitiveFirstMatch)
+				numOfMatches += reportMatches(m_CaseSensitive, sensitiveState, endOffset, onMatch, userCookie);
+			if (UseCaseInsensitive && insensitiveState >= insensitiveFirstMatch)
+				numOfMatches += reportMatches(m_CaseInsensitive, insensitiveState, endOffset, onMatch, userCookie);
+
+			if (stopAtFirstMatch)
+				break;
+		}
+	}
+
+	stream.m_CaseSensitiveState = sensitiveState;
+	stream.m_CaseInsensitiveState = insensitiveState;
+	stream.m_Offset += i;
+	return numOfMatches;
+}
+
+size_t PatternMatcher::dispatchScan(PatternMatchStream& stream, const uint8_t* data, size_t dataLen, OnPatternMatch onMatch, void* userCookie, bool stopAtFirstMatch) const
+{
+	// a stream searched before the matcher was compiled again may hold states that don't exist anymore
+	if (stream.m_CaseSensitiveState >= m_CaseSensitive.transitions.size() || stream.m_CaseInsensitiveState >= m_CaseInsensitive.transitions.size())
+	{
+		stream.m_CaseSensitiveState = 0;
+		stream.m_CaseInsensitiveState = 0;
+	}
+
+	if (data == NULL || dataLen == 0)
+		return 0;
+
+	if (m_HasCaseSensitive && m_HasCaseInsensitive)
+		return scan<true, true>(stream, data, dataLen, onMatch, userCookie, stopAtFirstMatch);
+	if (m_HasCaseSensitive)
+		return scan<true, false>(stream, data, dataLen, onMatch, userCookie, stopAtFirstMatch);
+	if (m_HasCaseInsensitive)
+		return scan<false, true>(stream, data, dataLen, onMatch, userCookie, stopAtFirstMatch);
+
+	stream.m_Offset += dataLen;
+	return 0;
+}
+
+size_t PatternMatcher::search(const uint8_t* data, size_t dataLen, OnPatternMatch onMatch, void* userCookie) const
+{
+	PatternMatchStream stream;
+	return dispatchScan(stream, data, dataLen, onMatch, userCookie, false);
+}
+
+static void appendPatternMatch(const PatternMatch& match, void* userCookie)
+{
+	((std::vector<PatternMatch>*)userCookie)->push_back(match);
+}
+
+size_t PatternMatcher::search(const uint8_t* data, size_t dataLen, std::vector<PatternMatch>& matches) const
+{
+	PatternMatchStream stream;
+	return dispatchScan(stream, data, dataLen, appendPatternMatch, &matches, false);
+}
+
+size_t PatternMatcher::search(Packet& packet, OnPatternMatch onMatch, void* userCookie) const
+{
+	Layer* transportLayer = packet.getLayerOfType<TcpLayer>();
+	if (transportLayer == NULL)
+		transportLayer = packet.getLayerOfType<UdpLayer>();
+	if (transportLayer == NULL)
+		return 0;
+
+	return search(transportLayer->getLayerPayload(), transportLayer->getLayerPayloadSize(), onMatch, userCookie);
+}
+
+bool PatternMatcher::containsAny(const uint8_t* data, size_t dataLen) const
+{
+	PatternMatchStream stream;
+	return dispatchScan(stream, data, dataLen, NULL, NULL, true) > 0;
+}
+
+size_t PatternMatcher::searchStream(PatternMatchStream& stream, const uint8_t* data, size_t dataLen, OnPatternMatch onMatch, void* userCookie) const
+{
+	return dispatchScan(stream, data, dataLen, onMatch, userCookie, false);
+}
+
+
+PatternFlowMatcher::PatternFlowMatcher(const PatternMatcher& matcher, OnFlowPatternMatch onMatch, void* userCookie) :
+	m_Matcher(matcher), m_OnMatch(onMatch), m_UserCookie(userCookie)
+{
+}
+
+PatternMatchStream* PatternFlowMatcher::getStream(uint32_t flowKey, int8_t side)
+{
+	if (side != 0 && side != 1)
+	{
+		LOG_ERROR("Flow side must be 0 or 1");
+		return NULL;
+	}
+
+	return &(m_Flows[flowKey].sides[side]);
+}
+
+void PatternFlowMatcher::onStreamMatch(const PatternMatch& match, void* userCookie)
+{
+	MatchContext* context = (MatchContext*)userCookie;
+	if (context->flowMatcher->m_OnMatch != NULL)
+		context->flowMatcher->m_OnMatch(context->flowKey, context->side, match, context->flowMatcher->m_UserCookie);
+}
+
+size_t PatternFlowMatcher::scan(uint32_t flowKey, int8_t side, const uint8_t* data, size_t dataLen)
+{
+	PatternMatchStream* stream = getStream(flowKey, side);
+	if (stream == NULL)
+		return 0;
+
+	MatchContext context;
+	context.flowMatcher = this;
+	context.flowKey = flowKey;
+	context.side = side;
+	return m_Matcher.searchStream(*stream, data, dataLen, onStreamMatch, &context);
+}
+
+size_t PatternFlowMatcher::scan(int8_t side, const TcpStreamData& tcpData)
+{
+	uint32_t flowKey = tcpData.getConnectionData().flowKey;
+	if (tcpData.isBytesMissing())
+	{
+		PatternMatchStream* stream = getStream(flowKey, side);
+		if (stream == NULL)
+			return 0;
+		stream->skip(tcpData.getMissingByteCount());
+	}
+
+	return scan(flowKey, side, tcpData.getData(), tcpData.getDataLength());
+}
+
+void PatternFlowMatcher::closeFlow(uint32_t flowKey)
+{
+	m_Flows.erase(flowKey);
+}
+
+void PatternFlowMatcher::clear()
+{
+	m_Flows.clear();
+}
+
+} // namespace pcpp
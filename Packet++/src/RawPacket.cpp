@@ -55,7 +55,7 @@ RawPacket& RawPacket::operator=(const RawPacket& other)
 {
 	if (this != &other)
 	{
-		if (m_RawData != NULL)
+		if (m_RawData != NULL && m_DeleteRawDataAtDestructor)
 			delete [] m_RawData;
 
 		m_RawPacketSet = false;
@@ -114,7 +114,7 @@ bool RawPacket::setRawData(const uint8_t* pRawData, int rawDataLen, timespec tim
 
 void RawPacket::clear()
 {
-	if (m_RawData != 0)
+	if (m_RawData != 0 && m_DeleteRawDataAtDestructor)
 		delete[] m_RawData;
 
 	m_RawData = 0;
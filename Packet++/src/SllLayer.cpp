@@ -103,11 +103,11 @@ void SllLayer::parseNextLayer()
 
 void SllLayer::computeCalculateFields()
 {
-	if (m_NextLayer == NULL)
+	if (getNextLayer() == NULL)
 		return;
 
 	sll_header* hdr = getSllHeader();
-	switch (m_NextLayer->getProtocol())
+	switch (getNextLayer()->getProtocol())
 	{
 		case IPv4:
 			hdr->protocol_type = htobe16(PCPP_ETHERTYPE_IP);
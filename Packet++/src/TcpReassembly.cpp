@@ -16,6 +16,14 @@
 
 #define PURGE_FREQ_SECS 1
 
+#define INITIAL_CONNECTION_TABLE_SIZE 64
+
+// the maximum number of bytes kept in free fragments for reuse
+#define MAX_FRAGMENT_POOL_BYTES (4 * 1024 * 1024)
+
+// the approximate memory accounted for each connection: its state, its connection information and its share of the connection table
+#define CONNECTION_MEMORY_USAGE (sizeof(TcpReassemblyData) + sizeof(ConnectionData) + 2 * sizeof(ConnectionTableSlot))
+
 #define SEQ_LT(a,b)  ((int32_t)((a)-(b)) < 0)
 #define SEQ_LEQ(a,b) ((int32_t)((a)-(b)) <= 0)
 #define SEQ_GT(a,b)  ((int32_t)((a)-(b)) > 0)
@@ -42,7 +50,74 @@ TcpReassembly::TcpReassembly(OnTcpMessageReady onMessageReadyCallback, void* use
 	m_RemoveConnInfo = config.removeConnInfo;
 	m_MaxNumToClean = (config.removeConnInfo == true && config.maxNumToClean == 0) ? 30 : config.maxNumToClean;
 	m_MaxOutOfOrderFragments = config.maxOutOfOrderFragments;
+	m_MaxNumOfConnections = config.maxNumOfConnections;
+	m_MaxMemoryUsage = config.maxMemoryUsage;
+	m_MemoryUsage = 0;
+	m_MaxOutOfOrderBytesPerConnection = config.maxOutOfOrderBytesPerConnection;
+	m_MaxOutOfOrderBytes = config.maxOutOfOrderBytes;
+	m_OutOfOrderBytes = 0;
+	m_FragmentPoolBytes = 0;
+	m_NumOfConnections = 0;
+	m_IdleListHead = InvalidConnIndex;
+	m_IdleListTail = InvalidConnIndex;
 	m_PurgeTimepoint = time(NULL) + PURGE_FREQ_SECS;
+
+	// the table is kept at most half full. If its capacity is limited it's allocated once and never grows
+	size_t tableSize = INITIAL_CONNECTION_TABLE_SIZE;
+	while (tableSize < 2 * m_MaxNumOfConnections)
+		tableSize *= 2;
+	ConnectionTableSlot emptySlot = { 0, InvalidConnIndex };
+	m_ConnectionTable.resize(tableSize, emptySlot);
+
+	// closed connections are never due more than m_ClosedConnectionDelay seconds ahead, so every wheel slot holds a single second
+	m_CleanupWheel.resize(m_ClosedConnectionDelay + 1, (uint32_t)InvalidConnIndex);
+	m_CleanupWheelTime = time(NULL);
+}
+
+TcpReassembly::~TcpReassembly()
+{
+	for (std::vector<TcpReassemblyData*>::iterator iter = m_ConnectionBlocks.begin(); iter != m_ConnectionBlocks.end(); ++iter)
+	{
+		for (uint32_t i = 0; i < ConnectionBlockSize; i++)
+		{
+			for (int side = 0; side < 2; side++)
+			{
+				TcpFragmentList& fragList = (*iter)[i].twoSides[side].tcpFragmentList;
+				for (TcpFragmentList::iterator fragIter = fragList.begin(); fragIter != fragList.end(); ++fragIter)
+					delete [] (uint8_t*)*fragIter;
+			}
+		}
+
+		delete [] *iter;
+	}
+
+	for (int sizeClass = 0; sizeClass < NumOfFragmentSizeClasses; sizeClass++)
+	{
+		for (std::vector<TcpFragment*>::iterator iter = m_FragmentPool[sizeClass].begin(); iter != m_FragmentPool[sizeClass].end(); ++iter)
+			delete [] (uint8_t*)*iter;
+	}
+}
+
+void TcpReassembly::TcpReassemblyData::clear()
+{
+	closed = false;
+	numOfSides = 0;
+	prevSide = -1;
+	for (int i = 0; i < 2; i++)
+	{
+		twoSides[i].srcIP = IPAddress();
+		twoSides[i].srcPort = 0;
+		twoSides[i].sequence = 0;
+		twoSides[i].tcpFragmentList.clear();
+		twoSides[i].gotFinOrRst = false;
+	}
+	connData = ConnectionData();
+	outOfOrderBytes = 0;
+	idlePrev = InvalidConnIndex;
+	idleNext = InvalidConnIndex;
+	cleanupPrev = InvalidConnIndex;
+	cleanupNext = InvalidConnIndex;
+	cleanupTime = 0;
 }
 
 
@@ -129,14 +204,22 @@ TcpReassembly::ReassemblyStatus TcpReassembly::reassemblePacket(Packet& tcpData)
 	// calculate flow key for this packet
 	uint32_t flowKey = hash5Tuple(&tcpData);
 
-	// find the connection in the connection map
-	ConnectionList::iterator iter = m_ConnectionList.find(flowKey);
+	// find the connection in the connection table
+	uint32_t connIndex = findConnection(flowKey);
 
-	if (iter == m_ConnectionList.end())
+	if (connIndex == InvalidConnIndex)
 	{
-		// if it's a packet of a new connection, create a TcpReassemblyData object and add it to the active connection list
-		std::pair<ConnectionList::iterator, bool> pair = m_ConnectionList.insert(std::make_pair(flowKey, TcpReassemblyData()));
-		tcpReassemblyData = &pair.first->second;
+		// make room for the new connection if the connection table or the memory cap is full
+		while ((m_MaxNumOfConnections > 0 && m_NumOfConnections >= m_MaxNumOfConnections) ||
+				(m_MaxMemoryUsage > 0 && m_MemoryUsage + CONNECTION_MEMORY_USAGE > m_MaxMemoryUsage))
+		{
+			if (!evictIdleConnection(InvalidConnIndex))
+				break;
+		}
+
+		// if it's a packet of a new connection, create a TcpReassemblyData object and add it to the connection table
+		connIndex = createConnection(flowKey);
+		tcpReassemblyData = getConnection(connIndex);
 		tcpReassemblyData->connData.srcIP = srcIP;
 		tcpReassemblyData->connData.dstIP = dstIP;
 		tcpReassemblyData->connData.srcPort = be16toh(tcpLayer->getTcpHeader()->portSrc);
@@ -153,14 +236,16 @@ TcpReassembly::ReassemblyStatus TcpReassembly::reassemblePacket(Packet& tcpData)
 	}
 	else // connection already exists
 	{
+		tcpReassemblyData = getConnection(connIndex);
+
 		// if this packet belongs to a connection that was already closed (for example: data packet that comes after FIN), ignore it.
-		if (iter->second.closed)
+		if (tcpReassemblyData->closed)
 		{
 			LOG_DEBUG("Ignoring packet of already closed flow [0x%X]", flowKey);
 			return Ignore_PacketOfClosedFlow;
 		}
 
-		tcpReassemblyData = &iter->second;
+		touchConnection(connIndex);
 		timeval currTime = timespecToTimeval(tcpData.getRawPacket()->getPacketTimeStamp());
 
 		if (currTime.tv_sec > tcpReassemblyData->connData.endTime.tv_sec)
@@ -415,22 +500,37 @@ TcpReassembly::ReassemblyStatus TcpReassembly::reassemblePacket(Packet& tcpData)
 			return status;
 		}
 
-		// create a new TcpFragment, copy the TCP data to it and add this packet to the the out-of-order packet list
-		TcpFragment* newTcpFrag = new TcpFragment();
-		newTcpFrag->data = new uint8_t[tcpPayloadSize];
-		newTcpFrag->dataLength = tcpPayloadSize;
-		newTcpFrag->sequence = sequence;
-		memcpy(newTcpFrag->data, tcpLayer->getLayerPayload(), tcpPayloadSize);
-		tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.pushBack(newTcpFrag);
+		// copy the TCP data to a new fragment and add it to the out-of-order packet list
+		addFragment(tcpReassemblyData, sideIndex, sequence, tcpLayer->getLayerPayload(), tcpPayloadSize);
 
 		LOG_DEBUG("Found out-of-order packet and added a new TCP fragment with size %d to the out-of-order list of side %d", (int)tcpPayloadSize, sideIndex);
 		status = OutOfOrderTcpMessageBuffered;
 
-		// check if we've stored too many out-of-order fragments; if so, consider missing packets lost and
-		// continue processing until the number of stored fragments is lower than the acceptable limit again
-		if (m_MaxOutOfOrderFragments > 0 && tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.size() > m_MaxOutOfOrderFragments)
+		// check if we've stored too many out-of-order fragments or bytes; if so, consider missing packets lost and
+		// continue processing until the stored data is within the acceptable limits again
+		if (!isOutOfOrderDataWithinLimits(tcpReassemblyData, sideIndex))
 		{
 			checkOutOfOrderFragments(tcpReassemblyData, sideIndex, false);
+
+			// the per-connection limit may still be exceeded by data stored for the other side
+			if (!isOutOfOrderDataWithinLimits(tcpReassemblyData, 1 - sideIndex))
+				checkOutOfOrderFragments(tcpReassemblyData, 1 - sideIndex, false);
+		}
+
+		if (m_MaxOutOfOrderBytes > 0 && m_OutOfOrderBytes > m_MaxOutOfOrderBytes)
+		{
+			releaseOutOfOrderData(connIndex);
+		}
+
+		// if the memory cap is exceeded evict idle connections. If this connection alone exceeds it, its out-of-order fragments are considered lost
+		if (m_MaxMemoryUsage > 0 && m_MemoryUsage > m_MaxMemoryUsage)
+		{
+			while (m_MemoryUsage > m_MaxMemoryUsage && evictIdleConnection(connIndex))
+			{
+			}
+
+			if (m_MemoryUsage > m_MaxMemoryUsage)
+				checkOutOfOrderFragments(tcpReassemblyData, sideIndex, true);
 		}
 
 		// handle case where this packet is FIN or RST
@@ -477,179 +577,107 @@ void TcpReassembly::handleFinOrRst(TcpReassemblyData* tcpReassemblyData, int8_t
 
 void TcpReassembly::checkOutOfOrderFragments(TcpReassemblyData* tcpReassemblyData, int8_t sideIndex, bool cleanWholeFragList)
 {
-	bool foundSomething = false;
+	TcpOneSideData& sideData = tcpReassemblyData->twoSides[sideIndex];
 
-	do
+	// the fragment list is sorted by sequence, so fragments that match the current sequence or have a smaller sequence are always at its front
+	while (!sideData.tcpFragmentList.empty())
 	{
-		LOG_DEBUG("Starting first iteration of checkOutOfOrderFragments - looking for fragments that match the current sequence or have smaller sequence");
+		TcpFragment* curTcpFrag = sideData.tcpFragmentList.front();
 
-		int index = 0;
-		foundSomething = false;
-
-		do
+		// if fragment sequence matches the current sequence
+		if (curTcpFrag->sequence == sideData.sequence)
 		{
-			index = 0;
-			foundSomething = false;
-
-			// first fragment list iteration - go over the whole fragment list and see if can find fragments that match the current sequence
-			// or have smaller sequence but have big enough payload to get new data
-			while (index < (int)tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.size())
-			{
-				TcpFragment* curTcpFrag = tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.at(index);
+			// update sequence
+			sideData.sequence += curTcpFrag->dataLength;
 
-				// if fragment sequence matches the current sequence
-				if (curTcpFrag->sequence == tcpReassemblyData->twoSides[sideIndex].sequence)
-				{
-					// update sequence
-					tcpReassemblyData->twoSides[sideIndex].sequence += curTcpFrag->dataLength;
-					if (curTcpFrag->data != NULL)
-					{
-						LOG_DEBUG("Found an out-of-order packet matching to the current sequence with size %d on side %d. Pulling it out of the list and sending the data to the callback", (int)curTcpFrag->dataLength, sideIndex);
+			LOG_DEBUG("Found an out-of-order packet matching to the current sequence with size %d on side %d. Pulling it out of the list and sending the data to the callback", (int)curTcpFrag->dataLength, sideIndex);
 
-						// send new data to callback
+			// send new data to callback
+			if (m_OnMessageReadyCallback != NULL)
+			{
+				TcpStreamData streamData(curTcpFrag->data, curTcpFrag->dataLength, 0, tcpReassemblyData->connData);
+				m_OnMessageReadyCallback(sideIndex, streamData, m_UserCookie);
+			}
 
-						if (m_OnMessageReadyCallback != NULL)
-						{
-							TcpStreamData streamData(curTcpFrag->data, curTcpFrag->dataLength, 0, tcpReassemblyData->connData);
-							m_OnMessageReadyCallback(sideIndex, streamData, m_UserCookie);
-						}
-					}
+			// remove fragment from list
+			removeFirstFragment(tcpReassemblyData, sideIndex);
+			continue;
+		}
 
+		// if fragment sequence has lower sequence than the current sequence
+		if (SEQ_LT(curTcpFrag->sequence, sideData.sequence))
+		{
+			// check if it still has new data
+			uint32_t newSequence = curTcpFrag->sequence + curTcpFrag->dataLength;
 
-					// remove fragment from list
-					tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.erase(tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.begin() + index);
+			// it has new data
+			if (SEQ_GT(newSequence, sideData.sequence))
+			{
+				// calculate the delta new data size
+				uint32_t newLength = sideData.sequence - curTcpFrag->sequence;
 
-					foundSomething = true;
+				LOG_DEBUG("Found a fragment in the out-of-order list which its sequence is lower than expected but its payload is long enough to contain new data. "
+					"Calling the callback with the new data. Fragment size is %d on side %d, new data size is %d", (int)curTcpFrag->dataLength, sideIndex, (int)(curTcpFrag->dataLength - newLength));
 
-					continue;
-				}
+				// update current sequence with the delta new data size
+				sideData.sequence += curTcpFrag->dataLength - newLength;
 
-				// if fragment sequence has lower sequence than the current sequence
-				if (SEQ_LT(curTcpFrag->sequence, tcpReassemblyData->twoSides[sideIndex].sequence))
+				// send only the new data to the callback
+				if (m_OnMessageReadyCallback != NULL)
 				{
-					// check if it still has new data
-					uint32_t newSequence = curTcpFrag->sequence + curTcpFrag->dataLength;
-
-					// it has new data
-					if (SEQ_GT(newSequence, tcpReassemblyData->twoSides[sideIndex].sequence))
-					{
-						// calculate the delta new data size
-						uint32_t newLength = tcpReassemblyData->twoSides[sideIndex].sequence - curTcpFrag->sequence;
-
-						LOG_DEBUG("Found a fragment in the out-of-order list which its sequence is lower than expected but its payload is long enough to contain new data. "
-							"Calling the callback with the new data. Fragment size is %d on side %d, new data size is %d", (int)curTcpFrag->dataLength, sideIndex, (int)(curTcpFrag->dataLength - newLength));
-
-						// update current sequence with the delta new data size
-						tcpReassemblyData->twoSides[sideIndex].sequence += curTcpFrag->dataLength - newLength;
-
-						// send only the new data to the callback
-						if (m_OnMessageReadyCallback != NULL)
-						{
-							TcpStreamData streamData(curTcpFrag->data + newLength, curTcpFrag->dataLength - newLength, 0, tcpReassemblyData->connData);
-							m_OnMessageReadyCallback(sideIndex, streamData, m_UserCookie);
-						}
-
-						foundSomething = true;
-					}
-					else
-					{
-						LOG_DEBUG("Found a fragment in the out-of-order list which doesn't contain any new data, ignoring it. Fragment size is %d on side %d", (int)curTcpFrag->dataLength, sideIndex);
-					}
-
-					// delete fragment from list
-					tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.erase(tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.begin() + index);
-
-					continue;
+					TcpStreamData streamData(curTcpFrag->data + newLength, curTcpFrag->dataLength - newLength, 0, tcpReassemblyData->connData);
+					m_OnMessageReadyCallback(sideIndex, streamData, m_UserCookie);
 				}
-
-				//if got to here it means the fragment has higher sequence than current sequence, increment index and continue
-				index++;
+			}
+			else
+			{
+				LOG_DEBUG("Found a fragment in the out-of-order list which doesn't contain any new data, ignoring it. Fragment size is %d on side %d", (int)curTcpFrag->dataLength, sideIndex);
 			}
 
-			// if managed to find new segment, do the search all over again
-		} while (foundSomething);
-
+			// delete fragment from list
+			removeFirstFragment(tcpReassemblyData, sideIndex);
+			continue;
+		}
 
 		// if got here it means we're left only with fragments that have higher sequence than current sequence. This means out-of-order packets or
-		// missing data. If we don't want to clear the frag list yet and the number of out of order fragments isn't above the configured limit,
+		// missing data. If we don't want to clear the frag list yet and the stored out-of-order data is within the configured limits,
 		// assume it's out-of-order and return
-		if (!cleanWholeFragList && (m_MaxOutOfOrderFragments == 0 || tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.size() <= m_MaxOutOfOrderFragments))
+		if (!cleanWholeFragList && isOutOfOrderDataWithinLimits(tcpReassemblyData, sideIndex))
 		{
 			return;
 		}
 
-		LOG_DEBUG("Starting second  iteration of checkOutOfOrderFragments - handle missing data");
-
-		// second fragment list iteration - now we're left only with fragments that have higher sequence than current sequence. This means missing data.
-		// Search for the fragment with the closest sequence to the current one
+		// now the first fragment is the one with the closest sequence to the current one. The data between them is considered missing
 
-		uint32_t closestSequence = 0xffffffff;
-		bool closestSequenceDefined = false;
-		int closestSequenceFragIndex = -1;
-		index = 0;
+		// calculate number of missing bytes
+		uint32_t missingDataLen = curTcpFrag->sequence - sideData.sequence;
 
-		while (index < (int)tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.size())
-		{
-			// extract segment at current index
-			TcpFragment* curTcpFrag = tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.at(index);
+		// update sequence
+		sideData.sequence = curTcpFrag->sequence + curTcpFrag->dataLength;
 
-			// check if its sequence is closer than current closest sequence
-			if (!closestSequenceDefined || SEQ_LT(curTcpFrag->sequence, closestSequence))
-			{
-				closestSequence = curTcpFrag->sequence;
-				closestSequenceFragIndex = index;
-				closestSequenceDefined = true;
-			}
-
-			index++;
-		}
-
-		// this means fragment list is not empty at this stage
-		if (closestSequenceFragIndex > -1)
+		// send new data to callback
+		if (m_OnMessageReadyCallback != NULL)
 		{
-			// get the fragment with the closest sequence
-			TcpFragment* curTcpFrag = tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.at(closestSequenceFragIndex);
+			// prepare missing data text
+			std::string missingDataTextStr = prepareMissingDataMessage(missingDataLen);
 
-			// calculate number of missing bytes
-			uint32_t missingDataLen = curTcpFrag->sequence - tcpReassemblyData->twoSides[sideIndex].sequence;
-
-			// update sequence
-			tcpReassemblyData->twoSides[sideIndex].sequence = curTcpFrag->sequence + curTcpFrag->dataLength;
-			if (curTcpFrag->data != NULL)
-			{
-				// send new data to callback
-				if (m_OnMessageReadyCallback != NULL)
-				{
-					// prepare missing data text
-					std::string missingDataTextStr = prepareMissingDataMessage(missingDataLen);
-
-					// add missing data text to the data that will be sent to the callback. This means that the data will look something like:
-					// "[xx bytes missing]<original_data>"
-					std::vector<uint8_t> dataWithMissingDataText;
-					dataWithMissingDataText.reserve(missingDataTextStr.length() + curTcpFrag->dataLength);
-					dataWithMissingDataText.insert(dataWithMissingDataText.end(), missingDataTextStr.begin(), missingDataTextStr.end());
-					dataWithMissingDataText.insert(dataWithMissingDataText.end(), curTcpFrag->data, curTcpFrag->data + curTcpFrag->dataLength);
-
-					//TcpStreamData streamData(curTcpFrag->data, curTcpFrag->dataLength, tcpReassemblyData->connData);
-					TcpStreamData streamData(&dataWithMissingDataText[0], dataWithMissingDataText.size(), missingDataLen, tcpReassemblyData->connData);
-					m_OnMessageReadyCallback(sideIndex, streamData, m_UserCookie);
-
-					LOG_DEBUG("Found missing data on side %d: %d byte are missing. Sending the closest fragment which is in size %d + missing text message which size is %d",
-						sideIndex, missingDataLen, (int)curTcpFrag->dataLength, (int)missingDataTextStr.length());
-				}
-			}
-
-			// remove fragment from list
-			tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.erase(tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.begin() + closestSequenceFragIndex);
+			// add missing data text to the data that will be sent to the callback. This means that the data will look something like:
+			// "[xx bytes missing]<original_data>"
+			std::vector<uint8_t> dataWithMissingDataText;
+			dataWithMissingDataText.reserve(missingDataTextStr.length() + curTcpFrag->dataLength);
+			dataWithMissingDataText.insert(dataWithMissingDataText.end(), missingDataTextStr.begin(), missingDataTextStr.end());
+			dataWithMissingDataText.insert(dataWithMissingDataText.end(), curTcpFrag->data, curTcpFrag->data + curTcpFrag->dataLength);
 
-			LOG_DEBUG("Calling checkOutOfOrderFragments again from the start");
+			TcpStreamData streamData(&dataWithMissingDataText[0], dataWithMissingDataText.size(), missingDataLen, tcpReassemblyData->connData);
+			m_OnMessageReadyCallback(sideIndex, streamData, m_UserCookie);
 
-			// call the method again from the start to do the whole search again (both iterations). 
-			// the stop condition is when the list is empty (so closestSequenceFragIndex == -1)
-			foundSomething = true;
+			LOG_DEBUG("Found missing data on side %d: %d byte are missing. Sending the closest fragment which is in size %d + missing text message which size is %d",
+				sideIndex, missingDataLen, (int)curTcpFrag->dataLength, (int)missingDataTextStr.length());
 		}
 
-	} while (foundSomething);
+		// remove fragment from list
+		removeFirstFragment(tcpReassemblyData, sideIndex);
+	}
 }
 
 void TcpReassembly::closeConnection(uint32_t flowKey)
@@ -659,14 +687,14 @@ void TcpReassembly::closeConnection(uint32_t flowKey)
 
 void TcpReassembly::closeConnectionInternal(uint32_t flowKey, ConnectionEndReason reason)
 {
-	ConnectionList::iterator iter = m_ConnectionList.find(flowKey);
-	if (iter == m_ConnectionList.end())
+	uint32_t connIndex = findConnection(flowKey);
+	if (connIndex == InvalidConnIndex)
 	{
 		LOG_ERROR("Cannot close flow with key 0x%X: cannot find flow", flowKey);
 		return;
 	}
 
-	TcpReassemblyData& tcpReassemblyData = iter->second;
+	TcpReassemblyData& tcpReassemblyData = *getConnection(connIndex);
 
 	if (tcpReassemblyData.closed) // the connection is already closed
 		return;
@@ -683,7 +711,7 @@ void TcpReassembly::closeConnectionInternal(uint32_t flowKey, ConnectionEndReaso
 		m_OnConnEnd(tcpReassemblyData.connData, reason, m_UserCookie);
 
 	tcpReassemblyData.closed = true; // mark the connection as closed
-	insertIntoCleanupList(flowKey);
+	insertIntoCleanupList(connIndex);
 
 	LOG_DEBUG("Connection with flow key 0x%X is closed", flowKey);
 }
@@ -692,10 +720,12 @@ void TcpReassembly::closeAllConnections()
 {
 	LOG_DEBUG("Closing all flows");
 
-	ConnectionList::iterator iter = m_ConnectionList.begin(), iterEnd = m_ConnectionList.end();
-	for (; iter != iterEnd; ++iter)
+	uint32_t nextConnIndex = m_IdleListHead;
+	while (nextConnIndex != InvalidConnIndex)
 	{
-		TcpReassemblyData& tcpReassemblyData = iter->second;
+		uint32_t connIndex = nextConnIndex;
+		TcpReassemblyData& tcpReassemblyData = *getConnection(connIndex);
+		nextConnIndex = tcpReassemblyData.idleNext;
 
 		if (tcpReassemblyData.closed) // the connection is already closed, skip it
 			continue;
@@ -713,7 +743,7 @@ void TcpReassembly::closeAllConnections()
 			m_OnConnEnd(tcpReassemblyData.connData, TcpReassemblyConnectionClosedManually, m_UserCookie);
 
 		tcpReassemblyData.closed = true; // mark the connection as closed
-		insertIntoCleanupList(flowKey);
+		insertIntoCleanupList(connIndex);
 
 		LOG_DEBUG("Connection with flow key 0x%X is closed", flowKey);
 	}
@@ -721,23 +751,44 @@ void TcpReassembly::closeAllConnections()
 
 int TcpReassembly::isConnectionOpen(const ConnectionData& connection) const
 {
-	ConnectionList::const_iterator iter = m_ConnectionList.find(connection.flowKey);
-	if (iter != m_ConnectionList.end())
-		return iter->second.closed == false;
+	uint32_t connIndex = findConnection(connection.flowKey);
+	if (connIndex != InvalidConnIndex)
+		return getConnection(connIndex)->closed == false;
 
 	return -1;
 }
 
-void TcpReassembly::insertIntoCleanupList(uint32_t flowKey)
+void TcpReassembly::insertIntoCleanupList(uint32_t connIndex)
 {
-	// m_CleanupList is a map with key of type time_t (expiration time). The mapped type is a list that stores the flow keys to be cleared in certain point of time.
-	// m_CleanupList.insert inserts an empty list if the container does not already contain an element with an equivalent key,
-	// otherwise this method returns an iterator to the element that prevents insertion.
-	std::pair<CleanupList::iterator, bool> pair = m_CleanupList.insert(std::make_pair(time(NULL) + m_ClosedConnectionDelay, CleanupList::mapped_type()));
-
-	// getting the reference to list
-	CleanupList::mapped_type& keysList = pair.first->second;
-	keysList.push_front(flowKey);
+	TcpReassemblyData* tcpReassemblyData = getConnection(connIndex);
+	tcpReassemblyData->cleanupTime = time(NULL) + m_ClosedConnectionDelay;
+
+	// m_CleanupWheel has a slot per second and each slot is the head of a doubly linked list of the connections due to be cleaned up in that second
+	uint32_t& slotHead = m_CleanupWheel[tcpReassemblyData->cleanupTime % m_CleanupWheel.size()];
+	tcpReassemblyData->cleanupPrev = InvalidConnIndex;
+	tcpReassemblyData->cleanupNext = slotHead;
+	if (slotHead != InvalidConnIndex)
+		getConnection(slotHead)->cleanupPrev = connIndex;
+	slotHead = connIndex;
+}
+
+void TcpReassembly::removeFromCleanupList(uint32_t connIndex)
+{
+	TcpReassemblyData* tcpReassemblyData = getConnection(connIndex);
+	if (tcpReassemblyData->cleanupTime == 0) // not scheduled for cleanup
+		return;
+
+	if (tcpReassemblyData->cleanupPrev != InvalidConnIndex)
+		getConnection(tcpReassemblyData->cleanupPrev)->cleanupNext = tcpReassemblyData->cleanupNext;
+	else
+		m_CleanupWheel[tcpReassemblyData->cleanupTime % m_CleanupWheel.size()] = tcpReassemblyData->cleanupNext;
+
+	if (tcpReassemblyData->cleanupNext != InvalidConnIndex)
+		getConnection(tcpReassemblyData->cleanupNext)->cleanupPrev = tcpReassemblyData->cleanupPrev;
+
+	tcpReassemblyData->cleanupPrev = InvalidConnIndex;
+	tcpReassemblyData->cleanupNext = InvalidConnIndex;
+	tcpReassemblyData->cleanupTime = 0;
 }
 
 uint32_t TcpReassembly::purgeClosedConnections(uint32_t maxNumToClean)
@@ -747,26 +798,344 @@ uint32_t TcpReassembly::purgeClosedConnections(uint32_t maxNumToClean)
 	if (maxNumToClean == 0)
 		maxNumToClean = m_MaxNumToClean;
 
-	CleanupList::iterator iterTime = m_CleanupList.begin(), iterTimeEnd = m_CleanupList.upper_bound(time(NULL));
-	while (iterTime != iterTimeEnd && count < maxNumToClean)
+	time_t now = time(NULL);
+	time_t wheelSize = (time_t)m_CleanupWheel.size();
+
+	// if the wheel wasn't turned for a whole round there's no need to visit a slot more than once
+	if (now - m_CleanupWheelTime >= wheelSize)
+		m_CleanupWheelTime = now - wheelSize + 1;
+
+	while (m_CleanupWheelTime <= now && count < maxNumToClean)
+	{
+		uint32_t connIndex = m_CleanupWheel[m_CleanupWheelTime % wheelSize];
+		while (connIndex != InvalidConnIndex && count < maxNumToClean)
+		{
+			TcpReassemblyData* tcpReassemblyData = getConnection(connIndex);
+			uint32_t nextConnIndex = tcpReassemblyData->cleanupNext;
+
+			// a slot may also hold connections due a whole round later if the wheel wasn't turned for a while
+			if (tcpReassemblyData->cleanupTime <= now)
+			{
+				removeConnection(connIndex);
+				count++;
+			}
+
+			connIndex = nextConnIndex;
+		}
+
+		// stopped in the middle of the slot, continue from it next time
+		if (connIndex != InvalidConnIndex)
+			break;
+
+		m_CleanupWheelTime++;
+	}
+
+	return count;
+}
+
+uint32_t TcpReassembly::findConnection(uint32_t flowKey) const
+{
+	size_t mask = m_ConnectionTable.size() - 1;
+	for (size_t slot = getTableSlot(flowKey); m_ConnectionTable[slot].connIndex != InvalidConnIndex; slot = (slot + 1) & mask)
+	{
+		if (m_ConnectionTable[slot].flowKey == flowKey)
+			return m_ConnectionTable[slot].connIndex;
+	}
+
+	return InvalidConnIndex;
+}
+
+uint32_t TcpReassembly::createConnection(uint32_t flowKey)
+{
+	if ((m_NumOfConnections + 1) * 2 > m_ConnectionTable.size())
+		growConnectionTable();
+
+	// take a free connection or allocate a new block of them
+	uint32_t connIndex;
+	if (!m_FreeConnections.empty())
+	{
+		connIndex = m_FreeConnections.back();
+		m_FreeConnections.pop_back();
+	}
+	else
 	{
-		CleanupList::mapped_type& keysList = iterTime->second;
+		connIndex = (uint32_t)m_ConnectionBlocks.size() * ConnectionBlockSize;
+		m_ConnectionBlocks.push_back(new TcpReassemblyData[ConnectionBlockSize]);
+		for (uint32_t i = ConnectionBlockSize - 1; i > 0; i--)
+			m_FreeConnections.push_back(connIndex + i);
+	}
+
+	size_t mask = m_ConnectionTable.size() - 1;
+	size_t slot = getTableSlot(flowKey);
+	while (m_ConnectionTable[slot].connIndex != InvalidConnIndex)
+		slot = (slot + 1) & mask;
+	m_ConnectionTable[slot].flowKey = flowKey;
+	m_ConnectionTable[slot].connIndex = connIndex;
+	m_NumOfConnections++;
+	m_MemoryUsage += CONNECTION_MEMORY_USAGE;
+
+	TcpReassemblyData* tcpReassemblyData = getConnection(connIndex);
+	tcpReassemblyData->connData.flowKey = flowKey;
+
+	// a new connection is the most recently seen one
+	tcpReassemblyData->idlePrev = m_IdleListTail;
+	tcpReassemblyData->idleNext = InvalidConnIndex;
+	if (m_IdleListTail != InvalidConnIndex)
+		getConnection(m_IdleListTail)->idleNext = connIndex;
+	else
+		m_IdleListHead = connIndex;
+	m_IdleListTail = connIndex;
 
-		for (; !keysList.empty() && count < maxNumToClean; ++count)
+	return connIndex;
+}
+
+void TcpReassembly::removeConnection(uint32_t connIndex)
+{
+	TcpReassemblyData* tcpReassemblyData = getConnection(connIndex);
+	uint32_t flowKey = tcpReassemblyData->connData.flowKey;
+
+	removeFromCleanupList(connIndex);
+	unlinkFromIdleList(connIndex);
+
+	// find the connection's slot and remove it by shifting back the following entries of its probe sequence (so no tombstones are needed)
+	size_t mask = m_ConnectionTable.size() - 1;
+	size_t slot = getTableSlot(flowKey);
+	while (m_ConnectionTable[slot].connIndex != connIndex)
+		slot = (slot + 1) & mask;
+
+	m_ConnectionTable[slot].connIndex = InvalidConnIndex;
+	size_t nextSlot = slot;
+	while (true)
+	{
+		nextSlot = (nextSlot + 1) & mask;
+		if (m_ConnectionTable[nextSlot].connIndex == InvalidConnIndex)
+			break;
+
+		// an entry can move back to the empty slot only if its home slot isn't cyclically between the empty slot and its current slot
+		size_t homeSlot = getTableSlot(m_ConnectionTable[nextSlot].flowKey);
+		bool canMove = (slot <= nextSlot) ? (homeSlot <= slot || homeSlot > nextSlot) : (homeSlot <= slot && homeSlot > nextSlot);
+		if (canMove)
 		{
-			CleanupList::mapped_type::const_reference key = keysList.front();
-			m_ConnectionInfo.erase(key);
-			m_ConnectionList.erase(key);
-			keysList.pop_front();
+			m_ConnectionTable[slot] = m_ConnectionTable[nextSlot];
+			m_ConnectionTable[nextSlot].connIndex = InvalidConnIndex;
+			slot = nextSlot;
 		}
+	}
+
+	m_ConnectionInfo.erase(flowKey);
+
+	for (int8_t side = 0; side < 2; side++)
+	{
+		while (!tcpReassemblyData->twoSides[side].tcpFragmentList.empty())
+			removeFirstFragment(tcpReassemblyData, side);
+	}
+
+	tcpReassemblyData->clear();
+	m_FreeConnections.push_back(connIndex);
+	m_NumOfConnections--;
+	m_MemoryUsage -= CONNECTION_MEMORY_USAGE;
+}
+
+void TcpReassembly::growConnectionTable()
+{
+	std::vector<ConnectionTableSlot> oldTable;
+	oldTable.swap(m_ConnectionTable);
+
+	ConnectionTableSlot emptySlot = { 0, InvalidConnIndex };
+	m_ConnectionTable.resize(oldTable.size() * 2, emptySlot);
+	size_t mask = m_ConnectionTable.size() - 1;
+
+	for (std::vector<ConnectionTableSlot>::const_iterator iter = oldTable.begin(); iter != oldTable.end(); ++iter)
+	{
+		if (iter->connIndex == InvalidConnIndex)
+			continue;
+
+		size_t slot = getTableSlot(iter->flowKey);
+		while (m_ConnectionTable[slot].connIndex != InvalidConnIndex)
+			slot = (slot + 1) & mask;
+		m_ConnectionTable[slot] = *iter;
+	}
+
+	LOG_DEBUG("Grew connection table to %d slots", (int)m_ConnectionTable.size());
+}
+
+void TcpReassembly::touchConnection(uint32_t connIndex)
+{
+	if (connIndex == m_IdleListTail)
+		return;
+
+	unlinkFromIdleList(connIndex);
+
+	TcpReassemblyData* tcpReassemblyData = getConnection(connIndex);
+	tcpReassemblyData->idlePrev = m_IdleListTail;
+	tcpReassemblyData->idleNext = InvalidConnIndex;
+	if (m_IdleListTail != InvalidConnIndex)
+		getConnection(m_IdleListTail)->idleNext = connIndex;
+	else
+		m_IdleListHead = connIndex;
+	m_IdleListTail = connIndex;
+}
+
+void TcpReassembly::unlinkFromIdleList(uint32_t connIndex)
+{
+	TcpReassemblyData* tcpReassemblyData = getConnection(connIndex);
+
+	if (tcpReassemblyData->idlePrev != InvalidConnIndex)
+		getConnection(tcpReassemblyData->idlePrev)->idleNext = tcpReassemblyData->idleNext;
+	else
+		m_IdleListHead = tcpReassemblyData->idleNext;
+
+	if (tcpReassemblyData->idleNext != InvalidConnIndex)
+		getConnection(tcpReassemblyData->idleNext)->idlePrev = tcpReassemblyData->idlePrev;
+	else
+		m_IdleListTail = tcpReassemblyData->idlePrev;
+
+	tcpReassemblyData->idlePrev = InvalidConnIndex;
+	tcpReassemblyData->idleNext = InvalidConnIndex;
+}
 
-		if (keysList.empty())
-			m_CleanupList.erase(iterTime++);
+bool TcpReassembly::evictIdleConnection(uint32_t connIndexToKeep)
+{
+	uint32_t connIndex = m_IdleListHead;
+	if (connIndex == InvalidConnIndex || connIndex == connIndexToKeep)
+		return false;
+
+	TcpReassemblyData* tcpReassemblyData = getConnection(connIndex);
+
+	LOG_DEBUG("Evicting connection with flow key 0x%X", tcpReassemblyData->connData.flowKey);
+
+	// closed connections already got their end callback and are only waiting to be cleaned up
+	if (!tcpReassemblyData->closed)
+		closeConnectionInternal(tcpReassemblyData->connData.flowKey, TcpReassemblyConnectionEvicted);
+
+	removeConnection(connIndex);
+	return true;
+}
+
+TcpReassembly::TcpFragment* TcpReassembly::allocateFragment(size_t dataLength)
+{
+	// find the smallest size class the data fits in
+	int sizeClass = 0;
+	while (sizeClass < NumOfFragmentSizeClasses && (MinFragmentCapacity << sizeClass) < dataLength)
+		sizeClass++;
+
+	TcpFragment* fragment = NULL;
+	if (sizeClass < NumOfFragmentSizeClasses && !m_FragmentPool[sizeClass].empty())
+	{
+		fragment = m_FragmentPool[sizeClass].back();
+		m_FragmentPool[sizeClass].pop_back();
+		m_FragmentPoolBytes -= fragment->capacity;
+	}
+	else
+	{
+		// fragments larger than the largest size class are allocated for their exact size and aren't pooled
+		size_t capacity = (sizeClass < NumOfFragmentSizeClasses ? (MinFragmentCapacity << sizeClass) : dataLength);
+		uint8_t* buffer = new uint8_t[sizeof(TcpFragment) + capacity];
+		fragment = (TcpFragment*)buffer;
+		fragment->capacity = capacity;
+		fragment->data = buffer + sizeof(TcpFragment);
+	}
+
+	fragment->dataLength = dataLength;
+	return fragment;
+}
+
+void TcpReassembly::releaseFragment(TcpFragment* fragment)
+{
+	int sizeClass = 0;
+	while (sizeClass < NumOfFragmentSizeClasses && (MinFragmentCapacity << sizeClass) != fragment->capacity)
+		sizeClass++;
+
+	if (sizeClass == NumOfFragmentSizeClasses || m_FragmentPoolBytes + fragment->capacity > MAX_FRAGMENT_POOL_BYTES)
+	{
+		delete [] (uint8_t*)fragment;
+		return;
+	}
+
+	m_FragmentPool[sizeClass].push_back(fragment);
+	m_FragmentPoolBytes += fragment->capacity;
+}
+
+void TcpReassembly::addFragment(TcpReassemblyData* tcpReassemblyData, int8_t sideIndex, uint32_t sequence, const uint8_t* data, size_t dataLength)
+{
+	TcpFragmentList& fragList = tcpReassemblyData->twoSides[sideIndex].tcpFragmentList;
+
+	// binary search for the first fragment with a higher sequence, so fragments with the same sequence keep their arrival order.
+	// Out-of-order fragments usually arrive in order among themselves, so check for appending at the end first
+	size_t low = 0, high = fragList.size();
+	if (high > 0 && !SEQ_LT(sequence, fragList.back()->sequence))
+		low = high;
+	while (low < high)
+	{
+		size_t mid = (low + high) / 2;
+		if (SEQ_LT(sequence, fragList[mid]->sequence))
+			high = mid;
 		else
-			++iterTime;
+			low = mid + 1;
 	}
+	TcpFragmentList::iterator insertPos = fragList.begin() + low;
 
-	return count;
+	// a retransmission of a stored fragment doesn't add any data
+	if (insertPos != fragList.begin() && (*(insertPos - 1))->sequence == sequence && (*(insertPos - 1))->dataLength >= dataLength)
+	{
+		LOG_DEBUG("Out-of-order fragment with sequence %u is already stored, ignoring it", sequence);
+		return;
+	}
+
+	TcpFragment* fragment = allocateFragment(dataLength);
+	fragment->sequence = sequence;
+	memcpy(fragment->data, data, dataLength);
+	fragList.insert(insertPos, fragment);
+
+	tcpReassemblyData->outOfOrderBytes += dataLength;
+	m_OutOfOrderBytes += dataLength;
+	m_MemoryUsage += sizeof(TcpFragment) + fragment->capacity;
+}
+
+void TcpReassembly::removeFirstFragment(TcpReassemblyData* tcpReassemblyData, int8_t sideIndex)
+{
+	TcpFragmentList& fragList = tcpReassemblyData->twoSides[sideIndex].tcpFragmentList;
+	TcpFragment* fragment = fragList.front();
+	fragList.pop_front();
+
+	tcpReassemblyData->outOfOrderBytes -= fragment->dataLength;
+	m_OutOfOrderBytes -= fragment->dataLength;
+	m_MemoryUsage -= sizeof(TcpFragment) + fragment->capacity;
+
+	releaseFragment(fragment);
+}
+
+bool TcpReassembly::isOutOfOrderDataWithinLimits(const TcpReassemblyData* tcpReassemblyData, int8_t sideIndex) const
+{
+	return (m_MaxOutOfOrderFragments == 0 || tcpReassemblyData->twoSides[sideIndex].tcpFragmentList.size() <= m_MaxOutOfOrderFragments) &&
+			(m_MaxOutOfOrderBytesPerConnection == 0 || tcpReassemblyData->outOfOrderBytes <= m_MaxOutOfOrderBytesPerConnection);
+}
+
+void TcpReassembly::releaseOutOfOrderData(uint32_t connIndexToReleaseLast)
+{
+	// consider the out-of-order data of the connections that were idle the longest as missing
+	uint32_t connIndex = m_IdleListHead;
+	while (connIndex != InvalidConnIndex && m_OutOfOrderBytes > m_MaxOutOfOrderBytes)
+	{
+		TcpReassemblyData* tcpReassemblyData = getConnection(connIndex);
+		uint32_t nextConnIndex = tcpReassemblyData->idleNext;
+
+		if (connIndex != connIndexToReleaseLast && tcpReassemblyData->outOfOrderBytes > 0)
+		{
+			LOG_DEBUG("Out-of-order data limit exceeded, releasing out-of-order data of connection with flow key 0x%X", tcpReassemblyData->connData.flowKey);
+			checkOutOfOrderFragments(tcpReassemblyData, 0, true);
+			checkOutOfOrderFragments(tcpReassemblyData, 1, true);
+		}
+
+		connIndex = nextConnIndex;
+	}
+
+	if (m_OutOfOrderBytes > m_MaxOutOfOrderBytes)
+	{
+		TcpReassemblyData* tcpReassemblyData = getConnection(connIndexToReleaseLast);
+		checkOutOfOrderFragments(tcpReassemblyData, 0, true);
+		checkOutOfOrderFragments(tcpReassemblyData, 1, true);
+	}
 }
 
 }
@@ -1,9 +1,19 @@
 #include "TextBasedProtocol.h"
 #include "Logger.h"
 #include "PayloadLayer.h"
+#include "SystemUtils.h"
 #include <string.h>
-#include <algorithm>
+#include <ctype.h>
 #include <stdlib.h>
+#include <new>
+
+#ifdef PCPP_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
 
 namespace pcpp
 {
@@ -20,13 +30,143 @@ size_t tbp_my_own_strnlen(const char* s, size_t maxlen)
 }
 
 
+typedef const char* (*TbpFindNewLineFunc)(const char* data, size_t dataLen);
+
+// find the first LF in a buffer
+static const char* tbpFindNewLineScalar(const char* data, size_t dataLen)
+{
+	return (const char*)memchr(data, '\n', dataLen);
+}
+
+#ifdef PCPP_X86
+
+static inline int tbpCountTrailingZeros(uint32_t mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (int)index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+// header lines are scanned 16 bytes at a time
+PCPP_TARGET("sse2")
+static const char* tbpFindNewLineSse2(const char* data, size_t dataLen)
+{
+	const char* end = data + dataLen;
+	const __m128i newLine = _mm_set1_epi8('\n');
+	while (end - data >= 16)
+	{
+		__m128i chunk = _mm_loadu_si128((const __m128i*)data);
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newLine));
+		if (mask != 0)
+			return data + tbpCountTrailingZeros(mask);
+		data += 16;
+	}
+
+	return tbpFindNewLineScalar(data, end - data);
+}
+
+// header lines are scanned 32 bytes at a time
+PCPP_TARGET("avx2")
+static const char* tbpFindNewLineAvx2(const char* data, size_t dataLen)
+{
+	const char* end = data + dataLen;
+	const __m256i newLine = _mm256_set1_epi8('\n');
+	while (end - data >= 32)
+	{
+		__m256i chunk = _mm256_loadu_si256((const __m256i*)data);
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newLine));
+		if (mask != 0)
+			return data + tbpCountTrailingZeros(mask);
+		data += 32;
+	}
+
+	return tbpFindNewLineSse2(data, end - data);
+}
+
+#endif // PCPP_X86
+
+static TbpFindNewLineFunc tbpSelectFindNewLine()
+{
+#ifdef PCPP_X86
+	if (cpuSupports(CpuAvx2))
+		return tbpFindNewLineAvx2;
+	if (cpuSupports(CpuSse2))
+		return tbpFindNewLineSse2;
+#endif
+	return tbpFindNewLineScalar;
+}
+
+static const char* tbpFindNewLine(const char* data, size_t dataLen)
+{
+	static const TbpFindNewLineFunc findNewLine = tbpSelectFindNewLine();
+	return findNewLine(data, dataLen);
+}
+
+
+// Well-known field names of HTTP and SIP are resolved to an ID with a perfect hash: each of them hashes to a slot of its own in
+// this table (the ID is the slot index), so a field name is identified by hashing it and comparing it with a single table entry.
+// The hash is (length * 38 + first * 26 + middle * 23 + last) % 64 over the lower-case name, the constants were chosen so that
+// the names don't collide. Adding a name requires checking that it still doesn't collide
+#define TBP_KNOWN_NAME_TABLE_SIZE 64
+
+static const char* const KnownFieldNames[TBP_KNOWN_NAME_TABLE_SIZE] = {
+	"transfer-encoding",   NULL,                  "location",            "allow",
+	NULL,                  "accept",              NULL,                  "content-language",
+	"set-cookie",          "user-agent",          NULL,                  "max-forwards",
+	"record-route",        "cache-control",       "accept-encoding",     NULL,
+	NULL,                  "date",                NULL,                  NULL,
+	NULL,                  "content-length",      NULL,                  NULL,
+	NULL,                  NULL,                  "from",                "mime-version",
+	NULL,                  "connection",          "server",              NULL,
+	NULL,                  "supported",           NULL,                  "referer",
+	NULL,                  "authorization",       NULL,                  "content-type",
+	"content-encoding",    NULL,                  "cseq",                NULL,
+	NULL,                  "accept-language",     "www-authenticate",    NULL,
+	"call-id",             "host",                NULL,                  "retry-after",
+	"cookie",              NULL,                  NULL,                  NULL,
+	"contact",             NULL,                  NULL,                  "reason",
+	"to",                  "content-disposition", "via",                 NULL
+};
+
+static bool tbpCaseInsensitiveEqual(const char* str1, const char* str2, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+	{
+		if (tolower((unsigned char)str1[i]) != tolower((unsigned char)str2[i]))
+			return false;
+	}
+
+	return true;
+}
+
+// returns the ID of a well-known field name, or -1 if the name isn't one of them
+static int tbpGetKnownFieldNameId(const char* name, size_t nameLen)
+{
+	if (nameLen == 0 || nameLen > 32)
+		return -1;
+
+	size_t slot = (nameLen * 38 + tolower((unsigned char)name[0]) * 26 + tolower((unsigned char)name[nameLen / 2]) * 23 +
+			tolower((unsigned char)name[nameLen - 1])) % TBP_KNOWN_NAME_TABLE_SIZE;
+
+	const char* knownName = KnownFieldNames[slot];
+	if (knownName == NULL || strlen(knownName) != nameLen || !tbpCaseInsensitiveEqual(name, knownName, nameLen))
+		return -1;
+
+	return (int)slot;
+}
+
+
 // -------- Class TextBasedProtocolMessage -----------------
 
 
 TextBasedProtocolMessage::TextBasedProtocolMessage(uint8_t* data, size_t dataLen, Layer* prevLayer, Packet* packet) : Layer(data, dataLen, prevLayer, packet),
-						m_FieldList(NULL), m_LastField(NULL), m_FieldsOffset(0) {}
+						m_FieldList(NULL), m_LastField(NULL), m_FieldsOffset(0), m_InlineFieldsInUse(0), m_NextInsertionOrder(0) {}
 
-TextBasedProtocolMessage::TextBasedProtocolMessage(const TextBasedProtocolMessage& other) : Layer(other)
+TextBasedProtocolMessage::TextBasedProtocolMessage(const TextBasedProtocolMessage& other) : Layer(other), m_InlineFieldsInUse(0), m_NextInsertionOrder(0)
 {
 	copyDataFrom(other);
 }
@@ -39,7 +179,7 @@ TextBasedProtocolMessage& TextBasedProtocolMessage::operator=(const TextBasedPro
 	{
 		HeaderField* temp = curField;
 		curField = curField->getNextField();
-		delete temp;
+		freeField(temp);
 	}
 
 	copyDataFrom(other);
@@ -52,13 +192,13 @@ void TextBasedProtocolMessage::copyDataFrom(const TextBasedProtocolMessage& othe
 	// copy field list
 	if (other.m_FieldList != NULL)
 	{
-		m_FieldList = new HeaderField(*(other.m_FieldList));
+		m_FieldList = new (allocateFieldStorage()) HeaderField(*(other.m_FieldList));
 		HeaderField* curField = m_FieldList;
 		curField->attachToTextBasedProtocolMessage(this, other.m_FieldList->m_NameOffsetInMessage);
 		HeaderField* curOtherField = other.m_FieldList;
 		while (curOtherField->getNextField() != NULL)
 		{
-			HeaderField* newField = new HeaderField(*(curOtherField->getNextField()));
+			HeaderField* newField = new (allocateFieldStorage()) HeaderField(*(curOtherField->getNextField()));
 			newField->attachToTextBasedProtocolMessage(this, curOtherField->getNextField()->m_NameOffsetInMessage);
 			curField->setNextField(newField);
 			curField = curField->getNextField();
@@ -75,11 +215,35 @@ void TextBasedProtocolMessage::copyDataFrom(const TextBasedProtocolMessage& othe
 
 	m_FieldsOffset = other.m_FieldsOffset;
 
-	// copy map
-	for(HeaderField* field = m_FieldList; field != NULL; field = field->getNextField())
+	// fields of the copy are indexed in their order in the message
+	m_NextInsertionOrder = 0;
+	for (HeaderField* field = m_FieldList; field != NULL; field = field->getNextField())
+		field->m_InsertionOrder = m_NextInsertionOrder++;
+}
+
+void* TextBasedProtocolMessage::allocateFieldStorage()
+{
+	for (int i = 0; i < NumOfInlineFields; i++)
 	{
-		m_FieldNameToFieldMap.insert(std::pair<std::string, HeaderField*>(field->getFieldName(), field));
+		if ((m_InlineFieldsInUse & (1U << i)) == 0)
+		{
+			m_InlineFieldsInUse |= (1U << i);
+			return m_InlineFieldStorage + i * sizeof(HeaderField);
+		}
 	}
+
+	return ::operator new(sizeof(HeaderField));
+}
+
+void TextBasedProtocolMessage::freeField(HeaderField* field)
+{
+	field->~HeaderField();
+
+	uint8_t* storage = (uint8_t*)field;
+	if (storage >= m_InlineFieldStorage && storage < m_InlineFieldStorage + sizeof(m_InlineFieldStorage))
+		m_InlineFieldsInUse &= ~(1U << ((storage - m_InlineFieldStorage) / sizeof(HeaderField)));
+	else
+		::operator delete(storage);
 }
 
 
@@ -88,7 +252,7 @@ void TextBasedProtocolMessage::parseFields()
 	char nameValueSeperator = getHeaderFieldNameValueSeparator();
 	bool spacesAllowedBetweenNameAndValue = spacesAllowedBetweenHeaderFieldNameAndValue();
 
-	HeaderField* firstField = new HeaderField(this, m_FieldsOffset, nameValueSeperator, spacesAllowedBetweenNameAndValue);
+	HeaderField* firstField = new (allocateFieldStorage()) HeaderField(this, m_FieldsOffset, nameValueSeperator, spacesAllowedBetweenNameAndValue);
 	LOG_DEBUG("Added new field: name='%s'; offset in packet=%d; length=%d", firstField->getFieldName().c_str(), firstField->m_NameOffsetInMessage, (int)firstField->getFieldSize());
 	LOG_DEBUG("     Field value = %s", firstField->getFieldValue().c_str());
 
@@ -96,10 +260,7 @@ void TextBasedProtocolMessage::parseFields()
 		m_FieldList = firstField;
 	else
 		m_FieldList->setNextField(firstField);
-
-	std::string fieldName = firstField->getFieldName();
-	std::transform(fieldName.begin(), fieldName.end(), fieldName.begin(), ::tolower);
-	m_FieldNameToFieldMap.insert(std::pair<std::string, HeaderField*>(fieldName, firstField));
+	firstField->m_InsertionOrder = m_NextInsertionOrder++;
 
 	// Last field will be empty and contain just "\n" or "\r\n". This field will mark the end of the header
 	HeaderField* curField = m_FieldList;
@@ -110,20 +271,18 @@ void TextBasedProtocolMessage::parseFields()
 	while (!curField->isEndOfHeader() && curOffset + curField->getFieldSize() < m_DataLen)
 	{
 		curOffset += curField->getFieldSize();
-		HeaderField* newField = new HeaderField(this, curOffset, nameValueSeperator, spacesAllowedBetweenNameAndValue);
+		HeaderField* newField = new (allocateFieldStorage()) HeaderField(this, curOffset, nameValueSeperator, spacesAllowedBetweenNameAndValue);
 		if(newField->getFieldSize() > 0)
 		{
 			LOG_DEBUG("Added new field: name='%s'; offset in packet=%d; length=%d", newField->getFieldName().c_str(), newField->m_NameOffsetInMessage, (int)newField->getFieldSize());
 			LOG_DEBUG("     Field value = %s", newField->getFieldValue().c_str());
 			curField->setNextField(newField);
 			curField = newField;
-			fieldName = newField->getFieldName();
-			std::transform(fieldName.begin(), fieldName.end(), fieldName.begin(), ::tolower);
-			m_FieldNameToFieldMap.insert(std::pair<std::string, HeaderField*>(fieldName, newField));
+			newField->m_InsertionOrder = m_NextInsertionOrder++;
 		}
 		else
 		{
-			delete newField;
+			freeField(newField);
 			break;
 		}
 	}
@@ -138,7 +297,7 @@ TextBasedProtocolMessage::~TextBasedProtocolMessage()
 	{
 		HeaderField* temp = m_FieldList;
 		m_FieldList = m_FieldList->getNextField();
-		delete temp;
+		freeField(temp);
 	}
 }
 
@@ -198,7 +357,7 @@ HeaderField* TextBasedProtocolMessage::insertField(HeaderField* prevField, const
 		return NULL;
 	}
 
-	HeaderField* newFieldToAdd = new HeaderField(newField);
+	HeaderField* newFieldToAdd = new (allocateFieldStorage()) HeaderField(newField);
 
 	int newFieldOffset = m_FieldsOffset;
 	if (prevField != NULL)
@@ -208,7 +367,7 @@ HeaderField* TextBasedProtocolMessage::insertField(HeaderField* prevField, const
 	if (!extendLayer(newFieldOffset, newFieldToAdd->getFieldSize()))
 	{
 		LOG_ERROR("Cannot extend layer to insert the header");
-		delete newFieldToAdd;
+		freeField(newFieldToAdd);
 		return NULL;
 	}
 
@@ -241,33 +400,14 @@ HeaderField* TextBasedProtocolMessage::insertField(HeaderField* prevField, const
 	if (newFieldToAdd->getNextField() == NULL)
 		m_LastField = newFieldToAdd;
 
-	// insert the new field into name to field map
-	std::string fieldName = newFieldToAdd->getFieldName();
-	std::transform(fieldName.begin(), fieldName.end(), fieldName.begin(), ::tolower);
-	m_FieldNameToFieldMap.insert(std::pair<std::string, HeaderField*>(fieldName, newFieldToAdd));
+	newFieldToAdd->m_InsertionOrder = m_NextInsertionOrder++;
 
 	return newFieldToAdd;
 }
 
 bool TextBasedProtocolMessage::removeField(std::string fieldName, int index)
 {
-	std::transform(fieldName.begin(), fieldName.end(), fieldName.begin(), ::tolower);
-
-	HeaderField* fieldToRemove = NULL;
-
-	std::pair <std::multimap<std::string,HeaderField*>::iterator, std::multimap<std::string,HeaderField*>::iterator> range;
-	range = m_FieldNameToFieldMap.equal_range(fieldName);
-	int i = 0;
-	for (std::multimap<std::string,HeaderField*>::iterator iter = range.first; iter != range.second; ++iter)
-	{
-		if (i == index)
-		{
-			fieldToRemove = iter->second;
-			break;
-		}
-
-		i++;
-	}
+	HeaderField* fieldToRemove = getFieldByName(fieldName, index);
 
 	if (fieldToRemove != NULL)
 		return removeField(fieldToRemove);
@@ -289,8 +429,6 @@ bool TextBasedProtocolMessage::removeField(HeaderField* fieldToRemove)
 		return false;
 	}
 
-	std::string fieldName = fieldToRemove->getFieldName();
-
 	// shorten layer and delete this field
 	if (!shortenLayer(fieldToRemove->m_NameOffsetInMessage, fieldToRemove->getFieldSize()))
 	{
@@ -336,21 +474,8 @@ bool TextBasedProtocolMessage::removeField(HeaderField* fieldToRemove)
 		}
 	}
 
-	// remove the hash entry for this field
-	std::transform(fieldName.begin(), fieldName.end(), fieldName.begin(), ::tolower);
-	std::pair <std::multimap<std::string,HeaderField*>::iterator, std::multimap<std::string,HeaderField*>::iterator> range;
-	range = m_FieldNameToFieldMap.equal_range(fieldName);
-	for (std::multimap<std::string,HeaderField*>::iterator iter = range.first; iter != range.second; ++iter)
-	{
-		if (iter->second == fieldToRemove)
-		{
-			m_FieldNameToFieldMap.erase(iter);
-			break;
-		}
-	}
-
 	// finally - delete this field
-	delete fieldToRemove;
+	freeField(fieldToRemove);
 
 	return true;
 }
@@ -376,20 +501,32 @@ void TextBasedProtocolMessage::shiftFieldsOffset(HeaderField* fromField, int num
 
 HeaderField* TextBasedProtocolMessage::getFieldByName(std::string fieldName, int index) const
 {
-	std::transform(fieldName.begin(), fieldName.end(), fieldName.begin(), ::tolower);
+	// messages have a few dozen fields at most so going over the list is cheap, and well-known names are compared by their ID.
+	// Fields with the same name are indexed in the order they were added to the message, which isn't necessarily their order in
+	// the message (fields can be inserted anywhere). Each pass finds the next one in this order
+	int knownNameId = tbpGetKnownFieldNameId(fieldName.c_str(), fieldName.length());
 
-	std::pair <std::multimap<std::string,HeaderField*>::const_iterator, std::multimap<std::string,HeaderField*>::const_iterator> range;
-	range = m_FieldNameToFieldMap.equal_range(fieldName);
-	int i = 0;
-	for (std::multimap<std::string,HeaderField*>::const_iterator iter = range.first; iter != range.second; ++iter)
+	HeaderField* result = NULL;
+	for (int i = 0; i <= index; i++)
 	{
-		if (i == index)
-			return iter->second;
+		HeaderField* nextResult = NULL;
+		for (HeaderField* curField = m_FieldList; curField != NULL; curField = curField->getNextField())
+		{
+			if ((result != NULL && curField->m_InsertionOrder <= result->m_InsertionOrder) ||
+					(nextResult != NULL && curField->m_InsertionOrder >= nextResult->m_InsertionOrder))
+				continue;
+
+			if (curField->isNameEqual(fieldName.c_str(), fieldName.length(), knownNameId))
+				nextResult = curField;
+		}
 
-		i++;
+		if (nextResult == NULL)
+			return NULL;
+
+		result = nextResult;
 	}
 
-	return NULL;
+	return result;
 }
 
 int TextBasedProtocolMessage::getFieldCount() const
@@ -435,10 +572,10 @@ void TextBasedProtocolMessage::computeCalculateFields()
 
 HeaderField::HeaderField(TextBasedProtocolMessage* TextBasedProtocolMessage, int offsetInMessage, char nameValueSeperator, bool spacesAllowedBetweenNameAndValue) :
 		m_NewFieldData(NULL), m_TextBasedProtocolMessage(TextBasedProtocolMessage), m_NameOffsetInMessage(offsetInMessage), m_NextField(NULL),
-		m_NameValueSeperator(nameValueSeperator), m_SpacesAllowedBetweenNameAndValue(spacesAllowedBetweenNameAndValue)
+		m_NameValueSeperator(nameValueSeperator), m_SpacesAllowedBetweenNameAndValue(spacesAllowedBetweenNameAndValue), m_KnownNameId(-1), m_InsertionOrder(0)
 {
 	char* fieldData = (char*)(m_TextBasedProtocolMessage->m_Data + m_NameOffsetInMessage);
-	char* fieldEndPtr = (char*)memchr(fieldData, '\n', m_TextBasedProtocolMessage->m_DataLen - (size_t)m_NameOffsetInMessage);
+	char* fieldEndPtr = (char*)tbpFindNewLine(fieldData, m_TextBasedProtocolMessage->m_DataLen - (size_t)m_NameOffsetInMessage);
 	if (fieldEndPtr == NULL)
 		m_FieldSize = tbp_my_own_strnlen(fieldData, m_TextBasedProtocolMessage->m_DataLen - (size_t)m_NameOffsetInMessage);
 	else
@@ -456,17 +593,23 @@ HeaderField::HeaderField(TextBasedProtocolMessage* TextBasedProtocolMessage, int
 	else
 		m_IsEndOfHeaderField = false;
 
-	char* fieldValuePtr = (char*)memchr(fieldData, nameValueSeperator, m_TextBasedProtocolMessage->m_DataLen - (size_t)m_NameOffsetInMessage);
+	// the separator is almost always in the current line which was just scanned, so look for it there first
+	char* fieldValuePtr = (char*)memchr(fieldData, nameValueSeperator, m_FieldSize);
+	if (fieldValuePtr == NULL && m_FieldSize < m_TextBasedProtocolMessage->m_DataLen - (size_t)m_NameOffsetInMessage)
+		fieldValuePtr = (char*)memchr(fieldData + m_FieldSize, nameValueSeperator, m_TextBasedProtocolMessage->m_DataLen - (size_t)m_NameOffsetInMessage - m_FieldSize);
+
 	// could not find the position of the separator, meaning field value position is unknown
 	if (fieldValuePtr == NULL)
 	{
 		m_ValueOffsetInMessage = -1;
 		m_FieldValueSize = -1;
 		m_FieldNameSize = m_FieldSize;
+		m_KnownNameId = tbpGetKnownFieldNameId(fieldData, m_FieldNameSize);
 	}
 	else
 	{
 		m_FieldNameSize = fieldValuePtr - fieldData;
+		m_KnownNameId = tbpGetKnownFieldNameId(fieldData, m_FieldNameSize);
 		// Header field looks like this: <field_name>[separator]<zero or more spaces><field_Value>
 		// So fieldValuePtr give us the position of the separator. Value offset is the first non-space byte forward
 		fieldValuePtr++;
@@ -523,6 +666,7 @@ void HeaderField::initNewField(std::string name, std::string value)
 	m_TextBasedProtocolMessage = NULL;
 	m_NameOffsetInMessage = 0;
 	m_NextField = NULL;
+	m_InsertionOrder = 0;
 
 	// first building the name-value separator
 	std::string nameValueSeparation(1, m_NameValueSeperator);
@@ -554,6 +698,7 @@ void HeaderField::initNewField(std::string name, std::string value)
 		m_ValueOffsetInMessage = 0;
 	m_FieldNameSize = name.length();
 	m_FieldValueSize = value.length();
+	m_KnownNameId = tbpGetKnownFieldNameId(name.c_str(), name.length());
 
 	if (name != PCPP_END_OF_TEXT_BASED_PROTOCOL_HEADER)
 		m_IsEndOfHeaderField = false;
@@ -585,6 +730,19 @@ HeaderField& HeaderField::operator=(const HeaderField& other)
 	return (*this);
 }
 
+bool HeaderField::isNameEqual(const char* name, size_t nameLen, int knownNameId) const
+{
+	if (knownNameId >= 0 || m_KnownNameId >= 0)
+		return knownNameId == m_KnownNameId;
+
+	// fields without a name (such as the end-of-header field) have an empty name
+	size_t fieldNameSize = (m_FieldNameSize == (size_t)-1 ? 0 : m_FieldNameSize);
+	if (fieldNameSize != nameLen)
+		return false;
+
+	return tbpCaseInsensitiveEqual(getData() + m_NameOffsetInMessage, name, nameLen);
+}
+
 char* HeaderField::getData() const
 {
 	if (m_TextBasedProtocolMessage == NULL)
@@ -0,0 +1,185 @@
+#ifndef PCAPPP_PARALLEL_FILE_PROCESSOR
+#define PCAPPP_PARALLEL_FILE_PROCESSOR
+
+#include <vector>
+#include <pthread.h>
+#include "PcapFileDevice.h"
+
+/// @file
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	class ParallelFileProcessor;
+
+	/**
+	 * @typedef OnFilePacketsArriveCallback
+	 * A callback that is called by a worker thread of ParallelFileProcessor when a burst of packets is ready for processing.
+	 * It's always called on the worker thread whose ID is given, so per-worker state can be kept without locking
+	 * @param[in] packets An array of RawPacket views into the processed file. The RawPacket objects are reused once the callback returns, but
+	 * the data they point to stays valid until ParallelFileProcessor#processFile() returns
+	 * @param[in] numOfPackets The number of packets in the array
+	 * @param[in] workerId The ID of the worker thread calling the callback, a value between 0 and the number of workers - 1
+	 * @param[in] processor The ParallelFileProcessor instance
+	 * @param[in] userCookie A pointer to the object set by the user when processFile() was called
+	 */
+	typedef void (*OnFilePacketsArriveCallback)(RawPacket* packets, uint32_t numOfPackets, uint16_t workerId, ParallelFileProcessor* processor, void* userCookie);
+
+	/**
+	 * @class ParallelFileProcessor
+	 * A class for processing a single pcap or pcap-ng file on multiple worker threads. The file is memory-mapped (see MmapPcapFileReaderDevice),
+	 * its record boundaries are indexed in one quick pass over the record headers, and the file is split into chunks that start and end on
+	 * record boundaries. Worker threads then take chunks and hand their packets to a user callback in bursts.
+	 * By default packets are distributed by chunk, which means packets of the same connection may be processed by different workers.
+	 * In flow-affinity mode (see setFlowAffinity()) packets are distributed by their 5-tuple hash (see hash5Tuple()), so all packets of a
+	 * connection in both directions are processed by the same worker, in the order they appear in the file. Flow-affinity mode works in
+	 * rounds of up to (number of workers) chunks: first each chunk is parsed by one worker which assigns its packets to workers by their
+	 * hash, then each worker processes the packets assigned to it in file order. Packets without a 5-tuple (hash value 0) are all processed
+	 * by worker 0.
+	 * Compressed (zstd) pcap-ng files are not supported. This class is not supported on Windows
+	 */
+	class ParallelFileProcessor
+	{
+	private:
+		struct FileChunk
+		{
+			uint64_t startOffset;
+			uint64_t endOffset;
+			bool swapBytes;
+			std::vector<MmapPcapFileReaderDevice::PcapNgInterfaceInfo> pcapNgInterfaces;
+		};
+
+		struct PacketLocation
+		{
+			uint64_t dataOffset;
+			uint32_t capturedLength;
+			uint32_t frameLength;
+			timespec timestamp;
+			LinkLayerType linkType;
+		};
+
+		enum WorkerPhase
+		{
+			ProcessChunks,
+			DispatchFlows,
+			ProcessFlows
+		};
+
+		struct WorkerContext
+		{
+			ParallelFileProcessor* processor;
+			uint16_t workerId;
+			WorkerPhase phase;
+			MmapPcapFileReaderDevice* reader;
+			uint64_t numOfPackets;
+		};
+
+		std::string m_FileName;
+		uint16_t m_NumOfWorkers;
+		uint64_t m_ChunkSize;
+		bool m_FlowAffinity;
+		std::vector<FileChunk> m_Chunks;
+		std::vector<WorkerContext> m_Workers;
+		OnFilePacketsArriveCallback m_OnPacketsArrive;
+		void* m_OnPacketsArriveUserCookie;
+		pthread_mutex_t m_NextChunkMutex;
+		size_t m_NextChunk;
+		size_t m_RoundStartChunk;
+		size_t m_RoundEndChunk;
+		// m_RoundLocations[chunk in round][destination worker]
+		std::vector<std::vector<std::vector<PacketLocation> > > m_RoundLocations;
+		uint64_t m_NumOfPacketsProcessed;
+
+		// private copy c'tor
+		ParallelFileProcessor(const ParallelFileProcessor& other);
+		ParallelFileProcessor& operator=(const ParallelFileProcessor& other);
+
+		bool indexFile(MmapPcapFileReaderDevice& indexer);
+		bool runWorkers(WorkerPhase phase);
+		bool takeNextChunk(size_t& chunkIndex);
+		void seekToChunk(MmapPcapFileReaderDevice& reader, const FileChunk& chunk) const;
+		void processChunk(WorkerContext& worker, const FileChunk& chunk);
+		void dispatchChunkFlows(WorkerContext& worker, size_t chunkIndex);
+		void processFlows(WorkerContext& worker);
+		static void* workerThreadMain(void* ptr);
+
+	public:
+		/**
+		 * The default size of a file chunk, in bytes
+		 */
+		static const uint64_t DefaultChunkSize = 16 * 1024 * 1024;
+
+		/**
+		 * A constructor for this class
+		 * @param[in] fileName The full path of the pcap or pcap-ng file to process
+		 * @param[in] numOfWorkers The number of worker threads. If set to 0 (the default) the number of cores in the machine is used
+		 */
+		ParallelFileProcessor(const std::string& fileName, uint16_t numOfWorkers = 0);
+
+		/**
+		 * A destructor for this class
+		 */
+		~ParallelFileProcessor();
+
+		/**
+		 * @return The name of the processed file
+		 */
+		std::string getFileName() const { return m_FileName; }
+
+		/**
+		 * @return The number of worker threads
+		 */
+		uint16_t getNumOfWorkers() const { return m_NumOfWorkers; }
+
+		/**
+		 * Set the approximate size of the chunks the file is split into. Chunks always start and end on record boundaries, so the actual size
+		 * may be a bit larger. Smaller chunks balance the load better while bigger chunks lower the scheduling overhead (and in flow-affinity
+		 * mode - the memory used per round). The default is DefaultChunkSize
+		 * @param[in] chunkSize The chunk size in bytes. A value of 0 is ignored
+		 */
+		void setChunkSize(uint64_t chunkSize) { if (chunkSize > 0) m_ChunkSize = chunkSize; }
+
+		/**
+		 * @return The approximate size of file chunks in bytes
+		 */
+		uint64_t getChunkSize() const { return m_ChunkSize; }
+
+		/**
+		 * Enable or disable flow-affinity mode. For more details please refer to the class description
+		 * @param[in] flowAffinity True to keep all packets of a connection on one worker, false to distribute packets by file chunks
+		 */
+		void setFlowAffinity(bool flowAffinity) { m_FlowAffinity = flowAffinity; }
+
+		/**
+		 * @return True if flow-affinity mode is enabled, false otherwise
+		 */
+		bool isFlowAffinity() const { return m_FlowAffinity; }
+
+		/**
+		 * Process the whole file. This method indexes the file, starts the worker threads and blocks until all packets were handed to the
+		 * callback and all worker threads ended
+		 * @param[in] onPacketsArrive The callback to call on worker threads for every burst of packets
+		 * @param[in] onPacketsArriveUserCookie A pointer to a user object that will be passed to the callback
+		 * @return True if the whole file was processed, false if the file couldn't be opened or indexed or if worker threads couldn't
+		 * be created (an error will be printed to log)
+		 */
+		bool processFile(OnFilePacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie);
+
+		/**
+		 * @return The number of file chunks found in the last call to processFile()
+		 */
+		size_t getNumOfChunks() const { return m_Chunks.size(); }
+
+		/**
+		 * @return The total number of packets handed to the callback in the last call to processFile()
+		 */
+		uint64_t getNumOfPacketsProcessed() const { return m_NumOfPacketsProcessed; }
+	};
+
+} // namespace pcpp
+
+#endif // PCAPPP_PARALLEL_FILE_PROCESSOR
@@ -1,6 +1,9 @@
 #ifndef PCAPPP_FILE_DEVICE
 #define PCAPPP_FILE_DEVICE
 
+#include <vector>
+#include <deque>
+#include <pthread.h>
 #include "PcapDevice.h"
 #include "RawPacket.h"
 
@@ -17,6 +20,17 @@ typedef struct pcap_dumper pcap_dumper_t;
 namespace pcpp
 {
 
+	class PcapFileIndex;
+
+	/**
+	 * @typedef OnFlowPacketCallback
+	 * A callback that is called by MmapPcapFileReaderDevice#forEachPacketOfFlow() for every packet of the flow
+	 * @param[in] rawPacket The packet read from the file. It's valid only until the callback returns
+	 * @param[in] userCookie A pointer to the object set by the user when forEachPacketOfFlow() was called
+	 * @return True to stop reading the packets of the flow, false to continue
+	 */
+	typedef bool (*OnFlowPacketCallback)(RawPacket& rawPacket, void* userCookie);
+
 	/**
 	 * @class IFileDevice
 	 * An abstract class (cannot be instantiated, has a private c'tor) which is the parent class for all file devices
@@ -55,6 +69,7 @@ namespace pcpp
 	protected:
 		uint32_t m_NumOfPacketsRead;
 		uint32_t m_NumOfPacketsNotParsed;
+		bool m_ZeroCopyMode;
 
 		/**
 		 * A constructor for this class that gets the pcap full path file name to open. Notice that after calling this constructor the file
@@ -63,6 +78,13 @@ namespace pcpp
 		 */
 		IFileReaderDevice(const char* fileName);
 
+		/**
+		 * Set packet data read by the underlying engine into a RawPacket. In zero-copy mode the RawPacket points to the engine's buffer,
+		 * otherwise the data is copied to a newly allocated buffer owned by the RawPacket. rawPacket is assumed to be cleared
+		 */
+		bool setPacketData(RawPacket& rawPacket, const uint8_t* packetData, uint32_t capturedLength, timeval timestamp, LinkLayerType linkType, uint32_t frameLength) const;
+		bool setPacketData(RawPacket& rawPacket, const uint8_t* packetData, uint32_t capturedLength, timespec timestamp, LinkLayerType linkType, uint32_t frameLength) const;
+
 	public:
 
 		/**
@@ -77,6 +99,24 @@ namespace pcpp
 
 		virtual bool getNextPacket(RawPacket& rawPacket) = 0;
 
+		/**
+		 * Enable or disable zero-copy read mode. By default every packet read by getNextPacket() is copied into a newly allocated buffer owned
+		 * by the RawPacket. In zero-copy mode no allocation or copy takes place: the RawPacket points directly to the read buffer of the
+		 * underlying engine (libpcap or LightPcapNg) and doesn't own it (its deleteRawDataAtDestructor flag is set to 'false').
+		 * The lifetime contract in zero-copy mode is: the raw data of a RawPacket returned by getNextPacket() is valid only until the next
+		 * call to getNextPacket() / getNextPackets() on this device or until the device is closed, whichever comes first. Users who need to keep
+		 * a packet for longer should copy it (for example using the RawPacket copy constructor). Modifying the packet in a way that requires a
+		 * bigger buffer (RawPacket::reallocateData()) is safe since the data is copied into a new buffer owned by the RawPacket.
+		 * getNextPackets() always copies the packets it reads since they must outlive the next read
+		 * @param[in] zeroCopyMode True to enable zero-copy read mode, false to disable it
+		 */
+		void setZeroCopyMode(bool zeroCopyMode) { m_ZeroCopyMode = zeroCopyMode; }
+
+		/**
+		 * @return True if zero-copy read mode is enabled, false otherwise. For more details please refer to setZeroCopyMode()
+		 */
+		bool isZeroCopyMode() const { return m_ZeroCopyMode; }
+
 		/**
 		 * Read the next N packets into a raw packet vector
 		 * @param[out] packetVec The raw packet vector to read packets into
@@ -259,6 +299,173 @@ namespace pcpp
 	};
 
 
+	/**
+	 * @class MmapPcapFileReaderDevice
+	 * A class for reading pcap and pcap-ng files by mapping the whole file into memory. Instead of going through libpcap or LightPcapNg
+	 * (which read the file with stdio one packet at a time) this device walks the record headers of the mapped file directly, so reading
+	 * a packet costs no system call, allocation or copy. The file format (pcap or pcap-ng) is detected by the file magic number and not by
+	 * its extension. Compressed (zstd) pcap-ng files are not supported.
+	 * This device is in zero-copy mode by default (see IFileReaderDevice#setZeroCopyMode()). In this mode packets read by getNextPacket() or
+	 * getNextPackets() point directly into the mapped file and stay valid until the device is closed (not only until the next read as in
+	 * other readers). The file is mapped copy-on-write, so modifying a packet in place never changes the file on disk.
+	 * With an index of the file (see PcapFileIndex and setIndex()) this device can also seek to a packet number or a timestamp and read the
+	 * packets of a single flow without reading the rest of the file.
+	 * This device is not supported on Windows
+	 */
+	class MmapPcapFileReaderDevice : public IFileReaderDevice
+	{
+		friend class ParallelFileProcessor;
+		friend class PcapFileIndex;
+	private:
+		struct PcapNgInterfaceInfo
+		{
+			LinkLayerType linkType;
+			uint32_t snapLen;
+			uint64_t tsUnitsPerSec;
+			int64_t tsOffset;
+			uint64_t blockOffset;
+		};
+
+		uint8_t* m_MappedFile;
+		uint64_t m_MappedFileLength;
+		uint64_t m_ReadOffset;
+		uint64_t m_ReadEndOffset;
+		// the offset of the last packet record read by getNextRecord()
+		uint64_t m_RecordOffset;
+		uint64_t m_PcapNgSectionOffset;
+		const PcapFileIndex* m_Index;
+		bool m_IsPcapNg;
+		bool m_SwapBytes;
+		bool m_NanoSecPrecision;
+		LinkLayerType m_PcapLinkLayerType;
+		std::vector<PcapNgInterfaceInfo> m_PcapNgInterfaces;
+		BpfFilterWrapper m_BpfWrapper;
+
+		// private copy c'tor
+		MmapPcapFileReaderDevice(const MmapPcapFileReaderDevice& other);
+		MmapPcapFileReaderDevice& operator=(const MmapPcapFileReaderDevice& other);
+
+		uint16_t read16(uint64_t offset) const;
+		uint32_t read32(uint64_t offset) const;
+		bool parsePcapFileHeader();
+		bool parsePcapNgSectionHeader(uint64_t offset);
+		bool parsePcapNgInterfaceBlock(uint64_t offset, uint32_t blockLength);
+		bool getNextRecord(const uint8_t*& packetData, uint32_t& capturedLength, uint32_t& frameLength, timespec& timestamp, LinkLayerType& linkType);
+		bool getNextPcapRecord(const uint8_t*& packetData, uint32_t& capturedLength, uint32_t& frameLength, timespec& timestamp, LinkLayerType& linkType);
+		bool getNextPcapNgRecord(const uint8_t*& packetData, uint32_t& capturedLength, uint32_t& frameLength, timespec& timestamp, LinkLayerType& linkType);
+		bool readNextPacket(RawPacket& rawPacket);
+		bool setReadOffset(uint64_t recordOffset, const PcapFileIndex& index);
+
+	public:
+		/**
+		 * A constructor for this class that gets the pcap or pcap-ng full path file name to open. Notice that after calling this constructor the
+		 * file isn't opened (mapped) yet, so reading packets will fail. For opening the file call open()
+		 * @param[in] fileName The full path of the file to read
+		 */
+		MmapPcapFileReaderDevice(const char* fileName);
+
+		/**
+		 * A destructor for this class. Unmaps the file if it's still mapped
+		 */
+		virtual ~MmapPcapFileReaderDevice() { close(); }
+
+		/**
+		 * @return True if the opened file is a pcap-ng file, false if it's a pcap file or if the file isn't opened
+		 */
+		bool isPcapNg() const { return m_IsPcapNg; }
+
+		/**
+		 * Read a burst of packets from the file into a caller-provided array of RawPacket objects. This is the fastest way to read a file since
+		 * in zero-copy mode (the default) every RawPacket is just a view into the mapped file. Each RawPacket in the array is cleared before
+		 * it's set. Before using this method please verify the file is opened using open()
+		 * @param[out] packetsArr An array of RawPacket objects to fill
+		 * @param[in] packetsArrLength The length of the array
+		 * @return The number of packets actually read. A value lower than packetsArrLength means end-of-file was reached. 0 is returned
+		 * also if the file isn't opened (an error log will be printed)
+		 */
+		int getNextPackets(RawPacket* packetsArr, int packetsArrLength);
+
+		using IFileReaderDevice::getNextPackets;
+
+		/**
+		 * Set the index used by seekToTime(), seekToPacket() and forEachPacketOfFlow(). The index isn't copied, so it must stay valid as
+		 * long as it's set. An index can be set before or after the file is opened
+		 * @param[in] index The index of the file, or NULL to remove the current index
+		 */
+		void setIndex(const PcapFileIndex* index) { m_Index = index; }
+
+		/**
+		 * @return The index set by setIndex(), or NULL if no index is set
+		 */
+		const PcapFileIndex* getIndex() const { return m_Index; }
+
+		/**
+		 * Move the read position so the next packet read is the first packet in the file whose timestamp is equal to or later than a given
+		 * timestamp. The file is read from the closest indexed packet, so this method doesn't depend on the file being sorted by time
+		 * @param[in] timestamp The timestamp to seek to
+		 * @return True if such a packet was found. False if the file isn't opened, no index was set (in both cases an error log will be
+		 * printed) or if all packets are earlier than the timestamp, in which case the read position is at the end of the file
+		 */
+		bool seekToTime(const timespec& timestamp);
+
+		/**
+		 * Move the read position so the next packet read is a given packet. Packets are counted from the beginning of the file regardless
+		 * of the filter set by setFilter()
+		 * @param[in] packetNumber The number of the packet, counting from 0
+		 * @return True if the packet was found. False if the file isn't opened, no index was set (in both cases an error log will be
+		 * printed) or if the file has fewer packets
+		 */
+		bool seekToPacket(uint64_t packetNumber);
+
+		/**
+		 * Read all packets of a flow using the flow records of the index, in file order. Only the packets of the flow are read and the read
+		 * position of getNextPacket() doesn't change. The filter set by setFilter() applies to these packets as well
+		 * @param[in] flowHash The 5-tuple hash of the flow, see hash5Tuple()
+		 * @param[in] onPacket The callback to call for every packet of the flow
+		 * @param[in] userCookie A pointer to a user object that will be passed to the callback
+		 * @return True if all packets of the flow were read or the callback stopped reading. False if the file isn't opened, no index with
+		 * flow records was set (in both cases an error log will be printed) or if the index doesn't match the file
+		 */
+		bool forEachPacketOfFlow(uint32_t flowHash, OnFlowPacketCallback onPacket, void* userCookie);
+
+		//overridden methods
+
+		/**
+		 * Read the next packet from the file. Before using this method please verify the file is opened using open()
+		 * @param[out] rawPacket A reference for an empty RawPacket where the packet will be written
+		 * @return True if a packet was read successfully. False will be returned if the file isn't opened (also, an error log will be printed)
+		 * or if reached end-of-file
+		 */
+		bool getNextPacket(RawPacket& rawPacket);
+
+		/**
+		 * Map the file which path was specified in the constructor into memory and parse its file header. The kernel is advised the mapping
+		 * is read sequentially, and where supported it's also advised to back the mapping with huge pages (best effort)
+		 * @return True if file was mapped successfully or if file is already opened. False if opening the file failed for some reason (for
+		 * example: file path does not exist, file is not a pcap or pcap-ng file or the platform is not supported)
+		 */
+		bool open();
+
+		/**
+		 * Unmap the file. All packets read in zero-copy mode become invalid once the file is closed
+		 */
+		void close();
+
+		/**
+		 * Get statistics of packets read so far. In the PcapStats struct, only the packetsRecv member is relevant. The rest of the members will contain 0
+		 * @param[out] stats The stats struct where stats are returned
+		 */
+		void getStatistics(PcapStats& stats) const;
+
+		/**
+		 * Set a filter for the reader device. Only packets that match the filter will be read
+		 * @param[in] filterAsString The filter to be set in Berkeley Packet Filter (BPF) syntax (http://biot.com/capstats/bpf.html)
+		 * @return True if filter set successfully, false otherwise
+		 */
+		bool setFilter(std::string filterAsString);
+	};
+
+
 	/**
 	 * @class IFileWriterDevice
 	 * An abstract class (cannot be instantiated, has a private c'tor) which is the parent class for file writer devices
@@ -300,6 +507,8 @@ namespace pcpp
 		LinkLayerType m_PcapLinkLayerType;
 		bool m_AppendMode;
 		FILE* m_File;
+		uint64_t m_FileOffset;
+		PcapFileIndex* m_Index;
 
 		// private copy c'tor
 		PcapFileWriterDevice(const PcapFileWriterDevice& other);
@@ -340,6 +549,14 @@ namespace pcpp
 		 */
 		bool writePackets(const RawPacketVector& packets);
 
+		/**
+		 * Add every packet written from now on to an index of the file, so the index is ready when writing is done. The index isn't copied, so
+		 * it must stay valid as long as it's set. The index should be set before any packet is written, either to an empty index or (in
+		 * append mode) to the index of the existing file
+		 * @param[in] index The index to add the written packets to, or NULL to stop indexing
+		 */
+		void setIndex(PcapFileIndex* index) { m_Index = index; }
+
 		//override methods
 
 		/**
@@ -380,6 +597,199 @@ namespace pcpp
 	};
 
 
+	/**
+	 * @class AsyncPcapFileWriterDevice
+	 * A class for writing pcap files at high rates, for example when recording traffic from a live device. Instead of writing each packet
+	 * to the file on the caller's thread like PcapFileWriterDevice, packets are serialized into large aligned memory buffers and full
+	 * buffers are written by a dedicated I/O thread, so the caller only pays for a memory copy per packet. The number and size of the
+	 * buffers are set in the c'tor. When all buffers are waiting to be written the device either blocks the caller until a buffer is free
+	 * (backpressure) or drops the packet, and both events are counted (see getNumOfBackpressureWaits() and getNumOfPacketsDropped()).
+	 * On Linux the file can be written with O_DIRECT, bypassing the page cache. The file is written in the same format as
+	 * PcapFileWriterDevice writes it (pcap, microsecond precision) and can be opened in append mode.
+	 * This device is not supported on Windows
+	 */
+	class AsyncPcapFileWriterDevice : public IFileWriterDevice
+	{
+	public:
+
+		/**
+		 * @struct AsyncWriterConfig
+		 * The buffering configuration of an AsyncPcapFileWriterDevice
+		 */
+		struct AsyncWriterConfig
+		{
+			/** The size of each buffer in bytes. It's rounded up to a multiple of 4KB and is at least 256KB. The default is 4MB */
+			size_t bufferSize;
+			/** The number of buffers, at least 2. The default is 8 */
+			int numOfBuffers;
+			/** If set to true packets are dropped when all buffers are waiting to be written, otherwise the caller waits for a free buffer.
+			 * The default is false */
+			bool dropWhenFull;
+			/** If set to true the file is written with O_DIRECT where the OS and file system support it, otherwise (or if not supported)
+			 * the file is written through the page cache. The default is false */
+			bool directIO;
+
+			AsyncWriterConfig() : bufferSize(4 * 1024 * 1024), numOfBuffers(8), dropWhenFull(false), directIO(false) {}
+		};
+
+	private:
+		// buffers are aligned to, and with O_DIRECT written in multiples of, this size
+		static const size_t Alignment = 4096;
+
+		/**
+		 * A buffer handed over to the I/O thread
+		 */
+		struct WriteBuffer
+		{
+			uint8_t* data;
+			size_t length;
+			uint64_t fileOffset;
+		};
+
+		LinkLayerType m_PcapLinkLayerType;
+		AsyncWriterConfig m_Config;
+		int m_Fd;
+		bool m_DirectIO;
+
+		// the buffer being filled by the caller and its position in the file
+		uint8_t* m_CurBuffer;
+		size_t m_CurLength;
+		uint64_t m_CurFileOffset;
+		// with O_DIRECT only whole blocks are written, so the last partial block written by flush() is written again with the next buffer
+		uint8_t m_PendingTail[Alignment];
+		size_t m_PendingTailLength;
+
+		uint64_t m_NumOfPacketsDropped;
+		uint64_t m_NumOfBackpressureWaits;
+		// a copy of m_IoError taken whenever the caller synchronizes with the I/O thread
+		bool m_IoErrorSeen;
+		PcapFileIndex* m_Index;
+
+		// the fields below are shared with the I/O thread and protected by m_Mutex
+		pthread_t m_IoThread;
+		bool m_IoThreadStarted;
+		pthread_mutex_t m_Mutex;
+		pthread_cond_t m_BufferReadyCond;
+		pthread_cond_t m_BufferFreeCond;
+		std::vector<uint8_t*> m_AllBuffers;
+		std::vector<uint8_t*> m_FreeBuffers;
+		std::deque<WriteBuffer> m_FullBuffers;
+		bool m_IoBusy;
+		bool m_StopIo;
+		bool m_IoError;
+
+		// private copy c'tor
+		AsyncPcapFileWriterDevice(const AsyncPcapFileWriterDevice& other);
+		AsyncPcapFileWriterDevice& operator=(const AsyncPcapFileWriterDevice& other);
+
+		bool openFile(bool appendMode);
+		bool acquireBuffer(bool wait);
+		void submitBuffer();
+		void waitForIo();
+		bool appendPacket(RawPacket const& packet);
+		void releaseResources();
+		bool writeBufferToFile(const WriteBuffer& buffer);
+		void ioThreadLoop();
+		static void* ioThreadMain(void* device);
+
+	public:
+		/**
+		 * A constructor for this class that gets the pcap full path file name to open for writing or create. Notice that after calling this
+		 * constructor the file isn't opened yet, so writing packets will fail. For opening the file call open()
+		 * @param[in] fileName The full path of the file
+		 * @param[in] linkLayerType The link layer type all packet in this file will be based on. The default is Ethernet
+		 * @param[in] config The buffering configuration, see AsyncWriterConfig for the defaults
+		 */
+		AsyncPcapFileWriterDevice(const char* fileName, LinkLayerType linkLayerType = LINKTYPE_ETHERNET, const AsyncWriterConfig& config = AsyncWriterConfig());
+
+		/**
+		 * A destructor for this class. Writes all buffered packets and closes the file if it's still opened
+		 */
+		~AsyncPcapFileWriterDevice();
+
+		/**
+		 * Copy a RawPacket to the current write buffer. The packet is written to the file later by the I/O thread. Before using this method
+		 * please verify the file is opened using open(). This method won't change the written packet
+		 * @param[in] packet A reference for an existing RawPcket to write to the file
+		 * @return True if the packet was buffered successfully. False will be returned if the file isn't opened, if the packet link layer
+		 * type is different than the one defined for the file (in these cases an error will be printed to log), if the packet was dropped
+		 * because all buffers were full or if writing a previous buffer to the file failed
+		 */
+		bool writePacket(RawPacket const& packet);
+
+		/**
+		 * Copy multiple RawPacket to the write buffers. The link layer type of all packets is verified before any of them is buffered, and
+		 * the I/O thread is notified only when buffers fill up. This method won't change the written packets or the RawPacketVector instance
+		 * @param[in] packets A reference for an existing RawPcketVector, all of its packets will be written to the file
+		 * @return True if all packets were buffered successfully. False will be returned if the file isn't opened, if one of the packets
+		 * has a different link layer type than the one defined for the file (in these cases no packet is buffered), or if at least one of the
+		 * packets was dropped
+		 */
+		bool writePackets(const RawPacketVector& packets);
+
+		/**
+		 * Get the number of packets dropped because all buffers were waiting to be written. Packets are dropped only if
+		 * AsyncWriterConfig#dropWhenFull is set
+		 */
+		uint64_t getNumOfPacketsDropped() const { return m_NumOfPacketsDropped; }
+
+		/**
+		 * Get the number of times the caller had to wait for the I/O thread to free a buffer. A growing number means the disk can't keep
+		 * up with the packet rate
+		 */
+		uint64_t getNumOfBackpressureWaits() const { return m_NumOfBackpressureWaits; }
+
+		/**
+		 * @return True if the opened file is written with O_DIRECT
+		 */
+		bool isDirectIO() const { return m_DirectIO; }
+
+		/**
+		 * Add every packet buffered from now on to an index of the file, see PcapFileWriterDevice#setIndex(). Packets are added when they're
+		 * buffered, so the index may point to packets that aren't written to the file yet
+		 * @param[in] index The index to add the written packets to, or NULL to stop indexing
+		 */
+		void setIndex(PcapFileIndex* index) { m_Index = index; }
+
+		//override methods
+
+		/**
+		 * Open the file in a write mode and start the I/O thread. If file doesn't exist, it will be created. If it does exist it will be
+		 * overwritten, meaning all its current content will be deleted
+		 * @return True if file was opened/created successfully or if file is already opened. False if opening the file failed for some reason
+		 * (an error will be printed to log)
+		 */
+		bool open();
+
+		/**
+		 * Same as open(), but enables to open the file in append mode in which packets will be appended to the file
+		 * instead of overwrite its current content. In append mode file must exist, otherwise opening will fail
+		 * @param[in] appendMode A boolean indicating whether to open the file in append mode or not. If set to false
+		 * this method will act exactly like open(). If set to true, file will be opened in append mode
+		 * @return True of managed to open the file successfully. In case appendMode is set to true, false will be returned
+		 * if file wasn't found or couldn't be read, if file type is not pcap with microsecond precision, or if link type specified in c'tor
+		 * is different from current file link type. In case appendMode is set to false, please refer to open() for return values
+		 */
+		bool open(bool appendMode);
+
+		/**
+		 * Hand over the current buffer to the I/O thread and wait until all buffered packets are written to the file
+		 */
+		void flush();
+
+		/**
+		 * Write all buffered packets, stop the I/O thread and close the file
+		 */
+		void close();
+
+		/**
+		 * Get statistics of packets written so far. Dropped packets are counted as packets not written
+		 * @param[out] stats The stats struct where stats are returned
+		 */
+		void getStatistics(PcapStats& stats) const;
+	};
+
+
 	/**
 	 * @class PcapNgFileWriterDevice
 	 * A class for opening a pcap-ng file for writing or creating a new pcap-ng file and write packets to it. This class adds
@@ -0,0 +1,195 @@
+#ifndef PCAPPP_PCAP_FILE_INDEX
+#define PCAPPP_PCAP_FILE_INDEX
+
+#include <string>
+#include <vector>
+#include <map>
+#include "PcapFileDevice.h"
+
+/// @file
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	/**
+	 * @class PcapFileIndex
+	 * An index of a pcap or pcap-ng file that enables random access into the file instead of reading it from the first packet.
+	 * The index keeps the file offset of one packet out of every N packets and of the first packet of every time interval, and optionally the
+	 * offsets of all packets of every flow (flows are identified by their 5-tuple hash, see hash5Tuple()). The index is used by
+	 * MmapPcapFileReaderDevice to seek to a packet number or a timestamp and to read the packets of a single flow (see
+	 * MmapPcapFileReaderDevice#setIndex()).
+	 * An index can be built in 3 ways:
+	 * - By reading an existing file with build()
+	 * - While the file is being written, by attaching it to a PcapFileWriterDevice or AsyncPcapFileWriterDevice (see their setIndex() method)
+	 * - By loading an index that was saved to a sidecar file, see save() and load()
+	 *
+	 * The index is built incrementally: packets are only added to it, and calling build() on an indexed file that grew since only reads the
+	 * new packets. Compressed (zstd) pcap-ng files are not supported
+	 */
+	class PcapFileIndex
+	{
+		friend class MmapPcapFileReaderDevice;
+	public:
+
+		/**
+		 * @struct IndexConfig
+		 * Which packets are indexed
+		 */
+		struct IndexConfig
+		{
+			/** Index one packet out of this number of packets. The default is 10000, 0 means packets are indexed only by timeInterval */
+			uint32_t packetInterval;
+			/** Also index the first packet whose timestamp is this number of seconds or more after the last indexed packet. The default is 1,
+			 * 0 means packets are indexed only by packetInterval */
+			uint32_t timeInterval;
+			/** If set to true the offsets of all packets of every flow are kept. The default is false */
+			bool indexFlows;
+
+			IndexConfig() : packetInterval(10000), timeInterval(1), indexFlows(false) {}
+		};
+
+		/**
+		 * @struct IndexEntry
+		 * An indexed packet
+		 */
+		struct IndexEntry
+		{
+			/** The number of the packet in the file, counting from 0 */
+			uint64_t packetNumber;
+			/** The offset of the packet record in the file */
+			uint64_t recordOffset;
+			/** The packet timestamp */
+			timespec timestamp;
+			/** The latest timestamp of all packets before this packet, so seeking by time works also in files that aren't sorted by time */
+			timespec maxTimestampBefore;
+		};
+
+	private:
+		// a pcap-ng section header or interface description block, needed for reading packets from the middle of a pcap-ng file
+		struct PcapNgBlock
+		{
+			uint64_t offset;
+			bool isSectionHeader;
+		};
+
+		IndexConfig m_Config;
+		std::vector<IndexEntry> m_Entries;
+		std::vector<PcapNgBlock> m_PcapNgBlocks;
+		std::map<uint32_t, std::vector<uint64_t> > m_FlowRecords;
+		uint64_t m_NumOfPackets;
+		// where the next packet starts, building continues from here
+		uint64_t m_IndexedLength;
+		timespec m_MaxTimestamp;
+
+		void addPcapNgBlock(uint64_t offset, bool isSectionHeader);
+		void getPcapNgBlocksBefore(uint64_t offset, std::vector<PcapNgBlock>& blocks) const;
+
+	public:
+		/**
+		 * A constructor for this class that creates an empty index
+		 * @param[in] config Which packets are indexed. The default is the default IndexConfig
+		 */
+		PcapFileIndex(const IndexConfig& config = IndexConfig());
+
+		/**
+		 * Remove all packets from the index. The index config stays the same
+		 */
+		void clear();
+
+		/**
+		 * Index the packets of a file that aren't indexed yet. If the index is empty the whole file is read, otherwise reading starts right
+		 * after the last indexed packet, so it's possible to build the index of a growing file in several calls. Packet data is read only if
+		 * flows are indexed
+		 * @param[in] fileName The full path of the pcap or pcap-ng file
+		 * @return True if the file was indexed successfully, false if the file couldn't be opened or is shorter than the indexed length (an
+		 * error will be printed to log)
+		 */
+		bool build(const std::string& fileName);
+
+		/**
+		 * Add a packet to the index. Packets must be added in the order they appear in the file. This method is called by the writer
+		 * devices and by build(), there is usually no need to call it directly
+		 * @param[in] recordOffset The offset of the packet record in the file
+		 * @param[in] recordLength The length of the packet record in the file
+		 * @param[in] timestamp The packet timestamp as it appears in the file
+		 * @param[in] flowHash The 5-tuple hash of the packet, used only if flows are indexed
+		 */
+		void addPacket(uint64_t recordOffset, uint64_t recordLength, const timespec& timestamp, uint32_t flowHash);
+
+		/**
+		 * Save the index to a file
+		 * @param[in] indexFileName The full path of the index file, usually the one returned by getIndexFileName()
+		 * @return True if the index was saved successfully, false otherwise (an error will be printed to log)
+		 */
+		bool save(const std::string& indexFileName) const;
+
+		/**
+		 * Load an index saved by save(), replacing the current content and config of the index
+		 * @param[in] indexFileName The full path of the index file
+		 * @return True if the index was loaded successfully, false if the file couldn't be read or isn't an index file (an error will be
+		 * printed to log). If false is returned the index is empty
+		 */
+		bool load(const std::string& indexFileName);
+
+		/**
+		 * @param[in] fileName The full path of a pcap or pcap-ng file
+		 * @return The conventional name of the sidecar index file of this file, which is the file name followed by ".idx"
+		 */
+		static std::string getIndexFileName(const std::string& fileName) { return fileName + ".idx"; }
+
+		/**
+		 * @return The index config
+		 */
+		const IndexConfig& getConfig() const { return m_Config; }
+
+		/**
+		 * @return The number of packets added to the index
+		 */
+		uint64_t getNumOfPackets() const { return m_NumOfPackets; }
+
+		/**
+		 * @return The file offset right after the last indexed packet
+		 */
+		uint64_t getIndexedLength() const { return m_IndexedLength; }
+
+		/**
+		 * @return The indexed packets, ordered by packet number
+		 */
+		const std::vector<IndexEntry>& getEntries() const { return m_Entries; }
+
+		/**
+		 * Find the indexed packet to start reading from in order to reach the first packet whose timestamp is equal to or later than a given
+		 * timestamp. All packets before the returned packet are earlier than the timestamp
+		 * @param[in] timestamp The timestamp to look for
+		 * @param[out] entry The indexed packet
+		 * @return False if the index is empty, true otherwise
+		 */
+		bool findEntryByTime(const timespec& timestamp, IndexEntry& entry) const;
+
+		/**
+		 * Find the last indexed packet whose number is equal to or lower than a given packet number
+		 * @param[in] packetNumber The packet number to look for, counting from 0
+		 * @param[out] entry The indexed packet
+		 * @return False if the index is empty or if the packet number isn't lower than the number of indexed packets, true otherwise
+		 */
+		bool findEntryByPacket(uint64_t packetNumber, IndexEntry& entry) const;
+
+		/**
+		 * @param[in] flowHash The 5-tuple hash of the flow
+		 * @return The file offsets of all packet records of the flow in file order, or NULL if flows aren't indexed or the flow has no packets
+		 */
+		const std::vector<uint64_t>* getFlowRecords(uint32_t flowHash) const;
+
+		/**
+		 * @return The number of flows in the index, 0 if flows aren't indexed
+		 */
+		size_t getNumOfFlows() const { return m_FlowRecords.size(); }
+	};
+
+} // namespace pcpp
+
+#endif // PCAPPP_PCAP_FILE_INDEX
@@ -8,6 +8,7 @@
 #include <stdint.h>
 #include "ArpLayer.h"
 #include "RawPacket.h"
+#include "ThreadedBpfProgram.h"
 
 //Forward Declaration - used in GeneralFilter
 struct bpf_program;
@@ -72,7 +73,9 @@ namespace pcpp
 
 	/**
 	 * @class BpfFilterWrapper
-	 * A wrapper class for BPF filtering. Enables setting a BPF filter and matching it against a packet
+	 * A wrapper class for BPF filtering. Enables setting a BPF filter and matching it against a packet. Compiled filters are translated
+	 * into a ThreadedBpfProgram which is used for matching instead of libpcap's interpreter. Filters it can't translate are matched with
+	 * libpcap's interpreter, and both give the same results
 	 */
 	class BpfFilterWrapper
 	{
@@ -80,6 +83,7 @@ namespace pcpp
 		std::string m_FilterStr;
 		LinkLayerType m_LinkType;
 		bpf_program* m_Program;
+		ThreadedBpfProgram m_ThreadedProgram;
 
 		void freeProgram();
 
@@ -7,6 +7,7 @@
 #include <string.h>
 #include "IpAddress.h"
 #include "Packet.h"
+#include "SystemUtils.h"
 
 // forward declerations for structs and typedefs that are defined in pcap.h
 struct pcap_if;
@@ -34,6 +35,17 @@ namespace pcpp
 	 */
 	typedef void (*OnPacketArrivesCallback)(RawPacket* pPacket, PcapLiveDevice* pDevice, void* userCookie);
 
+	/**
+	 * @typedef OnPacketBurstArrivesCallback
+	 * A callback that is called with a burst of packets captured by PcapLiveDevice in burst mode (see PcapLiveDevice#startCaptureBurstMode())
+	 * @param[in] packets An array of the captured packets. The packets and their data are valid only until the callback returns, as both are
+	 * reused for the next burst
+	 * @param[in] numOfPackets The number of packets in the array
+	 * @param[in] pDevice A pointer to the PcapLiveDevice instance
+	 * @param[in] userCookie A pointer to the object put by the user when packet capturing stared
+	 */
+	typedef void (*OnPacketBurstArrivesCallback)(RawPacket* packets, size_t numOfPackets, PcapLiveDevice* pDevice, void* userCookie);
+
 	/**
 	 * @typedef OnPacketArrivesStopBlocking
 	 * A callback that is called when a packet is captured by PcapLiveDevice
@@ -57,6 +69,7 @@ namespace pcpp
 	typedef void* (*ThreadStart)(void*);
 
 	struct PcapThread;
+	struct FanoutCaptureThread;
 
 	/**
 	 * @class PcapLiveDevice
@@ -72,7 +85,9 @@ namespace pcpp
 	 * from both libpcap and the OS
 	 * - Capture packets from the network. Capturing is always conducted on a different thread. PcapPlusPlus creates this
 	 * thread when capturing starts and kills it when capturing ends. This prevents the application from being stuck while waiting for packets or
-	 * processing them. Currently only one capturing thread is allowed, so when the interface is in capture mode, no further capturing is allowed.
+	 * processing them. Only one capture can run at a time, so when the interface is in capture mode, no further capturing is allowed. On Linux
+	 * a capture can also be spread over several threads, each reading its share of the traffic from its own descriptor (see
+	 * startCaptureMultiThread())
 	 * In addition to capturing the user can get stats on packets that were received by the application, dropped by the NIC (due to full
 	 * NIC buffers), etc. Stats collection can be initiated by the user by calling getStatistics() or be pushed to the user periodically by
 	 * supplying a callback and a timeout to startCapture()
@@ -107,6 +122,16 @@ namespace pcpp
 		int m_IntervalToUpdateStats;
 		RawPacketVector* m_CapturedPackets;
 		bool m_CaptureCallbackMode;
+		OnPacketBurstArrivesCallback m_cbOnPacketBurstArrives;
+		void* m_cbOnPacketBurstArrivesUserCookie;
+		// the packets of the current burst, which point into m_BurstBuffer
+		RawPacket* m_BurstPackets;
+		bool m_BurstPacketsAllocated;
+		size_t m_BurstSize;
+		size_t m_MaxBurstSize;
+		uint8_t* m_BurstBuffer;
+		size_t m_BurstBufferSize;
+		size_t m_BurstBufferOffset;
 		LinkLayerType m_LinkType;
 
 		// c'tor is not public, there should be only one for every interface (created by PcapLiveDeviceList)
@@ -123,6 +148,13 @@ namespace pcpp
 		static void onPacketArrives(uint8_t* user, const struct pcap_pkthdr* pkthdr, const uint8_t* packet);
 		static void onPacketArrivesNoCallback(uint8_t* user, const struct pcap_pkthdr* pkthdr, const uint8_t* packet);
 		static void onPacketArrivesBlockingMode(uint8_t* user, const struct pcap_pkthdr* pkthdr, const uint8_t* packet);
+		static void onPacketArrivesBurstMode(uint8_t* user, const struct pcap_pkthdr* pkthdr, const uint8_t* packet);
+		void flushPacketBurst();
+		void releasePacketBurst();
+		static void* fanoutCaptureThreadMain(void* ptr);
+		static void onFanoutPacketArrives(uint8_t* user, const struct pcap_pkthdr* pkthdr, const uint8_t* packet);
+		void stopFanoutThreads();
+		void restoreMainDescriptorFilter();
 		std::string printThreadId(PcapThread* id);
 		virtual ThreadStart getCaptureThreadStart();
 	public:
@@ -235,6 +267,58 @@ namespace pcpp
 		};
 
 
+		/**
+		 * The way packets are spread between the threads of a multi-threaded capture, see startCaptureMultiThread()
+		 */
+		enum FanoutMode
+		{
+			/** Packets are spread by the hash of their flow, so all packets of a flow (in both directions) are captured by the same thread */
+			FanoutHash,
+			/** Packets are spread round-robin between the threads */
+			FanoutLoadBalance,
+			/** Packets are spread by the CPU that received them from the NIC, so a thread pinned to a core gets the packets of the NIC queues
+			 * that are handled by this core */
+			FanoutCpu
+		};
+
+
+		/**
+		 * @struct FanoutConfiguration
+		 * A struct that contains user configurable parameters for a multi-threaded capture, see startCaptureMultiThread()
+		 */
+		struct FanoutConfiguration
+		{
+			/** The way packets are spread between the capture threads */
+			FanoutMode mode;
+
+			/**
+			 * The fanout group ID. All descriptors that join the same group on the same interface share its traffic, so two captures
+			 * running at the same time (in the same or different processes) must use different IDs. A value of 0 means a group ID is
+			 * picked based on the process ID
+			 */
+			uint16_t groupId;
+
+			/**
+			 * If set to true IP fragments are reassembled by the kernel before choosing a thread, so all fragments of a packet reach the
+			 * same thread in FanoutHash mode
+			 */
+			bool defragment;
+
+			/**
+			 * A c'tor for this struct
+			 * @param[in] mode The way packets are spread between the capture threads. Default value is FanoutHash
+			 * @param[in] groupId The fanout group ID. Default value is 0 which means a group ID is picked automatically
+			 * @param[in] defragment Whether to reassemble IP fragments before choosing a thread. Default value is true
+			 */
+			FanoutConfiguration(FanoutMode mode = FanoutHash, uint16_t groupId = 0, bool defragment = true)
+			{
+				this->mode = mode;
+				this->groupId = groupId;
+				this->defragment = defragment;
+			}
+		};
+
+
 		/**
 		 * A destructor for this class
 		 */
@@ -395,8 +479,62 @@ namespace pcpp
 		virtual int startCaptureBlockingMode(OnPacketArrivesStopBlocking onPacketArrives, void* userCookie, int timeout);
 
 		/**
-		 * Stop a currently running packet capture. This method terminates gracefully both packet capture thread and periodic stats collection
-		 * thread (both if exist)
+		 * Start capturing packets on this network interface (device) in burst mode. Instead of calling a callback per packet, the packets
+		 * libpcap returns from each read of the capture buffer (up to maxBurstSize packets) are collected and delivered in one call to
+		 * onPacketBurstArrives, so the per-packet callback overhead is saved and work can be amortized over a burst. The packet array and a
+		 * buffer for maxBurstSize packets of snapshot length are allocated once when capture starts and reused for every burst, so the
+		 * capture loop doesn't allocate memory: each packet is copied once into the buffer and the RawPacket instances only point to it.
+		 * The capture is done on a new thread created by this method, meaning all callback calls are done in a thread other than the caller
+		 * thread. Capture process will stop and this capture thread will be terminated when calling stopCapture(). This method must be called
+		 * after the device is opened (i.e the open() method was called), otherwise an error will be returned
+		 * @param[in] onPacketBurstArrives A callback that is called with each burst of captured packets. The packets are valid only until the
+		 * callback returns
+		 * @param[in] onPacketBurstArrivesUserCookie A pointer to a user provided object. This object will be transferred to the
+		 * onPacketBurstArrives callback each time it is called
+		 * @param[in] maxBurstSize The maximum number of packets in a burst. Default value is 64
+		 * @param[in] packetArray An optional array of at least maxBurstSize RawPacket instances to use for the bursts instead of an array
+		 * allocated by the device, so an application can keep the same array across captures. The data these instances own is freed when
+		 * capture starts, and they are cleared when capture stops. Default value is NULL which means the device allocates the array
+		 * @return True if capture started successfully, false if (relevant log error is printed in any case):
+		 * - Capture is already running
+		 * - Device is not opened
+		 * - maxBurstSize is 0
+		 * - Capture thread could not be created
+		 */
+		virtual bool startCaptureBurstMode(OnPacketBurstArrivesCallback onPacketBurstArrives, void* onPacketBurstArrivesUserCookie,
+			size_t maxBurstSize = 64, RawPacket* packetArray = NULL);
+
+		/**
+		 * Start capturing packets on this network interface (device) on several threads. This method opens one more descriptor of the interface
+		 * per thread (with the same configuration the device was opened with), joins all of them into a Linux PACKET_FANOUT group so the
+		 * kernel spreads the traffic between them, and starts a capture thread per descriptor. Each captured packet is delivered to exactly one
+		 * thread, which calls onPacketArrives with its own user cookie, so threads don't need to share state. Capture process will stop and
+		 * the threads will be terminated when calling stopCapture(). This method must be called after the device is opened (i.e the open()
+		 * method was called), otherwise an error will be returned. While capturing, getStatistics() returns the sum of the stats of all
+		 * threads. The filter set on the device (before or during the capture) applies to all threads, and the device's own descriptor
+		 * receives no packets until the capture is stopped.<BR>
+		 * Please notice this capture mode is only supported on Linux
+		 * @param[in] onPacketArrives A callback that is called each time a packet is captured. It is called concurrently from all capture
+		 * threads
+		 * @param[in] onPacketArrivesUserCookies One user provided object per capture thread, which also sets the number of capture threads.
+		 * Each thread transfers its own object to the onPacketArrives callback each time it is called
+		 * @param[in] coreMask The cores to pin the capture threads to. Thread i is pinned to the i-th core in the mask (wrapping around if
+		 * there are more threads than cores). Default value is 0 which means the threads aren't pinned
+		 * @param[in] config The fanout configuration. Default value is a FanoutConfiguration with its default values
+		 * @return True if capture started successfully, false if (relevant log error is printed in any case):
+		 * - Capture is already running
+		 * - Device is not opened
+		 * - No user cookies were given
+		 * - The platform doesn't support PACKET_FANOUT
+		 * - One of the descriptors couldn't be opened, couldn't be set with the device filter or couldn't join the fanout group
+		 * - One of the capture threads could not be created
+		 */
+		virtual bool startCaptureMultiThread(OnPacketArrivesCallback onPacketArrives, const std::vector<void*>& onPacketArrivesUserCookies,
+			CoreMask coreMask = 0, const FanoutConfiguration& config = FanoutConfiguration());
+
+		/**
+		 * Stop a currently running packet capture. This method terminates gracefully both packet capture thread (or threads, if capture was
+		 * started with startCaptureMultiThread()) and periodic stats collection thread (both if exist)
 		 */
 		void stopCapture();
 
@@ -503,7 +641,23 @@ namespace pcpp
 
 		virtual void getStatistics(IPcapDevice::PcapStats& stats) const;
 
+		using IPcapDevice::setFilter;
+
+		/**
+		 * Set a filter for the device. Same as IPcapDevice#setFilter(), and during a capture started with startCaptureMultiThread() the
+		 * filter is set on the descriptors of all capture threads
+		 * @param[in] filterAsString The filter to be set in Berkeley Packet Filter (BPF) syntax (http://biot.com/capstats/bpf.html)
+		 * @return True if filter set successfully, false otherwise
+		 */
+		virtual bool setFilter(std::string filterAsString);
+
 	protected:
+		// the configuration the device was opened with, used for opening the descriptors of a multi-threaded capture
+		DeviceConfiguration m_DeviceConfig;
+		std::vector<FanoutCaptureThread*> m_FanoutThreads;
+		// the last filter set on the device, set on the descriptors of a multi-threaded capture when they're opened
+		std::string m_CurrentFilter;
+
 		pcap_t* doOpen(const DeviceConfiguration& config);
 	};
 
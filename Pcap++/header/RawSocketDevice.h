@@ -36,6 +36,11 @@ namespace pcpp
 	 * Raw sockets are supported for both IPv4 and IPv6, so you can create and bind raw sockets to each of the two.
 	 * Also, there is no limit on the number of sockets opened for a specific IP address or network interface, so you can
 	 * create multiple instances of this class and bind all of them to the same interface and IP address.
+	 *
+	 * On Linux the device can be opened in one of several I/O modes (see IOMode and open(const DeviceConfiguration&)). The default
+	 * mode uses one system call per packet. In batch mode packets are received and sent with recvmmsg() / sendmmsg(), and in ring
+	 * mode they're received from a TPACKET_V3 ring shared with the kernel and sent through a send ring, which is the fastest way
+	 * to capture with AF_PACKET sockets. receivePacketBurst() gives zero-copy access to received packets in these modes.
 	 */
 	class RawSocketDevice : public IDevice
 	{
@@ -56,6 +61,83 @@ namespace pcpp
 			RecvError = 3
 		};
 
+		/**
+		 * An enum for choosing how packets are moved between the raw socket and the user
+		 */
+		enum IOMode
+		{
+			/** One system call per received or sent packet. This is the default mode and the only one supported on Windows */
+			SocketIO = 0,
+			/** Packets are received and sent in batches with a single recvmmsg() / sendmmsg() call per batch. Supported on Linux only */
+			BatchIO = 1,
+			/**
+			 * Packets are received from a TPACKET_V3 memory-mapped ring (PACKET_RX_RING) and sent through a memory-mapped ring
+			 * (PACKET_TX_RING) shared with the kernel, so receiving packets doesn't require system calls or copying. Supported on
+			 * Linux only
+			 */
+			RingIO = 2
+		};
+
+		/**
+		 * @struct DeviceConfiguration
+		 * A struct that contains user configurable parameters for opening a raw socket. All parameters have default values so
+		 * the user isn't expected to set all parameters or understand exactly how they work
+		 */
+		struct DeviceConfiguration
+		{
+			/** The way packets are received and sent. The default is RawSocketDevice#SocketIO */
+			IOMode ioMode;
+
+			/** In RawSocketDevice#BatchIO mode - the maximum number of packets received or sent in a single system call */
+			uint32_t batchSize;
+
+			/**
+			 * In RawSocketDevice#RingIO mode - the size in bytes of each block of the receive ring. The kernel fills a block with
+			 * packets and hands it to the user when it's full or when ringBlockTimeoutMs expires. It must be a multiple of the page size
+			 */
+			uint32_t ringBlockSize;
+
+			/** In RawSocketDevice#RingIO mode - the number of blocks in the receive ring */
+			uint32_t ringNumOfBlocks;
+
+			/**
+			 * In RawSocketDevice#RingIO mode - the time in milliseconds after which the kernel hands a block that isn't full to the user.
+			 * Lower values lower the latency, higher values lower the overhead. A value of 0 lets the kernel choose
+			 */
+			uint32_t ringBlockTimeoutMs;
+
+			/**
+			 * In RawSocketDevice#RingIO mode - the size in bytes of each frame in the send ring. Packets which don't fit in a frame
+			 * are sent with a regular system call
+			 */
+			uint32_t ringFrameSize;
+
+			/** In RawSocketDevice#RingIO mode - the number of frames in the send ring. A value of 0 means no send ring is created */
+			uint32_t ringNumOfTxFrames;
+
+			/**
+			 * A c'tor for this struct
+			 * @param[in] ioMode The way packets are received and sent. Default value is RawSocketDevice#SocketIO
+			 * @param[in] batchSize The number of packets in a batch in RawSocketDevice#BatchIO mode. Default value is 32
+			 * @param[in] ringBlockSize The size of a receive ring block in RawSocketDevice#RingIO mode. Default value is 1MB
+			 * @param[in] ringNumOfBlocks The number of receive ring blocks in RawSocketDevice#RingIO mode. Default value is 32
+			 * @param[in] ringBlockTimeoutMs The receive ring block timeout in RawSocketDevice#RingIO mode. Default value is 10ms
+			 * @param[in] ringFrameSize The send ring frame size in RawSocketDevice#RingIO mode. Default value is 2048
+			 * @param[in] ringNumOfTxFrames The number of send ring frames in RawSocketDevice#RingIO mode. Default value is 1024
+			 */
+			DeviceConfiguration(IOMode ioMode = SocketIO, uint32_t batchSize = 32, uint32_t ringBlockSize = 1024 * 1024,
+				uint32_t ringNumOfBlocks = 32, uint32_t ringBlockTimeoutMs = 10, uint32_t ringFrameSize = 2048, uint32_t ringNumOfTxFrames = 1024)
+			{
+				this->ioMode = ioMode;
+				this->batchSize = batchSize;
+				this->ringBlockSize = ringBlockSize;
+				this->ringNumOfBlocks = ringNumOfBlocks;
+				this->ringBlockTimeoutMs = ringBlockTimeoutMs;
+				this->ringFrameSize = ringFrameSize;
+				this->ringNumOfTxFrames = ringNumOfTxFrames;
+			}
+		};
+
 		/*
 		 * A c'tor for this class. This c'tor doesn't create the raw socket, but rather initializes internal structures. The actual
 		 * raw socket creation is done in the open() method. Each raw socket is bound to a network interface which means
@@ -108,6 +190,25 @@ namespace pcpp
 		 */
 		int receivePackets(RawPacketVector& packetVec, int timeout, int& failedRecv);
 
+		/**
+		 * Receive a burst of packets into an array of RawPacket objects. The method waits for packets like receivePacket() does and
+		 * then returns all packets that are already waiting, up to the array length. How the packet data is stored depends on the I/O
+		 * mode the device was opened with:
+		 *  - In RawSocketDevice#RingIO mode the packets point directly into the receive ring, and in RawSocketDevice#BatchIO
+		 *    mode they point into buffers owned by the device. No data is copied, but the data is valid only until the next call to
+		 *    a receive method or to close(). Packets the user wants to keep should be copied (for example with RawPacket's copy c'tor)
+		 *  - In RawSocketDevice#SocketIO mode packets are received one by one and own their data
+		 *
+		 * @param[out] rawPacketsArr An array of RawPacket objects the received packets will be written to
+		 * @param[in] arrLength The length of the array
+		 * @param[in] blocking Indicates whether to wait for packets if none are waiting. Default value is blocking
+		 * @param[in] timeout When in blocking mode, specifies the timeout [in seconds] to wait for packets. Zero or negative values
+		 * mean no timeout. The default value is no timeout
+		 * @return The number of packets received. 0 is returned if the timeout expired, if no packets were waiting in non-blocking
+		 * mode, or if an error occurred (an error will be printed to log)
+		 */
+		int receivePacketBurst(RawPacket* rawPacketsArr, int arrLength, bool blocking = true, int timeout = -1);
+
 		/**
 		 * Send an Ethernet packet to the network. L2 protocols other than Ethernet are not supported in raw sockets.
 		 * The entire packet is sent as is, including the original Ethernet and IP data.
@@ -130,6 +231,18 @@ namespace pcpp
 		 */
 		int sendPackets(const RawPacketVector& packetVec);
 
+		/**
+		 * Send an array of Ethernet packets to the network. This method is the same as sendPackets(const RawPacketVector&), it's
+		 * useful for sending packets received with receivePacketBurst() without copying them.
+		 * In RawSocketDevice#BatchIO mode packets are sent with sendmmsg(), and in RawSocketDevice#RingIO mode they're copied to
+		 * the send ring and sent with a single system call
+		 * @param[in] rawPacketsArr The array of packets to send
+		 * @param[in] arrLength The length of the array
+		 * @return The number of packets sent successfully. For packets that weren't sent successfully there will be a
+		 * corresponding error message printed to log
+		 */
+		int sendPackets(const RawPacket* rawPacketsArr, int arrLength);
+
 		// overridden methods
 
 		/**
@@ -138,6 +251,19 @@ namespace pcpp
 		 */
 		virtual bool open();
 
+		/**
+		 * Same as open(), but also sets the way packets are received and sent. Modes other than RawSocketDevice#SocketIO are
+		 * supported on Linux only
+		 * @param[in] config The configuration to use. See DeviceConfiguration
+		 * @return True if device was opened successfully, false otherwise with a corresponding error log message
+		 */
+		bool open(const DeviceConfiguration& config);
+
+		/**
+		 * @return The I/O mode the device was opened with, or the mode it will be opened with if it's not open
+		 */
+		IOMode getIOMode() const { return m_Config.ioMode; }
+
 		/**
 		 * Close the raw socket
 		 */
@@ -155,8 +281,11 @@ namespace pcpp
 		SocketFamily m_SockFamily;
 		void* m_Socket;
 		IPAddress m_InterfaceIP;
+		DeviceConfiguration m_Config;
 
 		RecvPacketResult getError(int& errorCode) const;
+		RecvPacketResult receivePacketBurstInternal(RawPacket* rawPacketsArr, int arrLength, bool blocking, int timeout, int& numOfPackets);
+		int sendPacketsInternal(const RawPacket* const* rawPackets, int numOfPackets);
 
 	};
 }
@@ -0,0 +1,191 @@
+#ifndef PCAPPP_ROTATING_FILE_WRITER_DEVICE
+#define PCAPPP_ROTATING_FILE_WRITER_DEVICE
+
+#include <string>
+#include <deque>
+#include <pthread.h>
+#include "PcapFileDevice.h"
+
+/// @file
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	/**
+	 * @class RotatingFileWriterDevice
+	 * A file writer device for continuous recording that writes packets into a rotating set of pcap or pcap-ng files, like a ring buffer.
+	 * The device rolls over to a new file when the current file reaches a maximum size, duration or packet count, and when more than the
+	 * maximum number of files were written the oldest file is deleted.
+	 * The files are named after the file name given in the c'tor with a running index before the extension, for example "capture.pcap"
+	 * is written as "capture-0000.pcap", "capture-0001.pcap" and so on.
+	 * Rotating doesn't stall the writing thread: a background thread creates and opens the next file ahead of time, so a rotation is only
+	 * a switch between two opened writers, and the rotated file is flushed, synced to disk, closed (and the oldest file is deleted) on the
+	 * background thread. Because of that the next file may exist (empty) before it's written to
+	 */
+	class RotatingFileWriterDevice : public IFileWriterDevice
+	{
+	public:
+
+		/**
+		 * @struct RotationConfig
+		 * When to roll over to the next file and how many files to keep. A limit set to 0 is not used
+		 */
+		struct RotationConfig
+		{
+			/** Roll over before a packet that would make the file larger than this number of bytes. The default is 0 */
+			uint64_t maxFileSize;
+			/** Roll over before a packet whose timestamp is this number of seconds or more after the first packet in the file. The default is 0 */
+			uint32_t maxFileDuration;
+			/** Roll over after this number of packets. The default is 0 */
+			uint32_t maxPacketsPerFile;
+			/** Keep at most this number of files with packets, deleting the oldest ones. The default is 0 (keep all files) */
+			uint32_t maxNumOfFiles;
+			/** If set to true pcap-ng files are written, otherwise pcap files. The default is false */
+			bool isPcapNg;
+			/** The compression level of pcap-ng files, see PcapNgFileWriterDevice. The default is 0 (no compression) */
+			int compressionLevel;
+
+			RotationConfig() : maxFileSize(0), maxFileDuration(0), maxPacketsPerFile(0), maxNumOfFiles(0), isPcapNg(false), compressionLevel(0) {}
+		};
+
+	private:
+		/**
+		 * A file written by this device
+		 */
+		struct RotatedFile
+		{
+			IFileWriterDevice* writer;
+			std::string fileName;
+		};
+
+		LinkLayerType m_PcapLinkLayerType;
+		RotationConfig m_Config;
+		std::string m_FileNamePrefix;
+		std::string m_FileNameExtension;
+
+		// the file being written, used only by the writing thread
+		RotatedFile m_CurFile;
+		uint64_t m_CurFileSize;
+		uint32_t m_CurFilePackets;
+		time_t m_CurFileStartTime;
+		uint64_t m_NumOfRotations;
+		uint64_t m_NumOfRotationStalls;
+
+		// the fields below are shared with the background thread and protected by m_Mutex
+		pthread_t m_BackgroundThread;
+		bool m_BackgroundThreadStarted;
+		pthread_mutex_t m_Mutex;
+		pthread_cond_t m_WorkCond;
+		pthread_cond_t m_NextFileReadyCond;
+		// the next file, opened ahead of time. Its writer is NULL if opening it failed
+		RotatedFile m_NextFile;
+		bool m_NextFileReady;
+		uint32_t m_NextFileIndex;
+		std::deque<RotatedFile> m_FilesToClose;
+		// names of the rotated files that weren't deleted (including files of previous runs), oldest first. Used only by the background
+		// thread once the device is opened
+		std::deque<std::string> m_KeptFiles;
+		bool m_Stopping;
+
+		// private copy c'tor
+		RotatingFileWriterDevice(const RotatingFileWriterDevice& other);
+		RotatingFileWriterDevice& operator=(const RotatingFileWriterDevice& other);
+
+		RotatedFile openFile(uint32_t fileIndex);
+		void closeFile(RotatedFile& file, bool deleteFile);
+		bool shouldRotate(RawPacket const& packet, uint64_t recordSize) const;
+		bool rotate();
+		void backgroundThreadLoop();
+		static void* backgroundThreadMain(void* device);
+
+	public:
+		/**
+		 * A constructor for this class. Notice that after calling this constructor no file is created yet, so writing packets will fail.
+		 * For creating the first file call open()
+		 * @param[in] fileName The full path of the files, the file index is added before the extension
+		 * @param[in] linkLayerType The link layer type all packet in the files will be based on (used for pcap files only). The default is Ethernet
+		 * @param[in] config When to roll over to the next file and how many files to keep. The default is to write a single file
+		 */
+		RotatingFileWriterDevice(const char* fileName, LinkLayerType linkLayerType = LINKTYPE_ETHERNET, const RotationConfig& config = RotationConfig());
+
+		/**
+		 * A destructor for this class. Closes the files if the device is still opened
+		 */
+		~RotatingFileWriterDevice();
+
+		/**
+		 * Write a RawPacket to the current file, rolling over to the next file first if the packet doesn't fit in the current file.
+		 * Before using this method please verify the device is opened using open(). This method won't change the written packet
+		 * @param[in] packet A reference for an existing RawPcket to write to the file
+		 * @return True if a packet was written successfully. False will be returned if the device isn't opened, if the next file couldn't
+		 * be opened or if the current file writer failed to write the packet (an error will be printed to log)
+		 */
+		bool writePacket(RawPacket const& packet);
+
+		/**
+		 * Write multiple RawPacket to the files. Before using this method please verify the device is opened using open(). This method won't
+		 * change the written packets or the RawPacketVector instance
+		 * @param[in] packets A reference for an existing RawPcketVector, all of its packets will be written to the files
+		 * @return True if all packets were written successfully. False will be returned if the device isn't opened (also, an error log will
+		 * be printed) or if at least one of the packets wasn't written successfully
+		 */
+		bool writePackets(const RawPacketVector& packets);
+
+		/**
+		 * @return The full path of the file currently written, or an empty string if the device isn't opened
+		 */
+		std::string getCurrentFileName() const { return m_CurFile.fileName; }
+
+		/**
+		 * @return The number of times the device rolled over to the next file since it was opened
+		 */
+		uint64_t getNumOfRotations() const { return m_NumOfRotations; }
+
+		/**
+		 * @return The number of rotations in which the writing thread had to wait for the background thread to open the next file.
+		 * Rotations that are too frequent for the background thread make this number grow
+		 */
+		uint64_t getNumOfRotationStalls() const { return m_NumOfRotationStalls; }
+
+		//override methods
+
+		/**
+		 * Create and open the first file and start the background thread. Files left by a previous run of a device with the same file name
+		 * are treated as the oldest files: the file index continues after the highest existing index, and they count towards
+		 * RotationConfig#maxNumOfFiles so they're the first files to be deleted
+		 * @return True if the first file was opened successfully or if the device is already opened. False if opening the file failed for
+		 * some reason (an error will be printed to log)
+		 */
+		bool open();
+
+		/**
+		 * Same as open(). Append mode isn't supported by this device
+		 * @param[in] appendMode If set to true an error is printed to log and false is returned
+		 * @return See open()
+		 */
+		bool open(bool appendMode);
+
+		/**
+		 * Flush the packets written to the current file
+		 */
+		void flush();
+
+		/**
+		 * Close the current file, wait for the background thread to close the rotated files and delete the file that was opened ahead of time
+		 */
+		void close();
+
+		/**
+		 * Get statistics of packets written so far to all files
+		 * @param[out] stats The stats struct where stats are returned
+		 */
+		void getStatistics(PcapStats& stats) const;
+	};
+
+} // namespace pcpp
+
+#endif // PCAPPP_ROTATING_FILE_WRITER_DEVICE
@@ -0,0 +1,171 @@
+#ifndef PCAPPP_SHARDED_TCP_REASSEMBLY
+#define PCAPPP_SHARDED_TCP_REASSEMBLY
+
+#include <vector>
+#include <pthread.h>
+#include "TcpReassembly.h"
+#include "SystemUtils.h"
+
+/// @file
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	/**
+	 * @class ShardedTcpReassembly
+	 * A multi-threaded front-end for TcpReassembly. It owns a number of TcpReassembly instances (shards), each of them used by a dedicated
+	 * worker thread. Packets fed by the user are distributed to shards by their direction-agnostic 5-tuple hash (see hash5Tuple()), so both
+	 * sides of a connection always reach the same shard. The hash is also the connection's flow key (see ConnectionData#flowKey), so the
+	 * shard of a connection is always flowKey % (number of shards).
+	 * Packets are copied into a lock-free single-producer single-consumer ring (SPSCRing) per shard, which means reassemblePacket(), closeConnection()
+	 * and closeAllConnections() must all be called from the same thread. All user callbacks are invoked on the worker thread of the shard
+	 * that owns the connection, so callbacks of different connections may run concurrently. getCurrentShardId() can be used inside
+	 * callbacks to keep per-shard state without locking.
+	 * The ring slots keep their packet buffers between packets, so after warm-up feeding packets doesn't allocate memory
+	 */
+	class ShardedTcpReassembly
+	{
+	private:
+		struct Shard;
+
+		TcpReassembly::OnTcpMessageReady m_OnMessageReadyCallback;
+		TcpReassembly::OnTcpConnectionStart m_OnConnStart;
+		TcpReassembly::OnTcpConnectionEnd m_OnConnEnd;
+		void* m_UserCookie;
+		TcpReassemblyConfiguration m_Config;
+		uint16_t m_NumOfShards;
+		uint32_t m_RingSize;
+		std::vector<Shard*> m_Shards;
+		bool m_Running;
+		bool m_DropWhenFull;
+		volatile uint32_t m_StopRequested;
+		uint64_t m_NumOfDroppedPackets;
+
+		// private copy c'tor
+		ShardedTcpReassembly(const ShardedTcpReassembly& other);
+		ShardedTcpReassembly& operator=(const ShardedTcpReassembly& other);
+
+		bool pushToShard(Shard* shard, const RawPacket* rawPacket, int command, uint32_t flowKey);
+		static void* workerThreadMain(void* ptr);
+
+	public:
+		/**
+		 * The default number of packets each shard's ring can hold
+		 */
+		static const uint32_t DefaultRingSize = 4096;
+
+		/**
+		 * A constructor for this class. The callbacks, the cookie and the configuration are the same as in TcpReassembly's c'tor and are used
+		 * by all shards
+		 * @param[in] onMessageReadyCallback The callback to be invoked when new data arrives
+		 * @param[in] userCookie A pointer to an object provided by the user which is passed to all callbacks. This parameter is optional, default cookie is NULL
+		 * @param[in] onConnectionStartCallback The callback to be invoked when a new connection is identified. This parameter is optional
+		 * @param[in] onConnectionEndCallback The callback to be invoked when a connection is terminated. This parameter is optional
+		 * @param[in] config Optional parameter for defining special configuration parameters for each shard. Notice limits such as
+		 * TcpReassemblyConfiguration#maxNumOfConnections and TcpReassemblyConfiguration#maxMemoryUsage apply to each shard separately
+		 * @param[in] numOfShards The number of shards (and worker threads). If set to 0 (the default) the number of cores in the machine is used
+		 * @param[in] ringSize The number of packets each shard's ring can hold. It's rounded up to a power of 2. The default is DefaultRingSize
+		 */
+		ShardedTcpReassembly(TcpReassembly::OnTcpMessageReady onMessageReadyCallback, void* userCookie = NULL,
+			TcpReassembly::OnTcpConnectionStart onConnectionStartCallback = NULL, TcpReassembly::OnTcpConnectionEnd onConnectionEndCallback = NULL,
+			const TcpReassemblyConfiguration& config = TcpReassemblyConfiguration(), uint16_t numOfShards = 0, uint32_t ringSize = DefaultRingSize);
+
+		/**
+		 * A destructor for this class. Stops the worker threads if they're still running (see stop()) and frees all shards
+		 */
+		~ShardedTcpReassembly();
+
+		/**
+		 * Start the worker threads of all shards
+		 * @param[in] coreMask An optional core mask. If it's not 0 the worker thread of shard i is pinned to the i-th core in the mask (cores
+		 * are reused if there are more shards than cores). Pinning is supported on Linux only and ignored on other platforms
+		 * @return True if all worker threads were started, false if they're already running or a thread couldn't be created (an error will
+		 * be printed to log)
+		 */
+		bool start(CoreMask coreMask = 0);
+
+		/**
+		 * Wait until all packets queued so far were processed and stop the worker threads. Connections stay open, so after stop() the user
+		 * may call closeAllConnections() (which then runs on the calling thread) or query the shards through getShard()
+		 */
+		void stop();
+
+		/**
+		 * @return True if the worker threads are running, false otherwise
+		 */
+		bool isRunning() const { return m_Running; }
+
+		/**
+		 * Queue a packet to the shard that owns its connection. The packet data is copied so the raw packet can be reused as soon as this
+		 * method returns
+		 * @param[in] tcpRawData A pointer to the raw packet to process
+		 * @return True if the packet was queued. False if it isn't a TCP packet, if the worker threads aren't running (an error will be printed
+		 * to log) or if the shard's ring was full and dropping is enabled (see setDropWhenFull())
+		 */
+		bool reassemblePacket(RawPacket* tcpRawData);
+
+		/**
+		 * Same as reassemblePacket(RawPacket*), but uses a packet the user already parsed (it must be parsed at least up to the transport layer)
+		 * @param[in] tcpData A reference to the packet to process
+		 * @return True if the packet was queued, false otherwise. See reassemblePacket(RawPacket*)
+		 */
+		bool reassemblePacket(Packet& tcpData);
+
+		/**
+		 * Close a connection manually. If the worker threads are running the request is queued to the shard that owns the connection and the
+		 * TcpReassembly#OnTcpConnectionEnd callback is invoked on its worker thread, otherwise the connection is closed on the calling thread
+		 * @param[in] flowKey A 4-byte hash key representing the connection
+		 */
+		void closeConnection(uint32_t flowKey);
+
+		/**
+		 * Close all open connections of all shards manually. If the worker threads are running the request is queued to every shard,
+		 * otherwise the connections are closed on the calling thread
+		 */
+		void closeAllConnections();
+
+		/**
+		 * @return The number of shards
+		 */
+		uint16_t getNumOfShards() const { return m_NumOfShards; }
+
+		/**
+		 * @param[in] flowKey A 4-byte hash key representing a connection
+		 * @return The ID of the shard that owns the connection
+		 */
+		uint16_t getShardIdForFlowKey(uint32_t flowKey) const { return (uint16_t)(flowKey % m_NumOfShards); }
+
+		/**
+		 * Get the TcpReassembly instance of a shard. It's not thread-safe to use it while the worker threads are running
+		 * @param[in] shardId The shard ID, a value between 0 and the number of shards - 1
+		 * @return A pointer to the shard's TcpReassembly instance or NULL if the shard ID is out of range
+		 */
+		TcpReassembly* getShard(uint16_t shardId) const;
+
+		/**
+		 * @return The ID of the shard whose worker thread calls this method (for example from inside a callback), or -1 if it's called
+		 * from a thread which isn't a worker thread of a ShardedTcpReassembly
+		 */
+		static int getCurrentShardId();
+
+		/**
+		 * Set the behavior when a packet is fed while the shard's ring is full. By default reassemblePacket() waits until the worker frees
+		 * a slot, which is right for processing files. When capturing live traffic it's usually better to drop the packet and not delay
+		 * the capture thread
+		 * @param[in] dropWhenFull True to drop packets when the ring is full, false to wait
+		 */
+		void setDropWhenFull(bool dropWhenFull) { m_DropWhenFull = dropWhenFull; }
+
+		/**
+		 * @return The number of packets dropped because a shard's ring was full
+		 */
+		uint64_t getNumOfDroppedPackets() const { return m_NumOfDroppedPackets; }
+	};
+
+} // namespace pcpp
+
+#endif // PCAPPP_SHARDED_TCP_REASSEMBLY
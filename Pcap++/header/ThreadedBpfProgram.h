@@ -0,0 +1,101 @@
+#ifndef PCAPPP_THREADED_BPF_PROGRAM
+#define PCAPPP_THREADED_BPF_PROGRAM
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+//Forward Declaration - defined in pcap.h
+struct bpf_insn;
+struct bpf_program;
+
+/// @file
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	/**
+	 * @class ThreadedBpfProgram
+	 * A faster replacement for libpcap's BPF interpreter (pcap_offline_filter()). A compiled BPF program is translated once into a
+	 * pre-decoded form: each instruction gets a dense opcode of its own (so there's no decoding of class/size/mode bits per packet),
+	 * relative jump offsets are resolved into absolute instruction indices, and common instruction pairs such as "load half-word, jump if
+	 * equal" are fused into a single instruction. When compiled with GCC or Clang the instructions are dispatched with computed gotos
+	 * (threaded code), otherwise a switch statement is used.<BR>
+	 * run() returns exactly the same value as libpcap's interpreter for every packet, including truncated packets. Programs that libpcap
+	 * would run into undefined behavior with (division by a constant 0, shifts by 32 or more, out-of-range jumps or scratch memory
+	 * indices, falling off the end of the program) and unknown opcodes are rejected by compile(), in which case the caller should keep
+	 * using libpcap's interpreter
+	 */
+	class ThreadedBpfProgram
+	{
+	public:
+		/**
+		 * A c'tor for this class. Creates an empty program
+		 */
+		ThreadedBpfProgram() : m_UsesScratchMemory(false) {}
+
+		/**
+		 * Translate a BPF program compiled by libpcap (for example by pcap_compile_nopcap()). The program stays valid even if the
+		 * bpf_program object is freed afterwards. If the translation fails the previous program is cleared
+		 * @param[in] program The BPF program to translate
+		 * @return True if the program was translated, false if it's empty or contains an instruction that isn't supported (an error
+		 * will be printed to log in debug mode)
+		 */
+		bool compile(const bpf_program* program);
+
+		/**
+		 * Translate an array of BPF instructions. See compile(const bpf_program*)
+		 * @param[in] instructions A pointer to the first instruction
+		 * @param[in] numOfInstructions The number of instructions in the array
+		 * @return True if the program was translated, false otherwise
+		 */
+		bool compile(const bpf_insn* instructions, uint32_t numOfInstructions);
+
+		/**
+		 * Clear the program
+		 */
+		void clear();
+
+		/**
+		 * @return True if no program was successfully translated, false otherwise
+		 */
+		bool isEmpty() const { return m_Instructions.empty(); }
+
+		/**
+		 * @return The number of instructions of the translated program (fused instructions count as one)
+		 */
+		size_t getNumOfInstructions() const { return m_Instructions.size(); }
+
+		/**
+		 * Run the program on a packet. This method doesn't change the object so it can be called from several threads concurrently
+		 * @param[in] packetData A pointer to the packet data
+		 * @param[in] wireLength The original length of the packet on the wire, which is what "len" in the filter refers to
+		 * @param[in] captureLength The number of bytes available in packetData
+		 * @return The program's return value, which is the same value pcap_offline_filter() returns (0 means the packet doesn't match).
+		 * If the program is empty 0 is returned
+		 */
+		uint32_t run(const uint8_t* packetData, uint32_t wireLength, uint32_t captureLength) const;
+
+	private:
+		struct Instruction
+		{
+			uint32_t op;
+			uint32_t k;
+			// the compared value of fused load-and-compare instructions
+			uint32_t k2;
+			// absolute instruction indices
+			uint32_t jt;
+			uint32_t jf;
+		};
+
+		std::vector<Instruction> m_Instructions;
+		bool m_UsesScratchMemory;
+	};
+
+} // namespace pcpp
+
+#endif // PCAPPP_THREADED_BPF_PROGRAM
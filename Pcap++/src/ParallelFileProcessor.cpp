@@ -0,0 +1,296 @@
+#define LOG_MODULE PcapLogModuleFileDevice
+
+#include "ParallelFileProcessor.h"
+#include "Packet.h"
+#include "PacketUtils.h"
+#include "SystemUtils.h"
+#include "Logger.h"
+
+#define PARALLEL_FILE_PROCESSOR_BURST_SIZE 64
+
+namespace pcpp
+{
+
+ParallelFileProcessor::ParallelFileProcessor(const std::string& fileName, uint16_t numOfWorkers) : m_FileName(fileName)
+{
+	if (numOfWorkers == 0)
+	{
+		int numOfCores = getNumOfCores();
+		numOfWorkers = (uint16_t)(numOfCores > 0 ? numOfCores : 1);
+	}
+
+	m_NumOfWorkers = numOfWorkers;
+	m_ChunkSize = DefaultChunkSize;
+	m_FlowAffinity = false;
+	m_OnPacketsArrive = NULL;
+	m_OnPacketsArriveUserCookie = NULL;
+	m_NextChunk = 0;
+	m_RoundStartChunk = 0;
+	m_RoundEndChunk = 0;
+	m_NumOfPacketsProcessed = 0;
+	pthread_mutex_init(&m_NextChunkMutex, NULL);
+}
+
+ParallelFileProcessor::~ParallelFileProcessor()
+{
+	pthread_mutex_destroy(&m_NextChunkMutex);
+}
+
+bool ParallelFileProcessor::indexFile(MmapPcapFileReaderDevice& indexer)
+{
+	m_Chunks.clear();
+
+	FileChunk chunk;
+	chunk.startOffset = indexer.m_ReadOffset;
+	chunk.swapBytes = indexer.m_SwapBytes;
+	chunk.pcapNgInterfaces = indexer.m_PcapNgInterfaces;
+
+	const uint8_t* packetData;
+	uint32_t capturedLength, frameLength;
+	timespec timestamp;
+	LinkLayerType linkType;
+
+	// only record headers are walked here, packet data isn't touched
+	while (true)
+	{
+		uint64_t recordOffset = indexer.m_ReadOffset;
+		if (recordOffset - chunk.startOffset >= m_ChunkSize)
+		{
+			// the reader state (byte order, pcap-ng interfaces) is saved so a worker can start reading right at this record
+			chunk.endOffset = recordOffset;
+			m_Chunks.push_back(chunk);
+			chunk.startOffset = recordOffset;
+			chunk.swapBytes = indexer.m_SwapBytes;
+			chunk.pcapNgInterfaces = indexer.m_PcapNgInterfaces;
+		}
+
+		if (!indexer.getNextRecord(packetData, capturedLength, frameLength, timestamp, linkType))
+			break;
+	}
+
+	chunk.endOffset = indexer.m_MappedFileLength;
+	m_Chunks.push_back(chunk);
+
+	LOG_DEBUG("File '%s' was split into %d chunks", m_FileName.c_str(), (int)m_Chunks.size());
+	return true;
+}
+
+void ParallelFileProcessor::seekToChunk(MmapPcapFileReaderDevice& reader, const FileChunk& chunk) const
+{
+	reader.m_ReadOffset = chunk.startOffset;
+	reader.m_ReadEndOffset = chunk.endOffset;
+	reader.m_SwapBytes = chunk.swapBytes;
+	reader.m_PcapNgInterfaces = chunk.pcapNgInterfaces;
+}
+
+bool ParallelFileProcessor::takeNextChunk(size_t& chunkIndex)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&m_NextChunkMutex);
+	if (m_NextChunk < m_RoundEndChunk)
+	{
+		chunkIndex = m_NextChunk++;
+		found = true;
+	}
+	pthread_mutex_unlock(&m_NextChunkMutex);
+
+	return found;
+}
+
+void ParallelFileProcessor::processChunk(WorkerContext& worker, const FileChunk& chunk)
+{
+	seekToChunk(*worker.reader, chunk);
+
+	RawPacket packets[PARALLEL_FILE_PROCESSOR_BURST_SIZE];
+	int numOfPackets;
+	while ((numOfPackets = worker.reader->getNextPackets(packets, PARALLEL_FILE_PROCESSOR_BURST_SIZE)) > 0)
+	{
+		m_OnPacketsArrive(packets, (uint32_t)numOfPackets, worker.workerId, this, m_OnPacketsArriveUserCookie);
+		worker.numOfPackets += numOfPackets;
+	}
+}
+
+void ParallelFileProcessor::dispatchChunkFlows(WorkerContext& worker, size_t chunkIndex)
+{
+	MmapPcapFileReaderDevice& reader = *worker.reader;
+	seekToChunk(reader, m_Chunks[chunkIndex]);
+
+	std::vector<std::vector<PacketLocation> >& chunkLocations = m_RoundLocations[chunkIndex - m_RoundStartChunk];
+
+	RawPacket rawPacket;
+	rawPacket.setDeleteRawDataAtDestructor(false);
+
+	PacketLocation location;
+	const uint8_t* packetData;
+	while (reader.getNextRecord(packetData, location.capturedLength, location.frameLength, location.timestamp, location.linkType))
+	{
+		rawPacket.setRawData(packetData, location.capturedLength, location.timestamp, location.linkType, location.frameLength);
+		Packet packet(&rawPacket, OsiModelTransportLayer);
+		uint32_t flowHash = hash5Tuple(&packet);
+
+		location.dataOffset = (uint64_t)(packetData - reader.m_MappedFile);
+		chunkLocations[flowHash % m_NumOfWorkers].push_back(location);
+	}
+}
+
+void ParallelFileProcessor::processFlows(WorkerContext& worker)
+{
+	RawPacket packets[PARALLEL_FILE_PROCESSOR_BURST_SIZE];
+	uint32_t numOfPackets = 0;
+
+	// chunks are visited in file order so every worker sees its flows in the order they appear in the file
+	for (size_t chunkInRound = 0; chunkInRound < m_RoundLocations.size(); chunkInRound++)
+	{
+		std::vector<PacketLocation>& locations = m_RoundLocations[chunkInRound][worker.workerId];
+		for (std::vector<PacketLocation>::const_iterator iter = locations.begin(); iter != locations.end(); iter++)
+		{
+			RawPacket& rawPacket = packets[numOfPackets];
+			rawPacket.clear();
+			rawPacket.setDeleteRawDataAtDestructor(false);
+			rawPacket.setRawData(worker.reader->m_MappedFile + iter->dataOffset, iter->capturedLength, iter->timestamp, iter->linkType, iter->frameLength);
+
+			if (++numOfPackets == PARALLEL_FILE_PROCESSOR_BURST_SIZE)
+			{
+				m_OnPacketsArrive(packets, numOfPackets, worker.workerId, this, m_OnPacketsArriveUserCookie);
+				worker.numOfPackets += numOfPackets;
+				numOfPackets = 0;
+			}
+		}
+
+		// release the memory as soon as possible
+		std::vector<PacketLocation>().swap(locations);
+	}
+
+	if (numOfPackets > 0)
+	{
+		m_OnPacketsArrive(packets, numOfPackets, worker.workerId, this, m_OnPacketsArriveUserCookie);
+		worker.numOfPackets += numOfPackets;
+	}
+}
+
+void* ParallelFileProcessor::workerThreadMain(void* ptr)
+{
+	WorkerContext* worker = (WorkerContext*)ptr;
+	ParallelFileProcessor* pThis = worker->processor;
+	size_t chunkIndex;
+
+	switch (worker->phase)
+	{
+	case ProcessChunks:
+		while (pThis->takeNextChunk(chunkIndex))
+			pThis->processChunk(*worker, pThis->m_Chunks[chunkIndex]);
+		break;
+
+	case DispatchFlows:
+		while (pThis->takeNextChunk(chunkIndex))
+			pThis->dispatchChunkFlows(*worker, chunkIndex);
+		break;
+
+	case ProcessFlows:
+		pThis->processFlows(*worker);
+		break;
+	}
+
+	return 0;
+}
+
+bool ParallelFileProcessor::runWorkers(WorkerPhase phase)
+{
+	std::vector<pthread_t> threads(m_NumOfWorkers);
+	uint16_t numOfThreadsCreated = 0;
+	bool result = true;
+
+	for (; numOfThreadsCreated < m_NumOfWorkers; numOfThreadsCreated++)
+	{
+		m_Workers[numOfThreadsCreated].phase = phase;
+		int err = pthread_create(&threads[numOfThreadsCreated], NULL, workerThreadMain, &m_Workers[numOfThreadsCreated]);
+		if (err != 0)
+		{
+			LOG_ERROR("Cannot create worker thread #%d. Error was: %d", (int)numOfThreadsCreated, err);
+			result = false;
+			break;
+		}
+	}
+
+	for (uint16_t i = 0; i < numOfThreadsCreated; i++)
+		pthread_join(threads[i], NULL);
+
+	return result;
+}
+
+bool ParallelFileProcessor::processFile(OnFilePacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie)
+{
+	m_NumOfPacketsProcessed = 0;
+
+	if (onPacketsArrive == NULL)
+	{
+		LOG_ERROR("Packets arrive callback is NULL");
+		return false;
+	}
+
+	m_OnPacketsArrive = onPacketsArrive;
+	m_OnPacketsArriveUserCookie = onPacketsArriveUserCookie;
+
+	MmapPcapFileReaderDevice indexer(m_FileName.c_str());
+	if (!indexer.open())
+	{
+		LOG_ERROR("Cannot open file '%s' for parallel processing", m_FileName.c_str());
+		return false;
+	}
+
+	bool result = indexFile(indexer);
+	indexer.close();
+	if (!result)
+		return false;
+
+	m_Workers.resize(m_NumOfWorkers);
+	for (uint16_t i = 0; i < m_NumOfWorkers; i++)
+	{
+		m_Workers[i].processor = this;
+		m_Workers[i].workerId = i;
+		m_Workers[i].numOfPackets = 0;
+		m_Workers[i].reader = new MmapPcapFileReaderDevice(m_FileName.c_str());
+		if (!m_Workers[i].reader->open())
+		{
+			LOG_ERROR("Cannot open file '%s' for worker #%d", m_FileName.c_str(), (int)i);
+			result = false;
+		}
+	}
+
+	if (result && !m_FlowAffinity)
+	{
+		m_NextChunk = 0;
+		m_RoundEndChunk = m_Chunks.size();
+		result = runWorkers(ProcessChunks);
+	}
+	else if (result)
+	{
+		// every round parses one chunk per worker, then every worker processes the flows it owns in that round
+		for (m_RoundStartChunk = 0; result && m_RoundStartChunk < m_Chunks.size(); m_RoundStartChunk = m_RoundEndChunk)
+		{
+			m_RoundEndChunk = m_RoundStartChunk + m_NumOfWorkers;
+			if (m_RoundEndChunk > m_Chunks.size())
+				m_RoundEndChunk = m_Chunks.size();
+
+			m_RoundLocations.assign(m_RoundEndChunk - m_RoundStartChunk, std::vector<std::vector<PacketLocation> >(m_NumOfWorkers));
+			m_NextChunk = m_RoundStartChunk;
+			result = runWorkers(DispatchFlows) && runWorkers(ProcessFlows);
+		}
+
+		m_RoundLocations.clear();
+	}
+
+	for (uint16_t i = 0; i < m_NumOfWorkers; i++)
+	{
+		m_NumOfPacketsProcessed += m_Workers[i].numOfPackets;
+		delete m_Workers[i].reader;
+	}
+
+	m_Workers.clear();
+
+	LOG_DEBUG("Finished processing file '%s', %d packets were processed", m_FileName.c_str(), (int)m_NumOfPacketsProcessed);
+	return result;
+}
+
+} // namespace pcpp
@@ -3,12 +3,23 @@
 #include <stdio.h>
 #include <cerrno>
 #include "PcapFileDevice.h"
+#include "PcapFileIndex.h"
+#include "Packet.h"
+#include "PacketUtils.h"
 #include "light_pcapng_ext.h"
 #include "Logger.h"
 #include "TimespecTimeval.h"
 #include "pcap.h"
 #include <string.h>
+#include <stdlib.h>
+#include <algorithm>
 #include <fstream>
+#if !defined(WIN32) && !defined(WINx64) && !defined(PCAPPP_MINGW_ENV)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
 
 namespace pcpp
 {
@@ -74,6 +85,7 @@ IFileReaderDevice::IFileReaderDevice(const char* fileName) : IFileDevice(fileNam
 {
 	m_NumOfPacketsNotParsed = 0;
 	m_NumOfPacketsRead = 0;
+	m_ZeroCopyMode = false;
 }
 
 IFileReaderDevice* IFileReaderDevice::getReader(const char* fileName)
@@ -86,6 +98,26 @@ IFileReaderDevice* IFileReaderDevice::getReader(const char* fileName)
 	return new PcapFileReaderDevice(fileName);
 }
 
+bool IFileReaderDevice::setPacketData(RawPacket& rawPacket, const uint8_t* packetData, uint32_t capturedLength, timeval timestamp, LinkLayerType linkType, uint32_t frameLength) const
+{
+	timespec nsecTimestamp;
+	TIMEVAL_TO_TIMESPEC(&timestamp, &nsecTimestamp);
+	return setPacketData(rawPacket, packetData, capturedLength, nsecTimestamp, linkType, frameLength);
+}
+
+bool IFileReaderDevice::setPacketData(RawPacket& rawPacket, const uint8_t* packetData, uint32_t capturedLength, timespec timestamp, LinkLayerType linkType, uint32_t frameLength) const
+{
+	// rawPacket was already cleared by the caller, so changing the ownership flag here can't leak or free anything
+	rawPacket.setDeleteRawDataAtDestructor(!m_ZeroCopyMode);
+
+	if (m_ZeroCopyMode)
+		return rawPacket.setRawData(packetData, capturedLength, timestamp, linkType, frameLength);
+
+	uint8_t* myPacketData = new uint8_t[capturedLength];
+	memcpy(myPacketData, packetData, capturedLength);
+	return rawPacket.setRawData(myPacketData, capturedLength, timestamp, linkType, frameLength);
+}
+
 uint64_t IFileReaderDevice::getFileSize() const
 {
 	std::ifstream fileStream(m_FileName, std::ifstream::ate | std::ifstream::binary);
@@ -98,6 +130,17 @@ int IFileReaderDevice::getNextPackets(RawPacketVector& packetVec, int numOfPacke
 
 	for (; numOfPacketsToRead < 0 || numOfPacketsRead < numOfPacketsToRead; numOfPacketsRead++)
 	{
+		if (m_ZeroCopyMode)
+		{
+			// packets in the vector must outlive the next read, so in zero-copy mode each of them is copied once
+			RawPacket lentPacket;
+			if (!getNextPacket(lentPacket))
+				break;
+
+			packetVec.pushBack(new RawPacket(lentPacket));
+			continue;
+		}
+
 		RawPacket* newPacket = new RawPacket();
 		bool packetRead = getNextPacket(*newPacket);
 		if (packetRead)
@@ -181,9 +224,7 @@ bool PcapFileReaderDevice::getNextPacket(RawPacket& rawPacket)
 		return false;
 	}
 
-	uint8_t* pMyPacketData = new uint8_t[pkthdr.caplen];
-	memcpy(pMyPacketData, pPacketData, pkthdr.caplen);
-	if (!rawPacket.setRawData(pMyPacketData, pkthdr.caplen, pkthdr.ts, static_cast<LinkLayerType>(m_PcapLinkLayerType), pkthdr.len))
+	if (!setPacketData(rawPacket, pPacketData, pkthdr.caplen, pkthdr.ts, static_cast<LinkLayerType>(m_PcapLinkLayerType), pkthdr.len))
 	{
 		LOG_ERROR("Couldn't set data to raw packet");
 		return false;
@@ -255,9 +296,7 @@ bool PcapNgFileReaderDevice::getNextPacket(RawPacket& rawPacket, std::string& pa
 		}
 	}
 
-	uint8_t* myPacketData = new uint8_t[pktHeader.captured_length];
-	memcpy(myPacketData, pktData, pktHeader.captured_length);
-	if (!rawPacket.setRawData(myPacketData, pktHeader.captured_length, pktHeader.timestamp, static_cast<LinkLayerType>(pktHeader.data_link), pktHeader.original_length))
+	if (!setPacketData(rawPacket, pktData, pktHeader.captured_length, pktHeader.timestamp, static_cast<LinkLayerType>(pktHeader.data_link), pktHeader.original_length))
 	{
 		LOG_ERROR("Couldn't set data to raw packet");
 		return false;
@@ -371,212 +410,866 @@ std::string PcapNgFileReaderDevice::getCaptureFileComment() const
 }
 
 
-// ~~~~~~~~~~~~~~~~~~~~~~~~~
-// IFileWriterDevice members
-// ~~~~~~~~~~~~~~~~~~~~~~~~~
-
-IFileWriterDevice:: IFileWriterDevice(const char* fileName) : IFileDevice(fileName)
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// MmapPcapFileReaderDevice members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#define PCAP_MAGIC_USEC 0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+#define PCAP_LINKTYPE_MASK 0x03FFFFFF
+#define PCAPNG_SECTION_HEADER_BLOCK 0x0A0D0D0A
+#define PCAPNG_INTERFACE_BLOCK 0x00000001
+#define PCAPNG_SIMPLE_PACKET_BLOCK 0x00000003
+#define PCAPNG_ENHANCED_PACKET_BLOCK 0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+#define PCAPNG_OPTION_END 0
+#define PCAPNG_OPTION_IF_TSRESOL 9
+#define PCAPNG_OPTION_IF_TSOFFSET 14
+#define PCAPNG_DEFAULT_TS_UNITS_PER_SEC 1000000ULL
+#define PCAPNG_MAX_TIMESTAMP_SECS ((uint64_t)-1 / 1000000000ULL)
+
+static inline uint16_t swap16(uint16_t value)
 {
-	m_NumOfPacketsNotWritten = 0;
-	m_NumOfPacketsWritten = 0;
+	return (uint16_t)((value >> 8) | (value << 8));
 }
 
+static inline uint32_t swap32(uint32_t value)
+{
+	return ((value >> 24) & 0xff) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24);
+}
 
-// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-// PcapFileWriterDevice members
-// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+MmapPcapFileReaderDevice::MmapPcapFileReaderDevice(const char* fileName) : IFileReaderDevice(fileName)
+{
+	m_MappedFile = NULL;
+	m_MappedFileLength = 0;
+	m_ReadOffset = 0;
+	m_ReadEndOffset = 0;
+	m_RecordOffset = 0;
+	m_PcapNgSectionOffset = 0;
+	m_Index = NULL;
+	m_IsPcapNg = false;
+	m_SwapBytes = false;
+	m_NanoSecPrecision = false;
+	m_PcapLinkLayerType = LINKTYPE_ETHERNET;
+	m_ZeroCopyMode = true;
+}
 
-PcapFileWriterDevice::PcapFileWriterDevice(const char* fileName, LinkLayerType linkLayerType) : IFileWriterDevice(fileName)
+uint16_t MmapPcapFileReaderDevice::read16(uint64_t offset) const
 {
-	m_PcapDumpHandler = NULL;
-	m_NumOfPacketsNotWritten = 0;
-	m_NumOfPacketsWritten = 0;
-	m_PcapLinkLayerType = linkLayerType;
-	m_AppendMode = false;
-	m_File = NULL;
+	// records aren't necessarily aligned, so values are copied out rather than dereferenced
+	uint16_t value;
+	memcpy(&value, m_MappedFile + offset, sizeof(value));
+	return m_SwapBytes ? swap16(value) : value;
 }
 
-void PcapFileWriterDevice::closeFile()
+uint32_t MmapPcapFileReaderDevice::read32(uint64_t offset) const
 {
-	if (m_AppendMode && m_File != NULL)
-	{
-		fclose(m_File);
-		m_File = NULL;
-	}
+	uint32_t value;
+	memcpy(&value, m_MappedFile + offset, sizeof(value));
+	return m_SwapBytes ? swap32(value) : value;
 }
 
-bool PcapFileWriterDevice::writePacket(RawPacket const& packet)
+bool MmapPcapFileReaderDevice::parsePcapFileHeader()
 {
-	if ((!m_AppendMode && m_PcapDescriptor == NULL) || (m_PcapDumpHandler == NULL))
-	{
-		LOG_ERROR("Device not opened");
-		m_NumOfPacketsNotWritten++;
+	if (m_MappedFileLength < sizeof(pcap_file_header))
 		return false;
-	}
 
-	if (packet.getLinkLayerType() != m_PcapLinkLayerType)
+	uint32_t magic;
+	memcpy(&magic, m_MappedFile, sizeof(magic));
+
+	if (magic == PCAP_MAGIC_USEC || magic == PCAP_MAGIC_NSEC)
+		m_SwapBytes = false;
+	else if (swap32(magic) == PCAP_MAGIC_USEC || swap32(magic) == PCAP_MAGIC_NSEC)
+		m_SwapBytes = true;
+	else
+		return false;
+
+	m_NanoSecPrecision = ((m_SwapBytes ? swap32(magic) : magic) == PCAP_MAGIC_NSEC);
+
+	int linkLayer = (int)(read32(20) & PCAP_LINKTYPE_MASK);
+	if (!RawPacket::isLinkTypeValid(linkLayer))
 	{
-		LOG_ERROR("Cannot write a packet with a different link layer type");
-		m_NumOfPacketsNotWritten++;
+		LOG_ERROR("Invalid link layer (%d) for reader device filename '%s'", linkLayer, m_FileName);
 		return false;
 	}
 
-	pcap_pkthdr pktHdr;
-	pktHdr.caplen = ((RawPacket&)packet).getRawDataLen();
-	pktHdr.len = ((RawPacket&)packet).getFrameLength();
-	timespec packet_timestamp = ((RawPacket&)packet).getPacketTimeStamp();
-	TIMESPEC_TO_TIMEVAL(&pktHdr.ts, &packet_timestamp);
-	if (!m_AppendMode)
-		pcap_dump((uint8_t*)m_PcapDumpHandler, &pktHdr, ((RawPacket&)packet).getRawData());
+	m_PcapLinkLayerType = static_cast<LinkLayerType>(linkLayer);
+	m_IsPcapNg = false;
+	m_ReadOffset = sizeof(pcap_file_header);
+	return true;
+}
+
+bool MmapPcapFileReaderDevice::parsePcapNgSectionHeader(uint64_t offset)
+{
+	// block type (4 bytes) + block length (4 bytes) + byte order magic (4 bytes)
+	if (offset + 12 > m_MappedFileLength)
+		return false;
+
+	uint32_t byteOrderMagic;
+	memcpy(&byteOrderMagic, m_MappedFile + offset + 8, sizeof(byteOrderMagic));
+	if (byteOrderMagic == PCAPNG_BYTE_ORDER_MAGIC)
+		m_SwapBytes = false;
+	else if (swap32(byteOrderMagic) == PCAPNG_BYTE_ORDER_MAGIC)
+		m_SwapBytes = true;
 	else
+		return false;
+
+	// interface IDs are local to a section
+	m_PcapNgInterfaces.clear();
+	m_PcapNgSectionOffset = offset;
+	m_IsPcapNg = true;
+	return true;
+}
+
+bool MmapPcapFileReaderDevice::parsePcapNgInterfaceBlock(uint64_t offset, uint32_t blockLength)
+{
+	// block header (8 bytes) + link type (2 bytes) + reserved (2 bytes) + snap length (4 bytes) + trailing block length (4 bytes)
+	if (blockLength < 20)
+		return false;
+
+	PcapNgInterfaceInfo interfaceInfo;
+	interfaceInfo.linkType = static_cast<LinkLayerType>(read16(offset + 8));
+	interfaceInfo.snapLen = read32(offset + 12);
+	interfaceInfo.tsUnitsPerSec = PCAPNG_DEFAULT_TS_UNITS_PER_SEC;
+	interfaceInfo.tsOffset = 0;
+	interfaceInfo.blockOffset = offset;
+
+	uint64_t optionOffset = offset + 16;
+	uint64_t optionsEnd = offset + blockLength - 4;
+	while (optionOffset + 4 <= optionsEnd)
 	{
-		// Below are actually the lines run by pcap_dump. The reason I had to put them instead pcap_dump is that on Windows using WinPcap/Npcap
-		// you can't pass pointers between libraries compiled with different compilers. In this case - PcapPlusPlus and WinPcap/Npcap weren't
-		// compiled with the same compiler so it's impossible to fopen a file in PcapPlusPlus, pass the pointer to WinPcap/Npcap and use the
-		// FILE* pointer there. Doing this throws an exception. So the only option when implementing append to pcap is to write all relevant
-		// WinPcap/Npcap code that handles opening/closing/writing to pcap files inside PcapPlusPlus code
+		uint16_t optionCode = read16(optionOffset);
+		uint16_t optionLength = read16(optionOffset + 2);
+		uint64_t valueOffset = optionOffset + 4;
+		if (optionCode == PCAPNG_OPTION_END || valueOffset + optionLength > optionsEnd)
+			break;
 
-		// the reason to create this packet_header struct is timeval has different sizes in 32-bit and 64-bit systems,
-		// but pcap format uses the 32-bit timeval version, so we need to align timeval to that
-		packet_header pktHdrTemp;
-		pktHdrTemp.tv_sec = pktHdr.ts.tv_sec;
-		pktHdrTemp.tv_usec = pktHdr.ts.tv_usec;
-		pktHdrTemp.caplen = pktHdr.caplen;
-		pktHdrTemp.len = pktHdr.len;
-		fwrite(&pktHdrTemp, sizeof(pktHdrTemp), 1, m_File);
-		fwrite(((RawPacket&)packet).getRawData(), pktHdrTemp.caplen, 1, m_File);
+		if (optionCode == PCAPNG_OPTION_IF_TSRESOL && optionLength >= 1)
+		{
+			uint8_t tsResolution = m_MappedFile[valueOffset];
+			uint8_t exponent = tsResolution & 0x7f;
+			if (tsResolution & 0x80)
+			{
+				// negative power of 2
+				if (exponent < 64)
+					interfaceInfo.tsUnitsPerSec = (1ULL << exponent);
+			}
+			else if (exponent <= 19)
+			{
+				// negative power of 10
+				interfaceInfo.tsUnitsPerSec = 1;
+				for (uint8_t i = 0; i < exponent; i++)
+					interfaceInfo.tsUnitsPerSec *= 10;
+			}
+		}
+		else if (optionCode == PCAPNG_OPTION_IF_TSOFFSET && optionLength >= 8)
+		{
+			uint64_t tsOffset = m_SwapBytes ? ((uint64_t)read32(valueOffset) << 32) | read32(valueOffset + 4) : ((uint64_t)read32(valueOffset + 4) << 32) | read32(valueOffset);
+			interfaceInfo.tsOffset = (int64_t)tsOffset;
+		}
+
+		// option values are padded to 32 bits
+		optionOffset = valueOffset + ((optionLength + 3) & ~3);
 	}
-	LOG_DEBUG("Packet written successfully to '%s'", m_FileName);
-	m_NumOfPacketsWritten++;
+
+	m_PcapNgInterfaces.push_back(interfaceInfo);
 	return true;
 }
 
-bool PcapFileWriterDevice::writePackets(const RawPacketVector& packets)
+bool MmapPcapFileReaderDevice::getNextPcapRecord(const uint8_t*& packetData, uint32_t& capturedLength, uint32_t& frameLength, timespec& timestamp, LinkLayerType& linkType)
 {
-	for (RawPacketVector::ConstVectorIterator iter = packets.begin(); iter != packets.end(); iter++)
+	if (m_ReadOffset + sizeof(packet_header) > m_ReadEndOffset)
+		return false;
+
+	capturedLength = read32(m_ReadOffset + 8);
+	frameLength = read32(m_ReadOffset + 12);
+	uint64_t dataOffset = m_ReadOffset + sizeof(packet_header);
+	if (dataOffset + capturedLength > m_ReadEndOffset)
 	{
-		if (!writePacket(**iter))
-			return false;
+		LOG_DEBUG("Last record in file '%s' is truncated", m_FileName);
+		return false;
 	}
 
+	timestamp.tv_sec = read32(m_ReadOffset);
+	timestamp.tv_nsec = read32(m_ReadOffset + 4);
+	if (!m_NanoSecPrecision)
+		timestamp.tv_nsec *= 1000;
+
+	packetData = m_MappedFile + dataOffset;
+	linkType = m_PcapLinkLayerType;
+	m_RecordOffset = m_ReadOffset;
+	m_ReadOffset = dataOffset + capturedLength;
 	return true;
 }
 
-bool PcapFileWriterDevice::open()
+bool MmapPcapFileReaderDevice::getNextPcapNgRecord(const uint8_t*& packetData, uint32_t& capturedLength, uint32_t& frameLength, timespec& timestamp, LinkLayerType& linkType)
 {
-	if (m_PcapDescriptor != NULL)
+	while (m_ReadOffset + 12 <= m_ReadEndOffset)
 	{
-		LOG_DEBUG("Pcap descriptor already opened. Nothing to do");
+		uint64_t blockOffset = m_ReadOffset;
+		uint32_t blockType = read32(blockOffset);
+		if (blockType == PCAPNG_SECTION_HEADER_BLOCK && !parsePcapNgSectionHeader(blockOffset))
+		{
+			LOG_ERROR("Corrupted section header block in file '%s'", m_FileName);
+			return false;
+		}
+
+		uint32_t blockLength = read32(blockOffset + 4);
+		if (blockLength < 12 || (blockLength & 3) != 0 || blockOffset + blockLength > m_ReadEndOffset)
+		{
+			LOG_DEBUG("Last block in file '%s' is truncated or corrupted", m_FileName);
+			return false;
+		}
+
+		m_ReadOffset = blockOffset + blockLength;
+
+		if (blockType == PCAPNG_INTERFACE_BLOCK)
+		{
+			if (!parsePcapNgInterfaceBlock(blockOffset, blockLength))
+				LOG_ERROR("Corrupted interface description block in file '%s'", m_FileName);
+			continue;
+		}
+
+		const PcapNgInterfaceInfo* interfaceInfo = NULL;
+		uint64_t dataOffset;
+		uint64_t tsUnits = 0;
+
+		if (blockType == PCAPNG_ENHANCED_PACKET_BLOCK && blockLength >= 32)
+		{
+			uint32_t interfaceId = read32(blockOffset + 8);
+			if (interfaceId >= m_PcapNgInterfaces.size())
+				continue;
+
+			interfaceInfo = &m_PcapNgInterfaces[interfaceId];
+			tsUnits = ((uint64_t)read32(blockOffset + 12) << 32) | read32(blockOffset + 16);
+			capturedLength = read32(blockOffset + 20);
+			frameLength = read32(blockOffset + 24);
+			dataOffset = blockOffset + 28;
+		}
+		else if (blockType == PCAPNG_SIMPLE_PACKET_BLOCK && blockLength >= 16)
+		{
+			// simple packet blocks always belong to the first interface and don't have a timestamp
+			if (m_PcapNgInterfaces.empty())
+				continue;
+
+			interfaceInfo = &m_PcapNgInterfaces[0];
+			frameLength = read32(blockOffset + 8);
+			capturedLength = blockLength - 16;
+			if (frameLength < capturedLength)
+				capturedLength = frameLength;
+			if (interfaceInfo->snapLen != 0 && interfaceInfo->snapLen < capturedLength)
+				capturedLength = interfaceInfo->snapLen;
+			dataOffset = blockOffset + 12;
+		}
+		else
+		{
+			// any other block doesn't contain packet data
+			continue;
+		}
+
+		if (dataOffset + capturedLength > blockOffset + blockLength - 4)
+		{
+			LOG_ERROR("Packet block in file '%s' has an invalid captured length", m_FileName);
+			continue;
+		}
+
+		uint64_t unitsPerSec = interfaceInfo->tsUnitsPerSec;
+		uint64_t packetSecs = tsUnits / unitsPerSec;
+		uint64_t remainderUnits = tsUnits % unitsPerSec;
+		if (packetSecs > PCAPNG_MAX_TIMESTAMP_SECS)
+		{
+			// same as LightPcapNg: a timestamp that can't be represented in nsec is treated as missing
+			timestamp.tv_sec = 0;
+			timestamp.tv_nsec = 0;
+		}
+		else
+		{
+			timestamp.tv_sec = (time_t)((int64_t)packetSecs + interfaceInfo->tsOffset);
+			if (unitsPerSec <= 1000000000ULL)
+				timestamp.tv_nsec = (long)(remainderUnits * (1000000000ULL / unitsPerSec));
+			else
+				timestamp.tv_nsec = (long)((double)remainderUnits * 1000000000.0 / (double)unitsPerSec);
+		}
+
+		packetData = m_MappedFile + dataOffset;
+		linkType = interfaceInfo->linkType;
+		m_RecordOffset = blockOffset;
 		return true;
 	}
 
-	switch(m_PcapLinkLayerType)
+	return false;
+}
+
+bool MmapPcapFileReaderDevice::getNextRecord(const uint8_t*& packetData, uint32_t& capturedLength, uint32_t& frameLength, timespec& timestamp, LinkLayerType& linkType)
+{
+	if (m_IsPcapNg)
+		return getNextPcapNgRecord(packetData, capturedLength, frameLength, timestamp, linkType);
+
+	return getNextPcapRecord(packetData, capturedLength, frameLength, timestamp, linkType);
+}
+
+bool MmapPcapFileReaderDevice::readNextPacket(RawPacket& rawPacket)
+{
+	rawPacket.clear();
+
+	const uint8_t* packetData = NULL;
+	uint32_t capturedLength = 0, frameLength = 0;
+	timespec timestamp;
+	LinkLayerType linkType = LINKTYPE_ETHERNET;
+
+	do
 	{
-		case LINKTYPE_RAW:
-		case LINKTYPE_DLT_RAW2:
-			LOG_ERROR("The only Raw IP link type supported in libpcap/WinPcap/Npcap is LINKTYPE_DLT_RAW1, please use that instead");
+		if (!getNextRecord(packetData, capturedLength, frameLength, timestamp, linkType))
 			return false;
-		default:
-			break;
 	}
+	while (!m_BpfWrapper.matchPacketWithFilter(packetData, capturedLength, timestamp, linkType));
 
-	m_NumOfPacketsNotWritten = 0;
-	m_NumOfPacketsWritten = 0;
-
-	m_PcapDescriptor = pcap_open_dead(m_PcapLinkLayerType, PCPP_MAX_PACKET_SIZE);
-	if (m_PcapDescriptor == NULL)
+	if (!setPacketData(rawPacket, packetData, capturedLength, timestamp, linkType, frameLength))
 	{
-		LOG_ERROR("Error opening file writer device for file '%s': pcap_open_dead returned NULL", m_FileName);
-		m_DeviceOpened = false;
+		LOG_ERROR("Couldn't set data to raw packet");
 		return false;
 	}
 
+	m_NumOfPacketsRead++;
+	return true;
+}
 
-	m_PcapDumpHandler = pcap_dump_open(m_PcapDescriptor, m_FileName);
-	if (m_PcapDumpHandler == NULL)
+bool MmapPcapFileReaderDevice::getNextPacket(RawPacket& rawPacket)
+{
+	if (m_MappedFile == NULL)
 	{
-		LOG_ERROR("Error opening file writer device for file '%s': pcap_dump_open returned NULL with error: '%s'",
-				m_FileName, pcap_geterr(m_PcapDescriptor));
-		m_DeviceOpened = false;
+		rawPacket.clear();
+		LOG_ERROR("File device '%s' not opened", m_FileName);
+		return false;
+	}
+
+	if (!readNextPacket(rawPacket))
+	{
+		LOG_DEBUG("Packet could not be read. Probably end-of-file");
 		return false;
 	}
 
-	m_DeviceOpened = true;
-	LOG_DEBUG("File writer device for file '%s' opened successfully", m_FileName);
 	return true;
 }
 
-void PcapFileWriterDevice::flush()
+int MmapPcapFileReaderDevice::getNextPackets(RawPacket* packetsArr, int packetsArrLength)
 {
-	if (!m_DeviceOpened)
-		return;
-
-	if (!m_AppendMode && pcap_dump_flush(m_PcapDumpHandler) == -1)
-	{
-		LOG_ERROR("Error while flushing the packets to file");
-	}
-	// in append mode it's impossible to use pcap_dump_flush, see comment above pcap_dump
-	else if (m_AppendMode && fflush(m_File) == EOF)
+	if (m_MappedFile == NULL)
 	{
-		LOG_ERROR("Error while flushing the packets to file");
+		LOG_ERROR("File device '%s' not opened", m_FileName);
+		return 0;
 	}
 
+	int numOfPacketsRead = 0;
+	while (numOfPacketsRead < packetsArrLength && readNextPacket(packetsArr[numOfPacketsRead]))
+		numOfPacketsRead++;
+
+	return numOfPacketsRead;
 }
 
-void PcapFileWriterDevice::close()
+bool MmapPcapFileReaderDevice::setReadOffset(uint64_t recordOffset, const PcapFileIndex& index)
 {
-	if (!m_DeviceOpened)
-		return;
+	if (recordOffset > m_ReadEndOffset || (!m_IsPcapNg && recordOffset < sizeof(pcap_file_header)))
+		return false;
 
-	flush();
+	if (m_IsPcapNg)
+	{
+		// the byte order and the interfaces of a record are known only from the blocks of its section that come before it
+		std::vector<PcapFileIndex::PcapNgBlock> blocks;
+		index.getPcapNgBlocksBefore(recordOffset, blocks);
+		for (std::vector<PcapFileIndex::PcapNgBlock>::const_iterator iter = blocks.begin(); iter != blocks.end(); iter++)
+		{
+			if (iter->offset + 12 > m_ReadEndOffset)
+				return false;
+
+			if (iter->isSectionHeader)
+			{
+				if (!parsePcapNgSectionHeader(iter->offset))
+					return false;
+				continue;
+			}
+
+			uint32_t blockLength = read32(iter->offset + 4);
+			if (read32(iter->offset) != PCAPNG_INTERFACE_BLOCK || blockLength > m_ReadEndOffset - iter->offset || !parsePcapNgInterfaceBlock(iter->offset, blockLength))
+				return false;
+		}
+	}
 
-	IFileDevice::close();
+	m_ReadOffset = recordOffset;
+	return true;
+}
 
-	if (!m_AppendMode && m_PcapDumpHandler != NULL)
+bool MmapPcapFileReaderDevice::seekToTime(const timespec& timestamp)
+{
+	if (m_MappedFile == NULL || m_Index == NULL)
 	{
-		pcap_dump_close(m_PcapDumpHandler);
+		LOG_ERROR("File device '%s' not opened or has no index", m_FileName);
+		return false;
 	}
-	else if (m_AppendMode && m_File != NULL)
+
+	PcapFileIndex::IndexEntry entry;
+	if (!m_Index->findEntryByTime(timestamp, entry))
+		return false;
+
+	if (!setReadOffset(entry.recordOffset, *m_Index))
 	{
-		// in append mode it's impossible to use pcap_dump_close, see comment above pcap_dump
-		fclose(m_File);
+		LOG_ERROR("The index doesn't match file '%s'", m_FileName);
+		return false;
 	}
 
-	m_PcapDumpHandler = NULL;
-	m_File = NULL;
-	LOG_DEBUG("File writer closed for file '%s'", m_FileName);
-}
+	// all packets before the indexed packet are earlier, the first packet that isn't is at or after it
+	const uint8_t* packetData;
+	uint32_t capturedLength, frameLength;
+	timespec packetTimestamp;
+	LinkLayerType linkType;
+	while (getNextRecord(packetData, capturedLength, frameLength, packetTimestamp, linkType))
+	{
+		if (packetTimestamp.tv_sec > timestamp.tv_sec || (packetTimestamp.tv_sec == timestamp.tv_sec && packetTimestamp.tv_nsec >= timestamp.tv_nsec))
+		{
+			m_ReadOffset = m_RecordOffset;
+			return true;
+		}
+	}
 
-void PcapFileWriterDevice::getStatistics(PcapStats& stats) const
-{
-	stats.packetsRecv = m_NumOfPacketsWritten;
-	stats.packetsDrop = m_NumOfPacketsNotWritten;
-	stats.packetsDropByInterface = 0;
-	LOG_DEBUG("Statistics received for writer device for filename '%s'", m_FileName);
+	return false;
 }
 
-bool PcapFileWriterDevice::open(bool appendMode)
+bool MmapPcapFileReaderDevice::seekToPacket(uint64_t packetNumber)
 {
-	if (!appendMode)
-		return open();
-
-	m_AppendMode = appendMode;
+	if (m_MappedFile == NULL || m_Index == NULL)
+	{
+		LOG_ERROR("File device '%s' not opened or has no index", m_FileName);
+		return false;
+	}
 
-#if !defined(WIN32) && !defined(WINx64)
-	m_File = fopen(m_FileName, "r+");
-#else
-	m_File = fopen(m_FileName, "rb+");
-#endif
+	PcapFileIndex::IndexEntry entry;
+	if (!m_Index->findEntryByPacket(packetNumber, entry))
+		return false;
 
-	if (m_File == NULL)
+	if (!setReadOffset(entry.recordOffset, *m_Index))
 	{
-		LOG_ERROR("Cannot open '%s' for reading and writing", m_FileName);
+		LOG_ERROR("The index doesn't match file '%s'", m_FileName);
 		return false;
 	}
 
-	pcap_file_header pcapFileHeader;
-	int amountRead = fread(&pcapFileHeader, 1, sizeof(pcapFileHeader), m_File);
-	if (amountRead != sizeof(pcap_file_header))
+	const uint8_t* packetData;
+	uint32_t capturedLength, frameLength;
+	timespec timestamp;
+	LinkLayerType linkType;
+	for (uint64_t i = entry.packetNumber; i < packetNumber; i++)
+	{
+		if (!getNextRecord(packetData, capturedLength, frameLength, timestamp, linkType))
+			return false;
+	}
+
+	return true;
+}
+
+bool MmapPcapFileReaderDevice::forEachPacketOfFlow(uint32_t flowHash, OnFlowPacketCallback onPacket, void* userCookie)
+{
+	if (m_MappedFile == NULL || m_Index == NULL || !m_Index->getConfig().indexFlows)
+	{
+		LOG_ERROR("File device '%s' not opened or has no index of flows", m_FileName);
+		return false;
+	}
+
+	const std::vector<uint64_t>* records = m_Index->getFlowRecords(flowHash);
+	if (records == NULL)
+		return true;
+
+	// the read position of getNextPacket() is restored when done
+	uint64_t readOffset = m_ReadOffset;
+	uint64_t recordOffset = m_RecordOffset;
+	uint64_t sectionOffset = m_PcapNgSectionOffset;
+	bool swapBytes = m_SwapBytes;
+	std::vector<PcapNgInterfaceInfo> pcapNgInterfaces = m_PcapNgInterfaces;
+
+	bool result = true;
+	RawPacket rawPacket;
+	const uint8_t* packetData;
+	uint32_t capturedLength, frameLength;
+	timespec timestamp;
+	LinkLayerType linkType;
+	for (std::vector<uint64_t>::const_iterator iter = records->begin(); iter != records->end(); iter++)
+	{
+		if (!setReadOffset(*iter, *m_Index) || !getNextRecord(packetData, capturedLength, frameLength, timestamp, linkType) || m_RecordOffset != *iter)
+		{
+			LOG_ERROR("The index doesn't match file '%s'", m_FileName);
+			result = false;
+			break;
+		}
+
+		if (!m_BpfWrapper.matchPacketWithFilter(packetData, capturedLength, timestamp, linkType))
+			continue;
+
+		if (!setPacketData(rawPacket, packetData, capturedLength, timestamp, linkType, frameLength))
+		{
+			LOG_ERROR("Couldn't set data to raw packet");
+			result = false;
+			break;
+		}
+
+		if (onPacket(rawPacket, userCookie))
+			break;
+	}
+
+	m_ReadOffset = readOffset;
+	m_RecordOffset = recordOffset;
+	m_PcapNgSectionOffset = sectionOffset;
+	m_SwapBytes = swapBytes;
+	m_PcapNgInterfaces = pcapNgInterfaces;
+	return result;
+}
+
+bool MmapPcapFileReaderDevice::open()
+{
+	m_NumOfPacketsRead = 0;
+	m_NumOfPacketsNotParsed = 0;
+
+	if (m_MappedFile != NULL)
+	{
+		LOG_DEBUG("File already mapped. Nothing to do");
+		return true;
+	}
+
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+
+	LOG_ERROR("Memory-mapped file reader is not supported on this platform");
+	m_DeviceOpened = false;
+	return false;
+
+#else
+
+	int fd = ::open(m_FileName, O_RDONLY);
+	if (fd < 0)
+	{
+		LOG_ERROR("Cannot open file reader device for filename '%s': %s", m_FileName, strerror(errno));
+		m_DeviceOpened = false;
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0 || (uint64_t)fileStat.st_size > (uint64_t)((size_t)-1))
+	{
+		LOG_ERROR("Cannot get the size of file '%s' or file is empty", m_FileName);
+		::close(fd);
+		m_DeviceOpened = false;
+		return false;
+	}
+
+	// the mapping is private and writable so packets can be modified in place (copy-on-write) without changing the file
+	void* mappedFile = mmap(NULL, (size_t)fileStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mappedFile == MAP_FAILED)
+	{
+		LOG_ERROR("Cannot map file '%s' into memory: %s", m_FileName, strerror(errno));
+		m_DeviceOpened = false;
+		return false;
+	}
+
+	madvise(mappedFile, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+	// only a hint, the kernel may not support huge pages for file mappings
+	madvise(mappedFile, (size_t)fileStat.st_size, MADV_HUGEPAGE);
+#endif
+
+	m_MappedFile = (uint8_t*)mappedFile;
+	m_MappedFileLength = (uint64_t)fileStat.st_size;
+	m_ReadEndOffset = m_MappedFileLength;
+
+	uint32_t magic = 0;
+	if (m_MappedFileLength >= sizeof(magic))
+		memcpy(&magic, m_MappedFile, sizeof(magic));
+
+	bool headerParsed;
+	if (magic == PCAPNG_SECTION_HEADER_BLOCK)
+	{
+		headerParsed = parsePcapNgSectionHeader(0);
+		m_ReadOffset = 0;
+	}
+	else
+	{
+		headerParsed = parsePcapFileHeader();
+	}
+
+	if (!headerParsed)
+	{
+		LOG_ERROR("File '%s' is not a valid pcap or pcap-ng file", m_FileName);
+		close();
+		return false;
+	}
+
+	LOG_DEBUG("Successfully mapped file reader device for filename '%s'", m_FileName);
+	m_DeviceOpened = true;
+	return true;
+
+#endif
+}
+
+void MmapPcapFileReaderDevice::close()
+{
+	if (m_MappedFile == NULL)
+		return;
+
+#if !defined(WIN32) && !defined(WINx64) && !defined(PCAPPP_MINGW_ENV)
+	munmap(m_MappedFile, (size_t)m_MappedFileLength);
+#endif
+
+	m_MappedFile = NULL;
+	m_MappedFileLength = 0;
+	m_ReadOffset = 0;
+	m_ReadEndOffset = 0;
+	m_IsPcapNg = false;
+	m_PcapNgInterfaces.clear();
+
+	m_DeviceOpened = false;
+	LOG_DEBUG("File reader closed for file '%s'", m_FileName);
+}
+
+void MmapPcapFileReaderDevice::getStatistics(PcapStats& stats) const
+{
+	stats.packetsRecv = m_NumOfPacketsRead;
+	stats.packetsDrop = m_NumOfPacketsNotParsed;
+	stats.packetsDropByInterface = 0;
+	LOG_DEBUG("Statistics received for mmap reader device for filename '%s'", m_FileName);
+}
+
+bool MmapPcapFileReaderDevice::setFilter(std::string filterAsString)
+{
+	return m_BpfWrapper.setFilter(filterAsString);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+// IFileWriterDevice members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+
+IFileWriterDevice:: IFileWriterDevice(const char* fileName) : IFileDevice(fileName)
+{
+	m_NumOfPacketsNotWritten = 0;
+	m_NumOfPacketsWritten = 0;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// PcapFileWriterDevice members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+PcapFileWriterDevice::PcapFileWriterDevice(const char* fileName, LinkLayerType linkLayerType) : IFileWriterDevice(fileName)
+{
+	m_PcapDumpHandler = NULL;
+	m_NumOfPacketsNotWritten = 0;
+	m_NumOfPacketsWritten = 0;
+	m_PcapLinkLayerType = linkLayerType;
+	m_AppendMode = false;
+	m_File = NULL;
+	m_FileOffset = 0;
+	m_Index = NULL;
+}
+
+// the flow hash of a packet being written, needed only when the index of the file has flow records
+static uint32_t getIndexedFlowHash(const PcapFileIndex* index, RawPacket const& packet)
+{
+	if (!index->getConfig().indexFlows)
+		return 0;
+
+	Packet parsedPacket((RawPacket*)&packet, OsiModelTransportLayer);
+	return hash5Tuple(&parsedPacket);
+}
+
+void PcapFileWriterDevice::closeFile()
+{
+	if (m_AppendMode && m_File != NULL)
+	{
+		fclose(m_File);
+		m_File = NULL;
+	}
+}
+
+bool PcapFileWriterDevice::writePacket(RawPacket const& packet)
+{
+	if ((!m_AppendMode && m_PcapDescriptor == NULL) || (m_PcapDumpHandler == NULL))
+	{
+		LOG_ERROR("Device not opened");
+		m_NumOfPacketsNotWritten++;
+		return false;
+	}
+
+	if (packet.getLinkLayerType() != m_PcapLinkLayerType)
+	{
+		LOG_ERROR("Cannot write a packet with a different link layer type");
+		m_NumOfPacketsNotWritten++;
+		return false;
+	}
+
+	pcap_pkthdr pktHdr;
+	pktHdr.caplen = ((RawPacket&)packet).getRawDataLen();
+	pktHdr.len = ((RawPacket&)packet).getFrameLength();
+	timespec packet_timestamp = ((RawPacket&)packet).getPacketTimeStamp();
+	TIMESPEC_TO_TIMEVAL(&pktHdr.ts, &packet_timestamp);
+	if (!m_AppendMode)
+		pcap_dump((uint8_t*)m_PcapDumpHandler, &pktHdr, ((RawPacket&)packet).getRawData());
+	else
+	{
+		// Below are actually the lines run by pcap_dump. The reason I had to put them instead pcap_dump is that on Windows using WinPcap/Npcap
+		// you can't pass pointers between libraries compiled with different compilers. In this case - PcapPlusPlus and WinPcap/Npcap weren't
+		// compiled with the same compiler so it's impossible to fopen a file in PcapPlusPlus, pass the pointer to WinPcap/Npcap and use the
+		// FILE* pointer there. Doing this throws an exception. So the only option when implementing append to pcap is to write all relevant
+		// WinPcap/Npcap code that handles opening/closing/writing to pcap files inside PcapPlusPlus code
+
+		// the reason to create this packet_header struct is timeval has different sizes in 32-bit and 64-bit systems,
+		// but pcap format uses the 32-bit timeval version, so we need to align timeval to that
+		packet_header pktHdrTemp;
+		pktHdrTemp.tv_sec = pktHdr.ts.tv_sec;
+		pktHdrTemp.tv_usec = pktHdr.ts.tv_usec;
+		pktHdrTemp.caplen = pktHdr.caplen;
+		pktHdrTemp.len = pktHdr.len;
+		fwrite(&pktHdrTemp, sizeof(pktHdrTemp), 1, m_File);
+		fwrite(((RawPacket&)packet).getRawData(), pktHdrTemp.caplen, 1, m_File);
+	}
+
+	// the on-disk record header is the same in both modes
+	uint64_t recordLength = sizeof(packet_header) + pktHdr.caplen;
+	if (m_Index != NULL)
+	{
+		timespec fileTimestamp;
+		TIMEVAL_TO_TIMESPEC(&pktHdr.ts, &fileTimestamp);
+		m_Index->addPacket(m_FileOffset, recordLength, fileTimestamp, getIndexedFlowHash(m_Index, packet));
+	}
+	m_FileOffset += recordLength;
+
+	LOG_DEBUG("Packet written successfully to '%s'", m_FileName);
+	m_NumOfPacketsWritten++;
+	return true;
+}
+
+bool PcapFileWriterDevice::writePackets(const RawPacketVector& packets)
+{
+	for (RawPacketVector::ConstVectorIterator iter = packets.begin(); iter != packets.end(); iter++)
+	{
+		if (!writePacket(**iter))
+			return false;
+	}
+
+	return true;
+}
+
+bool PcapFileWriterDevice::open()
+{
+	if (m_PcapDescriptor != NULL)
+	{
+		LOG_DEBUG("Pcap descriptor already opened. Nothing to do");
+		return true;
+	}
+
+	switch(m_PcapLinkLayerType)
+	{
+		case LINKTYPE_RAW:
+		case LINKTYPE_DLT_RAW2:
+			LOG_ERROR("The only Raw IP link type supported in libpcap/WinPcap/Npcap is LINKTYPE_DLT_RAW1, please use that instead");
+			return false;
+		default:
+			break;
+	}
+
+	m_NumOfPacketsNotWritten = 0;
+	m_NumOfPacketsWritten = 0;
+	m_FileOffset = sizeof(pcap_file_header);
+
+	m_PcapDescriptor = pcap_open_dead(m_PcapLinkLayerType, PCPP_MAX_PACKET_SIZE);
+	if (m_PcapDescriptor == NULL)
+	{
+		LOG_ERROR("Error opening file writer device for file '%s': pcap_open_dead returned NULL", m_FileName);
+		m_DeviceOpened = false;
+		return false;
+	}
+
+
+	m_PcapDumpHandler = pcap_dump_open(m_PcapDescriptor, m_FileName);
+	if (m_PcapDumpHandler == NULL)
+	{
+		LOG_ERROR("Error opening file writer device for file '%s': pcap_dump_open returned NULL with error: '%s'",
+				m_FileName, pcap_geterr(m_PcapDescriptor));
+		m_DeviceOpened = false;
+		return false;
+	}
+
+	m_DeviceOpened = true;
+	LOG_DEBUG("File writer device for file '%s' opened successfully", m_FileName);
+	return true;
+}
+
+void PcapFileWriterDevice::flush()
+{
+	if (!m_DeviceOpened)
+		return;
+
+	if (!m_AppendMode && pcap_dump_flush(m_PcapDumpHandler) == -1)
+	{
+		LOG_ERROR("Error while flushing the packets to file");
+	}
+	// in append mode it's impossible to use pcap_dump_flush, see comment above pcap_dump
+	else if (m_AppendMode && fflush(m_File) == EOF)
+	{
+		LOG_ERROR("Error while flushing the packets to file");
+	}
+
+}
+
+void PcapFileWriterDevice::close()
+{
+	if (!m_DeviceOpened)
+		return;
+
+	flush();
+
+	IFileDevice::close();
+
+	if (!m_AppendMode && m_PcapDumpHandler != NULL)
+	{
+		pcap_dump_close(m_PcapDumpHandler);
+	}
+	else if (m_AppendMode && m_File != NULL)
+	{
+		// in append mode it's impossible to use pcap_dump_close, see comment above pcap_dump
+		fclose(m_File);
+	}
+
+	m_PcapDumpHandler = NULL;
+	m_File = NULL;
+	LOG_DEBUG("File writer closed for file '%s'", m_FileName);
+}
+
+void PcapFileWriterDevice::getStatistics(PcapStats& stats) const
+{
+	stats.packetsRecv = m_NumOfPacketsWritten;
+	stats.packetsDrop = m_NumOfPacketsNotWritten;
+	stats.packetsDropByInterface = 0;
+	LOG_DEBUG("Statistics received for writer device for filename '%s'", m_FileName);
+}
+
+bool PcapFileWriterDevice::open(bool appendMode)
+{
+	if (!appendMode)
+		return open();
+
+	m_AppendMode = appendMode;
+
+#if !defined(WIN32) && !defined(WINx64)
+	m_File = fopen(m_FileName, "r+");
+#else
+	m_File = fopen(m_FileName, "rb+");
+#endif
+
+	if (m_File == NULL)
+	{
+		LOG_ERROR("Cannot open '%s' for reading and writing", m_FileName);
+		return false;
+	}
+
+	pcap_file_header pcapFileHeader;
+	int amountRead = fread(&pcapFileHeader, 1, sizeof(pcapFileHeader), m_File);
+	if (amountRead != sizeof(pcap_file_header))
 	{
 		if (ferror(m_File))
 			LOG_ERROR("Cannot read pcap header from file '%s', error was: %d", m_FileName, errno);
@@ -602,6 +1295,8 @@ bool PcapFileWriterDevice::open(bool appendMode)
 		return false;
 	}
 
+	m_FileOffset = (uint64_t)ftell(m_File);
+
 	m_PcapDumpHandler = ((pcap_dumper_t *)m_File);
 
 	m_DeviceOpened = true;
@@ -610,6 +1305,515 @@ bool PcapFileWriterDevice::open(bool appendMode)
 }
 
 
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// AsyncPcapFileWriterDevice members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#define ASYNC_WRITER_MIN_BUFFER_SIZE (256 * 1024)
+
+AsyncPcapFileWriterDevice::AsyncPcapFileWriterDevice(const char* fileName, LinkLayerType linkLayerType, const AsyncWriterConfig& config) :
+	IFileWriterDevice(fileName), m_PcapLinkLayerType(linkLayerType), m_Config(config)
+{
+	// a buffer must fit the largest packet even after the partial block kept by flush()
+	if (m_Config.bufferSize < ASYNC_WRITER_MIN_BUFFER_SIZE)
+		m_Config.bufferSize = ASYNC_WRITER_MIN_BUFFER_SIZE;
+	m_Config.bufferSize = (m_Config.bufferSize + Alignment - 1) & ~((size_t)Alignment - 1);
+	if (m_Config.numOfBuffers < 2)
+		m_Config.numOfBuffers = 2;
+
+	m_Fd = -1;
+	m_DirectIO = false;
+	m_CurBuffer = NULL;
+	m_CurLength = 0;
+	m_CurFileOffset = 0;
+	m_PendingTailLength = 0;
+	m_Index = NULL;
+	m_NumOfPacketsDropped = 0;
+	m_NumOfBackpressureWaits = 0;
+	m_IoThreadStarted = false;
+	m_IoBusy = false;
+	m_StopIo = false;
+	m_IoError = false;
+	m_IoErrorSeen = false;
+
+	pthread_mutex_init(&m_Mutex, NULL);
+	pthread_cond_init(&m_BufferReadyCond, NULL);
+	pthread_cond_init(&m_BufferFreeCond, NULL);
+}
+
+AsyncPcapFileWriterDevice::~AsyncPcapFileWriterDevice()
+{
+	close();
+
+	pthread_mutex_destroy(&m_Mutex);
+	pthread_cond_destroy(&m_BufferReadyCond);
+	pthread_cond_destroy(&m_BufferFreeCond);
+}
+
+bool AsyncPcapFileWriterDevice::open()
+{
+	return open(false);
+}
+
+bool AsyncPcapFileWriterDevice::open(bool appendMode)
+{
+	if (m_DeviceOpened)
+	{
+		LOG_DEBUG("Async file writer device already opened. Nothing to do");
+		return true;
+	}
+
+	m_NumOfPacketsNotWritten = 0;
+	m_NumOfPacketsWritten = 0;
+	m_NumOfPacketsDropped = 0;
+	m_NumOfBackpressureWaits = 0;
+	m_CurLength = 0;
+	m_PendingTailLength = 0;
+	m_StopIo = false;
+	m_IoError = false;
+	m_IoErrorSeen = false;
+
+	if (!openFile(appendMode))
+	{
+		releaseResources();
+		return false;
+	}
+
+	if (pthread_create(&m_IoThread, NULL, ioThreadMain, this) != 0)
+	{
+		LOG_ERROR("Cannot start the I/O thread of file writer device for file '%s'", m_FileName);
+		releaseResources();
+		return false;
+	}
+
+	m_IoThreadStarted = true;
+	m_DeviceOpened = true;
+	LOG_DEBUG("Async file writer device for file '%s' opened successfully%s", m_FileName, (appendMode ? " in append mode" : ""));
+	return true;
+}
+
+bool AsyncPcapFileWriterDevice::openFile(bool appendMode)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+
+	LOG_ERROR("Async file writer device is not supported on this platform");
+	return false;
+
+#else
+
+	m_Fd = ::open(m_FileName, O_RDWR | (appendMode ? 0 : O_CREAT | O_TRUNC), 0644);
+	if (m_Fd < 0)
+	{
+		LOG_ERROR("Cannot open '%s' for writing: %s", m_FileName, strerror(errno));
+		return false;
+	}
+
+	for (int i = 0; i < m_Config.numOfBuffers; i++)
+	{
+		void* buffer = NULL;
+		if (posix_memalign(&buffer, Alignment, m_Config.bufferSize) != 0)
+		{
+			LOG_ERROR("Cannot allocate write buffers for file '%s'", m_FileName);
+			return false;
+		}
+		m_AllBuffers.push_back((uint8_t*)buffer);
+	}
+	m_FreeBuffers = m_AllBuffers;
+
+	if (appendMode)
+	{
+		pcap_file_header pcapFileHeader;
+		struct stat fileStat;
+		if (pread(m_Fd, &pcapFileHeader, sizeof(pcapFileHeader), 0) != (ssize_t)sizeof(pcapFileHeader) || fstat(m_Fd, &fileStat) != 0)
+		{
+			LOG_ERROR("Cannot read pcap header from file '%s'", m_FileName);
+			return false;
+		}
+
+		// packets are written with microsecond timestamps in host byte order, like PcapFileWriterDevice writes them
+		if (pcapFileHeader.magic != 0xa1b2c3d4)
+		{
+			LOG_ERROR("File '%s' is not a pcap file with microsecond precision in host byte order", m_FileName);
+			return false;
+		}
+
+		LinkLayerType linkLayerType = static_cast<LinkLayerType>(pcapFileHeader.linktype);
+		if (linkLayerType != m_PcapLinkLayerType)
+		{
+			LOG_ERROR("Pcap file has a different link layer type than the one chosen in AsyncPcapFileWriterDevice c'tor, %d, %d", linkLayerType, m_PcapLinkLayerType);
+			return false;
+		}
+
+		// writing starts at the beginning of the last block, so the partial block at the end of the file is written again
+		uint64_t fileSize = (uint64_t)fileStat.st_size;
+		m_CurFileOffset = fileSize & ~((uint64_t)Alignment - 1);
+		m_PendingTailLength = (size_t)(fileSize - m_CurFileOffset);
+		if (m_PendingTailLength > 0 && pread(m_Fd, m_PendingTail, m_PendingTailLength, (off_t)m_CurFileOffset) != (ssize_t)m_PendingTailLength)
+		{
+			LOG_ERROR("Cannot read the end of file '%s', error was: %s", m_FileName, strerror(errno));
+			return false;
+		}
+	}
+	else
+	{
+		pcap_file_header pcapFileHeader;
+		pcapFileHeader.magic = 0xa1b2c3d4;
+		pcapFileHeader.version_major = 2;
+		pcapFileHeader.version_minor = 4;
+		pcapFileHeader.thiszone = 0;
+		pcapFileHeader.sigfigs = 0;
+		pcapFileHeader.snaplen = PCPP_MAX_PACKET_SIZE;
+		pcapFileHeader.linktype = (uint32_t)m_PcapLinkLayerType;
+
+		m_CurFileOffset = 0;
+		memcpy(m_PendingTail, &pcapFileHeader, sizeof(pcapFileHeader));
+		m_PendingTailLength = sizeof(pcapFileHeader);
+	}
+
+	// the file header and the end of the file were read without O_DIRECT, from now on the file is only written in whole blocks
+	m_DirectIO = false;
+	if (m_Config.directIO)
+	{
+#ifdef O_DIRECT
+		int flags = fcntl(m_Fd, F_GETFL);
+		m_DirectIO = (flags != -1 && fcntl(m_Fd, F_SETFL, flags | O_DIRECT) == 0);
+#endif
+		if (!m_DirectIO)
+			LOG_DEBUG("O_DIRECT is not supported for file '%s', writing through the page cache", m_FileName);
+	}
+
+	// the first buffer starts with the file header or the end of the file
+	return acquireBuffer(false);
+
+#endif
+}
+
+void AsyncPcapFileWriterDevice::releaseResources()
+{
+#if !defined(WIN32) && !defined(WINx64) && !defined(PCAPPP_MINGW_ENV)
+	if (m_Fd >= 0)
+		::close(m_Fd);
+
+	for (std::vector<uint8_t*>::iterator iter = m_AllBuffers.begin(); iter != m_AllBuffers.end(); iter++)
+		free(*iter);
+#endif
+
+	m_Fd = -1;
+	m_AllBuffers.clear();
+	m_FreeBuffers.clear();
+	m_FullBuffers.clear();
+	m_CurBuffer = NULL;
+	m_CurLength = 0;
+	m_DirectIO = false;
+}
+
+bool AsyncPcapFileWriterDevice::acquireBuffer(bool wait)
+{
+	pthread_mutex_lock(&m_Mutex);
+	if (m_FreeBuffers.empty() && wait)
+	{
+		m_NumOfBackpressureWaits++;
+		while (m_FreeBuffers.empty())
+			pthread_cond_wait(&m_BufferFreeCond, &m_Mutex);
+	}
+
+	m_IoErrorSeen = m_IoError;
+	if (m_FreeBuffers.empty())
+	{
+		pthread_mutex_unlock(&m_Mutex);
+		return false;
+	}
+
+	m_CurBuffer = m_FreeBuffers.back();
+	m_FreeBuffers.pop_back();
+	pthread_mutex_unlock(&m_Mutex);
+
+	memcpy(m_CurBuffer, m_PendingTail, m_PendingTailLength);
+	m_CurLength = m_PendingTailLength;
+	m_PendingTailLength = 0;
+	return true;
+}
+
+void AsyncPcapFileWriterDevice::submitBuffer()
+{
+	if (m_CurBuffer == NULL)
+		return;
+
+	WriteBuffer buffer;
+	buffer.data = m_CurBuffer;
+	buffer.length = m_CurLength;
+	buffer.fileOffset = m_CurFileOffset;
+
+	// a partial block at the end of the buffer goes to the beginning of the next buffer which will overwrite that block.
+	// Without O_DIRECT the file is written as is and nothing is written twice
+	size_t tailLength = (m_DirectIO ? m_CurLength % Alignment : 0);
+	memcpy(m_PendingTail, m_CurBuffer + m_CurLength - tailLength, tailLength);
+	m_PendingTailLength = tailLength;
+	m_CurFileOffset += m_CurLength - tailLength;
+	m_CurBuffer = NULL;
+	m_CurLength = 0;
+
+	pthread_mutex_lock(&m_Mutex);
+	m_FullBuffers.push_back(buffer);
+	pthread_cond_signal(&m_BufferReadyCond);
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+void AsyncPcapFileWriterDevice::waitForIo()
+{
+	pthread_mutex_lock(&m_Mutex);
+	while (!m_FullBuffers.empty() || m_IoBusy)
+		pthread_cond_wait(&m_BufferFreeCond, &m_Mutex);
+	m_IoErrorSeen = m_IoError;
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+bool AsyncPcapFileWriterDevice::appendPacket(RawPacket const& packet)
+{
+	packet_header pktHdr;
+	timespec packetTimestamp = packet.getPacketTimeStamp();
+	pktHdr.tv_sec = (uint32_t)packetTimestamp.tv_sec;
+	pktHdr.tv_usec = (uint32_t)(packetTimestamp.tv_nsec / 1000);
+	pktHdr.caplen = (uint32_t)packet.getRawDataLen();
+	pktHdr.len = (uint32_t)packet.getFrameLength();
+
+	size_t recordLength = sizeof(pktHdr) + pktHdr.caplen;
+	if (recordLength > m_Config.bufferSize - Alignment)
+	{
+		LOG_ERROR("Packet of %d bytes is larger than the write buffer", (int)pktHdr.caplen);
+		m_NumOfPacketsNotWritten++;
+		return false;
+	}
+
+	// when dropping, drop the packet before any of it is copied if it needs a buffer that isn't free
+	if (m_Config.dropWhenFull && (m_CurBuffer == NULL || m_Config.bufferSize - m_CurLength < recordLength))
+	{
+		pthread_mutex_lock(&m_Mutex);
+		bool hasFreeBuffer = !m_FreeBuffers.empty();
+		pthread_mutex_unlock(&m_Mutex);
+		if (!hasFreeBuffer)
+		{
+			m_NumOfPacketsDropped++;
+			m_NumOfPacketsNotWritten++;
+			return false;
+		}
+	}
+
+	// the record starts right after the data already buffered (or kept from the last partial block)
+	uint64_t recordOffset = m_CurFileOffset + (m_CurBuffer != NULL ? m_CurLength : m_PendingTailLength);
+
+	// the record may span two buffers, the file is a stream of bytes
+	const uint8_t* parts[2] = { (const uint8_t*)&pktHdr, packet.getRawData() };
+	size_t partLengths[2] = { sizeof(pktHdr), pktHdr.caplen };
+	for (int i = 0; i < 2; i++)
+	{
+		size_t copied = 0;
+		while (copied < partLengths[i])
+		{
+			if (m_CurBuffer == NULL)
+				acquireBuffer(true);
+
+			size_t length = std::min(partLengths[i] - copied, m_Config.bufferSize - m_CurLength);
+			memcpy(m_CurBuffer + m_CurLength, parts[i] + copied, length);
+			m_CurLength += length;
+			copied += length;
+
+			if (m_CurLength == m_Config.bufferSize)
+				submitBuffer();
+		}
+	}
+
+	if (m_Index != NULL)
+	{
+		timespec fileTimestamp;
+		fileTimestamp.tv_sec = pktHdr.tv_sec;
+		fileTimestamp.tv_nsec = pktHdr.tv_usec * 1000;
+		m_Index->addPacket(recordOffset, recordLength, fileTimestamp, getIndexedFlowHash(m_Index, packet));
+	}
+
+	m_NumOfPacketsWritten++;
+	return true;
+}
+
+bool AsyncPcapFileWriterDevice::writePacket(RawPacket const& packet)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device not opened");
+		m_NumOfPacketsNotWritten++;
+		return false;
+	}
+
+	if (packet.getLinkLayerType() != m_PcapLinkLayerType)
+	{
+		LOG_ERROR("Cannot write a packet with a different link layer type");
+		m_NumOfPacketsNotWritten++;
+		return false;
+	}
+
+	if (m_IoErrorSeen)
+	{
+		m_NumOfPacketsNotWritten++;
+		return false;
+	}
+
+	return appendPacket(packet);
+}
+
+bool AsyncPcapFileWriterDevice::writePackets(const RawPacketVector& packets)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device not opened");
+		m_NumOfPacketsNotWritten += packets.size();
+		return false;
+	}
+
+	for (RawPacketVector::ConstVectorIterator iter = packets.begin(); iter != packets.end(); iter++)
+	{
+		if ((*iter)->getLinkLayerType() != m_PcapLinkLayerType)
+		{
+			LOG_ERROR("Cannot write a packet with a different link layer type");
+			m_NumOfPacketsNotWritten += packets.size();
+			return false;
+		}
+	}
+
+	if (m_IoErrorSeen)
+	{
+		m_NumOfPacketsNotWritten += packets.size();
+		return false;
+	}
+
+	bool result = true;
+	for (RawPacketVector::ConstVectorIterator iter = packets.begin(); iter != packets.end(); iter++)
+	{
+		if (!appendPacket(**iter))
+			result = false;
+	}
+
+	return result;
+}
+
+void AsyncPcapFileWriterDevice::flush()
+{
+	if (!m_DeviceOpened)
+		return;
+
+	if (m_CurLength > 0)
+		submitBuffer();
+	waitForIo();
+
+	if (m_IoErrorSeen)
+		LOG_ERROR("Error while flushing the packets to file");
+}
+
+void AsyncPcapFileWriterDevice::close()
+{
+	if (!m_DeviceOpened)
+		return;
+
+	if (m_CurLength > 0)
+		submitBuffer();
+
+	pthread_mutex_lock(&m_Mutex);
+	m_StopIo = true;
+	pthread_cond_signal(&m_BufferReadyCond);
+	pthread_mutex_unlock(&m_Mutex);
+
+	if (m_IoThreadStarted)
+		pthread_join(m_IoThread, NULL);
+	m_IoThreadStarted = false;
+
+	// a buffer still held by the caller only contains the end of the file which is already written
+	releaseResources();
+	IFileDevice::close();
+	LOG_DEBUG("Async file writer closed for file '%s'", m_FileName);
+}
+
+void AsyncPcapFileWriterDevice::getStatistics(PcapStats& stats) const
+{
+	stats.packetsRecv = m_NumOfPacketsWritten;
+	stats.packetsDrop = m_NumOfPacketsNotWritten;
+	stats.packetsDropByInterface = 0;
+	LOG_DEBUG("Statistics received for async writer device for filename '%s'", m_FileName);
+}
+
+bool AsyncPcapFileWriterDevice::writeBufferToFile(const WriteBuffer& buffer)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	return false;
+#else
+	// with O_DIRECT the length must be a multiple of the block size, the file is truncated to its real size afterwards
+	size_t writeLength = buffer.length;
+	if (m_DirectIO && writeLength % Alignment != 0)
+	{
+		writeLength = (writeLength + Alignment - 1) & ~((size_t)Alignment - 1);
+		memset(buffer.data + buffer.length, 0, writeLength - buffer.length);
+	}
+
+	size_t written = 0;
+	while (written < writeLength)
+	{
+		ssize_t result = pwrite(m_Fd, buffer.data + written, writeLength - written, (off_t)(buffer.fileOffset + written));
+		if (result < 0 && errno == EINTR)
+			continue;
+		if (result <= 0)
+		{
+			LOG_ERROR("Error writing to file '%s': %s", m_FileName, strerror(errno));
+			return false;
+		}
+		written += (size_t)result;
+	}
+
+	if (writeLength != buffer.length && ftruncate(m_Fd, (off_t)(buffer.fileOffset + buffer.length)) != 0)
+	{
+		LOG_ERROR("Error truncating file '%s': %s", m_FileName, strerror(errno));
+		return false;
+	}
+
+	return true;
+#endif
+}
+
+void AsyncPcapFileWriterDevice::ioThreadLoop()
+{
+	pthread_mutex_lock(&m_Mutex);
+	while (true)
+	{
+		while (m_FullBuffers.empty() && !m_StopIo)
+			pthread_cond_wait(&m_BufferReadyCond, &m_Mutex);
+
+		if (m_FullBuffers.empty())
+			break;
+
+		WriteBuffer buffer = m_FullBuffers.front();
+		m_FullBuffers.pop_front();
+		m_IoBusy = true;
+		bool skipWrite = m_IoError;
+		pthread_mutex_unlock(&m_Mutex);
+
+		// after an error the buffers are only recycled so the caller doesn't block forever
+		bool success = (skipWrite || writeBufferToFile(buffer));
+
+		pthread_mutex_lock(&m_Mutex);
+		m_IoBusy = false;
+		if (!success)
+			m_IoError = true;
+		m_FreeBuffers.push_back(buffer.data);
+		pthread_cond_broadcast(&m_BufferFreeCond);
+	}
+
+	pthread_mutex_unlock(&m_Mutex);
+}
+
+void* AsyncPcapFileWriterDevice::ioThreadMain(void* device)
+{
+	((AsyncPcapFileWriterDevice*)device)->ioThreadLoop();
+	return NULL;
+}
+
+
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // PcapNgFileWriterDevice members
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
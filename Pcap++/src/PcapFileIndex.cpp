@@ -0,0 +1,341 @@
+#define LOG_MODULE PcapLogModuleFileDevice
+
+#include <stdio.h>
+#include <string.h>
+#include "PcapFileIndex.h"
+#include "Packet.h"
+#include "PacketUtils.h"
+#include "Logger.h"
+
+// "PCPPIDX" followed by the format version
+#define PCAP_FILE_INDEX_MAGIC "PCPPIDX\x01"
+#define PCAP_FILE_INDEX_MAGIC_LENGTH 8
+
+namespace pcpp
+{
+
+static inline bool isTimestampEarlier(const timespec& first, const timespec& second)
+{
+	return first.tv_sec < second.tv_sec || (first.tv_sec == second.tv_sec && first.tv_nsec < second.tv_nsec);
+}
+
+PcapFileIndex::PcapFileIndex(const IndexConfig& config) : m_Config(config)
+{
+	clear();
+}
+
+void PcapFileIndex::clear()
+{
+	m_Entries.clear();
+	m_PcapNgBlocks.clear();
+	m_FlowRecords.clear();
+	m_NumOfPackets = 0;
+	m_IndexedLength = 0;
+	m_MaxTimestamp.tv_sec = 0;
+	m_MaxTimestamp.tv_nsec = 0;
+}
+
+void PcapFileIndex::addPacket(uint64_t recordOffset, uint64_t recordLength, const timespec& timestamp, uint32_t flowHash)
+{
+	bool isIndexed = m_Entries.empty();
+	if (!isIndexed && m_Config.packetInterval > 0 && m_NumOfPackets - m_Entries.back().packetNumber >= m_Config.packetInterval)
+		isIndexed = true;
+	if (!isIndexed && m_Config.timeInterval > 0 && timestamp.tv_sec - m_Entries.back().timestamp.tv_sec >= (time_t)m_Config.timeInterval)
+		isIndexed = true;
+
+	if (isIndexed)
+	{
+		IndexEntry entry;
+		entry.packetNumber = m_NumOfPackets;
+		entry.recordOffset = recordOffset;
+		entry.timestamp = timestamp;
+		entry.maxTimestampBefore = m_MaxTimestamp;
+		m_Entries.push_back(entry);
+	}
+
+	if (m_Config.indexFlows)
+		m_FlowRecords[flowHash].push_back(recordOffset);
+
+	if (m_NumOfPackets == 0 || isTimestampEarlier(m_MaxTimestamp, timestamp))
+		m_MaxTimestamp = timestamp;
+
+	m_NumOfPackets++;
+	m_IndexedLength = recordOffset + recordLength;
+}
+
+void PcapFileIndex::addPcapNgBlock(uint64_t offset, bool isSectionHeader)
+{
+	PcapNgBlock block;
+	block.offset = offset;
+	block.isSectionHeader = isSectionHeader;
+	m_PcapNgBlocks.push_back(block);
+}
+
+void PcapFileIndex::getPcapNgBlocksBefore(uint64_t offset, std::vector<PcapNgBlock>& blocks) const
+{
+	blocks.clear();
+	for (std::vector<PcapNgBlock>::const_iterator iter = m_PcapNgBlocks.begin(); iter != m_PcapNgBlocks.end() && iter->offset < offset; iter++)
+	{
+		// interface IDs are local to a section, so only the last section matters
+		if (iter->isSectionHeader)
+			blocks.clear();
+		blocks.push_back(*iter);
+	}
+}
+
+bool PcapFileIndex::build(const std::string& fileName)
+{
+	MmapPcapFileReaderDevice reader(fileName.c_str());
+	if (!reader.open())
+		return false;
+
+	if (m_IndexedLength > 0 && !reader.setReadOffset(m_IndexedLength, *this))
+	{
+		LOG_ERROR("File '%s' is shorter than its index", fileName.c_str());
+		return false;
+	}
+
+	// new pcap-ng section and interface blocks are detected by comparing the reader state before and after each record
+	uint64_t sectionOffset = (uint64_t)-1;
+	size_t numOfInterfaces = 0;
+	if (reader.m_IsPcapNg && m_IndexedLength > 0)
+	{
+		sectionOffset = reader.m_PcapNgSectionOffset;
+		numOfInterfaces = reader.m_PcapNgInterfaces.size();
+	}
+
+	RawPacket rawPacket;
+	rawPacket.setDeleteRawDataAtDestructor(false);
+
+	const uint8_t* packetData;
+	uint32_t capturedLength, frameLength;
+	timespec timestamp;
+	LinkLayerType linkType;
+	uint64_t numOfPacketsBefore = m_NumOfPackets;
+	while (reader.getNextRecord(packetData, capturedLength, frameLength, timestamp, linkType))
+	{
+		if (reader.m_IsPcapNg)
+		{
+			if (reader.m_PcapNgSectionOffset != sectionOffset)
+			{
+				sectionOffset = reader.m_PcapNgSectionOffset;
+				numOfInterfaces = 0;
+				addPcapNgBlock(sectionOffset, true);
+			}
+
+			for (; numOfInterfaces < reader.m_PcapNgInterfaces.size(); numOfInterfaces++)
+				addPcapNgBlock(reader.m_PcapNgInterfaces[numOfInterfaces].blockOffset, false);
+		}
+
+		uint32_t flowHash = 0;
+		if (m_Config.indexFlows)
+		{
+			rawPacket.setRawData(packetData, capturedLength, timestamp, linkType, frameLength);
+			Packet packet(&rawPacket, OsiModelTransportLayer);
+			flowHash = hash5Tuple(&packet);
+		}
+
+		addPacket(reader.m_RecordOffset, reader.m_ReadOffset - reader.m_RecordOffset, timestamp, flowHash);
+	}
+
+	LOG_DEBUG("Indexed %d packets of file '%s'", (int)(m_NumOfPackets - numOfPacketsBefore), fileName.c_str());
+	return true;
+}
+
+const std::vector<uint64_t>* PcapFileIndex::getFlowRecords(uint32_t flowHash) const
+{
+	std::map<uint32_t, std::vector<uint64_t> >::const_iterator iter = m_FlowRecords.find(flowHash);
+	if (iter == m_FlowRecords.end())
+		return NULL;
+
+	return &iter->second;
+}
+
+bool PcapFileIndex::findEntryByTime(const timespec& timestamp, IndexEntry& entry) const
+{
+	if (m_Entries.empty())
+		return false;
+
+	// maxTimestampBefore never decreases, so the last entry whose previous packets are all earlier than the timestamp is found by binary search
+	size_t low = 0, high = m_Entries.size();
+	while (high - low > 1)
+	{
+		size_t middle = low + (high - low) / 2;
+		if (isTimestampEarlier(m_Entries[middle].maxTimestampBefore, timestamp))
+			low = middle;
+		else
+			high = middle;
+	}
+
+	entry = m_Entries[low];
+	return true;
+}
+
+bool PcapFileIndex::findEntryByPacket(uint64_t packetNumber, IndexEntry& entry) const
+{
+	if (m_Entries.empty() || packetNumber >= m_NumOfPackets)
+		return false;
+
+	size_t low = 0, high = m_Entries.size();
+	while (high - low > 1)
+	{
+		size_t middle = low + (high - low) / 2;
+		if (m_Entries[middle].packetNumber <= packetNumber)
+			low = middle;
+		else
+			high = middle;
+	}
+
+	entry = m_Entries[low];
+	return true;
+}
+
+static bool writeIndexValue(FILE* file, uint64_t value)
+{
+	return fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+static bool readIndexValue(FILE* file, uint64_t& value)
+{
+	return fread(&value, sizeof(value), 1, file) == 1;
+}
+
+bool PcapFileIndex::save(const std::string& indexFileName) const
+{
+	FILE* file = fopen(indexFileName.c_str(), "wb");
+	if (file == NULL)
+	{
+		LOG_ERROR("Cannot open index file '%s' for writing", indexFileName.c_str());
+		return false;
+	}
+
+	// all values are written as native 64-bit integers, index files aren't meant to move between machines of different byte order
+	bool result = (fwrite(PCAP_FILE_INDEX_MAGIC, 1, PCAP_FILE_INDEX_MAGIC_LENGTH, file) == PCAP_FILE_INDEX_MAGIC_LENGTH);
+	result = result && writeIndexValue(file, m_Config.packetInterval);
+	result = result && writeIndexValue(file, m_Config.timeInterval);
+	result = result && writeIndexValue(file, m_Config.indexFlows ? 1 : 0);
+	result = result && writeIndexValue(file, m_NumOfPackets);
+	result = result && writeIndexValue(file, m_IndexedLength);
+	result = result && writeIndexValue(file, (uint64_t)m_MaxTimestamp.tv_sec);
+	result = result && writeIndexValue(file, (uint64_t)m_MaxTimestamp.tv_nsec);
+
+	result = result && writeIndexValue(file, m_Entries.size());
+	for (std::vector<IndexEntry>::const_iterator iter = m_Entries.begin(); result && iter != m_Entries.end(); iter++)
+	{
+		result = result && writeIndexValue(file, iter->packetNumber);
+		result = result && writeIndexValue(file, iter->recordOffset);
+		result = result && writeIndexValue(file, (uint64_t)iter->timestamp.tv_sec);
+		result = result && writeIndexValue(file, (uint64_t)iter->timestamp.tv_nsec);
+		result = result && writeIndexValue(file, (uint64_t)iter->maxTimestampBefore.tv_sec);
+		result = result && writeIndexValue(file, (uint64_t)iter->maxTimestampBefore.tv_nsec);
+	}
+
+	result = result && writeIndexValue(file, m_PcapNgBlocks.size());
+	for (std::vector<PcapNgBlock>::const_iterator iter = m_PcapNgBlocks.begin(); result && iter != m_PcapNgBlocks.end(); iter++)
+	{
+		result = result && writeIndexValue(file, iter->offset);
+		result = result && writeIndexValue(file, iter->isSectionHeader ? 1 : 0);
+	}
+
+	result = result && writeIndexValue(file, m_FlowRecords.size());
+	for (std::map<uint32_t, std::vector<uint64_t> >::const_iterator iter = m_FlowRecords.begin(); result && iter != m_FlowRecords.end(); iter++)
+	{
+		result = result && writeIndexValue(file, iter->first);
+		result = result && writeIndexValue(file, iter->second.size());
+		result = result && fwrite(&iter->second[0], sizeof(uint64_t), iter->second.size(), file) == iter->second.size();
+	}
+
+	if (fclose(file) != 0)
+		result = false;
+
+	if (!result)
+		LOG_ERROR("Cannot write index file '%s'", indexFileName.c_str());
+
+	return result;
+}
+
+bool PcapFileIndex::load(const std::string& indexFileName)
+{
+	clear();
+
+	FILE* file = fopen(indexFileName.c_str(), "rb");
+	if (file == NULL)
+	{
+		LOG_ERROR("Cannot open index file '%s'", indexFileName.c_str());
+		return false;
+	}
+
+	char magic[PCAP_FILE_INDEX_MAGIC_LENGTH];
+	uint64_t packetInterval = 0, timeInterval = 0, indexFlows = 0, maxTimestampSec = 0, maxTimestampNsec = 0, count = 0;
+	bool result = (fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, PCAP_FILE_INDEX_MAGIC, sizeof(magic)) == 0);
+	result = result && readIndexValue(file, packetInterval);
+	result = result && readIndexValue(file, timeInterval);
+	result = result && readIndexValue(file, indexFlows);
+	result = result && readIndexValue(file, m_NumOfPackets);
+	result = result && readIndexValue(file, m_IndexedLength);
+	result = result && readIndexValue(file, maxTimestampSec);
+	result = result && readIndexValue(file, maxTimestampNsec);
+
+	m_Config.packetInterval = (uint32_t)packetInterval;
+	m_Config.timeInterval = (uint32_t)timeInterval;
+	m_Config.indexFlows = (indexFlows != 0);
+	m_MaxTimestamp.tv_sec = (time_t)maxTimestampSec;
+	m_MaxTimestamp.tv_nsec = (long)maxTimestampNsec;
+
+	// counts are checked against the packet count so a corrupted file doesn't make this method allocate gigabytes
+	result = result && readIndexValue(file, count) && count <= m_NumOfPackets;
+	for (uint64_t i = 0; result && i < count; i++)
+	{
+		IndexEntry entry;
+		uint64_t values[6];
+		for (int j = 0; j < 6; j++)
+			result = result && readIndexValue(file, values[j]);
+
+		entry.packetNumber = values[0];
+		entry.recordOffset = values[1];
+		entry.timestamp.tv_sec = (time_t)values[2];
+		entry.timestamp.tv_nsec = (long)values[3];
+		entry.maxTimestampBefore.tv_sec = (time_t)values[4];
+		entry.maxTimestampBefore.tv_nsec = (long)values[5];
+		if (result)
+			m_Entries.push_back(entry);
+	}
+
+	result = result && readIndexValue(file, count) && count <= m_IndexedLength;
+	for (uint64_t i = 0; result && i < count; i++)
+	{
+		uint64_t offset = 0, isSectionHeader = 0;
+		result = result && readIndexValue(file, offset) && readIndexValue(file, isSectionHeader);
+		if (result)
+			addPcapNgBlock(offset, isSectionHeader != 0);
+	}
+
+	uint64_t numOfFlows = 0, numOfFlowRecords = 0;
+	result = result && readIndexValue(file, numOfFlows) && numOfFlows <= m_NumOfPackets;
+	for (uint64_t i = 0; result && i < numOfFlows; i++)
+	{
+		uint64_t flowHash = 0;
+		result = result && readIndexValue(file, flowHash) && readIndexValue(file, count);
+		numOfFlowRecords += count;
+		result = result && numOfFlowRecords <= m_NumOfPackets;
+		if (!result)
+			break;
+
+		std::vector<uint64_t>& records = m_FlowRecords[(uint32_t)flowHash];
+		records.resize((size_t)count);
+		result = (count == 0 || fread(&records[0], sizeof(uint64_t), (size_t)count, file) == count);
+	}
+
+	fclose(file);
+
+	if (!result)
+	{
+		LOG_ERROR("File '%s' is not a valid index file", indexFileName.c_str());
+		clear();
+		return false;
+	}
+
+	return true;
+}
+
+} // namespace pcpp
@@ -60,6 +60,8 @@ bool BpfFilterWrapper::setFilter(const std::string& filter, LinkLayerType linkTy
 			m_Program = newProg;
 			m_FilterStr = filter;
 			m_LinkType = linkType;
+			if (!m_ThreadedProgram.compile(m_Program))
+				LOG_DEBUG("Filter '%s' can't be translated to threaded code, using libpcap's interpreter", filter.c_str());
 		}
 	}
 
@@ -74,6 +76,7 @@ void BpfFilterWrapper::freeProgram()
 		delete m_Program;
 		m_Program = NULL;
 		m_FilterStr.clear();
+		m_ThreadedProgram.clear();
 	}
 }
 
@@ -87,11 +90,15 @@ bool BpfFilterWrapper::matchPacketWithFilter(const uint8_t* packetData, uint32_t
 	if (m_FilterStr.empty())
 		return true;
 
-	if (!setFilter(std::string(m_FilterStr), static_cast<LinkLayerType>(linkType)))
+	// setFilter() clears m_FilterStr before storing the new filter, so it must get a copy
+	if (linkType != m_LinkType && !setFilter(std::string(m_FilterStr), static_cast<LinkLayerType>(linkType)))
 	{
 		return false;
 	}
 
+	if (!m_ThreadedProgram.isEmpty())
+		return (m_ThreadedProgram.run(packetData, packetDataLength, packetDataLength) != 0);
+
 	struct pcap_pkthdr pktHdr;
 	pktHdr.caplen = packetDataLength;
 	pktHdr.len = packetDataLength;
@@ -11,6 +11,7 @@
 #include "Logger.h"
 #include "SystemUtils.h"
 #include <string.h>
+#include <errno.h>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -34,6 +35,10 @@
 #include <net/if_dl.h>
 #include <sys/sysctl.h>
 #endif
+#ifdef LINUX
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+#endif
 
 // On Mac OS X and FreeBSD timeout of -1 causes pcap_open_live to fail so value of 1ms is set here.
 // On Linux and Windows this is not the case so we keep the -1 value
@@ -53,6 +58,16 @@ struct PcapThread
 	pthread_t pthread;
 };
 
+// a thread of a multi-threaded capture and the descriptor it reads from
+struct FanoutCaptureThread
+{
+	PcapLiveDevice* device;
+	pcap_t* descriptor;
+	void* userCookie;
+	pthread_t pthread;
+	bool threadStarted;
+};
+
 #ifdef HAS_SET_DIRECTION_ENABLED
 static pcap_direction_t directionTypeMap(PcapLiveDevice::PcapDirection direction)
 {
@@ -133,6 +148,15 @@ PcapLiveDevice::PcapLiveDevice(pcap_if_t* pInterface, bool calculateMTU, bool ca
 	m_cbOnStatsUpdateUserCookie = NULL;
 	m_CaptureCallbackMode = true;
 	m_CapturedPackets = NULL;
+	m_cbOnPacketBurstArrives = NULL;
+	m_cbOnPacketBurstArrivesUserCookie = NULL;
+	m_BurstPackets = NULL;
+	m_BurstPacketsAllocated = false;
+	m_BurstSize = 0;
+	m_MaxBurstSize = 0;
+	m_BurstBuffer = NULL;
+	m_BurstBufferSize = 0;
+	m_BurstBufferOffset = 0;
 	if (calculateMacAddress)
 	{
 		setDeviceMacAddress();
@@ -197,7 +221,16 @@ void* PcapLiveDevice::captureThreadMain(void* ptr)
 	}
 
 	LOG_DEBUG("Started capture thread for device '%s'", pThis->m_Name);
-	if (pThis->m_CaptureCallbackMode)
+	if (pThis->m_cbOnPacketBurstArrives != NULL)
+	{
+		// a burst is the packets returned by one read of the capture buffer
+		while (!pThis->m_StopThread)
+		{
+			pcap_dispatch(pThis->m_PcapDescriptor, (int)pThis->m_MaxBurstSize, onPacketArrivesBurstMode, (uint8_t*)pThis);
+			pThis->flushPacketBurst();
+		}
+	}
+	else if (pThis->m_CaptureCallbackMode)
 	{
 		while (!pThis->m_StopThread)
 			pcap_dispatch(pThis->m_PcapDescriptor, -1, onPacketArrives, (uint8_t*)pThis);
@@ -211,6 +244,91 @@ void* PcapLiveDevice::captureThreadMain(void* ptr)
 	return 0;
 }
 
+void PcapLiveDevice::onPacketArrivesBurstMode(uint8_t* user, const struct pcap_pkthdr* pkthdr, const uint8_t* packet)
+{
+	PcapLiveDevice* pThis = (PcapLiveDevice*)user;
+	if (pThis == NULL)
+	{
+		LOG_ERROR("Unable to extract PcapLiveDevice instance");
+		return;
+	}
+
+	// the buffer fits maxBurstSize packets of snapshot length, this is only a safety net
+	if (pThis->m_BurstBufferOffset + pkthdr->caplen > pThis->m_BurstBufferSize)
+	{
+		pThis->flushPacketBurst();
+		if (pkthdr->caplen > pThis->m_BurstBufferSize)
+			return;
+	}
+
+	uint8_t* packetData = pThis->m_BurstBuffer + pThis->m_BurstBufferOffset;
+	memcpy(packetData, packet, pkthdr->caplen);
+	pThis->m_BurstPackets[pThis->m_BurstSize].setRawData(packetData, pkthdr->caplen, pkthdr->ts, pThis->getLinkType(), pkthdr->len);
+	pThis->m_BurstBufferOffset += pkthdr->caplen;
+	pThis->m_BurstSize++;
+
+	if (pThis->m_BurstSize == pThis->m_MaxBurstSize)
+		pThis->flushPacketBurst();
+}
+
+void PcapLiveDevice::flushPacketBurst()
+{
+	if (m_BurstSize == 0)
+		return;
+
+	m_cbOnPacketBurstArrives(m_BurstPackets, m_BurstSize, this, m_cbOnPacketBurstArrivesUserCookie);
+	m_BurstSize = 0;
+	m_BurstBufferOffset = 0;
+}
+
+void PcapLiveDevice::releasePacketBurst()
+{
+	if (m_BurstPacketsAllocated)
+	{
+		delete [] m_BurstPackets;
+	}
+	else if (m_BurstPackets != NULL)
+	{
+		// the user's packets shouldn't point to the freed buffer
+		for (size_t i = 0; i < m_MaxBurstSize; i++)
+			m_BurstPackets[i].clear();
+	}
+
+	delete [] m_BurstBuffer;
+	m_BurstPackets = NULL;
+	m_BurstPacketsAllocated = false;
+	m_BurstBuffer = NULL;
+	m_BurstBufferSize = 0;
+	m_BurstBufferOffset = 0;
+	m_BurstSize = 0;
+	m_MaxBurstSize = 0;
+	m_cbOnPacketBurstArrives = NULL;
+	m_cbOnPacketBurstArrivesUserCookie = NULL;
+}
+
+void PcapLiveDevice::onFanoutPacketArrives(uint8_t* user, const struct pcap_pkthdr* pkthdr, const uint8_t* packet)
+{
+	FanoutCaptureThread* thread = (FanoutCaptureThread*)user;
+	PcapLiveDevice* pThis = thread->device;
+
+	RawPacket rawPacket(packet, pkthdr->caplen, pkthdr->ts, false, pThis->getLinkType());
+
+	if (pThis->m_cbOnPacketArrives != NULL)
+		pThis->m_cbOnPacketArrives(&rawPacket, pThis, thread->userCookie);
+}
+
+void* PcapLiveDevice::fanoutCaptureThreadMain(void* ptr)
+{
+	FanoutCaptureThread* thread = (FanoutCaptureThread*)ptr;
+	PcapLiveDevice* pThis = thread->device;
+
+	LOG_DEBUG("Started fanout capture thread for device '%s'", pThis->m_Name);
+	while (!pThis->m_StopThread)
+		pcap_dispatch(thread->descriptor, -1, onFanoutPacketArrives, (uint8_t*)thread);
+	LOG_DEBUG("Ended fanout capture thread for device '%s'", pThis->m_Name);
+	return 0;
+}
+
 void* PcapLiveDevice::statsThreadMain(void* ptr)
 {
 	PcapLiveDevice* pThis = (PcapLiveDevice*)ptr;
@@ -346,6 +464,8 @@ bool PcapLiveDevice::open(const DeviceConfiguration& config)
 		return false;
 	}
 
+	m_DeviceConfig = config;
+
 	LOG_DEBUG("Device '%s' opened", m_Name);
 
 	m_DeviceOpened = true;
@@ -377,6 +497,7 @@ void PcapLiveDevice::close()
 	}
 
 	m_DeviceOpened = false;
+	m_CurrentFilter.clear();
 	LOG_DEBUG("Device '%s' closed", m_Name);
 }
 
@@ -525,6 +646,258 @@ int PcapLiveDevice::startCaptureBlockingMode(OnPacketArrivesStopBlocking onPacke
 	return 1;
 }
 
+bool PcapLiveDevice::startCaptureBurstMode(OnPacketBurstArrivesCallback onPacketBurstArrives, void* onPacketBurstArrivesUserCookie, size_t maxBurstSize, RawPacket* packetArray)
+{
+	if (!m_DeviceOpened || m_PcapDescriptor == NULL)
+	{
+		LOG_ERROR("Device '%s' not opened", m_Name);
+		return false;
+	}
+
+	if (m_CaptureThreadStarted)
+	{
+		LOG_ERROR("Device '%s' already capturing traffic", m_Name);
+		return false;
+	}
+
+	if (maxBurstSize == 0)
+	{
+		LOG_ERROR("Max burst size must be larger than 0");
+		return false;
+	}
+
+	int snapshotLength = pcap_snapshot(m_PcapDescriptor);
+	if (snapshotLength <= 0)
+		snapshotLength = DEFAULT_SNAPLEN;
+
+	m_MaxBurstSize = maxBurstSize;
+	m_BurstBufferSize = maxBurstSize * snapshotLength;
+	m_BurstBuffer = new uint8_t[m_BurstBufferSize];
+	m_BurstPacketsAllocated = (packetArray == NULL);
+	m_BurstPackets = (packetArray != NULL ? packetArray : new RawPacket[maxBurstSize]);
+	for (size_t i = 0; i < maxBurstSize; i++)
+	{
+		m_BurstPackets[i].clear();
+		m_BurstPackets[i].setDeleteRawDataAtDestructor(false);
+	}
+	m_BurstSize = 0;
+	m_BurstBufferOffset = 0;
+
+	m_cbOnPacketBurstArrives = onPacketBurstArrives;
+	m_cbOnPacketBurstArrivesUserCookie = onPacketBurstArrivesUserCookie;
+	int err = pthread_create(&(m_CaptureThread->pthread), NULL, getCaptureThreadStart(), (void*)this);
+	if (err != 0)
+	{
+		LOG_ERROR("Cannot create LiveCapture thread for device '%s': [%s]", m_Name, strerror(err));
+		releasePacketBurst();
+		return false;
+	}
+	m_CaptureThreadStarted = true;
+	LOG_DEBUG("Successfully created burst mode capture thread for device '%s'. Thread id: %s", m_Name, printThreadId(m_CaptureThread).c_str());
+
+	return true;
+}
+
+bool PcapLiveDevice::startCaptureMultiThread(OnPacketArrivesCallback onPacketArrives, const std::vector<void*>& onPacketArrivesUserCookies, CoreMask coreMask, const FanoutConfiguration& config)
+{
+	if (!m_DeviceOpened || m_PcapDescriptor == NULL)
+	{
+		LOG_ERROR("Device '%s' not opened", m_Name);
+		return false;
+	}
+
+	if (m_CaptureThreadStarted)
+	{
+		LOG_ERROR("Device '%s' already capturing traffic", m_Name);
+		return false;
+	}
+
+	if (onPacketArrivesUserCookies.empty())
+	{
+		LOG_ERROR("No user cookies were given, cannot tell how many capture threads to create");
+		return false;
+	}
+
+#if defined(LINUX) && defined(PACKET_FANOUT)
+	std::vector<SystemCore> cores;
+	if (coreMask != 0)
+		createCoreVectorFromCoreMask(coreMask, cores);
+
+	// the group ID is global to the network namespace, so the default one is taken from the process ID
+	static uint16_t nextGroupIdOffset = 0;
+	uint16_t groupId = config.groupId;
+	if (groupId == 0)
+		groupId = (uint16_t)(getpid() + nextGroupIdOffset++);
+
+	int fanoutType;
+	switch (config.mode)
+	{
+	case FanoutLoadBalance:
+		fanoutType = PACKET_FANOUT_LB;
+		break;
+	case FanoutCpu:
+		fanoutType = PACKET_FANOUT_CPU;
+		break;
+	default:
+		fanoutType = PACKET_FANOUT_HASH;
+		break;
+	}
+	if (config.defragment)
+		fanoutType |= PACKET_FANOUT_FLAG_DEFRAG;
+	int fanoutArg = (groupId | (fanoutType << 16));
+
+	// the device filter is compiled once and set on each descriptor before it joins the group, so it never gets packets that don't match
+	struct bpf_program filterProg;
+	filterProg.bf_insns = NULL;
+	if (!m_CurrentFilter.empty() && pcap_compile(m_PcapDescriptor, &filterProg, m_CurrentFilter.c_str(), 1, 0) < 0)
+	{
+		LOG_ERROR("Error compiling filter '%s' for multi-threaded capture. Error message is: %s", m_CurrentFilter.c_str(), pcap_geterr(m_PcapDescriptor));
+		return false;
+	}
+
+	// all descriptors join the group before any thread starts, so no thread gets packets meant for the others
+	bool descriptorsReady = true;
+	for (size_t i = 0; i < onPacketArrivesUserCookies.size() && descriptorsReady; i++)
+	{
+		FanoutCaptureThread* thread = new FanoutCaptureThread();
+		thread->device = this;
+		thread->userCookie = onPacketArrivesUserCookies[i];
+		thread->threadStarted = false;
+		thread->descriptor = doOpen(m_DeviceConfig);
+		m_FanoutThreads.push_back(thread);
+		if (thread->descriptor == NULL)
+		{
+			LOG_ERROR("Cannot open descriptor #%d of multi-threaded capture for device '%s'", (int)i, m_Name);
+			descriptorsReady = false;
+		}
+		else if (filterProg.bf_insns != NULL && pcap_setfilter(thread->descriptor, &filterProg) < 0)
+		{
+			LOG_ERROR("Cannot set filter on descriptor #%d of multi-threaded capture for device '%s'. Error message is: %s", (int)i, m_Name, pcap_geterr(thread->descriptor));
+			descriptorsReady = false;
+		}
+		else if (setsockopt(pcap_fileno(thread->descriptor), SOL_PACKET, PACKET_FANOUT, &fanoutArg, sizeof(fanoutArg)) != 0)
+		{
+			LOG_ERROR("Cannot join descriptor #%d to fanout group %d of device '%s': [%s]", (int)i, (int)groupId, m_Name, strerror(errno));
+			descriptorsReady = false;
+		}
+	}
+
+	if (filterProg.bf_insns != NULL)
+		pcap_freecode(&filterProg);
+
+	// the main descriptor isn't read from during the capture, a match-nothing filter keeps it from buffering (and dropping) a copy of the
+	// traffic until restoreMainDescriptorFilter() is called
+	struct bpf_insn matchNothingInsn = BPF_STMT(BPF_RET | BPF_K, 0);
+	struct bpf_program matchNothingProg;
+	matchNothingProg.bf_len = 1;
+	matchNothingProg.bf_insns = &matchNothingInsn;
+	if (descriptorsReady && pcap_setfilter(m_PcapDescriptor, &matchNothingProg) < 0)
+	{
+		LOG_ERROR("Cannot set a match-nothing filter on the main descriptor of device '%s'. Error message is: %s", m_Name, pcap_geterr(m_PcapDescriptor));
+		descriptorsReady = false;
+	}
+
+	if (!descriptorsReady)
+	{
+		stopFanoutThreads();
+		return false;
+	}
+
+	m_cbOnPacketArrives = onPacketArrives;
+	m_StopThread = false;
+	for (size_t i = 0; i < m_FanoutThreads.size(); i++)
+	{
+		FanoutCaptureThread* thread = m_FanoutThreads[i];
+		int err = pthread_create(&thread->pthread, NULL, &fanoutCaptureThreadMain, (void*)thread);
+		if (err != 0)
+		{
+			LOG_ERROR("Cannot create capture thread #%d for device '%s': [%s]", (int)i, m_Name, strerror(err));
+			m_StopThread = true;
+			stopFanoutThreads();
+			restoreMainDescriptorFilter();
+			m_StopThread = false;
+			return false;
+		}
+		thread->threadStarted = true;
+
+		if (!cores.empty())
+		{
+			int coreId = cores[i % cores.size()].Id;
+			cpu_set_t cpuset;
+			CPU_ZERO(&cpuset);
+			CPU_SET(coreId, &cpuset);
+			if ((err = pthread_setaffinity_np(thread->pthread, sizeof(cpu_set_t), &cpuset)) != 0)
+				LOG_ERROR("Error while binding capture thread #%d to core %d: errno=%i", (int)i, coreId, err);
+		}
+	}
+
+	m_CaptureThreadStarted = true;
+	LOG_DEBUG("Successfully created %d capture threads for device '%s' in fanout group %d", (int)m_FanoutThreads.size(), m_Name, (int)groupId);
+	return true;
+#else
+	LOG_ERROR("Multi-threaded capture is supported only on Linux");
+	return false;
+#endif
+}
+
+void PcapLiveDevice::stopFanoutThreads()
+{
+	for (std::vector<FanoutCaptureThread*>::iterator iter = m_FanoutThreads.begin(); iter != m_FanoutThreads.end(); iter++)
+	{
+		if ((*iter)->threadStarted)
+			pthread_join((*iter)->pthread, NULL);
+		if ((*iter)->descriptor != NULL)
+			pcap_close((*iter)->descriptor);
+		delete *iter;
+	}
+
+	m_FanoutThreads.clear();
+}
+
+void PcapLiveDevice::restoreMainDescriptorFilter()
+{
+	// the main descriptor had a match-nothing filter while the threads captured
+	if (m_DeviceOpened && !IPcapDevice::setFilter(m_CurrentFilter))
+		LOG_ERROR("Cannot restore filter '%s' on device '%s' after multi-threaded capture", m_CurrentFilter.c_str(), m_Name);
+}
+
+bool PcapLiveDevice::setFilter(std::string filterAsString)
+{
+	if (m_FanoutThreads.empty())
+	{
+		if (!IPcapDevice::setFilter(filterAsString))
+			return false;
+
+		m_CurrentFilter = filterAsString;
+		return true;
+	}
+
+	// during a multi-threaded capture the filter is set on the descriptors the threads read from, the main descriptor keeps its
+	// match-nothing filter
+	struct bpf_program prog;
+	LOG_DEBUG("Compiling the filter '%s'", filterAsString.c_str());
+	if (pcap_compile(m_PcapDescriptor, &prog, filterAsString.c_str(), 1, 0) < 0)
+	{
+		LOG_ERROR("Error compiling filter. Error message is: %s", pcap_geterr(m_PcapDescriptor));
+		return false;
+	}
+
+	bool result = true;
+	for (size_t i = 0; i < m_FanoutThreads.size(); i++)
+	{
+		if (pcap_setfilter(m_FanoutThreads[i]->descriptor, &prog) < 0)
+		{
+			LOG_ERROR("Error setting a compiled filter on descriptor #%d. Error message is: %s", (int)i, pcap_geterr(m_FanoutThreads[i]->descriptor));
+			result = false;
+		}
+	}
+
+	pcap_freecode(&prog);
+	if (result)
+		m_CurrentFilter = filterAsString;
+	return result;
+}
+
 void PcapLiveDevice::stopCapture()
 {
 	// in blocking mode stop capture isn't relevant
@@ -532,12 +905,21 @@ void PcapLiveDevice::stopCapture()
 		return;
 
 	m_StopThread = true;
-	if (m_CaptureThreadStarted)
+	if (m_CaptureThreadStarted && !m_FanoutThreads.empty())
+	{
+		LOG_DEBUG("Stopping %d capture threads, waiting for them to join...", (int)m_FanoutThreads.size());
+		stopFanoutThreads();
+		restoreMainDescriptorFilter();
+		m_CaptureThreadStarted = false;
+	}
+	else if (m_CaptureThreadStarted)
 	{
 		LOG_DEBUG("Stopping capture thread, waiting for it to join...");
 		pthread_join(m_CaptureThread->pthread, NULL);
 		m_CaptureThreadStarted = false;
 	}
+	if (m_cbOnPacketBurstArrives != NULL)
+		releasePacketBurst();
 	LOG_DEBUG("Capture thread stopped for device '%s'", m_Name);
 	if (m_StatsThreadStarted)
 	{
@@ -558,6 +940,28 @@ bool PcapLiveDevice::captureActive()
 
 void PcapLiveDevice::getStatistics(PcapStats& stats) const
 {
+	if (!m_FanoutThreads.empty())
+	{
+		// the descriptors of a multi-threaded capture see the traffic, the main descriptor isn't read from
+		stats.packetsRecv = 0;
+		stats.packetsDrop = 0;
+		stats.packetsDropByInterface = 0;
+		for (std::vector<FanoutCaptureThread*>::const_iterator iter = m_FanoutThreads.begin(); iter != m_FanoutThreads.end(); iter++)
+		{
+			pcap_stat pcapStats;
+			if (pcap_stats((*iter)->descriptor, &pcapStats) < 0)
+			{
+				LOG_ERROR("Error getting statistics from live device '%s'", m_Name);
+				continue;
+			}
+
+			stats.packetsRecv += pcapStats.ps_recv;
+			stats.packetsDrop += pcapStats.ps_drop;
+			stats.packetsDropByInterface += pcapStats.ps_ifdrop;
+		}
+		return;
+	}
+
 	pcap_stat pcapStats;
 	if (pcap_stats(m_PcapDescriptor, &pcapStats) < 0)
 	{
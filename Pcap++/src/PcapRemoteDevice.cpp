@@ -84,7 +84,19 @@ void* PcapRemoteDevice::remoteDeviceCaptureThreadMain(void *ptr)
 	pcap_pkthdr* pkthdr;
 	const uint8_t* pktData;
 
-	if (pThis->m_CaptureCallbackMode)
+	if (pThis->m_cbOnPacketBurstArrives != NULL)
+	{
+		// packets are read one by one, so a burst ends when it's full or when no packet is waiting
+		while (!pThis->m_StopThread)
+		{
+			if (pcap_next_ex(pThis->m_PcapDescriptor, &pkthdr, &pktData) > 0)
+				onPacketArrivesBurstMode((uint8_t*)pThis, pkthdr, pktData);
+			else
+				pThis->flushPacketBurst();
+		}
+		pThis->flushPacketBurst();
+	}
+	else if (pThis->m_CaptureCallbackMode)
 	{
 		while (!pThis->m_StopThread)
 		{
@@ -4,11 +4,16 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 #include <linux/if_ether.h>
-#include <netpacket/packet.h>
+#include <linux/if_packet.h>
 #include <ifaddrs.h>
 #include <net/if.h>
 #endif
+#include <vector>
 #include <string.h>
 #include "Logger.h"
 #include "IpUtils.h"
@@ -66,9 +71,301 @@ struct SocketContainer
 	int fd;
 	int interfaceIndex;
 	std::string interfaceName;
+
+	// BatchIO mode: receive buffers and the recvmmsg()/sendmmsg() message arrays
+	uint8_t* batchBuffer;
+	uint32_t batchSize;
+	uint32_t batchCount;
+	uint32_t batchNext;
+	timespec batchTimestamp;
+	std::vector<mmsghdr> recvMsgs;
+	std::vector<iovec> recvIovecs;
+	std::vector<mmsghdr> sendMsgs;
+	std::vector<iovec> sendIovecs;
+
+	// RingIO mode: the receive ring is mapped first and the send ring right after it
+	uint8_t* ring;
+	size_t ringSize;
+	uint32_t rxBlockSize;
+	uint32_t rxNumOfBlocks;
+	// blocks handed to the user and not returned to the kernel yet start at rxFirstHeldBlock
+	uint32_t rxFirstHeldBlock;
+	uint32_t rxNumOfHeldBlocks;
+	// packets left to read in the last held block
+	uint32_t rxPacketsLeft;
+	uint8_t* rxNextPacket;
+	uint8_t* txRing;
+	uint32_t txFrameSize;
+	uint32_t txNumOfFrames;
+	uint32_t txNextFrame;
+	std::vector<uint32_t> txQueuedFrames;
 #endif
 };
 
+#ifdef LINUX
+
+// the offset of packet data in a send ring frame, as defined by the kernel for TPACKET_V3
+#define RAW_SOCKET_TX_DATA_OFFSET (TPACKET3_HDRLEN - sizeof(struct sockaddr_ll))
+
+static RawSocketDevice::RecvPacketResult waitForPackets(int fd, bool blocking, int timeout)
+{
+	struct pollfd pollFd;
+	pollFd.fd = fd;
+	pollFd.events = POLLIN;
+	pollFd.revents = 0;
+
+	// value of 0 timeout means disabling timeout
+	int timeoutMs = (!blocking ? 0 : (timeout > 0 ? timeout * 1000 : -1));
+	int res = poll(&pollFd, 1, timeoutMs);
+	if (res < 0 && errno != EINTR)
+	{
+		LOG_ERROR("Error waiting for packets. Error code is %d", errno);
+		return RawSocketDevice::RecvError;
+	}
+
+	if (res <= 0)
+		return (blocking ? RawSocketDevice::RecvTimeout : RawSocketDevice::RecvWouldBlock);
+
+	return RawSocketDevice::RecvSuccess;
+}
+
+static void setPacketView(RawPacket& rawPacket, const uint8_t* data, int dataLen, timespec timestamp, int frameLength)
+{
+	rawPacket.clear();
+	rawPacket.setDeleteRawDataAtDestructor(false);
+	rawPacket.setRawData(data, dataLen, timestamp, LINKTYPE_ETHERNET, frameLength);
+}
+
+static bool setupRings(SocketContainer* sockContainer, const RawSocketDevice::DeviceConfiguration& config)
+{
+	int fd = sockContainer->fd;
+	uint32_t pageSize = (uint32_t)getpagesize();
+
+	if (config.ringBlockSize == 0 || config.ringBlockSize % pageSize != 0 || config.ringNumOfBlocks == 0)
+	{
+		LOG_ERROR("Ring block size must be a multiple of the page size (%d) and the number of blocks must be positive", (int)pageSize);
+		return false;
+	}
+
+	if (config.ringFrameSize < TPACKET3_HDRLEN || config.ringFrameSize % TPACKET_ALIGNMENT != 0 || config.ringBlockSize % config.ringFrameSize != 0)
+	{
+		LOG_ERROR("Ring frame size must be a multiple of %d, at least %d bytes and must divide the block size", TPACKET_ALIGNMENT, (int)TPACKET3_HDRLEN);
+		return false;
+	}
+
+	int version = TPACKET_V3;
+	if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0)
+	{
+		LOG_ERROR("Cannot set TPACKET_V3 on raw socket. Error was: '%s'", strerror(errno));
+		return false;
+	}
+
+	struct tpacket_req3 rxReq;
+	memset(&rxReq, 0, sizeof(rxReq));
+	rxReq.tp_block_size = config.ringBlockSize;
+	rxReq.tp_block_nr = config.ringNumOfBlocks;
+	rxReq.tp_frame_size = config.ringFrameSize;
+	rxReq.tp_frame_nr = (config.ringBlockSize / config.ringFrameSize) * config.ringNumOfBlocks;
+	rxReq.tp_retire_blk_tov = config.ringBlockTimeoutMs;
+	if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &rxReq, sizeof(rxReq)) < 0)
+	{
+		LOG_ERROR("Cannot create receive ring. Error was: '%s'", strerror(errno));
+		return false;
+	}
+
+	// the send ring uses one frame per packet, so its blocks are just big enough to hold whole frames
+	struct tpacket_req3 txReq;
+	memset(&txReq, 0, sizeof(txReq));
+	if (config.ringNumOfTxFrames > 0)
+	{
+		uint32_t txBlockSize = pageSize;
+		while (txBlockSize % config.ringFrameSize != 0)
+			txBlockSize += pageSize;
+		uint32_t framesPerBlock = txBlockSize / config.ringFrameSize;
+
+		txReq.tp_block_size = txBlockSize;
+		txReq.tp_block_nr = (config.ringNumOfTxFrames + framesPerBlock - 1) / framesPerBlock;
+		txReq.tp_frame_size = config.ringFrameSize;
+		txReq.tp_frame_nr = txReq.tp_block_nr * framesPerBlock;
+		if (setsockopt(fd, SOL_PACKET, PACKET_TX_RING, &txReq, sizeof(txReq)) < 0)
+		{
+			LOG_ERROR("Cannot create send ring. Error was: '%s'", strerror(errno));
+			return false;
+		}
+	}
+
+	size_t rxRingSize = (size_t)rxReq.tp_block_size * rxReq.tp_block_nr;
+	size_t txRingSize = (size_t)txReq.tp_block_size * txReq.tp_block_nr;
+	void* ring = mmap(NULL, rxRingSize + txRingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ring == MAP_FAILED)
+	{
+		LOG_ERROR("Cannot map packet rings. Error was: '%s'", strerror(errno));
+		return false;
+	}
+
+	sockContainer->ring = (uint8_t*)ring;
+	sockContainer->ringSize = rxRingSize + txRingSize;
+	sockContainer->rxBlockSize = rxReq.tp_block_size;
+	sockContainer->rxNumOfBlocks = rxReq.tp_block_nr;
+	sockContainer->txRing = (txRingSize > 0 ? sockContainer->ring + rxRingSize : NULL);
+	sockContainer->txFrameSize = txReq.tp_frame_size;
+	sockContainer->txNumOfFrames = txReq.tp_frame_nr;
+	return true;
+}
+
+static void releaseRxBlocks(SocketContainer* sockContainer)
+{
+	// return all blocks whose packets were handed to the user in previous calls, except a block which still has packets to read
+	uint32_t numOfBlocksToRelease = sockContainer->rxNumOfHeldBlocks - (sockContainer->rxPacketsLeft > 0 ? 1 : 0);
+	for (uint32_t i = 0; i < numOfBlocksToRelease; i++)
+	{
+		tpacket_block_desc* blockDesc = (tpacket_block_desc*)(sockContainer->ring + (size_t)sockContainer->rxFirstHeldBlock * sockContainer->rxBlockSize);
+		__atomic_store_n(&blockDesc->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+		sockContainer->rxFirstHeldBlock = (sockContainer->rxFirstHeldBlock + 1) % sockContainer->rxNumOfBlocks;
+		sockContainer->rxNumOfHeldBlocks--;
+	}
+}
+
+static tpacket3_hdr* nextRxPacket(SocketContainer* sockContainer)
+{
+	while (sockContainer->rxPacketsLeft == 0)
+	{
+		// all blocks are held by the user, they're released on the next receive call
+		if (sockContainer->rxNumOfHeldBlocks == sockContainer->rxNumOfBlocks)
+			return NULL;
+
+		uint32_t nextBlock = (sockContainer->rxFirstHeldBlock + sockContainer->rxNumOfHeldBlocks) % sockContainer->rxNumOfBlocks;
+		tpacket_block_desc* blockDesc = (tpacket_block_desc*)(sockContainer->ring + (size_t)nextBlock * sockContainer->rxBlockSize);
+		if ((__atomic_load_n(&blockDesc->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0)
+			return NULL;
+
+		sockContainer->rxNumOfHeldBlocks++;
+		sockContainer->rxPacketsLeft = blockDesc->hdr.bh1.num_pkts;
+		sockContainer->rxNextPacket = (uint8_t*)blockDesc + blockDesc->hdr.bh1.offset_to_first_pkt;
+	}
+
+	tpacket3_hdr* packetHdr = (tpacket3_hdr*)sockContainer->rxNextPacket;
+	sockContainer->rxNextPacket += packetHdr->tp_next_offset;
+	sockContainer->rxPacketsLeft--;
+	return packetHdr;
+}
+
+static int readFromRxRing(SocketContainer* sockContainer, RawPacket* rawPacketsArr, int arrLength)
+{
+	int numOfPackets = 0;
+	while (numOfPackets < arrLength)
+	{
+		tpacket3_hdr* packetHdr = nextRxPacket(sockContainer);
+		if (packetHdr == NULL)
+			break;
+
+		timespec timestamp;
+		timestamp.tv_sec = packetHdr->tp_sec;
+		timestamp.tv_nsec = packetHdr->tp_nsec;
+		setPacketView(rawPacketsArr[numOfPackets++], (uint8_t*)packetHdr + packetHdr->tp_mac, (int)packetHdr->tp_snaplen, timestamp, (int)packetHdr->tp_len);
+	}
+
+	return numOfPackets;
+}
+
+static RawSocketDevice::RecvPacketResult fillBatch(SocketContainer* sockContainer, bool blocking, int timeout)
+{
+	int flags = MSG_DONTWAIT;
+	if (blocking && timeout > 0)
+	{
+		RawSocketDevice::RecvPacketResult res = waitForPackets(sockContainer->fd, blocking, timeout);
+		if (res != RawSocketDevice::RecvSuccess)
+			return res;
+	}
+	else if (blocking)
+	{
+		// wait for the first packet only and then take whatever is already waiting
+		flags = MSG_WAITFORONE;
+	}
+
+	int numOfPackets = recvmmsg(sockContainer->fd, &sockContainer->recvMsgs[0], sockContainer->batchSize, flags, NULL);
+	if (numOfPackets <= 0)
+	{
+		int errorCode = errno;
+		if (numOfPackets == 0 || errorCode == EAGAIN || errorCode == EWOULDBLOCK || errorCode == EINTR)
+			return (blocking ? RawSocketDevice::RecvTimeout : RawSocketDevice::RecvWouldBlock);
+
+		LOG_ERROR("Error reading from recvmmsg. Error code is %d", errorCode);
+		return RawSocketDevice::RecvError;
+	}
+
+	sockContainer->batchCount = (uint32_t)numOfPackets;
+	sockContainer->batchNext = 0;
+	clock_gettime(CLOCK_REALTIME, &sockContainer->batchTimestamp);
+	return RawSocketDevice::RecvSuccess;
+}
+
+static int sendBatch(int fd, std::vector<mmsghdr>& msgs, int batchLength)
+{
+	int sendCount = 0;
+	int batchOffset = 0;
+	while (batchOffset < batchLength)
+	{
+		int res = sendmmsg(fd, &msgs[batchOffset], batchLength - batchOffset, 0);
+		if (res < 0)
+		{
+			// sendmmsg() fails only if the first message can't be sent, so this packet is skipped
+			LOG_DEBUG("Failed to send packet. Error was: '%s'", strerror(errno));
+			batchOffset++;
+			continue;
+		}
+
+		sendCount += res;
+		batchOffset += res;
+	}
+
+	return sendCount;
+}
+
+static int flushTxRing(SocketContainer* sockContainer)
+{
+	std::vector<uint32_t>& queuedFrames = sockContainer->txQueuedFrames;
+	int sendCount = 0;
+	size_t firstPending = 0;
+
+	while (firstPending < queuedFrames.size())
+	{
+		// without MSG_DONTWAIT the call returns only after the kernel went over all frames waiting to be sent
+		if (::send(sockContainer->fd, NULL, 0, 0) < 0)
+			LOG_DEBUG("Failed to send packets from ring. Error was: '%s'", strerror(errno));
+
+		size_t i = firstPending;
+		for (; i < queuedFrames.size(); i++)
+		{
+			tpacket3_hdr* frameHdr = (tpacket3_hdr*)(sockContainer->txRing + (size_t)queuedFrames[i] * sockContainer->txFrameSize);
+			uint32_t status = __atomic_load_n(&frameHdr->tp_status, __ATOMIC_ACQUIRE);
+			if (status == TP_STATUS_AVAILABLE)
+				sendCount++;
+			else if (status & TP_STATUS_WRONG_FORMAT)
+			{
+				// the kernel stops at a malformed frame, so it's dropped and the frames after it are sent in the next round
+				LOG_DEBUG("Failed to send packet, the kernel rejected it");
+				__atomic_store_n(&frameHdr->tp_status, TP_STATUS_AVAILABLE, __ATOMIC_RELEASE);
+			}
+			else
+				break;
+		}
+
+		if (i == firstPending)
+		{
+			LOG_ERROR("Send ring is stuck, %d packets weren't sent", (int)(queuedFrames.size() - firstPending));
+			break;
+		}
+
+		firstPending = i;
+	}
+
+	queuedFrames.clear();
+	return sendCount;
+}
+
+#endif // LINUX
+
 RawSocketDevice::RawSocketDevice(const IPAddress& interfaceIP) : IDevice(), m_Socket(NULL)
 {
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
@@ -153,6 +450,18 @@ RawSocketDevice::RecvPacketResult RawSocketDevice::receivePacket(RawPacket& rawP
 		return RecvError;
 	}
 
+	if (m_Config.ioMode != SocketIO)
+	{
+		// the packet is taken from the current batch or ring block and copied, since the caller's packet owns its data
+		RawPacket packetView;
+		int numOfPackets = 0;
+		RecvPacketResult res = receivePacketBurstInternal(&packetView, 1, blocking, timeout, numOfPackets);
+		if (res == RecvSuccess)
+			rawPacket = packetView;
+
+		return res;
+	}
+
 	int fd = ((SocketContainer*)m_Socket)->fd;
 	char* buffer = new char[RAW_SOCKET_BUFFER_LEN];
 	memset(buffer, 0, RAW_SOCKET_BUFFER_LEN);
@@ -250,6 +559,183 @@ int RawSocketDevice::receivePackets(RawPacketVector& packetVec, int timeout, int
 	return packetCount;
 }
 
+int RawSocketDevice::receivePacketBurst(RawPacket* rawPacketsArr, int arrLength, bool blocking, int timeout)
+{
+	if (!isOpened())
+	{
+		LOG_ERROR("Device is not open");
+		return 0;
+	}
+
+	if (rawPacketsArr == NULL || arrLength <= 0)
+	{
+		LOG_ERROR("Packet array is NULL or empty");
+		return 0;
+	}
+
+#ifdef LINUX
+	if (m_Config.ioMode != SocketIO)
+	{
+		int numOfPackets = 0;
+		receivePacketBurstInternal(rawPacketsArr, arrLength, blocking, timeout, numOfPackets);
+		return numOfPackets;
+	}
+#endif
+
+	// wait only for the first packet and then take the packets that are already waiting
+	int numOfPackets = 0;
+	while (numOfPackets < arrLength && receivePacket(rawPacketsArr[numOfPackets], (numOfPackets == 0 ? blocking : false), timeout) == RecvSuccess)
+		numOfPackets++;
+
+	return numOfPackets;
+}
+
+#ifdef LINUX
+
+RawSocketDevice::RecvPacketResult RawSocketDevice::receivePacketBurstInternal(RawPacket* rawPacketsArr, int arrLength, bool blocking, int timeout, int& numOfPackets)
+{
+	SocketContainer* sockContainer = (SocketContainer*)m_Socket;
+	numOfPackets = 0;
+
+	if (m_Config.ioMode == RingIO)
+	{
+		// the packets handed out in the previous call aren't used anymore
+		releaseRxBlocks(sockContainer);
+
+		numOfPackets = readFromRxRing(sockContainer, rawPacketsArr, arrLength);
+		if (numOfPackets > 0)
+			return RecvSuccess;
+
+		RecvPacketResult res = waitForPackets(sockContainer->fd, blocking, timeout);
+		if (res != RecvSuccess)
+			return res;
+
+		numOfPackets = readFromRxRing(sockContainer, rawPacketsArr, arrLength);
+		if (numOfPackets > 0)
+			return RecvSuccess;
+
+		return (blocking ? RecvTimeout : RecvWouldBlock);
+	}
+
+	// refill the batch only when all of its packets were handed out, otherwise packets from the previous call would be overwritten
+	if (sockContainer->batchNext == sockContainer->batchCount)
+	{
+		RecvPacketResult res = fillBatch(sockContainer, blocking, timeout);
+		if (res != RecvSuccess)
+			return res;
+	}
+
+	while (numOfPackets < arrLength && sockContainer->batchNext < sockContainer->batchCount)
+	{
+		uint32_t slot = sockContainer->batchNext++;
+		setPacketView(rawPacketsArr[numOfPackets++], sockContainer->batchBuffer + (size_t)slot * RAW_SOCKET_BUFFER_LEN,
+			(int)sockContainer->recvMsgs[slot].msg_len, sockContainer->batchTimestamp, -1);
+	}
+
+	return RecvSuccess;
+}
+
+int RawSocketDevice::sendPacketsInternal(const RawPacket* const* rawPackets, int numOfPackets)
+{
+	SocketContainer* sockContainer = (SocketContainer*)m_Socket;
+	int fd = sockContainer->fd;
+
+	sockaddr_ll addr;
+	memset(&addr, 0, sizeof(struct sockaddr_ll));
+	addr.sll_family = htobe16(PF_PACKET);
+	addr.sll_protocol = htobe16(ETH_P_ALL);
+	addr.sll_halen = 6;
+	addr.sll_ifindex = sockContainer->interfaceIndex;
+
+	int sendCount = 0;
+	int batchLength = 0;
+	uint32_t maxRingPacketLen = (sockContainer->txRing != NULL ? sockContainer->txFrameSize - RAW_SOCKET_TX_DATA_OFFSET : 0);
+
+	for (int packetIndex = 0; packetIndex < numOfPackets; packetIndex++)
+	{
+		const RawPacket* rawPacket = rawPackets[packetIndex];
+		Packet packet((RawPacket*)rawPacket, OsiModelDataLinkLayer);
+		if (!packet.isPacketOfType(pcpp::Ethernet))
+		{
+			LOG_DEBUG("Can't send non-Ethernet packets");
+			continue;
+		}
+
+		uint32_t packetLen = (uint32_t)rawPacket->getRawDataLen();
+
+		if (m_Config.ioMode == RingIO && packetLen <= maxRingPacketLen)
+		{
+			tpacket3_hdr* frameHdr = (tpacket3_hdr*)(sockContainer->txRing + (size_t)sockContainer->txNextFrame * sockContainer->txFrameSize);
+			if (__atomic_load_n(&frameHdr->tp_status, __ATOMIC_ACQUIRE) != TP_STATUS_AVAILABLE)
+			{
+				// the ring is full, send what was queued so far to free frames
+				sendCount += flushTxRing(sockContainer);
+				if (__atomic_load_n(&frameHdr->tp_status, __ATOMIC_ACQUIRE) != TP_STATUS_AVAILABLE)
+					::send(fd, NULL, 0, 0);
+			}
+
+			if (__atomic_load_n(&frameHdr->tp_status, __ATOMIC_ACQUIRE) == TP_STATUS_AVAILABLE)
+			{
+				memcpy((uint8_t*)frameHdr + RAW_SOCKET_TX_DATA_OFFSET, rawPacket->getRawData(), packetLen);
+				frameHdr->tp_len = packetLen;
+				frameHdr->tp_snaplen = packetLen;
+				frameHdr->tp_next_offset = 0;
+				__atomic_store_n(&frameHdr->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+				sockContainer->txQueuedFrames.push_back(sockContainer->txNextFrame);
+				sockContainer->txNextFrame = (sockContainer->txNextFrame + 1) % sockContainer->txNumOfFrames;
+				continue;
+			}
+		}
+
+		if (m_Config.ioMode == BatchIO)
+		{
+			iovec& iov = sockContainer->sendIovecs[batchLength];
+			iov.iov_base = (void*)rawPacket->getRawData();
+			iov.iov_len = packetLen;
+			msghdr& msg = sockContainer->sendMsgs[batchLength].msg_hdr;
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_name = &addr;
+			msg.msg_namelen = sizeof(addr);
+			msg.msg_iov = &iov;
+			msg.msg_iovlen = 1;
+			batchLength++;
+
+			if (batchLength == (int)sockContainer->batchSize)
+			{
+				sendCount += sendBatch(fd, sockContainer->sendMsgs, batchLength);
+				batchLength = 0;
+			}
+
+			continue;
+		}
+
+		// packets that don't fit in a ring frame are sent after the packets queued before them to keep the order
+		if (m_Config.ioMode == RingIO)
+			sendCount += flushTxRing(sockContainer);
+
+		EthLayer* ethLayer = packet.getLayerOfType<EthLayer>();
+		ethLayer->getDestMac().copyTo((uint8_t*)&(addr.sll_addr));
+
+		if (::sendto(fd, rawPacket->getRawData(), packetLen, 0, (struct sockaddr*)&addr, sizeof(addr)) == -1)
+		{
+			LOG_DEBUG("Failed to send packet. Error was: '%s'", strerror(errno));
+			continue;
+		}
+
+		sendCount++;
+	}
+
+	if (batchLength > 0)
+		sendCount += sendBatch(fd, sockContainer->sendMsgs, batchLength);
+
+	if (m_Config.ioMode == RingIO)
+		sendCount += flushTxRing(sockContainer);
+
+	return sendCount;
+}
+
+#endif // LINUX
+
 bool RawSocketDevice::sendPacket(const RawPacket* rawPacket)
 {
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
@@ -265,6 +751,10 @@ bool RawSocketDevice::sendPacket(const RawPacket* rawPacket)
 		return false;
 	}
 
+	// the packet is copied to the send ring
+	if (m_Config.ioMode == RingIO && ((SocketContainer*)m_Socket)->txRing != NULL)
+		return (sendPacketsInternal(&rawPacket, 1) == 1);
+
 	Packet packet((RawPacket*)rawPacket, OsiModelDataLinkLayer);
 	if (!packet.isPacketOfType(pcpp::Ethernet))
 	{
@@ -316,45 +806,48 @@ int RawSocketDevice::sendPackets(const RawPacketVector& packetVec)
 		return 0;
 	}
 
-	int fd = ((SocketContainer*)m_Socket)->fd;
+	std::vector<const RawPacket*> rawPackets(packetVec.begin(), packetVec.end());
+	if (rawPackets.empty())
+		return 0;
 
-	sockaddr_ll addr;
-	memset(&addr, 0, sizeof(struct sockaddr_ll));
-	addr.sll_family = htobe16(PF_PACKET);
-	addr.sll_protocol = htobe16(ETH_P_ALL);
-	addr.sll_halen = 6;
-	addr.sll_ifindex = ((SocketContainer*)m_Socket)->interfaceIndex;
+	return sendPacketsInternal(&rawPackets[0], (int)rawPackets.size());
 
-	int sendCount = 0;
+#else
 
-	for (RawPacketVector::ConstVectorIterator iter = packetVec.begin(); iter != packetVec.end(); iter++)
-	{
-		Packet packet(*iter, OsiModelDataLinkLayer);
-		if (!packet.isPacketOfType(pcpp::Ethernet))
-		{
-			LOG_DEBUG("Can't send non-Ethernet packets");
-			continue;
-		}
+	LOG_ERROR("Raw socket are not supported on this platform");
+	return false;
 
-		EthLayer* ethLayer = packet.getLayerOfType<EthLayer>();
-		MacAddress dstMac = ethLayer->getDestMac();
-		dstMac.copyTo((uint8_t*)&(addr.sll_addr));
+#endif
+}
 
-		if (::sendto(fd, (*iter)->getRawData(), (*iter)->getRawDataLen(), 0, (struct sockaddr*)&addr, sizeof(addr)) == -1)
-		{
-			LOG_DEBUG("Failed to send packet. Error was: '%s'", strerror(errno));
-			continue;
-		}
+int RawSocketDevice::sendPackets(const RawPacket* rawPacketsArr, int arrLength)
+{
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
 
-		sendCount++;
+	LOG_ERROR("Sending packets with raw socket are not supported on Windows");
+	return 0;
+
+#elif LINUX
+
+	if (!isOpened())
+	{
+		LOG_ERROR("Device is not open");
+		return 0;
 	}
 
-	return sendCount;
+	if (rawPacketsArr == NULL || arrLength <= 0)
+		return 0;
+
+	std::vector<const RawPacket*> rawPackets(arrLength);
+	for (int i = 0; i < arrLength; i++)
+		rawPackets[i] = &rawPacketsArr[i];
+
+	return sendPacketsInternal(&rawPackets[0], arrLength);
 
 #else
 
 	LOG_ERROR("Raw socket are not supported on this platform");
-	return false;
+	return 0;
 
 #endif
 }
@@ -362,8 +855,27 @@ int RawSocketDevice::sendPackets(const RawPacketVector& packetVec)
 
 bool RawSocketDevice::open()
 {
+	return open(DeviceConfiguration());
+}
+
+bool RawSocketDevice::open(const DeviceConfiguration& config)
+{
+	if (isOpened())
+	{
+		LOG_ERROR("Device is already open");
+		return false;
+	}
+
+	m_Config = config;
+
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
 
+	if (m_Config.ioMode != SocketIO)
+	{
+		LOG_ERROR("Batch and ring I/O modes are supported on Linux only");
+		return false;
+	}
+
 	if (!m_InterfaceIP.isValid())
 	{
 		LOG_ERROR("IP address is not valid");
@@ -509,10 +1021,75 @@ bool RawSocketDevice::open()
 		return false;		
 	}
 
-	m_Socket = new SocketContainer(); // lgtm [cpp/resource-not-released-in-destructor]
-	((SocketContainer*)m_Socket)->fd = fd;
-	((SocketContainer*)m_Socket)->interfaceIndex = ifaceIndex;
-	((SocketContainer*)m_Socket)->interfaceName = ifaceName;
+	SocketContainer* sockContainer = new SocketContainer(); // lgtm [cpp/resource-not-released-in-destructor]
+	sockContainer->fd = fd;
+	sockContainer->interfaceIndex = ifaceIndex;
+	sockContainer->interfaceName = ifaceName;
+	sockContainer->batchBuffer = NULL;
+	sockContainer->batchSize = 0;
+	sockContainer->batchCount = 0;
+	sockContainer->batchNext = 0;
+	sockContainer->ring = NULL;
+	sockContainer->ringSize = 0;
+	sockContainer->rxBlockSize = 0;
+	sockContainer->rxNumOfBlocks = 0;
+	sockContainer->rxFirstHeldBlock = 0;
+	sockContainer->rxNumOfHeldBlocks = 0;
+	sockContainer->rxPacketsLeft = 0;
+	sockContainer->rxNextPacket = NULL;
+	sockContainer->txRing = NULL;
+	sockContainer->txFrameSize = 0;
+	sockContainer->txNumOfFrames = 0;
+	sockContainer->txNextFrame = 0;
+
+	if (m_Config.ioMode != SocketIO)
+	{
+		// the send ring sends through the interface the socket is bound to, SO_BINDTODEVICE isn't enough for it
+		sockaddr_ll bindAddr;
+		memset(&bindAddr, 0, sizeof(bindAddr));
+		bindAddr.sll_family = AF_PACKET;
+		bindAddr.sll_protocol = htobe16(ETH_P_ALL);
+		bindAddr.sll_ifindex = ifaceIndex;
+		if (bind(fd, (struct sockaddr*)&bindAddr, sizeof(bindAddr)) < 0)
+		{
+			LOG_ERROR("Cannot bind raw socket to interface '%s'. Error was: '%s'", ifaceName.c_str(), strerror(errno));
+			::close(fd);
+			delete sockContainer;
+			return false;
+		}
+	}
+
+	if (m_Config.ioMode == BatchIO)
+	{
+		uint32_t batchSize = (m_Config.batchSize > 0 ? m_Config.batchSize : 1);
+		sockContainer->batchSize = batchSize;
+		sockContainer->batchBuffer = new uint8_t[(size_t)batchSize * RAW_SOCKET_BUFFER_LEN];
+		sockContainer->recvMsgs.resize(batchSize);
+		sockContainer->recvIovecs.resize(batchSize);
+		sockContainer->sendMsgs.resize(batchSize);
+		sockContainer->sendIovecs.resize(batchSize);
+		memset(&sockContainer->recvMsgs[0], 0, sizeof(mmsghdr) * batchSize);
+		for (uint32_t i = 0; i < batchSize; i++)
+		{
+			sockContainer->recvIovecs[i].iov_base = sockContainer->batchBuffer + (size_t)i * RAW_SOCKET_BUFFER_LEN;
+			sockContainer->recvIovecs[i].iov_len = RAW_SOCKET_BUFFER_LEN;
+			sockContainer->recvMsgs[i].msg_hdr.msg_iov = &sockContainer->recvIovecs[i];
+			sockContainer->recvMsgs[i].msg_hdr.msg_iovlen = 1;
+		}
+	}
+	else if (m_Config.ioMode == RingIO)
+	{
+		if (!setupRings(sockContainer, m_Config))
+		{
+			::close(fd);
+			delete sockContainer;
+			return false;
+		}
+
+		sockContainer->txQueuedFrames.reserve(sockContainer->txNumOfFrames);
+	}
+
+	m_Socket = sockContainer;
 
 	m_DeviceOpened = true;
 
@@ -534,6 +1111,9 @@ void RawSocketDevice::close()
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
 		closesocket(sockContainer->fd);
 #elif LINUX
+		if (sockContainer->ring != NULL)
+			munmap(sockContainer->ring, sockContainer->ringSize);
+		delete [] sockContainer->batchBuffer;
 		::close(sockContainer->fd);
 #endif
 		delete sockContainer;
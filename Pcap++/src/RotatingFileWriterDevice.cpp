@@ -0,0 +1,418 @@
+#define LOG_MODULE PcapLogModuleFileDevice
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <dirent.h>
+#include <map>
+#include "RotatingFileWriterDevice.h"
+#include "Logger.h"
+#if !defined(WIN32) && !defined(WINx64) && !defined(PCAPPP_MINGW_ENV)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// the sizes of the file header and record header added to the captured data, used to track the size of the current file
+#define PCAP_FILE_HEADER_SIZE 24
+#define PCAP_RECORD_HEADER_SIZE 16
+#define PCAPNG_RECORD_HEADER_SIZE 32
+
+namespace pcpp
+{
+
+RotatingFileWriterDevice::RotatingFileWriterDevice(const char* fileName, LinkLayerType linkLayerType, const RotationConfig& config) :
+	IFileWriterDevice(fileName), m_PcapLinkLayerType(linkLayerType), m_Config(config)
+{
+	// the file index goes between the file name and its extension
+	std::string name(fileName);
+	size_t extensionPos = name.rfind('.');
+	size_t separatorPos = name.find_last_of("/\\");
+	if (extensionPos != std::string::npos && (separatorPos == std::string::npos || extensionPos > separatorPos))
+	{
+		m_FileNamePrefix = name.substr(0, extensionPos);
+		m_FileNameExtension = name.substr(extensionPos);
+	}
+	else
+	{
+		m_FileNamePrefix = name;
+		m_FileNameExtension = (m_Config.isPcapNg ? ".pcapng" : ".pcap");
+	}
+
+	m_CurFile.writer = NULL;
+	m_CurFileSize = 0;
+	m_CurFilePackets = 0;
+	m_CurFileStartTime = 0;
+	m_NumOfRotations = 0;
+	m_NumOfRotationStalls = 0;
+	m_BackgroundThreadStarted = false;
+	m_NextFile.writer = NULL;
+	m_NextFileReady = false;
+	m_NextFileIndex = 0;
+	m_Stopping = false;
+
+	pthread_mutex_init(&m_Mutex, NULL);
+	pthread_cond_init(&m_WorkCond, NULL);
+	pthread_cond_init(&m_NextFileReadyCond, NULL);
+}
+
+RotatingFileWriterDevice::~RotatingFileWriterDevice()
+{
+	close();
+
+	pthread_mutex_destroy(&m_Mutex);
+	pthread_cond_destroy(&m_WorkCond);
+	pthread_cond_destroy(&m_NextFileReadyCond);
+}
+
+RotatingFileWriterDevice::RotatedFile RotatingFileWriterDevice::openFile(uint32_t fileIndex)
+{
+	char index[16];
+	snprintf(index, sizeof(index), "-%04u", fileIndex);
+
+	RotatedFile file;
+	file.fileName = m_FileNamePrefix + index + m_FileNameExtension;
+	if (m_Config.isPcapNg)
+		file.writer = new PcapNgFileWriterDevice(file.fileName.c_str(), m_Config.compressionLevel);
+	else
+		file.writer = new PcapFileWriterDevice(file.fileName.c_str(), m_PcapLinkLayerType);
+
+	if (!file.writer->open())
+	{
+		LOG_ERROR("Cannot open file '%s' of rotating writer device", file.fileName.c_str());
+		delete file.writer;
+		file.writer = NULL;
+	}
+
+	return file;
+}
+
+void RotatingFileWriterDevice::closeFile(RotatedFile& file, bool deleteFile)
+{
+	if (file.writer == NULL)
+		return;
+
+	file.writer->close();
+	delete file.writer;
+	file.writer = NULL;
+
+	if (deleteFile)
+	{
+		remove(file.fileName.c_str());
+		return;
+	}
+
+#if !defined(WIN32) && !defined(WINx64) && !defined(PCAPPP_MINGW_ENV)
+	// the writers don't expose their file descriptor, but syncing any descriptor of the file syncs its data
+	int fd = ::open(file.fileName.c_str(), O_RDONLY);
+	if (fd >= 0)
+	{
+		if (fsync(fd) != 0)
+			LOG_ERROR("Cannot sync file '%s' to disk", file.fileName.c_str());
+		::close(fd);
+	}
+#endif
+}
+
+// find the files named "<prefix>-NNNN<extension>", which were written by a previous run of a device with the same file name.
+// The files are returned ordered by their index
+static void findRotatedFiles(const std::string& prefix, const std::string& extension, std::map<uint32_t, std::string>& files)
+{
+	size_t separatorPos = prefix.find_last_of("/\\");
+	std::string dirPath = (separatorPos == std::string::npos ? std::string(".") : prefix.substr(0, separatorPos + 1));
+	std::string dirPrefix = (separatorPos == std::string::npos ? std::string() : dirPath);
+	std::string namePrefix = (separatorPos == std::string::npos ? prefix : prefix.substr(separatorPos + 1)) + "-";
+
+	DIR* dir = opendir(dirPath.c_str());
+	if (dir == NULL)
+		return;
+
+	for (struct dirent* entry = readdir(dir); entry != NULL; entry = readdir(dir))
+	{
+		std::string name(entry->d_name);
+		// the index has at least 4 digits
+		if (name.length() < namePrefix.length() + 4 + extension.length() ||
+				name.compare(0, namePrefix.length(), namePrefix) != 0 ||
+				name.compare(name.length() - extension.length(), extension.length(), extension) != 0)
+			continue;
+
+		std::string index = name.substr(namePrefix.length(), name.length() - namePrefix.length() - extension.length());
+		if (index.find_first_not_of("0123456789") != std::string::npos)
+			continue;
+
+		files[(uint32_t)strtoul(index.c_str(), NULL, 10)] = dirPrefix + name;
+	}
+
+	closedir(dir);
+}
+
+bool RotatingFileWriterDevice::open()
+{
+	if (m_DeviceOpened)
+	{
+		LOG_DEBUG("Rotating writer device already opened. Nothing to do");
+		return true;
+	}
+
+	m_NumOfPacketsNotWritten = 0;
+	m_NumOfPacketsWritten = 0;
+	m_NumOfRotations = 0;
+	m_NumOfRotationStalls = 0;
+	m_NextFileReady = false;
+	m_Stopping = false;
+	m_KeptFiles.clear();
+
+	// files left by a previous run are the oldest files: numbering continues after them and they're the first to be deleted
+	std::map<uint32_t, std::string> existingFiles;
+	findRotatedFiles(m_FileNamePrefix, m_FileNameExtension, existingFiles);
+	uint32_t firstFileIndex = 0;
+	for (std::map<uint32_t, std::string>::iterator iter = existingFiles.begin(); iter != existingFiles.end(); iter++)
+	{
+		m_KeptFiles.push_back(iter->second);
+		firstFileIndex = iter->first + 1;
+	}
+
+	m_CurFile = openFile(firstFileIndex);
+	if (m_CurFile.writer == NULL)
+		return false;
+	m_NextFileIndex = firstFileIndex + 1;
+
+	// the first file is one of the files to keep
+	while (m_Config.maxNumOfFiles > 0 && m_KeptFiles.size() > m_Config.maxNumOfFiles - 1)
+	{
+		remove(m_KeptFiles.front().c_str());
+		m_KeptFiles.pop_front();
+	}
+
+	m_CurFileSize = (m_Config.isPcapNg ? 0 : PCAP_FILE_HEADER_SIZE);
+	m_CurFilePackets = 0;
+
+	if (pthread_create(&m_BackgroundThread, NULL, backgroundThreadMain, this) != 0)
+	{
+		LOG_ERROR("Cannot start the background thread of rotating writer device");
+		closeFile(m_CurFile, false);
+		return false;
+	}
+
+	m_BackgroundThreadStarted = true;
+	m_DeviceOpened = true;
+	LOG_DEBUG("Rotating writer device opened successfully, first file is '%s'", m_CurFile.fileName.c_str());
+	return true;
+}
+
+bool RotatingFileWriterDevice::open(bool appendMode)
+{
+	if (appendMode)
+	{
+		LOG_ERROR("Rotating writer device doesn't support append mode");
+		return false;
+	}
+
+	return open();
+}
+
+bool RotatingFileWriterDevice::shouldRotate(RawPacket const& packet, uint64_t recordSize) const
+{
+	// a file always gets at least one packet, even if it's larger than the max file size
+	if (m_CurFilePackets == 0)
+		return false;
+
+	if (m_Config.maxPacketsPerFile > 0 && m_CurFilePackets >= m_Config.maxPacketsPerFile)
+		return true;
+
+	if (m_Config.maxFileSize > 0 && m_CurFileSize + recordSize > m_Config.maxFileSize)
+		return true;
+
+	if (m_Config.maxFileDuration > 0 && packet.getPacketTimeStamp().tv_sec - m_CurFileStartTime >= (time_t)m_Config.maxFileDuration)
+		return true;
+
+	return false;
+}
+
+bool RotatingFileWriterDevice::rotate()
+{
+	pthread_mutex_lock(&m_Mutex);
+	if (!m_NextFileReady)
+	{
+		m_NumOfRotationStalls++;
+		while (!m_NextFileReady)
+			pthread_cond_wait(&m_NextFileReadyCond, &m_Mutex);
+	}
+
+	RotatedFile nextFile = m_NextFile;
+	m_NextFileReady = false;
+	// the current file is kept if the next one couldn't be opened, the background thread tries again for the next rotation
+	if (nextFile.writer != NULL)
+		m_FilesToClose.push_back(m_CurFile);
+	pthread_cond_signal(&m_WorkCond);
+	pthread_mutex_unlock(&m_Mutex);
+
+	if (nextFile.writer == NULL)
+		return false;
+
+	m_CurFile = nextFile;
+	m_CurFileSize = (m_Config.isPcapNg ? 0 : PCAP_FILE_HEADER_SIZE);
+	m_CurFilePackets = 0;
+	m_NumOfRotations++;
+	return true;
+}
+
+bool RotatingFileWriterDevice::writePacket(RawPacket const& packet)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device not opened");
+		m_NumOfPacketsNotWritten++;
+		return false;
+	}
+
+	uint64_t recordSize;
+	if (m_Config.isPcapNg)
+		recordSize = PCAPNG_RECORD_HEADER_SIZE + ((packet.getRawDataLen() + 3) & ~3);
+	else
+		recordSize = PCAP_RECORD_HEADER_SIZE + packet.getRawDataLen();
+
+	if (shouldRotate(packet, recordSize) && !rotate())
+	{
+		m_NumOfPacketsNotWritten++;
+		return false;
+	}
+
+	if (!m_CurFile.writer->writePacket(packet))
+	{
+		m_NumOfPacketsNotWritten++;
+		return false;
+	}
+
+	if (m_CurFilePackets == 0)
+		m_CurFileStartTime = packet.getPacketTimeStamp().tv_sec;
+	m_CurFileSize += recordSize;
+	m_CurFilePackets++;
+	m_NumOfPacketsWritten++;
+	return true;
+}
+
+bool RotatingFileWriterDevice::writePackets(const RawPacketVector& packets)
+{
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device not opened");
+		m_NumOfPacketsNotWritten += packets.size();
+		return false;
+	}
+
+	bool result = true;
+	for (RawPacketVector::ConstVectorIterator iter = packets.begin(); iter != packets.end(); iter++)
+	{
+		if (!writePacket(**iter))
+			result = false;
+	}
+
+	return result;
+}
+
+void RotatingFileWriterDevice::flush()
+{
+	if (!m_DeviceOpened)
+		return;
+
+	if (m_Config.isPcapNg)
+		static_cast<PcapNgFileWriterDevice*>(m_CurFile.writer)->flush();
+	else
+		static_cast<PcapFileWriterDevice*>(m_CurFile.writer)->flush();
+}
+
+void RotatingFileWriterDevice::close()
+{
+	if (!m_DeviceOpened)
+		return;
+
+	pthread_mutex_lock(&m_Mutex);
+	m_FilesToClose.push_back(m_CurFile);
+	m_Stopping = true;
+	pthread_cond_signal(&m_WorkCond);
+	pthread_mutex_unlock(&m_Mutex);
+
+	if (m_BackgroundThreadStarted)
+		pthread_join(m_BackgroundThread, NULL);
+	m_BackgroundThreadStarted = false;
+
+	m_CurFile.writer = NULL;
+	m_CurFile.fileName.clear();
+	m_DeviceOpened = false;
+	LOG_DEBUG("Rotating writer device closed after %d rotations", (int)m_NumOfRotations);
+}
+
+void RotatingFileWriterDevice::getStatistics(PcapStats& stats) const
+{
+	stats.packetsRecv = m_NumOfPacketsWritten;
+	stats.packetsDrop = m_NumOfPacketsNotWritten;
+	stats.packetsDropByInterface = 0;
+	LOG_DEBUG("Statistics received for rotating writer device for filename '%s'", m_FileName);
+}
+
+void RotatingFileWriterDevice::backgroundThreadLoop()
+{
+	pthread_mutex_lock(&m_Mutex);
+	while (true)
+	{
+		// opening the next file comes first, the writing thread may be waiting for it
+		if (!m_NextFileReady && !m_Stopping)
+		{
+			uint32_t fileIndex = m_NextFileIndex;
+			pthread_mutex_unlock(&m_Mutex);
+
+			RotatedFile nextFile = openFile(fileIndex);
+
+			pthread_mutex_lock(&m_Mutex);
+			m_NextFile = nextFile;
+			m_NextFileReady = true;
+			if (nextFile.writer != NULL)
+				m_NextFileIndex++;
+			pthread_cond_signal(&m_NextFileReadyCond);
+			continue;
+		}
+
+		if (!m_FilesToClose.empty())
+		{
+			RotatedFile file = m_FilesToClose.front();
+			m_FilesToClose.pop_front();
+			// the last file closed when stopping is the current file, otherwise the current file is one more file to keep
+			bool isLastFile = (m_Stopping && m_FilesToClose.empty());
+			pthread_mutex_unlock(&m_Mutex);
+
+			closeFile(file, false);
+			m_KeptFiles.push_back(file.fileName);
+			size_t maxKeptFiles = (isLastFile ? m_Config.maxNumOfFiles : m_Config.maxNumOfFiles - 1);
+			while (m_Config.maxNumOfFiles > 0 && m_KeptFiles.size() > maxKeptFiles)
+			{
+				remove(m_KeptFiles.front().c_str());
+				m_KeptFiles.pop_front();
+			}
+
+			pthread_mutex_lock(&m_Mutex);
+			continue;
+		}
+
+		if (m_Stopping)
+			break;
+
+		pthread_cond_wait(&m_WorkCond, &m_Mutex);
+	}
+
+	// the file opened ahead of time was never written to
+	RotatedFile unusedFile = m_NextFile;
+	bool hasUnusedFile = m_NextFileReady;
+	m_NextFile.writer = NULL;
+	m_NextFileReady = false;
+	pthread_mutex_unlock(&m_Mutex);
+
+	if (hasUnusedFile)
+		closeFile(unusedFile, true);
+}
+
+void* RotatingFileWriterDevice::backgroundThreadMain(void* device)
+{
+	((RotatingFileWriterDevice*)device)->backgroundThreadLoop();
+	return NULL;
+}
+
+} // namespace pcpp
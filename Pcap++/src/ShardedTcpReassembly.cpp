@@ -0,0 +1,365 @@
+#define LOG_MODULE PacketLogModuleTcpReassembly
+
+#include "ShardedTcpReassembly.h"
+#include "Packet.h"
+#include "PacketUtils.h"
+#include "Logger.h"
+#include "LockFreeRing.h"
+#include "SystemUtils.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+#include <windows.h>
+#else
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+// the initial size of a slot's packet buffer. It grows on demand and is kept for the next packets
+#define SHARDED_TCP_REASSEMBLY_MIN_SLOT_BUFFER 2048
+
+// the number of empty polls a worker spins before it starts yielding and then sleeping
+#define SHARDED_TCP_REASSEMBLY_SPIN_COUNT 64
+#define SHARDED_TCP_REASSEMBLY_YIELD_COUNT 1024
+
+namespace pcpp
+{
+
+static PCPP_THREAD_LOCAL int currentShardId = -1;
+
+enum SlotCommand
+{
+	SlotPacket,
+	SlotCloseConnection,
+	SlotCloseAllConnections
+};
+
+// a ring slot. Slots are filled and processed in place, so the packet buffer of a slot is kept for the next packets
+struct PacketSlot
+{
+	uint8_t* data;
+	uint32_t capacity;
+	uint32_t dataLen;
+	int frameLength;
+	timespec timestamp;
+	LinkLayerType linkType;
+	int command;
+	uint32_t flowKey;
+
+	PacketSlot() : data(NULL), capacity(0), dataLen(0), frameLength(0), linkType(LINKTYPE_ETHERNET), command(SlotPacket), flowKey(0)
+	{
+		timestamp.tv_sec = 0;
+		timestamp.tv_nsec = 0;
+	}
+
+	~PacketSlot() { free(data); }
+
+private:
+	// slots own their buffer, so they're never copied
+	PacketSlot(const PacketSlot& other);
+	PacketSlot& operator=(const PacketSlot& other);
+};
+
+struct ShardedTcpReassembly::Shard
+{
+	ShardedTcpReassembly* owner;
+	uint16_t id;
+	TcpReassembly* reassembly;
+	pthread_t thread;
+	SPSCRing<PacketSlot>* ring;
+};
+
+// spin first, then give up the time slice and finally sleep, so idle workers don't burn a core
+static void backOff(uint32_t& idleCount)
+{
+	idleCount++;
+	if (idleCount < SHARDED_TCP_REASSEMBLY_SPIN_COUNT)
+		return;
+
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
+	Sleep(idleCount < SHARDED_TCP_REASSEMBLY_YIELD_COUNT ? 0 : 1);
+#else
+	if (idleCount < SHARDED_TCP_REASSEMBLY_YIELD_COUNT)
+		sched_yield();
+	else
+		usleep(100);
+#endif
+}
+
+ShardedTcpReassembly::ShardedTcpReassembly(TcpReassembly::OnTcpMessageReady onMessageReadyCallback, void* userCookie,
+		TcpReassembly::OnTcpConnectionStart onConnectionStartCallback, TcpReassembly::OnTcpConnectionEnd onConnectionEndCallback,
+		const TcpReassemblyConfiguration& config, uint16_t numOfShards, uint32_t ringSize) :
+	m_OnMessageReadyCallback(onMessageReadyCallback), m_OnConnStart(onConnectionStartCallback), m_OnConnEnd(onConnectionEndCallback),
+	m_UserCookie(userCookie), m_Config(config)
+{
+	if (numOfShards == 0)
+	{
+		int numOfCores = getNumOfCores();
+		numOfShards = (uint16_t)(numOfCores > 0 ? numOfCores : 1);
+	}
+
+	m_NumOfShards = numOfShards;
+	m_RingSize = internal::ringRoundUpCapacity(ringSize);
+	m_Running = false;
+	m_DropWhenFull = false;
+	m_StopRequested = 0;
+	m_NumOfDroppedPackets = 0;
+
+	m_Shards.resize(m_NumOfShards);
+	for (uint16_t i = 0; i < m_NumOfShards; i++)
+	{
+		Shard* shard = new Shard();
+		shard->owner = this;
+		shard->id = i;
+		shard->reassembly = new TcpReassembly(m_OnMessageReadyCallback, m_UserCookie, m_OnConnStart, m_OnConnEnd, m_Config);
+		shard->ring = new SPSCRing<PacketSlot>(m_RingSize);
+		m_Shards[i] = shard;
+	}
+}
+
+ShardedTcpReassembly::~ShardedTcpReassembly()
+{
+	if (m_Running)
+		stop();
+
+	for (std::vector<Shard*>::iterator iter = m_Shards.begin(); iter != m_Shards.end(); ++iter)
+	{
+		Shard* shard = *iter;
+		delete shard->reassembly;
+		delete shard->ring;
+		delete shard;
+	}
+}
+
+void* ShardedTcpReassembly::workerThreadMain(void* ptr)
+{
+	Shard* shard = (Shard*)ptr;
+	ShardedTcpReassembly* pThis = shard->owner;
+	currentShardId = shard->id;
+
+	RawPacket rawPacket;
+	uint32_t idleCount = 0;
+
+	while (true)
+	{
+		// the stop flag must be read before the ring, otherwise packets queued right before stop() was called might be missed
+		uint32_t stopRequested = internal::ringLoadAcquire(&pThis->m_StopRequested);
+		PacketSlot* slot = shard->ring->peekDequeue();
+		if (slot == NULL)
+		{
+			if (stopRequested)
+				break;
+
+			backOff(idleCount);
+			continue;
+		}
+
+		idleCount = 0;
+		while (slot != NULL)
+		{
+			switch (slot->command)
+			{
+			case SlotPacket:
+			{
+				rawPacket.clear();
+				rawPacket.setDeleteRawDataAtDestructor(false);
+				rawPacket.setRawData(slot->data, (int)slot->dataLen, slot->timestamp, slot->linkType, slot->frameLength);
+				Packet packet(&rawPacket, OsiModelTransportLayer);
+				shard->reassembly->reassemblePacket(packet);
+				break;
+			}
+			case SlotCloseConnection:
+				shard->reassembly->closeConnection(slot->flowKey);
+				break;
+			case SlotCloseAllConnections:
+				shard->reassembly->closeAllConnections();
+				break;
+			}
+
+			// free the slot right away so a blocked producer can continue
+			shard->ring->commitDequeue();
+			slot = shard->ring->peekDequeue();
+		}
+	}
+
+	currentShardId = -1;
+	return 0;
+}
+
+bool ShardedTcpReassembly::start(CoreMask coreMask)
+{
+	if (m_Running)
+	{
+		LOG_ERROR("Sharded TCP reassembly is already running");
+		return false;
+	}
+
+	std::vector<SystemCore> cores;
+	if (coreMask != 0)
+		createCoreVectorFromCoreMask(coreMask, cores);
+
+	m_StopRequested = 0;
+	uint16_t numOfThreadsCreated = 0;
+	bool result = true;
+
+	for (; numOfThreadsCreated < m_NumOfShards; numOfThreadsCreated++)
+	{
+		Shard* shard = m_Shards[numOfThreadsCreated];
+		int err = pthread_create(&shard->thread, NULL, workerThreadMain, shard);
+		if (err != 0)
+		{
+			LOG_ERROR("Cannot create worker thread #%d. Error was: %d", (int)numOfThreadsCreated, err);
+			result = false;
+			break;
+		}
+
+#ifdef LINUX
+		if (!cores.empty())
+		{
+			int coreId = cores[numOfThreadsCreated % cores.size()].Id;
+			cpu_set_t cpuset;
+			CPU_ZERO(&cpuset);
+			CPU_SET(coreId, &cpuset);
+			if ((err = pthread_setaffinity_np(shard->thread, sizeof(cpu_set_t), &cpuset)) != 0)
+				LOG_ERROR("Error while binding worker thread #%d to core %d: errno=%i", (int)numOfThreadsCreated, coreId, err);
+		}
+#endif
+	}
+
+	if (!result)
+	{
+		internal::ringStoreRelease(&m_StopRequested, 1);
+		for (uint16_t i = 0; i < numOfThreadsCreated; i++)
+			pthread_join(m_Shards[i]->thread, NULL);
+		m_StopRequested = 0;
+		return false;
+	}
+
+	m_Running = true;
+	LOG_DEBUG("Started %d sharded TCP reassembly worker threads", (int)m_NumOfShards);
+	return true;
+}
+
+void ShardedTcpReassembly::stop()
+{
+	if (!m_Running)
+		return;
+
+	// workers process everything already in their rings before they exit
+	internal::ringStoreRelease(&m_StopRequested, 1);
+	for (uint16_t i = 0; i < m_NumOfShards; i++)
+		pthread_join(m_Shards[i]->thread, NULL);
+
+	m_StopRequested = 0;
+	m_Running = false;
+}
+
+bool ShardedTcpReassembly::pushToShard(Shard* shard, const RawPacket* rawPacket, int command, uint32_t flowKey)
+{
+	PacketSlot* slotPtr = shard->ring->reserveEnqueue();
+	uint32_t idleCount = 0;
+	while (slotPtr == NULL)
+	{
+		// commands are never dropped, otherwise connections might stay open forever
+		if (m_DropWhenFull && command == SlotPacket)
+		{
+			m_NumOfDroppedPackets++;
+			return false;
+		}
+
+		backOff(idleCount);
+		slotPtr = shard->ring->reserveEnqueue();
+	}
+
+	PacketSlot& slot = *slotPtr;
+	slot.command = command;
+	slot.flowKey = flowKey;
+
+	if (command == SlotPacket)
+	{
+		uint32_t dataLen = (uint32_t)rawPacket->getRawDataLen();
+		if (dataLen > slot.capacity)
+		{
+			uint32_t newCapacity = (slot.capacity > 0 ? slot.capacity : SHARDED_TCP_REASSEMBLY_MIN_SLOT_BUFFER);
+			while (newCapacity < dataLen)
+				newCapacity <<= 1;
+
+			uint8_t* newData = (uint8_t*)realloc(slot.data, newCapacity);
+			if (newData == NULL)
+			{
+				LOG_ERROR("Cannot allocate %d bytes for a packet of shard #%d", (int)newCapacity, (int)shard->id);
+				m_NumOfDroppedPackets++;
+				return false;
+			}
+
+			slot.data = newData;
+			slot.capacity = newCapacity;
+		}
+
+		memcpy(slot.data, rawPacket->getRawData(), dataLen);
+		slot.dataLen = dataLen;
+		slot.frameLength = rawPacket->getFrameLength();
+		slot.timestamp = rawPacket->getPacketTimeStamp();
+		slot.linkType = rawPacket->getLinkLayerType();
+	}
+
+	shard->ring->commitEnqueue();
+	return true;
+}
+
+bool ShardedTcpReassembly::reassemblePacket(Packet& tcpData)
+{
+	if (!m_Running)
+	{
+		LOG_ERROR("Sharded TCP reassembly isn't running, cannot queue packet");
+		return false;
+	}
+
+	if (!tcpData.isPacketOfType(TCP))
+		return false;
+
+	// same key TcpReassembly uses as the connection's flow key, so closeConnection() finds the same shard
+	uint32_t flowKey = hash5Tuple(&tcpData);
+	return pushToShard(m_Shards[getShardIdForFlowKey(flowKey)], tcpData.getRawPacketReadOnly(), SlotPacket, flowKey);
+}
+
+bool ShardedTcpReassembly::reassemblePacket(RawPacket* tcpRawData)
+{
+	Packet parsedPacket(tcpRawData, OsiModelTransportLayer);
+	return reassemblePacket(parsedPacket);
+}
+
+void ShardedTcpReassembly::closeConnection(uint32_t flowKey)
+{
+	Shard* shard = m_Shards[getShardIdForFlowKey(flowKey)];
+	if (m_Running)
+		pushToShard(shard, NULL, SlotCloseConnection, flowKey);
+	else
+		shard->reassembly->closeConnection(flowKey);
+}
+
+void ShardedTcpReassembly::closeAllConnections()
+{
+	for (uint16_t i = 0; i < m_NumOfShards; i++)
+	{
+		if (m_Running)
+			pushToShard(m_Shards[i], NULL, SlotCloseAllConnections, 0);
+		else
+			m_Shards[i]->reassembly->closeAllConnections();
+	}
+}
+
+TcpReassembly* ShardedTcpReassembly::getShard(uint16_t shardId) const
+{
+	if (shardId >= m_NumOfShards)
+		return NULL;
+
+	return m_Shards[shardId]->reassembly;
+}
+
+int ShardedTcpReassembly::getCurrentShardId()
+{
+	return currentShardId;
+}
+
+} // namespace pcpp
@@ -0,0 +1,398 @@
+#define LOG_MODULE PcapLogModuleLiveDevice
+
+#include "ThreadedBpfProgram.h"
+#include "Logger.h"
+#if defined(WINx64)
+#include <winsock2.h>
+#endif
+#include "pcap.h"
+#include <string.h>
+
+#if defined(__GNUC__)
+#define PCPP_BPF_COMPUTED_GOTO
+#endif
+
+namespace pcpp
+{
+
+// the dense opcodes of the translated program. The order must match the dispatch table in ThreadedBpfProgram::run()
+enum ThreadedBpfOp
+{
+	OpRetK, OpRetA,
+	OpLdWAbs, OpLdHAbs, OpLdBAbs, OpLdWInd, OpLdHInd, OpLdBInd, OpLdWLen, OpLdImm, OpLdMem,
+	OpLdxWLen, OpLdxMshB, OpLdxImm, OpLdxMem,
+	OpSt, OpStx,
+	OpJa, OpJgtK, OpJgeK, OpJeqK, OpJsetK, OpJgtX, OpJgeX, OpJeqX, OpJsetX,
+	OpAddK, OpSubK, OpMulK, OpDivK, OpModK, OpAndK, OpOrK, OpXorK, OpLshK, OpRshK,
+	OpAddX, OpSubX, OpMulX, OpDivX, OpModX, OpAndX, OpOrX, OpXorX, OpLshX, OpRshX,
+	OpNeg, OpTax, OpTxa,
+	// fused "ld[h|b] [k]; jeq #k2" pairs
+	OpLdHAbsJeqK, OpLdBAbsJeqK,
+	NumOfThreadedBpfOps
+};
+
+static bool translateOpcode(uint16_t code, uint32_t& op)
+{
+	switch (code)
+	{
+	case BPF_RET|BPF_K: op = OpRetK; return true;
+	case BPF_RET|BPF_A: op = OpRetA; return true;
+	case BPF_LD|BPF_W|BPF_ABS: op = OpLdWAbs; return true;
+	case BPF_LD|BPF_H|BPF_ABS: op = OpLdHAbs; return true;
+	case BPF_LD|BPF_B|BPF_ABS: op = OpLdBAbs; return true;
+	case BPF_LD|BPF_W|BPF_IND: op = OpLdWInd; return true;
+	case BPF_LD|BPF_H|BPF_IND: op = OpLdHInd; return true;
+	case BPF_LD|BPF_B|BPF_IND: op = OpLdBInd; return true;
+	case BPF_LD|BPF_W|BPF_LEN: op = OpLdWLen; return true;
+	case BPF_LD|BPF_IMM: op = OpLdImm; return true;
+	case BPF_LD|BPF_MEM: op = OpLdMem; return true;
+	case BPF_LDX|BPF_W|BPF_LEN: op = OpLdxWLen; return true;
+	case BPF_LDX|BPF_MSH|BPF_B: op = OpLdxMshB; return true;
+	case BPF_LDX|BPF_IMM: op = OpLdxImm; return true;
+	case BPF_LDX|BPF_MEM: op = OpLdxMem; return true;
+	case BPF_ST: op = OpSt; return true;
+	case BPF_STX: op = OpStx; return true;
+	case BPF_JMP|BPF_JA: op = OpJa; return true;
+	case BPF_JMP|BPF_JGT|BPF_K: op = OpJgtK; return true;
+	case BPF_JMP|BPF_JGE|BPF_K: op = OpJgeK; return true;
+	case BPF_JMP|BPF_JEQ|BPF_K: op = OpJeqK; return true;
+	case BPF_JMP|BPF_JSET|BPF_K: op = OpJsetK; return true;
+	case BPF_JMP|BPF_JGT|BPF_X: op = OpJgtX; return true;
+	case BPF_JMP|BPF_JGE|BPF_X: op = OpJgeX; return true;
+	case BPF_JMP|BPF_JEQ|BPF_X: op = OpJeqX; return true;
+	case BPF_JMP|BPF_JSET|BPF_X: op = OpJsetX; return true;
+	case BPF_ALU|BPF_ADD|BPF_K: op = OpAddK; return true;
+	case BPF_ALU|BPF_SUB|BPF_K: op = OpSubK; return true;
+	case BPF_ALU|BPF_MUL|BPF_K: op = OpMulK; return true;
+	case BPF_ALU|BPF_DIV|BPF_K: op = OpDivK; return true;
+	case BPF_ALU|BPF_MOD|BPF_K: op = OpModK; return true;
+	case BPF_ALU|BPF_AND|BPF_K: op = OpAndK; return true;
+	case BPF_ALU|BPF_OR|BPF_K: op = OpOrK; return true;
+	case BPF_ALU|BPF_XOR|BPF_K: op = OpXorK; return true;
+	case BPF_ALU|BPF_LSH|BPF_K: op = OpLshK; return true;
+	case BPF_ALU|BPF_RSH|BPF_K: op = OpRshK; return true;
+	case BPF_ALU|BPF_ADD|BPF_X: op = OpAddX; return true;
+	case BPF_ALU|BPF_SUB|BPF_X: op = OpSubX; return true;
+	case BPF_ALU|BPF_MUL|BPF_X: op = OpMulX; return true;
+	case BPF_ALU|BPF_DIV|BPF_X: op = OpDivX; return true;
+	case BPF_ALU|BPF_MOD|BPF_X: op = OpModX; return true;
+	case BPF_ALU|BPF_AND|BPF_X: op = OpAndX; return true;
+	case BPF_ALU|BPF_OR|BPF_X: op = OpOrX; return true;
+	case BPF_ALU|BPF_XOR|BPF_X: op = OpXorX; return true;
+	case BPF_ALU|BPF_LSH|BPF_X: op = OpLshX; return true;
+	case BPF_ALU|BPF_RSH|BPF_X: op = OpRshX; return true;
+	case BPF_ALU|BPF_NEG: op = OpNeg; return true;
+	case BPF_MISC|BPF_TAX: op = OpTax; return true;
+	case BPF_MISC|BPF_TXA: op = OpTxa; return true;
+	default: return false;
+	}
+}
+
+bool ThreadedBpfProgram::compile(const bpf_program* program)
+{
+	if (program == NULL)
+	{
+		clear();
+		return false;
+	}
+
+	return compile(program->bf_insns, program->bf_len);
+}
+
+bool ThreadedBpfProgram::compile(const bpf_insn* instructions, uint32_t numOfInstructions)
+{
+	clear();
+
+	if (instructions == NULL || numOfInstructions == 0)
+		return false;
+
+	std::vector<Instruction> translated(numOfInstructions);
+	bool usesScratchMemory = false;
+
+	for (uint32_t i = 0; i < numOfInstructions; i++)
+	{
+		const bpf_insn& insn = instructions[i];
+		Instruction& cur = translated[i];
+		if (!translateOpcode(insn.code, cur.op))
+		{
+			LOG_DEBUG("Unsupported BPF opcode 0x%X at instruction #%d", (int)insn.code, (int)i);
+			return false;
+		}
+
+		cur.k = insn.k;
+		cur.k2 = 0;
+		cur.jt = 0;
+		cur.jf = 0;
+
+		// the remaining program length after this instruction; a jump can't go beyond it
+		uint32_t remaining = numOfInstructions - i - 1;
+
+		switch (cur.op)
+		{
+		case OpRetK:
+		case OpRetA:
+			continue;
+
+		case OpJa:
+			if (insn.k >= remaining)
+			{
+				LOG_DEBUG("BPF jump out of range at instruction #%d", (int)i);
+				return false;
+			}
+			cur.jt = cur.jf = i + 1 + insn.k;
+			continue;
+
+		case OpJgtK: case OpJgeK: case OpJeqK: case OpJsetK:
+		case OpJgtX: case OpJgeX: case OpJeqX: case OpJsetX:
+			if (insn.jt >= remaining || insn.jf >= remaining)
+			{
+				LOG_DEBUG("BPF jump out of range at instruction #%d", (int)i);
+				return false;
+			}
+			cur.jt = i + 1 + insn.jt;
+			cur.jf = i + 1 + insn.jf;
+			continue;
+
+		case OpLdMem: case OpLdxMem: case OpSt: case OpStx:
+			if (insn.k >= BPF_MEMWORDS)
+			{
+				LOG_DEBUG("BPF scratch memory index out of range at instruction #%d", (int)i);
+				return false;
+			}
+			usesScratchMemory = true;
+			break;
+
+		case OpDivK: case OpModK:
+			if (insn.k == 0)
+			{
+				LOG_DEBUG("BPF division by zero at instruction #%d", (int)i);
+				return false;
+			}
+			break;
+
+		case OpLshK: case OpRshK:
+			if (insn.k >= 32)
+			{
+				LOG_DEBUG("BPF shift out of range at instruction #%d", (int)i);
+				return false;
+			}
+			break;
+
+		default:
+			break;
+		}
+
+		// every other instruction continues to the next one, so it can't be the last one
+		if (remaining == 0)
+		{
+			LOG_DEBUG("BPF program doesn't end with a return instruction");
+			return false;
+		}
+	}
+
+	// fuse load-and-compare pairs. The compare instruction is kept as is because other instructions may jump to it
+	for (uint32_t i = 0; i + 1 < numOfInstructions; i++)
+	{
+		Instruction& cur = translated[i];
+		const Instruction& next = translated[i + 1];
+		if (next.op != OpJeqK)
+			continue;
+
+		if (cur.op == OpLdHAbs)
+			cur.op = OpLdHAbsJeqK;
+		else if (cur.op == OpLdBAbs)
+			cur.op = OpLdBAbsJeqK;
+		else
+			continue;
+
+		cur.k2 = next.k;
+		cur.jt = next.jt;
+		cur.jf = next.jf;
+	}
+
+	m_Instructions.swap(translated);
+	m_UsesScratchMemory = usesScratchMemory;
+	return true;
+}
+
+void ThreadedBpfProgram::clear()
+{
+	m_Instructions.clear();
+	m_UsesScratchMemory = false;
+}
+
+#define EXTRACT_BE16(p) ((uint32_t)(((uint32_t)(p)[0] << 8) | (uint32_t)(p)[1]))
+#define EXTRACT_BE32(p) (((uint32_t)(p)[0] << 24) | ((uint32_t)(p)[1] << 16) | ((uint32_t)(p)[2] << 8) | (uint32_t)(p)[3])
+
+uint32_t ThreadedBpfProgram::run(const uint8_t* packetData, uint32_t wireLength, uint32_t captureLength) const
+{
+	if (m_Instructions.empty())
+		return 0;
+
+	const Instruction* const start = &m_Instructions[0];
+	const Instruction* pc = start;
+	const uint8_t* p = packetData;
+	const uint32_t buflen = captureLength;
+	uint32_t A = 0, X = 0, k;
+	uint32_t mem[BPF_MEMWORDS];
+	if (m_UsesScratchMemory)
+		memset(mem, 0, sizeof(mem));
+
+	// all bounds checks below are the same as in libpcap's bpf_filter(), so truncated packets give the same result
+
+#ifdef PCPP_BPF_COMPUTED_GOTO
+	static const void* const dispatchTable[NumOfThreadedBpfOps] = {
+		&&L_OpRetK, &&L_OpRetA,
+		&&L_OpLdWAbs, &&L_OpLdHAbs, &&L_OpLdBAbs, &&L_OpLdWInd, &&L_OpLdHInd, &&L_OpLdBInd, &&L_OpLdWLen, &&L_OpLdImm, &&L_OpLdMem,
+		&&L_OpLdxWLen, &&L_OpLdxMshB, &&L_OpLdxImm, &&L_OpLdxMem,
+		&&L_OpSt, &&L_OpStx,
+		&&L_OpJa, &&L_OpJgtK, &&L_OpJgeK, &&L_OpJeqK, &&L_OpJsetK, &&L_OpJgtX, &&L_OpJgeX, &&L_OpJeqX, &&L_OpJsetX,
+		&&L_OpAddK, &&L_OpSubK, &&L_OpMulK, &&L_OpDivK, &&L_OpModK, &&L_OpAndK, &&L_OpOrK, &&L_OpXorK, &&L_OpLshK, &&L_OpRshK,
+		&&L_OpAddX, &&L_OpSubX, &&L_OpMulX, &&L_OpDivX, &&L_OpModX, &&L_OpAndX, &&L_OpOrX, &&L_OpXorX, &&L_OpLshX, &&L_OpRshX,
+		&&L_OpNeg, &&L_OpTax, &&L_OpTxa,
+		&&L_OpLdHAbsJeqK, &&L_OpLdBAbsJeqK
+	};
+#define PCPP_BPF_OP(name) L_##name:
+#define PCPP_BPF_DISPATCH() goto *dispatchTable[pc->op]
+#define PCPP_BPF_NEXT() { ++pc; PCPP_BPF_DISPATCH(); }
+#define PCPP_BPF_JUMP_TO(target) { pc = start + (target); PCPP_BPF_DISPATCH(); }
+
+	PCPP_BPF_DISPATCH();
+#else
+#define PCPP_BPF_OP(name) case name:
+#define PCPP_BPF_NEXT() { ++pc; continue; }
+#define PCPP_BPF_JUMP_TO(target) { pc = start + (target); continue; }
+
+	for (;;)
+	{
+	switch (pc->op)
+	{
+	default:
+		return 0;
+#endif
+
+	PCPP_BPF_OP(OpRetK) return pc->k;
+	PCPP_BPF_OP(OpRetA) return A;
+
+	PCPP_BPF_OP(OpLdWAbs)
+		k = pc->k;
+		if (k > buflen || sizeof(int32_t) > buflen - k)
+			return 0;
+		A = EXTRACT_BE32(&p[k]);
+		PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpLdHAbs)
+		k = pc->k;
+		if (k > buflen || sizeof(int16_t) > buflen - k)
+			return 0;
+		A = EXTRACT_BE16(&p[k]);
+		PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpLdBAbs)
+		k = pc->k;
+		if (k >= buflen)
+			return 0;
+		A = p[k];
+		PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpLdWInd)
+		k = X + pc->k;
+		if (pc->k > buflen || X > buflen - pc->k || sizeof(int32_t) > buflen - k)
+			return 0;
+		A = EXTRACT_BE32(&p[k]);
+		PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpLdHInd)
+		k = X + pc->k;
+		if (X > buflen || pc->k > buflen - X || sizeof(int16_t) > buflen - k)
+			return 0;
+		A = EXTRACT_BE16(&p[k]);
+		PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpLdBInd)
+		k = X + pc->k;
+		if (pc->k >= buflen || X >= buflen - pc->k)
+			return 0;
+		A = p[k];
+		PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpLdWLen) A = wireLength; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpLdImm) A = pc->k; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpLdMem) A = mem[pc->k]; PCPP_BPF_NEXT();
+
+	PCPP_BPF_OP(OpLdxWLen) X = wireLength; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpLdxMshB)
+		k = pc->k;
+		if (k >= buflen)
+			return 0;
+		X = (p[k] & 0xf) << 2;
+		PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpLdxImm) X = pc->k; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpLdxMem) X = mem[pc->k]; PCPP_BPF_NEXT();
+
+	PCPP_BPF_OP(OpSt) mem[pc->k] = A; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpStx) mem[pc->k] = X; PCPP_BPF_NEXT();
+
+	PCPP_BPF_OP(OpJa) PCPP_BPF_JUMP_TO(pc->jt);
+	PCPP_BPF_OP(OpJgtK) PCPP_BPF_JUMP_TO(A > pc->k ? pc->jt : pc->jf);
+	PCPP_BPF_OP(OpJgeK) PCPP_BPF_JUMP_TO(A >= pc->k ? pc->jt : pc->jf);
+	PCPP_BPF_OP(OpJeqK) PCPP_BPF_JUMP_TO(A == pc->k ? pc->jt : pc->jf);
+	PCPP_BPF_OP(OpJsetK) PCPP_BPF_JUMP_TO((A & pc->k) ? pc->jt : pc->jf);
+	PCPP_BPF_OP(OpJgtX) PCPP_BPF_JUMP_TO(A > X ? pc->jt : pc->jf);
+	PCPP_BPF_OP(OpJgeX) PCPP_BPF_JUMP_TO(A >= X ? pc->jt : pc->jf);
+	PCPP_BPF_OP(OpJeqX) PCPP_BPF_JUMP_TO(A == X ? pc->jt : pc->jf);
+	PCPP_BPF_OP(OpJsetX) PCPP_BPF_JUMP_TO((A & X) ? pc->jt : pc->jf);
+
+	PCPP_BPF_OP(OpAddK) A += pc->k; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpSubK) A -= pc->k; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpMulK) A *= pc->k; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpDivK) A /= pc->k; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpModK) A %= pc->k; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpAndK) A &= pc->k; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpOrK) A |= pc->k; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpXorK) A ^= pc->k; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpLshK) A <<= pc->k; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpRshK) A >>= pc->k; PCPP_BPF_NEXT();
+
+	PCPP_BPF_OP(OpAddX) A += X; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpSubX) A -= X; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpMulX) A *= X; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpDivX)
+		if (X == 0)
+			return 0;
+		A /= X;
+		PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpModX)
+		if (X == 0)
+			return 0;
+		A %= X;
+		PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpAndX) A &= X; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpOrX) A |= X; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpXorX) A ^= X; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpLshX) A = (X < 32 ? A << X : 0); PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpRshX) A = (X < 32 ? A >> X : 0); PCPP_BPF_NEXT();
+
+	PCPP_BPF_OP(OpNeg) A = 0U - A; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpTax) X = A; PCPP_BPF_NEXT();
+	PCPP_BPF_OP(OpTxa) A = X; PCPP_BPF_NEXT();
+
+	PCPP_BPF_OP(OpLdHAbsJeqK)
+		k = pc->k;
+		if (k > buflen || sizeof(int16_t) > buflen - k)
+			return 0;
+		A = EXTRACT_BE16(&p[k]);
+		PCPP_BPF_JUMP_TO(A == pc->k2 ? pc->jt : pc->jf);
+	PCPP_BPF_OP(OpLdBAbsJeqK)
+		k = pc->k;
+		if (k >= buflen)
+			return 0;
+		A = p[k];
+		PCPP_BPF_JUMP_TO(A == pc->k2 ? pc->jt : pc->jf);
+
+#ifndef PCPP_BPF_COMPUTED_GOTO
+	}
+	}
+#endif
+
+#undef PCPP_BPF_OP
+#undef PCPP_BPF_DISPATCH
+#undef PCPP_BPF_NEXT
+#undef PCPP_BPF_JUMP_TO
+}
+
+} // namespace pcpp
@@ -2,6 +2,7 @@ from os import path
 import pytest
 import re
 import ntpath
+from scapy.all import wrpcap, Ether, IP, IPv6, IPv6ExtHdrFragment, TCP, UDP
 from test_utils import ExampleTest
 
 class TestPcapSearch(ExampleTest):
@@ -43,6 +44,48 @@ class TestPcapSearch(ExampleTest):
 
 		assert expected.issubset(actual)
 
+	@pytest.mark.parametrize('use_summaries', [False, True])
+	def test_filter_not_compiled_for_link_type(self, tmpdir, use_summaries):
+		# ethernet addresses can't be matched in a raw IP file, so its packets never match instead of all of them matching
+		packets = [IP(src='10.0.0.1', dst='10.0.0.2')/TCP(sport=1234, dport=80)] * 5 + [IP(src='10.0.0.1', dst='10.0.0.2')/UDP(sport=1234, dport=53)] * 3
+		wrpcap(path.join(tmpdir, 'raw_ip.pcap'), packets, linktype=101)
+		args = {
+			'-d': str(tmpdir),
+			'-s': 'ether host 00:11:22:33:44:55'
+		}
+		if use_summaries:
+			args['-i'] = ''
+		completed_process = self.run_example(args=args)
+		assert '0 packets were matched to search criteria' in completed_process.stdout
+
+	@pytest.mark.parametrize('use_summaries', [False, True])
+	def test_raw_ip_file(self, tmpdir, use_summaries):
+		packets = [IP(src='10.0.0.1', dst='10.0.0.2')/TCP(sport=1234, dport=80)] * 5 + [IP(src='10.0.0.1', dst='10.0.0.2')/UDP(sport=1234, dport=53)] * 3
+		wrpcap(path.join(tmpdir, 'raw_ip.pcap'), packets, linktype=101)
+		args = {
+			'-d': str(tmpdir),
+			'-s': 'tcp port 80'
+		}
+		if use_summaries:
+			args['-i'] = ''
+		# with summaries the first search builds the summary file and the second one searches through it
+		for _ in range(2 if use_summaries else 1):
+			completed_process = self.run_example(args=args)
+			assert '5 packets were matched to search criteria' in completed_process.stdout
+
+	def test_summary_ipv6_fragment_header(self, tmpdir):
+		packets = [Ether()/IPv6(src='2001:db8::1', dst='2001:db8::2')/IPv6ExtHdrFragment()/TCP(sport=1234, dport=80)] * 4
+		wrpcap(path.join(tmpdir, 'ipv6_frag.pcap'), packets)
+		args = {
+			'-d': str(tmpdir),
+			'-s': 'tcp',
+			'-i': ''
+		}
+		# the second search skips chunks by the summary built in the first one, so it must not skip the fragmented TCP packets
+		for _ in range(2):
+			completed_process = self.run_example(args=args)
+			assert '4 packets were matched to search criteria' in completed_process.stdout
+
 	def test_different_file_extensions(self):
 		args = {
 			'-d': 'pcap_examples',
@@ -40,6 +40,7 @@ PTF_TEST_CASE(TcpPacketCreation2);
 PTF_TEST_CASE(PacketUtilsHash5TupleUdp);
 PTF_TEST_CASE(PacketUtilsHash5TupleTcp);
 PTF_TEST_CASE(PacketUtilsHash5TupleIPv6);
+PTF_TEST_CASE(PacketUtilsChecksum);
 
 // Implemented in PacketTests.cpp
 PTF_TEST_CASE(InsertDataToPacket);
@@ -51,6 +52,8 @@ PTF_TEST_CASE(RawPacketTimeStampSetterTest);
 PTF_TEST_CASE(ParsePartialPacketTest);
 PTF_TEST_CASE(PacketTrailerTest);
 PTF_TEST_CASE(ResizeLayerTest);
+PTF_TEST_CASE(LayerArenaTest);
+PTF_TEST_CASE(LazyParsingTest);
 
 // Implemented in HttpTests.cpp
 PTF_TEST_CASE(HttpRequestLayerParsingTest);
@@ -59,6 +62,7 @@ PTF_TEST_CASE(HttpRequestLayerEditTest);
 PTF_TEST_CASE(HttpResponseLayerParsingTest);
 PTF_TEST_CASE(HttpResponseLayerCreationTest);
 PTF_TEST_CASE(HttpResponseLayerEditTest);
+PTF_TEST_CASE(HttpHeaderFieldLookupTest);
 
 // Implemented in PPPoETests.cpp
 PTF_TEST_CASE(PPPoESessionLayerParsingTest);
@@ -143,3 +147,7 @@ PTF_TEST_CASE(BgpLayerEditTest);
 // Implemented in SSHTests.cpp
 PTF_TEST_CASE(SSHParsingTest);
 PTF_TEST_CASE(SSHMalformedParsingTest);
+
+// Implemented in PatternMatcherTests.cpp
+PTF_TEST_CASE(PatternMatcherSearchTest);
+PTF_TEST_CASE(PatternMatcherStreamTest);
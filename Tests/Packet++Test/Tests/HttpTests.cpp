@@ -9,6 +9,7 @@
 #include "HttpLayer.h"
 #include "PayloadLayer.h"
 #include "SystemUtils.h"
+#include <ctype.h>
 
 PTF_TEST_CASE(HttpRequestLayerParsingTest)
 {
@@ -298,3 +299,87 @@ PTF_TEST_CASE(HttpResponseLayerEditTest)
 	expectedHttpResponse = "HTTP/1.1 413 This is a test\r\nContent-Length: 345\r\n";
 	PTF_ASSERT_BUF_COMPARE(expectedHttpResponse.c_str(), responseLayer->getData(), expectedHttpResponse.length());
 } // HttpResponseLayerEditTest
+
+
+
+PTF_TEST_CASE(HttpHeaderFieldLookupTest)
+{
+	// well-known names and other names, added in an order that differs from the well-known names table and in more than one case
+	const char* fieldNames[] = {
+		"Host", "User-Agent", "Accept", "Accept-Language", "Accept-Encoding", "Cookie", "Connection", "Content-Type", "Content-Length",
+		"Content-Encoding", "Transfer-Encoding", "Server", "Set-Cookie", "Date", "Location", "Referer", "Cache-Control", "Authorization",
+		"WWW-Authenticate", "Content-Disposition", "Content-Language", "Allow", "Retry-After", "MIME-Version", "Via", "From", "To",
+		"Call-ID", "CSeq", "Contact", "Max-Forwards", "Record-Route", "Supported", "Reason",
+		"X-Forwarded-For", "X-Custom", "DNT", "Upgrade-Insecure-Requests", "Hots", "Hostx"
+	};
+	const size_t numOfFieldNames = sizeof(fieldNames) / sizeof(fieldNames[0]);
+
+	pcpp::HttpRequestLayer httpLayer(pcpp::HttpRequestLayer::HttpGET, "/", pcpp::OneDotOne);
+	for (size_t i = 0; i < numOfFieldNames; i++)
+	{
+		std::string value = std::string("value-") + fieldNames[i];
+		PTF_ASSERT_NOT_NULL(httpLayer.addField(fieldNames[i], value));
+	}
+
+	// more fields than the ones stored inline in the layer
+	PTF_ASSERT_EQUAL(httpLayer.getFieldCount(), (int)numOfFieldNames, int);
+
+	for (size_t i = 0; i < numOfFieldNames; i++)
+	{
+		std::string name = fieldNames[i];
+		std::string lowerName = name, upperName = name;
+		for (size_t j = 0; j < name.length(); j++)
+		{
+			lowerName[j] = tolower(name[j]);
+			upperName[j] = toupper(name[j]);
+		}
+
+		std::string expectedValue = std::string("value-") + fieldNames[i];
+		PTF_ASSERT_NOT_NULL(httpLayer.getFieldByName(name));
+		PTF_ASSERT_EQUAL(httpLayer.getFieldByName(name)->getFieldValue(), expectedValue, string);
+		PTF_ASSERT_EQUAL(httpLayer.getFieldByName(lowerName)->getFieldValue(), expectedValue, string);
+		PTF_ASSERT_EQUAL(httpLayer.getFieldByName(upperName)->getFieldValue(), expectedValue, string);
+		PTF_ASSERT_NULL(httpLayer.getFieldByName(name, 1));
+	}
+
+	PTF_ASSERT_NULL(httpLayer.getFieldByName("Hos"));
+	PTF_ASSERT_NULL(httpLayer.getFieldByName("X-Forwarded"));
+	PTF_ASSERT_NULL(httpLayer.getFieldByName(""));
+
+	PTF_ASSERT_NOT_NULL(httpLayer.addEndOfHeader());
+	PTF_ASSERT_NOT_NULL(httpLayer.getFieldByName(""));
+	PTF_ASSERT_TRUE(httpLayer.getFieldByName("")->isEndOfHeader());
+
+	// remove fields stored inline and on the heap, then add fields in their place
+	PTF_ASSERT_TRUE(httpLayer.removeField("host"));
+	PTF_ASSERT_TRUE(httpLayer.removeField("X-CUSTOM"));
+	PTF_ASSERT_TRUE(httpLayer.removeField("set-cookie"));
+	PTF_ASSERT_NULL(httpLayer.getFieldByName("Host"));
+	PTF_ASSERT_NULL(httpLayer.getFieldByName("x-custom"));
+	PTF_ASSERT_NULL(httpLayer.getFieldByName("Set-Cookie"));
+
+	pcpp::HeaderField* hostField = httpLayer.insertField(NULL, PCPP_HTTP_HOST_FIELD, "www.example.com");
+	PTF_ASSERT_NOT_NULL(hostField);
+	PTF_ASSERT_TRUE(httpLayer.getFirstField() == hostField);
+	PTF_ASSERT_TRUE(httpLayer.getFieldByName("HOST") == hostField);
+	PTF_ASSERT_NOT_NULL(httpLayer.insertField(hostField, "X-Inserted", "1"));
+	PTF_ASSERT_EQUAL(httpLayer.getFieldByName("x-inserted")->getFieldValue(), "1", string);
+	PTF_ASSERT_EQUAL(httpLayer.getFieldCount(), (int)numOfFieldNames - 1, int);
+
+	// a copy gets fields of its own
+	pcpp::HttpRequestLayer copiedLayer(httpLayer);
+	PTF_ASSERT_EQUAL(copiedLayer.getFieldCount(), httpLayer.getFieldCount(), int);
+	PTF_ASSERT_NOT_NULL(copiedLayer.getFieldByName("Host"));
+	PTF_ASSERT_TRUE(copiedLayer.getFieldByName("Host") != hostField);
+	PTF_ASSERT_EQUAL(copiedLayer.getFieldByName("host")->getFieldValue(), "www.example.com", string);
+	PTF_ASSERT_EQUAL(copiedLayer.getFieldByName("upgrade-insecure-requests")->getFieldValue(), "value-Upgrade-Insecure-Requests", string);
+	PTF_ASSERT_EQUAL(copiedLayer.getHeaderLen(), httpLayer.getHeaderLen(), size);
+	PTF_ASSERT_BUF_COMPARE(copiedLayer.getData(), httpLayer.getData(), httpLayer.getHeaderLen());
+
+	pcpp::HttpRequestLayer assignedLayer(pcpp::HttpRequestLayer::HttpPOST, "/other", pcpp::OneDotZero);
+	PTF_ASSERT_NOT_NULL(assignedLayer.addField("Via", "proxy"));
+	assignedLayer = copiedLayer;
+	PTF_ASSERT_EQUAL(assignedLayer.getFieldCount(), copiedLayer.getFieldCount(), int);
+	PTF_ASSERT_EQUAL(assignedLayer.getFieldByName("VIA")->getFieldValue(), "value-Via", string);
+	PTF_ASSERT_EQUAL(assignedLayer.getFieldByName("dnt")->getFieldValue(), "value-DNT", string);
+} // HttpHeaderFieldLookupTest
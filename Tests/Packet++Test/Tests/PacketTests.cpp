@@ -915,4 +915,120 @@ PTF_TEST_CASE(ResizeLayerTest)
 	PTF_ASSERT_EQUAL(rawData2[5], 0xAD, u8);
 	PTF_ASSERT_EQUAL(rawData2[6], 0xBE, u8);
 	PTF_ASSERT_EQUAL(rawData2[7], 0xEF, u8);
-} // ResizeLayerTest
\ No newline at end of file
+} // ResizeLayerTest
+
+
+PTF_TEST_CASE(LayerArenaTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	READ_FILE_AND_CREATE_PACKET(1, "PacketExamples/radius_1.dat");
+	READ_FILE_AND_CREATE_PACKET(2, "PacketExamples/Vxlan1.dat");
+	READ_FILE_AND_CREATE_PACKET(3, "PacketExamples/radius_1.dat");
+
+	// re-parsing into the same packet reuses the arena, so layers are placed in the same memory
+	pcpp::Packet packet(&rawPacket1);
+	pcpp::Layer* firstLayer = packet.getFirstLayer();
+	pcpp::Layer* lastLayer = packet.getLastLayer();
+	packet.setRawPacket(&rawPacket2, false);
+	PTF_ASSERT_TRUE(packet.getFirstLayer() == firstLayer);
+	PTF_ASSERT_TRUE(packet.isPacketOfType(pcpp::VXLAN));
+	packet.setRawPacket(&rawPacket1, false);
+	PTF_ASSERT_TRUE(packet.getFirstLayer() == firstLayer);
+	PTF_ASSERT_TRUE(packet.getLastLayer() == lastLayer);
+	PTF_ASSERT_NOT_NULL(packet.getLayerOfType<pcpp::RadiusLayer>());
+
+	// a detached layer outlives the packet it was parsed in
+	pcpp::Layer* detachedLayer = NULL;
+	{
+		pcpp::Packet radiusPacket(&rawPacket3);
+		detachedLayer = radiusPacket.detachLayer(pcpp::Radius);
+		PTF_ASSERT_NOT_NULL(detachedLayer);
+		radiusPacket.setRawPacket(&rawPacket2, false);
+		PTF_ASSERT_TRUE(radiusPacket.isPacketOfType(pcpp::VXLAN));
+	}
+
+	PTF_ASSERT_EQUAL(detachedLayer->getProtocol(), pcpp::Radius, enum);
+	PTF_ASSERT_FALSE(detachedLayer->isAllocatedToPacket());
+	PTF_ASSERT_EQUAL(((pcpp::RadiusLayer*)detachedLayer)->getRadiusHeader()->code, 1, u8);
+	delete detachedLayer;
+
+	// layers created by the user are allocated on the heap and are owned by the user
+	pcpp::Packet copiedPacket(packet);
+	pcpp::PayloadLayer* payloadLayer = new pcpp::PayloadLayer((const uint8_t*)"\x01\x02\x03\x04", 4, false);
+	PTF_ASSERT_TRUE(copiedPacket.addLayer(payloadLayer));
+	PTF_ASSERT_EQUAL(copiedPacket.getLastLayer()->getProtocol(), pcpp::GenericPayload, enum);
+	PTF_ASSERT_TRUE(copiedPacket.removeLastLayer());
+	PTF_ASSERT_EQUAL(copiedPacket.getLastLayer()->getProtocol(), pcpp::Radius, enum);
+	delete payloadLayer;
+} // LayerArenaTest
+
+
+
+PTF_TEST_CASE(LazyParsingTest)
+{
+	timeval time;
+	gettimeofday(&time, NULL);
+
+	READ_FILE_AND_CREATE_PACKET(1, "PacketExamples/TwoHttpRequests1.dat");
+	READ_FILE_AND_CREATE_PACKET(2, "PacketExamples/packet_trailer_ipv4.dat");
+	READ_FILE_AND_CREATE_PACKET(3, "PacketExamples/GREv0_1.dat");
+	READ_FILE_AND_CREATE_PACKET(4, "PacketExamples/TwoHttpRequests1.dat");
+
+	// a lazily parsed packet ends up with the same layers as an eagerly parsed one
+	pcpp::RawPacket* rawPackets[] = { &rawPacket1, &rawPacket2, &rawPacket3 };
+	for (int i = 0; i < 3; i++)
+	{
+		pcpp::Packet eagerPacket(rawPackets[i]);
+		pcpp::Packet lazyPacket(rawPackets[i], pcpp::LazyParsing);
+
+		pcpp::Layer* eagerLayer = eagerPacket.getFirstLayer();
+		pcpp::Layer* lazyLayer = lazyPacket.getFirstLayer();
+		while (eagerLayer != NULL)
+		{
+			PTF_ASSERT_NOT_NULL(lazyLayer);
+			PTF_ASSERT_EQUAL(lazyLayer->getProtocol(), eagerLayer->getProtocol(), enum);
+			PTF_ASSERT_EQUAL(lazyLayer->getDataLen(), eagerLayer->getDataLen(), size);
+			eagerLayer = eagerLayer->getNextLayer();
+			lazyLayer = lazyLayer->getNextLayer();
+		}
+
+		PTF_ASSERT_NULL(lazyLayer);
+		PTF_ASSERT_EQUAL(lazyPacket.getLastLayer()->getProtocol(), eagerPacket.getLastLayer()->getProtocol(), enum);
+		PTF_ASSERT_EQUAL(lazyPacket.toString(), eagerPacket.toString(), string);
+	}
+
+	// layers are parsed only when they're reached
+	pcpp::Packet httpPacket(&rawPacket1, pcpp::LazyParsing);
+	PTF_ASSERT_TRUE(httpPacket.isPacketOfType(pcpp::Ethernet));
+	pcpp::IPv4Layer* ipLayer = httpPacket.getLayerOfType<pcpp::IPv4Layer>();
+	PTF_ASSERT_NOT_NULL(ipLayer);
+	{
+		pcpp::Packet eagerHttpPacket(&rawPacket4);
+		PTF_ASSERT_EQUAL(ipLayer->getDstIpAddress(), eagerHttpPacket.getLayerOfType<pcpp::IPv4Layer>()->getDstIpAddress(), object);
+	}
+	// the layer after IPv4 isn't parsed yet, so it's parsed from the modified data
+	ipLayer->getIPv4Header()->protocol = pcpp::PACKETPP_IPPROTO_UDP;
+	PTF_ASSERT_NOT_NULL(httpPacket.getLayerOfType<pcpp::UdpLayer>());
+	PTF_ASSERT_FALSE(httpPacket.isPacketOfType(pcpp::TCP));
+	PTF_ASSERT_FALSE(httpPacket.isPacketOfType(pcpp::HTTPRequest));
+
+	// a packet is fully parsed before it's modified
+	pcpp::Packet lazyPacket(&rawPacket4, pcpp::LazyParsing);
+	pcpp::PayloadLayer payloadLayer((const uint8_t*)"\x01\x02\x03\x04", 4, false);
+	PTF_ASSERT_TRUE(lazyPacket.addLayer(&payloadLayer));
+	PTF_ASSERT_TRUE(lazyPacket.getLastLayer() == &payloadLayer);
+	PTF_ASSERT_EQUAL(payloadLayer.getPrevLayer()->getProtocol(), pcpp::HTTPRequest, enum);
+	PTF_ASSERT_TRUE(lazyPacket.removeLastLayer());
+	PTF_ASSERT_EQUAL(lazyPacket.getLastLayer()->getProtocol(), pcpp::HTTPRequest, enum);
+
+	// reusing a packet
+	lazyPacket.setRawPacket(&rawPacket2, false, pcpp::LazyParsing);
+	PTF_ASSERT_TRUE(lazyPacket.isPacketOfType(pcpp::PacketTrailer));
+	lazyPacket.setRawPacket(&rawPacket3, false, pcpp::EagerParsing);
+	PTF_ASSERT_TRUE(lazyPacket.isPacketOfType(pcpp::GREv0));
+	lazyPacket.setRawPacket(NULL, false, pcpp::LazyParsing);
+	PTF_ASSERT_NULL(lazyPacket.getFirstLayer());
+	PTF_ASSERT_NULL(lazyPacket.getLastLayer());
+} // LazyParsingTest
@@ -1,3 +1,5 @@
+#include <vector>
+#include <string.h>
 #include "../TestDefinition.h"
 #include "../Utils/TestUtils.h"
 #include "EndianPortable.h"
@@ -134,3 +136,100 @@ PTF_TEST_CASE(PacketUtilsHash5TupleIPv6)
 	PTF_ASSERT_EQUAL(pcpp::hash5Tuple(&dstSrcPacket, true), 4288746927, u32);
 
 } // PacketUtilsHash5TupleIPv6
+
+
+
+static uint16_t referenceChecksum(const uint8_t* data, size_t dataLen)
+{
+	uint64_t sum = 0;
+	for (size_t i = 0; i + 1 < dataLen; i += 2)
+		sum += (data[i] << 8) | data[i + 1];
+	if (dataLen % 2 == 1)
+		sum += data[dataLen - 1] << 8;
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return (uint16_t)~sum;
+}
+
+PTF_TEST_CASE(PacketUtilsChecksum)
+{
+	// compare against a straightforward implementation for all lengths and alignments the vectorized code handles differently
+	std::vector<uint8_t> data(1024 * 1024 + 3);
+	srand(1);
+	for (size_t i = 0; i < data.size(); i++)
+		data[i] = (uint8_t)rand();
+
+	for (size_t offset = 0; offset < 4; offset++)
+	{
+		for (size_t len = 0; len < 300; len++)
+		{
+			pcpp::ScalarBuffer<uint16_t> buffer = { (uint16_t*)&data[offset], len };
+			PTF_ASSERT_EQUAL(pcpp::computeChecksum(&buffer, 1), referenceChecksum(&data[offset], len), u16);
+		}
+	}
+
+	pcpp::ScalarBuffer<uint16_t> largeBuffer = { (uint16_t*)&data[1], data.size() - 1 };
+	PTF_ASSERT_EQUAL(pcpp::computeChecksum(&largeBuffer, 1), referenceChecksum(&data[1], data.size() - 1), u16);
+
+	// the sum of many 0xFFFF words is where intermediate sums would overflow
+	std::vector<uint8_t> allOnes(1024 * 1024, 0xff);
+	pcpp::ScalarBuffer<uint16_t> allOnesBuffer = { (uint16_t*)&allOnes[0], allOnes.size() };
+	PTF_ASSERT_EQUAL(pcpp::computeChecksum(&allOnesBuffer, 1), referenceChecksum(&allOnes[0], allOnes.size()), u16);
+
+	// multiple buffers are each summed on their own, so the second buffer starts at an even offset even if the first one is odd
+	pcpp::ScalarBuffer<uint16_t> vec[2] = { { (uint16_t*)&data[0], 101 }, { (uint16_t*)&data[200], 64 } };
+	uint32_t sum = (uint16_t)~referenceChecksum(&data[0], 101) + (uint16_t)~referenceChecksum(&data[200], 64);
+	sum = (sum & 0xffff) + (sum >> 16);
+	PTF_ASSERT_EQUAL(pcpp::computeChecksum(vec, 2), (uint16_t)~sum, u16);
+
+	// incremental updates (RFC 1624) give the same result as computing the checksum again
+	timeval time;
+	gettimeofday(&time, NULL);
+	READ_FILE_AND_CREATE_PACKET(1, "PacketExamples/TcpPacketWithOptions3.dat");
+	pcpp::Packet tcpPacket(&rawPacket1);
+	pcpp::IPv4Layer* ipLayer = tcpPacket.getLayerOfType<pcpp::IPv4Layer>();
+	pcpp::TcpLayer* tcpLayer = tcpPacket.getLayerOfType<pcpp::TcpLayer>();
+	PTF_ASSERT_NOT_NULL(ipLayer);
+	PTF_ASSERT_NOT_NULL(tcpLayer);
+	pcpp::iphdr* ipHdr = ipLayer->getIPv4Header();
+	// make sure the checksums in the packet are valid before updating them
+	ipLayer->computeCalculateFields();
+	tcpLayer->calculateChecksum(true);
+
+	// TTL decrement
+	uint16_t oldTtlWord, newTtlWord;
+	memcpy(&oldTtlWord, &ipHdr->timeToLive, sizeof(uint16_t));
+	ipHdr->timeToLive--;
+	memcpy(&newTtlWord, &ipHdr->timeToLive, sizeof(uint16_t));
+	uint16_t updatedChecksum = pcpp::updateChecksum16(ipHdr->headerChecksum, oldTtlWord, newTtlWord);
+	ipLayer->computeCalculateFields();
+	PTF_ASSERT_EQUAL(updatedChecksum, ipHdr->headerChecksum, u16);
+
+	// source address rewrite, which changes both the IPv4 header checksum and the TCP checksum (via the pseudo header)
+	uint32_t oldSrcIp = ipHdr->ipSrc;
+	uint32_t newSrcIp = pcpp::IPv4Address("192.168.100.200").toInt();
+	uint16_t updatedIpChecksum = pcpp::updateChecksum32(ipHdr->headerChecksum, oldSrcIp, newSrcIp);
+	uint16_t updatedTcpChecksum = pcpp::updateChecksum32(tcpLayer->getTcpHeader()->headerChecksum, oldSrcIp, newSrcIp);
+	uint16_t updatedTcpChecksumFromBytes = pcpp::updateChecksum(tcpLayer->getTcpHeader()->headerChecksum, (uint8_t*)&oldSrcIp, (uint8_t*)&newSrcIp, 4);
+	ipHdr->ipSrc = newSrcIp;
+	ipLayer->computeCalculateFields();
+	PTF_ASSERT_EQUAL(updatedIpChecksum, ipHdr->headerChecksum, u16);
+	PTF_ASSERT_EQUAL(be16toh(updatedTcpChecksum), tcpLayer->calculateChecksum(false), u16);
+	PTF_ASSERT_EQUAL(updatedTcpChecksumFromBytes, updatedTcpChecksum, u16);
+
+	// IPv6 address rewrite
+	READ_FILE_AND_CREATE_PACKET(2, "PacketExamples/IPv6UdpPacket.dat");
+	pcpp::Packet udpPacket(&rawPacket2);
+	pcpp::IPv6Layer* ipv6Layer = udpPacket.getLayerOfType<pcpp::IPv6Layer>();
+	pcpp::UdpLayer* udpLayer = udpPacket.getLayerOfType<pcpp::UdpLayer>();
+	PTF_ASSERT_NOT_NULL(ipv6Layer);
+	PTF_ASSERT_NOT_NULL(udpLayer);
+	udpLayer->calculateChecksum(true);
+	uint8_t oldSrcIpv6[16];
+	uint8_t newSrcIpv6[16];
+	memcpy(oldSrcIpv6, ipv6Layer->getIPv6Header()->ipSrc, 16);
+	pcpp::IPv6Address("2001:db8::1234:5678").copyTo(newSrcIpv6);
+	updatedChecksum = pcpp::updateChecksum(udpLayer->getUdpHeader()->headerChecksum, oldSrcIpv6, newSrcIpv6, 16);
+	memcpy(ipv6Layer->getIPv6Header()->ipSrc, newSrcIpv6, 16);
+	PTF_ASSERT_EQUAL(be16toh(updatedChecksum), udpLayer->calculateChecksum(false), u16);
+} // PacketUtilsChecksum
@@ -0,0 +1,317 @@
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+#include "../TestDefinition.h"
+#include "../Utils/TestUtils.h"
+#include "Logger.h"
+#include "Packet.h"
+#include "PatternMatcher.h"
+#include "SystemUtils.h"
+
+
+struct PatternMatcherTestPattern
+{
+	std::string bytes;
+	uint32_t id;
+	bool caseInsensitive;
+};
+
+static bool patternMatchLess(const pcpp::PatternMatch& first, const pcpp::PatternMatch& second)
+{
+	if (first.endOffset != second.endOffset)
+		return first.endOffset < second.endOffset;
+	if (first.startOffset != second.startOffset)
+		return first.startOffset < second.startOffset;
+	return first.patternId < second.patternId;
+}
+
+static bool patternMatchEqual(const pcpp::PatternMatch& first, const pcpp::PatternMatch& second)
+{
+	return first.patternId == second.patternId && first.startOffset == second.startOffset && first.endOffset == second.endOffset;
+}
+
+static bool bytesEqual(const uint8_t* data, const std::string& pattern, bool caseInsensitive)
+{
+	for (size_t i = 0; i < pattern.length(); i++)
+	{
+		uint8_t dataByte = data[i], patternByte = (uint8_t)pattern[i];
+		if (caseInsensitive)
+		{
+			dataByte = (uint8_t)tolower(dataByte);
+			patternByte = (uint8_t)tolower(patternByte);
+		}
+
+		if (dataByte != patternByte)
+			return false;
+	}
+
+	return true;
+}
+
+// a reference search that compares every pattern at every offset
+static std::vector<pcpp::PatternMatch> bruteForceSearch(const std::vector<PatternMatcherTestPattern>& patterns, const std::vector<uint8_t>& data)
+{
+	std::vector<pcpp::PatternMatch> result;
+	for (size_t i = 0; i < patterns.size(); i++)
+	{
+		for (size_t offset = 0; offset + patterns[i].bytes.length() <= data.size(); offset++)
+		{
+			if (bytesEqual(&data[offset], patterns[i].bytes, patterns[i].caseInsensitive))
+			{
+				pcpp::PatternMatch match;
+				match.patternId = patterns[i].id;
+				match.startOffset = offset;
+				match.endOffset = offset + patterns[i].bytes.length();
+				result.push_back(match);
+			}
+		}
+	}
+
+	std::sort(result.begin(), result.end(), patternMatchLess);
+	return result;
+}
+
+static void generatePatternMatcherData(const std::vector<PatternMatcherTestPattern>& patterns, size_t dataLen, std::vector<uint8_t>& data)
+{
+	data.resize(dataLen);
+	for (size_t i = 0; i < dataLen; i++)
+		data[i] = (uint8_t)rand();
+
+	// plant occurrences of the patterns, flipping the case of case-insensitive ones, some of them overlapping each other
+	for (size_t i = 0; i < dataLen / 16; i++)
+	{
+		const PatternMatcherTestPattern& pattern = patterns[rand() % patterns.size()];
+		if (pattern.bytes.length() > dataLen)
+			continue;
+
+		size_t offset = rand() % (dataLen - pattern.bytes.length() + 1);
+		for (size_t j = 0; j < pattern.bytes.length(); j++)
+		{
+			uint8_t value = (uint8_t)pattern.bytes[j];
+			if (pattern.caseInsensitive && (rand() % 2) == 0)
+				value = (uint8_t)(isupper(value) ? tolower(value) : toupper(value));
+			data[offset + j] = value;
+		}
+	}
+}
+
+static void collectStreamMatch(const pcpp::PatternMatch& match, void* userCookie)
+{
+	((std::vector<pcpp::PatternMatch>*)userCookie)->push_back(match);
+}
+
+struct FlowMatchRecord
+{
+	uint32_t flowKey;
+	int8_t side;
+	pcpp::PatternMatch match;
+};
+
+static void collectFlowMatch(uint32_t flowKey, int8_t side, const pcpp::PatternMatch& match, void* userCookie)
+{
+	FlowMatchRecord record;
+	record.flowKey = flowKey;
+	record.side = side;
+	record.match = match;
+	((std::vector<FlowMatchRecord>*)userCookie)->push_back(record);
+}
+
+
+
+PTF_TEST_CASE(PatternMatcherSearchTest)
+{
+	pcpp::PatternMatcher matcher;
+
+	// invalid patterns and an empty matcher
+	pcpp::LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(matcher.addPattern("", 1));
+	PTF_ASSERT_FALSE(matcher.addPattern(NULL, 3, 1));
+	pcpp::LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_EQUAL(matcher.getNumOfPatterns(), 0, size);
+	const uint8_t someData[] = "some data to search";
+	std::vector<pcpp::PatternMatch> matches;
+	PTF_ASSERT_EQUAL(matcher.search(someData, sizeof(someData) - 1, matches), 0, size);
+	PTF_ASSERT_TRUE(matcher.compile());
+	PTF_ASSERT_FALSE(matcher.containsAny(someData, sizeof(someData) - 1));
+
+	// the classic Aho-Corasick example with overlapping patterns
+	PTF_ASSERT_TRUE(matcher.addPattern("he", 1));
+	PTF_ASSERT_TRUE(matcher.addPattern("she", 2));
+	PTF_ASSERT_TRUE(matcher.addPattern("his", 3));
+	PTF_ASSERT_TRUE(matcher.addPattern("hers", 4));
+	PTF_ASSERT_FALSE(matcher.isCompiled());
+	PTF_ASSERT_TRUE(matcher.compile());
+	PTF_ASSERT_TRUE(matcher.isCompiled());
+	PTF_ASSERT_EQUAL(matcher.getNumOfStates(), 10, size);
+	const uint8_t ushers[] = "ushers";
+	PTF_ASSERT_EQUAL(matcher.search(ushers, 6, matches), 3, size);
+	PTF_ASSERT_EQUAL(matches[0].patternId, 2, u32);
+	PTF_ASSERT_EQUAL(matches[0].startOffset, 1, u64);
+	PTF_ASSERT_EQUAL(matches[0].endOffset, 4, u64);
+	PTF_ASSERT_EQUAL(matches[1].patternId, 1, u32);
+	PTF_ASSERT_EQUAL(matches[1].startOffset, 2, u64);
+	PTF_ASSERT_EQUAL(matches[2].patternId, 4, u32);
+	PTF_ASSERT_EQUAL(matches[2].startOffset, 2, u64);
+	PTF_ASSERT_EQUAL(matches[2].endOffset, 6, u64);
+	PTF_ASSERT_TRUE(matcher.containsAny(ushers, 6));
+	PTF_ASSERT_FALSE(matcher.containsAny(ushers, 3));
+
+	// case-insensitive patterns together with case-sensitive ones, binary patterns and duplicate IDs
+	matcher.clear();
+	PTF_ASSERT_EQUAL(matcher.getNumOfPatterns(), 0, size);
+	PTF_ASSERT_TRUE(matcher.addPattern("Host:", 10, true));
+	PTF_ASSERT_TRUE(matcher.addPattern("host", 11));
+	const uint8_t binaryPattern[] = { 0x00, 0xff, 0x00 };
+	PTF_ASSERT_TRUE(matcher.addPattern(binaryPattern, sizeof(binaryPattern), 12));
+	PTF_ASSERT_TRUE(matcher.addPattern("HOST", 12));
+	PTF_ASSERT_TRUE(matcher.compile());
+	const uint8_t mixedData[] = { 'h', 'O', 's', 'T', ':', 'h', 'o', 's', 't', ':', 0x00, 0xff, 0x00, 0xff, 0x00, 'H', 'O', 'S', 'T' };
+	matches.clear();
+	PTF_ASSERT_EQUAL(matcher.search(mixedData, sizeof(mixedData), matches), 6, size);
+	std::sort(matches.begin(), matches.end(), patternMatchLess);
+	PTF_ASSERT_EQUAL(matches[0].patternId, 10, u32);
+	PTF_ASSERT_EQUAL(matches[0].startOffset, 0, u64);
+	PTF_ASSERT_EQUAL(matches[1].patternId, 11, u32);
+	PTF_ASSERT_EQUAL(matches[1].startOffset, 5, u64);
+	PTF_ASSERT_EQUAL(matches[2].patternId, 10, u32);
+	PTF_ASSERT_EQUAL(matches[2].startOffset, 5, u64);
+	PTF_ASSERT_EQUAL(matches[3].patternId, 12, u32);
+	PTF_ASSERT_EQUAL(matches[3].startOffset, 10, u64);
+	PTF_ASSERT_EQUAL(matches[4].patternId, 12, u32);
+	PTF_ASSERT_EQUAL(matches[4].startOffset, 12, u64);
+	PTF_ASSERT_EQUAL(matches[5].patternId, 12, u32);
+	PTF_ASSERT_EQUAL(matches[5].startOffset, 15, u64);
+
+	// compare random pattern sets with a brute-force search. The first sets have few start bytes so bytes are skipped at the
+	// initial state, the last ones start with almost any byte
+	srand(1);
+	const int numOfPatternsPerSet[] = { 1, 5, 20, 300, 2000 };
+	for (int setIndex = 0; setIndex < 5; setIndex++)
+	{
+		std::vector<PatternMatcherTestPattern> patterns;
+		matcher.clear();
+		for (int i = 0; i < numOfPatternsPerSet[setIndex]; i++)
+		{
+			PatternMatcherTestPattern pattern;
+			size_t length = 1 + rand() % 8;
+			for (size_t j = 0; j < length; j++)
+				pattern.bytes += (char)(rand() % 3 == 0 ? 'a' + rand() % 26 : rand());
+			pattern.id = (uint32_t)(rand() % 1000);
+			pattern.caseInsensitive = (rand() % 3 == 0);
+			patterns.push_back(pattern);
+			PTF_ASSERT_TRUE(matcher.addPattern(pattern.bytes, pattern.id, pattern.caseInsensitive));
+		}
+
+		PTF_ASSERT_TRUE(matcher.compile());
+		PTF_ASSERT_TRUE(matcher.getMemoryUsage() > 0);
+
+		std::vector<uint8_t> data;
+		generatePatternMatcherData(patterns, 5000, data);
+		std::vector<pcpp::PatternMatch> expected = bruteForceSearch(patterns, data);
+		matches.clear();
+		PTF_ASSERT_EQUAL(matcher.search(&data[0], data.size(), matches), expected.size(), size);
+		std::sort(matches.begin(), matches.end(), patternMatchLess);
+		PTF_ASSERT_TRUE(std::equal(matches.begin(), matches.end(), expected.begin(), patternMatchEqual));
+		PTF_ASSERT_TRUE(matcher.containsAny(&data[0], data.size()) == !expected.empty());
+	}
+
+	// search the payload of a packet
+	timeval time;
+	gettimeofday(&time, NULL);
+	READ_FILE_AND_CREATE_PACKET(1, "PacketExamples/TwoHttpRequests1.dat");
+	pcpp::Packet httpPacket(&rawPacket1);
+	matcher.clear();
+	PTF_ASSERT_TRUE(matcher.addPattern("HOST: ", 1, true));
+	PTF_ASSERT_TRUE(matcher.addPattern("GET /", 2));
+	PTF_ASSERT_TRUE(matcher.compile());
+	PTF_ASSERT_EQUAL(matcher.search(httpPacket, NULL), 2, size);
+} // PatternMatcherSearchTest
+
+
+
+PTF_TEST_CASE(PatternMatcherStreamTest)
+{
+	srand(2);
+
+	std::vector<PatternMatcherTestPattern> patterns;
+	pcpp::PatternMatcher matcher;
+	for (int i = 0; i < 50; i++)
+	{
+		PatternMatcherTestPattern pattern;
+		size_t length = 2 + rand() % 12;
+		for (size_t j = 0; j < length; j++)
+			pattern.bytes += (char)('a' + rand() % 26);
+		pattern.id = (uint32_t)i;
+		pattern.caseInsensitive = (i % 2 == 0);
+		patterns.push_back(pattern);
+		PTF_ASSERT_TRUE(matcher.addPattern(pattern.bytes, pattern.id, pattern.caseInsensitive));
+	}
+	PTF_ASSERT_TRUE(matcher.compile());
+
+	std::vector<uint8_t> data;
+	generatePatternMatcherData(patterns, 20000, data);
+	std::vector<pcpp::PatternMatch> expected = bruteForceSearch(patterns, data);
+	PTF_ASSERT_TRUE(expected.size() > 500);
+
+	// search the data in random chunks, including empty ones and chunks shorter than the patterns
+	pcpp::PatternMatchStream stream;
+	std::vector<pcpp::PatternMatch> matches;
+	size_t offset = 0, numOfMatches = 0;
+	while (offset < data.size())
+	{
+		size_t chunkLen = std::min((size_t)(rand() % 40), data.size() - offset);
+		numOfMatches += matcher.searchStream(stream, &data[offset], chunkLen, collectStreamMatch, &matches);
+		offset += chunkLen;
+		PTF_ASSERT_EQUAL(stream.getOffset(), offset, u64);
+	}
+	PTF_ASSERT_EQUAL(numOfMatches, expected.size(), size);
+	std::sort(matches.begin(), matches.end(), patternMatchLess);
+	PTF_ASSERT_TRUE(std::equal(matches.begin(), matches.end(), expected.begin(), patternMatchEqual));
+
+	// a pattern doesn't match across skipped bytes and offsets continue after them
+	pcpp::PatternMatcher httpMatcher;
+	PTF_ASSERT_TRUE(httpMatcher.addPattern("Content-Length", 1));
+	PTF_ASSERT_TRUE(httpMatcher.compile());
+	const uint8_t part1[] = "xxContent-";
+	const uint8_t part2[] = "Length: 10\r\nContent-Length";
+	stream.reset();
+	matches.clear();
+	PTF_ASSERT_EQUAL(httpMatcher.searchStream(stream, part1, 10, collectStreamMatch, &matches), 0, size);
+	stream.skip(5);
+	PTF_ASSERT_EQUAL(httpMatcher.searchStream(stream, part2, 26, collectStreamMatch, &matches), 1, size);
+	PTF_ASSERT_EQUAL(matches[0].startOffset, 27, u64);
+	PTF_ASSERT_EQUAL(matches[0].endOffset, 41, u64);
+
+	// interleaved flows and sides
+	std::vector<FlowMatchRecord> flowMatches;
+	pcpp::PatternFlowMatcher flowMatcher(httpMatcher, collectFlowMatch, &flowMatches);
+	PTF_ASSERT_EQUAL(flowMatcher.scan(1, 0, part1, 10), 0, size);
+	PTF_ASSERT_EQUAL(flowMatcher.scan(2, 0, part1, 10), 0, size);
+	PTF_ASSERT_EQUAL(flowMatcher.scan(1, 1, part2, 26), 1, size);
+	PTF_ASSERT_EQUAL(flowMatcher.getNumOfFlows(), 2, size);
+	PTF_ASSERT_EQUAL(flowMatcher.scan(1, 0, part2, 26), 2, size);
+	PTF_ASSERT_EQUAL(flowMatches.size(), 3, size);
+	PTF_ASSERT_EQUAL(flowMatches[0].flowKey, 1, u32);
+	PTF_ASSERT_EQUAL(flowMatches[0].side, 1, int);
+	PTF_ASSERT_EQUAL(flowMatches[0].match.startOffset, 12, u64);
+	PTF_ASSERT_EQUAL(flowMatches[1].side, 0, int);
+	PTF_ASSERT_EQUAL(flowMatches[1].match.startOffset, 2, u64);
+	PTF_ASSERT_EQUAL(flowMatches[2].match.startOffset, 22, u64);
+	pcpp::LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_EQUAL(flowMatcher.scan(1, 2, part2, 26), 0, size);
+	pcpp::LoggerPP::getInstance().enableErrors();
+
+	// TcpReassembly message chunks, bytes missing before the second one
+	pcpp::ConnectionData connData;
+	connData.flowKey = 2;
+	flowMatches.clear();
+	PTF_ASSERT_EQUAL(flowMatcher.scan(0, pcpp::TcpStreamData(part2, 26, 3, connData)), 1, size);
+	PTF_ASSERT_EQUAL(flowMatches[0].flowKey, 2, u32);
+	PTF_ASSERT_EQUAL(flowMatches[0].match.startOffset, 10 + 3 + 12, u64);
+
+	flowMatcher.closeFlow(1);
+	PTF_ASSERT_EQUAL(flowMatcher.getNumOfFlows(), 1, size);
+	flowMatcher.clear();
+	PTF_ASSERT_EQUAL(flowMatcher.getNumOfFlows(), 0, size);
+} // PatternMatcherStreamTest
@@ -132,6 +132,7 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(PacketUtilsHash5TupleUdp, "udp");
 	PTF_RUN_TEST(PacketUtilsHash5TupleTcp, "tcp");
 	PTF_RUN_TEST(PacketUtilsHash5TupleIPv6, "ipv6");
+	PTF_RUN_TEST(PacketUtilsChecksum, "checksum");
 
 	PTF_RUN_TEST(InsertDataToPacket, "packet;insert");
 	PTF_RUN_TEST(InsertVlanToPacket, "packet;vlan;insert");
@@ -142,6 +143,8 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(ParsePartialPacketTest, "packet;partial_packet");
 	PTF_RUN_TEST(PacketTrailerTest, "packet;packet_trailer");
 	PTF_RUN_TEST(ResizeLayerTest, "packet;resize");
+	PTF_RUN_TEST(LayerArenaTest, "packet;layer_arena");
+	PTF_RUN_TEST(LazyParsingTest, "packet;lazy_parsing");
 
 	PTF_RUN_TEST(HttpRequestLayerParsingTest, "http");
 	PTF_RUN_TEST(HttpRequestLayerCreationTest, "http");
@@ -149,6 +152,7 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(HttpResponseLayerParsingTest, "http");
 	PTF_RUN_TEST(HttpResponseLayerCreationTest, "http");
 	PTF_RUN_TEST(HttpResponseLayerEditTest, "http");
+	PTF_RUN_TEST(HttpHeaderFieldLookupTest, "http");
 
 	PTF_RUN_TEST(PPPoESessionLayerParsingTest, "pppoe");
 	PTF_RUN_TEST(PPPoESessionLayerCreationTest, "pppoe");
@@ -221,5 +225,8 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(SSHParsingTest, "ssh");
 	PTF_RUN_TEST(SSHMalformedParsingTest, "ssh");
 
+	PTF_RUN_TEST(PatternMatcherSearchTest, "pattern_matcher");
+	PTF_RUN_TEST(PatternMatcherStreamTest, "pattern_matcher");
+
 	PTF_END_RUNNING_TESTS;
 }
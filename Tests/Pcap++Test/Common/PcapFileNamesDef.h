@@ -1,5 +1,8 @@
 
 #define EXAMPLE_PCAP_WRITE_PATH "PcapExamples/example_copy.pcap"
+#define EXAMPLE_PCAP_ASYNC_WRITE_PATH "PcapExamples/example_async_copy.pcap"
+#define EXAMPLE_PCAP_ROTATING_WRITE_PATH "PcapExamples/rotating_copy.pcap"
+#define EXAMPLE_PCAP_INDEX_WRITE_PATH "PcapExamples/index_copy.pcap"
 #define EXAMPLE_PCAP_PATH "PcapExamples/example.pcap"
 #define EXAMPLE2_PCAP_PATH "PcapExamples/example2.pcap"
 #define EXAMPLE_PCAP_HTTP_REQUEST "PcapExamples/4KHttpRequests.pcap"
@@ -18,6 +21,9 @@
 #define EXAMPLE2_PCAPNG_WRITE_PATH "PcapExamples/pcapng-example-write.pcapng"
 #define EXAMPLE_PCAPNG_ZSTD_WRITE_PATH "PcapExamples/many_interfaces_copy.pcapng.zstd"
 #define EXAMPLE2_PCAPNG_ZSTD_WRITE_PATH "PcapExamples/pcapng-example-write.pcapng.zstd"
+#define EXAMPLE_PCAPNG_LARGE_WRITE_PATH "PcapExamples/example_copy.pcapng"
+#define EXAMPLE_PCAPNG_ZSTD_LARGE_WRITE_PATH "PcapExamples/example_copy.pcapng.zstd"
+#define EXAMPLE_PCAPNG_ZSTD_STREAM_WRITE_PATH "PcapExamples/example_stream_copy.pcapng.zstd"
 #define EXAMPLE_PCAP_GRE "PcapExamples/GrePackets.cap"
 #define EXAMPLE_PCAP_IGMP "PcapExamples/IgmpPackets.pcap"
 #define EXAMPLE_LINKTYPE_IPV6 "PcapExamples/linktype_ipv6.pcap"
@@ -6,6 +6,7 @@
 PTF_TEST_CASE(TestIPAddress);
 PTF_TEST_CASE(TestMacAddress);
 PTF_TEST_CASE(TestLRUList);
+PTF_TEST_CASE(TestLockFreeRing);
 PTF_TEST_CASE(TestGeneralUtils);
 PTF_TEST_CASE(TestGetMacAddress);
 
@@ -16,8 +17,15 @@ PTF_TEST_CASE(TestPcapRawIPFileReadWrite);
 PTF_TEST_CASE(TestPcapFileAppend);
 PTF_TEST_CASE(TestPcapNgFileReadWrite);
 PTF_TEST_CASE(TestPcapNgFileReadWriteAdv);
+PTF_TEST_CASE(TestPcapNgFileReadWriteZstdLarge);
 PTF_TEST_CASE(TestPcapFileReadLinkTypeIPv6);
 PTF_TEST_CASE(TestPcapFileReadLinkTypeIPv4);
+PTF_TEST_CASE(TestPcapFileReadZeroCopy);
+PTF_TEST_CASE(TestMmapPcapFileRead);
+PTF_TEST_CASE(TestAsyncPcapFileWrite);
+PTF_TEST_CASE(TestRotatingFileWriter);
+PTF_TEST_CASE(TestPcapFileIndex);
+PTF_TEST_CASE(TestParallelFileProcessor);
 
 // Implemented in LiveDeviceTests.cpp
 PTF_TEST_CASE(TestPcapLiveDeviceList);
@@ -27,6 +35,9 @@ PTF_TEST_CASE(TestPcapLiveDeviceNoNetworking);
 PTF_TEST_CASE(TestPcapLiveDeviceStatsMode);
 PTF_TEST_CASE(TestPcapLiveDeviceBlockingMode);
 PTF_TEST_CASE(TestPcapLiveDeviceSpecialCfg);
+PTF_TEST_CASE(TestPcapLiveDeviceBurstMode);
+PTF_TEST_CASE(TestPcapLiveDeviceMultiThread);
+PTF_TEST_CASE(TestPcapLiveDeviceMultiThreadWithFilter);
 PTF_TEST_CASE(TestWinPcapLiveDevice);
 PTF_TEST_CASE(TestSendPacket);
 PTF_TEST_CASE(TestSendPackets);
@@ -38,6 +49,8 @@ PTF_TEST_CASE(TestPcapFiltersLive);
 PTF_TEST_CASE(TestPcapFilters_General_BPFStr);
 PTF_TEST_CASE(TestPcapFiltersOffline);
 PTF_TEST_CASE(TestPcapFilters_LinkLayer);
+PTF_TEST_CASE(TestThreadedBpfProgram);
+PTF_TEST_CASE(TestPacketClassifier);
 
 // Implemented in PacketParsingTests.cpp
 PTF_TEST_CASE(TestHttpRequestParsing);
@@ -59,6 +72,9 @@ PTF_TEST_CASE(TestTcpReassemblyIPv6_OOO);
 PTF_TEST_CASE(TestTcpReassemblyCleanup);
 PTF_TEST_CASE(TestTcpReassemblyMaxOOOFrags);
 PTF_TEST_CASE(TestTcpReassemblyMaxSeq);
+PTF_TEST_CASE(TestTcpReassemblyEviction);
+PTF_TEST_CASE(TestTcpReassemblyOOOBytes);
+PTF_TEST_CASE(TestTcpReassemblySharded);
 
 // Implemented in IPFragmentationTests.cpp
 PTF_TEST_CASE(TestIPFragmentationSanity);
@@ -67,6 +83,7 @@ PTF_TEST_CASE(TestIPFragPartialData);
 PTF_TEST_CASE(TestIPFragMultipleFrags);
 PTF_TEST_CASE(TestIPFragMapOverflow);
 PTF_TEST_CASE(TestIPFragRemove);
+PTF_TEST_CASE(TestIPFragBufferLimits);
 
 // Implemented in PfRingTests.cpp
 PTF_TEST_CASE(TestPfRingDevice);
@@ -91,3 +108,4 @@ PTF_TEST_CASE(TestKniDeviceSendReceive);
 
 // Implemented in RawSocketTests.cpp
 PTF_TEST_CASE(TestRawSockets);
+PTF_TEST_CASE(TestRawSocketBurstIO);
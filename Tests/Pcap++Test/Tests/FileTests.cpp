@@ -1,8 +1,21 @@
 #include "../TestDefinition.h"
+#include <set>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
 #include "Logger.h"
 #include "Packet.h"
 #include "PcapFileDevice.h"
+#include "ParallelFileProcessor.h"
+#include "RotatingFileWriterDevice.h"
+#include "PcapFileIndex.h"
+#include "PacketUtils.h"
 #include "../Common/PcapFileNamesDef.h"
+#ifdef USE_Z_STD
+#include <zstd.h>
+#endif
 
 
 class FileReaderTeardown
@@ -659,6 +672,134 @@ PTF_TEST_CASE(TestPcapNgFileReadWriteAdv)
 } // TestPcapNgFileReadWriteAdv
 
 
+
+static std::string readFileContent(const char* fileName)
+{
+	std::ifstream file(fileName, std::ios::in | std::ios::binary);
+	std::stringstream content;
+	content << file.rdbuf();
+	return content.str();
+}
+
+#ifdef USE_Z_STD
+// the zstd pcap-ng writer compresses 1MB frames with up to 8 of them in flight (COMPRESSION_FRAME_SIZE and
+// COMPRESSION_NUM_OF_FRAMES in LightPcapNg)
+#define ZSTD_FRAME_SIZE (1024 * 1024)
+#define ZSTD_NUM_OF_FRAMES 8
+
+// returns the number of packets of the pcap-ng file that are equal to the packets of the expected file, or -1 if one of the
+// files has more packets
+static int countEqualPacketsInFiles(const char* fileName, const char* expectedFileName)
+{
+	pcpp::PcapNgFileReaderDevice readerDev(fileName);
+	pcpp::PcapNgFileReaderDevice expectedReaderDev(expectedFileName);
+	if (!readerDev.open() || !expectedReaderDev.open())
+		return -1;
+
+	int packetCount = 0;
+	pcpp::RawPacket rawPacket;
+	pcpp::RawPacket expectedRawPacket;
+	while (true)
+	{
+		bool hasPacket = readerDev.getNextPacket(rawPacket);
+		bool hasExpectedPacket = expectedReaderDev.getNextPacket(expectedRawPacket);
+		if (!hasPacket || !hasExpectedPacket)
+			return (hasPacket == hasExpectedPacket ? packetCount : -1);
+
+		if (rawPacket.getRawDataLen() != expectedRawPacket.getRawDataLen() ||
+				rawPacket.getFrameLength() != expectedRawPacket.getFrameLength() ||
+				rawPacket.getLinkLayerType() != expectedRawPacket.getLinkLayerType() ||
+				rawPacket.getPacketTimeStamp().tv_sec != expectedRawPacket.getPacketTimeStamp().tv_sec ||
+				rawPacket.getPacketTimeStamp().tv_nsec != expectedRawPacket.getPacketTimeStamp().tv_nsec ||
+				memcmp(rawPacket.getRawData(), expectedRawPacket.getRawData(), rawPacket.getRawDataLen()) != 0)
+			return packetCount;
+
+		packetCount++;
+	}
+}
+#endif
+
+PTF_TEST_CASE(TestPcapNgFileReadWriteZstdLarge)
+{
+#ifdef USE_Z_STD
+	pcpp::PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(readerDev.open());
+	pcpp::RawPacketVector packetVec;
+	readerDev.getNextPackets(packetVec);
+	readerDev.close();
+	PTF_ASSERT_EQUAL((int)packetVec.size(), 4631, int);
+
+	// the packets are written several times so the file takes more frames than the writer keeps in flight, which means
+	// frames are reused while the workers finish them out of order
+	const int numOfRounds = 4;
+	pcpp::PcapNgFileWriterDevice writerDev(EXAMPLE_PCAPNG_LARGE_WRITE_PATH);
+	pcpp::PcapNgFileWriterDevice writerCompressDev(EXAMPLE_PCAPNG_ZSTD_LARGE_WRITE_PATH, 5);
+	PTF_ASSERT_TRUE(writerDev.open());
+	PTF_ASSERT_TRUE(writerCompressDev.open());
+	for (int round = 0; round < numOfRounds; round++)
+	{
+		for (pcpp::RawPacketVector::ConstVectorIterator iter = packetVec.begin(); iter != packetVec.end(); iter++)
+		{
+			PTF_ASSERT_TRUE(writerDev.writePacket(**iter));
+			PTF_ASSERT_TRUE(writerCompressDev.writePacket(**iter));
+		}
+	}
+	writerDev.close();
+	writerCompressDev.close();
+
+	std::string content = readFileContent(EXAMPLE_PCAPNG_LARGE_WRITE_PATH);
+	PTF_ASSERT_GREATER_THAN(content.size(), (size_t)(ZSTD_NUM_OF_FRAMES * ZSTD_FRAME_SIZE), size);
+
+	// the compressed file is a sequence of independent frames that declare their size
+	std::string compressedContent = readFileContent(EXAMPLE_PCAPNG_ZSTD_LARGE_WRITE_PATH);
+	size_t numOfFrames = 0;
+	size_t decompressedSize = 0;
+	for (size_t offset = 0; offset < compressedContent.size(); numOfFrames++)
+	{
+		const char* frame = compressedContent.data() + offset;
+		size_t frameSize = ZSTD_findFrameCompressedSize(frame, compressedContent.size() - offset);
+		PTF_ASSERT_FALSE(ZSTD_isError(frameSize));
+		unsigned long long frameContentSize = ZSTD_getFrameContentSize(frame, frameSize);
+		PTF_ASSERT_TRUE(frameContentSize <= ZSTD_FRAME_SIZE);
+		decompressedSize += (size_t)frameContentSize;
+		offset += frameSize;
+	}
+	PTF_ASSERT_GREATER_THAN(numOfFrames, (size_t)ZSTD_NUM_OF_FRAMES, size);
+	PTF_ASSERT_EQUAL(decompressedSize, content.size(), size);
+
+	PTF_ASSERT_EQUAL(countEqualPacketsInFiles(EXAMPLE_PCAPNG_ZSTD_LARGE_WRITE_PATH, EXAMPLE_PCAPNG_LARGE_WRITE_PATH), 4631 * numOfRounds, int);
+
+	// -------
+
+	// files of the streaming compressor don't declare the frame size, so the reader decompresses them as a stream
+	ZSTD_CStream* cstream = ZSTD_createCStream();
+	PTF_ASSERT_NOT_NULL(cstream);
+	PTF_ASSERT_FALSE(ZSTD_isError(ZSTD_initCStream(cstream, 5)));
+	std::string streamContent(ZSTD_compressBound(content.size()) + ZSTD_CStreamOutSize(), '\0');
+	ZSTD_outBuffer output = { &streamContent[0], streamContent.size(), 0 };
+	for (size_t offset = 0; offset < content.size(); )
+	{
+		size_t chunkSize = std::min(ZSTD_CStreamInSize(), content.size() - offset);
+		ZSTD_inBuffer input = { content.data() + offset, chunkSize, 0 };
+		while (input.pos < input.size)
+			PTF_ASSERT_FALSE(ZSTD_isError(ZSTD_compressStream(cstream, &output, &input)));
+		offset += chunkSize;
+	}
+	PTF_ASSERT_EQUAL(ZSTD_endStream(cstream, &output), 0, size);
+	ZSTD_freeCStream(cstream);
+	streamContent.resize(output.pos);
+	PTF_ASSERT_TRUE(ZSTD_getFrameContentSize(streamContent.data(), streamContent.size()) == ZSTD_CONTENTSIZE_UNKNOWN);
+
+	std::ofstream streamFile(EXAMPLE_PCAPNG_ZSTD_STREAM_WRITE_PATH, std::ios::out | std::ios::binary | std::ios::trunc);
+	streamFile.write(streamContent.data(), streamContent.size());
+	streamFile.close();
+	PTF_ASSERT_EQUAL(countEqualPacketsInFiles(EXAMPLE_PCAPNG_ZSTD_STREAM_WRITE_PATH, EXAMPLE_PCAPNG_LARGE_WRITE_PATH), 4631 * numOfRounds, int);
+#else
+	PTF_SKIP_TEST("zstd not configured");
+#endif
+} // TestPcapNgFileReadWriteZstdLarge
+
+
 PTF_TEST_CASE(TestPcapFileReadLinkTypeIPv6)
 {
 	pcpp::PcapFileReaderDevice readerDev(EXAMPLE_LINKTYPE_IPV6);
@@ -745,3 +886,639 @@ PTF_TEST_CASE(TestPcapFileReadLinkTypeIPv4)
 
 } // TestPcapFileReadLinkTypeIPv4
 
+
+
+
+PTF_TEST_CASE(TestPcapFileReadZeroCopy)
+{
+	const char* fileNames[] = { EXAMPLE_PCAP_PATH, EXAMPLE2_PCAPNG_PATH };
+	const int expectedPacketCount[] = { 4631, 159 };
+
+	for (int fileIndex = 0; fileIndex < 2; fileIndex++)
+	{
+		pcpp::IFileReaderDevice* copyReader = pcpp::IFileReaderDevice::getReader(fileNames[fileIndex]);
+		FileReaderTeardown copyReaderTeardown(copyReader);
+		pcpp::IFileReaderDevice* zeroCopyReader = pcpp::IFileReaderDevice::getReader(fileNames[fileIndex]);
+		FileReaderTeardown zeroCopyReaderTeardown(zeroCopyReader);
+
+		PTF_ASSERT_FALSE(zeroCopyReader->isZeroCopyMode());
+		zeroCopyReader->setZeroCopyMode(true);
+		PTF_ASSERT_TRUE(zeroCopyReader->isZeroCopyMode());
+
+		PTF_ASSERT_TRUE(copyReader->open());
+		PTF_ASSERT_TRUE(zeroCopyReader->open());
+
+		pcpp::RawPacket copiedPacket;
+		pcpp::RawPacket lentPacket;
+		int packetCount = 0;
+		while (copyReader->getNextPacket(copiedPacket))
+		{
+			PTF_ASSERT_TRUE(zeroCopyReader->getNextPacket(lentPacket));
+			PTF_ASSERT_TRUE(copiedPacket.isDeleteRawDataAtDestructor());
+			PTF_ASSERT_FALSE(lentPacket.isDeleteRawDataAtDestructor());
+			PTF_ASSERT_EQUAL(lentPacket.getRawDataLen(), copiedPacket.getRawDataLen(), int);
+			PTF_ASSERT_EQUAL(lentPacket.getFrameLength(), copiedPacket.getFrameLength(), int);
+			PTF_ASSERT_EQUAL(lentPacket.getLinkLayerType(), copiedPacket.getLinkLayerType(), enum);
+			PTF_ASSERT_EQUAL(lentPacket.getPacketTimeStamp().tv_sec, copiedPacket.getPacketTimeStamp().tv_sec, u64);
+			PTF_ASSERT_BUF_COMPARE(lentPacket.getRawData(), copiedPacket.getRawData(), copiedPacket.getRawDataLen());
+			packetCount++;
+		}
+
+		PTF_ASSERT_FALSE(zeroCopyReader->getNextPacket(lentPacket));
+		PTF_ASSERT_EQUAL(packetCount, expectedPacketCount[fileIndex], int);
+
+		// a lent packet becomes owned once its buffer needs to grow
+		zeroCopyReader->close();
+		PTF_ASSERT_TRUE(zeroCopyReader->open());
+		PTF_ASSERT_TRUE(zeroCopyReader->getNextPacket(lentPacket));
+		int lentPacketLen = lentPacket.getRawDataLen();
+		PTF_ASSERT_TRUE(lentPacket.reallocateData(lentPacketLen + 10));
+		PTF_ASSERT_TRUE(lentPacket.isDeleteRawDataAtDestructor());
+
+		// reading into a previously lent packet in copy mode makes it owned again
+		pcpp::RawPacket packet;
+		PTF_ASSERT_TRUE(zeroCopyReader->getNextPacket(packet));
+		PTF_ASSERT_FALSE(packet.isDeleteRawDataAtDestructor());
+		zeroCopyReader->setZeroCopyMode(false);
+		PTF_ASSERT_TRUE(zeroCopyReader->getNextPacket(packet));
+		PTF_ASSERT_TRUE(packet.isDeleteRawDataAtDestructor());
+		zeroCopyReader->setZeroCopyMode(true);
+
+		// packets read in bulk must be owned by the vector even in zero-copy mode
+		zeroCopyReader->close();
+		PTF_ASSERT_TRUE(zeroCopyReader->open());
+		pcpp::RawPacketVector packetVec;
+		PTF_ASSERT_EQUAL(zeroCopyReader->getNextPackets(packetVec, 10), 10, int);
+		for (pcpp::RawPacketVector::VectorIterator iter = packetVec.begin(); iter != packetVec.end(); iter++)
+		{
+			PTF_ASSERT_TRUE((*iter)->isDeleteRawDataAtDestructor());
+		}
+
+		copyReader->close();
+		zeroCopyReader->close();
+	}
+} // TestPcapFileReadZeroCopy
+
+
+
+PTF_TEST_CASE(TestMmapPcapFileRead)
+{
+	const char* fileNames[] = { EXAMPLE_PCAP_PATH, SLL_PCAP_PATH, EXAMPLE_PCAPNG_PATH, EXAMPLE2_PCAPNG_PATH };
+	const bool isPcapNg[] = { false, false, true, true };
+	const int numOfFiles = 4;
+	const int burstSize = 32;
+
+	for (int fileIndex = 0; fileIndex < numOfFiles; fileIndex++)
+	{
+		pcpp::IFileReaderDevice* reader = pcpp::IFileReaderDevice::getReader(fileNames[fileIndex]);
+		FileReaderTeardown readerTeardown(reader);
+		pcpp::MmapPcapFileReaderDevice mmapReader(fileNames[fileIndex]);
+		PTF_ASSERT_TRUE(mmapReader.isZeroCopyMode());
+		PTF_ASSERT_TRUE(reader->open());
+		PTF_ASSERT_TRUE(mmapReader.open());
+		PTF_ASSERT_TRUE(mmapReader.isPcapNg() == isPcapNg[fileIndex]);
+
+		pcpp::RawPacket packetsArr[burstSize];
+		pcpp::RawPacket expectedPacket;
+		int packetCount = 0;
+		int numOfPacketsInBurst;
+		while ((numOfPacketsInBurst = mmapReader.getNextPackets(packetsArr, burstSize)) > 0)
+		{
+			for (int i = 0; i < numOfPacketsInBurst; i++)
+			{
+				PTF_ASSERT_TRUE(reader->getNextPacket(expectedPacket));
+				PTF_ASSERT_FALSE(packetsArr[i].isDeleteRawDataAtDestructor());
+				PTF_ASSERT_EQUAL(packetsArr[i].getRawDataLen(), expectedPacket.getRawDataLen(), int);
+				PTF_ASSERT_EQUAL(packetsArr[i].getFrameLength(), expectedPacket.getFrameLength(), int);
+				PTF_ASSERT_EQUAL(packetsArr[i].getLinkLayerType(), expectedPacket.getLinkLayerType(), enum);
+				PTF_ASSERT_EQUAL((uint64_t)packetsArr[i].getPacketTimeStamp().tv_sec, (uint64_t)expectedPacket.getPacketTimeStamp().tv_sec, u64);
+				PTF_ASSERT_BUF_COMPARE(packetsArr[i].getRawData(), expectedPacket.getRawData(), expectedPacket.getRawDataLen());
+				packetCount++;
+			}
+		}
+
+		PTF_ASSERT_FALSE(reader->getNextPacket(expectedPacket));
+
+		pcpp::IPcapDevice::PcapStats readerStatistics;
+		mmapReader.getStatistics(readerStatistics);
+		PTF_ASSERT_EQUAL((int)readerStatistics.packetsRecv, packetCount, int);
+
+		mmapReader.close();
+		PTF_ASSERT_FALSE(mmapReader.isOpened());
+		reader->close();
+	}
+
+	// the file format is detected by its content and not by its extension, and non-capture files are rejected
+	pcpp::MmapPcapFileReaderDevice pcapNgReader(EXAMPLE2_PCAPNG_PATH);
+	PTF_ASSERT_TRUE(pcapNgReader.open());
+	pcpp::RawPacket rawPacket;
+	PTF_ASSERT_TRUE(pcapNgReader.getNextPacket(rawPacket));
+	PTF_ASSERT_TRUE(rawPacket.getRawDataLen() > 0);
+
+	pcpp::LoggerPP::getInstance().supressErrors();
+	pcpp::MmapPcapFileReaderDevice invalidReader("PcapExamples/example2_summary.txt");
+	PTF_ASSERT_FALSE(invalidReader.open());
+	pcpp::MmapPcapFileReaderDevice nonExistingReader("PcapExamples/no_such_file.pcap");
+	PTF_ASSERT_FALSE(nonExistingReader.open());
+	PTF_ASSERT_FALSE(nonExistingReader.getNextPacket(rawPacket));
+	PTF_ASSERT_EQUAL(nonExistingReader.getNextPackets(&rawPacket, 1), 0, int);
+	pcpp::LoggerPP::getInstance().enableErrors();
+
+	// in copy mode packets are owned by the RawPacket
+	pcpp::MmapPcapFileReaderDevice copyReader(EXAMPLE_PCAP_PATH);
+	copyReader.setZeroCopyMode(false);
+	PTF_ASSERT_TRUE(copyReader.open());
+	pcpp::RawPacketVector packetVec;
+	PTF_ASSERT_EQUAL(copyReader.getNextPackets(packetVec), 4631, int);
+	PTF_ASSERT_TRUE(copyReader.getNextPackets(packetVec, 10) == 0);
+	copyReader.close();
+} // TestMmapPcapFileRead
+
+
+
+PTF_TEST_CASE(TestAsyncPcapFileWrite)
+{
+	pcpp::PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(readerDev.open());
+	pcpp::RawPacketVector packetVec;
+	readerDev.getNextPackets(packetVec);
+	readerDev.close();
+	PTF_ASSERT_EQUAL((int)packetVec.size(), 4631, int);
+
+	pcpp::PcapFileWriterDevice syncWriter(EXAMPLE_PCAP_WRITE_PATH);
+	PTF_ASSERT_TRUE(syncWriter.open());
+	PTF_ASSERT_TRUE(syncWriter.writePackets(packetVec));
+	syncWriter.close();
+	std::string expectedContent = readFileContent(EXAMPLE_PCAP_WRITE_PATH);
+
+	// small buffers so packets span buffers and the caller waits for the I/O thread, with and without O_DIRECT
+	for (int directIO = 0; directIO < 2; directIO++)
+	{
+		pcpp::AsyncPcapFileWriterDevice::AsyncWriterConfig config;
+		config.bufferSize = 1;
+		config.numOfBuffers = 2;
+		config.directIO = (directIO == 1);
+
+		pcpp::AsyncPcapFileWriterDevice asyncWriter(EXAMPLE_PCAP_ASYNC_WRITE_PATH, pcpp::LINKTYPE_ETHERNET, config);
+		PTF_ASSERT_TRUE(asyncWriter.open());
+		int packetCount = 0;
+		for (pcpp::RawPacketVector::ConstVectorIterator iter = packetVec.begin(); iter != packetVec.end(); iter++)
+		{
+			PTF_ASSERT_TRUE(asyncWriter.writePacket(**iter));
+			// flush in the middle so the partial block is written twice with O_DIRECT
+			if (++packetCount == 1000)
+				asyncWriter.flush();
+		}
+		asyncWriter.close();
+		PTF_ASSERT_FALSE(asyncWriter.isOpened());
+
+		pcpp::IPcapDevice::PcapStats writerStatistics;
+		asyncWriter.getStatistics(writerStatistics);
+		PTF_ASSERT_EQUAL((int)writerStatistics.packetsRecv, 4631, int);
+		PTF_ASSERT_EQUAL((int)writerStatistics.packetsDrop, 0, int);
+		PTF_ASSERT_EQUAL((int)asyncWriter.getNumOfPacketsDropped(), 0, int);
+		PTF_ASSERT_TRUE(readFileContent(EXAMPLE_PCAP_ASYNC_WRITE_PATH) == expectedContent);
+	}
+
+	// appending with batched writes gives the same file as appending with the sync writer
+	PTF_ASSERT_TRUE(syncWriter.open(true));
+	PTF_ASSERT_TRUE(syncWriter.writePackets(packetVec));
+	syncWriter.close();
+
+	pcpp::AsyncPcapFileWriterDevice appendWriter(EXAMPLE_PCAP_ASYNC_WRITE_PATH);
+	PTF_ASSERT_TRUE(appendWriter.open(true));
+	PTF_ASSERT_TRUE(appendWriter.writePackets(packetVec));
+	appendWriter.close();
+	PTF_ASSERT_TRUE(readFileContent(EXAMPLE_PCAP_ASYNC_WRITE_PATH) == readFileContent(EXAMPLE_PCAP_WRITE_PATH));
+
+	pcpp::LoggerPP::getInstance().supressErrors();
+	pcpp::AsyncPcapFileWriterDevice sllWriter(EXAMPLE_PCAP_ASYNC_WRITE_PATH, pcpp::LINKTYPE_LINUX_SLL);
+	PTF_ASSERT_FALSE(sllWriter.open(true));
+	PTF_ASSERT_FALSE(sllWriter.writePacket(*packetVec.front()));
+	pcpp::AsyncPcapFileWriterDevice nonExistingWriter("PcapExamples/no_such_dir/file.pcap");
+	PTF_ASSERT_FALSE(nonExistingWriter.open());
+	pcpp::LoggerPP::getInstance().enableErrors();
+} // TestAsyncPcapFileWrite
+
+
+
+static int countPacketsInFile(const std::string& fileName, time_t& firstTimestamp, time_t& lastTimestamp)
+{
+	pcpp::IFileReaderDevice* reader = pcpp::IFileReaderDevice::getReader(fileName.c_str());
+	FileReaderTeardown readerTeardown(reader);
+	if (!reader->open())
+		return -1;
+
+	int packetCount = 0;
+	pcpp::RawPacket rawPacket;
+	while (reader->getNextPacket(rawPacket))
+	{
+		if (packetCount == 0)
+			firstTimestamp = rawPacket.getPacketTimeStamp().tv_sec;
+		lastTimestamp = rawPacket.getPacketTimeStamp().tv_sec;
+		packetCount++;
+	}
+
+	return packetCount;
+}
+
+PTF_TEST_CASE(TestRotatingFileWriter)
+{
+	pcpp::PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(readerDev.open());
+	pcpp::RawPacketVector packetVec;
+	readerDev.getNextPackets(packetVec);
+	readerDev.close();
+
+	time_t firstTimestamp, lastTimestamp;
+
+	// start without files of previous runs of the test, the writers continue their numbering
+	for (int i = 0; i < 100; i++)
+	{
+		std::stringstream fileName;
+		fileName << "PcapExamples/rotating_copy-" << std::setw(4) << std::setfill('0') << i;
+		remove((fileName.str() + ".pcap").c_str());
+		remove((fileName.str() + ".pcapng").c_str());
+	}
+
+	// rotate by packet count and keep the last 3 files
+	pcpp::RotatingFileWriterDevice::RotationConfig config;
+	config.maxPacketsPerFile = 1000;
+	config.maxNumOfFiles = 3;
+	pcpp::RotatingFileWriterDevice countWriter(EXAMPLE_PCAP_ROTATING_WRITE_PATH, pcpp::LINKTYPE_ETHERNET, config);
+	PTF_ASSERT_TRUE(countWriter.open());
+	PTF_ASSERT_EQUAL(countWriter.getCurrentFileName(), std::string("PcapExamples/rotating_copy-0000.pcap"), string);
+	PTF_ASSERT_TRUE(countWriter.writePackets(packetVec));
+	PTF_ASSERT_EQUAL(countWriter.getCurrentFileName(), std::string("PcapExamples/rotating_copy-0004.pcap"), string);
+	countWriter.close();
+	PTF_ASSERT_EQUAL((int)countWriter.getNumOfRotations(), 4, int);
+
+	pcpp::IPcapDevice::PcapStats writerStatistics;
+	countWriter.getStatistics(writerStatistics);
+	PTF_ASSERT_EQUAL((int)writerStatistics.packetsRecv, 4631, int);
+
+	const int expectedPacketCounts[] = { -1, -1, 1000, 1000, 631, -1 };
+	pcpp::LoggerPP::getInstance().supressErrors();
+	for (int i = 0; i < 6; i++)
+	{
+		std::stringstream fileName;
+		fileName << "PcapExamples/rotating_copy-000" << i << ".pcap";
+		PTF_ASSERT_EQUAL(countPacketsInFile(fileName.str(), firstTimestamp, lastTimestamp), expectedPacketCounts[i], int);
+	}
+	pcpp::LoggerPP::getInstance().enableErrors();
+
+	// a restarted writer continues after the files of the previous run and deletes them first
+	pcpp::RotatingFileWriterDevice restartedWriter(EXAMPLE_PCAP_ROTATING_WRITE_PATH, pcpp::LINKTYPE_ETHERNET, config);
+	PTF_ASSERT_TRUE(restartedWriter.open());
+	PTF_ASSERT_EQUAL(restartedWriter.getCurrentFileName(), std::string("PcapExamples/rotating_copy-0005.pcap"), string);
+	PTF_ASSERT_TRUE(restartedWriter.writePackets(packetVec));
+	restartedWriter.close();
+
+	const int expectedRestartPacketCounts[] = { -1, -1, -1, -1, -1, -1, -1, 1000, 1000, 631, -1 };
+	pcpp::LoggerPP::getInstance().supressErrors();
+	for (int i = 0; i < 11; i++)
+	{
+		std::stringstream fileName;
+		fileName << "PcapExamples/rotating_copy-" << std::setw(4) << std::setfill('0') << i << ".pcap";
+		PTF_ASSERT_EQUAL(countPacketsInFile(fileName.str(), firstTimestamp, lastTimestamp), expectedRestartPacketCounts[i], int);
+	}
+	pcpp::LoggerPP::getInstance().enableErrors();
+
+	// rotate pcap-ng files by duration and pcap files by size
+	config = pcpp::RotatingFileWriterDevice::RotationConfig();
+	config.maxFileDuration = 5;
+	config.isPcapNg = true;
+	pcpp::RotatingFileWriterDevice durationWriter("PcapExamples/rotating_copy.pcapng", pcpp::LINKTYPE_ETHERNET, config);
+	PTF_ASSERT_TRUE(durationWriter.open());
+	PTF_ASSERT_TRUE(durationWriter.writePackets(packetVec));
+	durationWriter.close();
+	PTF_ASSERT_TRUE(durationWriter.getNumOfRotations() > 0);
+
+	config = pcpp::RotatingFileWriterDevice::RotationConfig();
+	config.maxFileSize = 200000;
+	pcpp::RotatingFileWriterDevice sizeWriter(EXAMPLE_PCAP_ROTATING_WRITE_PATH, pcpp::LINKTYPE_ETHERNET, config);
+	PTF_ASSERT_TRUE(sizeWriter.open());
+	PTF_ASSERT_EQUAL(sizeWriter.getCurrentFileName(), std::string("PcapExamples/rotating_copy-0010.pcap"), string);
+	PTF_ASSERT_TRUE(sizeWriter.writePackets(packetVec));
+	sizeWriter.close();
+	PTF_ASSERT_TRUE(sizeWriter.getNumOfRotations() > 0);
+
+	int durationPacketCount = 0, sizePacketCount = 0;
+	for (int i = 0; i <= (int)durationWriter.getNumOfRotations(); i++)
+	{
+		std::stringstream fileName;
+		fileName << "PcapExamples/rotating_copy-" << std::setw(4) << std::setfill('0') << i << ".pcapng";
+		int packetCount = countPacketsInFile(fileName.str(), firstTimestamp, lastTimestamp);
+		PTF_ASSERT_TRUE(packetCount > 0);
+		PTF_ASSERT_TRUE(lastTimestamp - firstTimestamp < 5);
+		durationPacketCount += packetCount;
+	}
+
+	for (int i = 10; i <= 10 + (int)sizeWriter.getNumOfRotations(); i++)
+	{
+		std::stringstream fileName;
+		fileName << "PcapExamples/rotating_copy-" << std::setw(4) << std::setfill('0') << i << ".pcap";
+		std::ifstream file(fileName.str().c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+		PTF_ASSERT_TRUE((int)file.tellg() <= 200000);
+		sizePacketCount += countPacketsInFile(fileName.str(), firstTimestamp, lastTimestamp);
+	}
+
+	PTF_ASSERT_EQUAL(durationPacketCount, 4631, int);
+	PTF_ASSERT_EQUAL(sizePacketCount, 4631, int);
+
+	pcpp::LoggerPP::getInstance().supressErrors();
+	pcpp::RotatingFileWriterDevice invalidWriter("PcapExamples/no_such_dir/file.pcap");
+	PTF_ASSERT_FALSE(invalidWriter.open());
+	PTF_ASSERT_FALSE(invalidWriter.writePacket(*packetVec.front()));
+	PTF_ASSERT_FALSE(sizeWriter.open(true));
+	pcpp::LoggerPP::getInstance().enableErrors();
+} // TestRotatingFileWriter
+
+
+
+static bool countFlowPacket(pcpp::RawPacket& rawPacket, void* userCookie)
+{
+	std::vector<int>* packetLengths = (std::vector<int>*)userCookie;
+	packetLengths->push_back(rawPacket.getRawDataLen());
+	return false;
+}
+
+static bool isEarlier(const timespec& first, const timespec& second)
+{
+	return first.tv_sec < second.tv_sec || (first.tv_sec == second.tv_sec && first.tv_nsec < second.tv_nsec);
+}
+
+PTF_TEST_CASE(TestPcapFileIndex)
+{
+	const char* fileNames[] = { EXAMPLE_PCAP_PATH, EXAMPLE_PCAPNG_PATH, EXAMPLE2_PCAPNG_PATH };
+	const int numOfFiles = 3;
+
+	pcpp::PcapFileIndex::IndexConfig config;
+	config.packetInterval = 10;
+	config.indexFlows = true;
+
+	for (int fileIndex = 0; fileIndex < numOfFiles; fileIndex++)
+	{
+		pcpp::MmapPcapFileReaderDevice sequentialReader(fileNames[fileIndex]);
+		sequentialReader.setZeroCopyMode(false);
+		PTF_ASSERT_TRUE(sequentialReader.open());
+		pcpp::RawPacketVector packets;
+		sequentialReader.getNextPackets(packets);
+		sequentialReader.close();
+
+		std::map<uint32_t, std::vector<int> > flows;
+		for (pcpp::RawPacketVector::VectorIterator iter = packets.begin(); iter != packets.end(); iter++)
+		{
+			pcpp::Packet packet(*iter, pcpp::OsiModelTransportLayer);
+			flows[pcpp::hash5Tuple(&packet)].push_back((*iter)->getRawDataLen());
+		}
+
+		pcpp::PcapFileIndex index(config);
+		PTF_ASSERT_TRUE(index.build(fileNames[fileIndex]));
+		PTF_ASSERT_EQUAL((int)index.getNumOfPackets(), (int)packets.size(), int);
+		PTF_ASSERT_EQUAL(index.getNumOfFlows(), flows.size(), size);
+		PTF_ASSERT_TRUE(index.getEntries().size() >= (packets.size() + 9) / 10);
+
+		pcpp::MmapPcapFileReaderDevice reader(fileNames[fileIndex]);
+		pcpp::RawPacket rawPacket;
+		PTF_ASSERT_TRUE(reader.open());
+		pcpp::LoggerPP::getInstance().supressErrors();
+		PTF_ASSERT_FALSE(reader.seekToPacket(0));
+		pcpp::LoggerPP::getInstance().enableErrors();
+		reader.setIndex(&index);
+
+		// seek to packets around the indexed ones, going backwards as well
+		const int packetNumbers[] = { 5, 0, 1, 9, 10, 11, (int)packets.size() - 1, 2 };
+		for (int i = 0; i < 8; i++)
+		{
+			int packetNumber = packetNumbers[i];
+			PTF_ASSERT_TRUE(reader.seekToPacket(packetNumber));
+			PTF_ASSERT_TRUE(reader.getNextPacket(rawPacket));
+			PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), packets.at(packetNumber)->getRawDataLen(), int);
+			PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), packets.at(packetNumber)->getRawData(), rawPacket.getRawDataLen());
+			PTF_ASSERT_EQUAL(rawPacket.getLinkLayerType(), packets.at(packetNumber)->getLinkLayerType(), enum);
+		}
+		PTF_ASSERT_FALSE(reader.seekToPacket(packets.size()));
+
+		// seeking by time finds the first packet in the file that isn't earlier than the timestamp
+		const int timePacketNumbers[] = { 0, 10, (int)packets.size() / 2, (int)packets.size() - 1 };
+		for (int i = 0; i < 4; i++)
+		{
+			timespec timestamp = packets.at(timePacketNumbers[i])->getPacketTimeStamp();
+			int expectedPacketNumber = 0;
+			while (isEarlier(packets.at(expectedPacketNumber)->getPacketTimeStamp(), timestamp))
+				expectedPacketNumber++;
+
+			PTF_ASSERT_TRUE(reader.seekToTime(timestamp));
+			PTF_ASSERT_TRUE(reader.getNextPacket(rawPacket));
+			PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), packets.at(expectedPacketNumber)->getRawDataLen(), int);
+			PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), packets.at(expectedPacketNumber)->getRawData(), rawPacket.getRawDataLen());
+		}
+
+		timespec lateTimestamp = packets.front()->getPacketTimeStamp();
+		for (pcpp::RawPacketVector::VectorIterator iter = packets.begin(); iter != packets.end(); iter++)
+		{
+			if (isEarlier(lateTimestamp, (*iter)->getPacketTimeStamp()))
+				lateTimestamp = (*iter)->getPacketTimeStamp();
+		}
+		lateTimestamp.tv_sec += 1;
+		PTF_ASSERT_FALSE(reader.seekToTime(lateTimestamp));
+
+		// reading the packets of a flow doesn't move the read position
+		PTF_ASSERT_TRUE(reader.seekToPacket(1));
+		int numOfFlowsChecked = 0;
+		for (std::map<uint32_t, std::vector<int> >::iterator iter = flows.begin(); iter != flows.end() && numOfFlowsChecked < 20; iter++, numOfFlowsChecked++)
+		{
+			std::vector<int> packetLengths;
+			PTF_ASSERT_TRUE(reader.forEachPacketOfFlow(iter->first, countFlowPacket, &packetLengths));
+			PTF_ASSERT_TRUE(packetLengths == iter->second);
+		}
+		PTF_ASSERT_TRUE(reader.getNextPacket(rawPacket));
+		PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), packets.at(1)->getRawData(), rawPacket.getRawDataLen());
+
+		// a saved index works the same as the one it was saved from
+		std::string indexFileName = pcpp::PcapFileIndex::getIndexFileName(EXAMPLE_PCAP_INDEX_WRITE_PATH);
+		PTF_ASSERT_TRUE(index.save(indexFileName));
+		pcpp::PcapFileIndex loadedIndex;
+		PTF_ASSERT_TRUE(loadedIndex.load(indexFileName));
+		PTF_ASSERT_EQUAL(loadedIndex.getNumOfPackets(), index.getNumOfPackets(), u64);
+		PTF_ASSERT_EQUAL(loadedIndex.getNumOfFlows(), index.getNumOfFlows(), size);
+		PTF_ASSERT_EQUAL(loadedIndex.getConfig().packetInterval, (uint32_t)10, u32);
+		reader.setIndex(&loadedIndex);
+		PTF_ASSERT_TRUE(reader.seekToPacket(packets.size() - 1));
+		PTF_ASSERT_TRUE(reader.getNextPacket(rawPacket));
+		PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), packets.at(packets.size() - 1)->getRawData(), rawPacket.getRawDataLen());
+		reader.close();
+	}
+
+	// an index built while writing is the same as an index built from the file, also when it's continued in append mode
+	pcpp::PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(readerDev.open());
+	pcpp::RawPacketVector packetVec;
+	readerDev.getNextPackets(packetVec);
+	readerDev.close();
+
+	pcpp::PcapFileIndex writerIndex(config);
+	pcpp::PcapFileWriterDevice writerDev(EXAMPLE_PCAP_INDEX_WRITE_PATH);
+	writerDev.setIndex(&writerIndex);
+	PTF_ASSERT_TRUE(writerDev.open());
+	pcpp::PcapFileWriterDevice appendWriterDev(EXAMPLE_PCAP_INDEX_WRITE_PATH);
+	appendWriterDev.setIndex(&writerIndex);
+	int packetCount = 0;
+	for (pcpp::RawPacketVector::VectorIterator iter = packetVec.begin(); iter != packetVec.end(); iter++, packetCount++)
+	{
+		if (packetCount == 2000)
+		{
+			writerDev.close();
+			PTF_ASSERT_TRUE(appendWriterDev.open(true));
+		}
+
+		PTF_ASSERT_TRUE((packetCount < 2000 ? writerDev : appendWriterDev).writePacket(**iter));
+	}
+	appendWriterDev.close();
+
+	pcpp::AsyncPcapFileWriterDevice::AsyncWriterConfig asyncConfig;
+	asyncConfig.bufferSize = 256 * 1024;
+	pcpp::PcapFileIndex asyncWriterIndex(config);
+	pcpp::AsyncPcapFileWriterDevice asyncWriterDev(EXAMPLE_PCAP_ASYNC_WRITE_PATH, pcpp::LINKTYPE_ETHERNET, asyncConfig);
+	asyncWriterDev.setIndex(&asyncWriterIndex);
+	PTF_ASSERT_TRUE(asyncWriterDev.open());
+	PTF_ASSERT_TRUE(asyncWriterDev.writePackets(packetVec));
+	asyncWriterDev.close();
+
+	pcpp::PcapFileIndex fileIndex(config);
+	PTF_ASSERT_TRUE(fileIndex.build(EXAMPLE_PCAP_INDEX_WRITE_PATH));
+	PTF_ASSERT_EQUAL(writerIndex.getNumOfPackets(), fileIndex.getNumOfPackets(), u64);
+	PTF_ASSERT_EQUAL(asyncWriterIndex.getNumOfPackets(), fileIndex.getNumOfPackets(), u64);
+	PTF_ASSERT_EQUAL(writerIndex.getIndexedLength(), fileIndex.getIndexedLength(), u64);
+	PTF_ASSERT_EQUAL(asyncWriterIndex.getIndexedLength(), fileIndex.getIndexedLength(), u64);
+	PTF_ASSERT_EQUAL(writerIndex.getEntries().size(), fileIndex.getEntries().size(), size);
+	PTF_ASSERT_EQUAL(asyncWriterIndex.getEntries().size(), fileIndex.getEntries().size(), size);
+	for (size_t i = 0; i < fileIndex.getEntries().size(); i++)
+	{
+		PTF_ASSERT_EQUAL(writerIndex.getEntries()[i].recordOffset, fileIndex.getEntries()[i].recordOffset, u64);
+		PTF_ASSERT_EQUAL(asyncWriterIndex.getEntries()[i].recordOffset, fileIndex.getEntries()[i].recordOffset, u64);
+		PTF_ASSERT_EQUAL((uint64_t)writerIndex.getEntries()[i].timestamp.tv_nsec, (uint64_t)fileIndex.getEntries()[i].timestamp.tv_nsec, u64);
+	}
+
+	// building an index of a file that grew reads only the new packets
+	pcpp::PcapFileIndex growingIndex(config);
+	pcpp::PcapFileWriterDevice growingWriterDev(EXAMPLE_PCAP_INDEX_WRITE_PATH);
+	PTF_ASSERT_TRUE(growingWriterDev.open());
+	growingWriterDev.writePacket(*packetVec.front());
+	growingWriterDev.close();
+	PTF_ASSERT_TRUE(growingIndex.build(EXAMPLE_PCAP_INDEX_WRITE_PATH));
+	PTF_ASSERT_EQUAL(growingIndex.getNumOfPackets(), (uint64_t)1, u64);
+	PTF_ASSERT_TRUE(growingWriterDev.open(true));
+	growingWriterDev.writePacket(*packetVec.at(packetVec.size() - 1));
+	growingWriterDev.close();
+	PTF_ASSERT_TRUE(growingIndex.build(EXAMPLE_PCAP_INDEX_WRITE_PATH));
+	PTF_ASSERT_EQUAL(growingIndex.getNumOfPackets(), (uint64_t)2, u64);
+
+	pcpp::LoggerPP::getInstance().supressErrors();
+	pcpp::PcapFileIndex invalidIndex;
+	PTF_ASSERT_FALSE(invalidIndex.load(EXAMPLE_PCAP_PATH));
+	PTF_ASSERT_FALSE(invalidIndex.build("PcapExamples/no_such_file.pcap"));
+	PTF_ASSERT_FALSE(fileIndex.build(EXAMPLE_PCAP_INDEX_WRITE_PATH));
+	pcpp::LoggerPP::getInstance().enableErrors();
+} // TestPcapFileIndex
+
+
+
+struct ParallelFileProcessorTestCookie
+{
+	std::vector<uint64_t> packetsPerWorker;
+	std::vector<std::set<uint32_t> > flowsPerWorker;
+	std::vector<uint64_t> bytesPerWorker;
+};
+
+static void parallelFileProcessorPacketsArrive(pcpp::RawPacket* packets, uint32_t numOfPackets, uint16_t workerId, pcpp::ParallelFileProcessor* processor, void* userCookie)
+{
+	ParallelFileProcessorTestCookie* cookie = (ParallelFileProcessorTestCookie*)userCookie;
+	for (uint32_t i = 0; i < numOfPackets; i++)
+	{
+		pcpp::Packet packet(&packets[i], pcpp::OsiModelTransportLayer);
+		cookie->packetsPerWorker[workerId]++;
+		cookie->bytesPerWorker[workerId] += packets[i].getRawDataLen();
+		cookie->flowsPerWorker[workerId].insert(pcpp::hash5Tuple(&packet));
+	}
+}
+
+PTF_TEST_CASE(TestParallelFileProcessor)
+{
+	const char* fileNames[] = { EXAMPLE_PCAP_PATH, EXAMPLE_PCAPNG_PATH, EXAMPLE2_PCAPNG_PATH };
+	const int numOfFiles = 3;
+	const uint16_t numOfWorkers = 4;
+
+	for (int fileIndex = 0; fileIndex < numOfFiles; fileIndex++)
+	{
+		// count the packets and bytes with a regular reader
+		pcpp::IFileReaderDevice* reader = pcpp::IFileReaderDevice::getReader(fileNames[fileIndex]);
+		FileReaderTeardown readerTeardown(reader);
+		PTF_ASSERT_TRUE(reader->open());
+		pcpp::RawPacket rawPacket;
+		uint64_t expectedPacketCount = 0;
+		uint64_t expectedByteCount = 0;
+		while (reader->getNextPacket(rawPacket))
+		{
+			expectedPacketCount++;
+			expectedByteCount += rawPacket.getRawDataLen();
+		}
+		reader->close();
+
+		for (int flowAffinity = 0; flowAffinity <= 1; flowAffinity++)
+		{
+			pcpp::ParallelFileProcessor processor(fileNames[fileIndex], numOfWorkers);
+			PTF_ASSERT_EQUAL(processor.getNumOfWorkers(), numOfWorkers, u16);
+			processor.setChunkSize(16 * 1024);
+			processor.setFlowAffinity(flowAffinity == 1);
+
+			ParallelFileProcessorTestCookie cookie;
+			cookie.packetsPerWorker.resize(numOfWorkers, 0);
+			cookie.bytesPerWorker.resize(numOfWorkers, 0);
+			cookie.flowsPerWorker.resize(numOfWorkers);
+			PTF_ASSERT_TRUE(processor.processFile(parallelFileProcessorPacketsArrive, &cookie));
+
+			uint64_t packetCount = 0;
+			uint64_t byteCount = 0;
+			for (uint16_t i = 0; i < numOfWorkers; i++)
+			{
+				packetCount += cookie.packetsPerWorker[i];
+				byteCount += cookie.bytesPerWorker[i];
+			}
+
+			PTF_ASSERT_EQUAL(packetCount, expectedPacketCount, u64);
+			PTF_ASSERT_EQUAL(byteCount, expectedByteCount, u64);
+			PTF_ASSERT_EQUAL(processor.getNumOfPacketsProcessed(), expectedPacketCount, u64);
+
+			if (flowAffinity == 0)
+				continue;
+
+			// in flow-affinity mode every flow must be handled by exactly one worker
+			for (uint16_t i = 0; i < numOfWorkers; i++)
+			{
+				for (std::set<uint32_t>::const_iterator iter = cookie.flowsPerWorker[i].begin(); iter != cookie.flowsPerWorker[i].end(); iter++)
+				{
+					for (uint16_t j = i + 1; j < numOfWorkers; j++)
+					{
+						PTF_ASSERT_TRUE(cookie.flowsPerWorker[j].find(*iter) == cookie.flowsPerWorker[j].end());
+					}
+				}
+			}
+		}
+	}
+
+	pcpp::ParallelFileProcessor largeChunksProcessor(EXAMPLE_PCAP_PATH, 2);
+	ParallelFileProcessorTestCookie cookie;
+	cookie.packetsPerWorker.resize(2, 0);
+	cookie.bytesPerWorker.resize(2, 0);
+	cookie.flowsPerWorker.resize(2);
+	PTF_ASSERT_TRUE(largeChunksProcessor.processFile(parallelFileProcessorPacketsArrive, &cookie));
+	PTF_ASSERT_EQUAL(largeChunksProcessor.getNumOfChunks(), 1, size);
+
+	pcpp::LoggerPP::getInstance().supressErrors();
+	pcpp::ParallelFileProcessor nonExistingFileProcessor("PcapExamples/no_such_file.pcap", 2);
+	PTF_ASSERT_FALSE(nonExistingFileProcessor.processFile(parallelFileProcessorPacketsArrive, &cookie));
+	PTF_ASSERT_FALSE(largeChunksProcessor.processFile(NULL, NULL));
+	pcpp::LoggerPP::getInstance().enableErrors();
+} // TestParallelFileProcessor
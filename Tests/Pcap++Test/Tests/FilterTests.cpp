@@ -6,8 +6,13 @@
 #include "IPv4Layer.h"
 #include "TcpLayer.h"
 #include "UdpLayer.h"
+#include "IPv6Layer.h"
+#include "PacketClassifier.h"
+#include "Logger.h"
 #include "PcapLiveDeviceList.h"
 #include "PcapFileDevice.h"
+#include "ThreadedBpfProgram.h"
+#include "pcap.h"
 #include "../Common/GlobalTestArgs.h"
 #include "../Common/PcapFileNamesDef.h"
 #include "../Common/TestUtils.h"
@@ -820,3 +825,481 @@ PTF_TEST_CASE(TestPcapFilters_LinkLayer)
 	rawPacketVec.clear();
 } // TestPcapFilters_LinkLayer
 
+
+
+
+// run a hand-assembled BPF program with both libpcap's interpreter and ThreadedBpfProgram on all packets of a file, also with truncated
+// capture lengths, and count the mismatches
+static int compareThreadedBpfProgram(struct bpf_insn* insns, int numOfInsns, const pcpp::RawPacketVector& packets, int& numOfMatches)
+{
+	pcpp::ThreadedBpfProgram threaded;
+	if (!threaded.compile(insns, (uint32_t)numOfInsns))
+		return -1;
+
+	struct bpf_program program;
+	program.bf_len = numOfInsns;
+	program.bf_insns = insns;
+
+	int mismatches = 0;
+	numOfMatches = 0;
+	for (pcpp::RawPacketVector::ConstVectorIterator iter = packets.begin(); iter != packets.end(); iter++)
+	{
+		const uint8_t* data = (*iter)->getRawData();
+		uint32_t len = (uint32_t)(*iter)->getRawDataLen();
+		const uint32_t capLens[] = { len, 0, 1, 13, 14, 21, 24, 34, 35, 40, 54, len > 0 ? len - 1 : 0 };
+		for (size_t i = 0; i < sizeof(capLens) / sizeof(capLens[0]); i++)
+		{
+			uint32_t capLen = std::min(capLens[i], len);
+			struct pcap_pkthdr pktHdr;
+			pktHdr.caplen = capLen;
+			pktHdr.len = len;
+			pktHdr.ts.tv_sec = 0;
+			pktHdr.ts.tv_usec = 0;
+			uint32_t expected = (uint32_t)pcap_offline_filter(&program, &pktHdr, data);
+			if (threaded.run(data, len, capLen) != expected)
+				mismatches++;
+			else if (i == 0 && expected != 0)
+				numOfMatches++;
+		}
+	}
+
+	return mismatches;
+}
+
+PTF_TEST_CASE(TestThreadedBpfProgram)
+{
+	pcpp::RawPacketVector packets;
+	pcpp::PcapFileReaderDevice reader(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(reader.open());
+	PTF_ASSERT_GREATER_THAN(reader.getNextPackets(packets), 0, int);
+	reader.close();
+	pcpp::PcapFileReaderDevice reader2(EXAMPLE_PCAP_VLAN);
+	PTF_ASSERT_TRUE(reader2.open());
+	PTF_ASSERT_GREATER_THAN(reader2.getNextPackets(packets), 0, int);
+	reader2.close();
+	pcpp::PcapFileReaderDevice reader3(EXAMPLE_PCAP_DNS);
+	PTF_ASSERT_TRUE(reader3.open());
+	PTF_ASSERT_GREATER_THAN(reader3.getNextPackets(packets), 0, int);
+	reader3.close();
+
+	int numOfMatches = 0;
+
+	// "tcp port 80" for IPv4, as generated by libpcap
+	struct bpf_insn tcpPort80[] = {
+		BPF_STMT(BPF_LD|BPF_H|BPF_ABS, 12),
+		BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, 0x800, 0, 10),
+		BPF_STMT(BPF_LD|BPF_B|BPF_ABS, 23),
+		BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, 6, 0, 8),
+		BPF_STMT(BPF_LD|BPF_H|BPF_ABS, 20),
+		BPF_JUMP(BPF_JMP|BPF_JSET|BPF_K, 0x1fff, 6, 0),
+		BPF_STMT(BPF_LDX|BPF_MSH|BPF_B, 14),
+		BPF_STMT(BPF_LD|BPF_H|BPF_IND, 14),
+		BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, 80, 2, 0),
+		BPF_STMT(BPF_LD|BPF_H|BPF_IND, 16),
+		BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, 80, 0, 1),
+		BPF_STMT(BPF_RET|BPF_K, 262144),
+		BPF_STMT(BPF_RET|BPF_K, 0),
+	};
+	PTF_ASSERT_EQUAL(compareThreadedBpfProgram(tcpPort80, sizeof(tcpPort80) / sizeof(tcpPort80[0]), packets, numOfMatches), 0, int);
+	PTF_ASSERT_GREATER_THAN(numOfMatches, 0, int);
+
+	// "arp"
+	struct bpf_insn arp[] = {
+		BPF_STMT(BPF_LD|BPF_H|BPF_ABS, 12),
+		BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, 0x806, 0, 1),
+		BPF_STMT(BPF_RET|BPF_K, 262144),
+		BPF_STMT(BPF_RET|BPF_K, 0),
+	};
+	PTF_ASSERT_EQUAL(compareThreadedBpfProgram(arp, sizeof(arp) / sizeof(arp[0]), packets, numOfMatches), 0, int);
+
+	// "(ip or vlan and ip) and udp and len > 100" returning the packet length. Non-VLAN packets jump straight to the compare instruction
+	// of a fused load-and-compare pair
+	struct bpf_insn vlanUdp[] = {
+		BPF_STMT(BPF_LDX|BPF_IMM, 0),
+		BPF_STMT(BPF_LD|BPF_H|BPF_ABS, 12),
+		BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, 0x8100, 0, 2),
+		BPF_STMT(BPF_LDX|BPF_IMM, 4),
+		BPF_STMT(BPF_LD|BPF_H|BPF_ABS, 16),
+		BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, 0x800, 0, 5),
+		BPF_STMT(BPF_LD|BPF_B|BPF_IND, 23),
+		BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, 17, 0, 3),
+		BPF_STMT(BPF_LD|BPF_W|BPF_LEN, 0),
+		BPF_JUMP(BPF_JMP|BPF_JGT|BPF_K, 100, 0, 1),
+		BPF_STMT(BPF_RET|BPF_A, 0),
+		BPF_STMT(BPF_RET|BPF_K, 0),
+	};
+	PTF_ASSERT_EQUAL(compareThreadedBpfProgram(vlanUdp, sizeof(vlanUdp) / sizeof(vlanUdp[0]), packets, numOfMatches), 0, int);
+	PTF_ASSERT_GREATER_THAN(numOfMatches, 0, int);
+
+	// a program that returns a value computed from the packet, exercising the ALU, scratch memory and X register instructions
+	struct bpf_insn alu[] = {
+		BPF_STMT(BPF_LD|BPF_W|BPF_ABS, 26),
+		BPF_STMT(BPF_ST, 0),
+		BPF_STMT(BPF_LDX|BPF_MSH|BPF_B, 14),
+		BPF_STMT(BPF_MISC|BPF_TXA, 0),
+		BPF_STMT(BPF_ALU|BPF_ADD|BPF_K, 14),
+		BPF_STMT(BPF_MISC|BPF_TAX, 0),
+		BPF_STMT(BPF_LD|BPF_B|BPF_IND, 13),
+		BPF_STMT(BPF_ALU|BPF_AND|BPF_K, 0x3f),
+		BPF_STMT(BPF_STX, 15),
+		BPF_STMT(BPF_MISC|BPF_TAX, 0),
+		BPF_STMT(BPF_LD|BPF_MEM, 0),
+		BPF_STMT(BPF_ALU|BPF_DIV|BPF_X, 0),
+		BPF_STMT(BPF_ALU|BPF_MUL|BPF_K, 3),
+		BPF_STMT(BPF_ALU|BPF_LSH|BPF_X, 0),
+		BPF_STMT(BPF_ALU|BPF_RSH|BPF_K, 3),
+		BPF_STMT(BPF_ALU|BPF_XOR|BPF_K, 0x5a5a5a5a),
+		BPF_STMT(BPF_ALU|BPF_MOD|BPF_K, 1000003),
+		BPF_STMT(BPF_ALU|BPF_SUB|BPF_X, 0),
+		BPF_STMT(BPF_ALU|BPF_NEG, 0),
+		BPF_STMT(BPF_ALU|BPF_OR|BPF_K, 1),
+		BPF_STMT(BPF_LDX|BPF_MEM, 15),
+		BPF_STMT(BPF_ALU|BPF_ADD|BPF_X, 0),
+		BPF_STMT(BPF_ALU|BPF_MOD|BPF_X, 0),
+		BPF_STMT(BPF_LDX|BPF_W|BPF_LEN, 0),
+		BPF_JUMP(BPF_JMP|BPF_JGE|BPF_X, 0, 0, 1),
+		BPF_STMT(BPF_LD|BPF_H|BPF_IND, 0),
+		BPF_STMT(BPF_LDX|BPF_IMM, 3),
+		BPF_STMT(BPF_ALU|BPF_RSH|BPF_X, 0),
+		BPF_JUMP(BPF_JMP|BPF_JSET|BPF_K, 0x2, 1, 0),
+		BPF_STMT(BPF_JMP|BPF_JA, 2),
+		BPF_STMT(BPF_LDX|BPF_IMM, 64),
+		BPF_STMT(BPF_LD|BPF_W|BPF_IND, 0),
+		BPF_STMT(BPF_ALU|BPF_ADD|BPF_K, 1),
+		BPF_STMT(BPF_RET|BPF_A, 0),
+	};
+	PTF_ASSERT_EQUAL(compareThreadedBpfProgram(alu, sizeof(alu) / sizeof(alu[0]), packets, numOfMatches), 0, int);
+	PTF_ASSERT_GREATER_THAN(numOfMatches, 0, int);
+
+	// jump instructions with X and immediate loads
+	struct bpf_insn jumpX[] = {
+		BPF_STMT(BPF_LDX|BPF_IMM, 0x45),
+		BPF_STMT(BPF_LD|BPF_B|BPF_ABS, 14),
+		BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_X, 0, 0, 4),
+		BPF_STMT(BPF_LDX|BPF_IMM, 0x4000),
+		BPF_STMT(BPF_LD|BPF_H|BPF_ABS, 20),
+		BPF_JUMP(BPF_JMP|BPF_JSET|BPF_X, 0, 3, 0),
+		BPF_STMT(BPF_LD|BPF_IMM, 7),
+		BPF_STMT(BPF_LDX|BPF_W|BPF_LEN, 0),
+		BPF_JUMP(BPF_JMP|BPF_JGT|BPF_X, 0, 0, 1),
+		BPF_STMT(BPF_RET|BPF_K, 0),
+		BPF_STMT(BPF_RET|BPF_K, 1),
+	};
+	PTF_ASSERT_EQUAL(compareThreadedBpfProgram(jumpX, sizeof(jumpX) / sizeof(jumpX[0]), packets, numOfMatches), 0, int);
+	PTF_ASSERT_GREATER_THAN(numOfMatches, 0, int);
+
+	// programs that are rejected
+	pcpp::ThreadedBpfProgram threaded;
+	PTF_ASSERT_TRUE(threaded.compile(arp, sizeof(arp) / sizeof(arp[0])));
+	PTF_ASSERT_EQUAL((int)threaded.getNumOfInstructions(), 4, int);
+	PTF_ASSERT_FALSE(threaded.isEmpty());
+
+	PTF_ASSERT_FALSE(threaded.compile(arp, 0));
+	PTF_ASSERT_TRUE(threaded.isEmpty());
+	PTF_ASSERT_EQUAL(threaded.run(packets.front()->getRawData(), 60, 60), 0, u32);
+
+	struct bpf_insn unknownOpcode[] = { BPF_STMT(BPF_RET|BPF_X, 0) };
+	PTF_ASSERT_FALSE(threaded.compile(unknownOpcode, 1));
+	struct bpf_insn noReturn[] = { BPF_STMT(BPF_LD|BPF_W|BPF_LEN, 0) };
+	PTF_ASSERT_FALSE(threaded.compile(noReturn, 1));
+	struct bpf_insn jumpOutOfRange[] = { BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, 0, 0, 1), BPF_STMT(BPF_RET|BPF_K, 0) };
+	PTF_ASSERT_FALSE(threaded.compile(jumpOutOfRange, 2));
+	struct bpf_insn jaOutOfRange[] = { BPF_STMT(BPF_JMP|BPF_JA, 0xffffffff), BPF_STMT(BPF_RET|BPF_K, 0) };
+	PTF_ASSERT_FALSE(threaded.compile(jaOutOfRange, 2));
+	struct bpf_insn memOutOfRange[] = { BPF_STMT(BPF_ST, BPF_MEMWORDS), BPF_STMT(BPF_RET|BPF_K, 0) };
+	PTF_ASSERT_FALSE(threaded.compile(memOutOfRange, 2));
+	struct bpf_insn divByZero[] = { BPF_STMT(BPF_ALU|BPF_DIV|BPF_K, 0), BPF_STMT(BPF_RET|BPF_A, 0) };
+	PTF_ASSERT_FALSE(threaded.compile(divByZero, 2));
+	struct bpf_insn bigShift[] = { BPF_STMT(BPF_ALU|BPF_LSH|BPF_K, 32), BPF_STMT(BPF_RET|BPF_A, 0) };
+	PTF_ASSERT_FALSE(threaded.compile(bigShift, 2));
+	PTF_ASSERT_TRUE(threaded.isEmpty());
+} // TestThreadedBpfProgram
+
+
+
+struct ClassifierTestTuple
+{
+	bool isIPv4;
+	uint8_t srcIp[16];
+	uint8_t dstIp[16];
+	bool hasPorts;
+	uint16_t srcPort;
+	uint16_t dstPort;
+	int protocol;
+};
+
+static bool getClassifierTestTuple(pcpp::Packet& packet, ClassifierTestTuple& tuple)
+{
+	pcpp::Layer* ipLayer = packet.getFirstLayer();
+	while (ipLayer != NULL && ipLayer->getProtocol() != pcpp::IPv4 && ipLayer->getProtocol() != pcpp::IPv6)
+		ipLayer = ipLayer->getNextLayer();
+	if (ipLayer == NULL)
+		return false;
+
+	memset(&tuple, 0, sizeof(tuple));
+	tuple.isIPv4 = (ipLayer->getProtocol() == pcpp::IPv4);
+	if (tuple.isIPv4)
+	{
+		pcpp::IPv4Layer* ipv4Layer = static_cast<pcpp::IPv4Layer*>(ipLayer);
+		memcpy(tuple.srcIp, ipv4Layer->getSrcIpAddress().toBytes(), 4);
+		memcpy(tuple.dstIp, ipv4Layer->getDstIpAddress().toBytes(), 4);
+		tuple.protocol = ipv4Layer->getIPv4Header()->protocol;
+	}
+	else
+	{
+		pcpp::IPv6Layer* ipv6Layer = static_cast<pcpp::IPv6Layer*>(ipLayer);
+		memcpy(tuple.srcIp, ipv6Layer->getSrcIpAddress().toBytes(), 16);
+		memcpy(tuple.dstIp, ipv6Layer->getDstIpAddress().toBytes(), 16);
+		tuple.protocol = ipv6Layer->getIPv6Header()->nextHeader;
+	}
+
+	pcpp::Layer* next = ipLayer->getNextLayer();
+	if (next != NULL && next->getProtocol() == pcpp::TCP)
+	{
+		pcpp::TcpLayer* tcpLayer = static_cast<pcpp::TcpLayer*>(next);
+		tuple.hasPorts = true;
+		tuple.srcPort = be16toh(tcpLayer->getTcpHeader()->portSrc);
+		tuple.dstPort = be16toh(tcpLayer->getTcpHeader()->portDst);
+		tuple.protocol = pcpp::PACKETPP_IPPROTO_TCP;
+	}
+	else if (next != NULL && next->getProtocol() == pcpp::UDP)
+	{
+		pcpp::UdpLayer* udpLayer = static_cast<pcpp::UdpLayer*>(next);
+		tuple.hasPorts = true;
+		tuple.srcPort = be16toh(udpLayer->getUdpHeader()->portSrc);
+		tuple.dstPort = be16toh(udpLayer->getUdpHeader()->portDst);
+		tuple.protocol = pcpp::PACKETPP_IPPROTO_UDP;
+	}
+
+	return true;
+}
+
+static bool classifierPrefixMatches(const uint8_t* addr, const pcpp::IPAddress& network, int prefixLength)
+{
+	const uint8_t* networkBytes = (network.isIPv4() ? network.getIPv4().toBytes() : network.getIPv6().toBytes());
+	for (int bit = 0; bit < prefixLength; bit++)
+	{
+		uint8_t mask = (uint8_t)(0x80 >> (bit % 8));
+		if ((addr[bit / 8] & mask) != (networkBytes[bit / 8] & mask))
+			return false;
+	}
+	return true;
+}
+
+// a straightforward implementation of a single rule match, used as a reference
+static bool classifierRuleMatches(const pcpp::PacketClassifierRule& rule, const ClassifierTestTuple& tuple)
+{
+	if (rule.srcIpPrefixLength > 0 && (rule.srcIp.isIPv4() != tuple.isIPv4 || !classifierPrefixMatches(tuple.srcIp, rule.srcIp, rule.srcIpPrefixLength)))
+		return false;
+	if (rule.dstIpPrefixLength > 0 && (rule.dstIp.isIPv4() != tuple.isIPv4 || !classifierPrefixMatches(tuple.dstIp, rule.dstIp, rule.dstIpPrefixLength)))
+		return false;
+	if (rule.protocol != pcpp::PacketClassifierRule::AnyProtocol && rule.protocol != tuple.protocol)
+		return false;
+
+	bool anySrcPort = (rule.srcPortFrom == 0 && rule.srcPortTo == 0xffff);
+	bool anyDstPort = (rule.dstPortFrom == 0 && rule.dstPortTo == 0xffff);
+	if (anySrcPort && anyDstPort)
+		return true;
+	if (!tuple.hasPorts)
+		return false;
+
+	return tuple.srcPort >= rule.srcPortFrom && tuple.srcPort <= rule.srcPortTo && tuple.dstPort >= rule.dstPortFrom && tuple.dstPort <= rule.dstPortTo;
+}
+
+static uint16_t randomPortBound(uint16_t port, bool up)
+{
+	switch (rand() % 4)
+	{
+	case 0: return port;
+	case 1: return (up ? 0xffff : 0);
+	case 2: return (up ? (uint16_t)std::min(0xffff, port + rand() % 2000) : (uint16_t)std::max(0, port - rand() % 2000));
+	default: return (up ? (uint16_t)(port | 0x3ff) : (uint16_t)(port & ~0x3ff));
+	}
+}
+
+// prefix lengths typical to ACLs, plus an occasional arbitrary one
+static uint8_t randomPrefixLength(bool isIPv4)
+{
+	const uint8_t ipv4Prefixes[] = { 8, 16, 24, 32, 32 };
+	const uint8_t ipv6Prefixes[] = { 32, 48, 64, 128, 128 };
+	if (rand() % 20 == 0)
+		return (uint8_t)(rand() % (isIPv4 ? 33 : 129));
+	return (isIPv4 ? ipv4Prefixes[rand() % 5] : ipv6Prefixes[rand() % 5]);
+}
+
+PTF_TEST_CASE(TestPacketClassifier)
+{
+	const char* files[] = { EXAMPLE_PCAP_PATH, EXAMPLE_PCAP_VLAN, EXAMPLE_PCAP_DNS, "PcapExamples/four_ipv6_http_streams.pcap" };
+	pcpp::RawPacketVector packets;
+	for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+	{
+		pcpp::PcapFileReaderDevice reader(files[i]);
+		PTF_ASSERT_TRUE(reader.open());
+		reader.getNextPackets(packets);
+		reader.close();
+	}
+
+	std::vector<ClassifierTestTuple> tuples;
+	std::vector<bool> isIp;
+	for (pcpp::RawPacketVector::VectorIterator iter = packets.begin(); iter != packets.end(); iter++)
+	{
+		pcpp::Packet packet(*iter);
+		ClassifierTestTuple tuple;
+		isIp.push_back(getClassifierTestTuple(packet, tuple));
+		tuples.push_back(tuple);
+	}
+
+	// build rules around the 5-tuples of random packets, with random wildcards, prefix lengths and port ranges
+	srand(1);
+	std::vector<pcpp::PacketClassifierRule> rules;
+	pcpp::PacketClassifier classifier;
+	while (rules.size() < 3000)
+	{
+		size_t packetIndex = rand() % packets.size();
+		if (!isIp[packetIndex])
+			continue;
+
+		const ClassifierTestTuple& tuple = tuples[packetIndex];
+		// duplicate IDs are allowed
+		pcpp::PacketClassifierRule rule((uint32_t)(rules.size() % 2500) * 3);
+		pcpp::IPAddress srcIp = (tuple.isIPv4 ? pcpp::IPAddress(pcpp::IPv4Address((uint8_t*)tuple.srcIp)) : pcpp::IPAddress(pcpp::IPv6Address((uint8_t*)tuple.srcIp)));
+		pcpp::IPAddress dstIp = (tuple.isIPv4 ? pcpp::IPAddress(pcpp::IPv4Address((uint8_t*)tuple.dstIp)) : pcpp::IPAddress(pcpp::IPv6Address((uint8_t*)tuple.dstIp)));
+		if (rand() % 3 != 0)
+		{
+			rule.srcIp = srcIp;
+			rule.srcIpPrefixLength = randomPrefixLength(tuple.isIPv4);
+		}
+		if (rand() % 3 != 0)
+		{
+			rule.dstIp = dstIp;
+			rule.dstIpPrefixLength = randomPrefixLength(tuple.isIPv4);
+		}
+		if (rand() % 2)
+			rule.protocol = tuple.protocol;
+		if (tuple.hasPorts && rand() % 2)
+		{
+			rule.srcPortFrom = randomPortBound(tuple.srcPort, false);
+			rule.srcPortTo = randomPortBound(tuple.srcPort, true);
+		}
+		if (tuple.hasPorts && rand() % 2)
+		{
+			rule.dstPortFrom = randomPortBound(tuple.dstPort, false);
+			rule.dstPortTo = randomPortBound(tuple.dstPort, true);
+		}
+		// make some rules miss by flipping an address bit
+		if (rand() % 4 == 0 && rule.srcIpPrefixLength > 0)
+			rule.srcIp = (tuple.isIPv4 ? pcpp::IPAddress(pcpp::IPv4Address(rule.srcIp.getIPv4().toInt() ^ 0x80)) : rule.srcIp);
+
+		PTF_ASSERT_TRUE(classifier.addRule(rule));
+		rules.push_back(rule);
+	}
+
+	PTF_ASSERT_EQUAL((int)classifier.getNumOfRules(), 3000, int);
+	PTF_ASSERT_LOWER_THAN((int)classifier.getNumOfTuples(), 3000, int);
+
+	// compare with a linear search over all rules
+	std::vector<uint32_t> allMatches, expectedAllMatches;
+	std::vector<uint32_t> expectedFirstMatch;
+	int numOfMatchedPackets = 0;
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		uint32_t expected = pcpp::PacketClassifier::NoMatch;
+		expectedAllMatches.clear();
+		if (isIp[i])
+		{
+			for (size_t r = 0; r < rules.size(); r++)
+			{
+				if (!classifierRuleMatches(rules[r], tuples[i]))
+					continue;
+				if (expectedAllMatches.empty())
+					expected = rules[r].ruleId;
+				expectedAllMatches.push_back(rules[r].ruleId);
+			}
+		}
+
+		if (expected != pcpp::PacketClassifier::NoMatch)
+			numOfMatchedPackets++;
+		expectedFirstMatch.push_back(expected);
+
+		pcpp::Packet packet(packets.at(i));
+		PTF_ASSERT_EQUAL(classifier.classify(packet), expected, u32);
+		PTF_ASSERT_EQUAL(classifier.classify(packets.at(i)), expected, u32);
+		PTF_ASSERT_TRUE(classifier.classifyAll(packet, allMatches) == !expectedAllMatches.empty());
+		PTF_ASSERT_TRUE(allMatches == expectedAllMatches);
+	}
+	PTF_ASSERT_GREATER_THAN(numOfMatchedPackets, 0, int);
+	PTF_ASSERT_LOWER_THAN(numOfMatchedPackets, (int)packets.size(), int);
+
+	// burst classification, including a burst that isn't a multiple of the internal chunk size
+	std::vector<pcpp::RawPacket*> packetPtrs(packets.begin(), packets.end());
+	std::vector<uint32_t> burstResults(packets.size(), 0);
+	classifier.classifyBurst(&packetPtrs[0], packetPtrs.size(), &burstResults[0]);
+	PTF_ASSERT_TRUE(burstResults == expectedFirstMatch);
+
+	std::vector<pcpp::RawPacket> contiguousPackets;
+	for (size_t i = 0; i < 45; i++)
+		contiguousPackets.push_back(*packets.at(i));
+	classifier.classifyBurst(&contiguousPackets[0], contiguousPackets.size(), &burstResults[0]);
+	PTF_ASSERT_TRUE(std::equal(expectedFirstMatch.begin(), expectedFirstMatch.begin() + 45, burstResults.begin()));
+
+	// hand-written rules: the first rule wins, and port ranges and protocol wildcards are honored
+	pcpp::PacketClassifier smallClassifier;
+	pcpp::PacketClassifierRule anyTcp(1);
+	anyTcp.protocol = pcpp::PACKETPP_IPPROTO_TCP;
+	pcpp::PacketClassifierRule httpServer(2);
+	httpServer.srcPortFrom = httpServer.srcPortTo = 80;
+	pcpp::PacketClassifierRule dns(3);
+	dns.dstPortFrom = 53;
+	dns.dstPortTo = 53;
+	dns.protocol = pcpp::PACKETPP_IPPROTO_UDP;
+	pcpp::PacketClassifierRule everything(4);
+	PTF_ASSERT_TRUE(smallClassifier.addRule(httpServer));
+	PTF_ASSERT_TRUE(smallClassifier.addRule(anyTcp));
+	PTF_ASSERT_TRUE(smallClassifier.addRule(dns));
+	PTF_ASSERT_TRUE(smallClassifier.addRule(everything));
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		if (!isIp[i])
+		{
+			PTF_ASSERT_EQUAL(smallClassifier.classify(packets.at(i)), (uint32_t)pcpp::PacketClassifier::NoMatch, u32);
+			continue;
+		}
+
+		const ClassifierTestTuple& tuple = tuples[i];
+		uint32_t expected = 4;
+		if (tuple.hasPorts && tuple.srcPort == 80)
+			expected = 2;
+		else if (tuple.protocol == pcpp::PACKETPP_IPPROTO_TCP)
+			expected = 1;
+		else if (tuple.protocol == pcpp::PACKETPP_IPPROTO_UDP && tuple.dstPort == 53)
+			expected = 3;
+		PTF_ASSERT_EQUAL(smallClassifier.classify(packets.at(i)), expected, u32);
+	}
+
+	// invalid rules
+	pcpp::LoggerPP::getInstance().supressErrors();
+	pcpp::PacketClassifierRule invalid(5);
+	invalid.srcIp = pcpp::IPv4Address(std::string("10.0.0.0"));
+	invalid.srcIpPrefixLength = 33;
+	PTF_ASSERT_FALSE(smallClassifier.addRule(invalid));
+	invalid.srcIpPrefixLength = 8;
+	invalid.dstIp = pcpp::IPv6Address(std::string("2001:db8::"));
+	invalid.dstIpPrefixLength = 32;
+	PTF_ASSERT_FALSE(smallClassifier.addRule(invalid));
+	invalid.dstIpPrefixLength = 0;
+	invalid.srcPortFrom = 100;
+	invalid.srcPortTo = 99;
+	PTF_ASSERT_FALSE(smallClassifier.addRule(invalid));
+	invalid.srcPortTo = 100;
+	invalid.protocol = 256;
+	PTF_ASSERT_FALSE(smallClassifier.addRule(invalid));
+	invalid.protocol = pcpp::PacketClassifierRule::AnyProtocol;
+	invalid.ruleId = pcpp::PacketClassifier::NoMatch;
+	PTF_ASSERT_FALSE(smallClassifier.addRule(invalid));
+	pcpp::LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_EQUAL((int)smallClassifier.getNumOfRules(), 4, int);
+
+	smallClassifier.clear();
+	PTF_ASSERT_EQUAL((int)smallClassifier.getNumOfRules(), 0, int);
+	PTF_ASSERT_EQUAL(smallClassifier.classify(packets.front()), (uint32_t)pcpp::PacketClassifier::NoMatch, u32);
+} // TestPacketClassifier
@@ -1081,4 +1081,119 @@ PTF_TEST_CASE(TestIPFragRemove)
 
 	ipReassembly.processPacket(ip4Packet8Frags.at(0), status);
 	PTF_ASSERT_EQUAL(ipReassembly.getCurrentCapacity(), 6, size);
-} // TestIPFragRemove
\ No newline at end of file
+} // TestIPFragRemove
+
+
+
+static void setPacketTime(pcpp::RawPacket* rawPacket, time_t seconds)
+{
+	timespec timestamp;
+	timestamp.tv_sec = seconds;
+	timestamp.tv_nsec = 0;
+	rawPacket->setPacketTimeStamp(timestamp);
+}
+
+PTF_TEST_CASE(TestIPFragBufferLimits)
+{
+	pcpp::PcapFileReaderDevice reader("PcapExamples/ip4_fragments.pcap");
+	PTF_ASSERT_TRUE(reader.open());
+
+	pcpp::RawPacketVector ip4Packet1Frags;
+	pcpp::RawPacketVector ip4Packet2Frags;
+	pcpp::RawPacketVector ip4Packet3Frags;
+
+	PTF_ASSERT_EQUAL(reader.getNextPackets(ip4Packet1Frags, 6), 6, int);
+	PTF_ASSERT_EQUAL(reader.getNextPackets(ip4Packet2Frags, 6), 6, int);
+	PTF_ASSERT_EQUAL(reader.getNextPackets(ip4Packet3Frags, 6), 6, int);
+
+	pcpp::IPReassembly::ReassemblyStatus status;
+
+	// reassemble the 2nd packet without any limits, in reverse order so all fragments but the first go through the out-of-order list
+	pcpp::IPReassembly reference;
+	pcpp::Packet* expected = NULL;
+	for (int i = 5; i >= 0; i--)
+		expected = reference.processPacket(ip4Packet2Frags.at(i), status);
+	PTF_ASSERT_EQUAL(status, pcpp::IPReassembly::REASSEMBLED, enum);
+	PTF_ASSERT_NOT_NULL(expected);
+	PTF_ASSERT_EQUAL(reference.getBufferedBytes(), 0, u64);
+
+	// timeout: packets that didn't get a fragment for more than 10 seconds are dropped
+	pcpp::PointerVector<pcpp::IPReassembly::PacketKey> packetsRemoved;
+	pcpp::IPReassembly timeoutReassembly(ipReassemblyOnFragmentsClean, &packetsRemoved, 100, 0, 10);
+
+	setPacketTime(ip4Packet1Frags.at(0), 100);
+	timeoutReassembly.processPacket(ip4Packet1Frags.at(0), status);
+	setPacketTime(ip4Packet2Frags.at(0), 105);
+	timeoutReassembly.processPacket(ip4Packet2Frags.at(0), status);
+	PTF_ASSERT_EQUAL(timeoutReassembly.getCurrentCapacity(), 2, size);
+	PTF_ASSERT_EQUAL(packetsRemoved.size(), 0, size);
+
+	setPacketTime(ip4Packet3Frags.at(0), 112);
+	timeoutReassembly.processPacket(ip4Packet3Frags.at(0), status);
+	PTF_ASSERT_EQUAL(timeoutReassembly.getCurrentCapacity(), 2, size);
+	PTF_ASSERT_EQUAL(packetsRemoved.size(), 1, size);
+	pcpp::IPReassembly::IPv4PacketKey* ip4Key = dynamic_cast<pcpp::IPReassembly::IPv4PacketKey*>(packetsRemoved.front());
+	PTF_ASSERT_NOT_NULL(ip4Key);
+	PTF_ASSERT_EQUAL(ip4Key->getIpID(), 0x1ea0, u16);
+
+	pcpp::Packet* result = NULL;
+	for (int i = 1; i < 6; i++)
+	{
+		setPacketTime(ip4Packet2Frags.at(i), 113);
+		result = timeoutReassembly.processPacket(ip4Packet2Frags.at(i), status);
+	}
+	PTF_ASSERT_EQUAL(status, pcpp::IPReassembly::REASSEMBLED, enum);
+	PTF_ASSERT_NOT_NULL(result);
+	PTF_ASSERT_EQUAL(result->getRawPacket()->getRawDataLen(), expected->getRawPacket()->getRawDataLen(), int);
+	PTF_ASSERT_BUF_COMPARE(result->getRawPacket()->getRawData(), expected->getRawPacket()->getRawData(), expected->getRawPacket()->getRawDataLen());
+	delete result;
+
+	// the 3rd packet times out as well once time moves forward
+	setPacketTime(ip4Packet1Frags.at(0), 200);
+	timeoutReassembly.processPacket(ip4Packet1Frags.at(0), status);
+	PTF_ASSERT_EQUAL(packetsRemoved.size(), 2, size);
+	PTF_ASSERT_EQUAL(timeoutReassembly.getCurrentCapacity(), 1, size);
+
+	// byte cap: buffering the fragments of 3 packets together doesn't fit so the least recently used packets are dropped
+	packetsRemoved.clear();
+	const uint64_t maxBufferedBytes = 20000;
+	pcpp::IPReassembly cappedReassembly(ipReassemblyOnFragmentsClean, &packetsRemoved, 100, maxBufferedBytes);
+	for (int i = 5; i >= 1; i--)
+	{
+		cappedReassembly.processPacket(ip4Packet1Frags.at(i), status);
+		PTF_ASSERT_TRUE(cappedReassembly.getBufferedBytes() <= maxBufferedBytes);
+		cappedReassembly.processPacket(ip4Packet3Frags.at(i), status);
+		PTF_ASSERT_TRUE(cappedReassembly.getBufferedBytes() <= maxBufferedBytes);
+	}
+	PTF_ASSERT_TRUE(packetsRemoved.size() > 0);
+
+	// a packet whose fragments arrive together still fits
+	result = NULL;
+	for (int i = 5; i >= 0; i--)
+	{
+		result = cappedReassembly.processPacket(ip4Packet2Frags.at(i), status);
+		PTF_ASSERT_TRUE(cappedReassembly.getBufferedBytes() <= maxBufferedBytes);
+	}
+	PTF_ASSERT_EQUAL(status, pcpp::IPReassembly::REASSEMBLED, enum);
+	PTF_ASSERT_NOT_NULL(result);
+	PTF_ASSERT_EQUAL(result->getRawPacket()->getRawDataLen(), expected->getRawPacket()->getRawDataLen(), int);
+	PTF_ASSERT_BUF_COMPARE(result->getRawPacket()->getRawData(), expected->getRawPacket()->getRawData(), expected->getRawPacket()->getRawDataLen());
+	delete result;
+
+	pcpp::IPReassembly::IPv4PacketKey key(0x1ea0, pcpp::IPv4Address(std::string("10.118.213.212")), pcpp::IPv4Address(std::string("10.118.213.211")));
+	cappedReassembly.removePacket(key);
+	key.setIpID(0x1ea2);
+	cappedReassembly.removePacket(key);
+	PTF_ASSERT_EQUAL(cappedReassembly.getCurrentCapacity(), 0, size);
+	PTF_ASSERT_EQUAL(cappedReassembly.getBufferedBytes(), 0, u64);
+
+	// a packet that doesn't fit on its own is dropped
+	packetsRemoved.clear();
+	pcpp::IPReassembly tinyReassembly(ipReassemblyOnFragmentsClean, &packetsRemoved, 100, 1000);
+	PTF_ASSERT_NULL(tinyReassembly.processPacket(ip4Packet1Frags.at(0), status));
+	PTF_ASSERT_EQUAL(tinyReassembly.getCurrentCapacity(), 0, size);
+	PTF_ASSERT_EQUAL(tinyReassembly.getBufferedBytes(), 0, u64);
+	PTF_ASSERT_EQUAL(packetsRemoved.size(), 1, size);
+
+	delete expected;
+} // TestIPFragBufferLimits
@@ -3,12 +3,17 @@
 #include "../Common/GlobalTestArgs.h"
 #include <sstream>
 #include <algorithm>
+#include <vector>
+#include <stdlib.h>
 #include "EndianPortable.h"
 #include "Logger.h"
 #include "GeneralUtils.h"
 #include "IpAddress.h"
 #include "MacAddress.h"
 #include "LRUList.h"
+#include "LockFreeRing.h"
+#include "RawPacket.h"
+#include <pthread.h>
 #include "NetworkUtils.h"
 #include "PcapLiveDeviceList.h"
 #include "SystemUtils.h"
@@ -192,6 +197,15 @@ PTF_TEST_CASE(TestMacAddress)
 
 
 
+// an LRUList element type that has no hash and no operator==
+struct LRUListOrderedKey
+{
+	int id;
+
+	LRUListOrderedKey(int keyId = 0) : id(keyId) {}
+	bool operator<(const LRUListOrderedKey& other) const { return id < other.id; }
+};
+
 PTF_TEST_CASE(TestLRUList)
 {
 	pcpp::LRUList<uint32_t> lruList(2);
@@ -209,10 +223,316 @@ PTF_TEST_CASE(TestLRUList)
 	lruList.eraseElement(2);
 	lruList.eraseElement(3);
 	PTF_ASSERT_EQUAL(lruList.getSize(), 0, size);
+
+	// putting an existing element advances it without evicting anything
+	PTF_ASSERT_EQUAL(lruList.put(4, NULL), 0, int);
+	PTF_ASSERT_EQUAL(lruList.put(5, NULL), 0, int);
+	PTF_ASSERT_EQUAL(lruList.put(4, NULL), 0, int);
+	PTF_ASSERT_EQUAL(lruList.getMRUElement(), 4, u32);
+	PTF_ASSERT_EQUAL(lruList.getLRUElement(), 5, u32);
+	PTF_ASSERT_EQUAL(lruList.put(6, &deletedValue), 1, int);
+	PTF_ASSERT_EQUAL(deletedValue, 5, u32);
+	PTF_ASSERT_EQUAL(lruList.getLRUElement(), 4, u32);
+
+	// a list of max size 0 evicts every new element right away
+	pcpp::LRUList<int> emptyList(0);
+	int deletedInt = 0;
+	PTF_ASSERT_EQUAL(emptyList.put(7, &deletedInt), 1, int);
+	PTF_ASSERT_EQUAL(deletedInt, 7, int);
+	PTF_ASSERT_EQUAL(emptyList.getSize(), 0, size);
+
+	// compare random operations against a straightforward implementation, with a preallocated list and a growing list
+	const size_t maxSize = 100;
+	pcpp::LRUList<uint32_t> preallocatedList(maxSize, maxSize);
+	pcpp::LRUList<uint32_t> growingList(maxSize);
+	std::vector<uint32_t> reference; // MRU element first
+	srand(5);
+	for (int i = 0; i < 20000; i++)
+	{
+		uint32_t value = (uint32_t)(rand() % 300);
+		if (rand() % 4 == 0)
+		{
+			preallocatedList.eraseElement(value);
+			growingList.eraseElement(value);
+			std::vector<uint32_t>::iterator iter = std::find(reference.begin(), reference.end(), value);
+			if (iter != reference.end())
+				reference.erase(iter);
+		}
+		else
+		{
+			uint32_t deleted1 = 0xffffffff, deleted2 = 0xffffffff, expectedDeleted = 0xffffffff;
+			int expectedResult = 0;
+			std::vector<uint32_t>::iterator iter = std::find(reference.begin(), reference.end(), value);
+			if (iter != reference.end())
+				reference.erase(iter);
+			else if (reference.size() == maxSize)
+			{
+				expectedDeleted = reference.back();
+				reference.pop_back();
+				expectedResult = 1;
+			}
+			reference.insert(reference.begin(), value);
+
+			PTF_ASSERT_EQUAL(preallocatedList.put(value, &deleted1), expectedResult, int);
+			PTF_ASSERT_EQUAL(growingList.put(value, &deleted2), expectedResult, int);
+			PTF_ASSERT_EQUAL(deleted1, expectedDeleted, u32);
+			PTF_ASSERT_EQUAL(deleted2, expectedDeleted, u32);
+		}
+
+		PTF_ASSERT_EQUAL(preallocatedList.getSize(), reference.size(), size);
+		PTF_ASSERT_EQUAL(growingList.getSize(), reference.size(), size);
+		if (!reference.empty())
+		{
+			PTF_ASSERT_EQUAL(preallocatedList.getMRUElement(), reference.front(), u32);
+			PTF_ASSERT_EQUAL(preallocatedList.getLRUElement(), reference.back(), u32);
+			PTF_ASSERT_EQUAL(growingList.getMRUElement(), reference.front(), u32);
+			PTF_ASSERT_EQUAL(growingList.getLRUElement(), reference.back(), u32);
+		}
+	}
+
+	// element types with a default hash other than integers
+	pcpp::LRUList<std::string> stringList(2);
+	std::string deletedString;
+	PTF_ASSERT_EQUAL(stringList.put("first", &deletedString), 0, int);
+	PTF_ASSERT_EQUAL(stringList.put("second", &deletedString), 0, int);
+	PTF_ASSERT_EQUAL(stringList.put("first", &deletedString), 0, int);
+	PTF_ASSERT_EQUAL(stringList.put("third", &deletedString), 1, int);
+	PTF_ASSERT_EQUAL(deletedString, "second", string);
+	stringList.eraseElement("first");
+	PTF_ASSERT_EQUAL(stringList.getSize(), 1, size);
+	PTF_ASSERT_EQUAL(stringList.getMRUElement(), "third", string);
+
+	pcpp::LRUList<pcpp::IPv4Address> ipList(2);
+	pcpp::IPv4Address deletedIp;
+	ipList.put(pcpp::IPv4Address(std::string("10.0.0.1")));
+	ipList.put(pcpp::IPv4Address(std::string("10.0.0.2")));
+	PTF_ASSERT_EQUAL(ipList.put(pcpp::IPv4Address(std::string("10.0.0.3")), &deletedIp), 1, int);
+	PTF_ASSERT_EQUAL(deletedIp.toString(), "10.0.0.1", string);
+
+	pcpp::LRUList<pcpp::MacAddress> macList(1);
+	pcpp::MacAddress deletedMac;
+	macList.put(pcpp::MacAddress("00:11:22:33:44:55"));
+	PTF_ASSERT_EQUAL(macList.put(pcpp::MacAddress("00:11:22:33:44:66"), &deletedMac), 1, int);
+	PTF_ASSERT_EQUAL(deletedMac.toString(), "00:11:22:33:44:55", string);
+
+	// types without a hash (that have only operator<) are kept in the ordered index
+	pcpp::LRUList<LRUListOrderedKey> orderedList(2);
+	LRUListOrderedKey deletedKey;
+	orderedList.put(LRUListOrderedKey(1));
+	orderedList.put(LRUListOrderedKey(2));
+	orderedList.put(LRUListOrderedKey(1));
+	PTF_ASSERT_EQUAL(orderedList.put(LRUListOrderedKey(3), &deletedKey), 1, int);
+	PTF_ASSERT_EQUAL(deletedKey.id, 2, int);
+	orderedList.eraseElement(LRUListOrderedKey(1));
+	PTF_ASSERT_EQUAL(orderedList.getSize(), 1, size);
+	PTF_ASSERT_EQUAL(orderedList.getLRUElement().id, 3, int);
 } // TestLRUList
 
 
 
+// items passed between the threads of the lock-free ring test. Each producer sends the values 1..ringTestItemsPerProducer
+static const uint32_t ringTestItemsPerProducer = 20000;
+
+struct RingTestThreadArgs
+{
+	pcpp::SPSCRing<uint32_t>* spscRing;
+	pcpp::MPMCRing<uint32_t>* mpmcRing;
+	volatile uint32_t* producersDone;
+	uint64_t sum;
+	uint32_t count;
+	bool outOfOrder;
+};
+
+static void* spscRingProducer(void* ptr)
+{
+	RingTestThreadArgs* args = (RingTestThreadArgs*)ptr;
+	uint32_t next = 1;
+	uint32_t items[16];
+	while (next <= ringTestItemsPerProducer)
+	{
+		// alternate single and bulk enqueues
+		if (next % 2 == 0)
+		{
+			uint32_t count = 0;
+			while (count < 16 && next + count <= ringTestItemsPerProducer)
+			{
+				items[count] = next + count;
+				count++;
+			}
+			next += args->spscRing->enqueueBulk(items, count);
+		}
+		else if (args->spscRing->enqueue(next))
+			next++;
+	}
+	return NULL;
+}
+
+static void* spscRingConsumer(void* ptr)
+{
+	RingTestThreadArgs* args = (RingTestThreadArgs*)ptr;
+	uint32_t expected = 1;
+	uint32_t items[16];
+	while (expected <= ringTestItemsPerProducer)
+	{
+		uint32_t count = args->spscRing->dequeueBulk(items, 16);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (items[i] != expected)
+				args->outOfOrder = true;
+			expected++;
+		}
+	}
+	args->count = expected - 1;
+	return NULL;
+}
+
+static void* mpmcRingProducer(void* ptr)
+{
+	RingTestThreadArgs* args = (RingTestThreadArgs*)ptr;
+	uint32_t next = 1;
+	uint32_t items[8];
+	while (next <= ringTestItemsPerProducer)
+	{
+		uint32_t count = 0;
+		while (count < 8 && next + count <= ringTestItemsPerProducer)
+		{
+			items[count] = next + count;
+			count++;
+		}
+		next += args->mpmcRing->enqueueBulk(items, count);
+	}
+	return NULL;
+}
+
+static void* mpmcRingConsumer(void* ptr)
+{
+	RingTestThreadArgs* args = (RingTestThreadArgs*)ptr;
+	uint32_t items[8];
+	while (true)
+	{
+		// the ring must be checked once more after all producers are done
+		bool producersDone = (pcpp::internal::ringLoadAcquire(args->producersDone) != 0);
+		uint32_t count = args->mpmcRing->dequeueBulk(items, 8);
+		for (uint32_t i = 0; i < count; i++)
+			args->sum += items[i];
+		args->count += count;
+		if (count == 0 && producersDone)
+			break;
+	}
+	return NULL;
+}
+
+
+
+PTF_TEST_CASE(TestLockFreeRing)
+{
+	// single-threaded behavior, the capacity is rounded up to a power of 2
+	pcpp::SPSCRing<int> spscRing(5);
+	PTF_ASSERT_EQUAL(spscRing.getCapacity(), 8, u32);
+	PTF_ASSERT_TRUE(spscRing.isEmpty());
+	int value = 0;
+	PTF_ASSERT_FALSE(spscRing.dequeue(value));
+	PTF_ASSERT_NULL(spscRing.peekDequeue());
+
+	int values[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+	PTF_ASSERT_EQUAL(spscRing.enqueueBulk(values, 10), 8, u32);
+	PTF_ASSERT_EQUAL(spscRing.getSize(), 8, u32);
+	PTF_ASSERT_FALSE(spscRing.enqueue(8));
+	PTF_ASSERT_NULL(spscRing.reserveEnqueue());
+
+	int dequeued[10];
+	PTF_ASSERT_EQUAL(spscRing.dequeueBulk(dequeued, 3), 3, u32);
+	PTF_ASSERT_EQUAL(dequeued[2], 2, int);
+	PTF_ASSERT_TRUE(spscRing.enqueue(8));
+	int* slot = spscRing.reserveEnqueue();
+	PTF_ASSERT_NOT_NULL(slot);
+	*slot = 9;
+	spscRing.commitEnqueue();
+	PTF_ASSERT_EQUAL(*spscRing.peekDequeue(), 3, int);
+	spscRing.commitDequeue();
+	PTF_ASSERT_EQUAL(spscRing.dequeueBulk(dequeued, 10), 6, u32);
+	PTF_ASSERT_EQUAL(dequeued[0], 4, int);
+	PTF_ASSERT_EQUAL(dequeued[5], 9, int);
+	PTF_ASSERT_TRUE(spscRing.isEmpty());
+
+	pcpp::MPMCRing<int> mpmcRing(4);
+	PTF_ASSERT_EQUAL(mpmcRing.getCapacity(), 4, u32);
+	PTF_ASSERT_FALSE(mpmcRing.dequeue(value));
+	// go around the ring a few times
+	for (int i = 0; i < 3; i++)
+	{
+		PTF_ASSERT_EQUAL(mpmcRing.enqueueBulk(values, 10), 4, u32);
+		PTF_ASSERT_FALSE(mpmcRing.enqueue(4));
+		PTF_ASSERT_EQUAL(mpmcRing.getSize(), 4, u32);
+		PTF_ASSERT_TRUE(mpmcRing.dequeue(value));
+		PTF_ASSERT_EQUAL(value, 0, int);
+		PTF_ASSERT_EQUAL(mpmcRing.dequeueBulk(dequeued, 10), 3, u32);
+		PTF_ASSERT_EQUAL(dequeued[2], 3, int);
+		PTF_ASSERT_TRUE(mpmcRing.isEmpty());
+	}
+
+	// rings of packet pointers transfer ownership, packets left in the ring are freed by deleteAll()
+	pcpp::SPSCRing<pcpp::RawPacket*> packetRing(4);
+	pcpp::MPMCRing<pcpp::RawPacket*> mpmcPacketRing(4);
+	for (int i = 0; i < 3; i++)
+	{
+		PTF_ASSERT_TRUE(packetRing.enqueue(new pcpp::RawPacket()));
+		PTF_ASSERT_TRUE(mpmcPacketRing.enqueue(new pcpp::RawPacket()));
+	}
+	PTF_ASSERT_EQUAL(packetRing.deleteAll(), 3, u32);
+	PTF_ASSERT_EQUAL(mpmcPacketRing.deleteAll(), 3, u32);
+	PTF_ASSERT_TRUE(packetRing.isEmpty());
+
+	// one producer and one consumer, items arrive in order
+	pcpp::SPSCRing<uint32_t> threadSpscRing(256);
+	RingTestThreadArgs spscArgs;
+	memset(&spscArgs, 0, sizeof(spscArgs));
+	spscArgs.spscRing = &threadSpscRing;
+	pthread_t producerThread, consumerThread;
+	PTF_ASSERT_EQUAL(pthread_create(&consumerThread, NULL, spscRingConsumer, &spscArgs), 0, int);
+	PTF_ASSERT_EQUAL(pthread_create(&producerThread, NULL, spscRingProducer, &spscArgs), 0, int);
+	pthread_join(producerThread, NULL);
+	pthread_join(consumerThread, NULL);
+	PTF_ASSERT_FALSE(spscArgs.outOfOrder);
+	PTF_ASSERT_EQUAL(spscArgs.count, ringTestItemsPerProducer, u32);
+	PTF_ASSERT_TRUE(threadSpscRing.isEmpty());
+
+	// several producers and consumers, every item arrives exactly once
+	const int numOfThreads = 3;
+	pcpp::MPMCRing<uint32_t> threadMpmcRing(256);
+	volatile uint32_t producersDone = 0;
+	RingTestThreadArgs mpmcArgs[numOfThreads * 2];
+	pthread_t mpmcThreads[numOfThreads * 2];
+	for (int i = 0; i < numOfThreads * 2; i++)
+	{
+		memset(&mpmcArgs[i], 0, sizeof(RingTestThreadArgs));
+		mpmcArgs[i].mpmcRing = &threadMpmcRing;
+		mpmcArgs[i].producersDone = &producersDone;
+		PTF_ASSERT_EQUAL(pthread_create(&mpmcThreads[i], NULL, (i < numOfThreads ? mpmcRingConsumer : mpmcRingProducer), &mpmcArgs[i]), 0, int);
+	}
+
+	// consumers stop once the producers are done and the ring is empty
+	for (int i = numOfThreads; i < numOfThreads * 2; i++)
+		pthread_join(mpmcThreads[i], NULL);
+	pcpp::internal::ringStoreRelease(&producersDone, 1);
+
+	uint64_t totalSum = 0;
+	uint32_t totalCount = 0;
+	for (int i = 0; i < numOfThreads; i++)
+	{
+		pthread_join(mpmcThreads[i], NULL);
+		totalSum += mpmcArgs[i].sum;
+		totalCount += mpmcArgs[i].count;
+	}
+
+	PTF_ASSERT_EQUAL(totalCount, ringTestItemsPerProducer * numOfThreads, u32);
+	uint64_t expectedSum = (uint64_t)ringTestItemsPerProducer * (ringTestItemsPerProducer + 1) / 2 * numOfThreads;
+	PTF_ASSERT_EQUAL(totalSum, expectedSum, u64);
+	PTF_ASSERT_TRUE(threadMpmcRing.isEmpty());
+} // TestLockFreeRing
+
+
+
 PTF_TEST_CASE(TestGeneralUtils)
 {
 	uint8_t resultArr[4];
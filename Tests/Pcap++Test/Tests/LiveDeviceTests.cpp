@@ -5,6 +5,7 @@
 #include "PcapFileDevice.h"
 #include "PcapRemoteDevice.h"
 #include "PcapRemoteDeviceList.h"
+#include "IPv4Layer.h"
 #include "../Common/GlobalTestArgs.h"
 #include "../Common/TestUtils.h"
 #include "../Common/PcapFileNamesDef.h"
@@ -85,6 +86,65 @@ static bool packetArrivesBlockingModeWithSnaplen(pcpp::RawPacket* rawPacket, pcp
 	return rawPacket->getRawDataLen() > snaplen;
 }
 
+struct BurstStats
+{
+	int numOfBursts;
+	int numOfPackets;
+	size_t maxBurstSize;
+	bool burstTooLarge;
+	bool emptyPacket;
+
+	BurstStats(size_t maxBurst) : numOfBursts(0), numOfPackets(0), maxBurstSize(maxBurst), burstTooLarge(false), emptyPacket(false) {}
+};
+
+static void packetBurstArrives(pcpp::RawPacket* packets, size_t numOfPackets, pcpp::PcapLiveDevice* pDevice, void* userCookie)
+{
+	BurstStats* stats = (BurstStats*)userCookie;
+	stats->numOfBursts++;
+	stats->numOfPackets += (int)numOfPackets;
+	if (numOfPackets == 0 || numOfPackets > stats->maxBurstSize)
+		stats->burstTooLarge = true;
+	for (size_t i = 0; i < numOfPackets; i++)
+	{
+		if (!packets[i].isPacketSet() || packets[i].getRawDataLen() <= 0)
+			stats->emptyPacket = true;
+	}
+}
+
+struct FanoutFilterStats
+{
+	pcpp::IPv4Address dstIp;
+	int numOfPackets;
+	int numOfOtherDstPackets;
+	int numOfNonTcpPackets;
+
+	FanoutFilterStats(const pcpp::IPv4Address& ip) : dstIp(ip), numOfPackets(0), numOfOtherDstPackets(0), numOfNonTcpPackets(0) {}
+};
+
+static void fanoutFilterPacketArrives(pcpp::RawPacket* rawPacket, pcpp::PcapLiveDevice* pDevice, void* userCookie)
+{
+	FanoutFilterStats* stats = (FanoutFilterStats*)userCookie;
+	pcpp::Packet packet(rawPacket);
+	pcpp::IPv4Layer* ipLayer = packet.getLayerOfType<pcpp::IPv4Layer>();
+	stats->numOfPackets++;
+	if (ipLayer == NULL || ipLayer->getDstIpAddress() != stats->dstIp)
+		stats->numOfOtherDstPackets++;
+	if (!packet.isPacketOfType(pcpp::TCP))
+		stats->numOfNonTcpPackets++;
+}
+
+static FanoutFilterStats sumFanoutFilterStats(const std::vector<FanoutFilterStats>& threadStats)
+{
+	FanoutFilterStats total(threadStats[0].dstIp);
+	for (std::vector<FanoutFilterStats>::const_iterator iter = threadStats.begin(); iter != threadStats.end(); iter++)
+	{
+		total.numOfPackets += iter->numOfPackets;
+		total.numOfOtherDstPackets += iter->numOfOtherDstPackets;
+		total.numOfNonTcpPackets += iter->numOfNonTcpPackets;
+	}
+	return total;
+}
+
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
 
 class RpcapdServerInitializer
@@ -469,6 +529,229 @@ PTF_TEST_CASE(TestPcapLiveDeviceSpecialCfg)
 
 
 
+PTF_TEST_CASE(TestPcapLiveDeviceBurstMode)
+{
+	pcpp::PcapLiveDevice* liveDev = pcpp::PcapLiveDeviceList::getInstance().getPcapLiveDeviceByIp(PcapTestGlobalArgs.ipToSendReceivePackets.c_str());
+	PTF_ASSERT_NOT_NULL(liveDev);
+	PTF_ASSERT_TRUE(liveDev->open());
+	DeviceTeardown devTeardown(liveDev);
+
+	// burst array allocated by the device
+	BurstStats burstStats(16);
+	PTF_ASSERT_TRUE(liveDev->startCaptureBurstMode(&packetBurstArrives, &burstStats, 16));
+	PTF_ASSERT_TRUE(liveDev->captureActive());
+
+	// a negative test - only one capture at a time
+	pcpp::LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(liveDev->startCaptureBurstMode(&packetBurstArrives, &burstStats));
+	pcpp::LoggerPP::getInstance().enableErrors();
+
+	int totalSleepTime = 0;
+	while (totalSleepTime <= 20)
+	{
+		pcpp::multiPlatformSleep(2);
+		totalSleepTime += 2;
+		if (burstStats.numOfPackets > 0)
+			break;
+	}
+
+	PTF_PRINT_VERBOSE("Total sleep time: %d secs", totalSleepTime);
+
+	liveDev->stopCapture();
+	PTF_ASSERT_GREATER_THAN(burstStats.numOfPackets, 0, int);
+	PTF_ASSERT_GREATER_THAN(burstStats.numOfBursts, 0, int);
+	PTF_ASSERT_FALSE(burstStats.burstTooLarge);
+	PTF_ASSERT_FALSE(burstStats.emptyPacket);
+
+	// burst array allocated by the user, it's cleared when capture stops
+	pcpp::RawPacket packetArray[8];
+	BurstStats userArrayBurstStats(8);
+	PTF_ASSERT_TRUE(liveDev->startCaptureBurstMode(&packetBurstArrives, &userArrayBurstStats, 8, packetArray));
+	totalSleepTime = 0;
+	while (totalSleepTime <= 20)
+	{
+		pcpp::multiPlatformSleep(2);
+		totalSleepTime += 2;
+		if (userArrayBurstStats.numOfPackets > 0)
+			break;
+	}
+
+	liveDev->stopCapture();
+	PTF_ASSERT_GREATER_THAN(userArrayBurstStats.numOfPackets, 0, int);
+	PTF_ASSERT_FALSE(userArrayBurstStats.burstTooLarge);
+	PTF_ASSERT_FALSE(userArrayBurstStats.emptyPacket);
+	for (int i = 0; i < 8; i++)
+		PTF_ASSERT_FALSE(packetArray[i].isPacketSet());
+
+	// a negative test - a burst can't be empty
+	pcpp::LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(liveDev->startCaptureBurstMode(&packetBurstArrives, &burstStats, 0));
+	pcpp::LoggerPP::getInstance().enableErrors();
+	liveDev->close();
+
+	// a negative test - device isn't opened
+	pcpp::LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(liveDev->startCaptureBurstMode(&packetBurstArrives, &burstStats));
+	pcpp::LoggerPP::getInstance().enableErrors();
+} // TestPcapLiveDeviceBurstMode
+
+
+
+PTF_TEST_CASE(TestPcapLiveDeviceMultiThread)
+{
+#ifdef LINUX
+	pcpp::PcapLiveDevice* liveDev = pcpp::PcapLiveDeviceList::getInstance().getPcapLiveDeviceByIp(PcapTestGlobalArgs.ipToSendReceivePackets.c_str());
+	PTF_ASSERT_NOT_NULL(liveDev);
+	PTF_ASSERT_TRUE(liveDev->open());
+	DeviceTeardown devTeardown(liveDev);
+
+	// one packet counter per capture thread
+	const int numOfThreads = 4;
+	int packetCount[numOfThreads] = { 0 };
+	std::vector<void*> cookies;
+	for (int i = 0; i < numOfThreads; i++)
+		cookies.push_back(&packetCount[i]);
+
+	pcpp::PcapLiveDevice::FanoutConfiguration fanoutConfig(pcpp::PcapLiveDevice::FanoutLoadBalance);
+	PTF_ASSERT_TRUE(liveDev->startCaptureMultiThread(&packetArrives, cookies, pcpp::getCoreMaskForAllMachineCores(), fanoutConfig));
+	PTF_ASSERT_TRUE(liveDev->captureActive());
+
+	// a negative test - only one capture at a time
+	pcpp::LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(liveDev->startCapture(&packetArrives, &packetCount[0]));
+	pcpp::LoggerPP::getInstance().enableErrors();
+
+	int totalPacketCount = 0;
+	int totalSleepTime = 0;
+	while (totalSleepTime <= 20)
+	{
+		pcpp::multiPlatformSleep(2);
+		totalSleepTime += 2;
+		totalPacketCount = 0;
+		for (int i = 0; i < numOfThreads; i++)
+			totalPacketCount += packetCount[i];
+		if (totalPacketCount >= numOfThreads * 10)
+			break;
+	}
+
+	PTF_PRINT_VERBOSE("Total sleep time: %d secs", totalSleepTime);
+
+	pcpp::IPcapDevice::PcapStats statistics;
+	liveDev->getStatistics(statistics);
+	liveDev->stopCapture();
+	PTF_ASSERT_FALSE(liveDev->captureActive());
+
+	totalPacketCount = 0;
+	for (int i = 0; i < numOfThreads; i++)
+		totalPacketCount += packetCount[i];
+	PTF_ASSERT_GREATER_THAN(totalPacketCount, 0, int);
+	PTF_ASSERT_GREATER_THAN(statistics.packetsRecv, 0, u64);
+
+	// in load balance mode every thread gets its share
+	if (totalPacketCount >= numOfThreads * 10)
+	{
+		for (int i = 0; i < numOfThreads; i++)
+			PTF_ASSERT_GREATER_THAN(packetCount[i], 0, int);
+	}
+
+	// a regular capture works after a multi-threaded one
+	int singleThreadPacketCount = 0;
+	PTF_ASSERT_TRUE(liveDev->startCapture(&packetArrives, &singleThreadPacketCount));
+	liveDev->stopCapture();
+
+	// a negative test - no cookies means no threads
+	pcpp::LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(liveDev->startCaptureMultiThread(&packetArrives, std::vector<void*>()));
+	pcpp::LoggerPP::getInstance().enableErrors();
+	liveDev->close();
+
+	// a negative test - device isn't opened
+	pcpp::LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(liveDev->startCaptureMultiThread(&packetArrives, cookies));
+	pcpp::LoggerPP::getInstance().enableErrors();
+#else
+	PTF_SKIP_TEST("Multi-threaded capture is supported only on Linux");
+#endif
+} // TestPcapLiveDeviceMultiThread
+
+
+
+PTF_TEST_CASE(TestPcapLiveDeviceMultiThreadWithFilter)
+{
+#ifdef LINUX
+	pcpp::IPv4Address ipToSearch(PcapTestGlobalArgs.ipToSendReceivePackets.c_str());
+	pcpp::PcapLiveDevice* liveDev = pcpp::PcapLiveDeviceList::getInstance().getPcapLiveDeviceByIp(ipToSearch);
+	PTF_ASSERT_NOT_NULL(liveDev);
+	PTF_ASSERT_TRUE(liveDev->open());
+	DeviceTeardown devTeardown(liveDev);
+
+	// a filter set before the capture starts applies to all capture threads
+	std::string dstFilter = "dst host " + PcapTestGlobalArgs.ipToSendReceivePackets;
+	PTF_ASSERT_TRUE(liveDev->setFilter(dstFilter));
+
+	const int numOfThreads = 4;
+	std::vector<FanoutFilterStats> threadStats(numOfThreads, FanoutFilterStats(ipToSearch));
+	std::vector<void*> cookies;
+	for (int i = 0; i < numOfThreads; i++)
+		cookies.push_back(&threadStats[i]);
+
+	PTF_ASSERT_TRUE(liveDev->startCaptureMultiThread(&fanoutFilterPacketArrives, cookies));
+	PTF_ASSERT_TRUE(sendURLRequest("www.google.com"));
+	int totalSleepTime = 0;
+	while (totalSleepTime < 10 && sumFanoutFilterStats(threadStats).numOfPackets < 2)
+	{
+		pcpp::multiPlatformSleep(1);
+		totalSleepTime++;
+	}
+
+	FanoutFilterStats total = sumFanoutFilterStats(threadStats);
+	PTF_ASSERT_GREATER_THAN(total.numOfPackets, 0, int);
+	PTF_ASSERT_EQUAL(total.numOfOtherDstPackets, 0, int);
+
+	// a filter set during the capture applies to all capture threads too. Packets that were already being delivered are let through
+	// before the counters are taken
+	PTF_ASSERT_TRUE(liveDev->setFilter(dstFilter + " and tcp"));
+	pcpp::multiPlatformSleep(1);
+	FanoutFilterStats totalBefore = sumFanoutFilterStats(threadStats);
+	PTF_ASSERT_TRUE(sendURLRequest("www.yahoo.com"));
+	totalSleepTime = 0;
+	while (totalSleepTime < 10 && sumFanoutFilterStats(threadStats).numOfPackets < totalBefore.numOfPackets + 2)
+	{
+		pcpp::multiPlatformSleep(1);
+		totalSleepTime++;
+	}
+
+	liveDev->stopCapture();
+	total = sumFanoutFilterStats(threadStats);
+	PTF_ASSERT_GREATER_THAN(total.numOfPackets, totalBefore.numOfPackets, int);
+	PTF_ASSERT_EQUAL(total.numOfOtherDstPackets, 0, int);
+	PTF_ASSERT_EQUAL(total.numOfNonTcpPackets, totalBefore.numOfNonTcpPackets, int);
+
+	// the device gets the last filter back when the multi-threaded capture stops
+	pcpp::RawPacketVector capturedPackets;
+	PTF_ASSERT_TRUE(liveDev->startCapture(capturedPackets));
+	PTF_ASSERT_TRUE(sendURLRequest("www.google.com"));
+	totalSleepTime = 0;
+	while (totalSleepTime < 10 && capturedPackets.size() < 2)
+	{
+		pcpp::multiPlatformSleep(1);
+		totalSleepTime++;
+	}
+	liveDev->stopCapture();
+	PTF_ASSERT_GREATER_THAN(capturedPackets.size(), 0, size);
+	for (pcpp::RawPacketVector::VectorIterator iter = capturedPackets.begin(); iter != capturedPackets.end(); iter++)
+	{
+		pcpp::Packet packet(*iter);
+		PTF_ASSERT_TRUE(packet.isPacketOfType(pcpp::TCP));
+		PTF_ASSERT_EQUAL(packet.getLayerOfType<pcpp::IPv4Layer>()->getDstIpAddress(), ipToSearch, object);
+	}
+#else
+	PTF_SKIP_TEST("Multi-threaded capture is supported only on Linux");
+#endif
+} // TestPcapLiveDeviceMultiThreadWithFilter
+
+
+
 PTF_TEST_CASE(TestWinPcapLiveDevice)
 {
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
@@ -5,6 +5,7 @@
 #include "Packet.h"
 #include "RawSocketDevice.h"
 #include "PcapFileDevice.h"
+#include <set>
 
 extern PcapTestArgs PcapTestGlobalArgs;
 
@@ -160,4 +161,88 @@ PTF_TEST_CASE(TestRawSockets)
 		PTF_ASSERT_FALSE(rawSock.sendPackets(packetVec));
 		pcpp::LoggerPP::getInstance().enableErrors();
 	}
-} // TestRawSockets
\ No newline at end of file
+} // TestRawSockets
+
+
+PTF_TEST_CASE(TestRawSocketBurstIO)
+{
+#ifdef LINUX
+	pcpp::IPAddress ipAddr = pcpp::IPAddress(PcapTestGlobalArgs.ipToSendReceivePackets);
+	PTF_ASSERT_TRUE(ipAddr.isValid());
+
+	pcpp::PcapFileReaderDevice readerDev(EXAMPLE2_PCAP_PATH);
+	PTF_ASSERT_TRUE(readerDev.open());
+	pcpp::RawPacketVector packetVec;
+	readerDev.getNextPackets(packetVec, 100);
+	readerDev.close();
+
+	// keep only packets that can be sent
+	std::set<std::string> sentPacketsData;
+	pcpp::RawPacketVector::VectorIterator iter = packetVec.begin();
+	while (iter != packetVec.end())
+	{
+		pcpp::Packet parsedPacket(*iter);
+		if (!parsedPacket.isPacketOfType(pcpp::Ethernet))
+		{
+			iter = packetVec.erase(iter);
+			continue;
+		}
+
+		sentPacketsData.insert(std::string((const char*)(*iter)->getRawData(), (*iter)->getRawDataLen()));
+		iter++;
+	}
+	PTF_ASSERT_GREATER_THAN(packetVec.size(), 0, size);
+
+	pcpp::RawSocketDevice::IOMode ioModes[] = { pcpp::RawSocketDevice::BatchIO, pcpp::RawSocketDevice::RingIO };
+	for (int modeIndex = 0; modeIndex < 2; modeIndex++)
+	{
+		pcpp::RawSocketDevice::DeviceConfiguration config(ioModes[modeIndex]);
+		pcpp::RawSocketDevice receiver(ipAddr);
+		PTF_ASSERT_TRUE(receiver.open(config));
+		PTF_ASSERT_EQUAL(receiver.getIOMode(), ioModes[modeIndex], enum);
+		pcpp::RawSocketDevice sender(ipAddr);
+		PTF_ASSERT_TRUE(sender.open(config));
+
+		PTF_ASSERT_EQUAL(sender.sendPackets(packetVec), (int)packetVec.size(), int);
+
+		// the receiver sees the packets sent from the other socket, and possibly other traffic on the interface
+		pcpp::RawPacket packetBurst[32];
+		size_t numOfSentPacketsReceived = 0;
+		for (int i = 0; i < 20 && numOfSentPacketsReceived < packetVec.size(); i++)
+		{
+			int numOfPackets = receiver.receivePacketBurst(packetBurst, 32, true, 1);
+			PTF_ASSERT_LOWER_OR_EQUAL_THAN(numOfPackets, 32, int);
+			for (int j = 0; j < numOfPackets; j++)
+			{
+				if (sentPacketsData.find(std::string((const char*)packetBurst[j].getRawData(), packetBurst[j].getRawDataLen())) != sentPacketsData.end())
+					numOfSentPacketsReceived++;
+			}
+		}
+		PTF_ASSERT_GREATER_OR_EQUAL_THAN(numOfSentPacketsReceived, packetVec.size(), size);
+
+		// packets in an array are sent the same way
+		pcpp::RawPacket packetArr[10];
+		int arrLength = (packetVec.size() < 10 ? (int)packetVec.size() : 10);
+		for (int i = 0; i < arrLength; i++)
+			packetArr[i] = *packetVec.at(i);
+		PTF_ASSERT_EQUAL(sender.sendPackets(packetArr, arrLength), arrLength, int);
+
+		// single packets are received and sent too
+		pcpp::RawPacket rawPacket;
+		PTF_ASSERT_EQUAL(receiver.receivePacket(rawPacket, true, 5), pcpp::RawSocketDevice::RecvSuccess, enum);
+		PTF_ASSERT_TRUE(sender.sendPacket(packetVec.at(0)));
+
+		receiver.close();
+		sender.close();
+	}
+
+	// a ring block size which isn't a multiple of the page size is rejected
+	pcpp::RawSocketDevice badConfigDevice(ipAddr);
+	pcpp::LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(badConfigDevice.open(pcpp::RawSocketDevice::DeviceConfiguration(pcpp::RawSocketDevice::RingIO, 32, 1000)));
+	pcpp::LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_FALSE(badConfigDevice.isOpened());
+#else
+	PTF_SKIP_TEST("Batch and ring I/O modes are supported on Linux only");
+#endif
+} // TestRawSocketBurstIO
@@ -6,10 +6,13 @@
 #include "EndianPortable.h"
 #include "SystemUtils.h"
 #include "TcpReassembly.h"
+#include "ShardedTcpReassembly.h"
+#include "EthLayer.h"
 #include "IPv4Layer.h"
 #include "TcpLayer.h"
 #include "PayloadLayer.h"
 #include "PcapFileDevice.h"
+#include "Logger.h"
 
 
 // ~~~~~~~~~~~~~~~~~~
@@ -25,12 +28,13 @@ struct TcpReassemblyStats
 	bool connectionsStarted;
 	bool connectionsEnded;
 	bool connectionsEndedManually;
+	bool connectionsEvicted;
 	size_t totalMissingBytes;
 	pcpp::ConnectionData connData;
 
 	TcpReassemblyStats() { clear(); }
 
-	void clear() { reassembledData = ""; numOfDataPackets = 0; curSide = -1; numOfMessagesFromSide[0] = 0; numOfMessagesFromSide[1] = 0; connectionsStarted = false; connectionsEnded = false; connectionsEndedManually = false; totalMissingBytes = 0;}
+	void clear() { reassembledData = ""; numOfDataPackets = 0; curSide = -1; numOfMessagesFromSide[0] = 0; numOfMessagesFromSide[1] = 0; connectionsStarted = false; connectionsEnded = false; connectionsEndedManually = false; connectionsEvicted = false; totalMissingBytes = 0;}
 };
 
 
@@ -163,6 +167,8 @@ static void tcpReassemblyConnectionEndCallback(const pcpp::ConnectionData& conne
 
 	if (reason == pcpp::TcpReassembly::TcpReassemblyConnectionClosedManually)
 		iter->second.connectionsEndedManually = true;
+	else if (reason == pcpp::TcpReassembly::TcpReassemblyConnectionEvicted)
+		iter->second.connectionsEvicted = true;
 	else
 		iter->second.connectionsEnded = true;
 }
@@ -209,6 +215,57 @@ static bool tcpReassemblyTest(std::vector<pcpp::RawPacket>& packetStream, TcpRea
 }
 
 
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// ShardedTcpReassembly test callbacks
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// callbacks of different shards run concurrently, so each shard collects its results separately
+struct ShardedTcpReassemblyTestCookie
+{
+	std::vector<TcpReassemblyMultipleConnStats> shardResults;
+	bool callbackOutsideWorker;
+};
+
+static void shardedTcpReassemblyMsgReadyCallback(int8_t sideIndex, const pcpp::TcpStreamData& tcpData, void* userCookie)
+{
+	ShardedTcpReassemblyTestCookie* cookie = (ShardedTcpReassemblyTestCookie*)userCookie;
+	int shardId = pcpp::ShardedTcpReassembly::getCurrentShardId();
+	if (shardId < 0)
+	{
+		cookie->callbackOutsideWorker = true;
+		return;
+	}
+
+	tcpReassemblyMsgReadyCallback(sideIndex, tcpData, &cookie->shardResults[shardId]);
+}
+
+static void shardedTcpReassemblyConnectionStartCallback(const pcpp::ConnectionData& connectionData, void* userCookie)
+{
+	ShardedTcpReassemblyTestCookie* cookie = (ShardedTcpReassemblyTestCookie*)userCookie;
+	int shardId = pcpp::ShardedTcpReassembly::getCurrentShardId();
+	if (shardId < 0)
+	{
+		cookie->callbackOutsideWorker = true;
+		return;
+	}
+
+	tcpReassemblyConnectionStartCallback(connectionData, &cookie->shardResults[shardId]);
+}
+
+static void shardedTcpReassemblyConnectionEndCallback(const pcpp::ConnectionData& connectionData, pcpp::TcpReassembly::ConnectionEndReason reason, void* userCookie)
+{
+	ShardedTcpReassemblyTestCookie* cookie = (ShardedTcpReassemblyTestCookie*)userCookie;
+	int shardId = pcpp::ShardedTcpReassembly::getCurrentShardId();
+	if (shardId < 0)
+	{
+		cookie->callbackOutsideWorker = true;
+		return;
+	}
+
+	tcpReassemblyConnectionEndCallback(connectionData, reason, &cookie->shardResults[shardId]);
+}
+
+
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // tcpReassemblyAddRetransmissions()
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -263,6 +320,33 @@ static pcpp::RawPacket tcpReassemblyAddRetransmissions(pcpp::RawPacket rawPacket
 }
 
 
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// tcpReassemblyCreateDataPacket()
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static pcpp::RawPacket tcpReassemblyCreateDataPacket(uint16_t srcPort, uint32_t sequence, size_t dataLength, char fillChar = 'a')
+{
+	pcpp::Packet packet(100 + dataLength);
+
+	pcpp::EthLayer ethLayer(pcpp::MacAddress("00:11:22:33:44:55"), pcpp::MacAddress("66:77:88:99:aa:bb"));
+	pcpp::IPv4Layer ipLayer(pcpp::IPv4Address(std::string("10.0.0.1")), pcpp::IPv4Address(std::string("10.0.0.2")));
+	ipLayer.getIPv4Header()->timeToLive = 64;
+	pcpp::TcpLayer tcpLayer(srcPort, 80);
+	tcpLayer.getTcpHeader()->sequenceNumber = htobe32(sequence);
+	tcpLayer.getTcpHeader()->ackFlag = 1;
+	std::vector<uint8_t> data(dataLength, fillChar);
+	pcpp::PayloadLayer payloadLayer(&data[0], dataLength, false);
+
+	packet.addLayer(&ethLayer);
+	packet.addLayer(&ipLayer);
+	packet.addLayer(&tcpLayer);
+	packet.addLayer(&payloadLayer);
+	packet.computeCalculateFields();
+
+	return *(packet.getRawPacket());
+}
+
+
 
 // ~~~~~~~~~~~~~~~~~~~~~
 // ~~~~~~~~~~~~~~~~~~~~~
@@ -1053,4 +1137,255 @@ PTF_TEST_CASE(TestTcpReassemblyMaxSeq)
 
 	std::string expectedReassemblyData = readFileIntoString(std::string("PcapExamples/one_tcp_stream_output.txt"));
 	PTF_ASSERT_EQUAL(expectedReassemblyData, stats.begin()->second.reassembledData, string);
-} //TestTcpReassemblyMaxSeq
\ No newline at end of file
+} //TestTcpReassemblyMaxSeq
+
+
+
+PTF_TEST_CASE(TestTcpReassemblyEviction)
+{
+	// a connection table limited to 100 connections evicts the connection that was idle the longest
+	TcpReassemblyMultipleConnStats results;
+	pcpp::TcpReassemblyConfiguration config(true, 5, 30, 0, 100);
+	pcpp::TcpReassembly tcpReassembly(tcpReassemblyMsgReadyCallback, &results, tcpReassemblyConnectionStartCallback, tcpReassemblyConnectionEndCallback, config);
+
+	const int numOfConnections = 1000;
+	pcpp::RawPacket keepAlivePacket;
+	for (int i = 0; i < numOfConnections; i++)
+	{
+		pcpp::RawPacket rawPacket = tcpReassemblyCreateDataPacket(10000 + i, 1000, 10);
+		tcpReassembly.reassemblePacket(&rawPacket);
+
+		// keep the first connection active so it's never the one idle the longest
+		if (i > 0)
+		{
+			keepAlivePacket = tcpReassemblyCreateDataPacket(10000, 1000 + 10 * i, 10);
+			tcpReassembly.reassemblePacket(&keepAlivePacket);
+		}
+
+		PTF_ASSERT_LOWER_OR_EQUAL_THAN(tcpReassembly.getNumOfConnections(), 100, size);
+	}
+
+	PTF_ASSERT_EQUAL(results.flowKeysList.size(), numOfConnections, size);
+	PTF_ASSERT_EQUAL(tcpReassembly.getConnectionInformation().size(), 100, size);
+
+	int numOfEvicted = 0;
+	for (TcpReassemblyMultipleConnStats::Stats::iterator iter = results.stats.begin(); iter != results.stats.end(); iter++)
+	{
+		if (iter->second.connectionsEvicted)
+		{
+			numOfEvicted++;
+			PTF_ASSERT_EQUAL(iter->second.numOfDataPackets, 1, int);
+			PTF_ASSERT_EQUAL(tcpReassembly.isConnectionOpen(iter->second.connData), -1, int);
+		}
+	}
+	PTF_ASSERT_EQUAL(numOfEvicted, numOfConnections - 100, int);
+
+	TcpReassemblyStats& firstConnStats = results.stats[results.flowKeysList[0]];
+	PTF_ASSERT_FALSE(firstConnStats.connectionsEvicted);
+	PTF_ASSERT_EQUAL(firstConnStats.numOfDataPackets, numOfConnections, int);
+
+	// the connections left in the table were the last ones seen
+	TcpReassemblyStats& lastConnStats = results.stats[results.flowKeysList[numOfConnections - 1]];
+	PTF_ASSERT_FALSE(lastConnStats.connectionsEvicted);
+	PTF_ASSERT_GREATER_THAN(tcpReassembly.isConnectionOpen(lastConnStats.connData), 0, int);
+
+	tcpReassembly.closeAllConnections();
+	PTF_ASSERT_TRUE(firstConnStats.connectionsEndedManually);
+	PTF_ASSERT_TRUE(lastConnStats.connectionsEndedManually);
+	PTF_ASSERT_EQUAL(tcpReassembly.getNumOfConnections(), 100, size);
+
+
+	// a memory cap evicts idle connections, and drops the out-of-order data of a connection that exceeds the cap on its own
+	TcpReassemblyMultipleConnStats memCapResults;
+	const uint64_t memoryCap = 64 * 1024;
+	pcpp::TcpReassemblyConfiguration memCapConfig(true, 5, 30, 0, 0, memoryCap);
+	pcpp::TcpReassembly memCapTcpReassembly(tcpReassemblyMsgReadyCallback, &memCapResults, tcpReassemblyConnectionStartCallback, tcpReassemblyConnectionEndCallback, memCapConfig);
+
+	for (int i = 0; i < 200; i++)
+	{
+		// a packet that opens the connection and a packet after a gap which is kept as out-of-order data
+		pcpp::RawPacket firstPacket = tcpReassemblyCreateDataPacket(20000 + i, 1000, 10);
+		pcpp::RawPacket outOfOrderPacket = tcpReassemblyCreateDataPacket(20000 + i, 2000, 1000);
+		memCapTcpReassembly.reassemblePacket(&firstPacket);
+		PTF_ASSERT_EQUAL(memCapTcpReassembly.reassemblePacket(&outOfOrderPacket), pcpp::TcpReassembly::OutOfOrderTcpMessageBuffered, enum);
+		PTF_ASSERT_LOWER_OR_EQUAL_THAN(memCapTcpReassembly.getMemoryUsage(), memoryCap, u64);
+	}
+
+	PTF_ASSERT_LOWER_THAN(memCapTcpReassembly.getNumOfConnections(), 200, size);
+	TcpReassemblyStats& evictedConnStats = memCapResults.stats[memCapResults.flowKeysList[0]];
+	PTF_ASSERT_TRUE(evictedConnStats.connectionsEvicted);
+	PTF_ASSERT_EQUAL(evictedConnStats.numOfDataPackets, 2, int);
+	PTF_ASSERT_EQUAL(evictedConnStats.totalMissingBytes, 990, size);
+
+	pcpp::RawPacket bigConnFirstPacket = tcpReassemblyCreateDataPacket(30000, 1000, 10);
+	memCapTcpReassembly.reassemblePacket(&bigConnFirstPacket);
+	for (int i = 0; i < 100; i++)
+	{
+		pcpp::RawPacket outOfOrderPacket = tcpReassemblyCreateDataPacket(30000, 2000 + 1000 * i, 1000);
+		memCapTcpReassembly.reassemblePacket(&outOfOrderPacket);
+		PTF_ASSERT_LOWER_OR_EQUAL_THAN(memCapTcpReassembly.getMemoryUsage(), memoryCap, u64);
+	}
+	TcpReassemblyStats& bigConnStats = memCapResults.stats[memCapResults.flowKeysList.back()];
+	PTF_ASSERT_FALSE(bigConnStats.connectionsEvicted);
+	PTF_ASSERT_EQUAL(bigConnStats.totalMissingBytes, 990, size);
+	PTF_ASSERT_EQUAL(memCapTcpReassembly.getNumOfConnections(), 1, size);
+} // TestTcpReassemblyEviction
+
+
+
+PTF_TEST_CASE(TestTcpReassemblyOOOBytes)
+{
+	// out-of-order fragments are delivered in sequence order no matter the order they arrived in, and retransmitted ones are stored once
+	TcpReassemblyMultipleConnStats results;
+	pcpp::TcpReassembly tcpReassembly(tcpReassemblyMsgReadyCallback, &results, tcpReassemblyConnectionStartCallback, tcpReassemblyConnectionEndCallback);
+
+	pcpp::RawPacket packet1 = tcpReassemblyCreateDataPacket(10000, 1000, 10, 'a');
+	pcpp::RawPacket packet2 = tcpReassemblyCreateDataPacket(10000, 1010, 990, 'b');
+	pcpp::RawPacket packet3 = tcpReassemblyCreateDataPacket(10000, 2000, 1000, 'c');
+	pcpp::RawPacket packet4 = tcpReassemblyCreateDataPacket(10000, 3000, 1000, 'd');
+	pcpp::RawPacket packet5 = tcpReassemblyCreateDataPacket(10000, 4000, 1000, 'e');
+
+	PTF_ASSERT_EQUAL(tcpReassembly.reassemblePacket(&packet1), pcpp::TcpReassembly::TcpMessageHandled, enum);
+	PTF_ASSERT_EQUAL(tcpReassembly.reassemblePacket(&packet5), pcpp::TcpReassembly::OutOfOrderTcpMessageBuffered, enum);
+	PTF_ASSERT_EQUAL(tcpReassembly.reassemblePacket(&packet3), pcpp::TcpReassembly::OutOfOrderTcpMessageBuffered, enum);
+	PTF_ASSERT_EQUAL(tcpReassembly.reassemblePacket(&packet4), pcpp::TcpReassembly::OutOfOrderTcpMessageBuffered, enum);
+	PTF_ASSERT_EQUAL(tcpReassembly.reassemblePacket(&packet4), pcpp::TcpReassembly::OutOfOrderTcpMessageBuffered, enum);
+	PTF_ASSERT_EQUAL(tcpReassembly.getOutOfOrderBytes(), 3000, u64);
+	PTF_ASSERT_EQUAL(tcpReassembly.reassemblePacket(&packet2), pcpp::TcpReassembly::TcpMessageHandled, enum);
+	PTF_ASSERT_EQUAL(tcpReassembly.getOutOfOrderBytes(), 0, u64);
+
+	TcpReassemblyStats& stats = results.stats.begin()->second;
+	PTF_ASSERT_EQUAL(stats.numOfDataPackets, 5, int);
+	PTF_ASSERT_EQUAL(stats.totalMissingBytes, 0, size);
+	std::string expectedData = std::string(10, 'a') + std::string(990, 'b') + std::string(1000, 'c') + std::string(1000, 'd') + std::string(1000, 'e');
+	PTF_ASSERT_EQUAL(stats.reassembledData, expectedData, string);
+
+
+	// a per-connection budget considers the data before the first stored fragment missing once it's exceeded
+	TcpReassemblyMultipleConnStats connBudgetResults;
+	pcpp::TcpReassemblyConfiguration connBudgetConfig(true, 5, 30, 0, 0, 0, 3000);
+	pcpp::TcpReassembly connBudgetTcpReassembly(tcpReassemblyMsgReadyCallback, &connBudgetResults, NULL, NULL, connBudgetConfig);
+
+	connBudgetTcpReassembly.reassemblePacket(&packet1);
+	connBudgetTcpReassembly.reassemblePacket(&packet3);
+	connBudgetTcpReassembly.reassemblePacket(&packet4);
+	pcpp::RawPacket packet6 = tcpReassemblyCreateDataPacket(10000, 5000, 1000, 'f');
+	connBudgetTcpReassembly.reassemblePacket(&packet6);
+	PTF_ASSERT_EQUAL(connBudgetTcpReassembly.getOutOfOrderBytes(), 3000, u64);
+	PTF_ASSERT_EQUAL(connBudgetResults.stats.begin()->second.numOfDataPackets, 1, int);
+
+	// the fourth fragment exceeds the budget, so the gap before the first one is skipped and all fragments are delivered
+	connBudgetTcpReassembly.reassemblePacket(&packet5);
+	PTF_ASSERT_EQUAL(connBudgetTcpReassembly.getOutOfOrderBytes(), 0, u64);
+	PTF_ASSERT_EQUAL(connBudgetResults.stats.begin()->second.numOfDataPackets, 5, int);
+	PTF_ASSERT_EQUAL(connBudgetResults.stats.begin()->second.totalMissingBytes, 990, size);
+
+
+	// a global budget releases the out-of-order data of the connections that were idle the longest without closing them
+	TcpReassemblyMultipleConnStats globalBudgetResults;
+	pcpp::TcpReassemblyConfiguration globalBudgetConfig(true, 5, 30, 0, 0, 0, 0, 5000);
+	pcpp::TcpReassembly globalBudgetTcpReassembly(tcpReassemblyMsgReadyCallback, &globalBudgetResults, tcpReassemblyConnectionStartCallback, tcpReassemblyConnectionEndCallback, globalBudgetConfig);
+
+	for (int i = 0; i < 10; i++)
+	{
+		pcpp::RawPacket firstPacket = tcpReassemblyCreateDataPacket(20000 + i, 1000, 10);
+		pcpp::RawPacket outOfOrderPacket = tcpReassemblyCreateDataPacket(20000 + i, 2000, 1000);
+		globalBudgetTcpReassembly.reassemblePacket(&firstPacket);
+		globalBudgetTcpReassembly.reassemblePacket(&outOfOrderPacket);
+		PTF_ASSERT_LOWER_OR_EQUAL_THAN(globalBudgetTcpReassembly.getOutOfOrderBytes(), 5000, u64);
+	}
+
+	PTF_ASSERT_EQUAL(globalBudgetTcpReassembly.getOutOfOrderBytes(), 5000, u64);
+	PTF_ASSERT_EQUAL(globalBudgetTcpReassembly.getNumOfConnections(), 10, size);
+	for (int i = 0; i < 10; i++)
+	{
+		TcpReassemblyStats& connStats = globalBudgetResults.stats[globalBudgetResults.flowKeysList[i]];
+		PTF_ASSERT_FALSE(connStats.connectionsEvicted);
+		PTF_ASSERT_GREATER_THAN(globalBudgetTcpReassembly.isConnectionOpen(connStats.connData), 0, int);
+		PTF_ASSERT_EQUAL(connStats.numOfDataPackets, (i < 5 ? 2 : 1), int);
+		PTF_ASSERT_EQUAL(connStats.totalMissingBytes, (size_t)(i < 5 ? 990 : 0), size);
+	}
+} // TestTcpReassemblyOOOBytes
+
+
+
+PTF_TEST_CASE(TestTcpReassemblySharded)
+{
+	std::string errMsg;
+	std::vector<pcpp::RawPacket> packetStream;
+	PTF_ASSERT_TRUE(readPcapIntoPacketVec("PcapExamples/three_http_streams.pcap", packetStream, errMsg));
+
+	// add many short connections so all shards get work
+	for (int i = 0; i < 300; i++)
+	{
+		packetStream.push_back(tcpReassemblyCreateDataPacket(10000 + i, 1000, 100, 'a' + (i % 26)));
+		packetStream.push_back(tcpReassemblyCreateDataPacket(10000 + i, 1100, 50, 'A' + (i % 26)));
+	}
+
+	// the results of a single TcpReassembly instance are the reference
+	TcpReassemblyMultipleConnStats expectedResults;
+	tcpReassemblyTest(packetStream, expectedResults, true, true);
+
+	const uint16_t numOfShards = 3;
+	ShardedTcpReassemblyTestCookie cookie;
+	cookie.shardResults.resize(numOfShards);
+	cookie.callbackOutsideWorker = false;
+
+	// a tiny ring makes the producer wait for the workers
+	pcpp::ShardedTcpReassembly shardedTcpReassembly(shardedTcpReassemblyMsgReadyCallback, &cookie, shardedTcpReassemblyConnectionStartCallback, shardedTcpReassemblyConnectionEndCallback, pcpp::TcpReassemblyConfiguration(), numOfShards, 5);
+	PTF_ASSERT_EQUAL(shardedTcpReassembly.getNumOfShards(), numOfShards, u16);
+	PTF_ASSERT_EQUAL(pcpp::ShardedTcpReassembly::getCurrentShardId(), -1, int);
+	PTF_ASSERT_NOT_NULL(shardedTcpReassembly.getShard(numOfShards - 1));
+	PTF_ASSERT_NULL(shardedTcpReassembly.getShard(numOfShards));
+
+	pcpp::LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(shardedTcpReassembly.reassemblePacket(&packetStream.front()));
+	pcpp::LoggerPP::getInstance().enableErrors();
+
+	PTF_ASSERT_TRUE(shardedTcpReassembly.start());
+	PTF_ASSERT_TRUE(shardedTcpReassembly.isRunning());
+	for (std::vector<pcpp::RawPacket>::iterator iter = packetStream.begin(); iter != packetStream.end(); iter++)
+	{
+		pcpp::Packet packet(&(*iter));
+		PTF_ASSERT_TRUE(shardedTcpReassembly.reassemblePacket(packet));
+	}
+	shardedTcpReassembly.closeAllConnections();
+	shardedTcpReassembly.stop();
+	PTF_ASSERT_FALSE(shardedTcpReassembly.isRunning());
+	PTF_ASSERT_FALSE(cookie.callbackOutsideWorker);
+	PTF_ASSERT_EQUAL(shardedTcpReassembly.getNumOfDroppedPackets(), 0, u64);
+
+	// every connection was handled by the shard its flow key maps to, with the same results as a single instance
+	size_t numOfConnections = 0;
+	for (uint16_t shardId = 0; shardId < numOfShards; shardId++)
+	{
+		TcpReassemblyMultipleConnStats::Stats& shardStats = cookie.shardResults[shardId].stats;
+		PTF_ASSERT_GREATER_THAN(shardStats.size(), 0, size);
+		numOfConnections += shardStats.size();
+
+		for (TcpReassemblyMultipleConnStats::Stats::iterator iter = shardStats.begin(); iter != shardStats.end(); iter++)
+		{
+			PTF_ASSERT_EQUAL(shardedTcpReassembly.getShardIdForFlowKey(iter->first), shardId, u16);
+			TcpReassemblyMultipleConnStats::Stats::iterator expectedIter = expectedResults.stats.find(iter->first);
+			PTF_ASSERT_TRUE(expectedIter != expectedResults.stats.end());
+			PTF_ASSERT_EQUAL(iter->second.numOfDataPackets, expectedIter->second.numOfDataPackets, int);
+			PTF_ASSERT_EQUAL(iter->second.numOfMessagesFromSide[0], expectedIter->second.numOfMessagesFromSide[0], int);
+			PTF_ASSERT_EQUAL(iter->second.numOfMessagesFromSide[1], expectedIter->second.numOfMessagesFromSide[1], int);
+			PTF_ASSERT_TRUE(iter->second.connectionsStarted == expectedIter->second.connectionsStarted);
+			PTF_ASSERT_TRUE(iter->second.connectionsEnded == expectedIter->second.connectionsEnded);
+			PTF_ASSERT_TRUE(iter->second.connectionsEndedManually == expectedIter->second.connectionsEndedManually);
+			PTF_ASSERT_EQUAL(iter->second.reassembledData, expectedIter->second.reassembledData, string);
+		}
+	}
+	PTF_ASSERT_EQUAL(numOfConnections, expectedResults.stats.size(), size);
+	PTF_ASSERT_EQUAL(numOfConnections, 303, size);
+
+	// the workers can be started again, and when they're stopped connections are closed on the calling thread
+	PTF_ASSERT_TRUE(shardedTcpReassembly.start());
+	pcpp::RawPacket newConnPacket = tcpReassemblyCreateDataPacket(20000, 1000, 10);
+	PTF_ASSERT_TRUE(shardedTcpReassembly.reassemblePacket(&newConnPacket));
+	shardedTcpReassembly.stop();
+	PTF_ASSERT_FALSE(cookie.callbackOutsideWorker);
+	shardedTcpReassembly.closeAllConnections();
+	PTF_ASSERT_TRUE(cookie.callbackOutsideWorker);
+} // TestTcpReassemblySharded
@@ -198,6 +198,7 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(TestIPAddress, "no_network;ip");
 	PTF_RUN_TEST(TestMacAddress, "no_network;mac");
 	PTF_RUN_TEST(TestLRUList, "no_network");
+	PTF_RUN_TEST(TestLockFreeRing, "no_network");
 	PTF_RUN_TEST(TestGeneralUtils, "no_network");
 	PTF_RUN_TEST(TestGetMacAddress, "mac");
 
@@ -207,8 +208,15 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(TestPcapFileAppend, "no_network;pcap");
 	PTF_RUN_TEST(TestPcapNgFileReadWrite, "no_network;pcap;pcapng");
 	PTF_RUN_TEST(TestPcapNgFileReadWriteAdv, "no_network;pcap;pcapng");
+	PTF_RUN_TEST(TestPcapNgFileReadWriteZstdLarge, "no_network;pcap;pcapng");
 	PTF_RUN_TEST(TestPcapFileReadLinkTypeIPv6, "no_network;pcap");
 	PTF_RUN_TEST(TestPcapFileReadLinkTypeIPv4, "no_network;pcap");
+	PTF_RUN_TEST(TestPcapFileReadZeroCopy, "no_network;pcap;pcapng");
+	PTF_RUN_TEST(TestMmapPcapFileRead, "no_network;pcap;pcapng");
+	PTF_RUN_TEST(TestAsyncPcapFileWrite, "no_network;pcap");
+	PTF_RUN_TEST(TestRotatingFileWriter, "no_network;pcap;pcapng");
+	PTF_RUN_TEST(TestPcapFileIndex, "no_network;pcap;pcapng");
+	PTF_RUN_TEST(TestParallelFileProcessor, "no_network;pcap;pcapng");
 
 	PTF_RUN_TEST(TestPcapLiveDeviceList, "no_network;live_device;skip_mem_leak_check");
 	PTF_RUN_TEST(TestPcapLiveDeviceListSearch, "live_device");
@@ -217,6 +225,9 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(TestPcapLiveDeviceStatsMode, "live_device");
 	PTF_RUN_TEST(TestPcapLiveDeviceBlockingMode, "live_device");
 	PTF_RUN_TEST(TestPcapLiveDeviceSpecialCfg, "live_device");
+	PTF_RUN_TEST(TestPcapLiveDeviceBurstMode, "live_device");
+	PTF_RUN_TEST(TestPcapLiveDeviceMultiThread, "live_device");
+	PTF_RUN_TEST(TestPcapLiveDeviceMultiThreadWithFilter, "live_device");
 	PTF_RUN_TEST(TestWinPcapLiveDevice, "live_device;winpcap");
 	PTF_RUN_TEST(TestSendPacket, "live_device;send");
 	PTF_RUN_TEST(TestSendPackets, "live_device;send");
@@ -227,6 +238,8 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(TestPcapFilters_General_BPFStr, "no_network;filters;skip_mem_leak_check");
 	PTF_RUN_TEST(TestPcapFiltersOffline, "no_network;filters");
 	PTF_RUN_TEST(TestPcapFilters_LinkLayer, "no_network;filters;skip_mem_leak_check");
+	PTF_RUN_TEST(TestThreadedBpfProgram, "no_network;filters");
+	PTF_RUN_TEST(TestPacketClassifier, "no_network;filters");
 
 	PTF_RUN_TEST(TestHttpRequestParsing, "no_network;http");
 	PTF_RUN_TEST(TestHttpResponseParsing, "no_network;http");
@@ -264,6 +277,9 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(TestTcpReassemblyCleanup, "no_network;tcp_reassembly");
 	PTF_RUN_TEST(TestTcpReassemblyMaxOOOFrags, "no_network;tcp_reassembly");
 	PTF_RUN_TEST(TestTcpReassemblyMaxSeq, "no_network;tcp_reassembly");
+	PTF_RUN_TEST(TestTcpReassemblyEviction, "no_network;tcp_reassembly");
+	PTF_RUN_TEST(TestTcpReassemblyOOOBytes, "no_network;tcp_reassembly");
+	PTF_RUN_TEST(TestTcpReassemblySharded, "no_network;tcp_reassembly");
 
 	PTF_RUN_TEST(TestIPFragmentationSanity, "no_network;ip_frag");
 	PTF_RUN_TEST(TestIPFragOutOfOrder, "no_network;ip_frag");
@@ -271,8 +287,10 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(TestIPFragMultipleFrags, "no_network;ip_frag");
 	PTF_RUN_TEST(TestIPFragMapOverflow, "no_network;ip_frag");
 	PTF_RUN_TEST(TestIPFragRemove, "no_network;ip_frag");
+	PTF_RUN_TEST(TestIPFragBufferLimits, "no_network;ip_frag");
 
 	PTF_RUN_TEST(TestRawSockets, "raw_sockets");
+	PTF_RUN_TEST(TestRawSocketBurstIO, "raw_sockets");
 
 	PTF_END_RUNNING_TESTS;
 }